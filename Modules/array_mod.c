@@ -0,0 +1,112 @@
+#include "../src/module.h"
+#include "../src/packed_array.h"
+#include <stdlib.h>
+
+// Packed float64 arrays for scripts, held by handle (a positive number).
+// Native modules fill and consume them whole (csv.column, ...), so a
+// million values cost one call instead of a million. Errors return -1
+// (handles and lengths), null (values) or false.
+
+static PackedArray* array_arg(Value* args, size_t arg_count, size_t i) {
+    if (i >= arg_count || args[i].type != VAL_NUMBER) return NULL;
+    return packed_array_lookup(args[i].as.number);
+}
+
+// Index argument i as a position in the array, or -1
+static double index_arg(const PackedArray* array, Value* args, size_t arg_count, size_t i) {
+    if (!array || i >= arg_count || args[i].type != VAL_NUMBER) return -1;
+    double index = args[i].as.number;
+    return index >= 0 && index < (double)array->length ? index : -1;
+}
+
+// new(length, fill?) -> array
+static Value array_new(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1 || args[0].type != VAL_NUMBER || !(args[0].as.number >= 0)) return value_number(-1);
+    PackedArray* array = packed_array_new((size_t)args[0].as.number);
+    if (array && arg_count > 1 && args[1].type == VAL_NUMBER) {
+        for (size_t i = 0; i < array->length; i++) array->data[i] = args[1].as.number;
+    }
+    return value_number(packed_array_register(array));
+}
+
+// of(x...) -> array holding the arguments
+static Value array_of(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    PackedArray* array = packed_array_new(arg_count);
+    if (!array) return value_number(-1);
+    for (size_t i = 0; i < arg_count; i++) {
+        if (args[i].type != VAL_NUMBER) {
+            packed_array_free(array);
+            return value_number(-1);
+        }
+        array->data[i] = args[i].as.number;
+    }
+    return value_number(packed_array_register(array));
+}
+
+// len(a) -> number
+static Value array_len(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    PackedArray* array = array_arg(args, arg_count, 0);
+    return value_number(array ? (double)array->length : -1);
+}
+
+// get(a, i) -> number
+static Value array_get(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    PackedArray* array = array_arg(args, arg_count, 0);
+    double index = index_arg(array, args, arg_count, 1);
+    if (index < 0) return value_null();
+    return value_number(array->data[(size_t)index]);
+}
+
+// set(a, i, x) -> bool
+static Value array_set(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    PackedArray* array = array_arg(args, arg_count, 0);
+    double index = index_arg(array, args, arg_count, 1);
+    if (index < 0 || arg_count < 3 || args[2].type != VAL_NUMBER) return value_bool(false);
+    array->data[(size_t)index] = args[2].as.number;
+    return value_bool(true);
+}
+
+// push(a, x...) -> new length
+static Value array_push(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    PackedArray* array = array_arg(args, arg_count, 0);
+    if (!array) return value_number(-1);
+    for (size_t i = 1; i < arg_count; i++) {
+        if (args[i].type != VAL_NUMBER || !packed_array_push(array, args[i].as.number)) return value_number(-1);
+    }
+    return value_number((double)array->length);
+}
+
+// to_list(a) -> list of numbers
+static Value array_to_list(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    PackedArray* array = array_arg(args, arg_count, 0);
+    if (!array) return value_null();
+    Value list = value_list();
+    for (size_t i = 0; i < array->length; i++) list_append(&list, value_number(array->data[i]));
+    return list;
+}
+
+// free(a) -> bool
+static Value array_free(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_bool(false);
+    return value_bool(packed_array_release(args[0].as.number));
+}
+
+void register_array_module(ModuleSystem* ms) {
+    Module* m = module_system_load(ms, "array");
+    module_register_native_function(m, "new", array_new);
+    module_register_native_function(m, "of", array_of);
+    module_register_native_function(m, "len", array_len);
+    module_register_native_function(m, "get", array_get);
+    module_register_native_function(m, "set", array_set);
+    module_register_native_function(m, "push", array_push);
+    module_register_native_function(m, "to_list", array_to_list);
+    module_register_native_function(m, "free", array_free);
+}
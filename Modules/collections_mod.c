@@ -0,0 +1,173 @@
+#include "../src/module.h"
+#include "../src/external_sort.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// collections.sort_external sorts a file of lines that may be far larger
+// than memory. Script values have no iterators or callables yet, so the
+// input is a file (one record per line) and the key is a spec string
+// instead of a function:
+//   "line"       the whole line, bytewise (default)
+//   "number"     the line parsed as a number
+//   "field:N"    the Nth whitespace-separated field (0-based), bytewise
+//   "number:N"   the Nth field parsed as a number
+// Lines whose numeric key does not parse sort first, in input order.
+
+#define LINE_IO_BUFFER (1 << 20)
+
+typedef struct {
+    bool numeric;
+    int field;              // -1 = whole line
+} KeySpec;
+
+static bool parse_key_spec(const char* spec, KeySpec* out) {
+    out->numeric = false;
+    out->field = -1;
+    if (strcmp(spec, "line") == 0) return true;
+    if (strcmp(spec, "number") == 0) {
+        out->numeric = true;
+        return true;
+    }
+    const char* index;
+    if (strncmp(spec, "field:", 6) == 0) {
+        index = spec + 6;
+    } else if (strncmp(spec, "number:", 7) == 0) {
+        index = spec + 7;
+        out->numeric = true;
+    } else {
+        return false;
+    }
+    char* end;
+    long field = strtol(index, &end, 10);
+    if (end == index || *end || field < 0 || field > 1 << 20) return false;
+    out->field = (int)field;
+    return true;
+}
+
+static RbValue line_key(void* ctx, RbValue line) {
+    const KeySpec* spec = ctx;
+    const char* start = line.data.s;
+    size_t length = strlen(start);
+    if (spec->field >= 0) {
+        const char* p = start;
+        for (int i = 0;; i++) {
+            while (*p && isspace((unsigned char)*p)) p++;
+            if (!*p) return rb_value_null();
+            const char* field_end = p;
+            while (*field_end && !isspace((unsigned char)*field_end)) field_end++;
+            if (i == spec->field) {
+                start = p;
+                length = (size_t)(field_end - p);
+                break;
+            }
+            p = field_end;
+        }
+    }
+    if (spec->numeric) {
+        char* end;
+        double number = strtod(start, &end);
+        return end == start ? rb_value_null() : rb_value_float(number);
+    }
+    RbValue key;
+    key.type = RB_VAL_STRING;
+    key.data.s = malloc(length + 1);
+    if (!key.data.s) return rb_value_null();
+    memcpy(key.data.s, start, length);
+    key.data.s[length] = '\0';
+    return key;
+}
+
+typedef struct {
+    FILE* file;
+    char* buffer;
+    size_t capacity;
+    bool failed;            // out of memory, as opposed to end of file
+} LineReader;
+
+// Next line without its newline, as a fresh RbValue string
+static bool next_line(void* ctx, RbValue* out) {
+    LineReader* reader = ctx;
+    size_t length = 0;
+    for (;;) {
+        if (reader->capacity - length < 2) {
+            size_t capacity = reader->capacity ? reader->capacity * 2 : 256;
+            char* grown = realloc(reader->buffer, capacity);
+            if (!grown) {
+                reader->failed = true;
+                return false;
+            }
+            reader->buffer = grown;
+            reader->capacity = capacity;
+        }
+        if (!fgets(reader->buffer + length, (int)(reader->capacity - length), reader->file)) {
+            if (length == 0) return false;
+            break;
+        }
+        length += strlen(reader->buffer + length);
+        if (reader->buffer[length - 1] == '\n') {
+            length--;
+            if (length > 0 && reader->buffer[length - 1] == '\r') length--;
+            break;
+        }
+    }
+    out->type = RB_VAL_STRING;
+    out->data.s = malloc(length + 1);
+    if (!out->data.s) {
+        reader->failed = true;
+        return false;
+    }
+    memcpy(out->data.s, reader->buffer, length);
+    out->data.s[length] = '\0';
+    return true;
+}
+
+static bool write_line(void* ctx, RbValue line) {
+    FILE* file = ctx;
+    bool ok = fputs(line.data.s, file) >= 0 && fputc('\n', file) != EOF;
+    rb_value_free(line);
+    return ok;
+}
+
+// sort_external(input_path, output_path, memory_budget?, key?) -> lines
+// written, or -1 on error. memory_budget is in bytes (default 256 MB).
+static Value collections_sort_external(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 2 || args[0].type != VAL_STRING || args[1].type != VAL_STRING)
+        return value_number(-1);
+
+    ExtSortOptions options = {0};
+    if (arg_count > 2 && args[2].type == VAL_NUMBER && args[2].as.number > 0)
+        options.memory_budget = (size_t)args[2].as.number;
+    KeySpec spec;
+    const char* key = arg_count > 3 && args[3].type == VAL_STRING ? args[3].as.string : "line";
+    if (!parse_key_spec(key, &spec)) return value_number(-1);
+    if (spec.numeric || spec.field >= 0) {
+        options.key = line_key;
+        options.key_ctx = &spec;
+    }
+
+    LineReader reader = { fopen(args[0].as.string, "rb"), NULL, 0, false };
+    if (!reader.file) return value_number(-1);
+    FILE* output = fopen(args[1].as.string, "wb");
+    if (!output) {
+        fclose(reader.file);
+        return value_number(-1);
+    }
+    setvbuf(reader.file, NULL, _IOFBF, LINE_IO_BUFFER);
+    setvbuf(output, NULL, _IOFBF, LINE_IO_BUFFER);
+
+    ExtSortStats stats;
+    bool ok = external_sort(next_line, &reader, write_line, output, &options, &stats);
+    ok = !ferror(reader.file) && !reader.failed && ok;
+    fclose(reader.file);
+    free(reader.buffer);
+    ok = fclose(output) == 0 && ok;
+    return value_number(ok ? (double)stats.values : -1);
+}
+
+void register_collections_module(ModuleSystem* ms) {
+    Module* m = module_system_load(ms, "collections");
+    module_register_native_function(m, "sort_external", collections_sort_external);
+}
@@ -0,0 +1,192 @@
+#include "../src/module.h"
+#include "../src/csv.h"
+#include "../src/packed_array.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Streaming CSV for scripts. Readers and writers are handles (positive
+// numbers): csv.next(r) returns the next row as a list of strings and
+// null at the end, after which the reader is already released; a writer
+// takes one row per csv.write_row call and must be closed to flush it.
+// csv.column loads one column straight into a packed array (see the array
+// module) and table.read_csv loads a whole file into a columnar table.
+
+#define MAX_CSV_HANDLES 256
+
+typedef struct {
+    CsvReader* reader;
+    CsvWriter* writer;
+    FILE* stream;           // buffered readers own their FILE*
+} CsvHandle;
+
+static CsvHandle g_csv[MAX_CSV_HANDLES];
+
+static Value handle_value(CsvReader* reader, CsvWriter* writer, FILE* stream) {
+    if (reader || writer) {
+        for (int i = 0; i < MAX_CSV_HANDLES; i++) {
+            if (!g_csv[i].reader && !g_csv[i].writer) {
+                g_csv[i] = (CsvHandle){ reader, writer, stream };
+                return value_number(i + 1);
+            }
+        }
+    }
+    csv_reader_close(reader);
+    csv_writer_close(writer);
+    if (stream) fclose(stream);
+    return value_number(-1);
+}
+
+static CsvHandle* handle_arg(Value* args, size_t arg_count, size_t i) {
+    if (i >= arg_count || args[i].type != VAL_NUMBER) return NULL;
+    double handle = args[i].as.number;
+    if (!(handle >= 1 && handle <= MAX_CSV_HANDLES)) return NULL;
+    CsvHandle* h = &g_csv[(int)handle - 1];
+    return h->reader || h->writer ? h : NULL;
+}
+
+static bool handle_close(CsvHandle* h) {
+    bool ok = true;
+    if (h->reader) csv_reader_close(h->reader);
+    if (h->writer) ok = csv_writer_close(h->writer);
+    if (h->stream) fclose(h->stream);
+    memset(h, 0, sizeof(*h));
+    return ok;
+}
+
+static char delimiter_arg(Value* args, size_t arg_count, size_t i) {
+    if (i < arg_count && args[i].type == VAL_STRING && args[i].as.string[0]) return args[i].as.string[0];
+    return ',';
+}
+
+// ========== READING ==========
+
+// open(path, delimiter?, mode?) -> reader; mode "mmap" (default) maps the
+// file, "buffered" reads it through a 1 MB buffer
+static Value csv_open(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_number(-1);
+    char delimiter = delimiter_arg(args, arg_count, 1);
+    bool buffered = arg_count > 2 && args[2].type == VAL_STRING && strcmp(args[2].as.string, "buffered") == 0;
+    if (!buffered) return handle_value(csv_reader_open(args[0].as.string, delimiter), NULL, NULL);
+    FILE* stream = fopen(args[0].as.string, "rb");
+    if (!stream) return value_number(-1);
+    return handle_value(csv_reader_open_stream(stream, delimiter), NULL, stream);
+}
+
+// next(r) -> list of field strings, or null at the end
+static Value csv_next(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    CsvHandle* h = handle_arg(args, arg_count, 0);
+    if (!h || !h->reader) return value_null();
+    const CsvField* fields;
+    size_t count;
+    if (!csv_reader_next(h->reader, &fields, &count)) {
+        // Exhausted readers release their input eagerly
+        handle_close(h);
+        return value_null();
+    }
+    Value row = value_list();
+    for (size_t i = 0; i < count; i++) {
+        char* text = strndup(fields[i].data, fields[i].length);
+        list_append(&row, value_string(text ? text : ""));
+        free(text);
+    }
+    return row;
+}
+
+// close(r or w) -> bool; false if a writer failed to flush
+static Value csv_close(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    CsvHandle* h = handle_arg(args, arg_count, 0);
+    if (!h) return value_bool(false);
+    return value_bool(handle_close(h));
+}
+
+// schema(path, delimiter?, sample_rows?) -> list of "int" / "float" /
+// "string", one per header column; sample_rows 0 (default) reads them all
+static Value csv_schema(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
+    size_t sample = arg_count > 2 && args[2].type == VAL_NUMBER && args[2].as.number > 0 ? (size_t)args[2].as.number : 0;
+    CsvSchema schema;
+    if (!csv_infer_schema(args[0].as.string, delimiter_arg(args, arg_count, 1), sample, &schema)) return value_null();
+    Value types = value_list();
+    for (size_t i = 0; i < schema.count; i++) list_append(&types, value_string(csv_type_name(schema.types[i])));
+    csv_schema_free(&schema);
+    return types;
+}
+
+// column(path, name, delimiter?) -> packed array of the column's numbers
+// (NaN where a cell is empty or not a number)
+static Value csv_column(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 2 || args[0].type != VAL_STRING || args[1].type != VAL_STRING) return value_number(-1);
+    char delimiter = delimiter_arg(args, arg_count, 2);
+    CsvSchema schema;
+    if (!csv_infer_schema(args[0].as.string, delimiter, 1, &schema)) return value_number(-1);
+    size_t column = schema.count;
+    for (size_t i = 0; i < schema.count; i++) {
+        if (strcmp(schema.names[i], args[1].as.string) == 0) {
+            column = i;
+            break;
+        }
+    }
+    bool found = column < schema.count;
+    csv_schema_free(&schema);
+    if (!found) return value_number(-1);
+    return value_number(packed_array_register(csv_read_column(args[0].as.string, delimiter, column)));
+}
+
+// ========== WRITING ==========
+
+// writer(path, delimiter?) -> writer
+static Value csv_writer(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_number(-1);
+    return handle_value(NULL, csv_writer_open(args[0].as.string, delimiter_arg(args, arg_count, 1)), NULL);
+}
+
+// write_row(w, value...) -> bool; numbers are written as numbers, null as
+// an empty field, strings quoted only when they need it
+static Value csv_write_row(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    CsvHandle* h = handle_arg(args, arg_count, 0);
+    if (!h || !h->writer) return value_bool(false);
+    for (size_t i = 1; i < arg_count; i++) {
+        switch (args[i].type) {
+            case VAL_NUMBER:
+                csv_writer_number(h->writer, args[i].as.number);
+                break;
+            case VAL_STRING:
+                csv_writer_field(h->writer, args[i].as.string, strlen(args[i].as.string));
+                break;
+            case VAL_BOOL:
+                csv_writer_field(h->writer, args[i].as.boolean ? "true" : "false", args[i].as.boolean ? 4 : 5);
+                break;
+            default:
+                csv_writer_field(h->writer, "", 0);
+                break;
+        }
+    }
+    csv_writer_end_row(h->writer);
+    return value_bool(true);
+}
+
+// isa() -> "avx2", "sse2" or "scalar": the scanner in use
+static Value csv_isa(Environment* env, Value* args, size_t arg_count) {
+    (void)env; (void)args; (void)arg_count;
+    return value_string(csv_scan_isa());
+}
+
+void register_csv_module(ModuleSystem* ms) {
+    Module* m = module_system_load(ms, "csv");
+    module_register_native_function(m, "open", csv_open);
+    module_register_native_function(m, "next", csv_next);
+    module_register_native_function(m, "close", csv_close);
+    module_register_native_function(m, "schema", csv_schema);
+    module_register_native_function(m, "column", csv_column);
+    module_register_native_function(m, "writer", csv_writer);
+    module_register_native_function(m, "write_row", csv_write_row);
+    module_register_native_function(m, "isa", csv_isa);
+}
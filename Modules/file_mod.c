@@ -1,9 +1,13 @@
 #include "../src/module.h"
+#include "../src/mmap_file.h"
+#include "../src/event_loop.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 static Value file_read(Environment* env, Value* args, size_t arg_count) {
     if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
@@ -96,28 +100,280 @@ static Value file_copy(Environment* env, Value* args, size_t arg_count) {
 static Value file_readlines(Environment* env, Value* args, size_t arg_count) {
     if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
     
-    FILE* file = fopen(args[0].as.string, "r");
-    if (!file) return value_null();
+    MappedFile mf;
+    if (!mapped_file_open(&mf, args[0].as.string)) return value_null();
     
     // Create list to hold lines
     Value list = value_list();
-    char* line = NULL;
-    size_t len = 0;
-    
-    while (getline(&line, &len, file) != -1) {
-        // Remove newline
-        size_t line_len = strlen(line);
-        if (line_len > 0 && line[line_len - 1] == '\n') {
-            line[line_len - 1] = '\0';
+    MappedLineIter it;
+    const char* line;
+    size_t line_len;
+    
+    mapped_lines_begin(&it, &mf);
+    while (mapped_lines_next(&it, &line, &line_len)) {
+        list_append(&list, value_string_len(line, line_len));
+    }
+    
+    mapped_file_close(&mf);
+    return list;
+}
+
+// Memory-mapped views and lazy line iterators, addressed by handle
+#define MAX_FILE_VIEWS 64
+
+typedef struct {
+    MappedFile file;
+    MappedLineIter lines;
+    bool is_iterator;
+    bool used;
+} FileView;
+
+static FileView g_views[MAX_FILE_VIEWS];
+
+static int view_open(const char* path, bool is_iterator) {
+    for (int i = 0; i < MAX_FILE_VIEWS; i++) {
+        if (!g_views[i].used) {
+            if (!mapped_file_open(&g_views[i].file, path)) return -1;
+            mapped_lines_begin(&g_views[i].lines, &g_views[i].file);
+            g_views[i].is_iterator = is_iterator;
+            g_views[i].used = true;
+            return i;
         }
-        list_append(&list, value_string(line));
     }
+    return -1;
+}
+
+static FileView* view_get(Value handle, bool is_iterator) {
+    if (handle.type != VAL_NUMBER) return NULL;
+    int idx = (int)handle.as.number;
+    if (idx < 0 || idx >= MAX_FILE_VIEWS || !g_views[idx].used) return NULL;
+    if (g_views[idx].is_iterator != is_iterator) return NULL;
+    return &g_views[idx];
+}
+
+static void view_release(FileView* view) {
+    mapped_file_close(&view->file);
+    view->used = false;
+}
+
+static Value file_mmap(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
+    int idx = view_open(args[0].as.string, false);
+    if (idx < 0) return value_null();
+    return value_number((double)idx);
+}
+
+static Value file_view_len(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1) return value_number(-1);
+    FileView* view = view_get(args[0], false);
+    if (!view) return value_number(-1);
+    return value_number((double)view->file.size);
+}
+
+static Value file_view_byte(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 2 || args[1].type != VAL_NUMBER) return value_number(-1);
+    FileView* view = view_get(args[0], false);
+    if (!view) return value_number(-1);
+    double pos = args[1].as.number;
+    if (pos < 0 || pos >= (double)view->file.size) return value_number(-1);
+    return value_number((double)(unsigned char)view->file.data[(size_t)pos]);
+}
+
+static Value file_view_slice(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 3 || args[1].type != VAL_NUMBER || args[2].type != VAL_NUMBER) 
+        return value_null();
+    FileView* view = view_get(args[0], false);
+    if (!view) return value_null();
     
-    free(line);
-    fclose(file);
+    double start = args[1].as.number;
+    double len = args[2].as.number;
+    if (start < 0 || len < 0 || start > (double)view->file.size) return value_null();
+    if (start + len > (double)view->file.size) len = (double)view->file.size - start;
+    
+    return value_string_len(view->file.data + (size_t)start, (size_t)len);
+}
+
+static Value file_unmap(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1) return value_bool(false);
+    FileView* view = view_get(args[0], false);
+    if (!view) return value_bool(false);
+    view_release(view);
+    return value_bool(true);
+}
+
+static Value file_lines(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
+    int idx = view_open(args[0].as.string, true);
+    if (idx < 0) return value_null();
+    return value_number((double)idx);
+}
+
+static Value file_next_line(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1) return value_null();
+    FileView* view = view_get(args[0], true);
+    if (!view) return value_null();
+    
+    const char* line;
+    size_t line_len;
+    if (!mapped_lines_next(&view->lines, &line, &line_len)) {
+        // Exhausted iterators release their mapping eagerly
+        view_release(view);
+        return value_null();
+    }
+    
+    return value_string_len(line, line_len);
+}
+
+static Value file_close_lines(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1) return value_bool(false);
+    FileView* view = view_get(args[0], true);
+    if (!view) return value_bool(false);
+    view_release(view);
+    return value_bool(true);
+}
+
+static Value file_count_lines(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_number(-1);
+    
+    MappedFile mf;
+    if (!mapped_file_open(&mf, args[0].as.string)) return value_number(-1);
+    size_t count = mapped_count_newlines(mf.data, mf.size);
+    mapped_file_close(&mf);
+    return value_number((double)count);
+}
+
+// Concurrent reads through the event loop's async I/O backend. A read
+// returns at most READ_ALL_CHUNK bytes (the backend's length and result
+// are 32-bit), so each file is read in rounds until EOF; the reads of one
+// round are all in flight together.
+#define READ_ALL_CHUNK ((size_t)1 << 30)
+
+typedef struct {
+    IOOperation* stat;
+    IOOperation* open;
+    char* buffer;
+    size_t capacity;
+    size_t length;
+    bool done;              // EOF reached, or failed (buffer freed)
+} ReadAllFile;
+
+static void read_all_done(void* context) {
+    (*(size_t*)context)--;
+}
+
+static void read_all_wait(EventLoop* loop, size_t* remaining) {
+    while (*remaining > 0) event_loop_run_once(loop);
+}
+
+// Counted before the call because the callback can run inside it; a NULL
+// op was never submitted, so its count is taken back
+static IOOperation* read_all_counted(IOOperation* op, size_t* remaining) {
+    if (!op) (*remaining)--;
+    return op;
+}
+
+static void read_all_fail(ReadAllFile* f) {
+    free(f->buffer);
+    f->buffer = NULL;
+    f->done = true;
+}
+
+static Value file_read_all(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1) return value_null();
+    
+    if (!global_event_loop) global_event_loop = event_loop_new();
+    EventLoop* loop = global_event_loop;
+    
+    ReadAllFile* files = calloc(arg_count, sizeof(ReadAllFile));
+    IOOperation** reads = calloc(arg_count, sizeof(IOOperation*));
+    if (!files || !reads) {
+        free(files);
+        free(reads);
+        return value_null();
+    }
+    size_t remaining = 0;
+    
+    // Phase 1: stat + open every file in one submission batch
+    for (size_t i = 0; i < arg_count; i++) {
+        if (args[i].type != VAL_STRING) continue;
+        remaining++;
+        files[i].stat = read_all_counted(event_loop_async_stat(loop, args[i].as.string, read_all_done, &remaining), &remaining);
+        remaining++;
+        files[i].open = read_all_counted(event_loop_async_open(loop, args[i].as.string, O_RDONLY, 0, read_all_done, &remaining), &remaining);
+    }
+    read_all_wait(loop, &remaining);
+    
+    // Size each buffer from the stat; files reporting 0 (/proc, pipes) or
+    // growing meanwhile get a larger one when it fills up
+    for (size_t i = 0; i < arg_count; i++) {
+        ReadAllFile* f = &files[i];
+        if (!f->stat || !f->open || f->stat->result < 0 || f->open->result < 0) {
+            f->done = true;
+            continue;
+        }
+        f->capacity = f->stat->stat.size > 0 ? (size_t)f->stat->stat.size + 1 : 4096;
+        f->buffer = malloc(f->capacity);
+        if (!f->buffer) read_all_fail(f);
+    }
+    
+    // Phase 2: rounds of positioned reads until every file is at EOF
+    for (;;) {
+        bool reading = false;
+        for (size_t i = 0; i < arg_count; i++) {
+            ReadAllFile* f = &files[i];
+            if (f->done) continue;
+            if (f->length == f->capacity) {
+                char* grown = realloc(f->buffer, f->capacity * 2);
+                if (!grown) {
+                    read_all_fail(f);
+                    continue;
+                }
+                f->buffer = grown;
+                f->capacity *= 2;
+            }
+            size_t want = f->capacity - f->length;
+            if (want > READ_ALL_CHUNK) want = READ_ALL_CHUNK;
+            remaining++;
+            reads[i] = read_all_counted(event_loop_async_read_at(loop, f->open->result, f->buffer + f->length, want,
+                                                                 (int64_t)f->length, read_all_done, &remaining),
+                                        &remaining);
+            if (!reads[i]) read_all_fail(f);
+            else reading = true;
+        }
+        if (!reading) break;
+        read_all_wait(loop, &remaining);
+        for (size_t i = 0; i < arg_count; i++) {
+            if (!reads[i]) continue;
+            int result = reads[i]->result;
+            event_loop_io_release(reads[i]);
+            reads[i] = NULL;
+            if (result < 0) read_all_fail(&files[i]);
+            else if (result == 0) files[i].done = true;
+            else files[i].length += (size_t)result;
+        }
+    }
+    
+    Value list = value_list();
+    for (size_t i = 0; i < arg_count; i++) {
+        ReadAllFile* f = &files[i];
+        if (f->buffer) list_append(&list, value_string_len(f->buffer, f->length));
+        else list_append(&list, value_null());
+        if (f->open && f->open->result >= 0) close(f->open->result);
+        event_loop_io_release(f->stat);
+        event_loop_io_release(f->open);
+        free(f->buffer);
+    }
+    
+    free(files);
+    free(reads);
     return list;
 }
 
+static Value file_io_backend(Environment* env, Value* args, size_t arg_count) {
+    if (!global_event_loop) global_event_loop = event_loop_new();
+    return value_string(event_loop_io_backend(global_event_loop));
+}
+
 void register_file_module(ModuleSystem* ms) {
     Module* m = module_system_load(ms, "file");
     module_register_native_function(m, "read", file_read);
@@ -128,4 +384,15 @@ void register_file_module(ModuleSystem* ms) {
     module_register_native_function(m, "delete", file_delete);
     module_register_native_function(m, "copy", file_copy);
     module_register_native_function(m, "readlines", file_readlines);
+    module_register_native_function(m, "mmap", file_mmap);
+    module_register_native_function(m, "view_len", file_view_len);
+    module_register_native_function(m, "view_byte", file_view_byte);
+    module_register_native_function(m, "view_slice", file_view_slice);
+    module_register_native_function(m, "unmap", file_unmap);
+    module_register_native_function(m, "lines", file_lines);
+    module_register_native_function(m, "next_line", file_next_line);
+    module_register_native_function(m, "close_lines", file_close_lines);
+    module_register_native_function(m, "count_lines", file_count_lines);
+    module_register_native_function(m, "read_all", file_read_all);
+    module_register_native_function(m, "io_backend", file_io_backend);
 }
\ No newline at end of file
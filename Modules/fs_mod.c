@@ -0,0 +1,155 @@
+#include "../src/module.h"
+#include "../src/fs_walk.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Recursive directory walks and globs (see src/fs_walk.h). fs.walk and
+// fs.glob return a handle (a positive number) at once; the tree is read
+// on the thread pool while fs.next hands out paths as they are found, so
+// the first results arrive before a large walk is over. Paths come in no
+// particular order. A handle closes itself once fs.next has returned
+// null; fs.close stops a walk early. An optional kind ("file", "dir",
+// "link" or "other") keeps only entries of that type. Errors return -1
+// (handles), null or false.
+
+#define MAX_FS_WALKS 64
+#define FS_DEFAULT_BATCH 1024
+
+typedef struct {
+    FsWalk* walk;
+    int kind;               // FsEntryType to keep, or -1 for all
+} FsWalkHandle;
+
+static FsWalkHandle g_walks[MAX_FS_WALKS];
+
+static FsWalkHandle* walk_arg(Value* args, size_t arg_count, size_t i) {
+    if (i >= arg_count || args[i].type != VAL_NUMBER) return NULL;
+    double handle = args[i].as.number;
+    if (!(handle >= 1 && handle <= MAX_FS_WALKS)) return NULL;
+    FsWalkHandle* h = &g_walks[(int)handle - 1];
+    return h->walk ? h : NULL;
+}
+
+static const char* string_arg(Value* args, size_t arg_count, size_t i) {
+    return i < arg_count && args[i].type == VAL_STRING ? args[i].as.string : NULL;
+}
+
+// Entry type from a kind name; -1 for none (all), -2 for an unknown name
+static int kind_arg(Value* args, size_t arg_count, size_t i) {
+    if (i >= arg_count || args[i].type == VAL_NULL) return -1;
+    if (args[i].type != VAL_STRING) return -2;
+    const char* kind = args[i].as.string;
+    if (strcmp(kind, "file") == 0) return FS_ENTRY_FILE;
+    if (strcmp(kind, "dir") == 0) return FS_ENTRY_DIR;
+    if (strcmp(kind, "link") == 0) return FS_ENTRY_LINK;
+    if (strcmp(kind, "other") == 0) return FS_ENTRY_OTHER;
+    return -2;
+}
+
+static Value open_handle(FsWalk* walk, int kind) {
+    if (!walk) return value_number(-1);
+    for (int i = 0; i < MAX_FS_WALKS; i++) {
+        if (!g_walks[i].walk) {
+            g_walks[i].walk = walk;
+            g_walks[i].kind = kind;
+            return value_number(i + 1);
+        }
+    }
+    fs_walk_close(walk);
+    return value_number(-1);
+}
+
+static void close_handle(FsWalkHandle* h) {
+    fs_walk_close(h->walk);
+    h->walk = NULL;
+}
+
+// The next path of the wanted kind; NULL (and the handle closed) when done
+static const char* next_path(FsWalkHandle* h) {
+    const char* path;
+    size_t length;
+    FsEntryType type;
+    while (fs_walk_next(h->walk, &path, &length, &type)) {
+        if (h->kind < 0 || (int)type == h->kind) return path;
+    }
+    close_handle(h);
+    return NULL;
+}
+
+// walk(root, kind?) -> handle; everything below root, paths start with root
+static Value fs_walk_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    const char* root = string_arg(args, arg_count, 0);
+    int kind = kind_arg(args, arg_count, 1);
+    if (!root || kind == -2) return value_number(-1);
+    return open_handle(fs_walk_open(root), kind);
+}
+
+// glob(pattern, kind?) -> handle; * ? [a-z] [!x] within a component, ** across
+static Value fs_glob_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    const char* pattern = string_arg(args, arg_count, 0);
+    int kind = kind_arg(args, arg_count, 1);
+    if (!pattern || kind == -2) return value_number(-1);
+    return open_handle(fs_glob_open(pattern), kind);
+}
+
+// next(h) -> path, or null when the walk is finished
+static Value fs_next_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    FsWalkHandle* h = walk_arg(args, arg_count, 0);
+    if (!h) return value_null();
+    const char* path = next_path(h);
+    return path ? value_string(path) : value_null();
+}
+
+// next_batch(h, n?) -> list of up to n paths (default 1024); empty when finished
+static Value fs_next_batch_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    Value list = value_list();
+    FsWalkHandle* h = walk_arg(args, arg_count, 0);
+    if (!h) return list;
+    size_t n = FS_DEFAULT_BATCH;
+    if (arg_count > 1 && args[1].type == VAL_NUMBER && args[1].as.number >= 1) n = (size_t)args[1].as.number;
+    for (size_t i = 0; i < n; i++) {
+        const char* path = next_path(h);
+        if (!path) break;
+        list_append(&list, value_string(path));
+    }
+    return list;
+}
+
+// errors(h) -> number of directories that could not be read so far
+static Value fs_errors_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    FsWalkHandle* h = walk_arg(args, arg_count, 0);
+    return h ? value_number((double)fs_walk_errors(h->walk)) : value_number(-1);
+}
+
+// close(h) -> bool; stops a walk that is not finished
+static Value fs_close_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    FsWalkHandle* h = walk_arg(args, arg_count, 0);
+    if (!h) return value_bool(false);
+    close_handle(h);
+    return value_bool(true);
+}
+
+// match(pattern, path) -> bool; the glob rules on a relative path, without the file system
+static Value fs_match_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    const char* pattern = string_arg(args, arg_count, 0);
+    const char* path = string_arg(args, arg_count, 1);
+    return value_bool(pattern && path && fs_glob_match(pattern, path));
+}
+
+void register_fs_module(ModuleSystem* ms) {
+    Module* m = module_system_load(ms, "fs");
+    module_register_native_function(m, "walk", fs_walk_fn);
+    module_register_native_function(m, "glob", fs_glob_fn);
+    module_register_native_function(m, "next", fs_next_fn);
+    module_register_native_function(m, "next_batch", fs_next_batch_fn);
+    module_register_native_function(m, "errors", fs_errors_fn);
+    module_register_native_function(m, "close", fs_close_fn);
+    module_register_native_function(m, "match", fs_match_fn);
+}
@@ -1,9 +1,15 @@
 #include "../src/module.h"
+#include "../src/http_server.h"
+#include "../src/event_loop.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include <curl/curl.h>
 
+#define HTTP_EASY_POOL_SIZE 32
+#define MAX_HTTP_REQUESTS 256
+
 typedef struct {
     char* data;
     size_t size;
@@ -23,62 +29,111 @@ static size_t write_callback(void* contents, size_t size, size_t nmemb, HttpResp
     return total_size;
 }
 
-static Value http_get(Environment* env, Value* args, size_t arg_count) {
-    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
-    
-    CURL* curl = curl_easy_init();
-    if (!curl) return value_null();
-    
-    HttpResponse response = {0};
-    
-    curl_easy_setopt(curl, CURLOPT_URL, args[0].as.string);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+// Connection reuse: every easy handle shares one connection cache, DNS
+// cache and TLS session cache, and finished handles go back to a pool
+// instead of curl_easy_cleanup(), so keep-alive connections survive calls.
+// Requests may run on several threads: the share takes a mutex per kind of
+// data it guards, and the pool and reuse mode are behind easy_pool_lock.
+static CURLSH* http_share = NULL;
+static pthread_once_t http_share_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t http_share_locks[CURL_LOCK_DATA_LAST];
+static pthread_mutex_t easy_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static CURL* easy_pool[HTTP_EASY_POOL_SIZE];
+static size_t easy_pool_count = 0;
+static bool http_reuse = true;
+
+static void http_share_lock(CURL* curl, curl_lock_data data, curl_lock_access access, void* userp) {
+    (void)curl;
+    (void)access;
+    (void)userp;
+    pthread_mutex_lock(&http_share_locks[data]);
+}
+
+static void http_share_unlock(CURL* curl, curl_lock_data data, void* userp) {
+    (void)curl;
+    (void)userp;
+    pthread_mutex_unlock(&http_share_locks[data]);
+}
+
+static void http_share_create(void) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) pthread_mutex_init(&http_share_locks[i], NULL);
+    http_share = curl_share_init();
+    curl_share_setopt(http_share, CURLSHOPT_LOCKFUNC, http_share_lock);
+    curl_share_setopt(http_share, CURLSHOPT_UNLOCKFUNC, http_share_unlock);
+    curl_share_setopt(http_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_share_setopt(http_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(http_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+static void http_init(void) {
+    pthread_once(&http_share_once, http_share_create);
+}
+
+static CURL* easy_acquire(void) {
+    http_init();
+    pthread_mutex_lock(&easy_pool_lock);
+    CURL* curl = easy_pool_count > 0 ? easy_pool[--easy_pool_count] : NULL;
+    bool reuse = http_reuse;
+    pthread_mutex_unlock(&easy_pool_lock);
+    if (!curl) curl = curl_easy_init();
+    if (!curl) return NULL;
+    if (reuse) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, http_share);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+        curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+    }
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    return curl;
+}
+
+static void easy_release(CURL* curl) {
+    if (!curl) return;
+    curl_easy_reset(curl);
+    pthread_mutex_lock(&easy_pool_lock);
+    bool pooled = http_reuse && easy_pool_count < HTTP_EASY_POOL_SIZE;
+    if (pooled) easy_pool[easy_pool_count++] = curl;
+    pthread_mutex_unlock(&easy_pool_lock);
+    if (!pooled) curl_easy_cleanup(curl);
+}
+
+// Configure a pooled handle for one request. `headers` receives the list
+// to free once the transfer is done.
+static CURL* http_prepare(const char* method, const char* url, const char* body,
+                          const char* content_type, HttpResponse* response,
+                          struct curl_slist** headers) {
+    CURL* curl = easy_acquire();
+    if (!curl) return NULL;
     
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+    if (method) curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method);
+    if (body) curl_easy_setopt(curl, CURLOPT_COPYPOSTFIELDS, body);
     
-    if (res != CURLE_OK) {
-        free(response.data);
-        return value_null();
+    *headers = NULL;
+    if (content_type) {
+        char header[256];
+        snprintf(header, sizeof(header), "Content-Type: %s", content_type);
+        *headers = curl_slist_append(NULL, header);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, *headers);
     }
-    
-    Value result = value_string(response.data ? response.data : "");
-    free(response.data);
-    return result;
+    return curl;
 }
 
-static Value http_post(Environment* env, Value* args, size_t arg_count) {
-    if (arg_count < 2 || args[0].type != VAL_STRING || args[1].type != VAL_STRING) 
-        return value_null();
-    
-    CURL* curl = curl_easy_init();
-    if (!curl) return value_null();
-    
+static Value http_perform(const char* method, const char* url, const char* body, const char* content_type) {
     HttpResponse response = {0};
-    
-    curl_easy_setopt(curl, CURLOPT_URL, args[0].as.string);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, args[1].as.string);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-    
-    // Set content type if provided
-    struct curl_slist* headers = NULL;
-    if (arg_count >= 3 && args[2].type == VAL_STRING) {
-        char content_type[256];
-        snprintf(content_type, sizeof(content_type), "Content-Type: %s", args[2].as.string);
-        headers = curl_slist_append(headers, content_type);
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    }
+    struct curl_slist* headers;
+    CURL* curl = http_prepare(method, url, body, content_type, &response, &headers);
+    if (!curl) return value_null();
     
     CURLcode res = curl_easy_perform(curl);
     
     if (headers) curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+    easy_release(curl);
     
     if (res != CURLE_OK) {
         free(response.data);
@@ -90,62 +145,384 @@ static Value http_post(Environment* env, Value* args, size_t arg_count) {
     return result;
 }
 
-static Value http_put(Environment* env, Value* args, size_t arg_count) {
+static Value http_get(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
+    return http_perform(NULL, args[0].as.string, NULL, NULL);
+}
+
+static Value http_post(Environment* env, Value* args, size_t arg_count) {
     if (arg_count < 2 || args[0].type != VAL_STRING || args[1].type != VAL_STRING) 
         return value_null();
     
-    CURL* curl = curl_easy_init();
-    if (!curl) return value_null();
+    // Set content type if provided
+    const char* content_type = arg_count >= 3 && args[2].type == VAL_STRING ? args[2].as.string : NULL;
+    return http_perform(NULL, args[0].as.string, args[1].as.string, content_type);
+}
+
+static Value http_put(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 2 || args[0].type != VAL_STRING || args[1].type != VAL_STRING) 
+        return value_null();
     
-    HttpResponse response = {0};
+    const char* content_type = arg_count >= 3 && args[2].type == VAL_STRING ? args[2].as.string : NULL;
+    return http_perform("PUT", args[0].as.string, args[1].as.string, content_type);
+}
+
+static Value http_delete(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
+    return http_perform("DELETE", args[0].as.string, NULL, NULL);
+}
+
+static Value http_set_reuse(Environment* env, Value* args, size_t arg_count) {
+    bool set = arg_count >= 1 && args[0].type == VAL_BOOL;
+    CURL* stale[HTTP_EASY_POOL_SIZE];
+    size_t count = 0;
+    pthread_mutex_lock(&easy_pool_lock);
+    if (set) {
+        http_reuse = args[0].as.boolean;
+        // Pooled handles were configured for the old mode
+        count = easy_pool_count;
+        memcpy(stale, easy_pool, count * sizeof(CURL*));
+        easy_pool_count = 0;
+    }
+    bool reuse = http_reuse;
+    pthread_mutex_unlock(&easy_pool_lock);
+    for (size_t i = 0; i < count; i++) curl_easy_cleanup(stale[i]);
+    return value_bool(reuse);
+}
+
+// Async requests: curl_multi in socket mode. libcurl tells us which sockets
+// it wants watched; those become one-shot read/write events on the shared
+// event loop, and its timeout becomes a loop timer. None of this state is
+// locked: it belongs to the thread that made the first async call, the one
+// driving the shared loop. On other threads get_async fails and get_all
+// fetches one URL at a time.
+typedef struct {
+    bool used;
+    bool done;
+    CURLcode result;
+    long status;
+    CURL* curl;
+    struct curl_slist* headers;
+    HttpResponse response;
+} HttpRequestSlot;
+
+typedef struct HttpSocket {
+    curl_socket_t fd;
+    int what;                   // CURL_POLL_* currently requested
+    int read_event;
+    int write_event;
+    struct HttpSocket* next;
+} HttpSocket;
+
+static CURLM* http_multi = NULL;
+static pthread_once_t http_multi_once = PTHREAD_ONCE_INIT;
+static pthread_t http_async_thread;
+static HttpRequestSlot http_requests[MAX_HTTP_REQUESTS];
+static HttpSocket* http_sockets = NULL;
+static int http_timer_event = 0;
+
+static EventLoop* http_loop(void) {
+    if (!global_event_loop) global_event_loop = event_loop_new();
+    return global_event_loop;
+}
+
+static HttpSocket* http_socket_find(curl_socket_t fd) {
+    for (HttpSocket* s = http_sockets; s; s = s->next) {
+        if (s->fd == fd) return s;
+    }
+    return NULL;
+}
+
+static void http_socket_arm(HttpSocket* s);
+
+static void http_check_done(void) {
+    CURLMsg* msg;
+    int left;
+    while ((msg = curl_multi_info_read(http_multi, &left))) {
+        if (msg->msg != CURLMSG_DONE) continue;
+        HttpRequestSlot* slot = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&slot);
+        curl_multi_remove_handle(http_multi, msg->easy_handle);
+        if (!slot) continue;
+        slot->done = true;
+        slot->result = msg->data.result;
+        curl_easy_getinfo(slot->curl, CURLINFO_RESPONSE_CODE, &slot->status);
+        if (slot->headers) curl_slist_free_all(slot->headers);
+        slot->headers = NULL;
+        easy_release(slot->curl);
+        slot->curl = NULL;
+    }
+}
+
+static void http_socket_action(curl_socket_t fd, int ev_bitmask) {
+    int running;
+    curl_multi_socket_action(http_multi, fd, ev_bitmask, &running);
+    http_check_done();
+    // Events are one-shot; re-arm if curl still wants this socket
+    if (fd != CURL_SOCKET_TIMEOUT) {
+        HttpSocket* s = http_socket_find(fd);
+        if (s) http_socket_arm(s);
+    }
+}
+
+static void http_on_readable(void* data) {
+    HttpSocket* s = (HttpSocket*)data;
+    s->read_event = 0;
+    http_socket_action(s->fd, CURL_CSELECT_IN);
+}
+
+static void http_on_writable(void* data) {
+    HttpSocket* s = (HttpSocket*)data;
+    s->write_event = 0;
+    http_socket_action(s->fd, CURL_CSELECT_OUT);
+}
+
+static void http_socket_arm(HttpSocket* s) {
+    EventLoop* loop = http_loop();
+    bool want_read = s->what == CURL_POLL_IN || s->what == CURL_POLL_INOUT;
+    bool want_write = s->what == CURL_POLL_OUT || s->what == CURL_POLL_INOUT;
     
-    curl_easy_setopt(curl, CURLOPT_URL, args[0].as.string);
-    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, args[1].as.string);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    if (want_read && !s->read_event) s->read_event = event_loop_add_read(loop, (int)s->fd, http_on_readable, s);
+    if (!want_read && s->read_event) { event_loop_remove_event(loop, s->read_event); s->read_event = 0; }
+    if (want_write && !s->write_event) s->write_event = event_loop_add_write(loop, (int)s->fd, http_on_writable, s);
+    if (!want_write && s->write_event) { event_loop_remove_event(loop, s->write_event); s->write_event = 0; }
+}
+
+static int http_socket_callback(CURL* easy, curl_socket_t fd, int what, void* userp, void* socketp) {
+    HttpSocket* s = (HttpSocket*)socketp;
     
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+    if (what == CURL_POLL_REMOVE) {
+        if (!s) return 0;
+        s->what = CURL_POLL_NONE;
+        http_socket_arm(s);
+        HttpSocket** link = &http_sockets;
+        while (*link && *link != s) link = &(*link)->next;
+        if (*link) *link = s->next;
+        free(s);
+        curl_multi_assign(http_multi, fd, NULL);
+        return 0;
+    }
     
-    if (res != CURLE_OK) {
-        free(response.data);
-        return value_null();
+    if (!s) {
+        s = calloc(1, sizeof(HttpSocket));
+        if (!s) return -1;
+        s->fd = fd;
+        s->next = http_sockets;
+        http_sockets = s;
+        curl_multi_assign(http_multi, fd, s);
     }
+    s->what = what;
+    http_socket_arm(s);
+    return 0;
+}
+
+static void http_on_timeout(void* data) {
+    http_timer_event = 0;
+    http_socket_action(CURL_SOCKET_TIMEOUT, 0);
+}
+
+static int http_timer_callback(CURLM* multi, long timeout_ms, void* userp) {
+    EventLoop* loop = http_loop();
+    if (http_timer_event) {
+        event_loop_remove_event(loop, http_timer_event);
+        http_timer_event = 0;
+    }
+    if (timeout_ms >= 0) http_timer_event = event_loop_add_timer(loop, (uint64_t)timeout_ms, http_on_timeout, NULL);
+    return 0;
+}
+
+static void http_multi_init(void) {
+    http_async_thread = pthread_self();
+    http_init();
+    http_multi = curl_multi_init();
+    curl_multi_setopt(http_multi, CURLMOPT_SOCKETFUNCTION, http_socket_callback);
+    curl_multi_setopt(http_multi, CURLMOPT_TIMERFUNCTION, http_timer_callback);
+    curl_multi_setopt(http_multi, CURLMOPT_MAX_HOST_CONNECTIONS, 16L);
+}
+
+// Whether this thread owns the async state, claiming it on first use
+static bool http_async_here(void) {
+    pthread_once(&http_multi_once, http_multi_init);
+    return pthread_equal(http_async_thread, pthread_self());
+}
+
+// Start an async GET on the owning thread; returns a slot index or -1
+static int http_start(const char* url) {
+    for (int i = 0; i < MAX_HTTP_REQUESTS; i++) {
+        HttpRequestSlot* slot = &http_requests[i];
+        if (slot->used) continue;
+        memset(slot, 0, sizeof(*slot));
+        slot->curl = http_prepare(NULL, url, NULL, NULL, &slot->response, &slot->headers);
+        if (!slot->curl) return -1;
+        slot->used = true;
+        curl_easy_setopt(slot->curl, CURLOPT_PRIVATE, slot);
+        // Multiplex over HTTP/2 where the server allows it, else wait for a
+        // pooled connection rather than opening a new one per request
+        curl_easy_setopt(slot->curl, CURLOPT_PIPEWAIT, 1L);
+        curl_multi_add_handle(http_multi, slot->curl);
+        return i;
+    }
+    return -1;
+}
+
+static Value http_finish(int handle) {
+    HttpRequestSlot* slot = &http_requests[handle];
+    while (!slot->done) event_loop_run_once(http_loop());
     
-    Value result = value_string(response.data ? response.data : "");
-    free(response.data);
+    Value result = value_null();
+    if (slot->result == CURLE_OK) result = value_string(slot->response.data ? slot->response.data : "");
+    free(slot->response.data);
+    slot->used = false;
     return result;
 }
 
-static Value http_delete(Environment* env, Value* args, size_t arg_count) {
-    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
+static Value http_get_async(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_STRING || !http_async_here()) return value_number(-1);
+    return value_number(http_start(args[0].as.string));
+}
+
+static Value http_wait(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_null();
+    int handle = (int)args[0].as.number;
+    if (!http_async_here()) return value_null();
+    if (handle < 0 || handle >= MAX_HTTP_REQUESTS || !http_requests[handle].used) return value_null();
+    return http_finish(handle);
+}
+
+// get_all(url...) -> list of bodies (null entries for failures); null when
+// there are more URLs than free request slots
+static Value http_get_all(Environment* env, Value* args, size_t arg_count) {
+    if (!http_async_here()) {
+        Value list = value_list();
+        for (size_t i = 0; i < arg_count; i++) {
+            list_append(&list, args[i].type == VAL_STRING ? http_perform(NULL, args[i].as.string, NULL, NULL) : value_null());
+        }
+        return list;
+    }
+    size_t free_slots = 0;
+    for (int i = 0; i < MAX_HTTP_REQUESTS; i++) free_slots += !http_requests[i].used;
+    if (arg_count > free_slots) return value_null();
+
+    int* handles = malloc(sizeof(int) * (arg_count ? arg_count : 1));
+    if (!handles) return value_null();
     
-    CURL* curl = curl_easy_init();
-    if (!curl) return value_null();
+    // Start everything first so the transfers overlap
+    for (size_t i = 0; i < arg_count; i++) {
+        handles[i] = args[i].type == VAL_STRING ? http_start(args[i].as.string) : -1;
+    }
     
-    HttpResponse response = {0};
+    Value list = value_list();
+    for (size_t i = 0; i < arg_count; i++) {
+        list_append(&list, handles[i] >= 0 ? http_finish(handles[i]) : value_null());
+    }
+    free(handles);
+    return list;
+}
+
+// Built-in server. Native functions cannot call back into script closures,
+// so the "handler" is declarative: exact-path routes registered with
+// http.route(), then static files under a document root.
+#define MAX_HTTP_ROUTES 64
+
+typedef struct {
+    char* path;
+    char* body;
+    size_t body_len;
+    char* content_type;
+} HttpRoute;
+
+static HttpRoute http_routes[MAX_HTTP_ROUTES];
+static size_t http_route_count = 0;
+static char* http_doc_root = NULL;
+
+static char* copy_string(const char* str) {
+    size_t len = strlen(str);
+    char* copy = malloc(len + 1);
+    if (copy) memcpy(copy, str, len + 1);
+    return copy;
+}
+
+static const char* content_type_for(const char* path) {
+    const char* dot = strrchr(path, '.');
+    if (!dot) return "application/octet-stream";
+    if (strcmp(dot, ".html") == 0 || strcmp(dot, ".htm") == 0) return "text/html; charset=utf-8";
+    if (strcmp(dot, ".css") == 0) return "text/css";
+    if (strcmp(dot, ".js") == 0) return "application/javascript";
+    if (strcmp(dot, ".json") == 0) return "application/json";
+    if (strcmp(dot, ".txt") == 0 || strcmp(dot, ".rbo") == 0) return "text/plain; charset=utf-8";
+    if (strcmp(dot, ".png") == 0) return "image/png";
+    if (strcmp(dot, ".jpg") == 0 || strcmp(dot, ".jpeg") == 0) return "image/jpeg";
+    if (strcmp(dot, ".svg") == 0) return "image/svg+xml";
+    return "application/octet-stream";
+}
+
+static void serve_handler(HttpConn* conn, const HttpRequest* req, void* user) {
+    for (size_t i = 0; i < http_route_count; i++) {
+        if (http_slice_eq(req->path, http_routes[i].path)) {
+            http_respond(conn, 200, http_routes[i].content_type, http_routes[i].body, http_routes[i].body_len);
+            return;
+        }
+    }
     
-    curl_easy_setopt(curl, CURLOPT_URL, args[0].as.string);
-    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    if (http_doc_root && (http_slice_eq(req->method, "GET") || http_slice_eq(req->method, "HEAD"))) {
+        char path[4096];
+        size_t root_len = strlen(http_doc_root);
+        // Refuse traversal out of the root and anything that does not fit
+        bool traversal = false;
+        for (size_t i = 0; i + 1 < req->path.len; i++) {
+            if (req->path.ptr[i] == '.' && req->path.ptr[i + 1] == '.') traversal = true;
+        }
+        if (!traversal && req->path.len > 0 && req->path.ptr[0] == '/' &&
+            root_len + req->path.len + 11 < sizeof(path)) {
+            memcpy(path, http_doc_root, root_len);
+            memcpy(path + root_len, req->path.ptr, req->path.len);
+            path[root_len + req->path.len] = '\0';
+            if (path[root_len + req->path.len - 1] == '/') strcat(path, "index.html");
+            if (http_respond_file(conn, 200, content_type_for(path), path)) return;
+        }
+    }
     
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+    http_respond(conn, 404, "text/plain", "Not Found\n", 10);
+}
+
+static Value http_route(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 2 || args[0].type != VAL_STRING || args[1].type != VAL_STRING) 
+        return value_bool(false);
     
-    if (res != CURLE_OK) {
-        free(response.data);
-        return value_null();
+    const char* content_type = arg_count >= 3 && args[2].type == VAL_STRING ? args[2].as.string : "text/plain";
+    HttpRoute* route = NULL;
+    for (size_t i = 0; i < http_route_count; i++) {
+        if (strcmp(http_routes[i].path, args[0].as.string) == 0) route = &http_routes[i];
+    }
+    if (!route) {
+        if (http_route_count >= MAX_HTTP_ROUTES) return value_bool(false);
+        route = &http_routes[http_route_count++];
+        route->path = copy_string(args[0].as.string);
+    } else {
+        free(route->body);
+        free(route->content_type);
     }
+    route->body = copy_string(args[1].as.string);
+    route->body_len = strlen(route->body);
+    route->content_type = copy_string(content_type);
+    return value_bool(true);
+}
+
+static Value http_serve(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_bool(false);
     
-    Value result = value_string(response.data ? response.data : "");
-    free(response.data);
-    return result;
+    free(http_doc_root);
+    http_doc_root = arg_count >= 2 && args[1].type == VAL_STRING ? copy_string(args[1].as.string) : NULL;
+    size_t workers = arg_count >= 3 && args[2].type == VAL_NUMBER && args[2].as.number >= 1
+        ? (size_t)args[2].as.number : 1;
+    
+    HttpServer* server = http_server_create(NULL, (int)args[0].as.number, workers, serve_handler, NULL);
+    if (!server) return value_bool(false);
+    
+    // Blocks for the life of the process, like a typical app server main
+    http_server_run(server);
+    http_server_free(server);
+    return value_bool(true);
 }
 
 void register_http_module(ModuleSystem* ms) {
@@ -154,4 +531,10 @@ void register_http_module(ModuleSystem* ms) {
     module_register_native_function(m, "post", http_post);
     module_register_native_function(m, "put", http_put);
     module_register_native_function(m, "delete", http_delete);
+    module_register_native_function(m, "get_async", http_get_async);
+    module_register_native_function(m, "wait", http_wait);
+    module_register_native_function(m, "get_all", http_get_all);
+    module_register_native_function(m, "set_reuse", http_set_reuse);
+    module_register_native_function(m, "route", http_route);
+    module_register_native_function(m, "serve", http_serve);
 }
\ No newline at end of file
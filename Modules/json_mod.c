@@ -1,4 +1,5 @@
 #include "../src/module.h"
+#include "../src/dtoa.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -177,7 +178,7 @@ static void stringify_value(Value val, char** result, size_t* capacity, size_t*
             strcpy(buffer, val.as.boolean ? "true" : "false");
             break;
         case VAL_NUMBER:
-            snprintf(buffer, sizeof(buffer), "%.15g", val.as.number);
+            dtoa_shortest(val.as.number, buffer);
             break;
         case VAL_STRING:
             snprintf(buffer, sizeof(buffer), "\"%s\"", val.as.string);
@@ -0,0 +1,386 @@
+#include "../src/module.h"
+#include "../src/kv_store.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Embedded ordered key-value store for scripts (see src/kv_store.h).
+// Stores and transactions are handles (positive numbers). kv.get/put/
+// delete/range on a store run in a transaction of their own; kv.begin
+// opens one explicitly for several operations that must commit together
+// or read one snapshot. Opening a path that is already open, from any
+// isolate, shares the same store, so writers serialize on its lock and
+// readers never wait. While a thread holds a write transaction on a
+// store, its own kv.put/delete and a second kv.begin(db, true) on that
+// store fail instead of waiting on itself; use the txn_* functions.
+// Keys and values are strings. Errors return -1 (handles), null (values)
+// or false. g_kv_lock guards the handle tables; it is never held across
+// kv_begin, which may wait on another thread's write transaction.
+
+#define MAX_KV_STORES 64
+#define MAX_KV_TXNS   256
+
+static pthread_mutex_t g_kv_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static KvStore* g_stores[MAX_KV_STORES];
+static int g_store_users[MAX_KV_STORES];   // calls using the store right now
+
+typedef struct {
+    bool claimed;           // slot taken; txn stays NULL while kv_begin runs
+    KvTxn* txn;
+    int store;              // index into g_stores
+    bool write;
+    pthread_t owner;        // thread that began it
+} KvTxnHandle;
+
+static KvTxnHandle g_txns[MAX_KV_TXNS];
+
+// Resolves a store handle and pins it so kv.close fails until
+// store_release; returns the index or -1
+static int store_acquire(Value* args, size_t arg_count, size_t i) {
+    if (i >= arg_count || args[i].type != VAL_NUMBER) return -1;
+    double handle = args[i].as.number;
+    if (!(handle >= 1 && handle <= MAX_KV_STORES)) return -1;
+    int db = (int)handle - 1;
+    pthread_mutex_lock(&g_kv_lock);
+    if (g_stores[db]) g_store_users[db]++;
+    else db = -1;
+    pthread_mutex_unlock(&g_kv_lock);
+    return db;
+}
+
+static void store_release(int db) {
+    pthread_mutex_lock(&g_kv_lock);
+    g_store_users[db]--;
+    pthread_mutex_unlock(&g_kv_lock);
+}
+
+static KvTxn* txn_arg(Value* args, size_t arg_count, size_t i) {
+    if (i >= arg_count || args[i].type != VAL_NUMBER) return NULL;
+    double handle = args[i].as.number;
+    if (!(handle >= 1 && handle <= MAX_KV_TXNS)) return NULL;
+    pthread_mutex_lock(&g_kv_lock);
+    KvTxn* txn = g_txns[(int)handle - 1].txn;
+    pthread_mutex_unlock(&g_kv_lock);
+    return txn;
+}
+
+// Detaches a handle's txn for commit or abort, so of two threads ending
+// the same handle only one gets it. The slot stays claimed, keeping the
+// store open, until txn_release
+static KvTxn* txn_take(Value* args, size_t arg_count, size_t i, int* slot) {
+    if (i >= arg_count || args[i].type != VAL_NUMBER) return NULL;
+    double handle = args[i].as.number;
+    if (!(handle >= 1 && handle <= MAX_KV_TXNS)) return NULL;
+    *slot = (int)handle - 1;
+    pthread_mutex_lock(&g_kv_lock);
+    KvTxn* txn = g_txns[*slot].txn;
+    g_txns[*slot].txn = NULL;
+    pthread_mutex_unlock(&g_kv_lock);
+    return txn;
+}
+
+static void txn_release(int slot) {
+    pthread_mutex_lock(&g_kv_lock);
+    g_txns[slot] = (KvTxnHandle){ 0 };
+    pthread_mutex_unlock(&g_kv_lock);
+}
+
+// Whether this thread holds a write transaction on db's store; beginning
+// another would deadlock on the store's write lock. Only this thread adds
+// such transactions, so the answer cannot go stale before it acts on it
+static bool writing_here(int db) {
+    bool found = false;
+    pthread_mutex_lock(&g_kv_lock);
+    for (int i = 0; i < MAX_KV_TXNS && !found; i++) {
+        KvTxnHandle* h = &g_txns[i];
+        found = h->txn && h->write && g_stores[h->store] == g_stores[db] && pthread_equal(h->owner, pthread_self());
+    }
+    pthread_mutex_unlock(&g_kv_lock);
+    return found;
+}
+
+static const char* string_arg(Value* args, size_t arg_count, size_t i) {
+    return i < arg_count && args[i].type == VAL_STRING ? args[i].as.string : NULL;
+}
+
+static Value view_string(KvView view) {
+    return value_string_len(view.data, view.length);
+}
+
+// ========== OPERATIONS ==========
+
+static Value txn_get(KvTxn* txn, const char* key) {
+    KvView value;
+    if (!kv_get(txn, key, strlen(key), &value)) return value_null();
+    return view_string(value);
+}
+
+// [[key, value], ...] for start <= key < end, at most limit pairs
+static Value txn_range(KvTxn* txn, Value* args, size_t arg_count, size_t first) {
+    const char* start = string_arg(args, arg_count, first);
+    const char* end = string_arg(args, arg_count, first + 1);
+    double limit = first + 2 < arg_count && args[first + 2].type == VAL_NUMBER ? args[first + 2].as.number : -1;
+    size_t end_length = end ? strlen(end) : 0;
+    Value pairs = value_list();
+    KvCursor* cursor = kv_cursor_open(txn, start, start ? strlen(start) : 0);
+    if (!cursor) return pairs;
+    KvView key, value;
+    for (double n = 0; (limit < 0 || n < limit) && kv_cursor_next(cursor, &key, &value); n++) {
+        if (end) {
+            int c = memcmp(key.data, end, key.length < end_length ? key.length : end_length);
+            if (c > 0 || (c == 0 && key.length >= end_length)) break;
+        }
+        Value pair = value_list();
+        list_append(&pair, view_string(key));
+        list_append(&pair, view_string(value));
+        list_append(&pairs, pair);
+    }
+    kv_cursor_close(cursor);
+    return pairs;
+}
+
+// ========== STORES ==========
+
+// open(path, sync_every?) -> db; sync_every > 1 batches fsyncs over that
+// many commits
+static Value kv_open_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    const char* path = string_arg(args, arg_count, 0);
+    if (!path) return value_number(-1);
+    KvOptions options = { 0, 1 };
+    if (arg_count > 1 && args[1].type == VAL_NUMBER && args[1].as.number >= 1) {
+        options.sync_every = (unsigned)args[1].as.number;
+    }
+    int slot = -1;
+    pthread_mutex_lock(&g_kv_lock);
+    for (int i = 0; i < MAX_KV_STORES; i++) {
+        if (!g_stores[i]) {
+            g_stores[i] = kv_open(path, &options);
+            slot = g_stores[i] ? i : -1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_kv_lock);
+    return value_number(slot >= 0 ? slot + 1 : -1);
+}
+
+// close(db) -> bool; false while the db has open transactions or another
+// thread is in a call on it
+static Value kv_close_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_bool(false);
+    double handle = args[0].as.number;
+    if (!(handle >= 1 && handle <= MAX_KV_STORES)) return value_bool(false);
+    int db = (int)handle - 1;
+    pthread_mutex_lock(&g_kv_lock);
+    KvStore* store = g_store_users[db] == 0 ? g_stores[db] : NULL;
+    for (int i = 0; i < MAX_KV_TXNS && store; i++) {
+        if (g_txns[i].claimed && g_txns[i].store == db) store = NULL;
+    }
+    if (store) g_stores[db] = NULL;
+    pthread_mutex_unlock(&g_kv_lock);
+    if (!store) return value_bool(false);
+    kv_close(store);
+    return value_bool(true);
+}
+
+// get(db, key) -> string or null
+static Value kv_get_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    const char* key = string_arg(args, arg_count, 1);
+    int db = key ? store_acquire(args, arg_count, 0) : -1;
+    if (db < 0) return value_null();
+    KvTxn* txn = kv_begin(g_stores[db], false);
+    Value v = value_null();
+    if (txn) {
+        v = txn_get(txn, key);
+        kv_commit(txn);
+    }
+    store_release(db);
+    return v;
+}
+
+static bool store_write(KvStore* store, const char* key, const char* value) {
+    KvTxn* txn = kv_begin(store, true);
+    if (!txn) return false;
+    bool done = value ? kv_put(txn, key, strlen(key), value, strlen(value))
+                      : kv_delete(txn, key, strlen(key));
+    if (!done) {
+        kv_abort(txn);
+        return false;
+    }
+    return kv_commit(txn);
+}
+
+// put(db, key, value) -> bool; false while this thread has a write txn on db
+static Value kv_put_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    const char* key = string_arg(args, arg_count, 1);
+    const char* value = string_arg(args, arg_count, 2);
+    int db = key && value ? store_acquire(args, arg_count, 0) : -1;
+    if (db < 0) return value_bool(false);
+    bool done = !writing_here(db) && store_write(g_stores[db], key, value);
+    store_release(db);
+    return value_bool(done);
+}
+
+// delete(db, key) -> bool, false if absent
+static Value kv_delete_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    const char* key = string_arg(args, arg_count, 1);
+    int db = key ? store_acquire(args, arg_count, 0) : -1;
+    if (db < 0) return value_bool(false);
+    bool done = !writing_here(db) && store_write(g_stores[db], key, NULL);
+    store_release(db);
+    return value_bool(done);
+}
+
+// range(db, start?, end?, limit?) -> [[key, value], ...] in key order;
+// null start/end mean unbounded
+static Value kv_range_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = store_acquire(args, arg_count, 0);
+    if (db < 0) return value_null();
+    KvTxn* txn = kv_begin(g_stores[db], false);
+    Value pairs = value_null();
+    if (txn) {
+        pairs = txn_range(txn, args, arg_count, 1);
+        kv_commit(txn);
+    }
+    store_release(db);
+    return pairs;
+}
+
+// count(db) -> number of keys
+static Value kv_count_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = store_acquire(args, arg_count, 0);
+    if (db < 0) return value_number(-1);
+    KvStat stat;
+    kv_stat(g_stores[db], &stat);
+    store_release(db);
+    return value_number((double)stat.entries);
+}
+
+// sync(db) -> bool; makes batched commits durable now
+static Value kv_sync_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = store_acquire(args, arg_count, 0);
+    if (db < 0) return value_bool(false);
+    bool synced = kv_sync(g_stores[db]);
+    store_release(db);
+    return value_bool(synced);
+}
+
+// ========== TRANSACTIONS ==========
+
+// begin(db, write?) -> txn; a write transaction waits for another thread's,
+// and is -1 if this thread already has one on db
+static Value kv_begin_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = store_acquire(args, arg_count, 0);
+    if (db < 0) return value_number(-1);
+    bool write = arg_count > 1 && args[1].type == VAL_BOOL && args[1].as.boolean;
+    int slot = -1;
+    if (!write || !writing_here(db)) {
+        pthread_mutex_lock(&g_kv_lock);
+        for (int i = 0; i < MAX_KV_TXNS; i++) {
+            if (!g_txns[i].claimed) {
+                g_txns[i] = (KvTxnHandle){ true, NULL, db, write, pthread_self() };
+                slot = i;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&g_kv_lock);
+    }
+    if (slot >= 0) {
+        // The claimed slot keeps the store open once the pin is dropped
+        KvTxn* txn = kv_begin(g_stores[db], write);
+        pthread_mutex_lock(&g_kv_lock);
+        if (txn) g_txns[slot].txn = txn;
+        else g_txns[slot] = (KvTxnHandle){ 0 };
+        pthread_mutex_unlock(&g_kv_lock);
+        if (!txn) slot = -1;
+    }
+    store_release(db);
+    return value_number(slot >= 0 ? slot + 1 : -1);
+}
+
+// txn_get(txn, key) -> string or null; sees the transaction's own writes
+static Value kv_txn_get_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    KvTxn* txn = txn_arg(args, arg_count, 0);
+    const char* key = string_arg(args, arg_count, 1);
+    if (!txn || !key) return value_null();
+    return txn_get(txn, key);
+}
+
+// txn_put(txn, key, value) -> bool
+static Value kv_txn_put_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    KvTxn* txn = txn_arg(args, arg_count, 0);
+    const char* key = string_arg(args, arg_count, 1);
+    const char* value = string_arg(args, arg_count, 2);
+    if (!txn || !key || !value) return value_bool(false);
+    return value_bool(kv_put(txn, key, strlen(key), value, strlen(value)));
+}
+
+// txn_delete(txn, key) -> bool
+static Value kv_txn_delete_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    KvTxn* txn = txn_arg(args, arg_count, 0);
+    const char* key = string_arg(args, arg_count, 1);
+    if (!txn || !key) return value_bool(false);
+    return value_bool(kv_delete(txn, key, strlen(key)));
+}
+
+// txn_range(txn, start?, end?, limit?) -> [[key, value], ...]
+static Value kv_txn_range_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    KvTxn* txn = txn_arg(args, arg_count, 0);
+    if (!txn) return value_null();
+    return txn_range(txn, args, arg_count, 1);
+}
+
+// commit(txn) -> bool; the handle is released either way
+static Value kv_commit_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int slot;
+    KvTxn* txn = txn_take(args, arg_count, 0, &slot);
+    if (!txn) return value_bool(false);
+    bool committed = kv_commit(txn);
+    txn_release(slot);
+    return value_bool(committed);
+}
+
+// abort(txn) -> bool
+static Value kv_abort_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int slot;
+    KvTxn* txn = txn_take(args, arg_count, 0, &slot);
+    if (!txn) return value_bool(false);
+    kv_abort(txn);
+    txn_release(slot);
+    return value_bool(true);
+}
+
+void register_kv_module(ModuleSystem* ms) {
+    Module* m = module_system_load(ms, "kv");
+    module_register_native_function(m, "open", kv_open_fn);
+    module_register_native_function(m, "close", kv_close_fn);
+    module_register_native_function(m, "get", kv_get_fn);
+    module_register_native_function(m, "put", kv_put_fn);
+    module_register_native_function(m, "delete", kv_delete_fn);
+    module_register_native_function(m, "range", kv_range_fn);
+    module_register_native_function(m, "count", kv_count_fn);
+    module_register_native_function(m, "sync", kv_sync_fn);
+    module_register_native_function(m, "begin", kv_begin_fn);
+    module_register_native_function(m, "txn_get", kv_txn_get_fn);
+    module_register_native_function(m, "txn_put", kv_txn_put_fn);
+    module_register_native_function(m, "txn_delete", kv_txn_delete_fn);
+    module_register_native_function(m, "txn_range", kv_txn_range_fn);
+    module_register_native_function(m, "commit", kv_commit_fn);
+    module_register_native_function(m, "abort", kv_abort_fn);
+}
@@ -0,0 +1,165 @@
+#include "../src/module.h"
+#include "../src/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Asynchronous logging from src/logger.c. A call checks the level first
+// and returns at once when it is filtered out; otherwise the format and
+// arguments are copied into this thread's ring buffer and a background
+// thread formats and writes them, so a log call never waits on the
+// terminal or disk. Each {} in the format takes the next argument; extra
+// arguments are appended separated by spaces. Script arguments are
+// evaluated before the call, so wrap expensive ones in
+// `if log.enabled("debug")`. When a ring is full lines are dropped, not
+// blocked on; stats() counts them.
+
+#define LOG_STACK_ARGS 16
+
+// Level from a name or a number (0 = debug .. 4 = off); -1 if neither
+static int level_arg(Value v) {
+    if (v.type == VAL_STRING) return logger_level_from_name(v.as.string);
+    if (v.type == VAL_NUMBER && v.as.number >= LOGGER_DEBUG && v.as.number <= LOGGER_OFF) return (int)v.as.number;
+    return -1;
+}
+
+// Queue format args[first] with the arguments after it
+static Value log_at(LoggerLevel level, Value* args, size_t arg_count, size_t first) {
+    if (!logger_enabled(level) || first >= arg_count || args[first].type != VAL_STRING) return value_bool(false);
+    size_t count = arg_count - first - 1;
+    LoggerArg stack[LOG_STACK_ARGS];
+    LoggerArg* converted = count <= LOG_STACK_ARGS ? stack : malloc(count * sizeof(LoggerArg));
+    if (!converted) return value_bool(false);
+    for (size_t i = 0; i < count; i++) {
+        Value v = args[first + 1 + i];
+        LoggerArg* a = &converted[i];
+        switch (v.type) {
+            case VAL_BOOL:
+                a->type = LOGGER_ARG_BOOL;
+                a->as.boolean = v.as.boolean;
+                break;
+            case VAL_NUMBER:
+                a->type = LOGGER_ARG_NUMBER;
+                a->as.number = v.as.number;
+                break;
+            case VAL_STRING:
+                a->type = LOGGER_ARG_STRING;
+                a->as.string.data = v.as.string;
+                a->as.string.length = strlen(v.as.string);
+                break;
+            case VAL_LIST:
+                a->type = LOGGER_ARG_STRING;
+                a->as.string.data = "<list>";
+                a->as.string.length = 6;
+                break;
+            case VAL_DICT:
+                a->type = LOGGER_ARG_STRING;
+                a->as.string.data = "<dict>";
+                a->as.string.length = 6;
+                break;
+            default:
+                a->type = LOGGER_ARG_NULL;
+                break;
+        }
+    }
+    const char* format = args[first].as.string;
+    bool queued = logger_write(level, format, strlen(format), converted, count);
+    if (converted != stack) free(converted);
+    return value_bool(queued);
+}
+
+// debug/info/warn/error(format, args...) -> bool queued
+static Value log_debug(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    return log_at(LOGGER_DEBUG, args, arg_count, 0);
+}
+
+static Value log_info(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    return log_at(LOGGER_INFO, args, arg_count, 0);
+}
+
+static Value log_warn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    return log_at(LOGGER_WARN, args, arg_count, 0);
+}
+
+static Value log_error(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    return log_at(LOGGER_ERROR, args, arg_count, 0);
+}
+
+// write(level, format, args...) -> bool queued
+static Value log_write(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int level = arg_count >= 1 ? level_arg(args[0]) : -1;
+    if (level < 0) return value_bool(false);
+    return log_at((LoggerLevel)level, args, arg_count, 1);
+}
+
+// level(name?) -> current level name; sets it when given
+static Value log_level(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count >= 1) {
+        int level = level_arg(args[0]);
+        if (level < 0) return value_null();
+        logger_set_level((LoggerLevel)level);
+    }
+    return value_string(logger_level_name(logger_level()));
+}
+
+// enabled(level) -> bool; whether a call at that level would be written
+static Value log_enabled(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int level = arg_count >= 1 ? level_arg(args[0]) : -1;
+    return value_bool(level >= 0 && logger_enabled((LoggerLevel)level));
+}
+
+// open(path = "-") -> bool; "-" is stdout, "stderr" stderr, else a file
+// opened for appending
+static Value log_open(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    const char* path = arg_count >= 1 && args[0].type == VAL_STRING ? args[0].as.string : "-";
+    return value_bool(logger_open(path));
+}
+
+// flush() -> null; returns once every line queued before it is written
+static Value log_flush(Environment* env, Value* args, size_t arg_count) {
+    (void)env; (void)args; (void)arg_count;
+    logger_flush();
+    return value_null();
+}
+
+// stats() -> {written, dropped, bytes, writes}
+static Value log_stats(Environment* env, Value* args, size_t arg_count) {
+    (void)env; (void)args; (void)arg_count;
+    LoggerStats stats;
+    logger_stats(&stats);
+    Value dict = value_dict();
+    dict_set(&dict, "written", value_number((double)stats.written));
+    dict_set(&dict, "dropped", value_number((double)stats.dropped));
+    dict_set(&dict, "bytes", value_number((double)stats.bytes));
+    dict_set(&dict, "writes", value_number((double)stats.writes));
+    return dict;
+}
+
+// close() -> null; flushes, stops the writer thread and closes the file
+static Value log_close(Environment* env, Value* args, size_t arg_count) {
+    (void)env; (void)args; (void)arg_count;
+    logger_shutdown();
+    return value_null();
+}
+
+void register_log_module(ModuleSystem* ms) {
+    Module* m = module_system_load(ms, "log");
+    module_register_native_function(m, "debug", log_debug);
+    module_register_native_function(m, "info", log_info);
+    module_register_native_function(m, "warn", log_warn);
+    module_register_native_function(m, "error", log_error);
+    module_register_native_function(m, "write", log_write);
+    module_register_native_function(m, "level", log_level);
+    module_register_native_function(m, "enabled", log_enabled);
+    module_register_native_function(m, "open", log_open);
+    module_register_native_function(m, "flush", log_flush);
+    module_register_native_function(m, "stats", log_stats);
+    module_register_native_function(m, "close", log_close);
+}
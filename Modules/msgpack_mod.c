@@ -0,0 +1,296 @@
+#include "../src/module.h"
+#include "../src/msgpack.h"
+#include "../src/mmap_file.h"
+#include "../src/packed_array.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Binary serialization for scripts, in MessagePack with a versioned
+// header (see src/msgpack.h). Encoded documents are buffers held by handle
+// (a positive number), since script strings cannot hold arbitrary bytes;
+// write/read go straight to and from files, and read decodes from the
+// mapped file. Packed arrays are stored as raw float64 blocks and decode
+// into new packed arrays with one copy. Errors return -1 (handles), null
+// (values) or false.
+
+#define MAX_MSGPACK_BUFFERS 256
+
+typedef struct {
+    unsigned char* data;
+    size_t length;
+} MsgpackBuffer;
+
+static MsgpackBuffer g_buffers[MAX_MSGPACK_BUFFERS];
+
+static Value buffer_value(MpWriter* writer) {
+    if (!writer->failed) {
+        for (int i = 0; i < MAX_MSGPACK_BUFFERS; i++) {
+            if (!g_buffers[i].data) {
+                g_buffers[i].data = mp_writer_take(writer, &g_buffers[i].length);
+                return value_number(i + 1);
+            }
+        }
+    }
+    mp_writer_free(writer);
+    return value_number(-1);
+}
+
+static MsgpackBuffer* buffer_arg(Value* args, size_t arg_count, size_t i) {
+    if (i >= arg_count || args[i].type != VAL_NUMBER) return NULL;
+    double handle = args[i].as.number;
+    if (!(handle >= 1 && handle <= MAX_MSGPACK_BUFFERS)) return NULL;
+    MsgpackBuffer* b = &g_buffers[(int)handle - 1];
+    return b->data ? b : NULL;
+}
+
+// ========== ENCODING ==========
+
+// Dictionaries have no key iteration in the module API yet, so they (and
+// anything else unknown) fail the encode instead of being dropped
+static bool encode_value(MpWriter* w, Value v, int depth) {
+    if (depth > MP_MAX_DEPTH) return false;
+    switch (v.type) {
+        case VAL_NULL:
+            mp_write_nil(w);
+            return true;
+        case VAL_BOOL:
+            mp_write_bool(w, v.as.boolean);
+            return true;
+        case VAL_NUMBER:
+            mp_write_number(w, v.as.number);
+            return true;
+        case VAL_STRING:
+            mp_write_str(w, v.as.string, strlen(v.as.string));
+            return true;
+        case VAL_LIST:
+            if (v.as.list.count > 0xffffffff) return false;
+            mp_write_array(w, (uint32_t)v.as.list.count);
+            for (size_t i = 0; i < v.as.list.count; i++) {
+                if (!encode_value(w, v.as.list.elements[i], depth + 1)) return false;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool encode_document(MpWriter* w, Value v) {
+    mp_writer_init(w);
+    mp_write_header(w);
+    if (encode_value(w, v, 0)) return !w->failed;
+    mp_writer_free(w);
+    return false;
+}
+
+static bool encode_array_document(MpWriter* w, const PackedArray* array) {
+    mp_writer_init(w);
+    mp_write_header(w);
+    mp_write_f64_array(w, array->data, array->length);
+    if (!w->failed) return true;
+    mp_writer_free(w);
+    return false;
+}
+
+// encode(value) -> buffer
+static Value msgpack_encode(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    MpWriter w;
+    if (arg_count < 1 || !encode_document(&w, args[0])) return value_number(-1);
+    return buffer_value(&w);
+}
+
+// encode_array(a) -> buffer holding the packed array
+static Value msgpack_encode_array(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    PackedArray* array = arg_count > 0 && args[0].type == VAL_NUMBER ? packed_array_lookup(args[0].as.number) : NULL;
+    MpWriter w;
+    if (!array || !encode_array_document(&w, array)) return value_number(-1);
+    return buffer_value(&w);
+}
+
+// ========== DECODING ==========
+
+// Decoding state: the packed arrays registered so far, so that a document
+// that fails part way releases them instead of leaking their handles
+typedef struct {
+    MpReader reader;
+    double* arrays;
+    size_t array_count;
+    size_t array_capacity;
+    bool ok;
+} MpDecoder;
+
+static bool decoder_track(MpDecoder* d, double handle) {
+    if (d->array_count == d->array_capacity) {
+        size_t capacity = d->array_capacity ? d->array_capacity * 2 : 8;
+        double* grown = realloc(d->arrays, capacity * sizeof(double));
+        if (!grown) return false;
+        d->arrays = grown;
+        d->array_capacity = capacity;
+    }
+    d->arrays[d->array_count++] = handle;
+    return true;
+}
+
+// Releases the arrays registered since `mark` (all of them for 0)
+static void decoder_release(MpDecoder* d, size_t mark) {
+    while (d->array_count > mark) packed_array_release(d->arrays[--d->array_count]);
+}
+
+static Value decode_value(MpDecoder* d, int depth) {
+    MpItem item;
+    if (depth > MP_MAX_DEPTH || !mp_read(&d->reader, &item)) {
+        d->ok = false;
+        return value_null();
+    }
+    switch (item.kind) {
+        case MP_NIL:
+            return value_null();
+        case MP_BOOL:
+            return value_bool(item.boolean);
+        case MP_INT:
+        case MP_FLOAT:
+            return value_number(item.number);
+        case MP_STR:
+        case MP_BIN: {
+            // Script strings end at the first NUL, so binaries do too
+            const char* nul = memchr(item.data, '\0', item.length);
+            return value_string_len(item.data, nul ? (size_t)(nul - (const char*)item.data) : item.length);
+        }
+        case MP_ARRAY: {
+            Value list = value_list();
+            for (uint32_t i = 0; i < item.count && d->ok; i++) list_append(&list, decode_value(d, depth + 1));
+            return list;
+        }
+        case MP_MAP: {
+            Value dict = value_dict();
+            for (uint32_t i = 0; i < item.count && d->ok; i++) {
+                Value key = decode_value(d, depth + 1);
+                size_t mark = d->array_count;
+                Value value = decode_value(d, depth + 1);
+                if (key.type == VAL_STRING) {
+                    dict_set(&dict, key.as.string, value);     // copies the key
+                    value_release(key);
+                } else {
+                    // Only string keys are kept; drop the value and any arrays in it
+                    decoder_release(d, mark);
+                    if (value.type == VAL_STRING) value_release(value);
+                }
+            }
+            return dict;
+        }
+        case MP_F64_ARRAY: {
+            PackedArray* array = packed_array_new(item.values_count);
+            if (!array) {
+                d->ok = false;
+                return value_null();
+            }
+            mp_f64_copy(&item, array->data);
+            double handle = packed_array_register(array);
+            if (handle < 0 || !decoder_track(d, handle)) {
+                if (handle >= 0) packed_array_release(handle);
+                d->ok = false;
+                return value_null();
+            }
+            return value_number(handle);
+        }
+        default:
+            return value_null();    // other ext types
+    }
+}
+
+static Value decode_document(const void* data, size_t length) {
+    MpDecoder d = { 0 };
+    mp_reader_init(&d.reader, data, length);
+    unsigned version;
+    if (!mp_read_header(&d.reader, &version)) return value_null();
+    d.ok = true;
+    Value v = decode_value(&d, 0);
+    if (!d.ok) decoder_release(&d, 0);
+    free(d.arrays);
+    return d.ok ? v : value_null();
+}
+
+// decode(buffer) -> value; packed arrays come back as new array handles
+static Value msgpack_decode(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    MsgpackBuffer* b = buffer_arg(args, arg_count, 0);
+    if (!b) return value_null();
+    return decode_document(b->data, b->length);
+}
+
+// ========== FILES ==========
+
+static bool write_file(const char* path, MpWriter* w) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        mp_writer_free(w);
+        return false;
+    }
+    bool ok = fwrite(w->data, 1, w->length, f) == w->length;
+    ok = fclose(f) == 0 && ok;
+    mp_writer_free(w);
+    return ok;
+}
+
+// write(path, value) -> bool
+static Value msgpack_write(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    MpWriter w;
+    if (arg_count < 2 || args[0].type != VAL_STRING || !encode_document(&w, args[1])) return value_bool(false);
+    return value_bool(write_file(args[0].as.string, &w));
+}
+
+// write_array(path, a) -> bool
+static Value msgpack_write_array(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 2 || args[0].type != VAL_STRING || args[1].type != VAL_NUMBER) return value_bool(false);
+    PackedArray* array = packed_array_lookup(args[1].as.number);
+    MpWriter w;
+    if (!array || !encode_array_document(&w, array)) return value_bool(false);
+    return value_bool(write_file(args[0].as.string, &w));
+}
+
+// read(path) -> value, decoded from the mapped file
+static Value msgpack_read(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
+    MappedFile file;
+    if (!mapped_file_open(&file, args[0].as.string)) return value_null();
+    Value v = decode_document(file.data, file.size);
+    mapped_file_close(&file);
+    return v;
+}
+
+// ========== BUFFERS ==========
+
+// size(buffer) -> bytes
+static Value msgpack_size(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    MsgpackBuffer* b = buffer_arg(args, arg_count, 0);
+    return value_number(b ? (double)b->length : -1);
+}
+
+// free(buffer) -> bool
+static Value msgpack_free(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    MsgpackBuffer* b = buffer_arg(args, arg_count, 0);
+    if (!b) return value_bool(false);
+    free(b->data);
+    b->data = NULL;
+    b->length = 0;
+    return value_bool(true);
+}
+
+void register_msgpack_module(ModuleSystem* ms) {
+    Module* m = module_system_load(ms, "msgpack");
+    module_register_native_function(m, "encode", msgpack_encode);
+    module_register_native_function(m, "encode_array", msgpack_encode_array);
+    module_register_native_function(m, "decode", msgpack_decode);
+    module_register_native_function(m, "write", msgpack_write);
+    module_register_native_function(m, "write_array", msgpack_write_array);
+    module_register_native_function(m, "read", msgpack_read);
+    module_register_native_function(m, "size", msgpack_size);
+    module_register_native_function(m, "free", msgpack_free);
+}
@@ -0,0 +1,159 @@
+#include "../src/module.h"
+#include "../src/net.h"
+#include "../src/event_loop.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define NET_READ_DEFAULT 65536
+
+// Script calls block the caller but drive the shared event loop while they
+// wait, so timers and other sockets keep making progress.
+static EventLoop* net_loop(void) {
+    if (!global_event_loop) global_event_loop = event_loop_new();
+    return global_event_loop;
+}
+
+static int net_finish(NetOp* op) {
+    if (!op) return -1;
+    net_op_wait(op);
+    int result = op->result;
+    net_op_release(op);
+    return result;
+}
+
+static void net_flag_ready(void* context) {
+    *(bool*)context = true;
+}
+
+static void net_wait_writable(int fd) {
+    bool ready = false;
+    event_loop_add_write(net_loop(), fd, net_flag_ready, &ready);
+    while (!ready) event_loop_run_once(net_loop());
+}
+
+static Value net_listen_fn(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 2 || args[1].type != VAL_NUMBER) return value_number(-1);
+
+    const char* host = args[0].type == VAL_STRING ? args[0].as.string : NULL;
+    int backlog = arg_count > 2 && args[2].type == VAL_NUMBER ? (int)args[2].as.number : NET_DEFAULT_BACKLOG;
+    int options = 0;
+    if (arg_count > 3 && args[3].type == VAL_BOOL && args[3].as.boolean) options |= NET_OPT_REUSEPORT;
+
+    int fd = net_listen(host, (int)args[1].as.number, backlog, options);
+    return value_number(fd >= 0 ? fd : -1);
+}
+
+static Value net_accept_fn(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_number(-1);
+
+    int fd = net_finish(net_async_accept(net_loop(), (int)args[0].as.number, NET_OPT_NODELAY, NULL, NULL));
+    return value_number(fd >= 0 ? fd : -1);
+}
+
+static Value net_connect_fn(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 2 || args[0].type != VAL_STRING || args[1].type != VAL_NUMBER) return value_number(-1);
+
+    int fd = net_finish(net_async_connect(net_loop(), args[0].as.string, (int)args[1].as.number, NULL, NULL));
+    return value_number(fd >= 0 ? fd : -1);
+}
+
+static Value net_read_fn(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_null();
+
+    size_t max = arg_count > 1 && args[1].type == VAL_NUMBER && args[1].as.number > 0
+        ? (size_t)args[1].as.number : NET_READ_DEFAULT;
+    char* buffer = malloc(max + 1);
+    if (!buffer) return value_null();
+
+    int n = net_finish(net_async_read(net_loop(), (int)args[0].as.number, buffer, max, NULL, NULL));
+    if (n <= 0) {
+        free(buffer);
+        return value_null();  // EOF or error
+    }
+    buffer[n] = '\0';
+    Value result = value_string(buffer);
+    free(buffer);
+    return result;
+}
+
+static Value net_write_fn(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 2 || args[0].type != VAL_NUMBER || args[1].type != VAL_STRING) return value_number(-1);
+
+    const char* data = args[1].as.string;
+    int n = net_finish(net_async_write(net_loop(), (int)args[0].as.number, data, strlen(data), NULL, NULL));
+    return value_number(n >= 0 ? n : -1);
+}
+
+static Value net_sendfile_fn(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 2 || args[0].type != VAL_NUMBER || args[1].type != VAL_STRING) return value_number(-1);
+
+    int sock = (int)args[0].as.number;
+    int file_fd = open(args[1].as.string, O_RDONLY);
+    if (file_fd < 0) return value_number(-1);
+
+    struct stat st;
+    if (fstat(file_fd, &st) != 0) {
+        close(file_fd);
+        return value_number(-1);
+    }
+
+    // The socket is non-blocking: wait for writability whenever the send
+    // buffer fills instead of spinning
+    int64_t offset = 0;
+    while (offset < (int64_t)st.st_size) {
+        int64_t n = net_sendfile(sock, file_fd, &offset, (size_t)(st.st_size - offset));
+        if (n == -EAGAIN) {
+            net_wait_writable(sock);
+            continue;
+        }
+        if (n <= 0) break;
+    }
+    close(file_fd);
+    return value_number((double)offset);
+}
+
+static Value net_close_fn(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_bool(false);
+
+    int fd = (int)args[0].as.number;
+    if (global_event_loop) event_loop_remove_fd_events(global_event_loop, fd);
+    net_close(fd);
+    return value_bool(true);
+}
+
+static Value net_set_nodelay_fn(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_bool(false);
+    bool on = arg_count < 2 || args[1].type != VAL_BOOL || args[1].as.boolean;
+    return value_bool(net_set_nodelay((int)args[0].as.number, on));
+}
+
+static Value net_set_reuseport_fn(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_bool(false);
+    bool on = arg_count < 2 || args[1].type != VAL_BOOL || args[1].as.boolean;
+    return value_bool(net_set_reuseport((int)args[0].as.number, on));
+}
+
+static Value net_local_port_fn(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_number(-1);
+    int port = net_local_port((int)args[0].as.number);
+    return value_number(port >= 0 ? port : -1);
+}
+
+void register_net_module(ModuleSystem* ms) {
+    Module* m = module_system_load(ms, "net");
+    module_register_native_function(m, "listen", net_listen_fn);
+    module_register_native_function(m, "accept", net_accept_fn);
+    module_register_native_function(m, "connect", net_connect_fn);
+    module_register_native_function(m, "read", net_read_fn);
+    module_register_native_function(m, "write", net_write_fn);
+    module_register_native_function(m, "sendfile", net_sendfile_fn);
+    module_register_native_function(m, "close", net_close_fn);
+    module_register_native_function(m, "set_nodelay", net_set_nodelay_fn);
+    module_register_native_function(m, "set_reuseport", net_set_reuseport_fn);
+    module_register_native_function(m, "local_port", net_local_port_fn);
+}
@@ -1,34 +1,159 @@
 #include "module.h"
+#include "../src/rng.h"
+#include "../src/packed_array.h"
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
 
-static int seeded = 0;
+// Random numbers from src/rng.c: xoshiro256** with one state per thread,
+// seeded from the OS unless random.seed is called. int() is unbiased
+// (Lemire's method instead of rand() % n). fill() writes a whole packed
+// array in one call with the SIMD kernel, which is what Monte Carlo loops
+// should use instead of one float() call per sample.
 
-static void ensure_seeded() {
-    if (!seeded) {
-        srand((unsigned)time(NULL));
-        seeded = 1;
+// Copy of a list element for a result list, so both can be freed
+static Value copy_value(Value v) {
+    if (v.type == VAL_STRING) return value_string(v.as.string);
+    if (v.type == VAL_LIST) {
+        Value list = value_list();
+        for (size_t i = 0; i < v.as.list.count; i++) list_append(&list, copy_value(v.as.list.elements[i]));
+        return list;
     }
+    return v;
 }
 
+// seed(n) -> null; makes this thread's sequence (and fills) repeatable
+static Value rand_seed(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count >= 1 && args[0].type == VAL_NUMBER) {
+        rng_thread_seed((uint64_t)(int64_t)args[0].as.number);
+    } else {
+        Rng fresh;
+        rng_seed_entropy(&fresh);
+        rng_thread_seed(rng_next(&fresh));
+    }
+    return value_null();
+}
+
+// int(min = 0, max = 100) -> integer in [min, max)
 static Value rand_int(Environment* env, Value* args, size_t arg_count) {
-    ensure_seeded();
-    int min = 0, max = 100;
-    if (arg_count >= 1 && args[0].type == VAL_NUMBER) min = (int)args[0].as.number;
-    if (arg_count >= 2 && args[1].type == VAL_NUMBER) max = (int)args[1].as.number;
+    (void)env;
+    int64_t min = 0, max = 100;
+    if (arg_count >= 1 && args[0].type == VAL_NUMBER) min = (int64_t)args[0].as.number;
+    if (arg_count >= 2 && args[1].type == VAL_NUMBER) max = (int64_t)args[1].as.number;
     if (max <= min) max = min + 1;
-    int r = min + rand() % (max - min);
-    return value_number((double)r);
+    uint64_t r = rng_bounded(rng_thread(), (uint64_t)max - (uint64_t)min);
+    return value_number((double)(min + (int64_t)r));
 }
 
+// float(lo = 0, hi = 1) -> number in [lo, hi)
 static Value rand_float(Environment* env, Value* args, size_t arg_count) {
-    ensure_seeded();
-    double r = (double)rand() / (double)RAND_MAX;
+    (void)env;
+    double r = rng_double(rng_thread());
+    if (arg_count >= 2 && args[0].type == VAL_NUMBER && args[1].type == VAL_NUMBER) {
+        r = args[0].as.number + r * (args[1].as.number - args[0].as.number);
+    }
     return value_number(r);
 }
 
+// fill(a, n?, lo = 0, hi = 1) -> length, or -1; resizes to n when given
+static Value rand_fill(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_number(-1);
+    PackedArray* array = packed_array_lookup(args[0].as.number);
+    if (!array) return value_number(-1);
+    if (arg_count >= 2 && args[1].type == VAL_NUMBER) {
+        if (!(args[1].as.number >= 0) || !packed_array_resize(array, (size_t)args[1].as.number)) {
+            return value_number(-1);
+        }
+    }
+    double lo = 0, hi = 1;
+    if (arg_count >= 4 && args[2].type == VAL_NUMBER && args[3].type == VAL_NUMBER) {
+        lo = args[2].as.number;
+        hi = args[3].as.number;
+    }
+    rng_fill_uniform(rng_thread_lanes(), array->data, array->length, lo, hi);
+    return value_number((double)array->length);
+}
+
+// shuffle(list | a) -> bool; in place
+static Value rand_shuffle(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1) return value_bool(false);
+    if (args[0].type == VAL_LIST) {
+        rng_shuffle(rng_thread(), args[0].as.list.elements, args[0].as.list.count, sizeof(Value));
+        return value_bool(true);
+    }
+    PackedArray* array = args[0].type == VAL_NUMBER ? packed_array_lookup(args[0].as.number) : NULL;
+    if (!array) return value_bool(false);
+    rng_shuffle(rng_thread(), array->data, array->length, sizeof(double));
+    return value_bool(true);
+}
+
+// sample(list | a, k) -> k distinct elements in random order, as a new
+// list or array; null if k is larger than the input
+static Value rand_sample(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 2 || args[1].type != VAL_NUMBER || !(args[1].as.number >= 0)) return value_null();
+    PackedArray* array = NULL;
+    size_t n;
+    if (args[0].type == VAL_LIST) {
+        n = args[0].as.list.count;
+    } else {
+        array = args[0].type == VAL_NUMBER ? packed_array_lookup(args[0].as.number) : NULL;
+        if (!array) return value_null();
+        n = array->length;
+    }
+    size_t k = (size_t)args[1].as.number;
+    if (k > n) return value_null();
+
+    // Partial Fisher-Yates over positions: the first k are the sample
+    size_t* index = malloc(sizeof(size_t) * (n ? n : 1));
+    if (!index) return value_null();
+    for (size_t i = 0; i < n; i++) index[i] = i;
+    Rng* rng = rng_thread();
+    for (size_t i = 0; i < k; i++) {
+        size_t j = i + (size_t)rng_bounded(rng, n - i);
+        size_t t = index[i];
+        index[i] = index[j];
+        index[j] = t;
+    }
+
+    Value result;
+    if (array) {
+        PackedArray* out = packed_array_new(k);
+        if (out) {
+            for (size_t i = 0; i < k; i++) out->data[i] = array->data[index[i]];
+        }
+        result = value_number(packed_array_register(out));
+    } else {
+        result = value_list();
+        for (size_t i = 0; i < k; i++) list_append(&result, copy_value(args[0].as.list.elements[index[i]]));
+    }
+    free(index);
+    return result;
+}
+
+// choice(list | a) -> one element, or null when empty
+static Value rand_choice(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1) return value_null();
+    if (args[0].type == VAL_LIST) {
+        size_t n = args[0].as.list.count;
+        if (n == 0) return value_null();
+        return copy_value(args[0].as.list.elements[rng_bounded(rng_thread(), n)]);
+    }
+    PackedArray* array = args[0].type == VAL_NUMBER ? packed_array_lookup(args[0].as.number) : NULL;
+    if (!array || array->length == 0) return value_null();
+    return value_number(array->data[rng_bounded(rng_thread(), array->length)]);
+}
+
 void register_mod_random(ModuleSystem* ms) {
     Module* m = module_system_load(ms, "random");
+    module_register_native_function(m, "seed", rand_seed);
     module_register_native_function(m, "int", rand_int);
     module_register_native_function(m, "float", rand_float);
+    module_register_native_function(m, "fill", rand_fill);
+    module_register_native_function(m, "shuffle", rand_shuffle);
+    module_register_native_function(m, "sample", rand_sample);
+    module_register_native_function(m, "choice", rand_choice);
 }
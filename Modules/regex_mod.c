@@ -0,0 +1,263 @@
+#include "../src/module.h"
+#include "../src/regex_engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Patterns are compiled once and shared through the engine's LRU cache, so
+// calling regex.test(pattern, line) in a loop costs one lookup per call.
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} RegexBuffer;
+
+static bool buffer_append(RegexBuffer* buf, const char* data, size_t length) {
+    if (buf->length + length + 1 > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 64;
+        while (capacity < buf->length + length + 1) capacity *= 2;
+        char* grown = realloc(buf->data, capacity);
+        if (!grown) return false;
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->length, data, length);
+    buf->length += length;
+    buf->data[buf->length] = '\0';
+    return true;
+}
+
+// The matched text as a new string, copied once straight from the subject
+static Value slice_value(const char* text, RegexSpan span) {
+    if (span.start == REGEX_NO_POS) return value_null();
+    return value_string_len(text + span.start, span.end - span.start);
+}
+
+// Optional trailing flags string: "i" ignore case, "m" multiline, "s" dot-all
+static int parse_flags(Value* args, size_t arg_count, size_t index) {
+    if (arg_count <= index || args[index].type != VAL_STRING) return 0;
+    int flags = 0;
+    for (const char* p = args[index].as.string; *p; p++) {
+        if (*p == 'i') flags |= REGEX_ICASE;
+        else if (*p == 'm') flags |= REGEX_MULTILINE;
+        else if (*p == 's') flags |= REGEX_DOTALL;
+    }
+    return flags;
+}
+
+// Look up pattern args[0] for subject args[1]; NULL if either is missing
+// or the pattern does not compile
+static Regex* regex_for(Value* args, size_t arg_count, size_t flags_index) {
+    if (arg_count < 2 || args[0].type != VAL_STRING || args[1].type != VAL_STRING) return NULL;
+    return regex_cache_get(args[0].as.string, parse_flags(args, arg_count, flags_index));
+}
+
+static Value regex_test(Environment* env, Value* args, size_t arg_count) {
+    Regex* re = regex_for(args, arg_count, 2);
+    if (!re) return value_bool(false);
+
+    const char* text = args[1].as.string;
+    bool matched = regex_is_match(re, text, strlen(text));
+    regex_release(re);
+    return value_bool(matched);
+}
+
+static Value regex_search_fn(Environment* env, Value* args, size_t arg_count) {
+    Regex* re = regex_for(args, arg_count, 2);
+    if (!re) return value_null();
+
+    const char* text = args[1].as.string;
+    RegexSpan groups[REGEX_MAX_GROUPS];
+    Value result = regex_search(re, text, strlen(text), 0, groups) ? slice_value(text, groups[0]) : value_null();
+    regex_release(re);
+    return result;
+}
+
+static Value regex_find_index(Environment* env, Value* args, size_t arg_count) {
+    Regex* re = regex_for(args, arg_count, 2);
+    if (!re) return value_number(-1);
+
+    const char* text = args[1].as.string;
+    RegexSpan groups[REGEX_MAX_GROUPS];
+    double index = regex_search(re, text, strlen(text), 0, groups) ? (double)groups[0].start : -1;
+    regex_release(re);
+    return value_number(index);
+}
+
+static Value regex_group(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 3 || args[2].type != VAL_NUMBER) return value_null();
+    Regex* re = regex_for(args, arg_count, 3);
+    if (!re) return value_null();
+
+    const char* text = args[1].as.string;
+    size_t index = args[2].as.number < 0 ? REGEX_MAX_GROUPS : (size_t)args[2].as.number;
+    RegexSpan groups[REGEX_MAX_GROUPS];
+    Value result = value_null();
+    if (index <= regex_group_count(re) && regex_search(re, text, strlen(text), 0, groups)) {
+        result = slice_value(text, groups[index]);
+    }
+    regex_release(re);
+    return result;
+}
+
+static Value regex_groups(Environment* env, Value* args, size_t arg_count) {
+    Regex* re = regex_for(args, arg_count, 2);
+    if (!re) return value_null();
+
+    const char* text = args[1].as.string;
+    RegexSpan groups[REGEX_MAX_GROUPS];
+    Value result = value_null();
+    if (regex_search(re, text, strlen(text), 0, groups)) {
+        result = value_list();
+        for (size_t i = 1; i <= regex_group_count(re); i++) {
+            list_append(&result, slice_value(text, groups[i]));
+        }
+    }
+    regex_release(re);
+    return result;
+}
+
+// Next match at or after *pos; advances *pos past it (by one byte for an
+// empty match so iteration always terminates)
+static bool next_match(Regex* re, const char* text, size_t length, size_t* pos, RegexSpan* groups) {
+    if (*pos > length || !regex_search(re, text, length, *pos, groups)) return false;
+    *pos = groups[0].end > groups[0].start ? groups[0].end : groups[0].end + 1;
+    return true;
+}
+
+static Value regex_findall(Environment* env, Value* args, size_t arg_count) {
+    Regex* re = regex_for(args, arg_count, 2);
+    if (!re) return value_null();
+
+    // Like Python: with a capture group, collect group 1 instead of the whole match
+    const char* text = args[1].as.string;
+    size_t length = strlen(text);
+    size_t which = regex_group_count(re) > 0 ? 1 : 0;
+    RegexSpan groups[REGEX_MAX_GROUPS];
+    Value list = value_list();
+    size_t pos = 0;
+    while (next_match(re, text, length, &pos, groups)) {
+        list_append(&list, slice_value(text, groups[which]));
+    }
+    regex_release(re);
+    return list;
+}
+
+static Value regex_count(Environment* env, Value* args, size_t arg_count) {
+    Regex* re = regex_for(args, arg_count, 2);
+    if (!re) return value_number(0);
+
+    const char* text = args[1].as.string;
+    size_t length = strlen(text);
+    RegexSpan groups[REGEX_MAX_GROUPS];
+    size_t count = 0, pos = 0;
+    while (next_match(re, text, length, &pos, groups)) count++;
+    regex_release(re);
+    return value_number((double)count);
+}
+
+// Append the replacement, expanding $0-$9 group references and $$
+static bool append_replacement(RegexBuffer* out, const char* repl, const char* text, RegexSpan* groups, size_t group_count) {
+    for (const char* p = repl; *p; p++) {
+        if (*p == '$' && p[1] == '$') {
+            if (!buffer_append(out, "$", 1)) return false;
+            p++;
+        } else if (*p == '$' && p[1] >= '0' && p[1] <= '9') {
+            size_t index = (size_t)(p[1] - '0');
+            if (index <= group_count && groups[index].start != REGEX_NO_POS &&
+                !buffer_append(out, text + groups[index].start, groups[index].end - groups[index].start)) return false;
+            p++;
+        } else if (!buffer_append(out, p, 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Value regex_replace(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 3 || args[2].type != VAL_STRING) return value_null();
+    Regex* re = regex_for(args, arg_count, 3);
+    if (!re) return arg_count >= 2 ? args[1] : value_null();
+
+    const char* text = args[1].as.string;
+    size_t length = strlen(text);
+    RegexBuffer out = {0};
+    RegexSpan groups[REGEX_MAX_GROUPS];
+    size_t copied = 0, pos = 0;
+    bool ok = buffer_append(&out, "", 0);
+    while (ok && next_match(re, text, length, &pos, groups)) {
+        ok = buffer_append(&out, text + copied, groups[0].start - copied) &&
+             append_replacement(&out, args[2].as.string, text, groups, regex_group_count(re));
+        copied = groups[0].end;
+    }
+    if (ok) ok = buffer_append(&out, text + copied, length - copied);
+    regex_release(re);
+
+    Value result = ok ? value_string(out.data) : value_null();
+    free(out.data);
+    return result;
+}
+
+static Value regex_split(Environment* env, Value* args, size_t arg_count) {
+    Regex* re = regex_for(args, arg_count, 2);
+    if (!re) return value_null();
+
+    const char* text = args[1].as.string;
+    size_t length = strlen(text);
+    RegexSpan groups[REGEX_MAX_GROUPS];
+    Value list = value_list();
+    size_t piece = 0, pos = 0;
+    while (next_match(re, text, length, &pos, groups)) {
+        if (groups[0].end == groups[0].start) {
+            // An empty match cannot split at the very start or end
+            if (groups[0].start == 0 || groups[0].start >= length) continue;
+        }
+        RegexSpan span = { piece, groups[0].start };
+        list_append(&list, slice_value(text, span));
+        piece = groups[0].end;
+    }
+    RegexSpan rest = { piece, length };
+    list_append(&list, slice_value(text, rest));
+    regex_release(re);
+    return list;
+}
+
+static Value regex_escape(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
+
+    const char* text = args[0].as.string;
+    RegexBuffer out = {0};
+    bool ok = buffer_append(&out, "", 0);
+    for (const char* p = text; ok && *p; p++) {
+        if (strchr("\\^$.|?*+()[]{}", *p)) ok = buffer_append(&out, "\\", 1);
+        if (ok) ok = buffer_append(&out, p, 1);
+    }
+    Value result = ok ? value_string(out.data) : value_null();
+    free(out.data);
+    return result;
+}
+
+static Value regex_valid(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_bool(false);
+
+    Regex* re = regex_cache_get(args[0].as.string, parse_flags(args, arg_count, 1));
+    if (!re) return value_bool(false);
+    regex_release(re);
+    return value_bool(true);
+}
+
+void register_regex_module(ModuleSystem* ms) {
+    Module* m = module_system_load(ms, "regex");
+    module_register_native_function(m, "test", regex_test);
+    module_register_native_function(m, "search", regex_search_fn);
+    module_register_native_function(m, "find_index", regex_find_index);
+    module_register_native_function(m, "group", regex_group);
+    module_register_native_function(m, "groups", regex_groups);
+    module_register_native_function(m, "findall", regex_findall);
+    module_register_native_function(m, "count", regex_count);
+    module_register_native_function(m, "replace", regex_replace);
+    module_register_native_function(m, "split", regex_split);
+    module_register_native_function(m, "escape", regex_escape);
+    module_register_native_function(m, "valid", regex_valid);
+}
@@ -0,0 +1,422 @@
+#include "../src/module.h"
+#include "../src/sqlite_db.h"
+#include "../src/packed_array.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// SQLite for scripts, registered as native.sqlite3 (the module that
+// shared/sdk/bindings/sqlite.rbo imports). Connections and cursors are
+// handles (positive numbers). Statements are prepared once per connection
+// and kept in an LRU cache keyed by SQL text (see src/sqlite_db.h), and
+// parameters are bound by type: integral numbers as INTEGER, other numbers
+// as REAL, strings as TEXT, booleans as 0/1. Rows are lists in column
+// order. query_prepared materializes every row; cursor/fetch produce them
+// one at a time, and fetch_columns returns a batch column by column, with
+// numeric columns as packed arrays. executemany runs one statement over
+// many rows in a single transaction. Errors return -1 (handles and
+// counts), null (rows) or false; error(conn) has the message.
+
+#define MAX_SQLITE_DBS     64
+#define MAX_SQLITE_CURSORS 256
+
+static SqlDb* g_dbs[MAX_SQLITE_DBS];
+
+typedef struct {
+    SqlCursor* cursor;
+    int db;                 // index into g_dbs
+} SqliteCursorHandle;
+
+static SqliteCursorHandle g_cursors[MAX_SQLITE_CURSORS];
+
+static int db_index(Value* args, size_t arg_count, size_t i) {
+    if (i >= arg_count || args[i].type != VAL_NUMBER) return -1;
+    double handle = args[i].as.number;
+    if (!(handle >= 1 && handle <= MAX_SQLITE_DBS) || !g_dbs[(int)handle - 1]) return -1;
+    return (int)handle - 1;
+}
+
+static SqliteCursorHandle* cursor_arg(Value* args, size_t arg_count, size_t i) {
+    if (i >= arg_count || args[i].type != VAL_NUMBER) return NULL;
+    double handle = args[i].as.number;
+    if (!(handle >= 1 && handle <= MAX_SQLITE_CURSORS)) return NULL;
+    SqliteCursorHandle* h = &g_cursors[(int)handle - 1];
+    return h->cursor ? h : NULL;
+}
+
+static void cursor_release(SqliteCursorHandle* h) {
+    sql_cursor_close(h->cursor);
+    h->cursor = NULL;
+}
+
+// ========== VALUES ==========
+
+// Script value -> parameter, borrowing strings; false for unbindable types
+static bool to_param(Value v, SqlValue* out) {
+    switch (v.type) {
+        case VAL_NULL:
+            out->type = SQL_NULL;
+            return true;
+        case VAL_BOOL:
+            out->type = SQL_INT;
+            out->as.i = v.as.boolean ? 1 : 0;
+            return true;
+        case VAL_NUMBER: {
+            double n = v.as.number;
+            if (n == floor(n) && n >= -9223372036854775808.0 && n < 9223372036854775808.0) {
+                out->type = SQL_INT;
+                out->as.i = (int64_t)n;
+            } else {
+                out->type = SQL_FLOAT;
+                out->as.f = n;
+            }
+            return true;
+        }
+        case VAL_STRING:
+            out->type = SQL_TEXT;
+            out->as.bytes.data = v.as.string;
+            out->as.bytes.length = strlen(v.as.string);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Parameters from an optional list argument; *params is malloc'd (or NULL
+// when there are none)
+static bool params_arg(Value* args, size_t arg_count, size_t i, SqlValue** params, size_t* count) {
+    *params = NULL;
+    *count = 0;
+    if (i >= arg_count || args[i].type == VAL_NULL) return true;
+    if (args[i].type != VAL_LIST) return false;
+    size_t n = args[i].as.list.count;
+    if (n == 0) return true;
+    *params = malloc(sizeof(SqlValue) * n);
+    if (!*params) return false;
+    for (size_t j = 0; j < n; j++) {
+        if (!to_param(args[i].as.list.elements[j], &(*params)[j])) {
+            free(*params);
+            *params = NULL;
+            return false;
+        }
+    }
+    *count = n;
+    return true;
+}
+
+static Value cell_value(SqlValue v) {
+    switch (v.type) {
+        case SQL_INT:
+            return value_number((double)v.as.i);
+        case SQL_FLOAT:
+            return value_number(v.as.f);
+        case SQL_TEXT:
+            return value_string(v.as.bytes.data);     // SQLite text is NUL-terminated
+        case SQL_BLOB: {
+            // Script strings end at the first NUL, so blobs do too
+            char* text = strndup(v.as.bytes.data ? v.as.bytes.data : "", v.as.bytes.length);
+            if (!text) return value_null();
+            Value s = value_string(text);
+            free(text);
+            return s;
+        }
+        default:
+            return value_null();
+    }
+}
+
+static Value row_value(SqlCursor* cursor) {
+    Value row = value_list();
+    size_t columns = sql_cursor_columns(cursor);
+    for (size_t i = 0; i < columns; i++) list_append(&row, cell_value(sql_cursor_value(cursor, i)));
+    return row;
+}
+
+// Every remaining row of a cursor, or null if stepping failed
+static Value drain(SqlCursor* cursor) {
+    Value rows = value_list();
+    while (sql_cursor_step(cursor)) list_append(&rows, row_value(cursor));
+    return sql_cursor_failed(cursor) ? value_null() : rows;
+}
+
+// ========== CONNECTIONS ==========
+
+// open(path, cache_size?) -> conn; ":memory:" for an in-memory database
+static Value sqlite_open(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_number(-1);
+    size_t cache = arg_count > 1 && args[1].type == VAL_NUMBER && args[1].as.number >= 1
+                       ? (size_t)args[1].as.number : 0;
+    for (int i = 0; i < MAX_SQLITE_DBS; i++) {
+        if (!g_dbs[i]) {
+            g_dbs[i] = sql_open(args[0].as.string, cache);
+            return value_number(g_dbs[i] ? i + 1 : -1);
+        }
+    }
+    return value_number(-1);
+}
+
+// close(conn) -> bool; also closes the connection's cursors
+static Value sqlite_close(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = db_index(args, arg_count, 0);
+    if (db < 0) return value_bool(false);
+    for (int i = 0; i < MAX_SQLITE_CURSORS; i++) {
+        if (g_cursors[i].cursor && g_cursors[i].db == db) cursor_release(&g_cursors[i]);
+    }
+    sql_close(g_dbs[db]);
+    g_dbs[db] = NULL;
+    return value_bool(true);
+}
+
+// exec(conn, sql) -> rows of the statement, or null; SQL without rows
+// (several statements allowed) returns an empty list
+static Value sqlite_exec(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = db_index(args, arg_count, 0);
+    if (db < 0 || arg_count < 2 || args[1].type != VAL_STRING) return value_null();
+    SqlCursor* cursor = sql_query(g_dbs[db], args[1].as.string, NULL, 0);
+    if (!cursor) {
+        // Several statements do not prepare as one; run them as a script
+        return sql_exec_script(g_dbs[db], args[1].as.string) ? value_list() : value_null();
+    }
+    Value rows = drain(cursor);
+    sql_cursor_close(cursor);
+    return rows;
+}
+
+// query_prepared(conn, sql, params?) -> list of rows, or null
+static Value sqlite_query_prepared(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = db_index(args, arg_count, 0);
+    SqlValue* params;
+    size_t count;
+    if (db < 0 || arg_count < 2 || args[1].type != VAL_STRING || !params_arg(args, arg_count, 2, &params, &count)) {
+        return value_null();
+    }
+    SqlCursor* cursor = sql_query(g_dbs[db], args[1].as.string, params, count);
+    free(params);
+    if (!cursor) return value_null();
+    Value rows = drain(cursor);
+    sql_cursor_close(cursor);
+    return rows;
+}
+
+// execute(conn, sql, params?) -> rows changed, or -1
+static Value sqlite_execute(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = db_index(args, arg_count, 0);
+    SqlValue* params;
+    size_t count;
+    if (db < 0 || arg_count < 2 || args[1].type != VAL_STRING || !params_arg(args, arg_count, 2, &params, &count)) {
+        return value_number(-1);
+    }
+    int64_t changes = sql_execute(g_dbs[db], args[1].as.string, params, count);
+    free(params);
+    return value_number((double)changes);
+}
+
+// executemany(conn, sql, rows) -> rows changed, or -1; every row is a list
+// of the same length and the whole batch is one transaction
+static Value sqlite_executemany(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = db_index(args, arg_count, 0);
+    if (db < 0 || arg_count < 3 || args[1].type != VAL_STRING || args[2].type != VAL_LIST) return value_number(-1);
+    size_t rows = args[2].as.list.count;
+    if (rows == 0) return value_number(0);
+    Value* first = &args[2].as.list.elements[0];
+    if (first->type != VAL_LIST) return value_number(-1);
+    size_t width = first->as.list.count;
+    SqlValue* params = malloc(sizeof(SqlValue) * (width ? rows * width : 1));
+    if (!params) return value_number(-1);
+    bool ok = true;
+    for (size_t r = 0; ok && r < rows; r++) {
+        Value* row = &args[2].as.list.elements[r];
+        ok = row->type == VAL_LIST && row->as.list.count == width;
+        for (size_t c = 0; ok && c < width; c++) ok = to_param(row->as.list.elements[c], &params[r * width + c]);
+    }
+    int64_t changes = ok ? sql_execute_many(g_dbs[db], args[1].as.string, params, rows, width) : -1;
+    free(params);
+    return value_number((double)changes);
+}
+
+// last_insert_id(conn) -> rowid of the latest insert
+static Value sqlite_last_insert_id(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = db_index(args, arg_count, 0);
+    return value_number(db < 0 ? -1 : (double)sql_last_insert_id(g_dbs[db]));
+}
+
+// error(conn) -> message of the last failure
+static Value sqlite_error(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = db_index(args, arg_count, 0);
+    return db < 0 ? value_null() : value_string(sql_error(g_dbs[db]));
+}
+
+// cache_stats(conn) -> [hits, misses, evictions] of the statement cache
+static Value sqlite_cache_stats(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = db_index(args, arg_count, 0);
+    if (db < 0) return value_null();
+    SqlCacheStats stats;
+    sql_cache_stats(g_dbs[db], &stats);
+    Value list = value_list();
+    list_append(&list, value_number((double)stats.hits));
+    list_append(&list, value_number((double)stats.misses));
+    list_append(&list, value_number((double)stats.evictions));
+    return list;
+}
+
+// ========== CURSORS ==========
+
+// cursor(conn, sql, params?) -> cursor; rows are produced as fetched
+static Value sqlite_cursor(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    int db = db_index(args, arg_count, 0);
+    SqlValue* params;
+    size_t count;
+    if (db < 0 || arg_count < 2 || args[1].type != VAL_STRING || !params_arg(args, arg_count, 2, &params, &count)) {
+        return value_number(-1);
+    }
+    for (int i = 0; i < MAX_SQLITE_CURSORS; i++) {
+        if (!g_cursors[i].cursor) {
+            SqlCursor* cursor = sql_query(g_dbs[db], args[1].as.string, params, count);
+            free(params);
+            if (!cursor) return value_number(-1);
+            g_cursors[i] = (SqliteCursorHandle){ cursor, db };
+            return value_number(i + 1);
+        }
+    }
+    free(params);
+    return value_number(-1);
+}
+
+// fetch(cursor) -> next row, or null at the end (the cursor is then
+// released)
+static Value sqlite_fetch(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    SqliteCursorHandle* h = cursor_arg(args, arg_count, 0);
+    if (!h) return value_null();
+    if (!sql_cursor_step(h->cursor)) {
+        cursor_release(h);
+        return value_null();
+    }
+    return row_value(h->cursor);
+}
+
+// fetch_columns(cursor, max_rows?) -> {name: column} for up to max_rows
+// rows (default all), or null at the end. A column whose first value is a
+// number is a packed array (other cells NaN); others are lists.
+static Value sqlite_fetch_columns(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    SqliteCursorHandle* h = cursor_arg(args, arg_count, 0);
+    if (!h) return value_null();
+    double max_rows = arg_count > 1 && args[1].type == VAL_NUMBER ? args[1].as.number : -1;
+    SqlCursor* cursor = h->cursor;
+    if (max_rows == 0 || !sql_cursor_step(cursor)) {
+        if (max_rows != 0) cursor_release(h);
+        return value_null();
+    }
+    size_t columns = sql_cursor_columns(cursor);
+    PackedArray** numeric = calloc(columns ? columns : 1, sizeof(PackedArray*));
+    Value* lists = malloc(sizeof(Value) * (columns ? columns : 1));
+    if (!numeric || !lists) {
+        free(numeric);
+        free(lists);
+        return value_null();
+    }
+    bool ok = true;
+    for (size_t c = 0; c < columns; c++) {
+        SqlType type = sql_cursor_value(cursor, c).type;
+        lists[c] = value_null();
+        if (!ok) continue;
+        if (type == SQL_INT || type == SQL_FLOAT) ok = (numeric[c] = packed_array_new(0)) != NULL;
+        else lists[c] = value_list();
+    }
+    double n = 0;
+    do {
+        for (size_t c = 0; ok && c < columns; c++) {
+            SqlValue v = sql_cursor_value(cursor, c);
+            if (!numeric[c]) {
+                list_append(&lists[c], cell_value(v));
+            } else {
+                double x = v.type == SQL_INT ? (double)v.as.i : v.type == SQL_FLOAT ? v.as.f : NAN;
+                ok = packed_array_push(numeric[c], x);
+            }
+        }
+        n++;
+    } while (ok && (max_rows < 0 || n < max_rows) && sql_cursor_step(cursor));
+    ok = ok && !sql_cursor_failed(cursor);
+
+    // Arrays are registered only once the whole batch has been read, and
+    // released again if the handle table fills; on failure the half-built
+    // lists are never handed out
+    double* handles = ok ? malloc(sizeof(double) * (columns ? columns : 1)) : NULL;
+    size_t registered = 0;
+    ok = handles != NULL;
+    for (size_t c = 0; c < columns; c++) {
+        if (!numeric[c]) continue;
+        if (!ok) {
+            packed_array_free(numeric[c]);
+            continue;
+        }
+        handles[c] = packed_array_register(numeric[c]);     // frees the array on -1
+        ok = handles[c] > 0;
+        registered = c + 1;
+    }
+    Value batch = value_null();
+    if (ok) {
+        batch = value_dict();
+        for (size_t c = 0; c < columns; c++) {
+            dict_set(&batch, sql_cursor_name(cursor, c), numeric[c] ? value_number(handles[c]) : lists[c]);
+        }
+    } else {
+        for (size_t c = 0; c < registered; c++) {
+            if (numeric[c] && handles[c] > 0) packed_array_release(handles[c]);
+        }
+    }
+    free(handles);
+    free(numeric);
+    free(lists);
+    return batch;
+}
+
+// columns(cursor) -> column names
+static Value sqlite_columns(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    SqliteCursorHandle* h = cursor_arg(args, arg_count, 0);
+    if (!h) return value_null();
+    Value names = value_list();
+    size_t columns = sql_cursor_columns(h->cursor);
+    for (size_t i = 0; i < columns; i++) list_append(&names, value_string(sql_cursor_name(h->cursor, i)));
+    return names;
+}
+
+// close_cursor(cursor) -> bool
+static Value sqlite_close_cursor(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    SqliteCursorHandle* h = cursor_arg(args, arg_count, 0);
+    if (!h) return value_bool(false);
+    cursor_release(h);
+    return value_bool(true);
+}
+
+void register_sqlite_module(ModuleSystem* ms) {
+    Module* m = module_system_load(ms, "native.sqlite3");
+    module_register_native_function(m, "open", sqlite_open);
+    module_register_native_function(m, "close", sqlite_close);
+    module_register_native_function(m, "exec", sqlite_exec);
+    module_register_native_function(m, "query_prepared", sqlite_query_prepared);
+    module_register_native_function(m, "execute", sqlite_execute);
+    module_register_native_function(m, "executemany", sqlite_executemany);
+    module_register_native_function(m, "last_insert_id", sqlite_last_insert_id);
+    module_register_native_function(m, "error", sqlite_error);
+    module_register_native_function(m, "cache_stats", sqlite_cache_stats);
+    module_register_native_function(m, "cursor", sqlite_cursor);
+    module_register_native_function(m, "fetch", sqlite_fetch);
+    module_register_native_function(m, "fetch_columns", sqlite_fetch_columns);
+    module_register_native_function(m, "columns", sqlite_columns);
+    module_register_native_function(m, "close_cursor", sqlite_close_cursor);
+}
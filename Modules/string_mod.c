@@ -1,17 +1,33 @@
 #include "module.h"
+#include "str_kernels.h"
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
 
+// Searching, case conversion and trimming go through the SIMD kernels in
+// src/str_kernels.c. split copies each piece straight into its string;
+// replace and join size the result first and build it in one buffer.
+
+static bool is_string_arg(Value* args, size_t arg_count, size_t index) {
+    return arg_count > index && args[index].type == VAL_STRING;
+}
+
+// len() and the indexes below count code points in non-ASCII UTF-8 and
+// bytes otherwise. The string's header already records which, along with
+// its code point count, so none of them rescans the string.
+
+// len(s) -> code points; bytes when s is not valid UTF-8
 static Value str_len(Environment* env, Value* args, size_t arg_count) {
     if (arg_count < 1 || args[0].type != VAL_STRING) return value_number(0);
-    return value_number((double)strlen(args[0].as.string));
+    return value_number((double)string_char_count(args[0].as.string));
 }
 
 static Value str_upper(Environment* env, Value* args, size_t arg_count) {
     if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
-    char* s = strdup(args[0].as.string);
-    for (char* p = s; *p; ++p) *p = (char)toupper((unsigned char)*p);
+    size_t len = strlen(args[0].as.string);
+    char* s = malloc(len + 1);
+    if (!s) return value_null();
+    str_upper_ascii(s, args[0].as.string, len + 1);
     Value v = value_string(s);
     free(s);
     return v;
@@ -19,8 +35,10 @@ static Value str_upper(Environment* env, Value* args, size_t arg_count) {
 
 static Value str_lower(Environment* env, Value* args, size_t arg_count) {
     if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
-    char* s = strdup(args[0].as.string);
-    for (char* p = s; *p; ++p) *p = (char)tolower((unsigned char)*p);
+    size_t len = strlen(args[0].as.string);
+    char* s = malloc(len + 1);
+    if (!s) return value_null();
+    str_lower_ascii(s, args[0].as.string, len + 1);
     Value v = value_string(s);
     free(s);
     return v;
@@ -37,10 +55,185 @@ static Value str_concat(Environment* env, Value* args, size_t arg_count) {
     return v;
 }
 
+// find(s, sub, start?) -> index or -1; start and the index count like len()
+static Value str_find_fn(Environment* env, Value* args, size_t arg_count) {
+    if (!is_string_arg(args, arg_count, 0) || !is_string_arg(args, arg_count, 1)) return value_number(-1);
+    const char* s = args[0].as.string;
+    size_t len = strlen(s);
+    size_t start = 0;
+    if (arg_count > 2 && args[2].type == VAL_NUMBER && args[2].as.number > 0) start = (size_t)args[2].as.number;
+    if (start > string_char_count(s)) return value_number(-1);
+    size_t from = string_char_offset(s, start);
+    if (from > len) return value_number(-1);
+
+    size_t hit = str_find(s + from, len - from, args[1].as.string, strlen(args[1].as.string));
+    if (hit == STR_NPOS) return value_number(-1);
+    return value_number((double)string_char_index(s, from + hit));
+}
+
+// rfind(s, sub) -> index of the last occurrence or -1, counted like len()
+static Value str_rfind_fn(Environment* env, Value* args, size_t arg_count) {
+    if (!is_string_arg(args, arg_count, 0) || !is_string_arg(args, arg_count, 1)) return value_number(-1);
+    const char* s = args[0].as.string;
+    size_t len = strlen(s);
+    size_t hit = str_rfind(s, len, args[1].as.string, strlen(args[1].as.string));
+    if (hit == STR_NPOS) return value_number(-1);
+    return value_number((double)string_char_index(s, hit));
+}
+
+// count(s, sub) -> non-overlapping occurrences
+static Value str_count_fn(Environment* env, Value* args, size_t arg_count) {
+    if (!is_string_arg(args, arg_count, 0) || !is_string_arg(args, arg_count, 1)) return value_number(0);
+    const char* s = args[0].as.string;
+    return value_number((double)str_count(s, strlen(s), args[1].as.string, strlen(args[1].as.string)));
+}
+
+static Value str_startswith(Environment* env, Value* args, size_t arg_count) {
+    if (!is_string_arg(args, arg_count, 0) || !is_string_arg(args, arg_count, 1)) return value_bool(false);
+    size_t n = strlen(args[1].as.string);
+    return value_bool(strncmp(args[0].as.string, args[1].as.string, n) == 0);
+}
+
+static Value str_endswith(Environment* env, Value* args, size_t arg_count) {
+    if (!is_string_arg(args, arg_count, 0) || !is_string_arg(args, arg_count, 1)) return value_bool(false);
+    size_t len = strlen(args[0].as.string), n = strlen(args[1].as.string);
+    return value_bool(n <= len && memcmp(args[0].as.string + len - n, args[1].as.string, n) == 0);
+}
+
+static Value str_strip(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
+    const char* s = args[0].as.string;
+    size_t start, end;
+    str_trim_bounds(s, strlen(s), &start, &end);
+    return value_string_len(s + start, end - start);
+}
+
+// Whitespace split: runs of whitespace separate, leading/trailing ignored
+static Value split_whitespace(const char* s, size_t len) {
+    Value list = value_list();
+    size_t pos = 0;
+    while (pos < len) {
+        size_t start, end;
+        str_trim_bounds(s + pos, len - pos, &start, &end);
+        if (start == end) break;
+        size_t word = pos + start, stop = word;
+        while (stop < pos + end && !isspace((unsigned char)s[stop])) stop++;
+        list_append(&list, value_string_len(s + word, stop - word));
+        pos = stop;
+    }
+    return list;
+}
+
+// split(s, sep?, maxsplit?) -> list; without sep, splits on whitespace
+static Value str_split(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
+    const char* s = args[0].as.string;
+    size_t len = strlen(s);
+    if (!is_string_arg(args, arg_count, 1)) return split_whitespace(s, len);
+
+    const char* sep = args[1].as.string;
+    size_t sep_len = strlen(sep);
+    if (sep_len == 0) return value_null();
+
+    size_t pieces = str_count(s, len, sep, sep_len) + 1;
+    if (arg_count > 2 && args[2].type == VAL_NUMBER && args[2].as.number >= 0 &&
+        (size_t)args[2].as.number + 1 < pieces) {
+        pieces = (size_t)args[2].as.number + 1;
+    }
+
+    Value list = value_list();
+    size_t pos = 0;
+    for (size_t i = 0; i < pieces; i++) {
+        size_t hit = i + 1 < pieces ? str_find(s + pos, len - pos, sep, sep_len) : len - pos;
+        list_append(&list, value_string_len(s + pos, hit));
+        pos += hit + sep_len;
+    }
+    return list;
+}
+
+// replace(s, old, new, count?) -> string with (up to count) occurrences replaced
+static Value str_replace(Environment* env, Value* args, size_t arg_count) {
+    if (!is_string_arg(args, arg_count, 0) || !is_string_arg(args, arg_count, 1) ||
+        !is_string_arg(args, arg_count, 2)) return value_null();
+    const char* s = args[0].as.string;
+    const char* old = args[1].as.string;
+    const char* rep = args[2].as.string;
+    size_t len = strlen(s), old_len = strlen(old), rep_len = strlen(rep);
+    if (old_len == 0) return value_string_len(s, len);
+
+    size_t hits = str_count(s, len, old, old_len);
+    if (arg_count > 3 && args[3].type == VAL_NUMBER && args[3].as.number >= 0 &&
+        (size_t)args[3].as.number < hits) {
+        hits = (size_t)args[3].as.number;
+    }
+    if (hits == 0) return value_string_len(s, len);
+
+    char* result = malloc(len - hits * old_len + hits * rep_len + 1);
+    if (!result) return value_null();
+    size_t pos = 0, out = 0;
+    for (size_t i = 0; i < hits; i++) {
+        size_t hit = str_find(s + pos, len - pos, old, old_len);
+        memcpy(result + out, s + pos, hit);
+        out += hit;
+        memcpy(result + out, rep, rep_len);
+        out += rep_len;
+        pos += hit + old_len;
+    }
+    memcpy(result + out, s + pos, len - pos);
+    result[out + len - pos] = '\0';
+    Value v = value_string(result);
+    free(result);
+    return v;
+}
+
+// join(sep, parts...) -> parts joined with sep (non-string parts are skipped)
+static Value str_join(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_null();
+    const char* sep = args[0].as.string;
+    size_t sep_len = strlen(sep);
+
+    size_t total = 0, parts = 0;
+    for (size_t i = 1; i < arg_count; i++) {
+        if (args[i].type != VAL_STRING) continue;
+        total += strlen(args[i].as.string);
+        parts++;
+    }
+    if (parts > 1) total += (parts - 1) * sep_len;
+
+    char* result = malloc(total + 1);
+    if (!result) return value_null();
+    size_t out = 0;
+    bool first = true;
+    for (size_t i = 1; i < arg_count; i++) {
+        if (args[i].type != VAL_STRING) continue;
+        if (!first) {
+            memcpy(result + out, sep, sep_len);
+            out += sep_len;
+        }
+        size_t n = strlen(args[i].as.string);
+        memcpy(result + out, args[i].as.string, n);
+        out += n;
+        first = false;
+    }
+    result[out] = '\0';
+    Value v = value_string(result);
+    free(result);
+    return v;
+}
+
 void register_mod_string(ModuleSystem* ms) {
     Module* m = module_system_load(ms, "string");
     module_register_native_function(m, "len", str_len);
     module_register_native_function(m, "upper", str_upper);
     module_register_native_function(m, "lower", str_lower);
     module_register_native_function(m, "concat", str_concat);
+    module_register_native_function(m, "find", str_find_fn);
+    module_register_native_function(m, "rfind", str_rfind_fn);
+    module_register_native_function(m, "count", str_count_fn);
+    module_register_native_function(m, "split", str_split);
+    module_register_native_function(m, "replace", str_replace);
+    module_register_native_function(m, "startswith", str_startswith);
+    module_register_native_function(m, "endswith", str_endswith);
+    module_register_native_function(m, "strip", str_strip);
+    module_register_native_function(m, "join", str_join);
 }
@@ -0,0 +1,288 @@
+#include "../src/module.h"
+#include "../src/table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Columnar tables for scripts. Tables live in native memory and scripts
+// hold them by handle (a positive number); every operation returns a new
+// table and leaves its input alone, and table.free(t) releases one. Column
+// arguments are names. Errors return -1 (handles and counts) or null.
+
+#define MAX_TABLES 1024
+
+static Table* g_tables[MAX_TABLES];
+
+static Value handle_value(Table* table) {
+    if (!table) return value_number(-1);
+    for (int i = 0; i < MAX_TABLES; i++) {
+        if (!g_tables[i]) {
+            g_tables[i] = table;
+            return value_number(i + 1);
+        }
+    }
+    table_free(table);
+    return value_number(-1);
+}
+
+static Table* table_arg(Value* args, size_t arg_count, size_t i) {
+    if (i >= arg_count || args[i].type != VAL_NUMBER) return NULL;
+    double handle = args[i].as.number;
+    if (!(handle >= 1 && handle <= MAX_TABLES)) return NULL;
+    return g_tables[(int)handle - 1];
+}
+
+// Column index for the name in args[i], or -1
+static int column_arg(const Table* table, Value* args, size_t arg_count, size_t i) {
+    if (!table || i >= arg_count || args[i].type != VAL_STRING) return -1;
+    return table_column_index(table, args[i].as.string);
+}
+
+static char delimiter_arg(Value* args, size_t arg_count, size_t i) {
+    if (i < arg_count && args[i].type == VAL_STRING && args[i].as.string[0]) return args[i].as.string[0];
+    return ',';
+}
+
+// ========== INPUT / OUTPUT ==========
+
+// read_csv(path, delimiter?) -> table
+static Value table_read_csv_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_number(-1);
+    return handle_value(table_read_csv(args[0].as.string, delimiter_arg(args, arg_count, 1)));
+}
+
+// read_ndjson(path) -> table
+static Value table_read_ndjson_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    if (arg_count < 1 || args[0].type != VAL_STRING) return value_number(-1);
+    return handle_value(table_read_ndjson(args[0].as.string));
+}
+
+// write_csv(t, path, delimiter?) -> bool
+static Value table_write_csv_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    Table* table = table_arg(args, arg_count, 0);
+    if (!table || arg_count < 2 || args[1].type != VAL_STRING) return value_bool(false);
+    return value_bool(table_write_csv(table, args[1].as.string, delimiter_arg(args, arg_count, 2)));
+}
+
+// free(t) -> bool
+static Value table_free_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    Table* table = table_arg(args, arg_count, 0);
+    if (!table) return value_bool(false);
+    table_free(table);
+    g_tables[(int)args[0].as.number - 1] = NULL;
+    return value_bool(true);
+}
+
+// ========== INSPECTION ==========
+
+// rows(t) -> number
+static Value table_rows_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    Table* table = table_arg(args, arg_count, 0);
+    return value_number(table ? (double)table->rows : -1);
+}
+
+// columns(t) -> list of column names
+static Value table_columns_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    Table* table = table_arg(args, arg_count, 0);
+    if (!table) return value_null();
+    Value names = value_list();
+    for (size_t i = 0; i < table->column_count; i++) list_append(&names, value_string(table->columns[i].name));
+    return names;
+}
+
+// get(t, column, row) -> number or string
+static Value table_get_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    Table* table = table_arg(args, arg_count, 0);
+    int column = column_arg(table, args, arg_count, 1);
+    if (column < 0 || arg_count < 3 || args[2].type != VAL_NUMBER) return value_null();
+    double row = args[2].as.number;
+    if (!(row >= 0 && row < (double)table->rows)) return value_null();
+    if (table->columns[column].type == TABLE_STRING) {
+        return value_string(table_get_string(table, (size_t)column, (size_t)row));
+    }
+    return value_number(table_get_number(table, (size_t)column, (size_t)row));
+}
+
+// ========== OPERATORS ==========
+
+static bool parse_op(const char* text, TableOp* op) {
+    static const struct { const char* text; TableOp op; } ops[] = {
+        { "==", TABLE_EQ }, { "!=", TABLE_NE }, { "<", TABLE_LT },
+        { "<=", TABLE_LE }, { ">", TABLE_GT }, { ">=", TABLE_GE }
+    };
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        if (strcmp(text, ops[i].text) == 0) {
+            *op = ops[i].op;
+            return true;
+        }
+    }
+    return false;
+}
+
+// filter(t, column, op, value, column, op, value, ...) -> table of the
+// rows matching every predicate. Each predicate narrows the previous
+// one's selection, so only the surviving rows are gathered.
+static Value table_filter_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    Table* table = table_arg(args, arg_count, 0);
+    if (!table || arg_count < 4 || (arg_count - 1) % 3 != 0) return value_number(-1);
+
+    Selection selection = { NULL, 0 };
+    bool first = true;
+    for (size_t i = 1; i < arg_count; i += 3) {
+        int column = column_arg(table, args, arg_count, i);
+        TableOp op;
+        if (column < 0 || args[i + 1].type != VAL_STRING || !parse_op(args[i + 1].as.string, &op)) {
+            selection_free(&selection);
+            return value_number(-1);
+        }
+        TableScalar value = { false, 0, NULL };
+        if (args[i + 2].type == VAL_STRING) {
+            value.is_string = true;
+            value.string = args[i + 2].as.string;
+        } else if (args[i + 2].type == VAL_NUMBER) {
+            value.number = args[i + 2].as.number;
+        } else {
+            selection_free(&selection);
+            return value_number(-1);
+        }
+        Selection narrowed;
+        bool ok = table_filter(table, (size_t)column, op, value, first ? NULL : &selection, &narrowed);
+        selection_free(&selection);
+        if (!ok) return value_number(-1);
+        selection = narrowed;
+        first = false;
+    }
+    Table* result = table_take(table, &selection);
+    selection_free(&selection);
+    return handle_value(result);
+}
+
+// sort(t, column, order?) -> table; order is "asc" (default) or "desc"
+static Value table_sort_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    Table* table = table_arg(args, arg_count, 0);
+    int column = column_arg(table, args, arg_count, 1);
+    if (column < 0) return value_number(-1);
+    bool descending = arg_count > 2 && args[2].type == VAL_STRING && strcmp(args[2].as.string, "desc") == 0;
+    return handle_value(table_sort(table, (size_t)column, descending));
+}
+
+// Aggregate specs: "count", or "sum:col", "mean:col", "min:col", "max:col"
+static bool parse_agg(const Table* table, const char* spec, TableAggSpec* out) {
+    static const struct { const char* prefix; TableAgg agg; } aggs[] = {
+        { "sum:", TABLE_SUM }, { "mean:", TABLE_MEAN }, { "min:", TABLE_MIN }, { "max:", TABLE_MAX }
+    };
+    out->column = 0;
+    if (strcmp(spec, "count") == 0) {
+        out->agg = TABLE_COUNT;
+        return true;
+    }
+    for (size_t i = 0; i < sizeof(aggs) / sizeof(aggs[0]); i++) {
+        size_t length = strlen(aggs[i].prefix);
+        if (strncmp(spec, aggs[i].prefix, length) == 0) {
+            int column = table_column_index(table, spec + length);
+            if (column < 0) return false;
+            out->agg = aggs[i].agg;
+            out->column = (size_t)column;
+            return true;
+        }
+    }
+    return false;
+}
+
+// group_by(t, key, spec...) -> table with the key column and one column per
+// spec ("sum_price", "count", ...), groups in order of first appearance
+static Value table_group_by_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    Table* table = table_arg(args, arg_count, 0);
+    int key = column_arg(table, args, arg_count, 1);
+    if (key < 0) return value_number(-1);
+    size_t spec_count = arg_count - 2;
+    TableAggSpec* specs = malloc(sizeof(TableAggSpec) * (spec_count ? spec_count : 1));
+    if (!specs) return value_number(-1);
+    for (size_t i = 0; i < spec_count; i++) {
+        if (args[i + 2].type != VAL_STRING || !parse_agg(table, args[i + 2].as.string, &specs[i])) {
+            free(specs);
+            return value_number(-1);
+        }
+    }
+    Value result = handle_value(table_group_by(table, (size_t)key, specs, spec_count));
+    free(specs);
+    return result;
+}
+
+// join(left, right, column, right_column?) -> inner join on equal keys
+static Value table_join_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    Table* left = table_arg(args, arg_count, 0);
+    Table* right = table_arg(args, arg_count, 1);
+    int left_key = column_arg(left, args, arg_count, 2);
+    int right_key = column_arg(right, args, arg_count, arg_count > 3 ? 3 : 2);
+    if (left_key < 0 || right_key < 0) return value_number(-1);
+    return handle_value(table_join(left, (size_t)left_key, right, (size_t)right_key));
+}
+
+// ========== AGGREGATES ==========
+
+static Value aggregate(Value* args, size_t arg_count, TableAgg agg) {
+    Table* table = table_arg(args, arg_count, 0);
+    if (!table) return value_null();
+    if (agg == TABLE_COUNT) return value_number((double)table->rows);
+    int column = column_arg(table, args, arg_count, 1);
+    if (column < 0) return value_null();
+    return value_number(table_aggregate(table, (size_t)column, agg, NULL));
+}
+
+// sum/mean/min/max(t, column) -> number (NaN if no values); count(t)
+static Value table_sum_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    return aggregate(args, arg_count, TABLE_SUM);
+}
+
+static Value table_mean_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    return aggregate(args, arg_count, TABLE_MEAN);
+}
+
+static Value table_min_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    return aggregate(args, arg_count, TABLE_MIN);
+}
+
+static Value table_max_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    return aggregate(args, arg_count, TABLE_MAX);
+}
+
+static Value table_count_fn(Environment* env, Value* args, size_t arg_count) {
+    (void)env;
+    return aggregate(args, arg_count, TABLE_COUNT);
+}
+
+void register_table_module(ModuleSystem* ms) {
+    Module* m = module_system_load(ms, "table");
+    module_register_native_function(m, "read_csv", table_read_csv_fn);
+    module_register_native_function(m, "read_ndjson", table_read_ndjson_fn);
+    module_register_native_function(m, "write_csv", table_write_csv_fn);
+    module_register_native_function(m, "free", table_free_fn);
+    module_register_native_function(m, "rows", table_rows_fn);
+    module_register_native_function(m, "columns", table_columns_fn);
+    module_register_native_function(m, "get", table_get_fn);
+    module_register_native_function(m, "filter", table_filter_fn);
+    module_register_native_function(m, "sort", table_sort_fn);
+    module_register_native_function(m, "group_by", table_group_by_fn);
+    module_register_native_function(m, "join", table_join_fn);
+    module_register_native_function(m, "sum", table_sum_fn);
+    module_register_native_function(m, "mean", table_mean_fn);
+    module_register_native_function(m, "min", table_min_fn);
+    module_register_native_function(m, "max", table_max_fn);
+    module_register_native_function(m, "count", table_count_fn);
+}
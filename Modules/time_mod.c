@@ -1,8 +1,76 @@
+#ifndef _WIN32
+#define _XOPEN_SOURCE 700   // strptime, localtime_r and clock_gettime under -std=c99
+#endif
+
 #include "../src/module.h"
+#include "../src/event_loop.h"
 #include <time.h>
 #include <sys/time.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+
+// The *_ns clocks read clock_gettime, which Linux serves from the vDSO
+// without entering the kernel. They count from when the module was
+// registered, so nanosecond values stay exact in a number for 104 days.
+
+#ifdef CLOCK_MONOTONIC_RAW
+#define PERF_CLOCK CLOCK_MONOTONIC_RAW          // not slewed by NTP
+#else
+#define PERF_CLOCK CLOCK_MONOTONIC
+#endif
+
+#ifdef CLOCK_MONOTONIC_COARSE
+#define COARSE_CLOCK CLOCK_MONOTONIC_COARSE     // the last tick, a few ns to read
+#define COARSE_WALL_CLOCK CLOCK_REALTIME_COARSE
+#else
+#define COARSE_CLOCK CLOCK_MONOTONIC
+#define COARSE_WALL_CLOCK CLOCK_REALTIME
+#endif
+
+static uint64_t g_monotonic_base;
+static uint64_t g_perf_base;
+
+static uint64_t clock_ns(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Local time of one second in one format, reused until either changes:
+// a logger stamping every line runs strftime once a second
+typedef struct {
+    time_t second;
+    bool valid;
+    char format[64];
+    char text[256];
+} TimeCache;
+
+#ifdef _MSC_VER
+#define TIME_THREAD_LOCAL __declspec(thread)
+#else
+#define TIME_THREAD_LOCAL __thread
+#endif
+
+// One cache per thread, so threads formatting at once never share it; the
+// text it hands out is copied into a string before that thread's next
+// format can overwrite it
+static TIME_THREAD_LOCAL TimeCache g_time_cache;
+
+static const char* format_cached(time_t second, const char* format) {
+    TimeCache* c = &g_time_cache;
+    size_t length = strlen(format);
+    if (c->valid && c->second == second && strcmp(c->format, format) == 0) return c->text;
+    struct tm tm_info;
+    if (!localtime_r(&second, &tm_info) || strftime(c->text, sizeof(c->text), format, &tm_info) == 0) {
+        c->text[0] = '\0';
+    }
+    c->second = second;
+    c->valid = length < sizeof(c->format);
+    if (c->valid) memcpy(c->format, format, length + 1);
+    return c->text;
+}
 
 static Value time_now(Environment* env, Value* args, size_t arg_count) {
     return value_number((double)time(NULL));
@@ -14,15 +82,38 @@ static Value time_now_ms(Environment* env, Value* args, size_t arg_count) {
     return value_number((double)(tv.tv_sec * 1000 + tv.tv_usec / 1000));
 }
 
+static void time_sleep_done(void* data) {
+    *(bool*)data = true;
+}
+
+// sleep(seconds): while the event loop has sockets, timers or I/O
+// registered (an http or net server), keeps running it until the time is
+// up so their callbacks are not held up; otherwise, or when called from
+// one of those callbacks, blocks the thread
 static Value time_sleep(Environment* env, Value* args, size_t arg_count) {
     if (arg_count < 1 || args[0].type != VAL_NUMBER) return value_null();
-    
+
     double seconds = args[0].as.number;
-    struct timespec ts;
-    ts.tv_sec = (time_t)seconds;
-    ts.tv_nsec = (long)((seconds - ts.tv_sec) * 1000000000);
-    
-    nanosleep(&ts, NULL);
+    if (!(seconds > 0)) return value_null();
+    uint64_t deadline = clock_ns(CLOCK_MONOTONIC) + (uint64_t)(seconds * 1e9);
+
+    EventLoop* loop = global_event_loop;
+    if (loop && event_loop_has_pending(loop) && !event_loop_is_dispatching(loop)) {
+        bool done = false;
+        event_loop_add_timer(loop, (uint64_t)(seconds * 1000), time_sleep_done, &done);
+        while (!done) event_loop_run_once(loop);
+    }
+
+    // The whole sleep, or what is left below the loop's millisecond timers
+    for (;;) {
+        uint64_t now = clock_ns(CLOCK_MONOTONIC);
+        if (now >= deadline) break;
+        uint64_t left = deadline - now;
+        struct timespec ts;
+        ts.tv_sec = (time_t)(left / 1000000000ull);
+        ts.tv_nsec = (long)(left % 1000000000ull);
+        if (nanosleep(&ts, NULL) == 0 || errno != EINTR) break;
+    }
     return value_null();
 }
 
@@ -36,11 +127,32 @@ static Value time_format(Environment* env, Value* args, size_t arg_count) {
         format = args[1].as.string;
     }
     
-    struct tm* tm_info = localtime(&timestamp);
-    char buffer[256];
-    strftime(buffer, sizeof(buffer), format, tm_info);
-    
-    return value_string(buffer);
+    return value_string(format_cached(timestamp, format));
+}
+
+// timestamp(format?) -> the current local time formatted, at most once a second
+static Value time_timestamp(Environment* env, Value* args, size_t arg_count) {
+    const char* format = "%Y-%m-%d %H:%M:%S";
+    if (arg_count >= 1 && args[0].type == VAL_STRING) {
+        format = args[0].as.string;
+    }
+    return value_string(format_cached((time_t)(clock_ns(COARSE_WALL_CLOCK) / 1000000000ull), format));
+}
+
+// monotonic_ns() -> nanoseconds on a clock that never goes back
+static Value time_monotonic_ns(Environment* env, Value* args, size_t arg_count) {
+    return value_number((double)(clock_ns(CLOCK_MONOTONIC) - g_monotonic_base));
+}
+
+// perf_counter_ns() -> nanoseconds for timing code; unaffected by NTP slewing
+static Value time_perf_counter_ns(Environment* env, Value* args, size_t arg_count) {
+    return value_number((double)(clock_ns(PERF_CLOCK) - g_perf_base));
+}
+
+// coarse_ns() -> monotonic_ns as of the last timer tick (1-4 ms resolution),
+// several times cheaper to read; for stamping hot paths
+static Value time_coarse_ns(Environment* env, Value* args, size_t arg_count) {
+    return value_number((double)(clock_ns(COARSE_CLOCK) - g_monotonic_base));
 }
 
 static Value time_parse(Environment* env, Value* args, size_t arg_count) {
@@ -120,6 +232,10 @@ static Value time_second(Environment* env, Value* args, size_t arg_count) {
 }
 
 void register_time_module(ModuleSystem* ms) {
+    // From the coarse clock, which trails the precise one by up to a tick,
+    // so that neither reads negative
+    g_monotonic_base = clock_ns(COARSE_CLOCK);
+    g_perf_base = clock_ns(PERF_CLOCK);
     Module* m = module_system_load(ms, "time");
     module_register_native_function(m, "now", time_now);
     module_register_native_function(m, "now_ms", time_now_ms);
@@ -132,4 +248,8 @@ void register_time_module(ModuleSystem* ms) {
     module_register_native_function(m, "hour", time_hour);
     module_register_native_function(m, "minute", time_minute);
     module_register_native_function(m, "second", time_second);
+    module_register_native_function(m, "timestamp", time_timestamp);
+    module_register_native_function(m, "monotonic_ns", time_monotonic_ns);
+    module_register_native_function(m, "perf_counter_ns", time_perf_counter_ns);
+    module_register_native_function(m, "coarse_ns", time_coarse_ns);
 }
\ No newline at end of file
@@ -3,7 +3,13 @@ echo Building Rubolt Collections Test...
 
 gcc -Wall -Wextra -std=c11 -O2 -c rb_collections.c -o rb_collections.o
 gcc -Wall -Wextra -std=c11 -O2 -c rb_list.c -o rb_list.o
-gcc -Wall -Wextra -std=c11 -O2 test_collections.c rb_collections.o rb_list.o -o test_collections.exe
+gcc -Wall -Wextra -std=c11 -O2 -c rb_sort.c -o rb_sort.o
+gcc -Wall -Wextra -std=c11 -O2 -c rb_deque.c -o rb_deque.o
+gcc -Wall -Wextra -std=c11 -O2 -c rb_heap.c -o rb_heap.o
+gcc -Wall -Wextra -std=c11 -O2 -c rb_sorted_set.c -o rb_sorted_set.o
+gcc -Wall -Wextra -std=c11 -O2 -c rb_pvector.c -o rb_pvector.o
+gcc -Wall -Wextra -std=c11 -O2 -c rb_pmap.c -o rb_pmap.o
+gcc -Wall -Wextra -std=c11 -O2 test_collections.c rb_collections.o rb_list.o rb_sort.o rb_deque.o rb_heap.o rb_sorted_set.o rb_pvector.o rb_pmap.o -o test_collections.exe
 
 if %ERRORLEVEL% NEQ 0 (
     echo Build failed!
@@ -17,5 +23,8 @@ echo   - Dynamic arrays with automatic resizing
 echo   - Negative indexing (list[-1])
 echo   - Slicing (list[start:end:step])
 echo   - append, insert, pop, remove
-echo   - sort, reverse, extend, copy
+echo   - sort (radix/multikey/pdqsort), stable sort, sort by key
+echo   - reverse, extend, copy
 echo   - index, count, contains
+echo   - deque, 4-ary heap with handles, B-tree sorted set
+echo   - persistent vector and HAMT map with builders
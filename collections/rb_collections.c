@@ -2,6 +2,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
+
+/* strdup is POSIX, not ISO C; the library builds with plain -std=c11 */
+static char *copy_string(const char *s) {
+    size_t size = strlen(s) + 1;
+    char *copy = malloc(size);
+    if (copy) memcpy(copy, s, size);
+    return copy;
+}
 
 /* ========== VALUE CONSTRUCTORS ========== */
 
@@ -29,7 +38,7 @@ RbValue rb_value_float(double f) {
 RbValue rb_value_string(const char *s) {
     RbValue val;
     val.type = RB_VAL_STRING;
-    val.data.s = s ? strdup(s) : NULL;
+    val.data.s = s ? copy_string(s) : NULL;
     return val;
 }
 
@@ -49,38 +58,166 @@ RbValue rb_value_ptr(void *ptr) {
 
 /* ========== HASH FUNCTIONS ========== */
 
-/* FNV-1a hash constants */
-#define FNV_OFFSET_BASIS 14695981039346656037UL
-#define FNV_PRIME 1099511628211UL
+/* wyhash-style keyed hashing: 64x64->128 multiply-fold mixing, 48 bytes per
+ * round for long inputs. The seed is random per process (or taken from
+ * RUBOLT_HASH_SEED), so colliding keys cannot be precomputed offline. */
+
+static const uint64_t HASH_SECRET[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+/* 0 means "not chosen yet"; a chosen seed of 0 is replaced by 1 */
+static uint64_t hash_seed = 0;
+
+static inline void hash_mum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+    hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t read64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint64_t random_seed(void) {
+    const char *env = getenv("RUBOLT_HASH_SEED");
+    if (env && *env) return strtoull(env, NULL, 0);
+
+    uint64_t seed = 0;
+#ifndef _WIN32
+    FILE *urandom = fopen("/dev/urandom", "rb");
+    if (urandom) {
+        if (fread(&seed, sizeof(seed), 1, urandom) != 1) seed = 0;
+        fclose(urandom);
+    }
+#endif
+    if (seed == 0) {
+        /* No entropy source: fall back to clock and ASLR-dependent addresses */
+        int local;
+        seed = hash_mix((uint64_t)time(NULL) ^ HASH_SECRET[0],
+                        (uint64_t)clock() ^ (uint64_t)(uintptr_t)&local ^
+                        ((uint64_t)(uintptr_t)&hash_seed << 16));
+    }
+    return seed;
+}
+
+uint64_t rb_hash_seed(void) {
+    uint64_t seed = __atomic_load_n(&hash_seed, __ATOMIC_ACQUIRE);
+    if (seed) return seed;
+    uint64_t chosen = random_seed();
+    if (chosen == 0) chosen = 1;
+    /* If another thread got there first, everyone uses its seed */
+    if (!__atomic_compare_exchange_n(&hash_seed, &seed, chosen, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return seed;
+    }
+    return chosen;
+}
+
+static uint32_t hash_epoch = 1;
+
+void rb_hash_set_seed(uint64_t seed) {
+    __atomic_store_n(&hash_seed, seed ? seed : 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&hash_epoch, 1, __ATOMIC_ACQ_REL);
+}
+
+uint32_t rb_hash_epoch(void) {
+    return __atomic_load_n(&hash_epoch, __ATOMIC_ACQUIRE);
+}
+
+uint64_t rb_hash_bytes(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint64_t seed = rb_hash_seed();
+    seed ^= hash_mix(seed ^ HASH_SECRET[0], HASH_SECRET[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t mid = (len >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + mid);
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = hash_mix(read64(p) ^ HASH_SECRET[1], read64(p + 8) ^ seed);
+                see1 = hash_mix(read64(p + 16) ^ HASH_SECRET[2], read64(p + 24) ^ see1);
+                see2 = hash_mix(read64(p + 32) ^ HASH_SECRET[3], read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = hash_mix(read64(p) ^ HASH_SECRET[1], read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+    a ^= HASH_SECRET[1];
+    b ^= seed;
+    hash_mum(&a, &b);
+    return hash_mix(a ^ HASH_SECRET[0] ^ len, b ^ HASH_SECRET[1]);
+}
 
 uint64_t rb_hash_string(const char *str) {
     if (!str) return 0;
-    
-    uint64_t hash = FNV_OFFSET_BASIS;
-    while (*str) {
-        hash ^= (uint64_t)(unsigned char)(*str++);
-        hash *= FNV_PRIME;
-    }
-    return hash;
+    return rb_hash_bytes(str, strlen(str));
+}
+
+/* One 64-bit word, keyed: two multiply-fold rounds */
+static inline uint64_t hash_word(uint64_t x, uint64_t salt) {
+    uint64_t a = x ^ HASH_SECRET[0], b = rb_hash_seed() ^ salt ^ HASH_SECRET[1];
+    hash_mum(&a, &b);
+    return hash_mix(a ^ HASH_SECRET[0], b ^ HASH_SECRET[1]);
 }
 
 uint64_t rb_hash_int(int64_t i) {
-    /* Mix the bits */
-    uint64_t x = (uint64_t)i;
-    x = ((x >> 32) ^ x) * 0x45d9f3b3335b369dULL;
-    x = ((x >> 32) ^ x) * 0x3335b36945d9f3b3ULL;
-    x = (x >> 32) ^ x;
-    return x;
+    return hash_word((uint64_t)i, HASH_SECRET[2]);
 }
 
 uint64_t rb_hash_float(double f) {
+    /* 0.0 == -0.0, so both must hash alike */
+    if (f == 0.0) f = 0.0;
     uint64_t bits;
     memcpy(&bits, &f, sizeof(double));
-    return rb_hash_int((int64_t)bits);
+    return hash_word(bits, HASH_SECRET[3]);
 }
 
 uint64_t rb_hash_ptr(const void *ptr) {
-    return rb_hash_int((int64_t)(uintptr_t)ptr);
+    return hash_word((uint64_t)(uintptr_t)ptr, HASH_SECRET[2] ^ HASH_SECRET[3]);
 }
 
 /* ========== VALUE OPERATIONS ========== */
@@ -88,7 +225,7 @@ uint64_t rb_hash_ptr(const void *ptr) {
 uint64_t rb_value_hash(RbValue val) {
     switch (val.type) {
         case RB_VAL_NULL:
-            return 0;
+            return hash_word(0, HASH_SECRET[0]);
         case RB_VAL_INT:
             return rb_hash_int(val.data.i);
         case RB_VAL_FLOAT:
@@ -96,7 +233,7 @@ uint64_t rb_value_hash(RbValue val) {
         case RB_VAL_STRING:
             return rb_hash_string(val.data.s);
         case RB_VAL_BOOL:
-            return val.data.b ? 1 : 0;
+            return hash_word(val.data.b ? 1 : 0, HASH_SECRET[1]);
         case RB_VAL_PTR:
             return rb_hash_ptr(val.data.ptr);
         default:
@@ -145,22 +282,22 @@ char *rb_value_to_string(RbValue val) {
     
     switch (val.type) {
         case RB_VAL_NULL:
-            return strdup("None");
+            return copy_string("None");
         case RB_VAL_INT:
             snprintf(buffer, sizeof(buffer), "%lld", (long long)val.data.i);
-            return strdup(buffer);
+            return copy_string(buffer);
         case RB_VAL_FLOAT:
             snprintf(buffer, sizeof(buffer), "%.6f", val.data.f);
-            return strdup(buffer);
+            return copy_string(buffer);
         case RB_VAL_STRING:
-            return val.data.s ? strdup(val.data.s) : strdup("None");
+            return val.data.s ? copy_string(val.data.s) : copy_string("None");
         case RB_VAL_BOOL:
-            return strdup(val.data.b ? "True" : "False");
+            return copy_string(val.data.b ? "True" : "False");
         case RB_VAL_PTR:
             snprintf(buffer, sizeof(buffer), "<ptr %p>", val.data.ptr);
-            return strdup(buffer);
+            return copy_string(buffer);
         default:
-            return strdup("<unknown>");
+            return copy_string("<unknown>");
     }
 }
 
@@ -59,7 +59,15 @@ void rb_value_print(RbValue val);
 
 /* ========== HASH FUNCTIONS ========== */
 
-/* FNV-1a hash for strings */
+/* Keyed wyhash-style hashes. The key is a per-process random seed (read
+ * from RUBOLT_HASH_SEED if set), so hash values differ between runs and
+ * must never be persisted. Equal values always hash alike, including 0.0
+ * and -0.0. */
+
+/* Hash an arbitrary byte range */
+uint64_t rb_hash_bytes(const void *data, size_t len);
+
+/* Hash a NUL-terminated string (0 for NULL) */
 uint64_t rb_hash_string(const char *str);
 
 /* Hash for integers */
@@ -71,6 +79,17 @@ uint64_t rb_hash_float(double f);
 /* Hash for pointers */
 uint64_t rb_hash_ptr(const void *ptr);
 
+/* The process hash seed, chosen on first use */
+uint64_t rb_hash_seed(void);
+
+/* Replace the seed (tests and benchmarks). Every hash computed before the
+ * call is invalidated, so existing tables must be rebuilt */
+void rb_hash_set_seed(uint64_t seed);
+
+/* Bumped by every rb_hash_set_seed, starting at 1: a hash cached together
+ * with the epoch it was computed in is valid while the two still match */
+uint32_t rb_hash_epoch(void);
+
 /* ========== COMPARISON FUNCTIONS ========== */
 
 typedef int (*RbCompareFn)(const void *a, const void *b);
@@ -0,0 +1,137 @@
+#include "rb_deque.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY 8
+
+/* ========== HELPERS ========== */
+
+static inline size_t slot(const RbDeque *deque, size_t index) {
+    return (deque->head + index) & (deque->capacity - 1);
+}
+
+/* Double the buffer, unwrapping the ring so the front lands at index 0 */
+static bool grow(RbDeque *deque, size_t min_capacity) {
+    if (deque->capacity >= min_capacity) return true;
+    size_t capacity = deque->capacity ? deque->capacity : INITIAL_CAPACITY;
+    while (capacity < min_capacity) capacity *= 2;
+
+    RbValue *items = malloc(sizeof(RbValue) * capacity);
+    if (!items) return false;
+    if (deque->size > 0) {
+        size_t first = deque->capacity - deque->head;
+        if (first > deque->size) first = deque->size;
+        memcpy(items, deque->items + deque->head, sizeof(RbValue) * first);
+        memcpy(items + first, deque->items, sizeof(RbValue) * (deque->size - first));
+    }
+    free(deque->items);
+    deque->items = items;
+    deque->head = 0;
+    deque->capacity = capacity;
+    return true;
+}
+
+static bool normalize(const RbDeque *deque, int index, size_t *out) {
+    if (index < 0) index += (int)deque->size;
+    if (index < 0 || (size_t)index >= deque->size) return false;
+    *out = (size_t)index;
+    return true;
+}
+
+/* ========== CREATION & DESTRUCTION ========== */
+
+RbDeque *rb_deque_new(void) {
+    RbDeque *deque = (RbDeque *)malloc(sizeof(RbDeque));
+    if (!deque) return NULL;
+
+    deque->items = NULL;
+    deque->head = 0;
+    deque->size = 0;
+    deque->capacity = 0;
+    return deque;
+}
+
+RbDeque *rb_deque_with_capacity(size_t capacity) {
+    RbDeque *deque = rb_deque_new();
+    if (deque) grow(deque, capacity);
+    return deque;
+}
+
+void rb_deque_free(RbDeque *deque) {
+    if (!deque) return;
+    rb_deque_clear(deque);
+    free(deque->items);
+    free(deque);
+}
+
+void rb_deque_clear(RbDeque *deque) {
+    if (!deque) return;
+    for (size_t i = 0; i < deque->size; i++) {
+        rb_value_free(deque->items[slot(deque, i)]);
+    }
+    deque->head = 0;
+    deque->size = 0;
+}
+
+/* ========== BASIC OPERATIONS ========== */
+
+size_t rb_deque_len(const RbDeque *deque) {
+    return deque ? deque->size : 0;
+}
+
+bool rb_deque_is_empty(const RbDeque *deque) {
+    return rb_deque_len(deque) == 0;
+}
+
+bool rb_deque_push_back(RbDeque *deque, RbValue value) {
+    if (!deque || !grow(deque, deque->size + 1)) return false;
+    deque->items[slot(deque, deque->size)] = rb_value_clone(value);
+    deque->size++;
+    return true;
+}
+
+bool rb_deque_push_front(RbDeque *deque, RbValue value) {
+    if (!deque || !grow(deque, deque->size + 1)) return false;
+    deque->head = (deque->head - 1) & (deque->capacity - 1);
+    deque->items[deque->head] = rb_value_clone(value);
+    deque->size++;
+    return true;
+}
+
+RbValue rb_deque_pop_back(RbDeque *deque) {
+    if (!deque || deque->size == 0) return rb_value_null();
+    deque->size--;
+    return deque->items[slot(deque, deque->size)];
+}
+
+RbValue rb_deque_pop_front(RbDeque *deque) {
+    if (!deque || deque->size == 0) return rb_value_null();
+    RbValue value = deque->items[deque->head];
+    deque->head = (deque->head + 1) & (deque->capacity - 1);
+    deque->size--;
+    return value;
+}
+
+RbValue rb_deque_front(const RbDeque *deque) {
+    if (!deque || deque->size == 0) return rb_value_null();
+    return deque->items[deque->head];
+}
+
+RbValue rb_deque_back(const RbDeque *deque) {
+    if (!deque || deque->size == 0) return rb_value_null();
+    return deque->items[slot(deque, deque->size - 1)];
+}
+
+RbValue rb_deque_get(const RbDeque *deque, int index) {
+    size_t i;
+    if (!deque || !normalize(deque, index, &i)) return rb_value_null();
+    return deque->items[slot(deque, i)];
+}
+
+void rb_deque_set(RbDeque *deque, int index, RbValue value) {
+    size_t i;
+    if (!deque || !normalize(deque, index, &i)) return;
+    RbValue *item = &deque->items[slot(deque, i)];
+    rb_value_free(*item);
+    *item = rb_value_clone(value);
+}
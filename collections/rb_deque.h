@@ -0,0 +1,72 @@
+#ifndef RB_DEQUE_H
+#define RB_DEQUE_H
+
+#include "rb_collections.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Double-ended queue: a growable ring buffer with a power-of-two capacity,
+ * so both ends push and pop in O(1) and indexing is a mask, not a modulo.
+ * Like RbList, pushed values are cloned and popped values are owned by the
+ * caller. */
+typedef struct RbDeque {
+    RbValue *items;
+    size_t head;        /* index of the front element */
+    size_t size;
+    size_t capacity;    /* 0 or a power of two */
+} RbDeque;
+
+/* ========== CREATION & DESTRUCTION ========== */
+
+/* Create a new empty deque */
+RbDeque *rb_deque_new(void);
+
+/* Create a deque with room for at least capacity items */
+RbDeque *rb_deque_with_capacity(size_t capacity);
+
+/* Free a deque and its values */
+void rb_deque_free(RbDeque *deque);
+
+/* Remove all items */
+void rb_deque_clear(RbDeque *deque);
+
+/* ========== BASIC OPERATIONS ========== */
+
+/* Number of items */
+size_t rb_deque_len(const RbDeque *deque);
+
+/* Check if deque is empty */
+bool rb_deque_is_empty(const RbDeque *deque);
+
+/* Add at the back / front; false if out of memory */
+bool rb_deque_push_back(RbDeque *deque, RbValue value);
+bool rb_deque_push_front(RbDeque *deque, RbValue value);
+
+/* Remove and return the back / front item (null if empty) */
+RbValue rb_deque_pop_back(RbDeque *deque);
+RbValue rb_deque_pop_front(RbDeque *deque);
+
+/* Borrow the front / back item (null if empty) */
+RbValue rb_deque_front(const RbDeque *deque);
+RbValue rb_deque_back(const RbDeque *deque);
+
+/* Borrow item at index; negative counts from the back */
+RbValue rb_deque_get(const RbDeque *deque, int index);
+
+/* Replace item at index */
+void rb_deque_set(RbDeque *deque, int index, RbValue value);
+
+/* ========== PYTHON-LIKE METHODS ========== */
+
+/* deque.append(x) / deque.appendleft(x) */
+#define rb_deque_py_append rb_deque_push_back
+#define rb_deque_py_appendleft rb_deque_push_front
+
+/* deque.pop() / deque.popleft() */
+#define rb_deque_py_pop rb_deque_pop_back
+#define rb_deque_py_popleft rb_deque_pop_front
+
+/* len(deque) */
+#define rb_deque_py_len rb_deque_len
+
+#endif /* RB_DEQUE_H */
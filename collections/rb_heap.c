@@ -0,0 +1,206 @@
+#include "rb_heap.h"
+#include "rb_sort.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define ARITY 4
+#define INITIAL_CAPACITY 16
+#define CACHE_LINE 64
+
+/* ========== HELPERS ========== */
+
+static inline bool less(const RbHeap *heap, const RbValue *a, const RbValue *b) {
+    return heap->compare ? heap->compare(a, b) < 0 : rb_compare_values(a, b) < 0;
+}
+
+/* Children of i start at 4i+1, so if &priorities[1] is cache-line aligned
+ * every sibling group fills exactly one line (4 x 16-byte RbValue) */
+static bool grow(RbHeap *heap) {
+    if (heap->size < heap->capacity) return true;
+    size_t capacity = heap->capacity ? heap->capacity * 2 : INITIAL_CAPACITY;
+
+    void *block = malloc(sizeof(RbValue) * capacity + CACHE_LINE);
+    RbHeapEntry *entries = realloc(heap->entries, sizeof(RbHeapEntry) * capacity);
+    if (!block || !entries) {
+        free(block);
+        if (entries) heap->entries = entries;
+        return false;
+    }
+    uintptr_t first = ((uintptr_t)block + sizeof(RbValue) + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1);
+    RbValue *priorities = (RbValue *)(first - sizeof(RbValue));
+    if (heap->size > 0) memcpy(priorities, heap->priorities, sizeof(RbValue) * heap->size);
+
+    free(heap->priority_block);
+    heap->priority_block = block;
+    heap->priorities = priorities;
+    heap->entries = entries;
+    heap->capacity = capacity;
+    return true;
+}
+
+static RbHeapHandle new_handle(RbHeap *heap) {
+    if (heap->free_count > 0) return heap->free_handles[--heap->free_count];
+    if (heap->handle_count == heap->handle_capacity) {
+        size_t capacity = heap->handle_capacity ? heap->handle_capacity * 2 : INITIAL_CAPACITY;
+        size_t *positions = realloc(heap->positions, sizeof(size_t) * capacity);
+        if (!positions) return RB_HEAP_NO_HANDLE;
+        heap->positions = positions;
+        RbHeapHandle *free_handles = realloc(heap->free_handles, sizeof(RbHeapHandle) * capacity);
+        if (!free_handles) return RB_HEAP_NO_HANDLE;
+        heap->free_handles = free_handles;
+        heap->handle_capacity = capacity;
+    }
+    return heap->handle_count++;
+}
+
+static inline void place(RbHeap *heap, size_t index, RbValue priority, RbHeapEntry entry) {
+    heap->priorities[index] = priority;
+    heap->entries[index] = entry;
+    heap->positions[entry.handle] = index;
+}
+
+/* Move the entry at index toward the root until its parent is not larger.
+ * The moving entry is held aside and written once at its final slot. */
+static void sift_up(RbHeap *heap, size_t index) {
+    RbValue priority = heap->priorities[index];
+    RbHeapEntry entry = heap->entries[index];
+    while (index > 0) {
+        size_t parent = (index - 1) / ARITY;
+        if (!less(heap, &priority, &heap->priorities[parent])) break;
+        place(heap, index, heap->priorities[parent], heap->entries[parent]);
+        index = parent;
+    }
+    place(heap, index, priority, entry);
+}
+
+static void sift_down(RbHeap *heap, size_t index) {
+    RbValue priority = heap->priorities[index];
+    RbHeapEntry entry = heap->entries[index];
+    for (;;) {
+        size_t first = index * ARITY + 1;
+        if (first >= heap->size) break;
+        size_t last = first + ARITY < heap->size ? first + ARITY : heap->size;
+        size_t best = first;
+        for (size_t c = first + 1; c < last; c++) {
+            if (less(heap, &heap->priorities[c], &heap->priorities[best])) best = c;
+        }
+        if (!less(heap, &heap->priorities[best], &priority)) break;
+        place(heap, index, heap->priorities[best], heap->entries[best]);
+        index = best;
+    }
+    place(heap, index, priority, entry);
+}
+
+/* Take out the entry at index, refilling the hole with the last entry */
+static void remove_at(RbHeap *heap, size_t index, RbValue *priority, RbValue *value) {
+    RbHeapHandle handle = heap->entries[index].handle;
+    if (priority) *priority = heap->priorities[index];
+    else rb_value_free(heap->priorities[index]);
+    if (value) *value = heap->entries[index].value;
+    else rb_value_free(heap->entries[index].value);
+
+    heap->positions[handle] = RB_HEAP_NO_HANDLE;
+    heap->free_handles[heap->free_count++] = handle;
+
+    size_t last = --heap->size;
+    if (index == last) return;
+    place(heap, index, heap->priorities[last], heap->entries[last]);
+    if (index > 0 && less(heap, &heap->priorities[index], &heap->priorities[(index - 1) / ARITY])) {
+        sift_up(heap, index);
+    } else {
+        sift_down(heap, index);
+    }
+}
+
+/* ========== CREATION & DESTRUCTION ========== */
+
+RbHeap *rb_heap_new(RbCompareFn compare) {
+    RbHeap *heap = (RbHeap *)calloc(1, sizeof(RbHeap));
+    if (!heap) return NULL;
+    heap->compare = compare;
+    return heap;
+}
+
+void rb_heap_free(RbHeap *heap) {
+    if (!heap) return;
+    rb_heap_clear(heap);
+    free(heap->priority_block);
+    free(heap->entries);
+    free(heap->positions);
+    free(heap->free_handles);
+    free(heap);
+}
+
+void rb_heap_clear(RbHeap *heap) {
+    if (!heap) return;
+    for (size_t i = 0; i < heap->size; i++) {
+        rb_value_free(heap->priorities[i]);
+        rb_value_free(heap->entries[i].value);
+    }
+    heap->size = 0;
+    heap->handle_count = 0;
+    heap->free_count = 0;
+}
+
+/* ========== OPERATIONS ========== */
+
+size_t rb_heap_len(const RbHeap *heap) {
+    return heap ? heap->size : 0;
+}
+
+bool rb_heap_is_empty(const RbHeap *heap) {
+    return rb_heap_len(heap) == 0;
+}
+
+RbHeapHandle rb_heap_push(RbHeap *heap, RbValue priority, RbValue value) {
+    if (!heap || !grow(heap)) return RB_HEAP_NO_HANDLE;
+    RbHeapHandle handle = new_handle(heap);
+    if (handle == RB_HEAP_NO_HANDLE) return RB_HEAP_NO_HANDLE;
+
+    RbHeapEntry entry = { rb_value_clone(value), handle };
+    place(heap, heap->size++, rb_value_clone(priority), entry);
+    sift_up(heap, heap->size - 1);
+    return handle;
+}
+
+bool rb_heap_peek(const RbHeap *heap, RbValue *priority, RbValue *value) {
+    if (!heap || heap->size == 0) return false;
+    if (priority) *priority = heap->priorities[0];
+    if (value) *value = heap->entries[0].value;
+    return true;
+}
+
+bool rb_heap_pop(RbHeap *heap, RbValue *priority, RbValue *value) {
+    if (!heap || heap->size == 0) return false;
+    remove_at(heap, 0, priority, value);
+    return true;
+}
+
+bool rb_heap_contains(const RbHeap *heap, RbHeapHandle handle) {
+    return heap && handle < heap->handle_count && heap->positions[handle] != RB_HEAP_NO_HANDLE;
+}
+
+bool rb_heap_update(RbHeap *heap, RbHeapHandle handle, RbValue priority) {
+    if (!rb_heap_contains(heap, handle)) return false;
+    size_t index = heap->positions[handle];
+    RbValue old = heap->priorities[index];
+    heap->priorities[index] = rb_value_clone(priority);
+    if (less(heap, &heap->priorities[index], &old)) sift_up(heap, index);
+    else sift_down(heap, index);
+    rb_value_free(old);
+    return true;
+}
+
+bool rb_heap_remove(RbHeap *heap, RbHeapHandle handle, RbValue *priority, RbValue *value) {
+    if (!rb_heap_contains(heap, handle)) return false;
+    remove_at(heap, heap->positions[handle], priority, value);
+    return true;
+}
+
+bool rb_heap_at(const RbHeap *heap, size_t index, RbValue *priority, RbValue *value) {
+    if (!heap || index >= heap->size) return false;
+    if (priority) *priority = heap->priorities[index];
+    if (value) *value = heap->entries[index].value;
+    return true;
+}
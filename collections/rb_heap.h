@@ -0,0 +1,88 @@
+#ifndef RB_HEAP_H
+#define RB_HEAP_H
+
+#include "rb_collections.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Priority queue: an implicit 4-ary min-heap (children of i are 4i+1..4i+4).
+ * The tree is half as deep as a binary heap, and the priorities live in
+ * their own array, aligned so the four children compared in one sift step
+ * sit in one 64-byte cache line. Values ride along in a parallel array.
+ *
+ * Every push returns a handle that stays valid until its entry is popped
+ * or removed; a handle-to-position index lets update (decrease-key or
+ * increase-key) and remove work on any entry in O(log n). Priorities use
+ * the natural order unless a comparator is given (pass a reversed one for
+ * a max-heap). Pushed values are cloned; popped values belong to the
+ * caller. */
+
+typedef size_t RbHeapHandle;
+
+#define RB_HEAP_NO_HANDLE ((RbHeapHandle)-1)
+
+typedef struct {
+    RbValue value;
+    RbHeapHandle handle;
+} RbHeapEntry;
+
+typedef struct RbHeap {
+    RbValue *priorities;        /* heap order; see rb_heap.c for alignment */
+    RbHeapEntry *entries;       /* parallel to priorities */
+    size_t size;
+    size_t capacity;
+    void *priority_block;       /* allocation behind priorities */
+
+    size_t *positions;          /* handle -> heap index (RB_HEAP_NO_HANDLE if free) */
+    size_t handle_count;
+    size_t handle_capacity;
+    RbHeapHandle *free_handles;
+    size_t free_count;
+
+    RbCompareFn compare;        /* NULL = natural order */
+} RbHeap;
+
+/* ========== CREATION & DESTRUCTION ========== */
+
+/* Create an empty heap; compare may be NULL for the natural order */
+RbHeap *rb_heap_new(RbCompareFn compare);
+
+/* Free a heap and its values */
+void rb_heap_free(RbHeap *heap);
+
+/* Remove all entries (every handle becomes invalid) */
+void rb_heap_clear(RbHeap *heap);
+
+/* ========== OPERATIONS ========== */
+
+/* Number of entries */
+size_t rb_heap_len(const RbHeap *heap);
+
+/* Check if heap is empty */
+bool rb_heap_is_empty(const RbHeap *heap);
+
+/* Insert value with priority; returns its handle, or RB_HEAP_NO_HANDLE if
+ * out of memory */
+RbHeapHandle rb_heap_push(RbHeap *heap, RbValue priority, RbValue value);
+
+/* Borrow the smallest entry; false if empty. Either out pointer may be NULL */
+bool rb_heap_peek(const RbHeap *heap, RbValue *priority, RbValue *value);
+
+/* Remove the smallest entry, handing its priority and value to the caller
+ * (NULL out pointers free them instead); false if empty */
+bool rb_heap_pop(RbHeap *heap, RbValue *priority, RbValue *value);
+
+/* Change an entry's priority and restore heap order */
+bool rb_heap_update(RbHeap *heap, RbHeapHandle handle, RbValue priority);
+
+/* Remove an entry by handle, like rb_heap_pop */
+bool rb_heap_remove(RbHeap *heap, RbHeapHandle handle, RbValue *priority, RbValue *value);
+
+/* Check if a handle refers to a live entry */
+bool rb_heap_contains(const RbHeap *heap, RbHeapHandle handle);
+
+/* Borrow entry `index` in storage order (0 is the smallest; the rest are in
+ * no particular order), for iterating without popping */
+bool rb_heap_at(const RbHeap *heap, size_t index, RbValue *priority, RbValue *value);
+
+#endif /* RB_HEAP_H */
@@ -216,32 +216,20 @@ void rb_list_reverse(RbList *list) {
     }
 }
 
-static int compare_values(const void *a, const void *b) {
-    const RbValue *va = (const RbValue *)a;
-    const RbValue *vb = (const RbValue *)b;
-    
-    if (va->type != vb->type) return va->type - vb->type;
-    
-    switch (va->type) {
-        case RB_VAL_INT:
-            return rb_compare_int(&va->data.i, &vb->data.i);
-        case RB_VAL_FLOAT:
-            return rb_compare_float(&va->data.f, &vb->data.f);
-        case RB_VAL_STRING:
-            return rb_compare_string(&va->data.s, &vb->data.s);
-        default:
-            return 0;
-    }
+/* Specialized sorts live in rb_sort.c */
+void rb_list_sort(RbList *list, RbCompareFn compare) {
+    if (!list || list->size <= 1) return;
+    rb_sort_values(list->items, list->size, compare);
 }
 
-void rb_list_sort(RbList *list, RbCompareFn compare) {
+void rb_list_sort_stable(RbList *list, RbCompareFn compare) {
     if (!list || list->size <= 1) return;
-    
-    if (compare) {
-        qsort(list->items, list->size, sizeof(RbValue), compare);
-    } else {
-        qsort(list->items, list->size, sizeof(RbValue), compare_values);
-    }
+    rb_sort_values_stable(list->items, list->size, compare);
+}
+
+void rb_list_sort_by_key(RbList *list, RbKeyFn key) {
+    if (!list || list->size <= 1) return;
+    rb_sort_values_by_key(list->items, list->size, key);
 }
 
 /* ========== SLICING & COPYING ========== */
@@ -315,9 +303,11 @@ void rb_list_print(const RbList *list) {
 }
 
 char *rb_list_to_string(const RbList *list) {
-    if (!list) return strdup("[]");
-    
-    if (list->size == 0) return strdup("[]");
+    if (!list || list->size == 0) {
+        char *empty = malloc(3);
+        if (empty) memcpy(empty, "[]", 3);
+        return empty;
+    }
     
     /* Calculate approximate size */
     size_t total_size = 2; /* [] */
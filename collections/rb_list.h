@@ -2,6 +2,7 @@
 #define RB_LIST_H
 
 #include "rb_collections.h"
+#include "rb_sort.h"
 #include <stddef.h>
 #include <stdbool.h>
 
@@ -74,9 +75,16 @@ bool rb_list_contains(const RbList *list, RbValue value);
 /* Reverse list in place */
 void rb_list_reverse(RbList *list);
 
-/* Sort list in place */
+/* Sort list in place (compare may be NULL for the natural order; see
+ * rb_sort.h for the algorithms) */
 void rb_list_sort(RbList *list, RbCompareFn compare);
 
+/* Stable sort: equal elements keep their relative order */
+void rb_list_sort_stable(RbList *list, RbCompareFn compare);
+
+/* Stable sort by a key computed once per element */
+void rb_list_sort_by_key(RbList *list, RbKeyFn key);
+
 /* ========== SLICING & COPYING ========== */
 
 /* Create a shallow copy */
@@ -104,8 +112,11 @@ static inline RbValue rb_list_py_pop(RbList *list) {
 /* list.reverse() */
 #define rb_list_py_reverse rb_list_reverse
 
-/* list.sort() */
-#define rb_list_py_sort(list) rb_list_sort(list, NULL)
+/* list.sort() - stable, like Python's */
+#define rb_list_py_sort(list) rb_list_sort_stable(list, NULL)
+
+/* list.sort(key=f) */
+#define rb_list_py_sort_key(list, key) rb_list_sort_by_key(list, key)
 
 /* len(list) */
 #define rb_list_py_len rb_list_len
@@ -0,0 +1,496 @@
+#include "rb_pmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BITS 5
+#define MASK 31u
+#define HASH_BITS 64
+
+/* A trie node stores its inline entries (key, value pairs) followed by its
+ * child pointers, both in bitmap order. Below the last 5-bit level
+ * (shift >= 64) a node is a collision list: the bitmaps are unused and the
+ * entries are kept in insertion order. */
+struct RbPMapNode {
+    size_t refcount;
+    uint64_t owner;             /* builder allowed to mutate in place; 0 = none */
+    uint32_t datamap;
+    uint32_t nodemap;
+    uint32_t entries;
+    uint32_t children;
+    RbValue kv[];
+};
+
+static uint64_t next_owner = 1;
+
+/* ========== NODES ========== */
+
+static inline RbPMapNode **children_of(const RbPMapNode *node) {
+    return (RbPMapNode **)(node->kv + 2 * node->entries);
+}
+
+static inline uint32_t bit_index(uint32_t bitmap, uint32_t bit) {
+    return (uint32_t)__builtin_popcount(bitmap & (bit - 1));
+}
+
+static inline uint32_t hash_bit(uint64_t hash, unsigned shift) {
+    return 1u << ((hash >> shift) & MASK);
+}
+
+static RbPMapNode *node_new(uint32_t entries, uint32_t children, uint64_t owner) {
+    RbPMapNode *node = malloc(sizeof(RbPMapNode) + sizeof(RbValue) * 2 * entries +
+                              sizeof(RbPMapNode *) * children);
+    if (!node) return NULL;
+    node->refcount = 1;
+    node->owner = owner;
+    node->datamap = 0;
+    node->nodemap = 0;
+    node->entries = entries;
+    node->children = children;
+    return node;
+}
+
+static inline void node_retain(RbPMapNode *node) {
+    if (node) __atomic_add_fetch(&node->refcount, 1, __ATOMIC_RELAXED);
+}
+
+static void node_release(RbPMapNode *node) {
+    if (!node || __atomic_sub_fetch(&node->refcount, 1, __ATOMIC_ACQ_REL) != 0) return;
+    for (uint32_t i = 0; i < 2 * node->entries; i++) rb_value_free(node->kv[i]);
+    RbPMapNode **children = children_of(node);
+    for (uint32_t i = 0; i < node->children; i++) node_release(children[i]);
+    free(node);
+}
+
+/* Make *slot writable by owner (see rb_pvector.c): in place if the
+ * builder created it, otherwise a copy takes over the slot's reference */
+static RbPMapNode *edit_slot(RbPMapNode **slot, uint64_t owner) {
+    RbPMapNode *node = *slot;
+    if (owner && node->owner == owner) return node;
+
+    RbPMapNode *copy = node_new(node->entries, node->children, owner);
+    if (!copy) return NULL;
+    copy->datamap = node->datamap;
+    copy->nodemap = node->nodemap;
+    for (uint32_t i = 0; i < 2 * node->entries; i++) copy->kv[i] = rb_value_clone(node->kv[i]);
+    RbPMapNode **from = children_of(node), **to = children_of(copy);
+    for (uint32_t i = 0; i < node->children; i++) {
+        to[i] = from[i];
+        node_retain(to[i]);
+    }
+    *slot = copy;
+    node_release(node);
+    return copy;
+}
+
+/* Rebuild a writable node with one entry and/or one child dropped (index
+ * in node, -1 for none) and/or added (index in the result, -1 for none).
+ * Everything else moves over; dropped items are the caller's to free.
+ * The old node is freed; on allocation failure it is returned unchanged. */
+static RbPMapNode *reshape(RbPMapNode *node, uint64_t owner, uint32_t datamap, uint32_t nodemap,
+                           int drop_entry, int add_entry, RbValue key, RbValue value,
+                           int drop_child, int add_child, RbPMapNode *child) {
+    uint32_t entries = node->entries - (drop_entry >= 0) + (add_entry >= 0);
+    uint32_t children = node->children - (drop_child >= 0) + (add_child >= 0);
+    RbPMapNode *result = node_new(entries, children, owner);
+    if (!result) return NULL;
+    result->datamap = datamap;
+    result->nodemap = nodemap;
+
+    uint32_t out = 0;
+    for (uint32_t i = 0; i < node->entries; i++) {
+        if ((int)i == drop_entry) continue;
+        if ((int)out == add_entry) out++;
+        result->kv[2 * out] = node->kv[2 * i];
+        result->kv[2 * out + 1] = node->kv[2 * i + 1];
+        out++;
+    }
+    if (add_entry >= 0) {
+        result->kv[2 * add_entry] = key;
+        result->kv[2 * add_entry + 1] = value;
+    }
+
+    RbPMapNode **from = children_of(node), **to = children_of(result);
+    out = 0;
+    for (uint32_t i = 0; i < node->children; i++) {
+        if ((int)i == drop_child) continue;
+        if ((int)out == add_child) out++;
+        to[out++] = from[i];
+    }
+    if (add_child >= 0) to[add_child] = child;
+
+    free(node);
+    return result;
+}
+
+/* Free the nodes of a merge() result whose entries still belong elsewhere */
+static void discard_merged(RbPMapNode *node) {
+    while (node) {
+        RbPMapNode *next = node->children ? children_of(node)[0] : NULL;
+        free(node);
+        node = next;
+    }
+}
+
+/* A subtree holding two entries whose hashes agree below shift */
+static RbPMapNode *merge(RbValue k1, RbValue v1, uint64_t h1, RbValue k2, RbValue v2, uint64_t h2,
+                         unsigned shift, uint64_t owner) {
+    if (shift >= HASH_BITS) {
+        RbPMapNode *node = node_new(2, 0, owner);
+        if (!node) return NULL;
+        node->kv[0] = k1;
+        node->kv[1] = v1;
+        node->kv[2] = k2;
+        node->kv[3] = v2;
+        return node;
+    }
+
+    uint32_t b1 = hash_bit(h1, shift), b2 = hash_bit(h2, shift);
+    if (b1 != b2) {
+        RbPMapNode *node = node_new(2, 0, owner);
+        if (!node) return NULL;
+        node->datamap = b1 | b2;
+        int first = b1 < b2 ? 0 : 2;
+        node->kv[first] = k1;
+        node->kv[first + 1] = v1;
+        node->kv[2 - first] = k2;
+        node->kv[3 - first] = v2;
+        return node;
+    }
+
+    RbPMapNode *child = merge(k1, v1, h1, k2, v2, h2, shift + BITS, owner);
+    RbPMapNode *node = child ? node_new(0, 1, owner) : NULL;
+    if (!node) {
+        discard_merged(child);
+        return NULL;
+    }
+    node->nodemap = b1;
+    children_of(node)[0] = child;
+    return node;
+}
+
+/* ========== LOOKUP ========== */
+
+static const RbValue *find(const RbPMapNode *node, RbValue key, uint64_t hash) {
+    for (unsigned shift = 0; node; shift += BITS) {
+        if (shift >= HASH_BITS) {
+            for (uint32_t i = 0; i < node->entries; i++) {
+                if (rb_value_equals(node->kv[2 * i], key)) return &node->kv[2 * i + 1];
+            }
+            return NULL;
+        }
+        uint32_t bit = hash_bit(hash, shift);
+        if (node->datamap & bit) {
+            uint32_t i = bit_index(node->datamap, bit);
+            return rb_value_equals(node->kv[2 * i], key) ? &node->kv[2 * i + 1] : NULL;
+        }
+        if (!(node->nodemap & bit)) return NULL;
+        node = children_of(node)[bit_index(node->nodemap, bit)];
+    }
+    return NULL;
+}
+
+/* ========== EDITS ==========
+ * Shared by versions and builders; a version update runs on a stack
+ * builder with owner 0, which copies every node it touches. */
+
+static void trie_begin(RbPMapBuilder *trie, const RbPMap *map, uint64_t owner) {
+    trie->owner = owner;
+    trie->count = map->count;
+    trie->root = map->root;
+    node_retain(trie->root);
+}
+
+static RbPMap *trie_seal(RbPMapBuilder *trie) {
+    RbPMap *map = malloc(sizeof(RbPMap));
+    if (!map) {
+        node_release(trie->root);
+        return NULL;
+    }
+    map->refcount = 1;
+    map->count = trie->count;
+    map->root = trie->root;
+    return map;
+}
+
+/* Insert or replace below *slot; *added tells which. The new key and value
+ * are cloned only once they have a place. */
+static bool set_rec(RbPMapNode **slot, RbValue key, RbValue value, uint64_t hash, unsigned shift,
+                    uint64_t owner, bool *added) {
+    RbPMapNode *node = edit_slot(slot, owner);
+    if (!node) return false;
+
+    if (shift >= HASH_BITS) {
+        for (uint32_t i = 0; i < node->entries; i++) {
+            if (rb_value_equals(node->kv[2 * i], key)) {
+                rb_value_free(node->kv[2 * i + 1]);
+                node->kv[2 * i + 1] = rb_value_clone(value);
+                return true;
+            }
+        }
+        RbPMapNode *grown = reshape(node, owner, 0, 0, -1, (int)node->entries,
+                                    rb_value_clone(key), rb_value_clone(value), -1, -1, NULL);
+        if (!grown) return false;
+        *slot = grown;
+        *added = true;
+        return true;
+    }
+
+    uint32_t bit = hash_bit(hash, shift);
+    if (node->datamap & bit) {
+        uint32_t i = bit_index(node->datamap, bit);
+        if (rb_value_equals(node->kv[2 * i], key)) {
+            rb_value_free(node->kv[2 * i + 1]);
+            node->kv[2 * i + 1] = rb_value_clone(value);
+            return true;
+        }
+        /* Two keys share this slot: push both down into a new subtree */
+        RbValue old_key = node->kv[2 * i], old_value = node->kv[2 * i + 1];
+        RbValue new_key = rb_value_clone(key), new_value = rb_value_clone(value);
+        RbPMapNode *child = merge(old_key, old_value, rb_value_hash(old_key),
+                                  new_key, new_value, hash, shift + BITS, owner);
+        RbPMapNode *grown = child ? reshape(node, owner, node->datamap & ~bit, node->nodemap | bit,
+                                            (int)i, -1, new_key, new_value,
+                                            -1, (int)bit_index(node->nodemap, bit), child) : NULL;
+        if (!grown) {
+            discard_merged(child);
+            rb_value_free(new_key);
+            rb_value_free(new_value);
+            return false;
+        }
+        *slot = grown;
+        *added = true;
+        return true;
+    }
+
+    if (node->nodemap & bit) {
+        return set_rec(&children_of(node)[bit_index(node->nodemap, bit)], key, value, hash,
+                       shift + BITS, owner, added);
+    }
+
+    RbPMapNode *grown = reshape(node, owner, node->datamap | bit, node->nodemap,
+                                -1, (int)bit_index(node->datamap, bit),
+                                rb_value_clone(key), rb_value_clone(value), -1, -1, NULL);
+    if (!grown) return false;
+    *slot = grown;
+    *added = true;
+    return true;
+}
+
+static bool trie_set(RbPMapBuilder *trie, RbValue key, uint64_t hash, RbValue value) {
+    if (!trie->root) {
+        RbPMapNode *root = node_new(1, 0, trie->owner);
+        if (!root) return false;
+        root->datamap = hash_bit(hash, 0);
+        root->kv[0] = rb_value_clone(key);
+        root->kv[1] = rb_value_clone(value);
+        trie->root = root;
+        trie->count = 1;
+        return true;
+    }
+    bool added = false;
+    if (!set_rec(&trie->root, key, value, hash, 0, trie->owner, &added)) return false;
+    if (added) trie->count++;
+    return true;
+}
+
+/* Remove a key known to be present below *slot. Every node on the path
+ * is made writable first, so the child left behind is always private and
+ * a lone surviving entry can be moved up into this node. */
+static bool remove_rec(RbPMapNode **slot, RbValue key, uint64_t hash, unsigned shift, uint64_t owner) {
+    RbPMapNode *node = edit_slot(slot, owner);
+    if (!node) return false;
+
+    if (shift >= HASH_BITS) {
+        for (uint32_t i = 0; i < node->entries; i++) {
+            if (!rb_value_equals(node->kv[2 * i], key)) continue;
+            RbValue old_key = node->kv[2 * i], old_value = node->kv[2 * i + 1];
+            RbPMapNode *shrunk = reshape(node, owner, 0, 0, (int)i, -1, old_key, old_value, -1, -1, NULL);
+            if (!shrunk) return false;
+            rb_value_free(old_key);
+            rb_value_free(old_value);
+            *slot = shrunk;
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t bit = hash_bit(hash, shift);
+    if (node->datamap & bit) {
+        uint32_t i = bit_index(node->datamap, bit);
+        RbValue old_key = node->kv[2 * i], old_value = node->kv[2 * i + 1];
+        RbPMapNode *shrunk = reshape(node, owner, node->datamap & ~bit, node->nodemap,
+                                     (int)i, -1, old_key, old_value, -1, -1, NULL);
+        if (!shrunk) return false;
+        rb_value_free(old_key);
+        rb_value_free(old_value);
+        *slot = shrunk;
+        return true;
+    }
+
+    uint32_t c = bit_index(node->nodemap, bit);
+    RbPMapNode **child_slot = &children_of(node)[c];
+    if (!remove_rec(child_slot, key, hash, shift + BITS, owner)) return false;
+
+    RbPMapNode *child = *child_slot;
+    if (child->entries != 1 || child->children != 0) return true;
+
+    /* Keep the trie canonical: a single entry lives inline, not in a child */
+    RbPMapNode *shrunk = reshape(node, owner, node->datamap | bit, node->nodemap & ~bit,
+                                 -1, (int)bit_index(node->datamap, bit), child->kv[0], child->kv[1],
+                                 (int)c, -1, NULL);
+    if (!shrunk) return true;
+    free(child);
+    *slot = shrunk;
+    return true;
+}
+
+static bool trie_remove(RbPMapBuilder *trie, RbValue key, uint64_t hash) {
+    if (!find(trie->root, key, hash)) return false;
+    if (!remove_rec(&trie->root, key, hash, 0, trie->owner)) return false;
+    trie->count--;
+    if (trie->root->entries == 0 && trie->root->children == 0) {
+        node_release(trie->root);
+        trie->root = NULL;
+    }
+    return true;
+}
+
+/* ========== VERSIONS ========== */
+
+RbPMap *rb_pmap_new(void) {
+    RbPMap *map = malloc(sizeof(RbPMap));
+    if (!map) return NULL;
+    map->refcount = 1;
+    map->count = 0;
+    map->root = NULL;
+    return map;
+}
+
+RbPMap *rb_pmap_retain(RbPMap *map) {
+    if (map) __atomic_add_fetch(&map->refcount, 1, __ATOMIC_RELAXED);
+    return map;
+}
+
+void rb_pmap_release(RbPMap *map) {
+    if (!map || __atomic_sub_fetch(&map->refcount, 1, __ATOMIC_ACQ_REL) != 0) return;
+    node_release(map->root);
+    free(map);
+}
+
+size_t rb_pmap_len(const RbPMap *map) {
+    return map ? map->count : 0;
+}
+
+bool rb_pmap_get(const RbPMap *map, RbValue key, RbValue *value) {
+    return rb_pmap_get_hashed(map, key, rb_value_hash(key), value);
+}
+
+bool rb_pmap_get_hashed(const RbPMap *map, RbValue key, uint64_t hash, RbValue *value) {
+    const RbValue *found = map ? find(map->root, key, hash) : NULL;
+    if (!found) return false;
+    if (value) *value = *found;
+    return true;
+}
+
+bool rb_pmap_contains(const RbPMap *map, RbValue key) {
+    return rb_pmap_get(map, key, NULL);
+}
+
+/* ========== UPDATES ========== */
+
+RbPMap *rb_pmap_set(const RbPMap *map, RbValue key, RbValue value) {
+    if (!map) return NULL;
+    RbPMapBuilder trie;
+    trie_begin(&trie, map, 0);
+    if (!trie_set(&trie, key, rb_value_hash(key), value)) {
+        node_release(trie.root);
+        return NULL;
+    }
+    return trie_seal(&trie);
+}
+
+RbPMap *rb_pmap_remove(const RbPMap *map, RbValue key) {
+    return rb_pmap_remove_hashed(map, key, rb_value_hash(key));
+}
+
+RbPMap *rb_pmap_remove_hashed(const RbPMap *map, RbValue key, uint64_t hash) {
+    if (!map) return NULL;
+    RbPMapBuilder trie;
+    trie_begin(&trie, map, 0);
+    if (!trie_remove(&trie, key, hash) && find(trie.root, key, hash)) {
+        node_release(trie.root);
+        return NULL;
+    }
+    return trie_seal(&trie);
+}
+
+/* ========== BUILDERS ========== */
+
+RbPMapBuilder *rb_pmap_builder(const RbPMap *map) {
+    if (!map) return NULL;
+    RbPMapBuilder *builder = malloc(sizeof(RbPMapBuilder));
+    if (!builder) return NULL;
+    trie_begin(builder, map, __atomic_fetch_add(&next_owner, 1, __ATOMIC_RELAXED));
+    return builder;
+}
+
+bool rb_pmap_builder_set(RbPMapBuilder *builder, RbValue key, RbValue value) {
+    return builder && trie_set(builder, key, rb_value_hash(key), value);
+}
+
+bool rb_pmap_builder_set_hashed(RbPMapBuilder *builder, RbValue key, uint64_t hash, RbValue value) {
+    return builder && trie_set(builder, key, hash, value);
+}
+
+bool rb_pmap_builder_remove(RbPMapBuilder *builder, RbValue key) {
+    return builder && trie_remove(builder, key, rb_value_hash(key));
+}
+
+RbPMap *rb_pmap_build(RbPMapBuilder *builder) {
+    if (!builder) return NULL;
+    RbPMap *map = trie_seal(builder);
+    free(builder);
+    return map;
+}
+
+void rb_pmap_builder_free(RbPMapBuilder *builder) {
+    if (!builder) return;
+    node_release(builder->root);
+    free(builder);
+}
+
+/* ========== ITERATION ========== */
+
+RbPMapIter rb_pmap_iter(const RbPMap *map) {
+    RbPMapIter it;
+    it.depth = 0;
+    if (map && map->root) {
+        it.nodes[0] = map->root;
+        it.entry[0] = 0;
+        it.child[0] = 0;
+        it.depth = 1;
+    }
+    return it;
+}
+
+bool rb_pmap_next(RbPMapIter *it, RbValue *key, RbValue *value) {
+    while (it->depth > 0) {
+        int top = it->depth - 1;
+        const RbPMapNode *node = it->nodes[top];
+        if (it->entry[top] < node->entries) {
+            uint32_t i = it->entry[top]++;
+            if (key) *key = node->kv[2 * i];
+            if (value) *value = node->kv[2 * i + 1];
+            return true;
+        }
+        if (it->child[top] < node->children) {
+            it->nodes[it->depth] = children_of(node)[it->child[top]++];
+            it->entry[it->depth] = 0;
+            it->child[it->depth] = 0;
+            it->depth++;
+            continue;
+        }
+        it->depth--;
+    }
+    return false;
+}
@@ -0,0 +1,102 @@
+#ifndef RB_PMAP_H
+#define RB_PMAP_H
+
+#include "rb_collections.h"
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Persistent map: an immutable hash array mapped trie (HAMT) keyed by
+ * rb_value_hash. Each node covers 5 bits of the hash with two 32-bit
+ * bitmaps, one for entries stored inline and one for child nodes, so a
+ * node holds exactly as many slots as it uses. Lookups and updates are
+ * O(log32 n); an update copies one node per level and shares the rest
+ * with the previous version. Keys whose 64-bit hashes collide share a
+ * small list at the bottom of the trie.
+ *
+ * Sharing and builders work like RbPVector: versions are reference
+ * counted atomically and immutable once published, and a builder edits
+ * the nodes it created in place until rb_pmap_build seals it.
+ *
+ * Keys and values are cloned on the way in and borrowed on the way out.
+ * Hashes are keyed per process (see rb_hash_seed), so iteration order is
+ * unspecified and differs between runs. */
+
+typedef struct RbPMapNode RbPMapNode;
+
+typedef struct RbPMap {
+    size_t refcount;
+    size_t count;
+    RbPMapNode *root;           /* NULL when empty */
+} RbPMap;
+
+typedef struct RbPMapBuilder {
+    uint64_t owner;             /* stamp on nodes this builder may mutate */
+    size_t count;
+    RbPMapNode *root;
+} RbPMapBuilder;
+
+#define RB_PMAP_MAX_DEPTH 14    /* 13 levels of 5 hash bits + collision lists */
+
+/* Borrowing cursor: a stack of positions, one per trie level */
+typedef struct {
+    const RbPMapNode *nodes[RB_PMAP_MAX_DEPTH];
+    uint32_t entry[RB_PMAP_MAX_DEPTH];
+    uint32_t child[RB_PMAP_MAX_DEPTH];
+    int depth;
+} RbPMapIter;
+
+/* ========== VERSIONS ========== */
+
+/* A new empty map */
+RbPMap *rb_pmap_new(void);
+
+/* Add / drop a holder; the last release frees the version */
+RbPMap *rb_pmap_retain(RbPMap *map);
+void rb_pmap_release(RbPMap *map);
+
+/* Number of entries */
+size_t rb_pmap_len(const RbPMap *map);
+
+/* Borrow the value for key; false if absent */
+bool rb_pmap_get(const RbPMap *map, RbValue key, RbValue *value);
+
+/* Check if key is present */
+bool rb_pmap_contains(const RbPMap *map, RbValue key);
+
+/* rb_pmap_get with rb_value_hash(key) supplied by a caller that caches it */
+bool rb_pmap_get_hashed(const RbPMap *map, RbValue key, uint64_t hash, RbValue *value);
+
+/* ========== UPDATES (each returns a new version) ========== */
+
+/* Map key to value, replacing any previous value */
+RbPMap *rb_pmap_set(const RbPMap *map, RbValue key, RbValue value);
+
+/* Drop key (a new version is returned even if it was absent) */
+RbPMap *rb_pmap_remove(const RbPMap *map, RbValue key);
+RbPMap *rb_pmap_remove_hashed(const RbPMap *map, RbValue key, uint64_t hash);
+
+/* ========== BUILDERS ========== */
+
+/* Start a batch of edits from a version (which stays unchanged) */
+RbPMapBuilder *rb_pmap_builder(const RbPMap *map);
+
+/* In-place edits; false if out of memory (set) or key absent (remove) */
+bool rb_pmap_builder_set(RbPMapBuilder *builder, RbValue key, RbValue value);
+bool rb_pmap_builder_set_hashed(RbPMapBuilder *builder, RbValue key, uint64_t hash, RbValue value);
+bool rb_pmap_builder_remove(RbPMapBuilder *builder, RbValue key);
+
+/* Seal the builder into a version; the builder is freed */
+RbPMap *rb_pmap_build(RbPMapBuilder *builder);
+
+/* Discard a builder without producing a version */
+void rb_pmap_builder_free(RbPMapBuilder *builder);
+
+/* ========== ITERATION ========== */
+
+RbPMapIter rb_pmap_iter(const RbPMap *map);
+
+/* Borrow the next entry; false at the end. Either out pointer may be NULL */
+bool rb_pmap_next(RbPMapIter *it, RbValue *key, RbValue *value);
+
+#endif /* RB_PMAP_H */
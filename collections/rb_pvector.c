@@ -0,0 +1,801 @@
+#include "rb_pvector.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BITS 5
+#define WIDTH (1u << BITS)
+#define MASK (WIDTH - 1)
+
+/* Concatenation rebalances until a level uses at most this many nodes more
+ * than the minimum, which bounds the extra search steps per level */
+#define EXTRAS 2
+
+/* Level 0 nodes are leaves holding values; higher levels hold children.
+ * Unused slots are null values / NULL children, so a node can always be
+ * released by walking all WIDTH slots.
+ *
+ * A branch is either radix (every child but the last is full, so the child
+ * holding an index is index >> shift) or relaxed: concatenation and
+ * slicing leave partly filled leaves inside the tree, and then `sizes[i]`
+ * is the number of values below children 0..i. A relaxed lookup starts at
+ * the radix guess, which is never past the right child, and steps right. */
+struct RbPVectorNode {
+    size_t refcount;
+    uint64_t owner;             /* builder allowed to mutate in place; 0 = none */
+    unsigned length;            /* values (leaf) or children in use */
+    size_t *sizes;              /* relaxed branches only; NULL when radix */
+    union {
+        RbPVectorNode *children[WIDTH];
+        RbValue values[WIDTH];
+    } as;
+};
+
+static uint64_t next_owner = 1;
+
+/* ========== NODES ========== */
+
+static RbPVectorNode *node_new(uint64_t owner) {
+    RbPVectorNode *node = calloc(1, sizeof(RbPVectorNode));
+    if (!node) return NULL;
+    node->refcount = 1;
+    node->owner = owner;
+    return node;
+}
+
+static inline void node_retain(RbPVectorNode *node) {
+    if (node) __atomic_add_fetch(&node->refcount, 1, __ATOMIC_RELAXED);
+}
+
+static void node_release(RbPVectorNode *node, unsigned level) {
+    if (!node || __atomic_sub_fetch(&node->refcount, 1, __ATOMIC_ACQ_REL) != 0) return;
+    for (unsigned i = 0; i < WIDTH; i++) {
+        if (level == 0) rb_value_free(node->as.values[i]);
+        else node_release(node->as.children[i], level - BITS);
+    }
+    free(node->sizes);
+    free(node);
+}
+
+/* Values below a node */
+static size_t node_count(const RbPVectorNode *node, unsigned level) {
+    if (level == 0) return node->length;
+    if (node->sizes) return node->sizes[node->length - 1];
+    return ((size_t)(node->length - 1) << level) + node_count(node->as.children[node->length - 1], level - BITS);
+}
+
+/* Slot of the child holding *index (relative to the branch); *index
+ * becomes relative to that child */
+static inline unsigned child_index(const RbPVectorNode *node, unsigned level, size_t *index) {
+    unsigned i = (unsigned)(*index >> level);
+    if (!node->sizes) {
+        *index -= (size_t)i << level;
+        return i;
+    }
+    while (node->sizes[i] <= *index) i++;
+    if (i > 0) *index -= node->sizes[i - 1];
+    return i;
+}
+
+/* Give a branch whose children are in place a size table if it needs one,
+ * or drop the one it has if it is radix again */
+static bool branch_sizes(RbPVectorNode *node, unsigned level) {
+    size_t sizes[WIDTH], total = 0;
+    bool radix = true;
+    for (unsigned i = 0; i < node->length; i++) {
+        size_t n = node_count(node->as.children[i], level - BITS);
+        if (i + 1 < node->length && n != (size_t)1 << level) radix = false;
+        total += n;
+        sizes[i] = total;
+    }
+    if (radix) {
+        free(node->sizes);
+        node->sizes = NULL;
+        return true;
+    }
+    if (!node->sizes && !(node->sizes = malloc(WIDTH * sizeof(size_t)))) return false;
+    memcpy(node->sizes, sizes, node->length * sizeof(size_t));
+    return true;
+}
+
+/* Make *slot writable by owner: nodes the builder created are edited in
+ * place, anything shared is copied (the slot's reference moves to the
+ * copy). Returns NULL, leaving the slot untouched, if out of memory. */
+static RbPVectorNode *edit_slot(RbPVectorNode **slot, unsigned level, uint64_t owner) {
+    RbPVectorNode *node = *slot;
+    if (owner && node->owner == owner) return node;
+
+    RbPVectorNode *copy = node_new(owner);
+    if (!copy) return NULL;
+    if (node->sizes) {
+        copy->sizes = malloc(WIDTH * sizeof(size_t));
+        if (!copy->sizes) {
+            free(copy);
+            return NULL;
+        }
+        memcpy(copy->sizes, node->sizes, WIDTH * sizeof(size_t));
+    }
+    copy->length = node->length;
+    for (unsigned i = 0; i < WIDTH; i++) {
+        if (level == 0) {
+            copy->as.values[i] = rb_value_clone(node->as.values[i]);
+        } else {
+            copy->as.children[i] = node->as.children[i];
+            node_retain(copy->as.children[i]);
+        }
+    }
+    *slot = copy;
+    node_release(node, level);
+    return copy;
+}
+
+/* A chain of single-child branches from level down to leaf */
+static RbPVectorNode *new_path(unsigned level, RbPVectorNode *leaf, uint64_t owner) {
+    if (level == 0) return leaf;
+    RbPVectorNode *node = node_new(owner);
+    if (!node) return NULL;
+    node->as.children[0] = new_path(level - BITS, leaf, owner);
+    if (!node->as.children[0]) {
+        free(node);
+        return NULL;
+    }
+    node->length = 1;
+    return node;
+}
+
+/* A new leaf holding count values of leaf from first */
+static RbPVectorNode *leaf_copy(const RbPVectorNode *leaf, size_t first, size_t count) {
+    RbPVectorNode *copy = node_new(0);
+    if (!copy) return NULL;
+    for (size_t i = 0; i < count; i++) copy->as.values[i] = rb_value_clone(leaf->as.values[first + i]);
+    copy->length = (unsigned)count;
+    return copy;
+}
+
+/* Values in the trie (the tail holds the rest) */
+static inline size_t tree_count(size_t count, const RbPVectorNode *tail) {
+    return count - tail->length;
+}
+
+/* The leaf holding index; *index becomes its position there */
+static const RbPVectorNode *leaf_for(size_t count, unsigned shift, const RbPVectorNode *root,
+                                     const RbPVectorNode *tail, size_t *index) {
+    size_t in_tree = tree_count(count, tail);
+    if (*index >= in_tree) {
+        *index -= in_tree;
+        return tail;
+    }
+    const RbPVectorNode *node = root;
+    for (unsigned level = shift; level > 0; level -= BITS) {
+        node = node->as.children[child_index(node, level, index)];
+    }
+    return node;
+}
+
+/* ========== EDITS ==========
+ * Shared by versions and builders: a version update runs the same edit on
+ * a stack builder with owner 0, which copies every node it touches. */
+
+static bool trie_begin(RbPVectorBuilder *trie, const RbPVector *vector, uint64_t owner) {
+    trie->owner = owner;
+    trie->count = vector->count;
+    trie->shift = vector->shift;
+    trie->root = vector->root;
+    trie->tail = vector->tail;
+    node_retain(trie->root);
+    node_retain(trie->tail);
+    return true;
+}
+
+static void trie_free(RbPVectorBuilder *trie) {
+    node_release(trie->root, trie->shift);
+    node_release(trie->tail, 0);
+}
+
+static RbPVector *trie_seal(RbPVectorBuilder *trie) {
+    RbPVector *vector = malloc(sizeof(RbPVector));
+    if (!vector) {
+        trie_free(trie);
+        return NULL;
+    }
+    vector->refcount = 1;
+    vector->count = trie->count;
+    vector->shift = trie->shift;
+    vector->root = trie->root;
+    vector->tail = trie->tail;
+    return vector;
+}
+
+/* Whether another leaf fits on the right edge of a subtree */
+static bool has_room(const RbPVectorNode *node, unsigned level) {
+    if (node->length < WIDTH) return true;
+    return level > BITS && has_room(node->as.children[WIDTH - 1], level - BITS);
+}
+
+/* Append a leaf on the right edge of the subtree at *slot, which has room */
+static bool append_leaf(RbPVectorNode **slot, unsigned level, RbPVectorNode *leaf, uint64_t owner) {
+    RbPVectorNode *node = edit_slot(slot, level, owner);
+    if (!node) return false;
+    unsigned last = node->length - 1;
+
+    if (level > BITS && has_room(node->as.children[last], level - BITS)) {
+        if (!append_leaf(&node->as.children[last], level - BITS, leaf, owner)) return false;
+        if (node->sizes) node->sizes[last] += leaf->length;
+        return true;
+    }
+
+    /* A new child; a radix branch whose last child is not full turns relaxed */
+    size_t before = node->sizes ? node->sizes[last] : node_count(node, level);
+    if (!node->sizes && node_count(node->as.children[last], level - BITS) != (size_t)1 << level) {
+        if (!(node->sizes = malloc(WIDTH * sizeof(size_t)))) return false;
+        for (unsigned i = 0; i < last; i++) node->sizes[i] = (size_t)(i + 1) << level;
+        node->sizes[last] = before;
+    }
+    RbPVectorNode *path = new_path(level - BITS, leaf, owner);
+    if (!path) return false;
+    if (node->sizes) node->sizes[node->length] = before + leaf->length;
+    node->as.children[node->length++] = path;
+    return true;
+}
+
+/* Move a leaf (the reference passes to the trie) onto the end of the trie */
+static bool tree_append(RbPVectorBuilder *trie, RbPVectorNode *leaf) {
+    if (!trie->root) {
+        RbPVectorNode *root = new_path(BITS, leaf, trie->owner);
+        if (!root) return false;
+        trie->root = root;
+        trie->shift = BITS;
+        return true;
+    }
+    if (has_room(trie->root, trie->shift)) return append_leaf(&trie->root, trie->shift, leaf, trie->owner);
+
+    /* The tree is full at this height: grow a level */
+    RbPVectorNode *root = node_new(trie->owner);
+    RbPVectorNode *path = root ? new_path(trie->shift, leaf, trie->owner) : NULL;
+    if (!path) {
+        free(root);
+        return false;
+    }
+    root->as.children[0] = trie->root;
+    root->as.children[1] = path;
+    root->length = 2;
+    if (!branch_sizes(root, trie->shift + BITS)) {
+        node_retain(leaf);      /* the leaf stays the caller's */
+        node_release(path, trie->shift);
+        free(root);
+        return false;
+    }
+    trie->root = root;
+    trie->shift += BITS;
+    return true;
+}
+
+static bool trie_push(RbPVectorBuilder *trie, RbValue value) {
+    if (trie->tail->length < WIDTH) {
+        RbPVectorNode *tail = edit_slot(&trie->tail, 0, trie->owner);
+        if (!tail) return false;
+        tail->as.values[tail->length++] = rb_value_clone(value);
+        trie->count++;
+        return true;
+    }
+
+    /* The tail is full: it moves into the tree and a new one starts */
+    RbPVectorNode *tail = node_new(trie->owner);
+    if (!tail) return false;
+    if (!tree_append(trie, trie->tail)) {
+        free(tail);
+        return false;
+    }
+    tail->as.values[0] = rb_value_clone(value);
+    tail->length = 1;
+    trie->tail = tail;
+    trie->count++;
+    return true;
+}
+
+static bool trie_set(RbPVectorBuilder *trie, size_t index, RbValue value) {
+    if (index == trie->count) return trie_push(trie, value);
+    if (index > trie->count) return false;
+
+    RbPVectorNode *leaf;
+    size_t in_tree = tree_count(trie->count, trie->tail);
+    if (index >= in_tree) {
+        leaf = edit_slot(&trie->tail, 0, trie->owner);
+        index -= in_tree;
+    } else {
+        RbPVectorNode **slot = &trie->root;
+        leaf = NULL;
+        for (unsigned level = trie->shift;; level -= BITS) {
+            RbPVectorNode *node = edit_slot(slot, level, trie->owner);
+            if (!node || level == 0) {
+                leaf = node;
+                break;
+            }
+            slot = &node->as.children[child_index(node, level, &index)];
+        }
+    }
+    if (!leaf) return false;
+
+    rb_value_free(leaf->as.values[index]);
+    leaf->as.values[index] = rb_value_clone(value);
+    return true;
+}
+
+/* Detach the rightmost leaf of the subtree at *slot into *leaf. Returns 1
+ * when the subtree is left empty (the caller drops it), 0 when not and -1
+ * when out of memory. */
+static int pop_leaf(RbPVectorNode **slot, unsigned level, uint64_t owner, RbPVectorNode **leaf) {
+    RbPVectorNode *node = edit_slot(slot, level, owner);
+    if (!node) return -1;
+    unsigned last = node->length - 1;
+    if (level == BITS) {
+        *leaf = node->as.children[last];
+    } else {
+        int emptied = pop_leaf(&node->as.children[last], level - BITS, owner, leaf);
+        if (emptied < 0) return -1;
+        if (!emptied) {
+            if (node->sizes) node->sizes[last] -= (*leaf)->length;
+            return 0;
+        }
+        node_release(node->as.children[last], level - BITS);
+    }
+    node->as.children[last] = NULL;
+    node->length--;
+    return node->length == 0;
+}
+
+/* Drop branches with a single child from the top of the trie */
+static void trie_shrink(RbPVectorBuilder *trie) {
+    while (trie->shift > BITS && trie->root->length == 1) {
+        RbPVectorNode *child = trie->root->as.children[0];
+        node_retain(child);
+        node_release(trie->root, trie->shift);
+        trie->root = child;
+        trie->shift -= BITS;
+    }
+}
+
+/* The trie's last leaf becomes the tail (which must be empty or released) */
+static bool trie_take_tail(RbPVectorBuilder *trie) {
+    RbPVectorNode *leaf = NULL;
+    int emptied = pop_leaf(&trie->root, trie->shift, trie->owner, &leaf);
+    if (emptied < 0) return false;
+    if (emptied) {
+        node_release(trie->root, trie->shift);
+        trie->root = NULL;
+        trie->shift = 0;
+    } else {
+        trie_shrink(trie);
+    }
+    node_release(trie->tail, 0);
+    trie->tail = leaf;
+    return true;
+}
+
+static bool trie_pop(RbPVectorBuilder *trie) {
+    if (trie->count == 0) return false;
+
+    if (trie->tail->length > 1 || !trie->root) {
+        RbPVectorNode *tail = edit_slot(&trie->tail, 0, trie->owner);
+        if (!tail) return false;
+        tail->length--;
+        rb_value_free(tail->as.values[tail->length]);
+        tail->as.values[tail->length] = rb_value_null();
+        trie->count--;
+        return true;
+    }
+
+    /* The tail empties: the last leaf of the tree becomes the tail */
+    if (!trie_take_tail(trie)) return false;
+    trie->count--;
+    return true;
+}
+
+/* ========== CONCATENATION ==========
+ * RRB concatenation (Bagwell & Rompf): the two trees are zipped together
+ * down their facing edges, and at each level the nodes along the seam are
+ * redistributed so that level holds at most EXTRAS more nodes than it
+ * minimally needs. Everything away from the seam is shared. */
+
+/* A new branch over children (references taken) */
+static RbPVectorNode *branch_of(RbPVectorNode **children, unsigned count, unsigned level) {
+    RbPVectorNode *node = node_new(0);
+    if (!node) return NULL;
+    memcpy(node->as.children, children, count * sizeof(RbPVectorNode *));
+    node->length = count;
+    if (!branch_sizes(node, level)) {
+        free(node);
+        return NULL;
+    }
+    return node;
+}
+
+/* New lengths for the nodes along a seam: full nodes stay, and runs of
+ * short ones are packed left until the count is within EXTRAS of optimal */
+static unsigned concat_plan(unsigned *lengths, unsigned count) {
+    size_t slots = 0;
+    for (unsigned i = 0; i < count; i++) slots += lengths[i];
+    unsigned optimal = (unsigned)((slots + WIDTH - 1) / WIDTH);
+    unsigned i = 0;
+    while (optimal + EXTRAS < count) {
+        while (lengths[i] > WIDTH - 1) i++;
+        unsigned remaining = lengths[i];
+        do {
+            unsigned fill = remaining + lengths[i + 1] < WIDTH ? remaining + lengths[i + 1] : WIDTH;
+            remaining = remaining + lengths[i + 1] - fill;
+            lengths[i++] = fill;
+        } while (remaining > 0);
+        memmove(lengths + i, lengths + i + 1, (count - i - 1) * sizeof(unsigned));
+        count--;
+        i--;
+    }
+    return count;
+}
+
+/* Redistribute the children of left (but its last), center and right (but
+ * its first), all branches at level, into nodes sized by concat_plan.
+ * Returns a branch one level up holding the one or two results. */
+static RbPVectorNode *concat_rebalance(const RbPVectorNode *left, const RbPVectorNode *center,
+                                       const RbPVectorNode *right, unsigned level) {
+    RbPVectorNode *all[3 * WIDTH];
+    unsigned lengths[3 * WIDTH], count = 0;
+    if (left) {
+        for (unsigned i = 0; i + 1 < left->length; i++) all[count++] = left->as.children[i];
+    }
+    for (unsigned i = 0; i < center->length; i++) all[count++] = center->as.children[i];
+    if (right) {
+        for (unsigned i = 1; i < right->length; i++) all[count++] = right->as.children[i];
+    }
+    for (unsigned i = 0; i < count; i++) lengths[i] = all[i]->length;
+    unsigned planned = concat_plan(lengths, count);
+
+    /* Stream the old nodes' slots into the planned nodes, reusing any old
+     * node that comes out unchanged */
+    unsigned child = level - BITS;
+    RbPVectorNode *built[2 * WIDTH];
+    unsigned from = 0, offset = 0, made = 0;
+    for (; made < planned; made++) {
+        if (offset == 0 && all[from]->length == lengths[made]) {
+            node_retain(all[from]);
+            built[made] = all[from++];
+            continue;
+        }
+        RbPVectorNode *node = node_new(0);
+        if (!node) break;
+        while (node->length < lengths[made]) {
+            unsigned take = all[from]->length - offset;
+            if (take > lengths[made] - node->length) take = lengths[made] - node->length;
+            for (unsigned k = 0; k < take; k++) {
+                if (child == 0) {
+                    node->as.values[node->length + k] = rb_value_clone(all[from]->as.values[offset + k]);
+                } else {
+                    node->as.children[node->length + k] = all[from]->as.children[offset + k];
+                    node_retain(node->as.children[node->length + k]);
+                }
+            }
+            node->length += take;
+            offset += take;
+            if (offset == all[from]->length) {
+                from++;
+                offset = 0;
+            }
+        }
+        if (child > 0 && !branch_sizes(node, child)) {
+            node_release(node, child);
+            break;
+        }
+        built[made] = node;
+    }
+
+    RbPVectorNode *halves[2] = { NULL, NULL };
+    RbPVectorNode *top = NULL;
+    if (made == planned) {
+        unsigned first = planned < WIDTH ? planned : WIDTH;
+        halves[0] = branch_of(built, first, level);
+        halves[1] = halves[0] && planned > first ? branch_of(built + first, planned - first, level) : NULL;
+        if (halves[0] && (halves[1] || planned == first)) {
+            top = branch_of(halves, halves[1] ? 2 : 1, level + BITS);
+            if (top) return top;
+        }
+        /* The halves own built[] once made; release through them */
+        if (halves[0]) {
+            for (unsigned i = 0; i < (halves[1] ? planned : first); i++) built[i] = NULL;
+            node_release(halves[0], level);
+            node_release(halves[1], level);
+        }
+    }
+    for (unsigned i = 0; i < made; i++) node_release(built[i], child);
+    return NULL;
+}
+
+/* Concatenate two subtrees; the result is a branch one level above the
+ * taller of them, with one or two children */
+static RbPVectorNode *concat_subtree(RbPVectorNode *left, unsigned left_level,
+                                     RbPVectorNode *right, unsigned right_level) {
+    RbPVectorNode *center, *result;
+    if (left_level > right_level) {
+        center = concat_subtree(left->as.children[left->length - 1], left_level - BITS, right, right_level);
+        result = center ? concat_rebalance(left, center, NULL, left_level) : NULL;
+        node_release(center, left_level);
+        return result;
+    }
+    if (left_level < right_level) {
+        center = concat_subtree(left, left_level, right->as.children[0], right_level - BITS);
+        result = center ? concat_rebalance(NULL, center, right, right_level) : NULL;
+        node_release(center, right_level);
+        return result;
+    }
+    if (left_level == 0) {
+        RbPVectorNode *pair[2] = { left, right };
+        result = branch_of(pair, 2, BITS);
+        if (result) {
+            node_retain(left);
+            node_retain(right);
+        }
+        return result;
+    }
+    center = concat_subtree(left->as.children[left->length - 1], left_level - BITS,
+                            right->as.children[0], right_level - BITS);
+    result = center ? concat_rebalance(left, center, right, left_level) : NULL;
+    node_release(center, left_level);
+    return result;
+}
+
+/* ========== SLICING ========== */
+
+/* The first n (>= 1) values of a subtree, sharing every whole child */
+static RbPVectorNode *subtree_take(RbPVectorNode *node, unsigned level, size_t n) {
+    if (n == node_count(node, level)) {
+        node_retain(node);
+        return node;
+    }
+    if (level == 0) return leaf_copy(node, 0, n);
+    size_t local = n - 1;
+    unsigned i = child_index(node, level, &local);
+    RbPVectorNode *last = subtree_take(node->as.children[i], level - BITS, local + 1);
+    if (!last) return NULL;
+    RbPVectorNode *children[WIDTH];
+    for (unsigned k = 0; k < i; k++) children[k] = node->as.children[k];
+    children[i] = last;
+    RbPVectorNode *copy = branch_of(children, i + 1, level);
+    if (!copy) {
+        node_release(last, level - BITS);
+        return NULL;
+    }
+    for (unsigned k = 0; k < i; k++) node_retain(children[k]);
+    return copy;
+}
+
+/* A subtree without its first n (< its count) values */
+static RbPVectorNode *subtree_drop(RbPVectorNode *node, unsigned level, size_t n) {
+    if (n == 0) {
+        node_retain(node);
+        return node;
+    }
+    if (level == 0) return leaf_copy(node, n, node->length - n);
+    size_t local = n;
+    unsigned i = child_index(node, level, &local);
+    RbPVectorNode *first = subtree_drop(node->as.children[i], level - BITS, local);
+    if (!first) return NULL;
+    RbPVectorNode *children[WIDTH];
+    unsigned count = node->length - i;
+    children[0] = first;
+    for (unsigned k = 1; k < count; k++) children[k] = node->as.children[i + k];
+    RbPVectorNode *copy = branch_of(children, count, level);
+    if (!copy) {
+        node_release(first, level - BITS);
+        return NULL;
+    }
+    for (unsigned k = 1; k < count; k++) node_retain(children[k]);
+    return copy;
+}
+
+/* ========== VERSIONS ========== */
+
+RbPVector *rb_pvector_new(void) {
+    RbPVector *vector = malloc(sizeof(RbPVector));
+    if (!vector) return NULL;
+    vector->tail = node_new(0);
+    if (!vector->tail) {
+        free(vector);
+        return NULL;
+    }
+    vector->refcount = 1;
+    vector->count = 0;
+    vector->shift = 0;
+    vector->root = NULL;
+    return vector;
+}
+
+RbPVector *rb_pvector_retain(RbPVector *vector) {
+    if (vector) __atomic_add_fetch(&vector->refcount, 1, __ATOMIC_RELAXED);
+    return vector;
+}
+
+void rb_pvector_release(RbPVector *vector) {
+    if (!vector || __atomic_sub_fetch(&vector->refcount, 1, __ATOMIC_ACQ_REL) != 0) return;
+    node_release(vector->root, vector->shift);
+    node_release(vector->tail, 0);
+    free(vector);
+}
+
+size_t rb_pvector_len(const RbPVector *vector) {
+    return vector ? vector->count : 0;
+}
+
+RbValue rb_pvector_get(const RbPVector *vector, size_t index) {
+    if (!vector || index >= vector->count) return rb_value_null();
+    const RbPVectorNode *leaf = leaf_for(vector->count, vector->shift, vector->root, vector->tail, &index);
+    return leaf->as.values[index];
+}
+
+/* ========== UPDATES ========== */
+
+RbPVector *rb_pvector_push(const RbPVector *vector, RbValue value) {
+    RbPVectorBuilder trie;
+    if (!vector || !trie_begin(&trie, vector, 0)) return NULL;
+    if (!trie_push(&trie, value)) {
+        trie_free(&trie);
+        return NULL;
+    }
+    return trie_seal(&trie);
+}
+
+RbPVector *rb_pvector_set(const RbPVector *vector, size_t index, RbValue value) {
+    RbPVectorBuilder trie;
+    if (!vector || !trie_begin(&trie, vector, 0)) return NULL;
+    if (!trie_set(&trie, index, value)) {
+        trie_free(&trie);
+        return NULL;
+    }
+    return trie_seal(&trie);
+}
+
+RbPVector *rb_pvector_pop(const RbPVector *vector) {
+    RbPVectorBuilder trie;
+    if (!vector || !trie_begin(&trie, vector, 0)) return NULL;
+    if (!trie_pop(&trie)) {
+        trie_free(&trie);
+        return NULL;
+    }
+    return trie_seal(&trie);
+}
+
+/* The left tail goes into the left tree as a (possibly short) leaf, the
+ * trees are concatenated, and the right tail stays the tail. A right side
+ * that is all tail is pushed value by value instead, keeping the tree
+ * radix. */
+RbPVector *rb_pvector_concat(const RbPVector *left, const RbPVector *right) {
+    if (!left || !right) return NULL;
+    if (right->count == 0) return rb_pvector_retain((RbPVector *)left);
+    if (left->count == 0) return rb_pvector_retain((RbPVector *)right);
+
+    RbPVectorBuilder trie;
+    trie_begin(&trie, left, 0);
+    if (!right->root) {
+        for (unsigned i = 0; i < right->tail->length; i++) {
+            if (!trie_push(&trie, right->tail->as.values[i])) {
+                trie_free(&trie);
+                return NULL;
+            }
+        }
+        return trie_seal(&trie);
+    }
+
+    node_retain(trie.tail);
+    if (!tree_append(&trie, trie.tail)) {
+        node_release(trie.tail, 0);
+        trie_free(&trie);
+        return NULL;
+    }
+    RbPVectorNode *root = concat_subtree(trie.root, trie.shift, right->root, right->shift);
+    unsigned shift = (trie.shift > right->shift ? trie.shift : right->shift) + BITS;
+    trie_free(&trie);
+    if (!root) return NULL;
+
+    trie.count = left->count + right->count;
+    trie.root = root;
+    trie.shift = shift;
+    trie.tail = right->tail;
+    node_retain(trie.tail);
+    trie_shrink(&trie);
+    return trie_seal(&trie);
+}
+
+/* Values [start, end) (clamped to the vector): the cut edges are copied,
+ * everything between them shared. The tail is kept when the slice reaches
+ * into it; otherwise the slice's last leaf becomes its tail. */
+RbPVector *rb_pvector_slice(const RbPVector *vector, size_t start, size_t end) {
+    if (!vector) return NULL;
+    if (end > vector->count) end = vector->count;
+    if (start > end) start = end;
+    if (start == 0 && end == vector->count) return rb_pvector_retain((RbPVector *)vector);
+    if (start == end) return rb_pvector_new();
+
+    size_t in_tree = tree_count(vector->count, vector->tail);
+    RbPVectorBuilder trie = { 0, end - start, 0, NULL, NULL };
+    if (start >= in_tree) {
+        trie.tail = leaf_copy(vector->tail, start - in_tree, end - start);
+        return trie.tail ? trie_seal(&trie) : NULL;
+    }
+
+    if (end > in_tree) {
+        trie.tail = end == vector->count ? vector->tail : leaf_copy(vector->tail, 0, end - in_tree);
+        if (!trie.tail) return NULL;
+        if (end == vector->count) node_retain(trie.tail);
+        trie.root = subtree_drop(vector->root, vector->shift, start);
+    } else {
+        RbPVectorNode *head = subtree_take(vector->root, vector->shift, end);
+        trie.root = head ? subtree_drop(head, vector->shift, start) : NULL;
+        node_release(head, vector->shift);
+    }
+    trie.shift = vector->shift;
+    if (!trie.root) {
+        node_release(trie.tail, 0);
+        return NULL;
+    }
+    trie_shrink(&trie);
+    if (!trie.tail && !trie_take_tail(&trie)) {
+        trie_free(&trie);
+        return NULL;
+    }
+    return trie_seal(&trie);
+}
+
+/* ========== BUILDERS ========== */
+
+RbPVectorBuilder *rb_pvector_builder(const RbPVector *vector) {
+    if (!vector) return NULL;
+    RbPVectorBuilder *builder = malloc(sizeof(RbPVectorBuilder));
+    if (!builder) return NULL;
+    trie_begin(builder, vector, __atomic_fetch_add(&next_owner, 1, __ATOMIC_RELAXED));
+    return builder;
+}
+
+bool rb_pvector_builder_push(RbPVectorBuilder *builder, RbValue value) {
+    return builder && trie_push(builder, value);
+}
+
+bool rb_pvector_builder_set(RbPVectorBuilder *builder, size_t index, RbValue value) {
+    return builder && trie_set(builder, index, value);
+}
+
+bool rb_pvector_builder_pop(RbPVectorBuilder *builder) {
+    return builder && trie_pop(builder);
+}
+
+/* The owner stamp is never reused, so nodes this builder created become
+ * immutable the moment it is sealed */
+RbPVector *rb_pvector_build(RbPVectorBuilder *builder) {
+    if (!builder) return NULL;
+    RbPVector *vector = trie_seal(builder);
+    free(builder);
+    return vector;
+}
+
+void rb_pvector_builder_free(RbPVectorBuilder *builder) {
+    if (!builder) return;
+    trie_free(builder);
+    free(builder);
+}
+
+/* ========== ITERATION ========== */
+
+RbPVectorIter rb_pvector_iter(const RbPVector *vector) {
+    RbPVectorIter it = { vector, 0, NULL, 0, 0 };
+    return it;
+}
+
+bool rb_pvector_next(RbPVectorIter *it, RbValue *out) {
+    const RbPVector *vector = it->vector;
+    if (!vector || it->index >= vector->count) return false;
+    if (!it->leaf || it->index >= it->leaf_end) {
+        size_t offset = it->index;
+        const RbPVectorNode *leaf = leaf_for(vector->count, vector->shift, vector->root, vector->tail, &offset);
+        it->leaf = leaf->as.values;
+        it->leaf_start = it->index - offset;
+        it->leaf_end = it->leaf_start + leaf->length;
+    }
+    *out = it->leaf[it->index - it->leaf_start];
+    it->index++;
+    return true;
+}
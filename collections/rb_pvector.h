@@ -0,0 +1,113 @@
+#ifndef RB_PVECTOR_H
+#define RB_PVECTOR_H
+
+#include "rb_collections.h"
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Persistent vector: an immutable 32-way relaxed radix balanced (RRB) trie
+ * with a tail buffer. Every "modification" returns a new version that
+ * shares all untouched nodes with the old one, so a snapshot is a pointer
+ * copy and an update copies only the O(log32 n) nodes on one root-to-leaf
+ * path. Appends and pops touch only the tail 31 times out of 32.
+ *
+ * Concatenation and slicing are O(log32 n) too: they copy the nodes along
+ * the cut or seam and share the rest. They may leave partly filled leaves
+ * inside the trie; the branches above those keep a table of subtree sizes,
+ * and indexing through them costs a short scan per level.
+ *
+ * Versions and nodes are reference counted with atomic operations and
+ * never change once published, so any version can be handed to other
+ * threads without copying or locking. Each holder calls rb_pvector_release
+ * when done (retain adds a holder).
+ *
+ * A builder (transient) batch-edits a private version in place: nodes it
+ * created itself are mutated directly instead of being copied on every
+ * call. rb_pvector_build seals it into a normal version in O(1).
+ *
+ * Values are cloned on the way in and borrowed on the way out. */
+
+typedef struct RbPVectorNode RbPVectorNode;
+
+typedef struct RbPVector {
+    size_t refcount;
+    size_t count;
+    unsigned shift;             /* bits below the root's index */
+    RbPVectorNode *root;        /* NULL until more than one leaf */
+    RbPVectorNode *tail;        /* the last 1..32 values */
+} RbPVector;
+
+typedef struct RbPVectorBuilder {
+    uint64_t owner;             /* stamp on nodes this builder may mutate */
+    size_t count;
+    unsigned shift;
+    RbPVectorNode *root;
+    RbPVectorNode *tail;
+} RbPVectorBuilder;
+
+/* Borrowing cursor; caches the current leaf */
+typedef struct {
+    const RbPVector *vector;
+    size_t index;
+    const RbValue *leaf;
+    size_t leaf_start;          /* index of leaf[0] */
+    size_t leaf_end;            /* one past the leaf's last index */
+} RbPVectorIter;
+
+/* ========== VERSIONS ========== */
+
+/* A new empty vector */
+RbPVector *rb_pvector_new(void);
+
+/* Add / drop a holder; the last release frees the version */
+RbPVector *rb_pvector_retain(RbPVector *vector);
+void rb_pvector_release(RbPVector *vector);
+
+/* Number of values */
+size_t rb_pvector_len(const RbPVector *vector);
+
+/* Borrow value at index (null if out of range) */
+RbValue rb_pvector_get(const RbPVector *vector, size_t index);
+
+/* ========== UPDATES (each returns a new version) ========== */
+
+/* Append a value */
+RbPVector *rb_pvector_push(const RbPVector *vector, RbValue value);
+
+/* Replace the value at index (index == len appends) */
+RbPVector *rb_pvector_set(const RbPVector *vector, size_t index, RbValue value);
+
+/* Drop the last value */
+RbPVector *rb_pvector_pop(const RbPVector *vector);
+
+/* left's values followed by right's */
+RbPVector *rb_pvector_concat(const RbPVector *left, const RbPVector *right);
+
+/* Values [start, end), clamped to the vector */
+RbPVector *rb_pvector_slice(const RbPVector *vector, size_t start, size_t end);
+
+/* ========== BUILDERS ========== */
+
+/* Start a batch of edits from a version (which stays unchanged) */
+RbPVectorBuilder *rb_pvector_builder(const RbPVector *vector);
+
+/* In-place edits; false if out of memory / out of range */
+bool rb_pvector_builder_push(RbPVectorBuilder *builder, RbValue value);
+bool rb_pvector_builder_set(RbPVectorBuilder *builder, size_t index, RbValue value);
+bool rb_pvector_builder_pop(RbPVectorBuilder *builder);
+
+/* Seal the builder into a version; the builder is freed */
+RbPVector *rb_pvector_build(RbPVectorBuilder *builder);
+
+/* Discard a builder without producing a version */
+void rb_pvector_builder_free(RbPVectorBuilder *builder);
+
+/* ========== ITERATION ========== */
+
+RbPVectorIter rb_pvector_iter(const RbPVector *vector);
+
+/* Borrow the next value; false at the end */
+bool rb_pvector_next(RbPVectorIter *it, RbValue *out);
+
+#endif /* RB_PVECTOR_H */
@@ -0,0 +1,571 @@
+#include "rb_sort.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SIGN_BIT 0x8000000000000000ULL
+
+#define RADIX_MIN 256           /* Below this pdqsort beats the histogram setup */
+#define MKQS_INSERTION 16
+#define PDQ_INSERTION 24
+#define PDQ_NINTHER 128
+#define PDQ_PARTIAL_LIMIT 8
+#define MERGE_RUN 32
+
+/* ========== COMPARISON ========== */
+
+static inline int natural_compare(const RbValue *a, const RbValue *b) {
+    if (a->type != b->type) return (int)a->type - (int)b->type;
+    switch (a->type) {
+        case RB_VAL_INT:
+            return (a->data.i > b->data.i) - (a->data.i < b->data.i);
+        case RB_VAL_FLOAT:
+            return (a->data.f > b->data.f) - (a->data.f < b->data.f);
+        case RB_VAL_STRING:
+            if (!a->data.s || !b->data.s) return (a->data.s != NULL) - (b->data.s != NULL);
+            return strcmp(a->data.s, b->data.s);
+        default:
+            return 0;
+    }
+}
+
+int rb_compare_values(const void *a, const void *b) {
+    return natural_compare((const RbValue *)a, (const RbValue *)b);
+}
+
+/* A NULL comparator means the natural order, compiled inline */
+static inline bool less(const RbValue *a, const RbValue *b, RbCompareFn compare) {
+    return compare ? compare(a, b) < 0 : natural_compare(a, b) < 0;
+}
+
+static inline void swap_values(RbValue *a, RbValue *b) {
+    RbValue t = *a;
+    *a = *b;
+    *b = t;
+}
+
+typedef enum { KIND_MIXED, KIND_INT, KIND_FLOAT, KIND_STRING } SortKind;
+
+/* One pass: are all elements the same sortable type, and already sorted? */
+static SortKind detect_kind(const RbValue *items, size_t count, bool *sorted) {
+    RbValueType type = items[0].type;
+    bool homogeneous = true;
+    *sorted = true;
+    for (size_t i = 1; i < count && (homogeneous || *sorted); i++) {
+        if (items[i].type != type) homogeneous = false;
+        if (*sorted && natural_compare(&items[i - 1], &items[i]) > 0) *sorted = false;
+    }
+    if (!homogeneous) return KIND_MIXED;
+    switch (type) {
+        case RB_VAL_INT: return KIND_INT;
+        case RB_VAL_FLOAT: return KIND_FLOAT;
+        case RB_VAL_STRING: return KIND_STRING;
+        default: return KIND_MIXED;
+    }
+}
+
+/* ========== RADIX SORT ========== */
+/* Ints and floats map to unsigned keys with the same order: ints flip the
+ * sign bit; negative floats flip every bit, positive ones the sign bit. */
+
+static inline uint64_t int_key(int64_t i) {
+    return (uint64_t)i ^ SIGN_BIT;
+}
+
+static inline uint64_t float_key(double f) {
+    uint64_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return (bits & SIGN_BIT) ? ~bits : bits | SIGN_BIT;
+}
+
+static inline double float_from_key(uint64_t key) {
+    uint64_t bits = (key & SIGN_BIT) ? key ^ SIGN_BIT : ~key;
+    double f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/* LSD radix sort, 11 bits per pass (six passes cover 64 bits with 2K-entry
+ * histograms that stay in L1/L2). All histograms come from a single read
+ * of the keys, and passes where every key has the same digit (the high
+ * bits of small ints, say) are skipped. payload, if given, is permuted
+ * along with the keys, which keeps the sort stable. False if out of memory. */
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1u << RADIX_BITS)
+#define RADIX_PASSES ((64 + RADIX_BITS - 1) / RADIX_BITS)
+
+static bool radix_sort(uint64_t *keys, uint64_t *key_tmp, size_t *payload, size_t *payload_tmp, size_t n) {
+    size_t (*hist)[RADIX_BUCKETS] = calloc(RADIX_PASSES, sizeof(*hist));
+    if (!hist) return false;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = keys[i];
+        for (int d = 0; d < RADIX_PASSES; d++) hist[d][(k >> (RADIX_BITS * d)) & (RADIX_BUCKETS - 1)]++;
+    }
+
+    uint64_t *src = keys, *dst = key_tmp;
+    size_t *psrc = payload, *pdst = payload_tmp;
+    for (int d = 0; d < RADIX_PASSES; d++) {
+        unsigned shift = RADIX_BITS * (unsigned)d;
+        if (hist[d][(src[0] >> shift) & (RADIX_BUCKETS - 1)] == n) continue;
+
+        size_t *offsets = hist[d], sum = 0;
+        for (unsigned b = 0; b < RADIX_BUCKETS; b++) {
+            size_t count = offsets[b];
+            offsets[b] = sum;
+            sum += count;
+        }
+        if (psrc) {
+            for (size_t i = 0; i < n; i++) {
+                size_t slot = offsets[(src[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+                dst[slot] = src[i];
+                pdst[slot] = psrc[i];
+            }
+            size_t *pt = psrc; psrc = pdst; pdst = pt;
+        } else {
+            for (size_t i = 0; i < n; i++) dst[offsets[(src[i] >> shift) & (RADIX_BUCKETS - 1)]++] = src[i];
+        }
+        uint64_t *t = src; src = dst; dst = t;
+    }
+    if (src != keys) {
+        memcpy(keys, src, n * sizeof(uint64_t));
+        if (payload) memcpy(payload, psrc, n * sizeof(size_t));
+    }
+    free(hist);
+    return true;
+}
+
+/* Sorts a homogeneous int or float array; false if out of memory */
+static bool radix_sort_numbers(RbValue *items, size_t n, SortKind kind) {
+    uint64_t *keys = malloc(2 * n * sizeof(uint64_t));
+    if (!keys) return false;
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = kind == KIND_INT ? int_key(items[i].data.i) : float_key(items[i].data.f);
+    }
+    if (!radix_sort(keys, keys + n, NULL, NULL, n)) {
+        free(keys);
+        return false;
+    }
+    /* The key is the whole value, so the sorted values are rebuilt from it */
+    for (size_t i = 0; i < n; i++) {
+        if (kind == KIND_INT) items[i].data.i = (int64_t)(keys[i] ^ SIGN_BIT);
+        else items[i].data.f = float_from_key(keys[i]);
+    }
+    free(keys);
+    return true;
+}
+
+/* ========== MULTIKEY QUICKSORT ========== */
+/* Bentley-Sedgewick: three-way partition on the character at `depth`, so
+ * each byte of a shared prefix is compared once per partition instead of in
+ * every strcmp. Every string in a call agrees on its first `depth` bytes. */
+
+static inline int char_at(const char *s, size_t depth) {
+    return (unsigned char)s[depth];
+}
+
+static inline void swap_strings(char **a, char **b) {
+    char *t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static void mkqs(char **a, size_t n, size_t depth) {
+    while (n > MKQS_INSERTION) {
+        size_t m = n / 2;
+        int x = char_at(a[0], depth), y = char_at(a[m], depth), z = char_at(a[n - 1], depth);
+        size_t p = x < y ? (y < z ? m : (x < z ? n - 1 : 0)) : (x < z ? 0 : (y < z ? n - 1 : m));
+        int v = char_at(a[p], depth);
+
+        size_t lt = 0, i = 0, gt = n;
+        while (i < gt) {
+            int c = char_at(a[i], depth);
+            if (c < v) swap_strings(&a[lt++], &a[i++]);
+            else if (c > v) swap_strings(&a[i], &a[--gt]);
+            else i++;
+        }
+        /* Recurse into the two smaller parts and loop on the largest, so the
+         * stack stays O(log n) however long the shared prefixes are. The
+         * equal part moves one byte deeper; if v is the terminator its
+         * strings are identical and already in place. */
+        char **part[3] = { a, a + lt, a + gt };
+        size_t size[3] = { lt, v != 0 ? gt - lt : 0, n - gt };
+        size_t deeper[3] = { depth, depth + 1, depth };
+        int big = size[0] >= size[1] ? (size[0] >= size[2] ? 0 : 2) : (size[1] >= size[2] ? 1 : 2);
+        for (int k = 0; k < 3; k++) {
+            if (k != big) mkqs(part[k], size[k], deeper[k]);
+        }
+        a = part[big];
+        n = size[big];
+        depth = deeper[big];
+    }
+    for (size_t i = 1; i < n; i++) {
+        char *s = a[i];
+        size_t j = i;
+        while (j > 0 && strcmp(a[j - 1] + depth, s + depth) > 0) {
+            a[j] = a[j - 1];
+            j--;
+        }
+        a[j] = s;
+    }
+}
+
+/* Sorts a homogeneous string array; false if out of memory */
+static bool sort_strings(RbValue *items, size_t n) {
+    char **strings = malloc(n * sizeof(char *));
+    if (!strings) return false;
+    /* NULL strings order first */
+    size_t nulls = 0, count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (items[i].data.s) strings[count++] = items[i].data.s;
+        else nulls++;
+    }
+    mkqs(strings, count, 0);
+    for (size_t i = 0; i < nulls; i++) items[i].data.s = NULL;
+    for (size_t i = 0; i < count; i++) items[nulls + i].data.s = strings[i];
+    free(strings);
+    return true;
+}
+
+/* ========== PDQSORT ========== */
+/* Pattern-defeating quicksort (Orson Peters): median-of-3 / ninther pivots,
+ * partial insertion sort when a partition was already in order, equal-key
+ * partitioning when the pivot equals its predecessor, pivot shuffling on
+ * unbalanced partitions and heapsort after too many of them. Scans are
+ * bounds-checked so an inconsistent comparator cannot run off the array. */
+
+static void insertion_sort(RbValue *a, size_t n, RbCompareFn compare) {
+    for (size_t i = 1; i < n; i++) {
+        if (!less(&a[i], &a[i - 1], compare)) continue;
+        RbValue x = a[i];
+        size_t j = i;
+        do {
+            a[j] = a[j - 1];
+            j--;
+        } while (j > 0 && less(&x, &a[j - 1], compare));
+        a[j] = x;
+    }
+}
+
+/* Insertion sort that gives up after PDQ_PARTIAL_LIMIT moves */
+static bool partial_insertion_sort(RbValue *a, size_t n, RbCompareFn compare) {
+    size_t moves = 0;
+    for (size_t i = 1; i < n; i++) {
+        if (!less(&a[i], &a[i - 1], compare)) continue;
+        RbValue x = a[i];
+        size_t j = i;
+        do {
+            a[j] = a[j - 1];
+            j--;
+        } while (j > 0 && less(&x, &a[j - 1], compare));
+        a[j] = x;
+        moves += i - j;
+        if (moves > PDQ_PARTIAL_LIMIT) return false;
+    }
+    return true;
+}
+
+static void sift_down(RbValue *a, size_t root, size_t n, RbCompareFn compare) {
+    for (;;) {
+        size_t child = 2 * root + 1;
+        if (child >= n) return;
+        if (child + 1 < n && less(&a[child], &a[child + 1], compare)) child++;
+        if (!less(&a[root], &a[child], compare)) return;
+        swap_values(&a[root], &a[child]);
+        root = child;
+    }
+}
+
+static void heap_sort(RbValue *a, size_t n, RbCompareFn compare) {
+    for (size_t i = n / 2; i-- > 0;) sift_down(a, i, n, compare);
+    for (size_t end = n; end-- > 1;) {
+        swap_values(&a[0], &a[end]);
+        sift_down(a, 0, end, compare);
+    }
+}
+
+static inline void sort2(RbValue *a, RbValue *b, RbCompareFn compare) {
+    if (less(b, a, compare)) swap_values(a, b);
+}
+
+static inline void sort3(RbValue *a, RbValue *b, RbValue *c, RbCompareFn compare) {
+    sort2(a, b, compare);
+    sort2(b, c, compare);
+    sort2(a, b, compare);
+}
+
+/* Partition around a[0]; elements equal to the pivot go right. Returns the
+ * pivot's final index. */
+static size_t partition_right(RbValue *a, size_t n, RbCompareFn compare, bool *already_partitioned) {
+    RbValue pivot = a[0];
+    size_t first = 0, last = n;
+    while (++first < n && less(&a[first], &pivot, compare));
+    if (first == 1) {
+        while (first < last && !less(&a[--last], &pivot, compare));
+    } else {
+        while (last > first && !less(&a[--last], &pivot, compare));
+    }
+    *already_partitioned = first >= last;
+    while (first < last) {
+        swap_values(&a[first], &a[last]);
+        while (++first < n && less(&a[first], &pivot, compare));
+        while (last > 0 && !less(&a[--last], &pivot, compare));
+    }
+    size_t pivot_pos = first - 1;
+    a[0] = a[pivot_pos];
+    a[pivot_pos] = pivot;
+    return pivot_pos;
+}
+
+/* Partition around a[0] with equal elements on the left; used when the
+ * pivot equals the element before this range, so the whole left part is
+ * equal and needs no further sorting */
+static size_t partition_left(RbValue *a, size_t n, RbCompareFn compare) {
+    RbValue pivot = a[0];
+    size_t first = 0, last = n;
+    while (last > 0 && less(&pivot, &a[--last], compare));
+    if (last + 1 == n) {
+        while (first < last && !less(&pivot, &a[++first], compare));
+    } else {
+        while (first + 1 < n && !less(&pivot, &a[++first], compare));
+    }
+    while (first < last) {
+        swap_values(&a[first], &a[last]);
+        while (last > 0 && less(&pivot, &a[--last], compare));
+        while (first + 1 < n && !less(&pivot, &a[++first], compare));
+    }
+    a[0] = a[last];
+    a[last] = pivot;
+    return last;
+}
+
+static void pdq_loop(RbValue *a, size_t n, RbCompareFn compare, int bad_allowed, bool leftmost) {
+    for (;;) {
+        if (n < PDQ_INSERTION) {
+            insertion_sort(a, n, compare);
+            return;
+        }
+
+        /* Pivot to a[0] */
+        size_t s2 = n / 2;
+        if (n > PDQ_NINTHER) {
+            sort3(&a[0], &a[s2], &a[n - 1], compare);
+            sort3(&a[1], &a[s2 - 1], &a[n - 2], compare);
+            sort3(&a[2], &a[s2 + 1], &a[n - 3], compare);
+            sort3(&a[s2 - 1], &a[s2], &a[s2 + 1], compare);
+            swap_values(&a[0], &a[s2]);
+        } else {
+            sort3(&a[s2], &a[0], &a[n - 1], compare);
+        }
+
+        /* a[-1] is the previous pivot; equal to this one means a run of
+         * equal keys, which partition_left peels off in one step */
+        if (!leftmost && !less(&a[-1], &a[0], compare)) {
+            size_t pos = partition_left(a, n, compare);
+            a += pos + 1;
+            n -= pos + 1;
+            continue;
+        }
+
+        bool already_partitioned;
+        size_t pos = partition_right(a, n, compare, &already_partitioned);
+        size_t l_size = pos, r_size = n - pos - 1;
+
+        if (l_size < n / 8 || r_size < n / 8) {
+            if (--bad_allowed == 0) {
+                heap_sort(a, n, compare);
+                return;
+            }
+            if (l_size >= PDQ_INSERTION) {
+                swap_values(&a[0], &a[l_size / 4]);
+                swap_values(&a[pos - 1], &a[pos - l_size / 4]);
+                if (l_size > PDQ_NINTHER) {
+                    swap_values(&a[1], &a[l_size / 4 + 1]);
+                    swap_values(&a[2], &a[l_size / 4 + 2]);
+                    swap_values(&a[pos - 2], &a[pos - (l_size / 4 + 1)]);
+                    swap_values(&a[pos - 3], &a[pos - (l_size / 4 + 2)]);
+                }
+            }
+            if (r_size >= PDQ_INSERTION) {
+                swap_values(&a[pos + 1], &a[pos + 1 + r_size / 4]);
+                swap_values(&a[n - 1], &a[n - r_size / 4]);
+                if (r_size > PDQ_NINTHER) {
+                    swap_values(&a[pos + 2], &a[pos + 2 + r_size / 4]);
+                    swap_values(&a[pos + 3], &a[pos + 3 + r_size / 4]);
+                    swap_values(&a[n - 2], &a[n - (1 + r_size / 4)]);
+                    swap_values(&a[n - 3], &a[n - (2 + r_size / 4)]);
+                }
+            }
+        } else if (already_partitioned &&
+                   partial_insertion_sort(a, pos, compare) &&
+                   partial_insertion_sort(a + pos + 1, r_size, compare)) {
+            return;
+        }
+
+        /* Recurse into the left part, loop on the right */
+        pdq_loop(a, pos, compare, bad_allowed, leftmost);
+        a += pos + 1;
+        n = r_size;
+        leftmost = false;
+    }
+}
+
+static void pdqsort(RbValue *a, size_t n, RbCompareFn compare) {
+    int log2n = 0;
+    for (size_t m = n; m > 1; m >>= 1) log2n++;
+    pdq_loop(a, n, compare, log2n, true);
+}
+
+/* ========== STABLE SORT ========== */
+/* Stable sorts work on (key, original index) pairs and produce the
+ * permutation; the caller then gathers the elements in that order. */
+
+typedef struct {
+    RbValue key;
+    size_t index;
+} KeyedValue;
+
+static void insertion_sort_keyed(KeyedValue *a, size_t n, RbCompareFn compare) {
+    for (size_t i = 1; i < n; i++) {
+        KeyedValue x = a[i];
+        size_t j = i;
+        while (j > 0 && less(&x.key, &a[j - 1].key, compare)) {
+            a[j] = a[j - 1];
+            j--;
+        }
+        a[j] = x;
+    }
+}
+
+/* Bottom-up merge sort over insertion-sorted runs; adjacent runs that are
+ * already in order are copied without merging */
+static void merge_sort_keyed(KeyedValue *a, KeyedValue *tmp, size_t n, RbCompareFn compare) {
+    for (size_t i = 0; i < n; i += MERGE_RUN) {
+        insertion_sort_keyed(a + i, n - i < MERGE_RUN ? n - i : MERGE_RUN, compare);
+    }
+    KeyedValue *src = a, *dst = tmp;
+    for (size_t width = MERGE_RUN; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            if (mid == hi || !less(&src[mid].key, &src[mid - 1].key, compare)) {
+                memcpy(dst + lo, src + lo, (hi - lo) * sizeof(KeyedValue));
+                continue;
+            }
+            size_t i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                /* Ties take the left element */
+                dst[k++] = less(&src[j].key, &src[i].key, compare) ? src[j++] : src[i++];
+            }
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
+        }
+        KeyedValue *t = src; src = dst; dst = t;
+    }
+    if (src != a) memcpy(a, src, n * sizeof(KeyedValue));
+}
+
+/* order[j] = index of the element that belongs at position j */
+static bool stable_order(const RbValue *keys, size_t n, RbCompareFn compare, size_t *order) {
+    bool sorted;
+    SortKind kind = compare ? KIND_MIXED : detect_kind(keys, n, &sorted);
+
+    if (kind == KIND_INT || kind == KIND_FLOAT) {
+        uint64_t *radix_keys = malloc(2 * n * sizeof(uint64_t));
+        size_t *tmp = malloc(n * sizeof(size_t));
+        bool done = false;
+        if (radix_keys && tmp) {
+            for (size_t i = 0; i < n; i++) {
+                if (kind == KIND_INT) {
+                    radix_keys[i] = int_key(keys[i].data.i);
+                } else {
+                    /* -0.0 == 0.0, so they must share a key to stay in order */
+                    radix_keys[i] = float_key(keys[i].data.f == 0.0 ? 0.0 : keys[i].data.f);
+                }
+                order[i] = i;
+            }
+            done = radix_sort(radix_keys, radix_keys + n, order, tmp, n);
+        }
+        free(radix_keys);
+        free(tmp);
+        if (done) return true;
+    }
+
+    KeyedValue *keyed = malloc(2 * n * sizeof(KeyedValue));
+    if (!keyed) return false;
+    for (size_t i = 0; i < n; i++) {
+        keyed[i].key = keys[i];
+        keyed[i].index = i;
+    }
+    merge_sort_keyed(keyed, keyed + n, n, compare);
+    for (size_t i = 0; i < n; i++) order[i] = keyed[i].index;
+    free(keyed);
+    return true;
+}
+
+/* Rearrange items into `order` */
+static bool gather(RbValue *items, size_t n, const size_t *order) {
+    RbValue *tmp = malloc(n * sizeof(RbValue));
+    if (!tmp) return false;
+    for (size_t i = 0; i < n; i++) tmp[i] = items[order[i]];
+    memcpy(items, tmp, n * sizeof(RbValue));
+    free(tmp);
+    return true;
+}
+
+/* ========== PUBLIC API ========== */
+
+void rb_sort_values(RbValue *items, size_t count, RbCompareFn compare) {
+    if (!items || count <= 1) return;
+    if (!compare) {
+        bool sorted;
+        SortKind kind = detect_kind(items, count, &sorted);
+        if (sorted) return;
+        if ((kind == KIND_INT || kind == KIND_FLOAT) && count >= RADIX_MIN &&
+            radix_sort_numbers(items, count, kind)) return;
+        if (kind == KIND_STRING && sort_strings(items, count)) return;
+    }
+    pdqsort(items, count, compare);
+}
+
+void rb_sort_values_stable(RbValue *items, size_t count, RbCompareFn compare) {
+    if (!items || count <= 1) return;
+    if (!compare) {
+        /* Equal ints or strings are indistinguishable, so any sort is stable */
+        bool sorted;
+        SortKind kind = detect_kind(items, count, &sorted);
+        if (sorted) return;
+        if (kind == KIND_INT || kind == KIND_STRING) {
+            rb_sort_values(items, count, NULL);
+            return;
+        }
+    }
+    size_t *order = malloc(count * sizeof(size_t));
+    if (order && stable_order(items, count, compare, order)) gather(items, count, order);
+    free(order);
+}
+
+void rb_sort_values_by_key(RbValue *items, size_t count, RbKeyFn key) {
+    if (!items || count <= 1 || !key) return;
+    RbValue *keys = malloc(count * sizeof(RbValue));
+    if (keys) {
+        for (size_t i = 0; i < count; i++) keys[i] = key(items[i]);
+        rb_sort_values_by_keys(items, keys, count);
+        for (size_t i = 0; i < count; i++) rb_value_free(keys[i]);
+    }
+    free(keys);
+}
+
+bool rb_sort_values_by_keys(RbValue *items, RbValue *keys, size_t count) {
+    if (!items || !keys || count <= 1) return true;
+    size_t *order = malloc(count * sizeof(size_t));
+    RbValue *tmp = malloc(count * sizeof(RbValue));
+    bool ok = order && tmp && stable_order(keys, count, NULL, order);
+    if (ok) {
+        for (size_t i = 0; i < count; i++) tmp[i] = items[order[i]];
+        memcpy(items, tmp, count * sizeof(RbValue));
+        for (size_t i = 0; i < count; i++) tmp[i] = keys[order[i]];
+        memcpy(keys, tmp, count * sizeof(RbValue));
+    }
+    free(order);
+    free(tmp);
+    return ok;
+}
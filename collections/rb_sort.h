@@ -0,0 +1,41 @@
+#ifndef RB_SORT_H
+#define RB_SORT_H
+
+#include "rb_collections.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Sorting for RbValue arrays (used by RbList). With no comparator the
+ * natural order is used: values are grouped by type, then ints and floats
+ * by value and strings bytewise. A first pass looks at the element types and
+ * picks an algorithm:
+ *   all ints / all floats   LSD radix sort on order-preserving 64-bit keys
+ *   all strings             multikey quicksort
+ *   anything else           pdqsort with the comparison inlined
+ * An explicit comparator always goes through pdqsort. */
+
+/* Key function for sort-by-key. The returned value is owned by the sort
+ * and freed with rb_value_free, so string keys must be fresh copies. */
+typedef RbValue (*RbKeyFn)(RbValue value);
+
+/* ========== SORTING ========== */
+
+/* Unstable in-place sort; compare may be NULL for the natural order */
+void rb_sort_values(RbValue *items, size_t count, RbCompareFn compare);
+
+/* Stable in-place sort (equal elements keep their order) */
+void rb_sort_values_stable(RbValue *items, size_t count, RbCompareFn compare);
+
+/* Stable sort by key(item) in natural key order; each key is computed once
+ * (decorate-sort-undecorate) */
+void rb_sort_values_by_key(RbValue *items, size_t count, RbKeyFn key);
+
+/* Stable sort of items by precomputed keys[i]; both arrays are permuted
+ * together and the keys stay owned by the caller. Returns false (arrays
+ * untouched) if scratch memory runs out */
+bool rb_sort_values_by_keys(RbValue *items, RbValue *keys, size_t count);
+
+/* The natural-order comparison, usable as an RbCompareFn */
+int rb_compare_values(const void *a, const void *b);
+
+#endif /* RB_SORT_H */
@@ -0,0 +1,505 @@
+#include "rb_sorted_set.h"
+#include "rb_sort.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NODE_BYTES 256
+#define CACHE_LINE 64
+#define LEAF_KEYS 15
+#define INNER_KEYS 10
+#define LEAF_MIN (LEAF_KEYS / 2)
+#define INNER_MIN (INNER_KEYS / 2)
+#define MAX_CHUNK_NODES 256
+
+/* Both node kinds start with the same header so a node can be inspected
+ * before its kind is known. Separators in inner nodes are cloned copies:
+ * every value in children[i] < keys[i] <= every value in children[i + 1]. */
+typedef struct {
+    uint16_t count;
+    bool leaf;
+} NodeHeader;
+
+typedef struct Leaf {
+    NodeHeader header;
+    struct Leaf *next;
+    RbValue keys[LEAF_KEYS];
+} Leaf;
+
+typedef struct {
+    NodeHeader header;
+    RbValue keys[INNER_KEYS];
+    void *children[INNER_KEYS + 1];
+} Inner;
+
+_Static_assert(sizeof(Leaf) <= NODE_BYTES, "leaf node too large");
+_Static_assert(sizeof(Inner) <= NODE_BYTES, "inner node too large");
+
+typedef struct Chunk {
+    struct Chunk *next;
+} Chunk;
+
+/* ========== HELPERS ========== */
+
+static inline int compare(const RbSortedSet *set, const RbValue *a, const RbValue *b) {
+    return set->compare ? set->compare(a, b) : rb_compare_values(a, b);
+}
+
+static inline bool is_leaf(const void *node) {
+    return ((const NodeHeader *)node)->leaf;
+}
+
+/* First index whose key is >= value (or > value when upper) */
+static size_t search(const RbSortedSet *set, const RbValue *keys, size_t count,
+                     const RbValue *value, bool upper) {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        int c = compare(set, &keys[mid], value);
+        if (c < 0 || (upper && c == 0)) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+/* ========== NODE ALLOCATION ========== */
+
+/* Nodes come from cache-line-aligned chunks that grow with the set, so a
+ * node never straddles more lines than it must */
+static bool add_chunk(RbSortedSet *set) {
+    size_t nodes = set->node_total < 4 ? 4 : set->node_total;
+    if (nodes > MAX_CHUNK_NODES) nodes = MAX_CHUNK_NODES;
+
+    char *raw = malloc(sizeof(Chunk) + CACHE_LINE - 1 + nodes * NODE_BYTES);
+    if (!raw) return false;
+    Chunk *chunk = (Chunk *)raw;
+    chunk->next = set->chunks;
+    set->chunks = chunk;
+
+    uintptr_t base = ((uintptr_t)(raw + sizeof(Chunk)) + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1);
+    for (size_t i = 0; i < nodes; i++) {
+        void **node = (void **)(base + i * NODE_BYTES);
+        *node = set->free_nodes;
+        set->free_nodes = node;
+    }
+    set->free_count += nodes;
+    set->node_total += nodes;
+    return true;
+}
+
+/* Make sure an insert can split every level without failing halfway */
+static bool reserve_nodes(RbSortedSet *set, size_t count) {
+    while (set->free_count < count) {
+        if (!add_chunk(set)) return false;
+    }
+    return true;
+}
+
+static void *take_node(RbSortedSet *set) {
+    void **node = set->free_nodes;
+    set->free_nodes = *node;
+    set->free_count--;
+    return node;
+}
+
+static void release_node(RbSortedSet *set, void *node) {
+    *(void **)node = set->free_nodes;
+    set->free_nodes = node;
+    set->free_count++;
+}
+
+static Leaf *new_leaf(RbSortedSet *set) {
+    Leaf *leaf = take_node(set);
+    leaf->header.count = 0;
+    leaf->header.leaf = true;
+    leaf->next = NULL;
+    return leaf;
+}
+
+static Inner *new_inner(RbSortedSet *set) {
+    Inner *inner = take_node(set);
+    inner->header.count = 0;
+    inner->header.leaf = false;
+    return inner;
+}
+
+static void free_subtree(RbSortedSet *set, void *node) {
+    NodeHeader *header = node;
+    if (header->leaf) {
+        Leaf *leaf = node;
+        for (size_t i = 0; i < header->count; i++) rb_value_free(leaf->keys[i]);
+    } else {
+        Inner *inner = node;
+        for (size_t i = 0; i < header->count; i++) rb_value_free(inner->keys[i]);
+        for (size_t i = 0; i <= header->count; i++) free_subtree(set, inner->children[i]);
+    }
+    release_node(set, node);
+}
+
+/* ========== CREATION & DESTRUCTION ========== */
+
+RbSortedSet *rb_sorted_set_new(RbCompareFn compare) {
+    RbSortedSet *set = (RbSortedSet *)calloc(1, sizeof(RbSortedSet));
+    if (!set) return NULL;
+    set->compare = compare;
+    return set;
+}
+
+void rb_sorted_set_free(RbSortedSet *set) {
+    if (!set) return;
+    rb_sorted_set_clear(set);
+    Chunk *chunk = set->chunks;
+    while (chunk) {
+        Chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(set);
+}
+
+void rb_sorted_set_clear(RbSortedSet *set) {
+    if (!set) return;
+    if (set->root) free_subtree(set, set->root);
+    set->root = NULL;
+    set->size = 0;
+    set->height = 0;
+    set->version++;
+}
+
+/* ========== INSERTION ========== */
+
+/* Insert into the subtree at node. Returns 0 if the value is already
+ * present, 1 otherwise; when the node had to split, *split is its new right
+ * sibling and *separator the (owned) key that goes up to the parent. */
+static int insert_rec(RbSortedSet *set, void *node, const RbValue *value,
+                      void **split, RbValue *separator) {
+    *split = NULL;
+    if (is_leaf(node)) {
+        Leaf *leaf = node;
+        size_t count = leaf->header.count;
+        size_t pos = search(set, leaf->keys, count, value, false);
+        if (pos < count && compare(set, &leaf->keys[pos], value) == 0) return 0;
+
+        RbValue item = rb_value_clone(*value);
+        if (count < LEAF_KEYS) {
+            memmove(&leaf->keys[pos + 1], &leaf->keys[pos], sizeof(RbValue) * (count - pos));
+            leaf->keys[pos] = item;
+            leaf->header.count++;
+            return 1;
+        }
+
+        /* Split 16 values 8/8 */
+        RbValue all[LEAF_KEYS + 1];
+        memcpy(all, leaf->keys, sizeof(RbValue) * pos);
+        all[pos] = item;
+        memcpy(all + pos + 1, leaf->keys + pos, sizeof(RbValue) * (count - pos));
+
+        Leaf *right = new_leaf(set);
+        size_t left_count = (LEAF_KEYS + 1) / 2;
+        memcpy(leaf->keys, all, sizeof(RbValue) * left_count);
+        memcpy(right->keys, all + left_count, sizeof(RbValue) * (LEAF_KEYS + 1 - left_count));
+        leaf->header.count = (uint16_t)left_count;
+        right->header.count = (uint16_t)(LEAF_KEYS + 1 - left_count);
+        right->next = leaf->next;
+        leaf->next = right;
+
+        *split = right;
+        *separator = rb_value_clone(right->keys[0]);
+        return 1;
+    }
+
+    Inner *inner = node;
+    size_t count = inner->header.count;
+    size_t index = search(set, inner->keys, count, value, true);
+
+    void *child_split;
+    RbValue child_separator;
+    int result = insert_rec(set, inner->children[index], value, &child_split, &child_separator);
+    if (!child_split) return result;
+
+    if (count < INNER_KEYS) {
+        memmove(&inner->keys[index + 1], &inner->keys[index], sizeof(RbValue) * (count - index));
+        memmove(&inner->children[index + 2], &inner->children[index + 1], sizeof(void *) * (count - index));
+        inner->keys[index] = child_separator;
+        inner->children[index + 1] = child_split;
+        inner->header.count++;
+        return result;
+    }
+
+    /* Split 11 keys / 12 children: 5 keys stay, the middle key moves up, 5 go right */
+    RbValue keys[INNER_KEYS + 1];
+    void *children[INNER_KEYS + 2];
+    memcpy(keys, inner->keys, sizeof(RbValue) * index);
+    keys[index] = child_separator;
+    memcpy(keys + index + 1, inner->keys + index, sizeof(RbValue) * (count - index));
+    memcpy(children, inner->children, sizeof(void *) * (index + 1));
+    children[index + 1] = child_split;
+    memcpy(children + index + 2, inner->children + index + 1, sizeof(void *) * (count - index));
+
+    Inner *right = new_inner(set);
+    size_t left_count = (INNER_KEYS + 1) / 2;
+    size_t right_count = INNER_KEYS - left_count;
+    memcpy(inner->keys, keys, sizeof(RbValue) * left_count);
+    memcpy(inner->children, children, sizeof(void *) * (left_count + 1));
+    memcpy(right->keys, keys + left_count + 1, sizeof(RbValue) * right_count);
+    memcpy(right->children, children + left_count + 1, sizeof(void *) * (right_count + 1));
+    inner->header.count = (uint16_t)left_count;
+    right->header.count = (uint16_t)right_count;
+
+    *split = right;
+    *separator = keys[left_count];
+    return result;
+}
+
+bool rb_sorted_set_add(RbSortedSet *set, RbValue value) {
+    if (!set) return false;
+    /* A split can climb every level and add a root */
+    if (!reserve_nodes(set, set->height + 1)) return false;
+
+    if (!set->root) {
+        Leaf *leaf = new_leaf(set);
+        leaf->keys[0] = rb_value_clone(value);
+        leaf->header.count = 1;
+        set->root = leaf;
+        set->height = 1;
+        set->size = 1;
+        set->version++;
+        return true;
+    }
+
+    void *split;
+    RbValue separator;
+    if (!insert_rec(set, set->root, &value, &split, &separator)) return false;
+
+    if (split) {
+        Inner *root = new_inner(set);
+        root->keys[0] = separator;
+        root->children[0] = set->root;
+        root->children[1] = split;
+        root->header.count = 1;
+        set->root = root;
+        set->height++;
+    }
+    set->size++;
+    set->version++;
+    return true;
+}
+
+/* ========== REMOVAL ========== */
+
+/* Drop key index and child index + 1 from an inner node */
+static void inner_erase(Inner *inner, size_t index) {
+    size_t count = inner->header.count;
+    memmove(&inner->keys[index], &inner->keys[index + 1], sizeof(RbValue) * (count - index - 1));
+    memmove(&inner->children[index + 1], &inner->children[index + 2], sizeof(void *) * (count - index - 1));
+    inner->header.count--;
+}
+
+/* Merge children[index + 1] into children[index] */
+static void merge_children(RbSortedSet *set, Inner *parent, size_t index) {
+    void *left_node = parent->children[index];
+    void *right_node = parent->children[index + 1];
+
+    if (is_leaf(left_node)) {
+        Leaf *left = left_node, *right = right_node;
+        memcpy(&left->keys[left->header.count], right->keys, sizeof(RbValue) * right->header.count);
+        left->header.count += right->header.count;
+        left->next = right->next;
+        rb_value_free(parent->keys[index]);
+    } else {
+        /* The separator comes down between the two halves */
+        Inner *left = left_node, *right = right_node;
+        size_t count = left->header.count;
+        left->keys[count] = parent->keys[index];
+        memcpy(&left->keys[count + 1], right->keys, sizeof(RbValue) * right->header.count);
+        memcpy(&left->children[count + 1], right->children, sizeof(void *) * (right->header.count + 1));
+        left->header.count += 1 + right->header.count;
+    }
+    inner_erase(parent, index);
+    release_node(set, right_node);
+}
+
+/* Refill an underfull children[index] from a sibling, or merge with one */
+static void rebalance(RbSortedSet *set, Inner *parent, size_t index) {
+    void *child = parent->children[index];
+    void *left = index > 0 ? parent->children[index - 1] : NULL;
+    void *right = index < parent->header.count ? parent->children[index + 1] : NULL;
+    size_t min = is_leaf(child) ? LEAF_MIN : INNER_MIN;
+
+    if (left && ((NodeHeader *)left)->count > min) {
+        if (is_leaf(child)) {
+            Leaf *c = child, *l = left;
+            memmove(&c->keys[1], &c->keys[0], sizeof(RbValue) * c->header.count);
+            c->keys[0] = l->keys[--l->header.count];
+            c->header.count++;
+            rb_value_free(parent->keys[index - 1]);
+            parent->keys[index - 1] = rb_value_clone(c->keys[0]);
+        } else {
+            Inner *c = child, *l = left;
+            memmove(&c->keys[1], &c->keys[0], sizeof(RbValue) * c->header.count);
+            memmove(&c->children[1], &c->children[0], sizeof(void *) * (c->header.count + 1));
+            c->keys[0] = parent->keys[index - 1];
+            c->children[0] = l->children[l->header.count];
+            c->header.count++;
+            parent->keys[index - 1] = l->keys[--l->header.count];
+        }
+        return;
+    }
+
+    if (right && ((NodeHeader *)right)->count > min) {
+        if (is_leaf(child)) {
+            Leaf *c = child, *r = right;
+            c->keys[c->header.count++] = r->keys[0];
+            memmove(&r->keys[0], &r->keys[1], sizeof(RbValue) * --r->header.count);
+            rb_value_free(parent->keys[index]);
+            parent->keys[index] = rb_value_clone(r->keys[0]);
+        } else {
+            Inner *c = child, *r = right;
+            c->keys[c->header.count] = parent->keys[index];
+            c->children[c->header.count + 1] = r->children[0];
+            c->header.count++;
+            parent->keys[index] = r->keys[0];
+            memmove(&r->keys[0], &r->keys[1], sizeof(RbValue) * (r->header.count - 1));
+            memmove(&r->children[0], &r->children[1], sizeof(void *) * r->header.count);
+            r->header.count--;
+        }
+        return;
+    }
+
+    merge_children(set, parent, left ? index - 1 : index);
+}
+
+static bool remove_rec(RbSortedSet *set, void *node, const RbValue *value) {
+    if (is_leaf(node)) {
+        Leaf *leaf = node;
+        size_t count = leaf->header.count;
+        size_t pos = search(set, leaf->keys, count, value, false);
+        if (pos == count || compare(set, &leaf->keys[pos], value) != 0) return false;
+        rb_value_free(leaf->keys[pos]);
+        memmove(&leaf->keys[pos], &leaf->keys[pos + 1], sizeof(RbValue) * (count - pos - 1));
+        leaf->header.count--;
+        return true;
+    }
+
+    Inner *inner = node;
+    size_t index = search(set, inner->keys, inner->header.count, value, true);
+    void *child = inner->children[index];
+    if (!remove_rec(set, child, value)) return false;
+
+    size_t min = is_leaf(child) ? LEAF_MIN : INNER_MIN;
+    if (((NodeHeader *)child)->count < min) rebalance(set, inner, index);
+    return true;
+}
+
+bool rb_sorted_set_remove(RbSortedSet *set, RbValue value) {
+    if (!set || !set->root) return false;
+    if (!remove_rec(set, set->root, &value)) return false;
+
+    NodeHeader *root = set->root;
+    if (root->count == 0) {
+        /* An empty leaf root empties the set; an empty inner root has one child left */
+        set->root = root->leaf ? NULL : ((Inner *)root)->children[0];
+        set->height--;
+        release_node(set, root);
+    }
+    set->size--;
+    set->version++;
+    return true;
+}
+
+/* ========== LOOKUP ========== */
+
+size_t rb_sorted_set_len(const RbSortedSet *set) {
+    return set ? set->size : 0;
+}
+
+bool rb_sorted_set_is_empty(const RbSortedSet *set) {
+    return rb_sorted_set_len(set) == 0;
+}
+
+/* Descend to the leaf that would hold value */
+static const Leaf *find_leaf(const RbSortedSet *set, const RbValue *value) {
+    const void *node = set->root;
+    while (node && !is_leaf(node)) {
+        const Inner *inner = node;
+        node = inner->children[search(set, inner->keys, inner->header.count, value, true)];
+    }
+    return node;
+}
+
+bool rb_sorted_set_contains(const RbSortedSet *set, RbValue value) {
+    if (!set) return false;
+    const Leaf *leaf = find_leaf(set, &value);
+    if (!leaf) return false;
+    size_t pos = search(set, leaf->keys, leaf->header.count, &value, false);
+    return pos < leaf->header.count && compare(set, &leaf->keys[pos], &value) == 0;
+}
+
+bool rb_sorted_set_min(const RbSortedSet *set, RbValue *out) {
+    if (!set || !set->root) return false;
+    const void *node = set->root;
+    while (!is_leaf(node)) node = ((const Inner *)node)->children[0];
+    *out = ((const Leaf *)node)->keys[0];
+    return true;
+}
+
+bool rb_sorted_set_max(const RbSortedSet *set, RbValue *out) {
+    if (!set || !set->root) return false;
+    const void *node = set->root;
+    while (!is_leaf(node)) {
+        const Inner *inner = node;
+        node = inner->children[inner->header.count];
+    }
+    const Leaf *leaf = node;
+    *out = leaf->keys[leaf->header.count - 1];
+    return true;
+}
+
+/* ========== ITERATION & RANGES ========== */
+
+RbSortedSetIter rb_sorted_set_begin(const RbSortedSet *set) {
+    RbSortedSetIter it = { NULL, 0 };
+    if (!set || !set->root) return it;
+    const void *node = set->root;
+    while (!is_leaf(node)) node = ((const Inner *)node)->children[0];
+    it.leaf = node;
+    return it;
+}
+
+static RbSortedSetIter seek(const RbSortedSet *set, const RbValue *value, bool upper) {
+    RbSortedSetIter it = { NULL, 0 };
+    if (!set) return it;
+    const Leaf *leaf = find_leaf(set, value);
+    if (!leaf) return it;
+    it.leaf = leaf;
+    it.index = search(set, leaf->keys, leaf->header.count, value, upper);
+    return it;
+}
+
+RbSortedSetIter rb_sorted_set_lower_bound(const RbSortedSet *set, RbValue value) {
+    return seek(set, &value, false);
+}
+
+RbSortedSetIter rb_sorted_set_upper_bound(const RbSortedSet *set, RbValue value) {
+    return seek(set, &value, true);
+}
+
+bool rb_sorted_set_next(RbSortedSetIter *it, RbValue *out) {
+    const Leaf *leaf = it->leaf;
+    /* A seek can land one past the end of a leaf */
+    while (leaf && it->index >= leaf->header.count) {
+        leaf = leaf->next;
+        it->leaf = leaf;
+        it->index = 0;
+    }
+    if (!leaf) return false;
+    *out = leaf->keys[it->index++];
+    return true;
+}
+
+size_t rb_sorted_set_count_range(const RbSortedSet *set, RbValue low, RbValue high) {
+    RbSortedSetIter it = rb_sorted_set_lower_bound(set, low);
+    size_t count = 0;
+    RbValue value;
+    while (rb_sorted_set_next(&it, &value) && compare(set, &value, &high) < 0) count++;
+    return count;
+}
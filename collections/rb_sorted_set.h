@@ -0,0 +1,87 @@
+#ifndef RB_SORTED_SET_H
+#define RB_SORTED_SET_H
+
+#include "rb_collections.h"
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Ordered set: a B+tree whose nodes are exactly 256 bytes (four cache
+ * lines) on 64-bit targets. Leaves hold up to 15 values and are chained
+ * left to right, so ordered iteration and range queries walk consecutive
+ * leaves without revisiting inner nodes. Inner nodes hold 10 separators
+ * and 11 children. Nodes are carved from cache-line-aligned chunks and
+ * recycled through a free list.
+ *
+ * Values are ordered by the natural order unless a comparator is given;
+ * values comparing equal are duplicates. Added values are cloned. */
+
+typedef struct RbSortedSet {
+    void *root;             /* NULL when empty */
+    size_t size;
+    size_t height;          /* 1 = the root is a leaf */
+    RbCompareFn compare;    /* NULL = natural order */
+    uint64_t version;       /* bumped by every change */
+
+    void *free_nodes;       /* recycled nodes, linked through their first word */
+    size_t free_count;
+    void *chunks;           /* node allocations, linked */
+    size_t node_total;
+} RbSortedSet;
+
+/* Position in the set; invalidated by any add, remove or clear */
+typedef struct {
+    const void *leaf;
+    size_t index;
+} RbSortedSetIter;
+
+/* ========== CREATION & DESTRUCTION ========== */
+
+/* Create an empty set; compare may be NULL for the natural order */
+RbSortedSet *rb_sorted_set_new(RbCompareFn compare);
+
+/* Free a set and its values */
+void rb_sorted_set_free(RbSortedSet *set);
+
+/* Remove all values */
+void rb_sorted_set_clear(RbSortedSet *set);
+
+/* ========== OPERATIONS ========== */
+
+/* Number of values */
+size_t rb_sorted_set_len(const RbSortedSet *set);
+
+/* Check if set is empty */
+bool rb_sorted_set_is_empty(const RbSortedSet *set);
+
+/* Add a clone of value; false if already present (or out of memory).
+ * The caller keeps ownership of value either way, so a rejected
+ * duplicate is still the caller's to free. */
+bool rb_sorted_set_add(RbSortedSet *set, RbValue value);
+
+/* Remove a value; false if absent */
+bool rb_sorted_set_remove(RbSortedSet *set, RbValue value);
+
+/* Check membership */
+bool rb_sorted_set_contains(const RbSortedSet *set, RbValue value);
+
+/* Borrow the smallest / largest value; false if empty */
+bool rb_sorted_set_min(const RbSortedSet *set, RbValue *out);
+bool rb_sorted_set_max(const RbSortedSet *set, RbValue *out);
+
+/* ========== ITERATION & RANGES ========== */
+
+/* Iterator at the smallest value */
+RbSortedSetIter rb_sorted_set_begin(const RbSortedSet *set);
+
+/* Iterator at the first value >= value / > value */
+RbSortedSetIter rb_sorted_set_lower_bound(const RbSortedSet *set, RbValue value);
+RbSortedSetIter rb_sorted_set_upper_bound(const RbSortedSet *set, RbValue value);
+
+/* Borrow the value at the iterator and advance; false at the end */
+bool rb_sorted_set_next(RbSortedSetIter *it, RbValue *out);
+
+/* Number of values in [low, high) */
+size_t rb_sorted_set_count_range(const RbSortedSet *set, RbValue low, RbValue high);
+
+#endif /* RB_SORTED_SET_H */
@@ -1,7 +1,14 @@
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
+#include <stdlib.h>
 #include "rb_collections.h"
 #include "rb_list.h"
+#include "rb_deque.h"
+#include "rb_heap.h"
+#include "rb_sorted_set.h"
+#include "rb_pvector.h"
+#include "rb_pmap.h"
 
 void test_list_basic() {
     printf("=== Testing List Basic Operations ===\n");
@@ -122,6 +129,95 @@ void test_list_reverse_sort() {
     printf("✓ Reverse/Sort passed\n\n");
 }
 
+static bool is_sorted(const RbList *list) {
+    for (size_t i = 1; i < list->size; i++) {
+        if (rb_compare_values(&list->items[i - 1], &list->items[i]) > 0) return false;
+    }
+    return true;
+}
+
+/* Orders ints by their last digit only, so many elements compare equal */
+static int compare_last_digit(const void *a, const void *b) {
+    int64_t x = ((const RbValue *)a)->data.i % 10, y = ((const RbValue *)b)->data.i % 10;
+    return (x > y) - (x < y);
+}
+
+static RbValue parity_key(RbValue value) {
+    return rb_value_int(value.data.i % 2);
+}
+
+void test_list_sort_variants() {
+    printf("=== Testing Specialized Sorts ===\n");
+    
+    /* Ints (radix), floats (radix), strings (multikey), mixed (pdqsort) */
+    RbList *ints = rb_list_new();
+    RbList *floats = rb_list_new();
+    RbList *strings = rb_list_new();
+    RbList *mixed = rb_list_new();
+    uint64_t seed = 12345;
+    for (int i = 0; i < 5000; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        int64_t r = (int64_t)(seed >> 33) - (1LL << 30);
+        char word[16];
+        snprintf(word, sizeof(word), "w%lld", (long long)(r % 977));
+        RbValue str = rb_value_string(word);  /* appends clone it */
+        rb_list_append(ints, rb_value_int(r));
+        rb_list_append(floats, rb_value_float((double)r / 7.0));
+        rb_list_append(strings, str);
+        rb_list_append(mixed, i % 3 == 0 ? rb_value_int(r % 100) : i % 3 == 1 ? rb_value_float((double)(r % 100)) : str);
+        rb_value_free(str);
+    }
+    rb_list_sort(ints, NULL);
+    rb_list_sort(floats, NULL);
+    rb_list_sort(strings, NULL);
+    rb_list_sort(mixed, NULL);
+    assert(is_sorted(ints));
+    assert(is_sorted(floats));
+    assert(is_sorted(strings));
+    assert(is_sorted(mixed));
+    printf("Sorted 5000 ints, floats, strings and mixed values\n");
+    
+    /* A long shared prefix must not cost a stack frame per byte */
+    enum { PREFIX = 100000 };
+    char *line = malloc(PREFIX + 8);
+    memset(line, 'p', PREFIX);
+    RbList *prefixed = rb_list_new();
+    for (int i = 0; i < 64; i++) {
+        snprintf(line + PREFIX, 8, "%02d", (i * 37) % 64);
+        RbValue str = rb_value_string(line);
+        rb_list_append(prefixed, str);
+        rb_value_free(str);
+    }
+    rb_list_sort(prefixed, NULL);
+    assert(is_sorted(prefixed));
+    assert(strcmp(prefixed->items[63].data.s + PREFIX, "63") == 0);
+    rb_list_free(prefixed);
+    free(line);
+    
+    /* Stable sort keeps insertion order among equal keys */
+    RbList *list = rb_list_new();
+    for (int i = 0; i < 100; i++) rb_list_append(list, rb_value_int(i));
+    rb_list_sort_stable(list, compare_last_digit);
+    for (size_t i = 1; i < list->size; i++) {
+        int64_t prev = list->items[i - 1].data.i, cur = list->items[i].data.i;
+        assert(prev % 10 < cur % 10 || (prev % 10 == cur % 10 && prev < cur));
+    }
+    printf("Stable by last digit: %lld %lld %lld ...\n",
+           (long long)list->items[0].data.i, (long long)list->items[1].data.i, (long long)list->items[2].data.i);
+    
+    /* Sort by key: evens first, each group in original order */
+    rb_list_sort_by_key(list, parity_key);
+    assert(list->items[0].data.i == 0 && list->items[49].data.i % 2 == 0);
+    assert(list->items[50].data.i % 2 == 1);
+    
+    rb_list_free(ints);
+    rb_list_free(floats);
+    rb_list_free(strings);
+    rb_list_free(mixed);
+    rb_list_free(list);
+    printf("✓ Specialized sorts passed\n\n");
+}
+
 void test_list_slice() {
     printf("=== Testing List Slicing ===\n");
     
@@ -211,6 +307,509 @@ void test_list_extend_copy() {
     printf("✓ Extend/Copy passed\n\n");
 }
 
+void test_value_hash() {
+    printf("=== Testing Value Hashing ===\n");
+    
+    /* Equal values hash alike, whatever the allocation */
+    char a[] = "the quick brown fox jumps over the lazy dog, twice over";
+    char b[sizeof(a)];
+    memcpy(b, a, sizeof(a));
+    RbValue sa = { .type = RB_VAL_STRING, .data.s = a };
+    RbValue sb = { .type = RB_VAL_STRING, .data.s = b };
+    assert(rb_value_hash(sa) == rb_value_hash(sb));
+    assert(rb_hash_string(a) == rb_hash_bytes(a, strlen(a)));
+    assert(rb_value_hash(rb_value_float(0.0)) == rb_value_hash(rb_value_float(-0.0)));
+    
+    /* Every length up to 64 and one flipped byte give distinct hashes */
+    for (size_t len = 0; len <= 64; len++) {
+        char buf[64];
+        memset(buf, 'x', sizeof(buf));
+        uint64_t h = rb_hash_bytes(buf, len);
+        if (len > 0) {
+            buf[len - 1] = 'y';
+            assert(rb_hash_bytes(buf, len) != h);
+        }
+        assert(len == 0 || rb_hash_bytes(buf, len - 1) != h);
+    }
+    assert(rb_hash_int(1) != rb_hash_int(2));
+    assert(rb_value_hash(rb_value_bool(true)) != rb_value_hash(rb_value_bool(false)));
+    
+    /* The seed keys every type */
+    uint64_t seed = rb_hash_seed();
+    uint64_t before[4] = { rb_hash_string(a), rb_hash_int(42), rb_hash_float(1.5),
+                           rb_value_hash(rb_value_null()) };
+    uint32_t epoch = rb_hash_epoch();
+    rb_hash_set_seed(seed ^ 0x9e3779b97f4a7c15ULL);
+    assert(rb_hash_epoch() != epoch);
+    assert(rb_hash_string(a) != before[0]);
+    assert(rb_hash_int(42) != before[1]);
+    assert(rb_hash_float(1.5) != before[2]);
+    assert(rb_value_hash(rb_value_null()) != before[3]);
+    rb_hash_set_seed(seed);
+    assert(rb_hash_string(a) == before[0]);
+    
+    printf("Seed: %016llx\n", (unsigned long long)seed);
+    printf("✓ Value hashing passed\n\n");
+}
+
+void test_deque() {
+    printf("=== Testing Deque ===\n");
+    
+    RbDeque *deque = rb_deque_new();
+    for (int i = 0; i < 5; i++) rb_deque_push_back(deque, rb_value_int(i));
+    for (int i = 1; i <= 5; i++) rb_deque_push_front(deque, rb_value_int(-i));
+    assert(rb_deque_len(deque) == 10);
+    assert(rb_deque_front(deque).data.i == -5);
+    assert(rb_deque_back(deque).data.i == 4);
+    assert(rb_deque_get(deque, 5).data.i == 0);
+    assert(rb_deque_get(deque, -1).data.i == 4);
+    
+    /* Wrap around the ring many times and grow while wrapped */
+    int64_t expect_front = -5;
+    for (int round = 0; round < 1000; round++) {
+        assert(rb_deque_pop_front(deque).data.i == expect_front++);
+        rb_deque_push_back(deque, rb_value_int(round + 5));
+        if (round % 7 == 0) rb_deque_push_back(deque, rb_value_int(-1000));
+        if (round % 7 == 0) assert(rb_deque_pop_back(deque).data.i == -1000);
+    }
+    assert(rb_deque_len(deque) == 10);
+    for (int i = 0; i < 10; i++) assert(rb_deque_get(deque, i).data.i == expect_front + i);
+    
+    RbValue front = rb_value_string("front");
+    rb_deque_set(deque, 0, front);
+    rb_value_free(front);
+    assert(strcmp(rb_deque_front(deque).data.s, "front") == 0);
+    RbValue popped = rb_deque_pop_front(deque);
+    rb_value_free(popped);
+    
+    rb_deque_clear(deque);
+    assert(rb_deque_is_empty(deque));
+    assert(rb_deque_pop_back(deque).type == RB_VAL_NULL);
+    rb_deque_free(deque);
+    printf("✓ Deque passed\n\n");
+}
+
+void test_heap() {
+    printf("=== Testing Heap ===\n");
+    
+    enum { N = 2000 };
+    static int64_t priority[N];
+    static bool live[N];
+    RbHeap *heap = rb_heap_new(NULL);
+    RbHeapHandle handles[N];
+    srand(12345);
+    
+    for (int i = 0; i < N; i++) {
+        priority[i] = rand() % 1000;
+        live[i] = true;
+        handles[i] = rb_heap_push(heap, rb_value_int(priority[i]), rb_value_int(i));
+        assert(handles[i] != RB_HEAP_NO_HANDLE);
+    }
+    
+    /* Decrease, increase and remove arbitrary entries by handle */
+    for (int i = 0; i < N; i += 3) {
+        priority[i] = rand() % 2000 - 500;
+        assert(rb_heap_update(heap, handles[i], rb_value_int(priority[i])));
+    }
+    for (int i = 1; i < N; i += 5) {
+        RbValue p, v;
+        assert(rb_heap_remove(heap, handles[i], &p, &v));
+        assert(p.data.i == priority[i] && v.data.i == i);
+        assert(!rb_heap_contains(heap, handles[i]));
+        live[i] = false;
+    }
+    
+    /* Pops come out in priority order and match the reference */
+    int64_t last = -1000000;
+    size_t popped = 0;
+    RbValue p, v;
+    while (rb_heap_pop(heap, &p, &v)) {
+        assert(p.data.i >= last);
+        assert(live[v.data.i] && priority[v.data.i] == p.data.i);
+        live[v.data.i] = false;
+        last = p.data.i;
+        popped++;
+    }
+    assert(popped == N - N / 5);
+    
+    /* Handles are recycled, strings are cloned in */
+    RbValue strs[5] = { rb_value_string("b"), rb_value_string("second"), rb_value_string("a"),
+                        rb_value_string("first"), rb_value_string("0") };
+    RbHeapHandle h = rb_heap_push(heap, strs[0], strs[1]);
+    rb_heap_push(heap, strs[2], strs[3]);
+    assert(rb_heap_peek(heap, NULL, &v) && strcmp(v.data.s, "first") == 0);
+    assert(rb_heap_update(heap, h, strs[4]));
+    for (int i = 0; i < 5; i++) rb_value_free(strs[i]);
+    assert(rb_heap_peek(heap, NULL, &v) && strcmp(v.data.s, "second") == 0);
+    assert(rb_heap_pop(heap, NULL, NULL));
+    
+    rb_heap_free(heap);
+    printf("✓ Heap passed\n\n");
+}
+
+static int compare_int_desc(const void *a, const void *b) {
+    int64_t x = ((const RbValue *)a)->data.i, y = ((const RbValue *)b)->data.i;
+    return (x < y) - (x > y);
+}
+
+void test_sorted_set() {
+    printf("=== Testing Sorted Set ===\n");
+    
+    enum { RANGE = 5000 };
+    static bool present[RANGE];
+    RbSortedSet *set = rb_sorted_set_new(NULL);
+    size_t size = 0;
+    srand(777);
+    
+    /* Random adds and removes against a bitmap reference */
+    for (int step = 0; step < 40000; step++) {
+        int64_t x = rand() % RANGE;
+        if (step < 20000 || rand() % 2) {
+            assert(rb_sorted_set_add(set, rb_value_int(x)) == !present[x]);
+            if (!present[x]) size++;
+            present[x] = true;
+        } else {
+            assert(rb_sorted_set_remove(set, rb_value_int(x)) == present[x]);
+            if (present[x]) size--;
+            present[x] = false;
+        }
+    }
+    assert(rb_sorted_set_len(set) == size);
+    
+    /* Ordered iteration visits exactly the present values */
+    RbSortedSetIter it = rb_sorted_set_begin(set);
+    RbValue v;
+    int64_t expect = -1;
+    for (;;) {
+        do { expect++; } while (expect < RANGE && !present[expect]);
+        if (expect == RANGE) break;
+        assert(rb_sorted_set_next(&it, &v) && v.data.i == expect);
+    }
+    assert(!rb_sorted_set_next(&it, &v));
+    
+    /* Range queries */
+    for (int q = 0; q < 200; q++) {
+        int64_t lo = rand() % RANGE, hi = lo + rand() % 300;
+        size_t count = 0;
+        for (int64_t x = lo; x < hi && x < RANGE; x++) count += present[x];
+        assert(rb_sorted_set_count_range(set, rb_value_int(lo), rb_value_int(hi)) == count);
+        it = rb_sorted_set_upper_bound(set, rb_value_int(lo));
+        int64_t next = lo + 1;
+        while (next < RANGE && !present[next]) next++;
+        assert(rb_sorted_set_next(&it, &v) == (next < RANGE));
+        if (next < RANGE) assert(v.data.i == next);
+    }
+    
+    /* Drain completely, then reuse */
+    for (int64_t x = 0; x < RANGE; x++) {
+        assert(rb_sorted_set_contains(set, rb_value_int(x)) == present[x]);
+        if (present[x]) assert(rb_sorted_set_remove(set, rb_value_int(x)));
+    }
+    assert(rb_sorted_set_is_empty(set));
+    assert(!rb_sorted_set_min(set, &v));
+    
+    const char *words[] = { "pear", "apple", "fig", "kiwi", "apple" };
+    for (int i = 0; i < 5; i++) {
+        RbValue word = rb_value_string(words[i]);
+        assert(rb_sorted_set_add(set, word) == (i < 4));
+        rb_value_free(word);    /* cloned, or rejected as a duplicate */
+    }
+    assert(rb_sorted_set_len(set) == 4);
+    assert(rb_sorted_set_min(set, &v) && strcmp(v.data.s, "apple") == 0);
+    assert(rb_sorted_set_max(set, &v) && strcmp(v.data.s, "pear") == 0);
+    rb_sorted_set_free(set);
+    
+    /* A custom comparator defines the order */
+    set = rb_sorted_set_new(compare_int_desc);
+    for (int64_t x = 1; x <= 100; x++) rb_sorted_set_add(set, rb_value_int(x));
+    assert(rb_sorted_set_min(set, &v) && v.data.i == 100);
+    assert(rb_sorted_set_count_range(set, rb_value_int(50), rb_value_int(40)) == 10);
+    rb_sorted_set_free(set);
+    printf("✓ Sorted set passed\n\n");
+}
+
+/* from, from + 1, ... as a vector of n values */
+static RbPVector *pvector_range(int64_t from, size_t n) {
+    RbPVector *empty = rb_pvector_new();
+    RbPVectorBuilder *builder = rb_pvector_builder(empty);
+    rb_pvector_release(empty);
+    for (size_t i = 0; i < n; i++) assert(rb_pvector_builder_push(builder, rb_value_int(from + (int64_t)i)));
+    return rb_pvector_build(builder);
+}
+
+/* Compare a vector against a reference by index and by iteration */
+static void pvector_check(const RbPVector *v, const int64_t *expect, size_t n) {
+    assert(rb_pvector_len(v) == n);
+    RbPVectorIter it = rb_pvector_iter(v);
+    RbValue value;
+    for (size_t i = 0; i < n; i++) {
+        assert(rb_pvector_get(v, i).data.i == expect[i]);
+        assert(rb_pvector_next(&it, &value) && value.data.i == expect[i]);
+    }
+    assert(!rb_pvector_next(&it, &value));
+}
+
+void test_pvector() {
+    printf("=== Testing Persistent Vector ===\n");
+    
+    enum { N = 40000 };
+    RbPVector *empty = rb_pvector_new();
+    RbPVector *v = rb_pvector_retain(empty);
+    
+    /* Grow one version at a time past two trie levels */
+    for (int64_t i = 0; i < N; i++) {
+        RbPVector *next = rb_pvector_push(v, rb_value_int(i));
+        rb_pvector_release(v);
+        v = next;
+    }
+    assert(rb_pvector_len(v) == N);
+    assert(rb_pvector_len(empty) == 0);
+    for (int64_t i = 0; i < N; i += 7) assert(rb_pvector_get(v, i).data.i == i);
+    assert(rb_pvector_get(v, N).type == RB_VAL_NULL);
+    
+    /* An update leaves the snapshot untouched */
+    RbPVector *snapshot = rb_pvector_retain(v);
+    srand(4242);
+    for (int k = 0; k < 2000; k++) {
+        size_t index = rand() % N;
+        RbPVector *next = rb_pvector_set(v, index, rb_value_int(-(int64_t)index));
+        rb_pvector_release(v);
+        v = next;
+    }
+    size_t changed = 0;
+    for (int64_t i = 0; i < N; i++) {
+        assert(rb_pvector_get(snapshot, i).data.i == i);
+        int64_t now = rb_pvector_get(v, i).data.i;
+        assert(now == i || now == -i);
+        if (now != i) changed++;
+    }
+    assert(changed > 1000);
+    
+    /* Pop back down through the trie levels */
+    for (int64_t i = N - 1; i >= 100; i--) {
+        RbPVector *next = rb_pvector_pop(v);
+        rb_pvector_release(v);
+        v = next;
+    }
+    assert(rb_pvector_len(v) == 100);
+    assert(rb_pvector_len(snapshot) == N);
+    rb_pvector_release(v);
+    
+    /* A builder edits in place and leaves its source alone */
+    RbPVectorBuilder *builder = rb_pvector_builder(snapshot);
+    for (int64_t i = 0; i < 1000; i++) assert(rb_pvector_builder_push(builder, rb_value_int(N + i)));
+    for (int64_t i = 0; i < N + 1000; i += 3) assert(rb_pvector_builder_set(builder, i, rb_value_int(0)));
+    assert(!rb_pvector_builder_set(builder, N + 5000, rb_value_int(0)));
+    for (int i = 0; i < 500; i++) assert(rb_pvector_builder_pop(builder));
+    v = rb_pvector_build(builder);
+    assert(rb_pvector_len(v) == N + 500);
+    
+    RbPVectorIter it = rb_pvector_iter(v);
+    RbValue value;
+    for (int64_t i = 0; i < N + 500; i++) {
+        assert(rb_pvector_next(&it, &value));
+        assert(value.data.i == (i % 3 == 0 ? 0 : i));
+    }
+    assert(!rb_pvector_next(&it, &value));
+    assert(rb_pvector_get(snapshot, 3).data.i == 3);
+    rb_pvector_release(v);
+    rb_pvector_release(snapshot);
+    
+    /* Concatenation at every pair of shapes, from tail-only to three levels */
+    static const size_t sizes[] = { 0, 1, 31, 32, 33, 100, 1024, 1057, 5000, 40000 };
+    enum { SHAPES = sizeof(sizes) / sizeof(sizes[0]) };
+    static int64_t expect[3 * N];
+    for (size_t a = 0; a < SHAPES; a++) {
+        for (size_t b = 0; b < SHAPES; b++) {
+            RbPVector *left = pvector_range(0, sizes[a]);
+            RbPVector *right = pvector_range(1000000, sizes[b]);
+            v = rb_pvector_concat(left, right);
+            for (size_t i = 0; i < sizes[a]; i++) expect[i] = (int64_t)i;
+            for (size_t i = 0; i < sizes[b]; i++) expect[sizes[a] + i] = 1000000 + (int64_t)i;
+            pvector_check(v, expect, sizes[a] + sizes[b]);
+            assert(rb_pvector_len(left) == sizes[a] && rb_pvector_len(right) == sizes[b]);
+            rb_pvector_release(left);
+            rb_pvector_release(right);
+            rb_pvector_release(v);
+        }
+    }
+    
+    /* Random slices, concats and edits against an array reference; the
+     * relaxed trees they build must still push, pop, set and build */
+    static int64_t scratch[3 * N];
+    size_t n = 3000;
+    v = pvector_range(0, n);
+    for (size_t i = 0; i < n; i++) expect[i] = (int64_t)i;
+    srand(8989);
+    for (int step = 0; step < 400; step++) {
+        RbPVector *next;
+        int op = rand() % 5;
+        if (op == 0 || n < 10) {
+            size_t extra = rand() % 3000;
+            RbPVector *piece = pvector_range(step * 10000, extra);
+            next = rb_pvector_concat(v, piece);
+            rb_pvector_release(piece);
+            if (n + extra > 2 * N) {
+                rb_pvector_release(next);
+                continue;
+            }
+            for (size_t i = 0; i < extra; i++) expect[n + i] = step * 10000 + (int64_t)i;
+            n += extra;
+        } else if (op == 1) {
+            size_t start = rand() % n, end = start + rand() % (n - start + 1);
+            next = rb_pvector_slice(v, start, end);
+            memmove(expect, expect + start, (end - start) * sizeof(int64_t));
+            n = end - start;
+        } else if (op == 2) {
+            /* Concatenate two slices of itself */
+            size_t cut = rand() % n;
+            RbPVector *head = rb_pvector_slice(v, 0, cut);
+            RbPVector *rest = rb_pvector_slice(v, cut, n);
+            next = rb_pvector_concat(rest, head);
+            rb_pvector_release(head);
+            rb_pvector_release(rest);
+            memcpy(scratch, expect + cut, (n - cut) * sizeof(int64_t));
+            memcpy(scratch + n - cut, expect, cut * sizeof(int64_t));
+            memcpy(expect, scratch, n * sizeof(int64_t));
+        } else if (op == 3) {
+            builder = rb_pvector_builder(v);
+            for (int k = 0; k < 50; k++) {
+                size_t index = rand() % n;
+                assert(rb_pvector_builder_set(builder, index, rb_value_int(-step)));
+                expect[index] = -step;
+            }
+            for (int k = 0; k < 40; k++) {
+                assert(rb_pvector_builder_push(builder, rb_value_int(step)));
+                expect[n++] = step;
+            }
+            next = rb_pvector_build(builder);
+        } else {
+            size_t drop = rand() % (n < 200 ? n : 200);
+            next = rb_pvector_retain(v);
+            for (size_t k = 0; k < drop; k++) {
+                RbPVector *popped = rb_pvector_pop(next);
+                rb_pvector_release(next);
+                next = popped;
+            }
+            n -= drop;
+            if (n > 0) {
+                RbPVector *changed_version = rb_pvector_set(next, n / 2, rb_value_int(7));
+                rb_pvector_release(next);
+                next = changed_version;
+                expect[n / 2] = 7;
+            }
+        }
+        assert(next);
+        rb_pvector_release(v);
+        v = next;
+        pvector_check(v, expect, n);
+    }
+    RbPVector *none = rb_pvector_slice(v, n, n + 10);
+    assert(rb_pvector_len(none) == 0);
+    rb_pvector_release(none);
+    rb_pvector_release(v);
+    
+    /* Strings are cloned in */
+    RbValue word = rb_value_string("alpha");
+    v = rb_pvector_push(empty, word);
+    strcpy(word.data.s, "beta");
+    rb_value_free(word);
+    assert(strcmp(rb_pvector_get(v, 0).data.s, "alpha") == 0);
+    rb_pvector_release(v);
+    rb_pvector_release(empty);
+    printf("✓ Persistent vector passed\n\n");
+}
+
+void test_pmap() {
+    printf("=== Testing Persistent Map ===\n");
+    
+    enum { RANGE = 20000 };
+    static int64_t reference[RANGE];   /* 0 = absent, else value */
+    RbPMap *m = rb_pmap_new();
+    size_t size = 0;
+    srand(9090);
+    
+    /* Random sets and removes against an array reference */
+    for (int step = 0; step < 60000; step++) {
+        int64_t key = rand() % RANGE;
+        RbPMap *next;
+        if (step < 30000 || rand() % 2) {
+            int64_t value = 1 + rand() % 1000;
+            next = rb_pmap_set(m, rb_value_int(key), rb_value_int(value));
+            if (!reference[key]) size++;
+            reference[key] = value;
+        } else {
+            next = rb_pmap_remove(m, rb_value_int(key));
+            if (reference[key]) size--;
+            reference[key] = 0;
+        }
+        rb_pmap_release(m);
+        m = next;
+    }
+    assert(rb_pmap_len(m) == size);
+    RbValue value;
+    for (int64_t key = 0; key < RANGE; key++) {
+        bool found = rb_pmap_get(m, rb_value_int(key), &value);
+        assert(found == (reference[key] != 0));
+        if (found) assert(value.data.i == reference[key]);
+    }
+    
+    /* Iteration visits every entry once */
+    RbPMapIter it = rb_pmap_iter(m);
+    RbValue key;
+    size_t seen = 0;
+    while (rb_pmap_next(&it, &key, &value)) {
+        assert(reference[key.data.i] == value.data.i);
+        seen++;
+    }
+    assert(seen == size);
+    
+    /* A builder's batch leaves the snapshot untouched */
+    RbPMap *snapshot = rb_pmap_retain(m);
+    RbPMapBuilder *builder = rb_pmap_builder(m);
+    for (int64_t k = 0; k < RANGE; k += 2) {
+        if (reference[k]) assert(rb_pmap_builder_remove(builder, rb_value_int(k)));
+        else assert(!rb_pmap_builder_remove(builder, rb_value_int(k)));
+    }
+    for (int64_t k = RANGE; k < RANGE + 100; k++) assert(rb_pmap_builder_set(builder, rb_value_int(k), rb_value_int(k)));
+    RbPMap *odd = rb_pmap_build(builder);
+    for (int64_t k = 0; k < RANGE; k++) {
+        assert(rb_pmap_contains(snapshot, rb_value_int(k)) == (reference[k] != 0));
+        assert(rb_pmap_contains(odd, rb_value_int(k)) == (k % 2 == 1 && reference[k] != 0));
+    }
+    assert(rb_pmap_contains(odd, rb_value_int(RANGE + 50)));
+    rb_pmap_release(odd);
+    rb_pmap_release(snapshot);
+    rb_pmap_release(m);
+    
+    /* String and mixed keys */
+    m = rb_pmap_new();
+    const char *words[] = { "one", "two", "three", "two" };
+    for (int i = 0; i < 4; i++) {
+        RbValue word = rb_value_string(words[i]);   /* the map keeps a clone */
+        RbPMap *next = rb_pmap_set(m, word, rb_value_int(i));
+        rb_value_free(word);
+        rb_pmap_release(m);
+        m = next;
+    }
+    RbValue name = rb_value_string("float");
+    RbPMap *next = rb_pmap_set(m, rb_value_float(2.5), name);
+    rb_value_free(name);
+    RbValue two = { .type = RB_VAL_STRING, .data.s = "two" };
+    assert(rb_pmap_len(m) == 3 && rb_pmap_len(next) == 4);
+    assert(rb_pmap_get(m, two, &value) && value.data.i == 3);
+    assert(rb_pmap_get(next, rb_value_float(2.5), &value) && strcmp(value.data.s, "float") == 0);
+    assert(!rb_pmap_contains(m, rb_value_float(2.5)));
+    RbValue three = { .type = RB_VAL_STRING, .data.s = "three" };
+    assert(rb_pmap_get_hashed(m, three, rb_hash_string("three"), &value) && value.data.i == 2);
+    RbPMap *removed = rb_pmap_remove_hashed(m, three, rb_hash_string("three"));
+    assert(rb_pmap_len(removed) == 2 && !rb_pmap_contains(removed, three));
+    rb_pmap_release(removed);
+    rb_pmap_release(next);
+    rb_pmap_release(m);
+    printf("✓ Persistent map passed\n\n");
+}
+
 int main() {
     printf("╔═══════════════════════════════════════════════╗\n");
     printf("║       Rubolt Collections Test Suite          ║\n");
@@ -220,9 +819,16 @@ int main() {
     test_list_insert_remove();
     test_list_search();
     test_list_reverse_sort();
+    test_list_sort_variants();
     test_list_slice();
     test_list_strings();
     test_list_extend_copy();
+    test_value_hash();
+    test_deque();
+    test_heap();
+    test_sorted_set();
+    test_pvector();
+    test_pmap();
     
     printf("╔═══════════════════════════════════════════════╗\n");
     printf("║           All Tests Passed! ✓                 ║\n");
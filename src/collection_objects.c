@@ -0,0 +1,538 @@
+#include "collection_objects.h"
+#include "../collections/rb_sort.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+/* ========== VALUE CONVERSION ========== */
+
+/* A borrowed RbValue view of a script value. Strings point at the
+ * interpreter's bytes; slices (which are not NUL-terminated) get a
+ * scratch copy that view_done frees. The collections clone what they
+ * keep, so nothing here outlives the call. */
+typedef struct {
+    RbValue value;
+    char *scratch;
+} View;
+
+static bool view_of(Value value, View *view) {
+    view->scratch = NULL;
+    switch (value.type) {
+        case VALUE_NULL:
+            view->value = rb_value_null();
+            return true;
+        case VALUE_BOOL:
+            view->value = rb_value_bool(value.as.boolean);
+            return true;
+        case VALUE_NUMBER:
+            view->value = rb_value_float(value.as.number);
+            return true;
+        case VALUE_STRING:
+            view->value.type = RB_VAL_STRING;
+            view->value.data.s = value.as.string;
+            return true;
+        case VALUE_SLICE: {
+            const char *data;
+            size_t length;
+            value_string_view(value, &data, &length);
+            view->scratch = malloc(length + 1);
+            if (!view->scratch) return false;
+            memcpy(view->scratch, data, length);
+            view->scratch[length] = '\0';
+            view->value.type = RB_VAL_STRING;
+            view->value.data.s = view->scratch;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static void view_done(View *view) {
+    free(view->scratch);
+}
+
+/* rb_value_hash of a key view; strings reuse the hash cached in their header */
+static uint64_t key_hash(Value key, const View *view) {
+    if (key.type == VALUE_STRING || key.type == VALUE_SLICE) return value_string_hash(key);
+    return rb_value_hash(view->value);
+}
+
+static Value from_rb(RbValue value) {
+    switch (value.type) {
+        case RB_VAL_BOOL: return value_bool(value.data.b);
+        case RB_VAL_INT: return value_number((double)value.data.i);
+        case RB_VAL_FLOAT: return value_number(value.data.f);
+        case RB_VAL_STRING: return value.data.s ? value_string(value.data.s) : value_null();
+        default: return value_null();
+    }
+}
+
+/* Hand a popped (owned) value to the script */
+static Value take_rb(RbValue value) {
+    Value result = from_rb(value);
+    rb_value_free(value);
+    return result;
+}
+
+static Value collection_value(CollectionObject *object) {
+    Value value = {VALUE_COLLECTION, {.object = object}};
+    return value;
+}
+
+static CollectionObject *object_of(Value value) {
+    return value.type == VALUE_COLLECTION ? (CollectionObject *)value.as.object : NULL;
+}
+
+static int compare_reversed(const void *a, const void *b) {
+    return rb_compare_values(b, a);
+}
+
+/* ========== BUILTINS ========== */
+
+Value builtin_deque(Environment *env, Value *args, size_t arg_count) {
+    CollectionObject *object = malloc(sizeof(CollectionObject));
+    if (!object) return value_null();
+    object->kind = COLLECTION_DEQUE;
+    object->as.deque = rb_deque_with_capacity(arg_count);
+    for (size_t i = 0; i < arg_count; i++) {
+        View view;
+        if (!view_of(args[i], &view)) continue;
+        rb_deque_push_back(object->as.deque, view.value);
+        view_done(&view);
+    }
+    return collection_value(object);
+}
+
+Value builtin_heap(Environment *env, Value *args, size_t arg_count) {
+    bool max = false;
+    if (arg_count == 1) {
+        const char *data;
+        size_t length;
+        if (!value_string_view(args[0], &data, &length)) return value_null();
+        if (length == 3 && memcmp(data, "max", 3) == 0) max = true;
+        else if (length != 3 || memcmp(data, "min", 3) != 0) return value_null();
+    } else if (arg_count > 1) {
+        return value_null();
+    }
+
+    CollectionObject *object = malloc(sizeof(CollectionObject));
+    if (!object) return value_null();
+    object->kind = COLLECTION_HEAP;
+    object->as.heap = rb_heap_new(max ? compare_reversed : NULL);
+    return collection_value(object);
+}
+
+Value builtin_sorted_set(Environment *env, Value *args, size_t arg_count) {
+    CollectionObject *object = malloc(sizeof(CollectionObject));
+    if (!object) return value_null();
+    object->kind = COLLECTION_SORTED_SET;
+    object->as.set = rb_sorted_set_new(NULL);
+    for (size_t i = 0; i < arg_count; i++) {
+        View view;
+        if (!view_of(args[i], &view)) continue;
+        rb_sorted_set_add(object->as.set, view.value);
+        view_done(&view);
+    }
+    return collection_value(object);
+}
+
+/* Wrap a new persistent version; the object takes over its reference */
+static Value vector_value(RbPVector *vector) {
+    if (!vector) return value_null();
+    CollectionObject *object = malloc(sizeof(CollectionObject));
+    if (!object) {
+        rb_pvector_release(vector);
+        return value_null();
+    }
+    object->kind = COLLECTION_PVECTOR;
+    object->as.vector = vector;
+    return collection_value(object);
+}
+
+static Value map_value(RbPMap *map) {
+    if (!map) return value_null();
+    CollectionObject *object = malloc(sizeof(CollectionObject));
+    if (!object) {
+        rb_pmap_release(map);
+        return value_null();
+    }
+    object->kind = COLLECTION_PMAP;
+    object->as.map = map;
+    return collection_value(object);
+}
+
+/* Push args onto a copy of vector through a builder */
+static RbPVector *vector_with(const RbPVector *vector, Value *args, size_t arg_count) {
+    RbPVectorBuilder *builder = rb_pvector_builder(vector);
+    if (!builder) return NULL;
+    for (size_t i = 0; i < arg_count; i++) {
+        View view;
+        if (!view_of(args[i], &view)) continue;
+        rb_pvector_builder_push(builder, view.value);
+        view_done(&view);
+    }
+    return rb_pvector_build(builder);
+}
+
+/* Set key/value pairs from args on a copy of map through a builder */
+static RbPMap *map_with(const RbPMap *map, Value *args, size_t arg_count) {
+    RbPMapBuilder *builder = rb_pmap_builder(map);
+    if (!builder) return NULL;
+    for (size_t i = 0; i + 1 < arg_count; i += 2) {
+        View key, value;
+        if (!view_of(args[i], &key)) continue;
+        if (view_of(args[i + 1], &value)) {
+            rb_pmap_builder_set_hashed(builder, key.value, key_hash(args[i], &key), value.value);
+            view_done(&value);
+        }
+        view_done(&key);
+    }
+    return rb_pmap_build(builder);
+}
+
+Value builtin_pvector(Environment *env, Value *args, size_t arg_count) {
+    RbPVector *empty = rb_pvector_new();
+    if (!empty) return value_null();
+    RbPVector *vector = vector_with(empty, args, arg_count);
+    rb_pvector_release(empty);
+    return vector_value(vector);
+}
+
+Value builtin_pmap(Environment *env, Value *args, size_t arg_count) {
+    if (arg_count % 2 != 0) return value_null();
+    RbPMap *empty = rb_pmap_new();
+    if (!empty) return value_null();
+    RbPMap *map = map_with(empty, args, arg_count);
+    rb_pmap_release(empty);
+    return map_value(map);
+}
+
+/* ========== OBJECT PROTOCOL ========== */
+
+size_t collection_length(Value value) {
+    CollectionObject *object = object_of(value);
+    if (!object) return 0;
+    switch (object->kind) {
+        case COLLECTION_DEQUE: return rb_deque_len(object->as.deque);
+        case COLLECTION_HEAP: return rb_heap_len(object->as.heap);
+        case COLLECTION_SORTED_SET: return rb_sorted_set_len(object->as.set);
+        case COLLECTION_PVECTOR: return rb_pvector_len(object->as.vector);
+        case COLLECTION_PMAP: return rb_pmap_len(object->as.map);
+    }
+    return 0;
+}
+
+const char *collection_type_name(Value value) {
+    CollectionObject *object = object_of(value);
+    if (!object) return "object";
+    switch (object->kind) {
+        case COLLECTION_DEQUE: return "deque";
+        case COLLECTION_HEAP: return "heap";
+        case COLLECTION_SORTED_SET: return "sorted_set";
+        case COLLECTION_PVECTOR: return "pvector";
+        case COLLECTION_PMAP: return "pmap";
+    }
+    return "object";
+}
+
+static bool arg_number(Value *args, size_t arg_count, size_t i, double *out) {
+    if (i >= arg_count || args[i].type != VALUE_NUMBER) return false;
+    *out = args[i].as.number;
+    return true;
+}
+
+static bool arg_index(Value *args, size_t arg_count, int *out) {
+    double index;
+    if (!arg_number(args, arg_count, 0, &index) || !(index >= INT_MIN && index <= INT_MAX)) return false;
+    *out = (int)index;
+    return true;
+}
+
+/* push_back push_front pop_back pop_front front back get set clear */
+static bool deque_method(RbDeque *deque, const char *name, Value *args, size_t arg_count, Value *result) {
+    View view;
+    int index;
+    *result = value_null();
+
+    if (strcmp(name, "push_back") == 0 || strcmp(name, "push_front") == 0) {
+        bool back = name[5] == 'b';
+        for (size_t i = 0; i < arg_count; i++) {
+            if (!view_of(args[i], &view)) continue;
+            if (back) rb_deque_push_back(deque, view.value);
+            else rb_deque_push_front(deque, view.value);
+            view_done(&view);
+        }
+    } else if (strcmp(name, "pop_back") == 0) {
+        *result = take_rb(rb_deque_pop_back(deque));
+    } else if (strcmp(name, "pop_front") == 0) {
+        *result = take_rb(rb_deque_pop_front(deque));
+    } else if (strcmp(name, "front") == 0) {
+        *result = from_rb(rb_deque_front(deque));
+    } else if (strcmp(name, "back") == 0) {
+        *result = from_rb(rb_deque_back(deque));
+    } else if (strcmp(name, "get") == 0) {
+        if (arg_index(args, arg_count, &index)) *result = from_rb(rb_deque_get(deque, index));
+    } else if (strcmp(name, "set") == 0) {
+        if (arg_count == 2 && arg_index(args, arg_count, &index) && view_of(args[1], &view)) {
+            rb_deque_set(deque, index, view.value);
+            view_done(&view);
+        }
+    } else if (strcmp(name, "clear") == 0) {
+        rb_deque_clear(deque);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool arg_handle(Value *args, size_t arg_count, RbHeapHandle *out) {
+    double handle;
+    if (!arg_number(args, arg_count, 0, &handle) || !(handle >= 0 && handle < (double)SIZE_MAX)) return false;
+    *out = (RbHeapHandle)handle;
+    return true;
+}
+
+/* push(value, priority?) -> handle; pop peek peek_priority update remove contains clear */
+static bool heap_method(RbHeap *heap, const char *name, Value *args, size_t arg_count, Value *result) {
+    RbHeapHandle handle;
+    *result = value_null();
+
+    if (strcmp(name, "push") == 0) {
+        View value, priority;
+        if (arg_count < 1 || arg_count > 2 || !view_of(args[0], &value)) return true;
+        if (!view_of(args[arg_count - 1], &priority)) {
+            view_done(&value);
+            return true;
+        }
+        RbHeapHandle h = rb_heap_push(heap, priority.value, value.value);
+        if (h != RB_HEAP_NO_HANDLE) *result = value_number((double)h);
+        view_done(&value);
+        view_done(&priority);
+    } else if (strcmp(name, "pop") == 0) {
+        RbValue value;
+        if (rb_heap_pop(heap, NULL, &value)) *result = take_rb(value);
+    } else if (strcmp(name, "peek") == 0) {
+        RbValue value;
+        if (rb_heap_peek(heap, NULL, &value)) *result = from_rb(value);
+    } else if (strcmp(name, "peek_priority") == 0) {
+        RbValue priority;
+        if (rb_heap_peek(heap, &priority, NULL)) *result = from_rb(priority);
+    } else if (strcmp(name, "update") == 0) {
+        View priority;
+        if (arg_count == 2 && arg_handle(args, arg_count, &handle) && view_of(args[1], &priority)) {
+            *result = value_bool(rb_heap_update(heap, handle, priority.value));
+            view_done(&priority);
+        }
+    } else if (strcmp(name, "remove") == 0) {
+        RbValue value;
+        if (arg_handle(args, arg_count, &handle) && rb_heap_remove(heap, handle, NULL, &value)) {
+            *result = take_rb(value);
+        }
+    } else if (strcmp(name, "contains") == 0) {
+        *result = value_bool(arg_handle(args, arg_count, &handle) && rb_heap_contains(heap, handle));
+    } else if (strcmp(name, "clear") == 0) {
+        rb_heap_clear(heap);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* add remove contains min max range(lo, hi) count(lo, hi) clear */
+static bool set_method(RbSortedSet *set, const char *name, Value *args, size_t arg_count, Value *result) {
+    View view;
+    RbValue value;
+    *result = value_null();
+
+    if (strcmp(name, "add") == 0 || strcmp(name, "remove") == 0 || strcmp(name, "contains") == 0) {
+        if (arg_count != 1 || !view_of(args[0], &view)) return true;
+        if (name[0] == 'a') *result = value_bool(rb_sorted_set_add(set, view.value));
+        else if (name[0] == 'r') *result = value_bool(rb_sorted_set_remove(set, view.value));
+        else *result = value_bool(rb_sorted_set_contains(set, view.value));
+        view_done(&view);
+    } else if (strcmp(name, "min") == 0) {
+        if (rb_sorted_set_min(set, &value)) *result = from_rb(value);
+    } else if (strcmp(name, "max") == 0) {
+        if (rb_sorted_set_max(set, &value)) *result = from_rb(value);
+    } else if (strcmp(name, "range") == 0 || strcmp(name, "count") == 0) {
+        View low, high;
+        if (arg_count != 2 || !view_of(args[0], &low)) return true;
+        if (!view_of(args[1], &high)) {
+            view_done(&low);
+            return true;
+        }
+        size_t count = rb_sorted_set_count_range(set, low.value, high.value);
+        if (name[0] == 'c') {
+            *result = value_number((double)count);
+        } else {
+            Value *elements = malloc(sizeof(Value) * (count ? count : 1));
+            RbSortedSetIter it = rb_sorted_set_lower_bound(set, low.value);
+            for (size_t i = 0; i < count && rb_sorted_set_next(&it, &value); i++) {
+                elements[i] = from_rb(value);
+            }
+            *result = value_array(elements, count);
+        }
+        view_done(&low);
+        view_done(&high);
+    } else if (strcmp(name, "clear") == 0) {
+        rb_sorted_set_clear(set);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* get(i); push(x...) set(i, x) pop() concat(v) slice(start, end?) return a
+ * new pvector */
+static bool pvector_method(RbPVector *vector, const char *name, Value *args, size_t arg_count, Value *result) {
+    View view;
+    int index;
+    *result = value_null();
+
+    if (strcmp(name, "get") == 0) {
+        if (arg_index(args, arg_count, &index) && index >= 0) {
+            *result = from_rb(rb_pvector_get(vector, (size_t)index));
+        }
+    } else if (strcmp(name, "push") == 0) {
+        *result = vector_value(vector_with(vector, args, arg_count));
+    } else if (strcmp(name, "set") == 0) {
+        if (arg_count == 2 && arg_index(args, arg_count, &index) && index >= 0 &&
+            (size_t)index <= rb_pvector_len(vector) && view_of(args[1], &view)) {
+            *result = vector_value(rb_pvector_set(vector, (size_t)index, view.value));
+            view_done(&view);
+        }
+    } else if (strcmp(name, "pop") == 0) {
+        *result = vector_value(rb_pvector_pop(vector));
+    } else if (strcmp(name, "concat") == 0) {
+        CollectionObject *other = arg_count == 1 ? object_of(args[0]) : NULL;
+        if (other && other->kind == COLLECTION_PVECTOR) {
+            *result = vector_value(rb_pvector_concat(vector, other->as.vector));
+        }
+    } else if (strcmp(name, "slice") == 0) {
+        double start, end = (double)rb_pvector_len(vector);
+        if ((arg_count == 1 || (arg_count == 2 && arg_number(args, arg_count, 1, &end))) &&
+            arg_number(args, arg_count, 0, &start) && start >= 0 && end >= 0) {
+            /* Clamp before converting; the vector clamps to its length */
+            size_t length = rb_pvector_len(vector);
+            size_t from = start < (double)length ? (size_t)start : length;
+            size_t to = end < (double)length ? (size_t)end : length;
+            *result = vector_value(rb_pvector_slice(vector, from, to));
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* get(key) has(key) keys(); set(key, value...) remove(key) return a new pmap */
+static bool pmap_method(RbPMap *map, const char *name, Value *args, size_t arg_count, Value *result) {
+    View key;
+    RbValue value;
+    *result = value_null();
+
+    if (strcmp(name, "get") == 0 || strcmp(name, "has") == 0) {
+        if (arg_count != 1 || !view_of(args[0], &key)) return true;
+        bool found = rb_pmap_get_hashed(map, key.value, key_hash(args[0], &key), &value);
+        if (name[0] == 'h') *result = value_bool(found);
+        else if (found) *result = from_rb(value);
+        view_done(&key);
+    } else if (strcmp(name, "set") == 0) {
+        if (arg_count >= 2 && arg_count % 2 == 0) *result = map_value(map_with(map, args, arg_count));
+    } else if (strcmp(name, "remove") == 0) {
+        if (arg_count != 1 || !view_of(args[0], &key)) return true;
+        *result = map_value(rb_pmap_remove_hashed(map, key.value, key_hash(args[0], &key)));
+        view_done(&key);
+    } else if (strcmp(name, "keys") == 0) {
+        size_t count = rb_pmap_len(map);
+        Value *keys = malloc(sizeof(Value) * (count ? count : 1));
+        RbPMapIter it = rb_pmap_iter(map);
+        RbValue k;
+        for (size_t i = 0; i < count && rb_pmap_next(&it, &k, NULL); i++) {
+            keys[i] = from_rb(k);
+        }
+        *result = value_array(keys, count);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool collection_call_method(Value object_value, const char *name, Value *args, size_t arg_count, Value *result) {
+    CollectionObject *object = object_of(object_value);
+    if (!object) return false;
+    switch (object->kind) {
+        case COLLECTION_DEQUE: return deque_method(object->as.deque, name, args, arg_count, result);
+        case COLLECTION_HEAP: return heap_method(object->as.heap, name, args, arg_count, result);
+        case COLLECTION_SORTED_SET: return set_method(object->as.set, name, args, arg_count, result);
+        case COLLECTION_PVECTOR: return pvector_method(object->as.vector, name, args, arg_count, result);
+        case COLLECTION_PMAP: return pmap_method(object->as.map, name, args, arg_count, result);
+    }
+    return false;
+}
+
+/* ========== ITERATION ========== */
+
+void collection_iter_init(CollectionIter *it, Value value) {
+    memset(it, 0, sizeof(*it));
+    it->object = object_of(value);
+    if (it->object && it->object->kind == COLLECTION_SORTED_SET) {
+        it->set_iter = rb_sorted_set_begin(it->object->as.set);
+        it->version = it->object->as.set->version;
+    } else if (it->object && it->object->kind == COLLECTION_PVECTOR) {
+        it->vector_iter = rb_pvector_iter(it->object->as.vector);
+    } else if (it->object && it->object->kind == COLLECTION_PMAP) {
+        it->map_iter = rb_pmap_iter(it->object->as.map);
+    }
+}
+
+bool collection_iter_next(CollectionIter *it, Value *out) {
+    CollectionObject *object = it->object;
+    if (!object) return false;
+    RbValue value;
+
+    switch (object->kind) {
+        case COLLECTION_DEQUE:
+            if (it->index >= rb_deque_len(object->as.deque)) return false;
+            *out = from_rb(rb_deque_get(object->as.deque, (int)it->index++));
+            return true;
+
+        case COLLECTION_HEAP:
+            if (!rb_heap_at(object->as.heap, it->index++, NULL, &value)) return false;
+            *out = from_rb(value);
+            return true;
+
+        case COLLECTION_SORTED_SET: {
+            RbSortedSet *set = object->as.set;
+            if (it->version != set->version) {
+                /* The body changed the set: continue after the last value seen */
+                View last;
+                if (it->started && view_of(it->last, &last)) {
+                    it->set_iter = rb_sorted_set_upper_bound(set, last.value);
+                    view_done(&last);
+                } else {
+                    it->set_iter = rb_sorted_set_begin(set);
+                }
+                it->version = set->version;
+            }
+            if (!rb_sorted_set_next(&it->set_iter, &value)) return false;
+            *out = from_rb(value);
+            it->last = *out;
+            it->started = true;
+            return true;
+        }
+
+        /* Persistent versions never change under the loop */
+        case COLLECTION_PVECTOR:
+            if (!rb_pvector_next(&it->vector_iter, &value)) return false;
+            *out = from_rb(value);
+            return true;
+
+        case COLLECTION_PMAP:
+            if (!rb_pmap_next(&it->map_iter, &value, NULL)) return false;
+            *out = from_rb(value);
+            return true;
+    }
+    return false;
+}
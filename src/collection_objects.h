@@ -0,0 +1,85 @@
+#ifndef RUBOLT_COLLECTION_OBJECTS_H
+#define RUBOLT_COLLECTION_OBJECTS_H
+
+#include "interpreter.h"
+#include "../collections/rb_deque.h"
+#include "../collections/rb_heap.h"
+#include "../collections/rb_sorted_set.h"
+#include "../collections/rb_pvector.h"
+#include "../collections/rb_pmap.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/* The deque, heap, sorted_set, pvector and pmap builtins: script-visible
+ * wrappers around the native collections, carried in VALUE_COLLECTION
+ * values. Elements are nulls, bools, numbers and strings; strings are
+ * copied in and out. pvector and pmap are immutable: their updating
+ * methods return a new collection that shares structure with the old. */
+
+typedef enum {
+    COLLECTION_DEQUE,
+    COLLECTION_HEAP,
+    COLLECTION_SORTED_SET,
+    COLLECTION_PVECTOR,
+    COLLECTION_PMAP
+} CollectionKind;
+
+typedef struct {
+    CollectionKind kind;
+    union {
+        RbDeque *deque;
+        RbHeap *heap;
+        RbSortedSet *set;
+        RbPVector *vector;
+        RbPMap *map;
+    } as;
+} CollectionObject;
+
+/* State of one for-in loop over a collection. Deques and heaps are walked
+ * by index (a heap in storage order, smallest first); a sorted set walks
+ * its leaves and re-seeks past the last value if the loop body changed it.
+ * A pvector yields its values and a pmap its keys. */
+typedef struct {
+    CollectionObject *object;
+    size_t index;
+    RbSortedSetIter set_iter;
+    RbPVectorIter vector_iter;
+    RbPMapIter map_iter;
+    uint64_t version;
+    Value last;
+    bool started;
+} CollectionIter;
+
+/* ========== BUILTINS ========== */
+
+/* deque(x...) -> deque holding the arguments front to back */
+Value builtin_deque(Environment *env, Value *args, size_t arg_count);
+
+/* heap() -> min-heap; heap("max") -> max-heap */
+Value builtin_heap(Environment *env, Value *args, size_t arg_count);
+
+/* sorted_set(x...) -> set holding the arguments */
+Value builtin_sorted_set(Environment *env, Value *args, size_t arg_count);
+
+/* pvector(x...) -> persistent vector holding the arguments */
+Value builtin_pvector(Environment *env, Value *args, size_t arg_count);
+
+/* pmap(key, value, ...) -> persistent map of the argument pairs */
+Value builtin_pmap(Environment *env, Value *args, size_t arg_count);
+
+/* ========== OBJECT PROTOCOL ========== */
+
+/* Element count (the .length member and len()) */
+size_t collection_length(Value value);
+
+/* "deque", "heap", "sorted_set", "pvector" or "pmap" */
+const char *collection_type_name(Value value);
+
+/* Call object.name(args...); false if the collection has no such method */
+bool collection_call_method(Value object, const char *name, Value *args, size_t arg_count, Value *result);
+
+/* for-in support */
+void collection_iter_init(CollectionIter *it, Value value);
+bool collection_iter_next(CollectionIter *it, Value *out);
+
+#endif /* RUBOLT_COLLECTION_OBJECTS_H */
@@ -0,0 +1,691 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "csv.h"
+#include "mmap_file.h"
+#include "dtoa.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CSV_X86 1
+#include <immintrin.h>
+#define CSV_TARGET_SSE2 __attribute__((target("sse2")))
+#define CSV_TARGET_AVX2 __attribute__((target("avx2,pclmul")))
+#endif
+
+#define NEWLINE_FLAG    ((uint64_t)1 << 63)
+#define SCAN_WINDOW     ((size_t)256 * 1024)    /* bytes indexed per scan */
+#define STREAM_BUFFER   ((size_t)1 << 20)
+
+/* ========== STRUCTURAL INDEX ========== */
+
+/* An index entry is the offset of a field end (a delimiter or newline
+ * outside quotes), with NEWLINE_FLAG set when it ends a row. The scanners
+ * index whole 64-byte blocks; *carry is all ones while inside quotes. */
+
+static inline uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/* Append base + bit for every set bit of ends */
+static inline size_t emit_ends(uint64_t ends, uint64_t newlines, size_t base, uint64_t *out, size_t n) {
+    while (ends) {
+        unsigned bit = (unsigned)__builtin_ctzll(ends);
+        out[n++] = (uint64_t)(base + bit) | ((newlines >> bit) & 1) << 63;
+        ends &= ends - 1;
+    }
+    return n;
+}
+
+/* Field ends of one block, given its three masks */
+static inline size_t block_ends(uint64_t inside, uint64_t delims, uint64_t newlines, uint64_t *carry,
+                                size_t base, uint64_t *out, size_t n) {
+    inside ^= *carry;
+    *carry = (uint64_t)((int64_t)inside >> 63);
+    return emit_ends((delims | newlines) & ~inside, newlines, base, out, n);
+}
+
+static size_t index_scalar(const char *p, size_t blocks, char delimiter, uint64_t *carry, size_t base,
+                           uint64_t *out) {
+    size_t n = 0;
+    for (size_t b = 0; b < blocks; b++, p += 64, base += 64) {
+        uint64_t quotes = 0, delims = 0, newlines = 0;
+        for (unsigned i = 0; i < 64; i++) {
+            uint64_t bit = (uint64_t)1 << i;
+            quotes |= p[i] == '"' ? bit : 0;
+            delims |= p[i] == delimiter ? bit : 0;
+            newlines |= p[i] == '\n' ? bit : 0;
+        }
+        n = block_ends(prefix_xor(quotes), delims, newlines, carry, base, out, n);
+    }
+    return n;
+}
+
+#ifdef CSV_X86
+
+CSV_TARGET_SSE2
+static uint64_t match_sse2(const __m128i *v, __m128i c) {
+    uint64_t m0 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[0], c));
+    uint64_t m1 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[1], c));
+    uint64_t m2 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[2], c));
+    uint64_t m3 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[3], c));
+    return m0 | m1 << 16 | m2 << 32 | m3 << 48;
+}
+
+CSV_TARGET_SSE2
+static size_t index_sse2(const char *p, size_t blocks, char delimiter, uint64_t *carry, size_t base,
+                         uint64_t *out) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i delim = _mm_set1_epi8(delimiter);
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t n = 0;
+    for (size_t b = 0; b < blocks; b++, p += 64, base += 64) {
+        __m128i v[4];
+        for (int i = 0; i < 4; i++) v[i] = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        n = block_ends(prefix_xor(match_sse2(v, quote)), match_sse2(v, delim), match_sse2(v, newline),
+                       carry, base, out, n);
+    }
+    return n;
+}
+
+CSV_TARGET_AVX2
+static uint64_t match_avx2(__m256i lo, __m256i hi, __m256i c) {
+    uint64_t m0 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, c));
+    uint64_t m1 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, c));
+    return m0 | m1 << 32;
+}
+
+/* Prefix XOR as one carry-less multiply by all ones */
+CSV_TARGET_AVX2
+static uint64_t prefix_xor_clmul(uint64_t x) {
+    __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long)x), _mm_set1_epi8((char)0xFF), 0);
+    return (uint64_t)_mm_cvtsi128_si64(product);
+}
+
+CSV_TARGET_AVX2
+static size_t index_avx2(const char *p, size_t blocks, char delimiter, uint64_t *carry, size_t base,
+                         uint64_t *out) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i delim = _mm256_set1_epi8(delimiter);
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t n = 0;
+    for (size_t b = 0; b < blocks; b++, p += 64, base += 64) {
+        __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+        n = block_ends(prefix_xor_clmul(match_avx2(lo, hi, quote)), match_avx2(lo, hi, delim),
+                       match_avx2(lo, hi, newline), carry, base, out, n);
+    }
+    return n;
+}
+
+#endif /* CSV_X86 */
+
+/* ========== DISPATCH ========== */
+
+typedef size_t (*IndexFn)(const char *, size_t, char, uint64_t *, size_t, uint64_t *);
+
+typedef struct {
+    const char *isa;
+    IndexFn index;
+} CsvScanner;
+
+static const CsvScanner scalar_scanner = { "scalar", index_scalar };
+#ifdef CSV_X86
+static const CsvScanner sse2_scanner = { "sse2", index_sse2 };
+static const CsvScanner avx2_scanner = { "avx2", index_avx2 };
+#endif
+
+/* Chosen on first use; a racing first call just stores the same pointer */
+static const CsvScanner *active_scanner = NULL;
+
+static const CsvScanner *best_scanner(void) {
+#ifdef CSV_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul")) return &avx2_scanner;
+    if (__builtin_cpu_supports("sse2")) return &sse2_scanner;
+#endif
+    return &scalar_scanner;
+}
+
+static const CsvScanner *scanner(void) {
+    if (!active_scanner) active_scanner = best_scanner();
+    return active_scanner;
+}
+
+const char *csv_scan_isa(void) {
+    return scanner()->isa;
+}
+
+bool csv_scan_select(const char *isa) {
+    if (strcmp(isa, "scalar") == 0) { active_scanner = &scalar_scanner; return true; }
+#ifdef CSV_X86
+    __builtin_cpu_init();
+    if (strcmp(isa, "sse2") == 0 && __builtin_cpu_supports("sse2")) { active_scanner = &sse2_scanner; return true; }
+    if (strcmp(isa, "avx2") == 0 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul")) {
+        active_scanner = &avx2_scanner;
+        return true;
+    }
+#endif
+    return false;
+}
+
+/* ========== READER ========== */
+
+struct CsvReader {
+    char delimiter;
+    const char *data;           /* input window */
+    size_t length;
+    bool final;                 /* the window reaches the end of the input */
+    MappedFile file;
+    bool mapped;
+    FILE *stream;
+    char *buffer;               /* stream window */
+    size_t buffer_capacity;
+
+    /* Index of data[scanned - window .. scanned), consumed from index_pos */
+    uint64_t *index;
+    size_t index_count;
+    size_t index_pos;
+    size_t scanned;
+    uint64_t carry;
+
+    size_t row_start;           /* first byte of the next row */
+    CsvField *fields;
+    size_t field_capacity;
+    char *scratch;              /* unescaped quoted fields */
+    size_t scratch_capacity;
+    bool failed;
+};
+
+static CsvReader *reader_new(char delimiter) {
+    if (!delimiter) delimiter = ',';
+    if (delimiter == '"' || delimiter == '\n' || delimiter == '\r') return NULL;
+    CsvReader *reader = calloc(1, sizeof(CsvReader));
+    if (!reader) return NULL;
+    reader->delimiter = delimiter;
+    reader->index = malloc(sizeof(uint64_t) * SCAN_WINDOW);
+    if (!reader->index) {
+        free(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+CsvReader *csv_reader_open(const char *path, char delimiter) {
+    CsvReader *reader = reader_new(delimiter);
+    if (!reader) return NULL;
+    if (!mapped_file_open(&reader->file, path)) {
+        csv_reader_close(reader);
+        return NULL;
+    }
+    reader->mapped = true;
+    reader->data = reader->file.data;
+    reader->length = reader->file.size;
+    reader->final = true;
+    return reader;
+}
+
+CsvReader *csv_reader_open_stream(FILE *stream, char delimiter) {
+    CsvReader *reader = reader_new(delimiter);
+    if (!reader) return NULL;
+    reader->stream = stream;
+    reader->buffer = malloc(STREAM_BUFFER);
+    if (!reader->buffer) {
+        csv_reader_close(reader);
+        return NULL;
+    }
+    reader->buffer_capacity = STREAM_BUFFER;
+    reader->data = reader->buffer;
+    return reader;
+}
+
+CsvReader *csv_reader_open_buffer(const char *data, size_t length, char delimiter) {
+    CsvReader *reader = reader_new(delimiter);
+    if (!reader) return NULL;
+    reader->data = data;
+    reader->length = length;
+    reader->final = true;
+    return reader;
+}
+
+void csv_reader_close(CsvReader *reader) {
+    if (!reader) return;
+    if (reader->mapped) mapped_file_close(&reader->file);
+    free(reader->buffer);
+    free(reader->index);
+    free(reader->fields);
+    free(reader->scratch);
+    free(reader);
+}
+
+bool csv_reader_failed(const CsvReader *reader) {
+    return reader->failed;
+}
+
+/* Index the next window; false if nothing more can be indexed until the
+ * stream is refilled (or at the end of the input) */
+static bool scan_more(CsvReader *reader) {
+    reader->index_count = reader->index_pos = 0;
+    size_t available = reader->length - reader->scanned;
+    size_t blocks = (available < SCAN_WINDOW ? available : SCAN_WINDOW) / 64;
+    IndexFn index = scanner()->index;
+    if (blocks) {
+        reader->index_count = index(reader->data + reader->scanned, blocks, reader->delimiter, &reader->carry,
+                                    reader->scanned, reader->index);
+        reader->scanned += blocks * 64;
+        return true;
+    }
+    if (!available || !reader->final) return false;
+    /* The last partial block, padded with NULs */
+    char block[64] = {0};
+    memcpy(block, reader->data + reader->scanned, available);
+    reader->index_count = index(block, 1, reader->delimiter, &reader->carry, reader->scanned, reader->index);
+    reader->scanned = reader->length;
+    return true;
+}
+
+/* Move the unfinished row to the front of the stream buffer and read more
+ * after it. The row is indexed again from its start, which is always
+ * outside quotes. */
+static bool refill(CsvReader *reader) {
+    if (!reader->stream || reader->final) return false;
+    size_t keep = reader->length - reader->row_start;
+    memmove(reader->buffer, reader->buffer + reader->row_start, keep);
+    if (keep > reader->buffer_capacity / 2) {
+        char *grown = realloc(reader->buffer, reader->buffer_capacity * 2);
+        if (!grown) {
+            reader->failed = true;
+            return false;
+        }
+        reader->buffer = grown;
+        reader->buffer_capacity *= 2;
+    }
+    size_t want = reader->buffer_capacity - keep;
+    size_t got = fread(reader->buffer + keep, 1, want, reader->stream);
+    if (got < want) {
+        if (ferror(reader->stream)) reader->failed = true;
+        reader->final = true;
+    }
+    reader->data = reader->buffer;
+    reader->length = keep + got;
+    reader->row_start = 0;
+    reader->scanned = 0;
+    reader->carry = 0;
+    reader->index_count = reader->index_pos = 0;
+    return !reader->failed;
+}
+
+static bool grow_fields(CsvReader *reader) {
+    size_t capacity = reader->field_capacity ? reader->field_capacity * 2 : 16;
+    CsvField *fields = realloc(reader->fields, sizeof(CsvField) * capacity);
+    if (!fields) {
+        reader->failed = true;
+        return false;
+    }
+    reader->fields = fields;
+    reader->field_capacity = capacity;
+    return true;
+}
+
+/* Field n of the current row, before unquoting */
+static inline bool push_field(CsvReader *reader, size_t n, size_t start, size_t end) {
+    if (n == reader->field_capacity && !grow_fields(reader)) return false;
+    reader->fields[n].data = reader->data + start;
+    reader->fields[n].length = end - start;
+    return true;
+}
+
+/* Copy a quoted field's content, undoubling quotes; anything after the
+ * closing quote is dropped */
+static size_t unescape(const char *s, size_t length, char *out) {
+    const char *p = s + 1, *end = s + length;
+    size_t n = 0;
+    while (p < end) {
+        const char *q = memchr(p, '"', (size_t)(end - p));
+        size_t run = (size_t)((q ? q : end) - p);
+        memcpy(out + n, p, run);
+        n += run;
+        if (!q || q + 1 >= end || q[1] != '"') break;
+        out[n++] = '"';
+        p = q + 2;
+    }
+    return n;
+}
+
+/* Strip the row's line end and unquote its quoted fields. A quoted field
+ * without doubled quotes still points into the input; only the others are
+ * copied into scratch, which is sized for the whole row first so earlier
+ * fields stay valid. */
+static bool finish_row(CsvReader *reader, size_t n) {
+    CsvField *fields = reader->fields;
+    CsvField *last = &fields[n - 1];
+    if (last->length && last->data[last->length - 1] == '\r') last->length--;
+    size_t used = 0;
+    bool sized = false;
+    for (size_t i = 0; i < n; i++) {
+        const char *s = fields[i].data;
+        size_t length = fields[i].length;
+        if (!length || s[0] != '"') continue;
+        if (length >= 2 && s[length - 1] == '"' && !memchr(s + 1, '"', length - 2)) {
+            fields[i].data = s + 1;
+            fields[i].length = length - 2;
+            continue;
+        }
+        if (!sized) {
+            size_t row = (size_t)(last->data + last->length - fields[0].data);
+            if (row > reader->scratch_capacity) {
+                char *grown = realloc(reader->scratch, row);
+                if (!grown) {
+                    reader->failed = true;
+                    return false;
+                }
+                reader->scratch = grown;
+                reader->scratch_capacity = row;
+            }
+            sized = true;
+        }
+        fields[i].data = reader->scratch + used;
+        fields[i].length = unescape(s, length, reader->scratch + used);
+        used += fields[i].length;
+    }
+    return true;
+}
+
+bool csv_reader_next(CsvReader *reader, const CsvField **fields, size_t *count) {
+    while (!reader->failed) {
+        size_t n = 0;
+        size_t start = reader->row_start;
+        bool restart = false;
+        for (;;) {
+            if (reader->index_pos == reader->index_count) {
+                if (scan_more(reader)) continue;
+                if (refill(reader)) {
+                    restart = true;
+                    break;
+                }
+                if (reader->failed) return false;
+                /* End of input: the last row has no line break */
+                if (n == 0 && start >= reader->length) return false;
+                if (!push_field(reader, n++, start, reader->length)) return false;
+                reader->row_start = reader->length;
+                break;
+            }
+            uint64_t entry = reader->index[reader->index_pos++];
+            size_t end = (size_t)(entry & ~NEWLINE_FLAG);
+            if (!push_field(reader, n++, start, end)) return false;
+            start = end + 1;
+            if (entry & NEWLINE_FLAG) {
+                reader->row_start = start;
+                break;
+            }
+        }
+        if (restart) continue;
+        const CsvField *first = &reader->fields[0];
+        if (n == 1 && (first->length == 0 || (first->length == 1 && first->data[0] == '\r'))) continue;
+        if (!finish_row(reader, n)) return false;
+        *fields = reader->fields;
+        *count = n;
+        return true;
+    }
+    return false;
+}
+
+/* ========== TYPE INFERENCE ========== */
+
+CsvCellKind csv_classify(const char *s, size_t length, int64_t *integer, double *number) {
+    if (length == 0) return CSV_CELL_EMPTY;
+    size_t i = s[0] == '-' || s[0] == '+';
+    if (i < length && length - i <= 18) {
+        int64_t value = 0;
+        size_t j = i;
+        while (j < length && s[j] >= '0' && s[j] <= '9') value = value * 10 + (s[j++] - '0');
+        if (j == length && j > i) {
+            *integer = s[0] == '-' ? -value : value;
+            return CSV_CELL_INT;
+        }
+    }
+    /* Plain decimals of up to 15 digits are exact as mantissa / 10^k */
+    static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+                                     1e14, 1e15 };
+    int64_t mantissa = 0;
+    size_t digits = 0, point = 0, j = i;
+    for (; j < length && digits <= 15; j++) {
+        if (s[j] >= '0' && s[j] <= '9') mantissa = mantissa * 10 + (s[j] - '0'), digits++;
+        else if (s[j] == '.' && !point) point = j + 1;
+        else break;
+    }
+    if (j == length && point && digits && digits <= 15) {
+        double value = (double)mantissa / powers[length - point];
+        *number = s[0] == '-' ? -value : value;
+        return CSV_CELL_FLOAT;
+    }
+    char c = s[i < length ? i : 0];
+    if (length >= 64 || !((c >= '0' && c <= '9') || c == '.')) return CSV_CELL_STRING;
+    char text[64];
+    memcpy(text, s, length);
+    text[length] = '\0';
+    char *end;
+    *number = strtod(text, &end);
+    return end == text + length ? CSV_CELL_FLOAT : CSV_CELL_STRING;
+}
+
+void csv_kinds_note(CsvKinds *kinds, CsvCellKind kind) {
+    switch (kind) {
+        case CSV_CELL_EMPTY: kinds->has_empty = true; break;
+        case CSV_CELL_INT: kinds->has_int = true; break;
+        case CSV_CELL_FLOAT: kinds->has_float = true; break;
+        case CSV_CELL_STRING: kinds->has_string = true; break;
+    }
+}
+
+CsvType csv_kinds_type(const CsvKinds *kinds) {
+    if (kinds->has_string) return CSV_TYPE_STRING;
+    if (kinds->has_int && !kinds->has_float && !kinds->has_empty) return CSV_TYPE_INT;
+    return CSV_TYPE_FLOAT;
+}
+
+const char *csv_type_name(CsvType type) {
+    switch (type) {
+        case CSV_TYPE_INT: return "int";
+        case CSV_TYPE_FLOAT: return "float";
+        case CSV_TYPE_STRING: return "string";
+    }
+    return "string";
+}
+
+bool csv_infer_schema(const char *path, char delimiter, size_t max_rows, CsvSchema *schema) {
+    memset(schema, 0, sizeof(*schema));
+    CsvReader *reader = csv_reader_open(path, delimiter);
+    if (!reader) return false;
+    const CsvField *fields;
+    size_t count;
+    bool ok = csv_reader_next(reader, &fields, &count);
+    CsvKinds *kinds = NULL;
+    if (ok) {
+        schema->names = calloc(count, sizeof(char *));
+        schema->types = malloc(sizeof(CsvType) * count);
+        kinds = calloc(count, sizeof(CsvKinds));
+        ok = schema->names && schema->types && kinds;
+        for (size_t i = 0; ok && i < count; i++) {
+            ok = (schema->names[i] = malloc(fields[i].length + 1)) != NULL;
+            if (!ok) break;
+            memcpy(schema->names[i], fields[i].data, fields[i].length);
+            schema->names[i][fields[i].length] = '\0';
+            schema->count++;
+        }
+    }
+    size_t columns = schema->count;
+    for (size_t row = 0; ok && (max_rows == 0 || row < max_rows) && csv_reader_next(reader, &fields, &count); row++) {
+        for (size_t i = 0; i < columns; i++) {
+            int64_t integer;
+            double number;
+            csv_kinds_note(&kinds[i], i < count ? csv_classify(fields[i].data, fields[i].length, &integer, &number)
+                                                : CSV_CELL_EMPTY);
+        }
+    }
+    ok = ok && !csv_reader_failed(reader);
+    for (size_t i = 0; ok && i < columns; i++) schema->types[i] = csv_kinds_type(&kinds[i]);
+    free(kinds);
+    csv_reader_close(reader);
+    if (!ok) csv_schema_free(schema);
+    return ok;
+}
+
+void csv_schema_free(CsvSchema *schema) {
+    for (size_t i = 0; i < schema->count; i++) free(schema->names[i]);
+    free(schema->names);
+    free(schema->types);
+    memset(schema, 0, sizeof(*schema));
+}
+
+PackedArray *csv_read_column(const char *path, char delimiter, size_t column) {
+    CsvReader *reader = csv_reader_open(path, delimiter);
+    if (!reader) return NULL;
+    PackedArray *values = packed_array_new(0);
+    const CsvField *fields;
+    size_t width;
+    bool ok = values && csv_reader_next(reader, &fields, &width) && column < width;
+    while (ok && csv_reader_next(reader, &fields, &width)) {
+        int64_t integer;
+        double number = NAN;
+        CsvCellKind kind = column < width ? csv_classify(fields[column].data, fields[column].length, &integer, &number)
+                                          : CSV_CELL_EMPTY;
+        ok = packed_array_push(values, kind == CSV_CELL_INT ? (double)integer : kind == CSV_CELL_FLOAT ? number : NAN);
+    }
+    ok = ok && !csv_reader_failed(reader);
+    csv_reader_close(reader);
+    if (!ok) {
+        packed_array_free(values);
+        return NULL;
+    }
+    return values;
+}
+
+/* ========== WRITER ========== */
+
+struct CsvWriter {
+    FILE *file;
+    bool owns_file;
+    char delimiter;
+    bool in_row;                /* a field was written on this row */
+    bool failed;
+    size_t used;
+    char buffer[CSV_WRITE_BUFFER];
+};
+
+static CsvWriter *writer_new(FILE *file, bool owns_file, char delimiter) {
+    CsvWriter *writer = malloc(sizeof(CsvWriter));
+    if (!writer) return NULL;
+    writer->file = file;
+    writer->owns_file = owns_file;
+    writer->delimiter = delimiter ? delimiter : ',';
+    writer->in_row = false;
+    writer->failed = false;
+    writer->used = 0;
+    return writer;
+}
+
+CsvWriter *csv_writer_open(const char *path, char delimiter) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return NULL;
+    /* Writes arrive in CSV_WRITE_BUFFER blocks already */
+    setvbuf(file, NULL, _IONBF, 0);
+    CsvWriter *writer = writer_new(file, true, delimiter);
+    if (!writer) fclose(file);
+    return writer;
+}
+
+CsvWriter *csv_writer_open_stream(FILE *stream, char delimiter) {
+    return writer_new(stream, false, delimiter);
+}
+
+static void writer_flush(CsvWriter *writer) {
+    if (writer->used && fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used) writer->failed = true;
+    writer->used = 0;
+}
+
+static void writer_put(CsvWriter *writer, const char *data, size_t length) {
+    if (length > CSV_WRITE_BUFFER - writer->used) {
+        writer_flush(writer);
+        if (length >= CSV_WRITE_BUFFER) {
+            if (fwrite(data, 1, length, writer->file) != length) writer->failed = true;
+            return;
+        }
+    }
+    memcpy(writer->buffer + writer->used, data, length);
+    writer->used += length;
+}
+
+static void writer_byte(CsvWriter *writer, char c) {
+    if (writer->used == CSV_WRITE_BUFFER) writer_flush(writer);
+    writer->buffer[writer->used++] = c;
+}
+
+static void writer_separate(CsvWriter *writer) {
+    if (writer->in_row) writer_byte(writer, writer->delimiter);
+    writer->in_row = true;
+}
+
+void csv_writer_field(CsvWriter *writer, const char *data, size_t length) {
+    writer_separate(writer);
+    const char delimiter = writer->delimiter;
+    size_t i = 0;
+    while (i < length && data[i] != delimiter && data[i] != '"' && data[i] != '\n' && data[i] != '\r') i++;
+    if (i == length) {
+        writer_put(writer, data, length);
+        return;
+    }
+    writer_byte(writer, '"');
+    const char *p = data, *end = data + length;
+    for (const char *q; (q = memchr(p, '"', (size_t)(end - p))) != NULL; p = q + 1) {
+        writer_put(writer, p, (size_t)(q - p) + 1);
+        writer_byte(writer, '"');
+    }
+    writer_put(writer, p, (size_t)(end - p));
+    writer_byte(writer, '"');
+}
+
+void csv_writer_number(CsvWriter *writer, double value) {
+    writer_separate(writer);
+    if (value != value) return;
+    /* The shortest form that reads back exactly */
+    char text[DTOA_BUFFER_SIZE];
+    writer_put(writer, text, dtoa_shortest(value, text));
+}
+
+void csv_writer_int(CsvWriter *writer, int64_t value) {
+    writer_separate(writer);
+    char text[24];
+    char *p = text + sizeof(text);
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) *--p = '-';
+    writer_put(writer, p, (size_t)(text + sizeof(text) - p));
+}
+
+void csv_writer_end_row(CsvWriter *writer) {
+    writer_byte(writer, '\n');
+    writer->in_row = false;
+}
+
+bool csv_writer_close(CsvWriter *writer) {
+    if (!writer) return false;
+    writer_flush(writer);
+    bool ok = !writer->failed;
+    if (writer->owns_file) ok = fclose(writer->file) == 0 && ok;
+    else ok = fflush(writer->file) == 0 && ok;
+    free(writer);
+    return ok;
+}
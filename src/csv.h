@@ -0,0 +1,142 @@
+#ifndef RUBOLT_CSV_H
+#define RUBOLT_CSV_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "packed_array.h"
+
+/* Streaming CSV reader and writer.
+ *
+ * The reader finds fields with a structural index instead of a byte loop:
+ * each 64-byte block is compared against the delimiter, '"' and '\n' at
+ * once (SSE2 or AVX2), giving three bitmasks. The prefix XOR of the quote
+ * mask (a carry-less multiply by all ones where PCLMUL is available) marks
+ * the bytes inside quotes, and the delimiters and newlines outside them
+ * are the field ends. Rows are then cut from the index without looking at
+ * the bytes in between. Input is a whole file mapped with mmap, a FILE*
+ * read through a refilled buffer, or a caller's buffer.
+ *
+ * Fields follow RFC 4180: a quoted field may hold delimiters, newlines and
+ * doubled quotes; a "\r\n" line end is accepted; blank lines are skipped.
+ * A quote inside an unquoted field starts a quoted section, as in most
+ * vectorized parsers.
+ *
+ * The writer appends to a 64 KB buffer and quotes a field only when it
+ * holds the delimiter, a quote or a line break. */
+
+/* ========== READER ========== */
+
+typedef struct CsvReader CsvReader;
+
+/* One field of the current row. Unquoted fields point into the input;
+ * quoted ones into the reader's scratch buffer, unescaped. Valid until the
+ * next csv_reader_next call. */
+typedef struct {
+    const char *data;
+    size_t length;
+} CsvField;
+
+/* Read a file through mmap */
+CsvReader *csv_reader_open(const char *path, char delimiter);
+
+/* Read a stream through a refilled buffer (pipes, sockets, stdin). The
+ * stream is not closed by csv_reader_close. */
+CsvReader *csv_reader_open_stream(FILE *stream, char delimiter);
+
+/* Read a caller's buffer, which must outlive the reader */
+CsvReader *csv_reader_open_buffer(const char *data, size_t length, char delimiter);
+
+/* Next row into *fields / *count; false at the end of the input or on an
+ * error (see csv_reader_failed) */
+bool csv_reader_next(CsvReader *reader, const CsvField **fields, size_t *count);
+
+/* True after a read or allocation error */
+bool csv_reader_failed(const CsvReader *reader);
+
+void csv_reader_close(CsvReader *reader);
+
+/* ========== TYPE INFERENCE ========== */
+
+typedef enum {
+    CSV_CELL_EMPTY,
+    CSV_CELL_INT,
+    CSV_CELL_FLOAT,
+    CSV_CELL_STRING
+} CsvCellKind;
+
+typedef enum {
+    CSV_TYPE_INT,
+    CSV_TYPE_FLOAT,
+    CSV_TYPE_STRING
+} CsvType;
+
+/* What a cell holds: an integer of up to 18 digits (into *integer), any
+ * other number strtod accepts in full (into *number), or text */
+CsvCellKind csv_classify(const char *s, size_t length, int64_t *integer, double *number);
+
+/* Evidence about one column's cells. A column is INT if every cell is an
+ * integer, FLOAT if every cell is a number or empty, else STRING. */
+typedef struct {
+    bool has_int;
+    bool has_float;
+    bool has_empty;
+    bool has_string;
+} CsvKinds;
+
+void csv_kinds_note(CsvKinds *kinds, CsvCellKind kind);
+CsvType csv_kinds_type(const CsvKinds *kinds);
+
+/* "int", "float" or "string" */
+const char *csv_type_name(CsvType type);
+
+/* Header names and column types of a file with a header row, inferred from
+ * the first max_rows records (0 = all of them) */
+typedef struct {
+    size_t count;
+    char **names;
+    CsvType *types;
+} CsvSchema;
+
+bool csv_infer_schema(const char *path, char delimiter, size_t max_rows, CsvSchema *schema);
+void csv_schema_free(CsvSchema *schema);
+
+/* Column `column` of a file with a header row as a packed array (empty
+ * and non-numeric cells are NaN); NULL on error */
+PackedArray *csv_read_column(const char *path, char delimiter, size_t column);
+
+/* ========== WRITER ========== */
+
+#define CSV_WRITE_BUFFER (64 * 1024)
+
+typedef struct CsvWriter CsvWriter;
+
+/* Create / truncate a file */
+CsvWriter *csv_writer_open(const char *path, char delimiter);
+
+/* Write to a stream, which csv_writer_close flushes but does not close */
+CsvWriter *csv_writer_open_stream(FILE *stream, char delimiter);
+
+/* Append one field to the current row */
+void csv_writer_field(CsvWriter *writer, const char *data, size_t length);
+
+/* Numbers are written unquoted; NaN as an empty field */
+void csv_writer_number(CsvWriter *writer, double value);
+void csv_writer_int(CsvWriter *writer, int64_t value);
+
+/* End the current row with '\n' */
+void csv_writer_end_row(CsvWriter *writer);
+
+/* Flush and release; false if any write failed */
+bool csv_writer_close(CsvWriter *writer);
+
+/* ========== DISPATCH ========== */
+
+/* "avx2", "sse2" or "scalar" */
+const char *csv_scan_isa(void);
+
+/* Force a scanner (for benchmarks); false if the CPU lacks it */
+bool csv_scan_select(const char *isa);
+
+#endif /* RUBOLT_CSV_H */
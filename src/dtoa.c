@@ -0,0 +1,317 @@
+#include "dtoa.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* ========== DIY FLOATING POINT ========== */
+
+/* f * 2^e with a 64-bit significand */
+typedef struct {
+    uint64_t f;
+    int e;
+} DiyFp;
+
+#define SIGNIFICAND_MASK ((uint64_t)0x000FFFFFFFFFFFFF)
+#define HIDDEN_BIT ((uint64_t)0x0010000000000000)
+#define EXPONENT_BIAS (0x3FF + 52)
+#define DENORMAL_EXPONENT (1 - EXPONENT_BIAS)
+
+/* Product rounded to 64 bits, without relying on a 128-bit type */
+static DiyFp diy_multiply(DiyFp x, DiyFp y) {
+    const uint64_t m32 = 0xFFFFFFFFu;
+    uint64_t a = x.f >> 32, b = x.f & m32, c = y.f >> 32, d = y.f & m32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t mid = (bd >> 32) + (ad & m32) + (bc & m32) + ((uint64_t)1 << 31);
+    return (DiyFp){ ac + (ad >> 32) + (bc >> 32) + (mid >> 32), x.e + y.e + 64 };
+}
+
+static DiyFp diy_normalize(DiyFp x) {
+    while (!(x.f & ((uint64_t)1 << 63))) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+/* 10^k for k = -348, -340, ..., 340, rounded to 64 bits */
+static const DiyFp cached_powers[] = {
+    { 0xfa8fd5a0081c0288ULL, -1220 }, /* 1e-348 */
+    { 0xbaaee17fa23ebf76ULL, -1193 }, /* 1e-340 */
+    { 0x8b16fb203055ac76ULL, -1166 }, /* 1e-332 */
+    { 0xcf42894a5dce35eaULL, -1140 }, /* 1e-324 */
+    { 0x9a6bb0aa55653b2dULL, -1113 }, /* 1e-316 */
+    { 0xe61acf033d1a45dfULL, -1087 }, /* 1e-308 */
+    { 0xab70fe17c79ac6caULL, -1060 }, /* 1e-300 */
+    { 0xff77b1fcbebcdc4fULL, -1034 }, /* 1e-292 */
+    { 0xbe5691ef416bd60cULL, -1007 }, /* 1e-284 */
+    { 0x8dd01fad907ffc3cULL, -980 }, /* 1e-276 */
+    { 0xd3515c2831559a83ULL, -954 }, /* 1e-268 */
+    { 0x9d71ac8fada6c9b5ULL, -927 }, /* 1e-260 */
+    { 0xea9c227723ee8bcbULL, -901 }, /* 1e-252 */
+    { 0xaecc49914078536dULL, -874 }, /* 1e-244 */
+    { 0x823c12795db6ce57ULL, -847 }, /* 1e-236 */
+    { 0xc21094364dfb5637ULL, -821 }, /* 1e-228 */
+    { 0x9096ea6f3848984fULL, -794 }, /* 1e-220 */
+    { 0xd77485cb25823ac7ULL, -768 }, /* 1e-212 */
+    { 0xa086cfcd97bf97f4ULL, -741 }, /* 1e-204 */
+    { 0xef340a98172aace5ULL, -715 }, /* 1e-196 */
+    { 0xb23867fb2a35b28eULL, -688 }, /* 1e-188 */
+    { 0x84c8d4dfd2c63f3bULL, -661 }, /* 1e-180 */
+    { 0xc5dd44271ad3cdbaULL, -635 }, /* 1e-172 */
+    { 0x936b9fcebb25c996ULL, -608 }, /* 1e-164 */
+    { 0xdbac6c247d62a584ULL, -582 }, /* 1e-156 */
+    { 0xa3ab66580d5fdaf6ULL, -555 }, /* 1e-148 */
+    { 0xf3e2f893dec3f126ULL, -529 }, /* 1e-140 */
+    { 0xb5b5ada8aaff80b8ULL, -502 }, /* 1e-132 */
+    { 0x87625f056c7c4a8bULL, -475 }, /* 1e-124 */
+    { 0xc9bcff6034c13053ULL, -449 }, /* 1e-116 */
+    { 0x964e858c91ba2655ULL, -422 }, /* 1e-108 */
+    { 0xdff9772470297ebdULL, -396 }, /* 1e-100 */
+    { 0xa6dfbd9fb8e5b88fULL, -369 }, /* 1e-92 */
+    { 0xf8a95fcf88747d94ULL, -343 }, /* 1e-84 */
+    { 0xb94470938fa89bcfULL, -316 }, /* 1e-76 */
+    { 0x8a08f0f8bf0f156bULL, -289 }, /* 1e-68 */
+    { 0xcdb02555653131b6ULL, -263 }, /* 1e-60 */
+    { 0x993fe2c6d07b7facULL, -236 }, /* 1e-52 */
+    { 0xe45c10c42a2b3b06ULL, -210 }, /* 1e-44 */
+    { 0xaa242499697392d3ULL, -183 }, /* 1e-36 */
+    { 0xfd87b5f28300ca0eULL, -157 }, /* 1e-28 */
+    { 0xbce5086492111aebULL, -130 }, /* 1e-20 */
+    { 0x8cbccc096f5088ccULL, -103 }, /* 1e-12 */
+    { 0xd1b71758e219652cULL, -77 }, /* 1e-4 */
+    { 0x9c40000000000000ULL, -50 }, /* 1e4 */
+    { 0xe8d4a51000000000ULL, -24 }, /* 1e12 */
+    { 0xad78ebc5ac620000ULL, 3 }, /* 1e20 */
+    { 0x813f3978f8940984ULL, 30 }, /* 1e28 */
+    { 0xc097ce7bc90715b3ULL, 56 }, /* 1e36 */
+    { 0x8f7e32ce7bea5c70ULL, 83 }, /* 1e44 */
+    { 0xd5d238a4abe98068ULL, 109 }, /* 1e52 */
+    { 0x9f4f2726179a2245ULL, 136 }, /* 1e60 */
+    { 0xed63a231d4c4fb27ULL, 162 }, /* 1e68 */
+    { 0xb0de65388cc8ada8ULL, 189 }, /* 1e76 */
+    { 0x83c7088e1aab65dbULL, 216 }, /* 1e84 */
+    { 0xc45d1df942711d9aULL, 242 }, /* 1e92 */
+    { 0x924d692ca61be758ULL, 269 }, /* 1e100 */
+    { 0xda01ee641a708deaULL, 295 }, /* 1e108 */
+    { 0xa26da3999aef774aULL, 322 }, /* 1e116 */
+    { 0xf209787bb47d6b85ULL, 348 }, /* 1e124 */
+    { 0xb454e4a179dd1877ULL, 375 }, /* 1e132 */
+    { 0x865b86925b9bc5c2ULL, 402 }, /* 1e140 */
+    { 0xc83553c5c8965d3dULL, 428 }, /* 1e148 */
+    { 0x952ab45cfa97a0b3ULL, 455 }, /* 1e156 */
+    { 0xde469fbd99a05fe3ULL, 481 }, /* 1e164 */
+    { 0xa59bc234db398c25ULL, 508 }, /* 1e172 */
+    { 0xf6c69a72a3989f5cULL, 534 }, /* 1e180 */
+    { 0xb7dcbf5354e9beceULL, 561 }, /* 1e188 */
+    { 0x88fcf317f22241e2ULL, 588 }, /* 1e196 */
+    { 0xcc20ce9bd35c78a5ULL, 614 }, /* 1e204 */
+    { 0x98165af37b2153dfULL, 641 }, /* 1e212 */
+    { 0xe2a0b5dc971f303aULL, 667 }, /* 1e220 */
+    { 0xa8d9d1535ce3b396ULL, 694 }, /* 1e228 */
+    { 0xfb9b7cd9a4a7443cULL, 720 }, /* 1e236 */
+    { 0xbb764c4ca7a44410ULL, 747 }, /* 1e244 */
+    { 0x8bab8eefb6409c1aULL, 774 }, /* 1e252 */
+    { 0xd01fef10a657842cULL, 800 }, /* 1e260 */
+    { 0x9b10a4e5e9913129ULL, 827 }, /* 1e268 */
+    { 0xe7109bfba19c0c9dULL, 853 }, /* 1e276 */
+    { 0xac2820d9623bf429ULL, 880 }, /* 1e284 */
+    { 0x80444b5e7aa7cf85ULL, 907 }, /* 1e292 */
+    { 0xbf21e44003acdd2dULL, 933 }, /* 1e300 */
+    { 0x8e679c2f5e44ff8fULL, 960 }, /* 1e308 */
+    { 0xd433179d9c8cb841ULL, 986 }, /* 1e316 */
+    { 0x9e19db92b4e31ba9ULL, 1013 }, /* 1e324 */
+    { 0xeb96bf6ebadf77d9ULL, 1039 }, /* 1e332 */
+    { 0xaf87023b9bf0ee6bULL, 1066 }, /* 1e340 */
+};
+
+/* A power 10^-k that scales a number with binary exponent e so that its
+ * exponent lands in [-60, -32] */
+static DiyFp cached_power(int e, int *k) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ki = (int)dk;
+    if (dk - ki > 0.0) ki++;
+    unsigned index = (unsigned)((ki >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+    return cached_powers[index];
+}
+
+/* ========== GRISU3 ========== */
+
+/* Move the last digit down while that brings the result closer to the
+ * exact value; false if the result cannot be proven to be the closest
+ * shortest one */
+static bool round_weed(char *buffer, int length, uint64_t distance_too_high_w, uint64_t unsafe_interval,
+                       uint64_t rest, uint64_t ten_kappa, uint64_t unit) {
+    uint64_t small_distance = distance_too_high_w - unit;
+    uint64_t big_distance = distance_too_high_w + unit;
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+           (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance)) {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance)) {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+static const uint32_t powers_of_ten[] = { 1,      10,      100,      1000,      10000,
+                                          100000, 1000000, 10000000, 100000000, 1000000000 };
+
+/* Digits of w between low and high, all scaled by the same power of ten */
+static bool digit_gen(DiyFp low, DiyFp w, DiyFp high, char *buffer, int *length, int *kappa) {
+    uint64_t unit = 1;
+    DiyFp too_low = { low.f - unit, low.e };
+    DiyFp too_high = { high.f + unit, high.e };
+    uint64_t unsafe_interval = too_high.f - too_low.f;
+    int shift = -w.e;
+    uint64_t one = (uint64_t)1 << shift;
+    uint32_t integrals = (uint32_t)(too_high.f >> shift);
+    uint64_t fractionals = too_high.f & (one - 1);
+
+    int digits = 10;
+    while (digits > 1 && integrals < powers_of_ten[digits - 1]) digits--;
+    uint32_t divisor = powers_of_ten[digits - 1];
+    *kappa = digits;
+    *length = 0;
+    while (*kappa > 0) {
+        buffer[(*length)++] = (char)('0' + integrals / divisor);
+        integrals %= divisor;
+        (*kappa)--;
+        uint64_t rest = ((uint64_t)integrals << shift) + fractionals;
+        if (rest < unsafe_interval) {
+            return round_weed(buffer, *length, too_high.f - w.f, unsafe_interval, rest, (uint64_t)divisor << shift,
+                              unit);
+        }
+        divisor /= 10;
+    }
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        buffer[(*length)++] = (char)('0' + (fractionals >> shift));
+        fractionals &= one - 1;
+        (*kappa)--;
+        if (fractionals < unsafe_interval) {
+            return round_weed(buffer, *length, (too_high.f - w.f) * unit, unsafe_interval, fractionals, one, unit);
+        }
+    }
+}
+
+/* Shortest digits of a positive finite value and its decimal exponent
+ * (value = digits * 10^exponent); false when Grisu3 cannot decide */
+static bool grisu3(double value, char *buffer, int *length, int *exponent) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased = (int)(bits >> 52 & 0x7FF);
+    DiyFp v = { bits & SIGNIFICAND_MASK, DENORMAL_EXPONENT };
+    if (biased) {
+        v.f += HIDDEN_BIT;
+        v.e = biased - EXPONENT_BIAS;
+    }
+
+    /* The rounding interval: halfway to the neighbours, which are closer
+     * below when v is a power of two */
+    DiyFp plus = diy_normalize((DiyFp){ (v.f << 1) + 1, v.e - 1 });
+    DiyFp minus = v.f == HIDDEN_BIT && biased > 1 ? (DiyFp){ (v.f << 2) - 1, v.e - 2 }
+                                                   : (DiyFp){ (v.f << 1) - 1, v.e - 1 };
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    DiyFp w = diy_normalize(v);
+
+    int mk;
+    DiyFp c_mk = cached_power(plus.e, &mk);
+    int kappa;
+    bool ok = digit_gen(diy_multiply(minus, c_mk), diy_multiply(w, c_mk), diy_multiply(plus, c_mk), buffer, length,
+                        &kappa);
+    *exponent = mk + kappa;
+    return ok;
+}
+
+/* Digits of the correctly rounded %e output at the shortest precision
+ * that reads back exactly */
+static void fallback(double value, char *buffer, int *length, int *exponent) {
+    char text[40];
+    for (int precision = 1; precision <= 17; precision++) {
+        snprintf(text, sizeof(text), "%.*e", precision - 1, value);
+        if (strtod(text, NULL) == value) break;
+    }
+    /* text is d[.ddd]e[+-]xx */
+    char *p = text;
+    *length = 0;
+    for (; *p != 'e'; p++) {
+        if (*p != '.') buffer[(*length)++] = *p;
+    }
+    while (*length > 1 && buffer[*length - 1] == '0') (*length)--;
+    *exponent = atoi(p + 1) - (*length - 1);
+}
+
+/* ========== LAYOUT ========== */
+
+size_t dtoa_shortest(double value, char *out) {
+    char *p = out;
+    if (value != value) {
+        memcpy(out, "nan", 4);
+        return 3;
+    }
+    if (signbit(value)) {
+        *p++ = '-';
+        value = -value;
+    }
+    if (value == 0) {
+        memcpy(p, "0", 2);
+        return (size_t)(p - out) + 1;
+    }
+    if (value > 1.7976931348623157e308) {
+        memcpy(p, "inf", 4);
+        return (size_t)(p - out) + 3;
+    }
+
+    char digits[20];
+    int length, exponent;
+    if (!grisu3(value, digits, &length, &exponent)) fallback(value, digits, &length, &exponent);
+
+    /* point = position of the decimal point after the first digit */
+    int point = length + exponent;
+    if (point > -4 && point <= 16) {
+        if (exponent >= 0) {
+            memcpy(p, digits, (size_t)length);
+            p += length;
+            memset(p, '0', (size_t)exponent);
+            p += exponent;
+        } else if (point > 0) {
+            memcpy(p, digits, (size_t)point);
+            p += point;
+            *p++ = '.';
+            memcpy(p, digits + point, (size_t)(length - point));
+            p += length - point;
+        } else {
+            *p++ = '0';
+            *p++ = '.';
+            memset(p, '0', (size_t)-point);
+            p += -point;
+            memcpy(p, digits, (size_t)length);
+            p += length;
+        }
+    } else {
+        *p++ = digits[0];
+        if (length > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, (size_t)(length - 1));
+            p += length - 1;
+        }
+        int e = point - 1;
+        *p++ = 'e';
+        *p++ = e < 0 ? '-' : '+';
+        if (e < 0) e = -e;
+        if (e >= 100) *p++ = (char)('0' + e / 100);
+        *p++ = (char)('0' + e / 10 % 10);
+        *p++ = (char)('0' + e % 10);
+    }
+    *p = '\0';
+    return (size_t)(p - out);
+}
@@ -0,0 +1,26 @@
+#ifndef RUBOLT_DTOA_H
+#define RUBOLT_DTOA_H
+
+#include <stddef.h>
+
+/* Shortest decimal form of a double, for print and the CSV writer.
+ *
+ * dtoa_shortest writes the fewest significant digits that read back
+ * (with strtod) as exactly the same double, choosing the closest such
+ * number when several have that many digits. Digits come from Grisu3,
+ * which works in 64-bit integer arithmetic and settles about 99.5% of
+ * inputs; it detects the rest, which fall back to trying printf
+ * precisions from 1 to 17 digits.
+ *
+ * The layout follows Python's repr without the trailing ".0": plain
+ * decimal when the exponent is in [-4, 16), otherwise scientific with at
+ * least two exponent digits.
+ *   0.1  100  -2.5  123456.789  1e+16  1.5e-07  nan  inf  -inf  -0 */
+
+#define DTOA_BUFFER_SIZE 32
+
+/* Writes a NUL-terminated string to out (DTOA_BUFFER_SIZE bytes) and
+ * returns its length */
+size_t dtoa_shortest(double value, char *out);
+
+#endif /* RUBOLT_DTOA_H */
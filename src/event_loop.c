@@ -1,12 +1,28 @@
+#ifndef _WIN32
+#define _DEFAULT_SOURCE     /* pread/pwrite/fsync under -std=c99 */
+#endif
+
 #include "event_loop.h"
+#include "uring_backend.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
 static uint64_t now_ms(void){ return GetTickCount64(); }
 #else
 #include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#define EVENT_LOOP_HAVE_EPOLL 1
+#define EVENT_LOOP_MAX_READY 64
+#endif
 static uint64_t now_ms(void){ struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return (uint64_t)ts.tv_sec*1000ull + ts.tv_nsec/1000000ull; }
 #endif
 
@@ -18,11 +34,25 @@ static Event *event_new(EventType type, EventCallback cb, void *data) {
 
 EventLoop *event_loop_new(void) {
     EventLoop *loop = (EventLoop *)calloc(1, sizeof(EventLoop));
-    if (!loop) return NULL; loop->running = false; loop->next_event_id = 1; loop->last_tick_time = now_ms(); return loop;
+    if (!loop) return NULL; loop->running = false; loop->next_event_id = 1; loop->last_tick_time = now_ms();
+#ifdef _WIN32
+    event_loop_init_iocp(loop);
+#else
+    event_loop_init_epoll(loop);
+#endif
+    return loop;
 }
 
+static void io_backend_shutdown(EventLoop *loop);
+
 void event_loop_free(EventLoop *loop) {
-    if (!loop) return; while (loop->events) { Event *n = loop->events->next; free(loop->events); loop->events = n; } free(loop);
+    if (!loop) return; io_backend_shutdown(loop); while (loop->events) { Event *n = loop->events->next; free(loop->events); loop->events = n; }
+#ifdef _WIN32
+    event_loop_cleanup_iocp(loop);
+#else
+    event_loop_cleanup_epoll(loop);
+#endif
+    free(loop->watches); free(loop);
 }
 
 void event_loop_run(EventLoop *loop) {
@@ -30,9 +60,12 @@ void event_loop_run(EventLoop *loop) {
 }
 
 bool event_loop_run_once(EventLoop *loop) {
+    loop->dispatch_depth++;
     event_loop_process_events(loop, 10);
     event_loop_fire_timers(loop);
-    return loop->events != NULL || loop->running;
+    event_loop_process_io(loop);
+    loop->dispatch_depth--;
+    return loop->events != NULL || loop->pending_io != NULL || loop->watch_count > 0 || loop->running;
 }
 
 void event_loop_run_until(EventLoop *loop, bool (*condition)(void *), void *data) {
@@ -43,41 +76,342 @@ void event_loop_stop(EventLoop *loop) { loop->running = false; }
 
 bool event_loop_is_running(EventLoop *loop) { return loop->running; }
 
+bool event_loop_is_dispatching(EventLoop *loop) { return loop->dispatch_depth > 0; }
+
+bool event_loop_has_pending(EventLoop *loop) {
+    return loop->events != NULL || loop->pending_io != NULL || loop->io_inflight > 0 || loop->watch_count > 0;
+}
+
+/* Re-derive the epoll interest set for one fd from its pending I/O events */
+static void epoll_sync_fd(EventLoop *loop, int fd) {
+#ifdef EVENT_LOOP_HAVE_EPOLL
+    if (loop->epoll_fd < 0 || fd < 0) return;
+    uint32_t mask = 0;
+    for (Event *e = loop->events; e; e = e->next) {
+        if (e->fd != fd) continue;
+        if (e->type == EVENT_IO_READ) mask |= EPOLLIN | EPOLLRDHUP;
+        else if (e->type == EVENT_IO_WRITE) mask |= EPOLLOUT;
+    }
+    struct epoll_event ev; memset(&ev, 0, sizeof(ev)); ev.events = mask; ev.data.fd = fd;
+    if (!mask) { epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, &ev); return; }
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev) != 0 && errno == ENOENT) epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+#else
+    (void)loop; (void)fd;
+#endif
+}
+
 int event_loop_add_read(EventLoop *loop, int fd, EventCallback callback, void *data) {
-    (void)fd; Event *e = event_new(EVENT_IO_READ, callback, data); e->id = loop->next_event_id++; e->next = loop->events; loop->events = e; loop->event_count++; return e->id;
+    Event *e = event_new(EVENT_IO_READ, callback, data); e->id = loop->next_event_id++; e->fd = fd; e->next = loop->events; loop->events = e; loop->event_count++; epoll_sync_fd(loop, fd); return e->id;
 }
 
 int event_loop_add_write(EventLoop *loop, int fd, EventCallback callback, void *data) {
-    (void)fd; Event *e = event_new(EVENT_IO_WRITE, callback, data); e->id = loop->next_event_id++; e->next = loop->events; loop->events = e; loop->event_count++; return e->id;
+    Event *e = event_new(EVENT_IO_WRITE, callback, data); e->id = loop->next_event_id++; e->fd = fd; e->next = loop->events; loop->events = e; loop->event_count++; epoll_sync_fd(loop, fd); return e->id;
 }
 
 int event_loop_add_timer(EventLoop *loop, uint64_t timeout_ms, EventCallback callback, void *data) {
-    Event *e = event_new(EVENT_TIMER, callback, data); e->id = loop->next_event_id++; e->timeout_ms = timeout_ms; e->fire_time = now_ms() + timeout_ms; e->next = loop->events; loop->events = e; loop->event_count++; return e->id;
+    Event *e = event_new(EVENT_TIMER, callback, data); e->fd = -1; e->id = loop->next_event_id++; e->timeout_ms = timeout_ms; e->fire_time = now_ms() + timeout_ms; e->next = loop->events; loop->events = e; loop->event_count++; return e->id;
 }
 
 int event_loop_add_timer_recurring(EventLoop *loop, uint64_t interval_ms, EventCallback callback, void *data) {
-    Event *e = event_new(EVENT_TIMER, callback, data); e->id = loop->next_event_id++; e->timeout_ms = interval_ms; e->fire_time = now_ms() + interval_ms; e->recurring = true; e->next = loop->events; loop->events = e; loop->event_count++; return e->id;
+    Event *e = event_new(EVENT_TIMER, callback, data); e->fd = -1; e->id = loop->next_event_id++; e->timeout_ms = interval_ms; e->fire_time = now_ms() + interval_ms; e->recurring = true; e->next = loop->events; loop->events = e; loop->event_count++; return e->id;
 }
 
 int event_loop_add_event(EventLoop *loop, EventType type, EventCallback callback, void *data) {
-    Event *e = event_new(type, callback, data); e->id = loop->next_event_id++; e->next = loop->events; loop->events = e; loop->event_count++; return e->id;
+    Event *e = event_new(type, callback, data); e->fd = -1; e->id = loop->next_event_id++; e->next = loop->events; loop->events = e; loop->event_count++; return e->id;
 }
 
 bool event_loop_remove_event(EventLoop *loop, int event_id) {
-    Event *prev = NULL, *e = loop->events; while (e) { if (e->id == event_id) { if (prev) prev->next = e->next; else loop->events = e->next; free(e); loop->event_count--; return true; } prev = e; e = e->next; } return false;
+    Event *prev = NULL, *e = loop->events; while (e) { if (e->id == event_id) { int fd = e->fd; bool is_io = e->type == EVENT_IO_READ || e->type == EVENT_IO_WRITE; if (prev) prev->next = e->next; else loop->events = e->next; free(e); loop->event_count--; if (is_io) epoll_sync_fd(loop, fd); return true; } prev = e; e = e->next; } return false;
+}
+
+void event_loop_remove_fd_events(EventLoop *loop, int fd) {
+    Event *prev = NULL, *e = loop->events; bool removed = false;
+    while (e) {
+        if (e->fd == fd && (e->type == EVENT_IO_READ || e->type == EVENT_IO_WRITE)) { Event *n = e->next; if (prev) prev->next = n; else loop->events = n; free(e); loop->event_count--; e = n; removed = true; continue; }
+        prev = e; e = e->next;
+    }
+    if (removed) epoll_sync_fd(loop, fd);
+}
+
+bool event_loop_watch_fd(EventLoop *loop, int fd, uint32_t interest, FdWatchCallback callback, void *data) {
+#ifdef EVENT_LOOP_HAVE_EPOLL
+    if (loop->epoll_fd < 0 || fd < 0 || !callback) return false;
+    if ((size_t)fd >= loop->watch_capacity) {
+        size_t cap = loop->watch_capacity ? loop->watch_capacity : 64; while (cap <= (size_t)fd) cap *= 2;
+        FdWatch *w = (FdWatch *)realloc(loop->watches, cap * sizeof(FdWatch)); if (!w) return false;
+        memset(w + loop->watch_capacity, 0, (cap - loop->watch_capacity) * sizeof(FdWatch)); loop->watches = w; loop->watch_capacity = cap;
+    }
+    struct epoll_event ev; memset(&ev, 0, sizeof(ev)); ev.data.fd = fd; ev.events = EPOLLET | EPOLLRDHUP;
+    if (interest & EVENT_LOOP_READABLE) ev.events |= EPOLLIN;
+    if (interest & EVENT_LOOP_WRITABLE) ev.events |= EPOLLOUT;
+    bool existed = loop->watches[fd].callback != NULL;
+    if (epoll_ctl(loop->epoll_fd, existed ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) != 0) return false;
+    loop->watches[fd].callback = callback; loop->watches[fd].data = data; if (!existed) loop->watch_count++;
+    return true;
+#else
+    (void)loop; (void)fd; (void)interest; (void)callback; (void)data; return false;
+#endif
+}
+
+void event_loop_unwatch_fd(EventLoop *loop, int fd) {
+    if (fd < 0 || (size_t)fd >= loop->watch_capacity || !loop->watches[fd].callback) return;
+#ifdef EVENT_LOOP_HAVE_EPOLL
+    struct epoll_event ev; memset(&ev, 0, sizeof(ev)); epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+#endif
+    loop->watches[fd].callback = NULL; loop->watches[fd].data = NULL; loop->watch_count--;
+}
+
+/* ========== ASYNC I/O BACKEND ========== */
+
+/* Let fd readiness waits also wake on async I/O completions */
+static void io_watch_completions(EventLoop *loop) {
+#ifdef EVENT_LOOP_HAVE_EPOLL
+    int fd = loop->uring ? uring_fd(loop->uring) : loop->io_wake_fd[0];
+    if (loop->epoll_fd < 0 || fd < 0) return;
+    struct epoll_event ev; memset(&ev, 0, sizeof(ev)); ev.events = EPOLLIN; ev.data.fd = fd;
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+#else
+    (void)loop;
+#endif
+}
+
+static void io_backend_init(EventLoop *loop) {
+    if (loop->io_initialized) return;
+    loop->io_initialized = true;
+    loop->io_wake_fd[0] = loop->io_wake_fd[1] = -1;
+
+    loop->io_buffer_size = EVENT_LOOP_IO_BUFFER_SIZE;
+    loop->io_buffers = (char *)malloc(loop->io_buffer_size * EVENT_LOOP_IO_BUFFERS);
+    if (loop->io_buffers) {
+        loop->io_buffer_count = EVENT_LOOP_IO_BUFFERS;
+        loop->io_buffer_free = EVENT_LOOP_IO_BUFFERS >= 64 ? ~0ull : ((1ull << EVENT_LOOP_IO_BUFFERS) - 1);
+    }
+
+    loop->uring = uring_create(EVENT_LOOP_RING_ENTRIES);
+    if (loop->uring) {
+        /* Fixed buffers are an optimisation only; plain reads still work */
+        if (loop->io_buffers && !uring_register_buffers(loop->uring, loop->io_buffers, loop->io_buffer_size, loop->io_buffer_count))
+            loop->io_buffer_count = 0, loop->io_buffer_free = 0;
+        io_watch_completions(loop);
+        return;
+    }
+
+    /* Fallback: blocking syscalls on a small pool, completions posted back */
+    loop->io_pool = thread_pool_create(EVENT_LOOP_IO_THREADS);
+    loop->io_done_lock = mutex_create();
+#ifndef _WIN32
+    if (pipe(loop->io_wake_fd) == 0) {
+        fcntl(loop->io_wake_fd[0], F_SETFL, O_NONBLOCK);
+        fcntl(loop->io_wake_fd[1], F_SETFL, O_NONBLOCK);
+    }
+#endif
+    io_watch_completions(loop);
+}
+
+static void io_op_free(IOOperation *op) { if (!op) return; free(op->path); free(op->backend_data); free(op); }
+
+static void io_backend_shutdown(EventLoop *loop) {
+    if (!loop->io_initialized) return;
+    if (loop->io_pool) { thread_pool_destroy(loop->io_pool); loop->io_pool = NULL; }
+    if (loop->uring) { uring_free(loop->uring); loop->uring = NULL; }
+    while (loop->pending_io) { IOOperation *n = loop->pending_io->next; io_op_free(loop->pending_io); loop->pending_io = n; }
+    loop->io_done = NULL; loop->io_inflight = 0;
+    if (loop->io_done_lock) { mutex_destroy(loop->io_done_lock); loop->io_done_lock = NULL; }
+#ifndef _WIN32
+    if (loop->io_wake_fd[0] >= 0) { close(loop->io_wake_fd[0]); close(loop->io_wake_fd[1]); }
+#endif
+    free(loop->io_buffers); loop->io_buffers = NULL;
+    loop->io_initialized = false;
+}
+
+static int io_fixed_index(EventLoop *loop, const void *buffer, size_t size) {
+    if (!loop->uring || !loop->io_buffer_count || !buffer) return -1;
+    const char *p = (const char *)buffer;
+    if (p < loop->io_buffers || p >= loop->io_buffers + loop->io_buffer_size * loop->io_buffer_count) return -1;
+    size_t slot = (size_t)(p - loop->io_buffers) / loop->io_buffer_size;
+    if (p + size > loop->io_buffers + (slot + 1) * loop->io_buffer_size) return -1;
+    return (int)slot;
+}
+
+/* Blocking implementation used by the thread-pool fallback */
+static int io_perform_blocking(IOOperation *op) {
+    long r = -1;
+    switch (op->kind) {
+        case IO_OP_READ:
+        case IO_OP_WRITE: {
+            bool is_write = op->kind == IO_OP_WRITE;
+#ifdef _WIN32
+            if (op->file_offset >= 0) _lseeki64(op->fd, op->file_offset, SEEK_SET);
+            r = is_write ? _write(op->fd, op->buffer, (unsigned)op->size) : _read(op->fd, op->buffer, (unsigned)op->size);
+#else
+            if (op->file_offset >= 0) r = is_write ? pwrite(op->fd, op->buffer, op->size, (off_t)op->file_offset) : pread(op->fd, op->buffer, op->size, (off_t)op->file_offset);
+            else r = is_write ? write(op->fd, op->buffer, op->size) : read(op->fd, op->buffer, op->size);
+#endif
+            break;
+        }
+        case IO_OP_OPEN:
+            r = open(op->path, op->flags, op->mode);
+            break;
+        case IO_OP_STAT: {
+            struct stat st;
+            r = stat(op->path, &st);
+            if (r == 0) { op->stat.size = (uint64_t)st.st_size; op->stat.mode = (uint32_t)st.st_mode; op->stat.mtime = (int64_t)st.st_mtime; }
+            break;
+        }
+        case IO_OP_FSYNC:
+#ifdef _WIN32
+            r = _commit(op->fd);
+#else
+            r = fsync(op->fd);
+#endif
+            break;
+    }
+    return r < 0 ? -errno : (int)r;
+}
+
+static void *io_pool_worker(void *arg) {
+    IOOperation *op = (IOOperation *)arg;
+    EventLoop *loop = op->loop;
+    op->result = io_perform_blocking(op);
+    mutex_lock(loop->io_done_lock);
+    op->done_next = loop->io_done; loop->io_done = op;
+    mutex_unlock(loop->io_done_lock);
+#ifndef _WIN32
+    if (loop->io_wake_fd[1] >= 0) { char c = 1; ssize_t w = write(loop->io_wake_fd[1], &c, 1); (void)w; }
+#endif
+    return NULL;
+}
+
+static void io_complete(EventLoop *loop, IOOperation *op, int result) {
+    IOOperation **pp = &loop->pending_io; while (*pp && *pp != op) pp = &(*pp)->next; if (*pp) *pp = op->next;
+    op->next = NULL; loop->io_inflight--;
+    op->result = result; op->completed = true;
+    if (op->kind == IO_OP_STAT && result == 0 && op->backend_data) uring_statx_decode(op->backend_data, &op->stat.size, &op->stat.mode, &op->stat.mtime);
+    if (op->cancelled) { io_op_free(op); return; }
+    if (op->on_complete) op->on_complete(op->context);
+}
+
+static bool io_prep_uring(EventLoop *loop, IOOperation *op) {
+    UringQueue *q = loop->uring; uint64_t ud = (uint64_t)(uintptr_t)op;
+    switch (op->kind) {
+        case IO_OP_READ: return uring_prep_read(q, op->fd, op->buffer, (unsigned)op->size, op->file_offset, op->buf_index, ud);
+        case IO_OP_WRITE: return uring_prep_write(q, op->fd, op->buffer, (unsigned)op->size, op->file_offset, op->buf_index, ud);
+        case IO_OP_OPEN: return uring_prep_openat(q, op->path, op->flags, op->mode, ud);
+        case IO_OP_STAT: return uring_prep_statx(q, op->path, op->backend_data, ud);
+        case IO_OP_FSYNC: return uring_prep_fsync(q, op->fd, ud);
+    }
+    return false;
+}
+
+/* Queue an op. Under io_uring SQEs are only batched here and submitted in
+ * one io_uring_enter() per loop iteration (or when the SQ fills up). */
+static IOOperation *io_submit(EventLoop *loop, IOOperation *op) {
+    io_backend_init(loop);
+    op->loop = loop; op->next = loop->pending_io; loop->pending_io = op; loop->io_inflight++;
+    if (loop->uring) {
+        if (op->kind == IO_OP_STAT) op->backend_data = calloc(1, URING_STATX_SIZE);
+        if (!io_prep_uring(loop, op)) { uring_submit(loop->uring, 0); if (!io_prep_uring(loop, op)) io_complete(loop, op, -EAGAIN); }
+    } else if (!loop->io_pool || !thread_pool_submit(loop->io_pool, io_pool_worker, op)) {
+        /* No pool either: degrade to a synchronous call */
+        io_complete(loop, op, io_perform_blocking(op));
+    }
+    return op;
 }
 
-void event_loop_remove_fd_events(EventLoop *loop, int fd) { (void)loop; (void)fd; }
+static IOOperation *io_op_new(IOOpKind kind, EventCallback on_complete, void *context) {
+    IOOperation *op = (IOOperation *)calloc(1, sizeof(IOOperation)); if (!op) return NULL;
+    op->kind = kind; op->fd = -1; op->file_offset = -1; op->buf_index = -1; op->on_complete = on_complete; op->context = context; return op;
+}
+
+IOOperation *event_loop_async_read_at(EventLoop *loop, int fd, void *buffer, size_t size, int64_t offset, EventCallback on_complete, void *context) {
+    IOOperation *op = io_op_new(IO_OP_READ, on_complete, context); if (!op) return NULL;
+    op->fd = fd; op->buffer = buffer; op->size = size; op->file_offset = offset;
+    io_backend_init(loop); op->buf_index = io_fixed_index(loop, buffer, size);
+    return io_submit(loop, op);
+}
+
+IOOperation *event_loop_async_write_at(EventLoop *loop, int fd, const void *buffer, size_t size, int64_t offset, EventCallback on_complete, void *context) {
+    IOOperation *op = io_op_new(IO_OP_WRITE, on_complete, context); if (!op) return NULL;
+    op->fd = fd; op->buffer = (void *)buffer; op->size = size; op->file_offset = offset;
+    io_backend_init(loop); op->buf_index = io_fixed_index(loop, buffer, size);
+    return io_submit(loop, op);
+}
 
 IOOperation *event_loop_async_read(EventLoop *loop, int fd, void *buffer, size_t size, EventCallback on_complete, void *context) {
-    (void)fd; (void)size; IOOperation *op = (IOOperation *)calloc(1, sizeof(IOOperation)); op->buffer = buffer; op->on_complete = on_complete; op->context = context; op->completed = true; if (on_complete) on_complete(context); return op;
+    return event_loop_async_read_at(loop, fd, buffer, size, -1, on_complete, context);
 }
 
 IOOperation *event_loop_async_write(EventLoop *loop, int fd, const void *buffer, size_t size, EventCallback on_complete, void *context) {
-    (void)fd; (void)buffer; (void)size; IOOperation *op = (IOOperation *)calloc(1, sizeof(IOOperation)); op->on_complete = on_complete; op->context = context; op->completed = true; if (on_complete) on_complete(context); return op;
+    return event_loop_async_write_at(loop, fd, buffer, size, -1, on_complete, context);
+}
+
+IOOperation *event_loop_async_open(EventLoop *loop, const char *path, int flags, int mode, EventCallback on_complete, void *context) {
+    IOOperation *op = io_op_new(IO_OP_OPEN, on_complete, context); if (!op) return NULL;
+    op->path = strdup(path); op->flags = flags; op->mode = mode; return io_submit(loop, op);
+}
+
+IOOperation *event_loop_async_stat(EventLoop *loop, const char *path, EventCallback on_complete, void *context) {
+    IOOperation *op = io_op_new(IO_OP_STAT, on_complete, context); if (!op) return NULL;
+    op->path = strdup(path); return io_submit(loop, op);
+}
+
+IOOperation *event_loop_async_fsync(EventLoop *loop, int fd, EventCallback on_complete, void *context) {
+    IOOperation *op = io_op_new(IO_OP_FSYNC, on_complete, context); if (!op) return NULL;
+    op->fd = fd; return io_submit(loop, op);
 }
 
-bool event_loop_cancel_io(EventLoop *loop, IOOperation *op) { (void)loop; if (!op) return false; free(op); return true; }
+bool event_loop_cancel_io(EventLoop *loop, IOOperation *op) {
+    if (!op) return false;
+    if (op->completed) { io_op_free(op); return true; }
+    /* The backend still owns the op; it is freed when its completion drains */
+    op->cancelled = true;
+    if (loop && loop->uring) uring_prep_cancel(loop->uring, (uint64_t)(uintptr_t)op, 0);
+    return true;
+}
+
+void event_loop_io_release(IOOperation *op) { if (op && op->completed) io_op_free(op); }
+
+void *event_loop_io_buffer_acquire(EventLoop *loop) {
+    io_backend_init(loop);
+    if (!loop->io_buffer_free) return NULL;
+    int slot = __builtin_ctzll(loop->io_buffer_free); loop->io_buffer_free &= ~(1ull << slot);
+    return loop->io_buffers + (size_t)slot * loop->io_buffer_size;
+}
+
+void event_loop_io_buffer_release(EventLoop *loop, void *buffer) {
+    if (!buffer || !loop->io_buffers) return;
+    size_t slot = (size_t)((char *)buffer - loop->io_buffers) / loop->io_buffer_size;
+    if (slot < loop->io_buffer_count) loop->io_buffer_free |= 1ull << slot;
+}
+
+size_t event_loop_io_pending(EventLoop *loop) { return loop->io_inflight; }
+
+const char *event_loop_io_backend(EventLoop *loop) { io_backend_init(loop); return loop->uring ? "io_uring" : "threadpool"; }
+
+static size_t io_drain(EventLoop *loop) {
+    size_t drained = 0;
+    if (loop->uring) {
+        uint64_t ud; int32_t res;
+        while (uring_next_completion(loop->uring, &ud, &res)) { if (ud) { io_complete(loop, (IOOperation *)(uintptr_t)ud, res); drained++; } }
+    } else if (loop->io_done_lock) {
+#ifndef _WIN32
+        char sink[64]; while (loop->io_wake_fd[0] >= 0 && read(loop->io_wake_fd[0], sink, sizeof(sink)) > 0) {}
+#endif
+        mutex_lock(loop->io_done_lock); IOOperation *done = loop->io_done; loop->io_done = NULL; mutex_unlock(loop->io_done_lock);
+        while (done) { IOOperation *n = done->done_next; io_complete(loop, done, done->result); done = n; drained++; }
+    }
+    return drained;
+}
+
+/* Block for I/O readiness, but only when nothing else is scheduled */
+static void io_wait(EventLoop *loop, uint64_t timeout_ms) {
+#ifdef _WIN32
+    (void)loop; Sleep((DWORD)(timeout_ms > 1 ? 1 : timeout_ms));
+#else
+    struct pollfd pfd; pfd.fd = loop->uring ? uring_fd(loop->uring) : loop->io_wake_fd[0]; pfd.events = POLLIN; pfd.revents = 0;
+    if (pfd.fd >= 0) poll(&pfd, 1, (int)timeout_ms);
+#endif
+}
 
 int event_loop_call_soon(EventLoop *loop, EventCallback callback, void *data) { return event_loop_add_event(loop, EVENT_CUSTOM, callback, data); }
 int event_loop_call_later(EventLoop *loop, uint64_t delay_ms, EventCallback callback, void *data) { return event_loop_add_timer(loop, delay_ms, callback, data); }
@@ -94,33 +428,94 @@ void event_loop_print_stats(EventLoop *loop) { printf("events=%zu iterations=%ll
 void event_loop_run_async_task(EventLoop *loop, void *task) { (void)loop; (void)task; }
 void event_loop_schedule_coro(EventLoop *loop, void *coro) { (void)loop; (void)coro; }
 
+/* Wait up to `wait_ms` for fd readiness and flag the matching I/O events */
+static void poll_fds(EventLoop *loop, uint64_t wait_ms) {
+#ifdef EVENT_LOOP_HAVE_EPOLL
+    if (loop->epoll_fd < 0) return;
+    struct epoll_event ready[EVENT_LOOP_MAX_READY];
+    int n = epoll_wait(loop->epoll_fd, ready, EVENT_LOOP_MAX_READY, (int)wait_ms);
+    for (int i = 0; i < n; i++) {
+        uint32_t rev = ready[i].events; int fd = ready[i].data.fd;
+        bool readable = (rev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0;
+        bool writable = (rev & (EPOLLOUT | EPOLLHUP | EPOLLERR)) != 0;
+        if ((size_t)fd < loop->watch_capacity && loop->watches[fd].callback) {
+            loop->watches[fd].callback(loop->watches[fd].data, fd, (readable ? EVENT_LOOP_READABLE : 0) | (writable ? EVENT_LOOP_WRITABLE : 0));
+            continue;
+        }
+        for (Event *e = loop->events; e; e = e->next) {
+            if (e->fd != fd) continue;
+            if ((e->type == EVENT_IO_READ && readable) || (e->type == EVENT_IO_WRITE && writable)) e->ready = true;
+        }
+    }
+#else
+    (void)loop; (void)wait_ms;
+#endif
+}
+
 void event_loop_process_events(EventLoop *loop, uint64_t timeout_ms) {
-    (void)timeout_ms; loop->iteration_count++;
-    /* Process custom and I/O events immediately */
-    Event *prev = NULL, *e = loop->events;
+    loop->iteration_count++;
     uint64_t now = now_ms();
+
+    /* Block in the poller only until the next timer or pending custom event */
+    uint64_t wait = timeout_ms;
+    for (Event *e = loop->events; e; e = e->next) {
+        if (e->type == EVENT_CUSTOM) wait = 0;
+        else if (e->type == EVENT_TIMER) { uint64_t d = e->fire_time > now ? e->fire_time - now : 0; if (d < wait) wait = d; }
+    }
+    if (loop->epoll_fd >= 0 && (loop->events || loop->io_inflight || loop->watch_count)) { poll_fds(loop, wait); now = now_ms(); }
+
+    /* Unlink one-shot events that are due before running any callback, so
+     * callbacks are free to add or remove events */
+    Event *fired = NULL, **fired_tail = &fired, *prev = NULL, *e = loop->events;
+    bool recurring_due = false;
     while (e) {
-        bool fired = false;
-        if (e->type == EVENT_TIMER) {
-            if (now >= e->fire_time) { fired = true; }
-        } else if (e->type == EVENT_CUSTOM || e->type == EVENT_IO_READ || e->type == EVENT_IO_WRITE) {
-            fired = true;
+        bool due = false;
+        if (e->type == EVENT_TIMER) due = now >= e->fire_time;
+        else if (e->type == EVENT_CUSTOM) due = true;
+        else if (e->type == EVENT_IO_READ || e->type == EVENT_IO_WRITE) due = loop->epoll_fd < 0 || e->ready;
+        if (due && !e->recurring) {
+            Event *n = e->next; if (prev) prev->next = n; else loop->events = n; loop->event_count--;
+            e->next = NULL; *fired_tail = e; fired_tail = &e->next; e = n; continue;
         }
-        if (fired && e->callback) e->callback(e->data);
-        if (fired && !e->recurring) {
-            Event *to_free = e; e = e->next; if (prev) prev->next = e; else loop->events = e; free(to_free); loop->event_count--; continue;
-        }
-        if (fired && e->recurring) { e->fire_time = now + e->timeout_ms; }
+        if (due) { e->ready = true; e->fire_time = now + e->timeout_ms; recurring_due = true; }
         prev = e; e = e->next;
     }
+
+    while (fired) {
+        Event *n = fired->next; bool is_io = fired->type == EVENT_IO_READ || fired->type == EVENT_IO_WRITE; int fd = fired->fd;
+        if (is_io) epoll_sync_fd(loop, fd);
+        if (fired->callback) fired->callback(fired->data);
+        free(fired); fired = n;
+    }
+
+    /* Recurring events stay linked; rescan after each callback in case it
+     * changed the list */
+    while (recurring_due) {
+        recurring_due = false;
+        for (e = loop->events; e; e = e->next) {
+            if (e->recurring && e->ready) { e->ready = false; if (e->callback) e->callback(e->data); recurring_due = true; break; }
+        }
+    }
 }
 
 void event_loop_fire_timers(EventLoop *loop) { (void)loop; }
 
+void event_loop_process_io(EventLoop *loop) {
+    if (!loop->io_initialized || !loop->io_inflight) return;
+    if (loop->uring) uring_submit(loop->uring, 0);
+    if (io_drain(loop) == 0 && loop->events == NULL) { io_wait(loop, 10); io_drain(loop); }
+}
+
 #ifdef _WIN32
 bool event_loop_init_iocp(EventLoop *loop) { (void)loop; return true; }
 void event_loop_cleanup_iocp(EventLoop *loop) { (void)loop; }
 #else
-bool event_loop_init_epoll(EventLoop *loop) { (void)loop; return true; }
-void event_loop_cleanup_epoll(EventLoop *loop) { (void)loop; }
+bool event_loop_init_epoll(EventLoop *loop) {
+#ifdef EVENT_LOOP_HAVE_EPOLL
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC); return loop->epoll_fd >= 0;
+#else
+    loop->epoll_fd = -1; return false;
+#endif
+}
+void event_loop_cleanup_epoll(EventLoop *loop) { if (loop->epoll_fd >= 0) close(loop->epoll_fd); loop->epoll_fd = -1; }
 #endif
@@ -4,6 +4,13 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include "threading.h"
+
+/* Async I/O tuning */
+#define EVENT_LOOP_RING_ENTRIES 256
+#define EVENT_LOOP_IO_BUFFERS 16            /* At most 64 (one bitmask) */
+#define EVENT_LOOP_IO_BUFFER_SIZE (64 * 1024)
+#define EVENT_LOOP_IO_THREADS 4
 
 /* Event types */
 typedef enum {
@@ -18,6 +25,18 @@ typedef enum {
 /* Event callback */
 typedef void (*EventCallback)(void *data);
 
+/* Readiness bits passed to fd watchers */
+#define EVENT_LOOP_READABLE 0x01
+#define EVENT_LOOP_WRITABLE 0x02
+
+/* Persistent fd watcher callback; `ready` is a mask of EVENT_LOOP_* bits */
+typedef void (*FdWatchCallback)(void *data, int fd, uint32_t ready);
+
+typedef struct FdWatch {
+    FdWatchCallback callback;
+    void *data;
+} FdWatch;
+
 /* Event structure */
 typedef struct Event {
     int id;
@@ -29,20 +48,48 @@ typedef struct Event {
     void *data;
     bool recurring;             /* For repeating timers */
     bool active;
+    bool ready;                 /* fd reported ready / recurring timer due */
     struct Event *next;
 } Event;
 
+/* Async I/O operation kinds */
+typedef enum {
+    IO_OP_READ,
+    IO_OP_WRITE,
+    IO_OP_OPEN,
+    IO_OP_STAT,
+    IO_OP_FSYNC
+} IOOpKind;
+
+/* Result of an async stat */
+typedef struct IOStat {
+    uint64_t size;
+    uint32_t mode;
+    int64_t mtime;
+} IOStat;
+
 /* I/O operation */
 typedef struct IOOperation {
+    IOOpKind kind;
     int fd;
     void *buffer;
     size_t size;
     size_t offset;
+    int64_t file_offset;        /* Position for read/write, -1 = current */
+    int buf_index;              /* Registered buffer slot, -1 if none */
+    char *path;                 /* Open/stat target */
+    int flags;
+    int mode;
+    IOStat stat;                /* Filled in by async stat */
+    void *backend_data;         /* Backend scratch (statx buffer) */
     bool completed;
-    int result;
+    bool cancelled;
+    int result;                 /* Bytes / fd / 0 on success, -errno on failure */
     EventCallback on_complete;
     void *context;
+    struct EventLoop *loop;
     struct IOOperation *next;
+    struct IOOperation *done_next;  /* Thread-pool completion list */
 } IOOperation;
 
 /* Event loop */
@@ -51,6 +98,7 @@ typedef struct EventLoop {
     int next_event_id;
     size_t event_count;
     bool running;
+    int dispatch_depth;         /* event_loop_run_once calls on the stack */
     uint64_t iteration_count;
     IOOperation *pending_io;
     
@@ -64,6 +112,26 @@ typedef struct EventLoop {
     /* Timing */
     uint64_t last_tick_time;
     uint64_t next_timer_fire;
+    
+    /* Async I/O backend: io_uring when available, else thread-pool offload */
+    struct UringQueue *uring;
+    struct ThreadPool *io_pool;
+    Mutex *io_done_lock;
+    IOOperation *io_done;       /* Completed by pool workers, not yet dispatched */
+    int io_wake_fd[2];          /* Pool workers poke this pipe on completion */
+    size_t io_inflight;
+    bool io_initialized;
+    
+    /* Registered I/O buffers (fixed buffers under io_uring) */
+    char *io_buffers;
+    size_t io_buffer_size;
+    unsigned io_buffer_count;
+    uint64_t io_buffer_free;    /* Bitmask of free slots */
+    
+    /* Persistent edge-triggered watchers, indexed by fd */
+    FdWatch *watches;
+    size_t watch_capacity;
+    size_t watch_count;
 } EventLoop;
 
 /* ========== EVENT LOOP LIFECYCLE ========== */
@@ -89,6 +157,14 @@ void event_loop_stop(EventLoop *loop);
 /* Check if running */
 bool event_loop_is_running(EventLoop *loop);
 
+/* Whether the caller is inside one of the loop's callbacks, where running
+ * the loop again would dispatch events re-entrantly */
+bool event_loop_is_dispatching(EventLoop *loop);
+
+/* Whether events, fd watches or I/O are registered: something a blocking
+ * wait should keep servicing */
+bool event_loop_has_pending(EventLoop *loop);
+
 /* ========== EVENT MANAGEMENT ========== */
 
 /* Add I/O read event */
@@ -113,6 +189,15 @@ bool event_loop_remove_event(EventLoop *loop, int event_id);
 /* Remove all events for fd */
 void event_loop_remove_fd_events(EventLoop *loop, int fd);
 
+/* Watch an fd until unwatched (edge-triggered: the callback must drain the
+ * fd until EAGAIN). Cheaper than re-adding one-shot events for long-lived
+ * sockets. Do not mix with add_read/add_write on the same fd. Returns
+ * false where there is no readiness backend (non-Linux). */
+bool event_loop_watch_fd(EventLoop *loop, int fd, uint32_t interest, FdWatchCallback callback, void *data);
+
+/* Stop watching an fd (call before closing it) */
+void event_loop_unwatch_fd(EventLoop *loop, int fd);
+
 /* ========== ASYNC I/O ========== */
 
 /* Schedule async read */
@@ -123,9 +208,41 @@ IOOperation *event_loop_async_read(EventLoop *loop, int fd, void *buffer, size_t
 IOOperation *event_loop_async_write(EventLoop *loop, int fd, const void *buffer, size_t size,
                                     EventCallback on_complete, void *context);
 
-/* Cancel I/O operation */
+/* Schedule async read/write at an explicit file offset (-1 = current position) */
+IOOperation *event_loop_async_read_at(EventLoop *loop, int fd, void *buffer, size_t size,
+                                      int64_t offset, EventCallback on_complete, void *context);
+IOOperation *event_loop_async_write_at(EventLoop *loop, int fd, const void *buffer, size_t size,
+                                       int64_t offset, EventCallback on_complete, void *context);
+
+/* Schedule async open; op->result is the new fd */
+IOOperation *event_loop_async_open(EventLoop *loop, const char *path, int flags, int mode,
+                                   EventCallback on_complete, void *context);
+
+/* Schedule async stat; fills op->stat */
+IOOperation *event_loop_async_stat(EventLoop *loop, const char *path,
+                                   EventCallback on_complete, void *context);
+
+/* Schedule async fsync */
+IOOperation *event_loop_async_fsync(EventLoop *loop, int fd,
+                                    EventCallback on_complete, void *context);
+
+/* Cancel I/O operation (frees it once the backend lets go of it) */
 bool event_loop_cancel_io(EventLoop *loop, IOOperation *op);
 
+/* Free a completed I/O operation */
+void event_loop_io_release(IOOperation *op);
+
+/* Borrow a registered I/O buffer (EVENT_LOOP_IO_BUFFER_SIZE bytes); reads
+ * and writes into it use fixed-buffer submissions. NULL if none free. */
+void *event_loop_io_buffer_acquire(EventLoop *loop);
+void event_loop_io_buffer_release(EventLoop *loop, void *buffer);
+
+/* Number of I/O operations still in flight */
+size_t event_loop_io_pending(EventLoop *loop);
+
+/* Name of the active I/O backend ("io_uring" or "threadpool") */
+const char *event_loop_io_backend(EventLoop *loop);
+
 /* ========== DEFERRED EXECUTION ========== */
 
 /* Call soon (next iteration) */
@@ -0,0 +1,808 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L     /* mkstemp(), fdopen() under -std=c11 */
+#endif
+
+#include "external_sort.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define IO_BLOCK_MIN    ((size_t)64 << 10)
+#define IO_BLOCK_MAX    ((size_t)4 << 20)
+#define WRITE_BUFFER    ((size_t)1 << 20)
+
+typedef struct ExtSort {
+    ThreadPool *pool;
+    Mutex *lock;                /* guards Job.busy */
+    CondVar *job_done;
+    const ExtSortOptions *options;
+    bool keyed;
+} ExtSort;
+
+/* ========== BACKGROUND JOBS ========== */
+
+/* One outstanding piece of work on the pool. Without a pool (or if the
+ * submit fails) the work runs inline, so callers never need a fallback. */
+typedef struct {
+    ExtSort *sort;
+    bool busy;
+    void (*fn)(void *);
+    void *arg;
+} Job;
+
+static void *job_main(void *p) {
+    Job *job = p;
+    job->fn(job->arg);
+    mutex_lock(job->sort->lock);
+    job->busy = false;
+    condvar_broadcast(job->sort->job_done);
+    mutex_unlock(job->sort->lock);
+    return NULL;
+}
+
+static void job_start(Job *job, void (*fn)(void *), void *arg) {
+    job->fn = fn;
+    job->arg = arg;
+    job->busy = true;
+    if (!job->sort->pool || !thread_pool_submit(job->sort->pool, job_main, job)) {
+        fn(arg);
+        job->busy = false;
+    }
+}
+
+static void job_wait(Job *job) {
+    mutex_lock(job->sort->lock);
+    while (job->busy) condvar_wait(job->sort->job_done, job->sort->lock);
+    mutex_unlock(job->sort->lock);
+}
+
+/* ========== TEMP FILES ========== */
+
+/* Anonymous read/write file: unlinked right away, so it is reclaimed when
+ * closed even if the process dies mid-sort */
+static FILE *temp_file(const char *dir) {
+#ifdef _WIN32
+    (void)dir;
+    return tmpfile();
+#else
+    if (!dir || !*dir) dir = getenv("TMPDIR");
+    if (!dir || !*dir) dir = "/tmp";
+    size_t size = strlen(dir) + sizeof("/rubolt-sort-XXXXXX");
+    char *path = malloc(size);
+    if (!path) return NULL;
+    snprintf(path, size, "%s/rubolt-sort-XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd >= 0) unlink(path);
+    free(path);
+    if (fd < 0) return NULL;
+    FILE *file = fdopen(fd, "w+b");
+    if (!file) close(fd);
+    return file;
+#endif
+}
+
+/* ========== ENCODING ========== */
+
+/* Records are a tag byte and a payload: zigzag varint for ints, the 8 raw
+ * bytes of a double, varint length + bytes for strings, nothing for null
+ * and booleans. Keyed sorts store the key record before the value. */
+enum {
+    TAG_NULL, TAG_INT, TAG_FLOAT, TAG_STRING, TAG_FALSE, TAG_TRUE,
+    TAG_NO_STRING       /* RB_VAL_STRING with a NULL pointer */
+};
+
+/* Buffered writer. The async flavour double-buffers and hands full buffers
+ * to the pool, so encoding continues while the previous buffer is written;
+ * writers already running on a pool thread stay synchronous. */
+typedef struct {
+    ExtSort *sort;
+    FILE *file;
+    char *buf[2];
+    size_t len;
+    int current;
+    size_t flush_len;
+    int flush_index;
+    bool async;
+    bool failed;
+    uint64_t written;
+    Job flush;
+} Writer;
+
+static void writer_flush_job(void *arg) {
+    Writer *w = arg;
+    if (fwrite(w->buf[w->flush_index], 1, w->flush_len, w->file) != w->flush_len) w->failed = true;
+}
+
+static bool writer_init(Writer *w, ExtSort *sort, FILE *file, bool async) {
+    memset(w, 0, sizeof(*w));
+    w->sort = sort;
+    w->file = file;
+    w->async = async;
+    w->flush.sort = sort;
+    w->buf[0] = malloc(WRITE_BUFFER);
+    w->buf[1] = async ? malloc(WRITE_BUFFER) : NULL;
+    if (!w->buf[0] || (async && !w->buf[1])) {
+        free(w->buf[0]);
+        free(w->buf[1]);
+        return false;
+    }
+    return true;
+}
+
+static void writer_flush(Writer *w) {
+    if (w->len == 0) return;
+    if (w->async) {
+        job_wait(&w->flush);
+        w->flush_index = w->current;
+        w->flush_len = w->len;
+        w->current ^= 1;
+        job_start(&w->flush, writer_flush_job, w);
+    } else if (fwrite(w->buf[0], 1, w->len, w->file) != w->len) {
+        w->failed = true;
+    }
+    w->written += w->len;
+    w->len = 0;
+}
+
+/* Flush everything and release the buffers; false if any write failed */
+static bool writer_finish(Writer *w) {
+    writer_flush(w);
+    if (w->async) job_wait(&w->flush);
+    if (fflush(w->file) != 0) w->failed = true;
+    free(w->buf[0]);
+    free(w->buf[1]);
+    w->buf[0] = w->buf[1] = NULL;
+    return !w->failed;
+}
+
+static inline void writer_bytes(Writer *w, const void *data, size_t n) {
+    const char *p = data;
+    while (n > 0) {
+        if (w->len == WRITE_BUFFER) writer_flush(w);
+        size_t chunk = WRITE_BUFFER - w->len;
+        if (chunk > n) chunk = n;
+        memcpy(w->buf[w->current] + w->len, p, chunk);
+        w->len += chunk;
+        p += chunk;
+        n -= chunk;
+    }
+}
+
+static inline void writer_varint(Writer *w, uint64_t v) {
+    unsigned char tmp[10];
+    size_t n = 0;
+    while (v >= 0x80) {
+        tmp[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    tmp[n++] = (unsigned char)v;
+    writer_bytes(w, tmp, n);
+}
+
+static bool write_value(Writer *w, RbValue v) {
+    unsigned char tag;
+    switch (v.type) {
+    case RB_VAL_NULL:   tag = TAG_NULL; break;
+    case RB_VAL_INT:    tag = TAG_INT; break;
+    case RB_VAL_FLOAT:  tag = TAG_FLOAT; break;
+    case RB_VAL_STRING: tag = v.data.s ? TAG_STRING : TAG_NO_STRING; break;
+    case RB_VAL_BOOL:   tag = v.data.b ? TAG_TRUE : TAG_FALSE; break;
+    default:            return false;
+    }
+    writer_bytes(w, &tag, 1);
+    if (tag == TAG_INT) {
+        uint64_t u = (uint64_t)v.data.i;
+        writer_varint(w, (u << 1) ^ (0 - (u >> 63)));
+    } else if (tag == TAG_FLOAT) {
+        writer_bytes(w, &v.data.f, sizeof(double));
+    } else if (tag == TAG_STRING) {
+        size_t len = strlen(v.data.s);
+        writer_varint(w, len);
+        writer_bytes(w, v.data.s, len);
+    }
+    return true;
+}
+
+/* ========== RUN READERS ========== */
+
+/* Sequential reader over one spilled run. Two blocks: the merge consumes
+ * one while a pool job reads the next into the other. */
+typedef struct {
+    FILE *file;
+    char *block[2];
+    size_t fill[2];
+    size_t block_size;
+    int current;
+    size_t pos;
+    bool eof;               /* no more blocks to load */
+    bool failed;
+    Job prefetch;
+} RunReader;
+
+static void reader_load_job(void *arg) {
+    RunReader *r = arg;
+    int target = r->current ^ 1;
+    r->fill[target] = fread(r->block[target], 1, r->block_size, r->file);
+    if (r->fill[target] < r->block_size) {
+        r->eof = true;
+        if (ferror(r->file)) r->failed = true;
+    }
+}
+
+static bool reader_open(RunReader *r, ExtSort *sort, FILE *file, size_t block_size) {
+    memset(r, 0, sizeof(*r));
+    r->file = file;
+    r->block_size = block_size;
+    r->prefetch.sort = sort;
+    r->block[0] = malloc(block_size);
+    r->block[1] = malloc(block_size);
+    if (!r->block[0] || !r->block[1]) return false;
+    rewind(file);
+    r->current = 1;     /* empty; the first read swaps to block 0 */
+    job_start(&r->prefetch, reader_load_job, r);
+    return true;
+}
+
+static void reader_close(RunReader *r) {
+    job_wait(&r->prefetch);
+    free(r->block[0]);
+    free(r->block[1]);
+    r->block[0] = r->block[1] = NULL;
+}
+
+/* Move to the prefetched block and start loading the one after it */
+static bool reader_next_block(RunReader *r) {
+    job_wait(&r->prefetch);
+    if (r->failed) return false;
+    r->current ^= 1;
+    r->pos = 0;
+    if (r->fill[r->current] == 0) return false;
+    if (!r->eof) job_start(&r->prefetch, reader_load_job, r);
+    else r->fill[r->current ^ 1] = 0;
+    return true;
+}
+
+static bool reader_bytes(RunReader *r, void *dst, size_t n) {
+    char *out = dst;
+    while (n > 0) {
+        if (r->pos == r->fill[r->current] && !reader_next_block(r)) return false;
+        size_t chunk = r->fill[r->current] - r->pos;
+        if (chunk > n) chunk = n;
+        memcpy(out, r->block[r->current] + r->pos, chunk);
+        r->pos += chunk;
+        out += chunk;
+        n -= chunk;
+    }
+    return true;
+}
+
+static inline bool reader_byte(RunReader *r, unsigned char *b) {
+    if (r->pos < r->fill[r->current]) {
+        *b = (unsigned char)r->block[r->current][r->pos++];
+        return true;
+    }
+    return reader_bytes(r, b, 1);
+}
+
+static bool reader_varint(RunReader *r, uint64_t *out) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        unsigned char b;
+        if (!reader_byte(r, &b)) return false;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Decode one record. Returns false at the end of the run; a truncated or
+ * corrupt record also sets r->failed */
+static bool read_value(RunReader *r, RbValue *out) {
+    unsigned char tag;
+    if (!reader_byte(r, &tag)) return false;
+    uint64_t u;
+    switch (tag) {
+    case TAG_NULL:
+        out->type = RB_VAL_NULL;
+        out->data.i = 0;
+        return true;
+    case TAG_FALSE:
+    case TAG_TRUE:
+        out->type = RB_VAL_BOOL;
+        out->data.b = tag == TAG_TRUE;
+        return true;
+    case TAG_NO_STRING:
+        out->type = RB_VAL_STRING;
+        out->data.s = NULL;
+        return true;
+    case TAG_INT:
+        if (!reader_varint(r, &u)) break;
+        out->type = RB_VAL_INT;
+        out->data.i = (int64_t)((u >> 1) ^ (0 - (u & 1)));
+        return true;
+    case TAG_FLOAT:
+        if (!reader_bytes(r, &out->data.f, sizeof(double))) break;
+        out->type = RB_VAL_FLOAT;
+        return true;
+    case TAG_STRING: {
+        if (!reader_varint(r, &u) || u >= SIZE_MAX) break;
+        char *s = malloc((size_t)u + 1);
+        if (!s) break;
+        if (!reader_bytes(r, s, (size_t)u)) {
+            free(s);
+            break;
+        }
+        s[u] = '\0';
+        out->type = RB_VAL_STRING;
+        out->data.s = s;
+        return true;
+    }
+    default:
+        break;
+    }
+    r->failed = true;
+    return false;
+}
+
+/* ========== RUN GENERATION ========== */
+
+typedef struct {
+    ExtSort *sort;
+    RbValue *items;
+    RbValue *keys;          /* parallel to items when keyed */
+    size_t count;
+    size_t capacity;
+    size_t bytes;           /* estimated memory held */
+    FILE *file;             /* spilled run, set by the job */
+    bool ok;
+    uint64_t written;
+    Job job;
+} RunBuffer;
+
+/* Rough heap footprint of a buffered value */
+static inline size_t value_cost(RbValue v) {
+    size_t cost = sizeof(RbValue);
+    if (v.type == RB_VAL_STRING && v.data.s) cost += strlen(v.data.s) + 1 + 2 * sizeof(void *);
+    return cost;
+}
+
+static bool buffer_push(RunBuffer *b, RbValue value, RbValue key) {
+    if (b->count == b->capacity) {
+        size_t capacity = b->capacity ? b->capacity * 2 : 4096;
+        RbValue *items = realloc(b->items, capacity * sizeof(RbValue));
+        if (!items) return false;
+        b->items = items;
+        if (b->sort->keyed) {
+            RbValue *keys = realloc(b->keys, capacity * sizeof(RbValue));
+            if (!keys) return false;
+            b->keys = keys;
+        }
+        b->capacity = capacity;
+    }
+    b->items[b->count] = value;
+    b->bytes += value_cost(value);
+    if (b->sort->keyed) {
+        b->keys[b->count] = key;
+        b->bytes += value_cost(key);
+    }
+    b->count++;
+    return true;
+}
+
+static void buffer_clear(RunBuffer *b) {
+    for (size_t i = 0; i < b->count; i++) {
+        rb_value_free(b->items[i]);
+        if (b->sort->keyed) rb_value_free(b->keys[i]);
+    }
+    b->count = 0;
+    b->bytes = 0;
+}
+
+/* Empty the buffer and give back its arrays */
+static void buffer_release(RunBuffer *b) {
+    buffer_clear(b);
+    free(b->items);
+    free(b->keys);
+    b->items = b->keys = NULL;
+    b->capacity = 0;
+}
+
+static bool buffer_sort(RunBuffer *b) {
+    if (b->sort->keyed) return rb_sort_values_by_keys(b->items, b->keys, b->count);
+    rb_sort_values_stable(b->items, b->count, NULL);
+    return true;
+}
+
+/* Pool job: sort the buffer, write it out as a run and empty it */
+static void spill_job(void *arg) {
+    RunBuffer *b = arg;
+    b->ok = false;
+    b->written = 0;
+    b->file = NULL;
+    if (!buffer_sort(b)) return;
+    FILE *file = temp_file(b->sort->options->temp_dir);
+    if (!file) return;
+    Writer w;
+    if (!writer_init(&w, b->sort, file, false)) {
+        fclose(file);
+        return;
+    }
+    bool ok = true;
+    for (size_t i = 0; i < b->count && ok; i++) {
+        if (b->sort->keyed) ok = write_value(&w, b->keys[i]);
+        ok = ok && write_value(&w, b->items[i]);
+    }
+    ok = writer_finish(&w) && ok;
+    buffer_clear(b);
+    if (!ok) {
+        fclose(file);
+        return;
+    }
+    b->file = file;
+    b->written = w.written;
+    b->ok = true;
+}
+
+typedef struct {
+    FILE **files;
+    size_t count;
+    size_t capacity;
+} RunList;
+
+static bool runs_push(RunList *runs, FILE *file) {
+    if (runs->count == runs->capacity) {
+        size_t capacity = runs->capacity ? runs->capacity * 2 : 16;
+        FILE **files = realloc(runs->files, capacity * sizeof(FILE *));
+        if (!files) return false;
+        runs->files = files;
+        runs->capacity = capacity;
+    }
+    runs->files[runs->count++] = file;
+    return true;
+}
+
+static void runs_close(RunList *runs) {
+    for (size_t i = 0; i < runs->count; i++) {
+        if (runs->files[i]) fclose(runs->files[i]);
+    }
+    free(runs->files);
+    runs->files = NULL;
+    runs->count = runs->capacity = 0;
+}
+
+/* Wait for a buffer's spill and collect its run */
+static bool spill_finish(RunBuffer *b, RunList *runs, ExtSortStats *stats) {
+    job_wait(&b->job);
+    if (!b->ok) return false;
+    b->ok = false;
+    if (!runs_push(runs, b->file)) {
+        fclose(b->file);
+        return false;
+    }
+    stats->runs++;
+    stats->bytes_spilled += b->written;
+    return true;
+}
+
+/* ========== MERGING ========== */
+
+/* Loser tree over k runs: leaves are runs, internal node n (1..k-1) keeps the
+ * loser of the match played there and tree[0] the overall winner. Ties go to
+ * the lower run index, which keeps the merge stable. */
+typedef struct {
+    ExtSort *sort;
+    RunReader *readers;
+    size_t k;
+    RbValue *heads;         /* current value of each run */
+    RbValue *head_keys;     /* its key, when keyed */
+    bool *live;
+    size_t *tree;
+} Merger;
+
+static inline bool beats(const Merger *m, size_t a, size_t b) {
+    if (!m->live[a]) return false;
+    if (!m->live[b]) return true;
+    const RbValue *ka = m->sort->keyed ? &m->head_keys[a] : &m->heads[a];
+    const RbValue *kb = m->sort->keyed ? &m->head_keys[b] : &m->heads[b];
+    int c = rb_compare_values(ka, kb);
+    return c < 0 || (c == 0 && a < b);
+}
+
+static bool merger_advance(Merger *m, size_t run) {
+    RunReader *r = &m->readers[run];
+    if (m->sort->keyed) {
+        if (!read_value(r, &m->head_keys[run])) {
+            m->live[run] = false;
+            return !r->failed;
+        }
+        if (!read_value(r, &m->heads[run])) {
+            rb_value_free(m->head_keys[run]);
+            m->live[run] = false;
+            r->failed = true;
+            return false;
+        }
+    } else if (!read_value(r, &m->heads[run])) {
+        m->live[run] = false;
+        return !r->failed;
+    }
+    m->live[run] = true;
+    return true;
+}
+
+static void merger_free(Merger *m) {
+    for (size_t i = 0; i < m->k; i++) {
+        if (m->live && m->live[i]) {
+            rb_value_free(m->heads[i]);
+            if (m->sort->keyed) rb_value_free(m->head_keys[i]);
+        }
+        if (m->readers) reader_close(&m->readers[i]);
+    }
+    free(m->readers);
+    free(m->heads);
+    free(m->head_keys);
+    free(m->live);
+    free(m->tree);
+}
+
+static bool merger_init(Merger *m, ExtSort *sort, FILE **files, size_t k, size_t block_size) {
+    memset(m, 0, sizeof(*m));
+    m->sort = sort;
+    m->readers = calloc(k, sizeof(RunReader));
+    m->heads = calloc(k, sizeof(RbValue));
+    m->head_keys = sort->keyed ? calloc(k, sizeof(RbValue)) : NULL;
+    m->live = calloc(k, sizeof(bool));
+    m->tree = calloc(k, sizeof(size_t));
+    size_t *winners = calloc(2 * k, sizeof(size_t));
+    if (!m->readers || !m->heads || (sort->keyed && !m->head_keys) || !m->live ||
+        !m->tree || !winners) {
+        free(winners);
+        merger_free(m);
+        return false;
+    }
+    m->k = k;
+
+    bool ok = true;
+    for (size_t i = 0; i < k; i++) {
+        if (!reader_open(&m->readers[i], sort, files[i], block_size)) ok = false;
+    }
+    for (size_t i = 0; i < k && ok; i++) ok = merger_advance(m, i);
+    if (!ok) {
+        free(winners);
+        merger_free(m);
+        return false;
+    }
+
+    for (size_t i = 0; i < k; i++) winners[k + i] = i;
+    for (size_t n = k - 1; n >= 1; n--) {
+        size_t a = winners[2 * n], b = winners[2 * n + 1];
+        if (beats(m, a, b)) {
+            winners[n] = a;
+            m->tree[n] = b;
+        } else {
+            winners[n] = b;
+            m->tree[n] = a;
+        }
+    }
+    m->tree[0] = k > 1 ? winners[1] : 0;
+    free(winners);
+    return true;
+}
+
+/* Take the smallest head (its key is freed unless key_out is given) and
+ * replay its path; false when every run is exhausted or on a read error */
+static bool merger_pop(Merger *m, RbValue *value, RbValue *key_out, bool *failed) {
+    size_t w = m->tree[0];
+    if (!m->live[w]) return false;
+    *value = m->heads[w];
+    if (m->sort->keyed) {
+        if (key_out) *key_out = m->head_keys[w];
+        else rb_value_free(m->head_keys[w]);
+    }
+    if (!merger_advance(m, w)) {
+        *failed = true;
+        return true;
+    }
+    size_t current = w;
+    for (size_t n = (m->k + w) / 2; n >= 1; n /= 2) {
+        if (beats(m, m->tree[n], current)) {
+            size_t t = m->tree[n];
+            m->tree[n] = current;
+            current = t;
+        }
+    }
+    m->tree[0] = current;
+    return true;
+}
+
+/* Merge files[0..k) into a new run file */
+static FILE *merge_to_file(ExtSort *sort, FILE **files, size_t k, size_t block_size,
+                           ExtSortStats *stats) {
+    FILE *out = temp_file(sort->options->temp_dir);
+    if (!out) return NULL;
+    Merger m;
+    Writer w;
+    if (!merger_init(&m, sort, files, k, block_size)) {
+        fclose(out);
+        return NULL;
+    }
+    if (!writer_init(&w, sort, out, true)) {
+        merger_free(&m);
+        fclose(out);
+        return NULL;
+    }
+    bool failed = false;
+    RbValue value, key;
+    while (!failed && merger_pop(&m, &value, sort->keyed ? &key : NULL, &failed)) {
+        if (sort->keyed) {
+            write_value(&w, key);
+            rb_value_free(key);
+        }
+        write_value(&w, value);
+        rb_value_free(value);
+    }
+    merger_free(&m);
+    if (!writer_finish(&w) || failed) {
+        fclose(out);
+        return NULL;
+    }
+    stats->bytes_spilled += w.written;
+    return out;
+}
+
+/* Merge files[0..k) straight into the caller */
+static bool merge_to_emit(ExtSort *sort, FILE **files, size_t k, size_t block_size,
+                          ExtSortEmit emit, void *emit_ctx) {
+    Merger m;
+    if (!merger_init(&m, sort, files, k, block_size)) return false;
+    bool failed = false;
+    RbValue value;
+    while (!failed && merger_pop(&m, &value, NULL, &failed)) {
+        if (!emit(emit_ctx, value)) failed = true;
+    }
+    merger_free(&m);
+    return !failed;
+}
+
+/* Largest block size (within bounds) that still lets `runs` be merged at once */
+static size_t pick_block_size(size_t budget, size_t runs) {
+    size_t want = runs < EXTSORT_MAX_FANIN ? runs : EXTSORT_MAX_FANIN;
+    if (want < 2) want = 2;
+    size_t block = IO_BLOCK_MAX;
+    while (block > IO_BLOCK_MIN && budget / (2 * block) < want) block /= 2;
+    return block;
+}
+
+static bool merge_runs(ExtSort *sort, RunList *runs, size_t budget,
+                       ExtSortEmit emit, void *emit_ctx, ExtSortStats *stats) {
+    size_t block = pick_block_size(budget, runs->count);
+    size_t fan_in = budget / (2 * block);
+    if (fan_in > EXTSORT_MAX_FANIN) fan_in = EXTSORT_MAX_FANIN;
+    if (fan_in < 2) fan_in = 2;
+
+    /* Intermediate passes merge consecutive groups, so earlier input still
+     * lands in lower-numbered runs and ties stay in order */
+    while (runs->count > fan_in) {
+        size_t merged = 0;
+        for (size_t i = 0; i < runs->count; i += fan_in) {
+            size_t group = runs->count - i < fan_in ? runs->count - i : fan_in;
+            FILE *file = runs->files[i];
+            if (group > 1) {
+                file = merge_to_file(sort, runs->files + i, group, block, stats);
+                if (!file) return false;
+                for (size_t j = i; j < i + group; j++) {
+                    fclose(runs->files[j]);
+                    runs->files[j] = NULL;
+                }
+            }
+            runs->files[merged++] = file;
+        }
+        for (size_t j = merged; j < runs->count; j++) runs->files[j] = NULL;
+        runs->count = merged;
+        stats->merge_passes++;
+    }
+    stats->merge_passes++;
+    return merge_to_emit(sort, runs->files, runs->count, block, emit, emit_ctx);
+}
+
+/* ========== PUBLIC API ========== */
+
+bool external_sort(ExtSortNext next, void *next_ctx,
+                   ExtSortEmit emit, void *emit_ctx,
+                   const ExtSortOptions *options, ExtSortStats *stats) {
+    ExtSortOptions defaults = {0};
+    ExtSortStats local_stats;
+    if (!options) options = &defaults;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(*stats));
+    if (!next || !emit) return false;
+
+    size_t budget = options->memory_budget ? options->memory_budget : EXTSORT_DEFAULT_BUDGET;
+    if (budget < EXTSORT_MIN_BUDGET) budget = EXTSORT_MIN_BUDGET;
+    /* Two buffers in flight plus scratch for the sort itself */
+    size_t run_budget = budget / 3;
+
+    ExtSort sort = {0};
+    sort.options = options;
+    sort.keyed = options->key != NULL;
+    sort.pool = options->pool ? options->pool : global_thread_pool;
+    ThreadPool *own_pool = NULL;
+    if (!sort.pool) sort.pool = own_pool = thread_pool_create(2);
+    sort.lock = mutex_create();
+    sort.job_done = condvar_create();
+
+    RunBuffer buffers[2];
+    memset(buffers, 0, sizeof(buffers));
+    for (int i = 0; i < 2; i++) {
+        buffers[i].sort = &sort;
+        buffers[i].job.sort = &sort;
+    }
+    RunList runs = {0};
+    bool ok = sort.lock && sort.job_done;
+    bool spilling = false;      /* buffers[filling ^ 1] has a spill in flight */
+    int filling = 0;
+
+    RbValue value;
+    while (ok && next(next_ctx, &value)) {
+        RbValue key = {0};
+        if (sort.keyed) key = options->key(options->key_ctx, value);
+        if (value.type == RB_VAL_PTR || key.type == RB_VAL_PTR ||
+            !buffer_push(&buffers[filling], value, key)) {
+            rb_value_free(value);
+            rb_value_free(key);
+            ok = false;
+            break;
+        }
+        stats->values++;
+        if (buffers[filling].bytes >= run_budget) {
+            if (spilling) {
+                ok = spill_finish(&buffers[filling ^ 1], &runs, stats);
+                spilling = false;
+            }
+            if (ok) {
+                job_start(&buffers[filling].job, spill_job, &buffers[filling]);
+                spilling = true;
+                filling ^= 1;
+            }
+        }
+    }
+    if (spilling) ok = spill_finish(&buffers[filling ^ 1], &runs, stats) && ok;
+
+    if (ok && runs.count == 0) {
+        /* Everything fit in memory */
+        RunBuffer *b = &buffers[filling];
+        ok = buffer_sort(b);
+        size_t i = 0;
+        for (; ok && i < b->count; i++) {
+            if (sort.keyed) rb_value_free(b->keys[i]);
+            if (!emit(emit_ctx, b->items[i])) ok = false;
+        }
+        /* Whatever was not handed over is still ours */
+        for (size_t j = i; j < b->count; j++) {
+            rb_value_free(b->items[j]);
+            if (sort.keyed) rb_value_free(b->keys[j]);
+        }
+        b->count = 0;
+    } else if (ok) {
+        if (buffers[filling].count > 0) {
+            spill_job(&buffers[filling]);
+            ok = spill_finish(&buffers[filling], &runs, stats);
+        }
+        /* Both run buffers are empty now; the merge gets the whole budget */
+        for (int i = 0; i < 2; i++) buffer_release(&buffers[i]);
+        if (ok) ok = merge_runs(&sort, &runs, budget, emit, emit_ctx, stats);
+    }
+
+    for (int i = 0; i < 2; i++) buffer_release(&buffers[i]);
+    runs_close(&runs);
+    if (own_pool) thread_pool_destroy(own_pool);
+    if (sort.lock) mutex_destroy(sort.lock);
+    if (sort.job_done) condvar_destroy(sort.job_done);
+    return ok;
+}
@@ -0,0 +1,66 @@
+#ifndef RUBOLT_EXTERNAL_SORT_H
+#define RUBOLT_EXTERNAL_SORT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../collections/rb_sort.h"
+#include "threading.h"
+
+/* External merge sort for inputs larger than memory.
+ *
+ * Values are pulled from a callback into an in-memory buffer until it holds
+ * about a third of the memory budget, stable-sorted with the RbList sorts and
+ * spilled to an unlinked temp file in a compact binary encoding. The next
+ * buffer fills while a pool thread sorts and writes the previous one. The
+ * runs are then k-way merged through a loser tree, with every run read in
+ * large blocks that are prefetched on the pool while the current block is
+ * consumed. If there are more runs than the budget allows open at once,
+ * intermediate passes merge them in groups first.
+ *
+ * The sort is stable: ties keep their input order. Values are compared in
+ * the natural order (rb_compare_values), or by key when a key function is
+ * given. Input that fits in one buffer is sorted in memory and never touches
+ * disk. RB_VAL_PTR values cannot be spilled and fail the sort. */
+
+#define EXTSORT_DEFAULT_BUDGET  ((size_t)256 << 20)
+#define EXTSORT_MIN_BUDGET      ((size_t)1 << 20)
+#define EXTSORT_MAX_FANIN       256
+
+/* Produce the next input value into *out (ownership passes to the sort);
+ * return false at the end of the input */
+typedef bool (*ExtSortNext)(void *ctx, RbValue *out);
+
+/* Receive the next value in sorted order; the receiver owns it (free with
+ * rb_value_free). Return false to abort the sort */
+typedef bool (*ExtSortEmit)(void *ctx, RbValue value);
+
+/* Sort key for a value. Called once per value; the result is owned by the
+ * sort, so string keys must be fresh allocations */
+typedef RbValue (*ExtSortKey)(void *ctx, RbValue value);
+
+typedef struct {
+    size_t memory_budget;   /* bytes; 0 = EXTSORT_DEFAULT_BUDGET */
+    ExtSortKey key;         /* NULL = sort the values themselves */
+    void *key_ctx;
+    const char *temp_dir;   /* NULL = $TMPDIR, then /tmp */
+    ThreadPool *pool;       /* NULL = global_thread_pool, else a private one */
+} ExtSortOptions;
+
+typedef struct {
+    uint64_t values;
+    size_t runs;            /* sorted runs spilled (0 = sorted in memory) */
+    size_t merge_passes;    /* including the final one */
+    uint64_t bytes_spilled; /* across all passes */
+} ExtSortStats;
+
+/* ========== SORTING ========== */
+
+/* Sort everything `next` produces and hand it to `emit` in order. options
+ * and stats may be NULL. Returns false on I/O or allocation failure, an
+ * unspillable value or an aborted emit; values not yet emitted are freed */
+bool external_sort(ExtSortNext next, void *next_ctx,
+                   ExtSortEmit emit, void *emit_ctx,
+                   const ExtSortOptions *options, ExtSortStats *stats);
+
+#endif /* RUBOLT_EXTERNAL_SORT_H */
@@ -0,0 +1,663 @@
+#ifdef __linux__
+#define _GNU_SOURCE                 /* syscall(), DT_* and O_DIRECTORY under -std=c11 */
+#endif
+
+#include "fs_walk.h"
+#include "threading.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#ifdef _MSC_VER
+#define FS_THREAD_LOCAL __declspec(thread)
+#else
+#define FS_THREAD_LOCAL __thread
+#endif
+
+/* ========== GLOB PATTERNS ========== */
+
+typedef struct {
+    const char *data;
+    size_t length;
+} Span;
+
+typedef struct {
+    char *text;                 /* the pattern's components point into this */
+    Span *parts;
+    size_t count;
+} Glob;
+
+static bool is_globstar(Span s) {
+    return s.length == 2 && s.data[0] == '*' && s.data[1] == '*';
+}
+
+static bool has_wildcard(Span s) {
+    for (size_t i = 0; i < s.length; i++) {
+        if (s.data[i] == '*' || s.data[i] == '?' || s.data[i] == '[' || s.data[i] == '\\') return true;
+    }
+    return false;
+}
+
+/* [...] at p (just past the '['): 1 or 0 for a match or not, with *after
+ * set past the ']'; -1 if there is no closing ']' */
+static int class_match(const char *p, const char *end, char c, const char **after) {
+    bool negate = false, matched = false;
+    if (p < end && (*p == '!' || *p == '^')) {
+        negate = true;
+        p++;
+    }
+    const char *first = p;
+    while (p < end && (*p != ']' || p == first)) {
+        unsigned char lo = (unsigned char)*p, hi = lo;
+        if (p + 2 < end && p[1] == '-' && p[2] != ']') {
+            hi = (unsigned char)p[2];
+            p += 3;
+        } else {
+            p++;
+        }
+        if ((unsigned char)c >= lo && (unsigned char)c <= hi) matched = true;
+    }
+    if (p >= end) return -1;
+    *after = p + 1;
+    return matched != negate;
+}
+
+/* One path component against one pattern component */
+static bool component_match(Span pattern, Span name) {
+    const char *p = pattern.data, *pe = p + pattern.length;
+    const char *n = name.data, *ne = n + name.length;
+    /* Hidden names only match a pattern that starts with a literal dot */
+    if (n < ne && *n == '.' && (p == pe || *p != '.')) return false;
+    const char *star_p = NULL, *star_n = NULL;
+    while (n < ne) {
+        if (p < pe) {
+            if (*p == '*') {
+                star_p = ++p;
+                star_n = n;
+                continue;
+            }
+            if (*p == '?') {
+                p++;
+                n++;
+                continue;
+            }
+            if (*p == '[') {
+                const char *after;
+                int r = class_match(p + 1, pe, *n, &after);
+                if (r > 0) {
+                    p = after;
+                    n++;
+                    continue;
+                }
+                if (r == 0) goto backtrack;
+                /* No closing ']': a literal '[' */
+            }
+            if (*p == '\\' && p + 1 < pe) {
+                if (p[1] != *n) goto backtrack;
+                p += 2;
+                n++;
+                continue;
+            }
+            if (*p == *n) {
+                p++;
+                n++;
+                continue;
+            }
+        }
+    backtrack:
+        if (!star_p) return false;
+        p = star_p;
+        n = ++star_n;
+    }
+    while (p < pe && *p == '*') p++;
+    return p == pe;
+}
+
+/* Pattern parts from pi against path components from ni. With prefix the
+ * question is whether paths below the directory named by the components
+ * could match. */
+static bool parts_match(const Glob *g, size_t pi, const Span *names, size_t count, size_t ni, bool prefix) {
+    if (ni == count) {
+        if (prefix) return pi < g->count;
+        while (pi < g->count && is_globstar(g->parts[pi])) pi++;
+        return pi == g->count;
+    }
+    if (pi == g->count) return false;
+    if (is_globstar(g->parts[pi])) {
+        if (parts_match(g, pi + 1, names, count, ni, prefix)) return true;
+        return names[ni].data[0] != '.' && parts_match(g, pi, names, count, ni + 1, prefix);
+    }
+    return component_match(g->parts[pi], names[ni]) && parts_match(g, pi + 1, names, count, ni + 1, prefix);
+}
+
+/* Split on '/', skipping empty components; *count gets the number */
+static Span *split_path(const char *path, size_t length, Span *stack, size_t stack_count, size_t *count) {
+    size_t n = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (path[i] != '/' && (i == 0 || path[i - 1] == '/')) n++;
+    }
+    Span *spans = n <= stack_count ? stack : malloc(n * sizeof(Span));
+    if (!spans) return NULL;
+    n = 0;
+    for (size_t i = 0; i < length;) {
+        if (path[i] == '/') {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < length && path[i] != '/') i++;
+        spans[n++] = (Span){ path + start, i - start };
+    }
+    *count = n;
+    return spans;
+}
+
+static bool glob_test(const Glob *g, const char *path, size_t length, bool prefix) {
+    Span stack[64];
+    size_t count;
+    Span *names = split_path(path, length, stack, 64, &count);
+    if (!names) return false;
+    bool result = parts_match(g, 0, names, count, 0, prefix);
+    if (names != stack) free(names);
+    return result;
+}
+
+static void glob_free(Glob *g) {
+    if (!g) return;
+    free(g->text);
+    free(g->parts);
+    free(g);
+}
+
+/* Parse a pattern into the literal directory to start from and the parts
+ * to match below it */
+static Glob *glob_parse(const char *pattern, char **root) {
+    Glob *g = calloc(1, sizeof(Glob));
+    if (!g || !(g->text = strdup(pattern))) {
+        free(g);
+        return NULL;
+    }
+    size_t count;
+    Span *parts = split_path(g->text, strlen(g->text), NULL, 0, &count);
+    if (!parts || count == 0) {
+        free(parts);
+        glob_free(g);
+        return NULL;
+    }
+    /* Leading literal components form the root; the last one is always
+     * matched, so "src/main.c" reads src */
+    size_t literal = 0;
+    while (literal + 1 < count && !has_wildcard(parts[literal])) literal++;
+    size_t length = pattern[0] == '/' ? 1 : 0;
+    for (size_t i = 0; i < literal; i++) length += parts[i].length + 1;
+    char *r = malloc(length + 1), *p = r;
+    if (!r) {
+        free(parts);
+        glob_free(g);
+        return NULL;
+    }
+    if (pattern[0] == '/') *p++ = '/';
+    for (size_t i = 0; i < literal; i++) {
+        if (i) *p++ = '/';
+        memcpy(p, parts[i].data, parts[i].length);
+        p += parts[i].length;
+    }
+    *p = '\0';
+    memmove(parts, parts + literal, (count - literal) * sizeof(Span));
+    g->parts = parts;
+    g->count = count - literal;
+    *root = r;
+    return g;
+}
+
+bool fs_glob_match(const char *pattern, const char *path) {
+    Glob g = { NULL, NULL, 0 };
+    g.parts = split_path(pattern, strlen(pattern), NULL, 0, &g.count);
+    if (!g.parts) return false;
+    bool result = glob_test(&g, path, strlen(path), false);
+    free(g.parts);
+    return result;
+}
+
+/* ========== RESULT BATCHES ========== */
+
+/* The entries found in one directory: NUL-terminated paths back to back */
+typedef struct FsBatch {
+    struct FsBatch *next;
+    char *text;
+    size_t text_length, text_capacity;
+    size_t *offsets;
+    unsigned char *types;
+    size_t count, capacity;
+    size_t read;                /* entries handed to the caller */
+} FsBatch;
+
+static void batch_free(FsBatch *b) {
+    if (!b) return;
+    free(b->text);
+    free(b->offsets);
+    free(b->types);
+    free(b);
+}
+
+static bool batch_add(FsBatch *b, const char *path, size_t length, FsEntryType type) {
+    if (b->count == b->capacity) {
+        size_t capacity = b->capacity ? b->capacity * 2 : 64;
+        size_t *offsets = realloc(b->offsets, capacity * sizeof(size_t));
+        if (!offsets) return false;
+        b->offsets = offsets;
+        unsigned char *types = realloc(b->types, capacity);
+        if (!types) return false;
+        b->types = types;
+        b->capacity = capacity;
+    }
+    if (b->text_length + length + 1 > b->text_capacity) {
+        size_t capacity = b->text_capacity ? b->text_capacity * 2 : 4096;
+        while (capacity < b->text_length + length + 1) capacity *= 2;
+        char *text = realloc(b->text, capacity);
+        if (!text) return false;
+        b->text = text;
+        b->text_capacity = capacity;
+    }
+    b->offsets[b->count] = b->text_length;
+    b->types[b->count++] = (unsigned char)type;
+    memcpy(b->text + b->text_length, path, length);
+    b->text[b->text_length + length] = '\0';
+    b->text_length += length + 1;
+    return true;
+}
+
+/* ========== WALK STATE ========== */
+
+struct FsWalk {
+    Mutex *lock;
+    CondVar *ready;             /* a batch arrived or a worker finished */
+    ThreadPool *pool;
+    size_t max_tasks;
+    size_t tasks;               /* pool tasks running or queued */
+    char **dirs;                /* directories waiting to be read */
+    size_t dir_count, dir_capacity;
+    size_t scanning;            /* directories being read */
+    FsBatch *head, *tail;
+    size_t buffered;            /* entries in the batches */
+    FsBatch *current;           /* being handed out, owned by the caller */
+    size_t errors;
+    bool cancelled;
+    Glob *glob;                 /* NULL for a plain walk */
+    size_t relative_offset;     /* where glob-relative paths start */
+};
+
+/* Directory read results, built without the lock */
+typedef struct {
+    FsBatch *batch;
+    char **subdirs;
+    size_t subdir_count, subdir_capacity;
+    char *path;                 /* scratch for joined paths */
+    size_t path_capacity;
+} Scan;
+
+static const char *scan_join(Scan *s, const char *dir, const char *name, size_t name_length, size_t *length) {
+    size_t dir_length = strlen(dir);
+    bool slash = dir_length && dir[dir_length - 1] != '/';
+    *length = dir_length + slash + name_length;
+    if (*length + 1 > s->path_capacity) {
+        size_t capacity = s->path_capacity ? s->path_capacity : 256;
+        while (capacity < *length + 1) capacity *= 2;
+        char *path = realloc(s->path, capacity);
+        if (!path) return NULL;
+        s->path = path;
+        s->path_capacity = capacity;
+    }
+    memcpy(s->path, dir, dir_length);
+    if (slash) s->path[dir_length] = '/';
+    memcpy(s->path + dir_length + slash, name, name_length);
+    s->path[*length] = '\0';
+    return s->path;
+}
+
+static void scan_visit(FsWalk *w, Scan *s, const char *dir, const char *name, size_t name_length,
+                       FsEntryType type) {
+    size_t length;
+    const char *path = scan_join(s, dir, name, name_length, &length);
+    if (!path) return;
+    bool report = true, descend = type == FS_ENTRY_DIR;
+    if (w->glob) {
+        const char *relative = path + w->relative_offset;
+        size_t relative_length = length - w->relative_offset;
+        report = glob_test(w->glob, relative, relative_length, false);
+        descend = descend && glob_test(w->glob, relative, relative_length, true);
+    }
+    if (report) batch_add(s->batch, path, length, type);
+    if (!descend) return;
+    if (s->subdir_count == s->subdir_capacity) {
+        size_t capacity = s->subdir_capacity ? s->subdir_capacity * 2 : 16;
+        char **subdirs = realloc(s->subdirs, capacity * sizeof(char *));
+        if (!subdirs) return;
+        s->subdirs = subdirs;
+        s->subdir_capacity = capacity;
+    }
+    char *copy = malloc(length + 1);
+    if (!copy) return;
+    memcpy(copy, path, length + 1);
+    s->subdirs[s->subdir_count++] = copy;
+}
+
+static bool is_dot_or_dotdot(const char *name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+/* ========== READING DIRECTORIES ========== */
+
+#ifdef _WIN32
+
+static bool scan_dir(FsWalk *w, Scan *s, const char *dir) {
+    char pattern[MAX_PATH];
+    size_t length = strlen(dir);
+    if (length + 3 > sizeof(pattern)) return false;
+    memcpy(pattern, length ? dir : ".", length ? length : 1);
+    strcpy(pattern + (length ? length : 1), "\\*");
+    WIN32_FIND_DATAA data;
+    HANDLE h = FindFirstFileA(pattern, &data);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    do {
+        if (is_dot_or_dotdot(data.cFileName)) continue;
+        FsEntryType type = data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT ? FS_ENTRY_LINK
+                           : data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY  ? FS_ENTRY_DIR
+                                                                               : FS_ENTRY_FILE;
+        scan_visit(w, s, dir, data.cFileName, strlen(data.cFileName), type);
+    } while (FindNextFileA(h, &data));
+    FindClose(h);
+    return true;
+}
+
+#else
+
+/* The type from d_type, or from lstat when the file system leaves it
+ * unknown */
+static FsEntryType entry_type(int dir_fd, const char *name, unsigned char d_type) {
+#ifdef DT_UNKNOWN
+    switch (d_type) {
+        case DT_REG: return FS_ENTRY_FILE;
+        case DT_DIR: return FS_ENTRY_DIR;
+        case DT_LNK: return FS_ENTRY_LINK;
+        case DT_UNKNOWN: break;
+        default: return FS_ENTRY_OTHER;
+    }
+#else
+    (void)d_type;
+#endif
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) return FS_ENTRY_OTHER;
+    if (S_ISREG(st.st_mode)) return FS_ENTRY_FILE;
+    if (S_ISDIR(st.st_mode)) return FS_ENTRY_DIR;
+    if (S_ISLNK(st.st_mode)) return FS_ENTRY_LINK;
+    return FS_ENTRY_OTHER;
+}
+
+#ifdef __linux__
+
+struct dirent64_record {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* One large buffer per thread, kept for the thread's lifetime */
+static FS_THREAD_LOCAL char *dir_buffer;
+
+static bool scan_dir(FsWalk *w, Scan *s, const char *dir) {
+    if (!dir_buffer && !(dir_buffer = malloc(FS_WALK_DIR_BUFFER))) return false;
+    int fd = open(*dir ? dir : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (;;) {
+        long n = syscall(SYS_getdents64, fd, dir_buffer, FS_WALK_DIR_BUFFER);
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        for (long offset = 0; offset < n;) {
+            struct dirent64_record *d = (struct dirent64_record *)(dir_buffer + offset);
+            offset += d->d_reclen;
+            if (is_dot_or_dotdot(d->d_name)) continue;
+            scan_visit(w, s, dir, d->d_name, strlen(d->d_name), entry_type(fd, d->d_name, d->d_type));
+        }
+    }
+    close(fd);
+    return ok;
+}
+
+#else
+
+static bool scan_dir(FsWalk *w, Scan *s, const char *dir) {
+    DIR *d = opendir(*dir ? dir : ".");
+    if (!d) return false;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (is_dot_or_dotdot(e->d_name)) continue;
+#ifdef DT_UNKNOWN
+        unsigned char d_type = e->d_type;
+#else
+        unsigned char d_type = 0;
+#endif
+        scan_visit(w, s, dir, e->d_name, strlen(e->d_name), entry_type(dirfd(d), e->d_name, d_type));
+    }
+    closedir(d);
+    return true;
+}
+
+#endif
+#endif
+
+/* ========== SCHEDULING ========== */
+
+static void *walk_task(void *arg);
+
+/* Start pool tasks while there are directories for them; lock held */
+static void spawn_tasks(FsWalk *w) {
+    while (!w->cancelled && w->tasks < w->max_tasks && w->tasks < w->dir_count &&
+           w->buffered < FS_WALK_MAX_BUFFERED) {
+        if (!thread_pool_submit(w->pool, walk_task, w)) break;
+        w->tasks++;
+    }
+}
+
+/* Read dir (taken from w->dirs, with w->scanning counting it) and publish
+ * what it held; called without the lock */
+static void read_and_publish(FsWalk *w, char *dir) {
+    Scan s;
+    memset(&s, 0, sizeof(s));
+    s.batch = calloc(1, sizeof(FsBatch));
+    bool ok = s.batch && scan_dir(w, &s, dir);
+    free(s.path);
+    free(dir);
+
+    mutex_lock(w->lock);
+    w->scanning--;
+    if (!ok) w->errors++;
+    for (size_t i = 0; i < s.subdir_count; i++) {
+        if (w->dir_count == w->dir_capacity) {
+            size_t capacity = w->dir_capacity ? w->dir_capacity * 2 : 64;
+            char **dirs = realloc(w->dirs, capacity * sizeof(char *));
+            if (!dirs) {
+                w->errors++;
+                free(s.subdirs[i]);
+                continue;
+            }
+            w->dirs = dirs;
+            w->dir_capacity = capacity;
+        }
+        w->dirs[w->dir_count++] = s.subdirs[i];
+    }
+    free(s.subdirs);
+    if (s.batch && s.batch->count) {
+        if (w->tail) w->tail->next = s.batch;
+        else w->head = s.batch;
+        w->tail = s.batch;
+        w->buffered += s.batch->count;
+    } else {
+        batch_free(s.batch);
+    }
+    spawn_tasks(w);
+    condvar_broadcast(w->ready);
+    mutex_unlock(w->lock);
+}
+
+/* Pool task: read directories until none are left, the caller has enough
+ * waiting, or the walk is closed */
+static void *walk_task(void *arg) {
+    FsWalk *w = arg;
+    mutex_lock(w->lock);
+    while (!w->cancelled && w->dir_count && w->buffered < FS_WALK_MAX_BUFFERED) {
+        char *dir = w->dirs[--w->dir_count];
+        w->scanning++;
+        mutex_unlock(w->lock);
+        read_and_publish(w, dir);
+        mutex_lock(w->lock);
+    }
+    w->tasks--;
+    condvar_broadcast(w->ready);
+    mutex_unlock(w->lock);
+    return NULL;
+}
+
+/* ========== WALKS ========== */
+
+static FsWalk *walk_start(char *root, Glob *glob) {
+    FsWalk *w = calloc(1, sizeof(FsWalk));
+    if (!w) return NULL;
+    w->lock = mutex_create();
+    w->ready = condvar_create();
+    w->dirs = malloc(64 * sizeof(char *));
+    if (!w->lock || !w->ready || !w->dirs) {
+        if (w->lock) mutex_destroy(w->lock);
+        if (w->ready) condvar_destroy(w->ready);
+        free(w->dirs);
+        free(w);
+        return NULL;
+    }
+    w->dir_capacity = 64;
+    w->dirs[w->dir_count++] = root;
+    w->glob = glob;
+    size_t root_length = strlen(root);
+    w->relative_offset = root_length + (root_length && root[root_length - 1] != '/');
+    w->pool = thread_pool_shared();
+    w->max_tasks = w->pool ? w->pool->thread_count : 0;
+    /* The first fs_walk_next reads root itself and starts the pool on
+     * its subdirectories, so the first paths never wait for a worker */
+    return w;
+}
+
+FsWalk *fs_walk_open(const char *root) {
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(root);
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) return NULL;
+#else
+    struct stat st;
+    if (stat(root, &st) != 0 || !S_ISDIR(st.st_mode)) return NULL;
+#endif
+    /* Drop trailing slashes so paths join cleanly, but keep "/" */
+    size_t length = strlen(root);
+    while (length > 1 && root[length - 1] == '/') length--;
+    char *copy = malloc(length + 1);
+    if (!copy) return NULL;
+    memcpy(copy, root, length);
+    copy[length] = '\0';
+    FsWalk *w = walk_start(copy, NULL);
+    if (!w) free(copy);
+    return w;
+}
+
+FsWalk *fs_glob_open(const char *pattern) {
+    char *root;
+    Glob *g = glob_parse(pattern, &root);
+    if (!g) return NULL;
+    FsWalk *w = walk_start(root, g);
+    if (!w) {
+        free(root);
+        glob_free(g);
+    }
+    return w;
+}
+
+bool fs_walk_next(FsWalk *w, const char **path, size_t *length, FsEntryType *type) {
+    FsBatch *b = w->current;
+    if (!b || b->read == b->count) {
+        mutex_lock(w->lock);
+        batch_free(b);
+        w->current = b = NULL;
+        for (;;) {
+            if (w->head) {
+                b = w->head;
+                w->head = b->next;
+                if (!w->head) w->tail = NULL;
+                w->buffered -= b->count;
+                spawn_tasks(w);
+                break;
+            }
+            if (!w->dir_count && !w->scanning) {
+                mutex_unlock(w->lock);
+                return false;
+            }
+            if (w->dir_count) {
+                /* Read a directory here rather than wait for the pool */
+                char *dir = w->dirs[--w->dir_count];
+                w->scanning++;
+                mutex_unlock(w->lock);
+                read_and_publish(w, dir);
+                mutex_lock(w->lock);
+                continue;
+            }
+            condvar_wait(w->ready, w->lock);
+        }
+        mutex_unlock(w->lock);
+        w->current = b;
+    }
+    size_t i = b->read++;
+    *path = b->text + b->offsets[i];
+    *length = (i + 1 < b->count ? b->offsets[i + 1] : b->text_length) - b->offsets[i] - 1;
+    *type = (FsEntryType)b->types[i];
+    return true;
+}
+
+size_t fs_walk_errors(FsWalk *w) {
+    mutex_lock(w->lock);
+    size_t errors = w->errors;
+    mutex_unlock(w->lock);
+    return errors;
+}
+
+void fs_walk_close(FsWalk *w) {
+    if (!w) return;
+    mutex_lock(w->lock);
+    w->cancelled = true;
+    while (w->tasks || w->scanning) condvar_wait(w->ready, w->lock);
+    mutex_unlock(w->lock);
+    for (size_t i = 0; i < w->dir_count; i++) free(w->dirs[i]);
+    free(w->dirs);
+    while (w->head) {
+        FsBatch *next = w->head->next;
+        batch_free(w->head);
+        w->head = next;
+    }
+    batch_free(w->current);
+    glob_free(w->glob);
+    mutex_destroy(w->lock);
+    condvar_destroy(w->ready);
+    free(w);
+}
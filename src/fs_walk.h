@@ -0,0 +1,61 @@
+#ifndef RUBOLT_FS_WALK_H
+#define RUBOLT_FS_WALK_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Recursive directory walks and globs for the fs module.
+ *
+ * Directories are read on the shared thread pool, several at a time, and
+ * the entries are handed to the caller as they are found: fs_walk_next
+ * returns the first paths long before a walk of a large tree finishes.
+ * The calling thread reads directories too while it would otherwise wait,
+ * so a walk makes progress even when the pool is busy. On Linux a
+ * directory is read with getdents64 into a large per-thread buffer, and
+ * entry types come from d_type, so nothing is stat'ed unless the file
+ * system does not report types. Symbolic links are reported, never
+ * followed. Workers stop reading ahead once FS_WALK_MAX_BUFFERED entries
+ * are waiting for the caller.
+ *
+ * Entries arrive in no particular order; sort them if order matters. */
+
+#define FS_WALK_DIR_BUFFER ((size_t)256 << 10)  /* getdents64 buffer per thread */
+#define FS_WALK_MAX_BUFFERED ((size_t)1 << 16)
+
+typedef enum {
+    FS_ENTRY_FILE,
+    FS_ENTRY_DIR,
+    FS_ENTRY_LINK,
+    FS_ENTRY_OTHER
+} FsEntryType;
+
+typedef struct FsWalk FsWalk;
+
+/* ========== WALKS ========== */
+
+/* Everything below root, not root itself; paths are root joined with the
+ * relative path. NULL if root is not a readable directory. */
+FsWalk *fs_walk_open(const char *root);
+
+/* Paths matching a glob pattern: * and ? match within one path component,
+ * [abc], [a-z] and [!x] match one character, and a ** component matches
+ * any number of directories. Wildcards do not match a leading dot. Only
+ * directories that can contain a match are read. */
+FsWalk *fs_glob_open(const char *pattern);
+
+/* The next entry; the path stays valid until the next call. False when
+ * the walk is finished. */
+bool fs_walk_next(FsWalk *walk, const char **path, size_t *length, FsEntryType *type);
+
+/* Directories that could not be read so far */
+size_t fs_walk_errors(FsWalk *walk);
+
+/* Stops the workers and frees the walk; it need not be finished */
+void fs_walk_close(FsWalk *walk);
+
+/* ========== MATCHING ========== */
+
+/* Whether a relative path matches a pattern, with the rules above */
+bool fs_glob_match(const char *pattern, const char *path);
+
+#endif /* RUBOLT_FS_WALK_H */
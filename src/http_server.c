@@ -0,0 +1,599 @@
+#ifndef _WIN32
+#define _GNU_SOURCE         /* gmtime_r() under -std=c99 */
+#endif
+
+#include "http_server.h"
+#include "mmap_file.h"
+#include "net.h"
+#include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* ========== PARSER ========== */
+
+bool http_slice_eq(HttpSlice s, const char *str) {
+    size_t n = strlen(str);
+    return s.len == n && memcmp(s.ptr, str, n) == 0;
+}
+
+static bool slice_ieq(HttpSlice s, const char *str) {
+    size_t n = strlen(str);
+    if (s.len != n) return false;
+    for (size_t i = 0; i < n; i++) {
+        char a = s.ptr[i], b = str[i];
+        if (a >= 'A' && a <= 'Z') a = (char)(a + 32);
+        if (b >= 'A' && b <= 'Z') b = (char)(b + 32);
+        if (a != b) return false;
+    }
+    return true;
+}
+
+const HttpSlice *http_request_header(const HttpRequest *req, const char *name) {
+    for (size_t i = 0; i < req->header_count; i++) {
+        if (slice_ieq(req->headers[i].name, name)) return &req->headers[i].value;
+    }
+    return NULL;
+}
+
+/* True if the header block holds a control byte other than \t \r \n
+ * (16 bytes per step with SSE2) */
+static bool has_control_bytes(const char *p, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i max_ctl = _mm_set1_epi8(0x1f);
+    const __m128i tab = _mm_set1_epi8('\t'), cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i ctl = _mm_cmpeq_epi8(_mm_max_epu8(x, max_ctl), max_ctl);
+        __m128i ok = _mm_or_si128(_mm_cmpeq_epi8(x, tab), _mm_or_si128(_mm_cmpeq_epi8(x, cr), _mm_cmpeq_epi8(x, lf)));
+        __m128i bad = _mm_or_si128(_mm_andnot_si128(ok, ctl), _mm_cmpeq_epi8(x, del));
+        if (_mm_movemask_epi8(bad)) return true;
+    }
+#endif
+    for (; i < len; i++) {
+        unsigned char c = (unsigned char)p[i];
+        if ((c < 0x20 && c != '\t' && c != '\r' && c != '\n') || c == 0x7f) return true;
+    }
+    return false;
+}
+
+/* Offset just past the blank line ending the headers, or 0 if not there yet.
+ * Newlines are located with the SIMD scanner from mmap_file. */
+static size_t find_header_end(const char *buf, size_t len, size_t *scanned) {
+    const char *end = buf + len;
+    const char *p = buf + *scanned;
+    while (p < end) {
+        const char *nl = mapped_find_newline(p, end);
+        if (nl == end) break;
+        if (nl + 1 < end && nl[1] == '\n') return (size_t)(nl + 2 - buf);
+        if (nl + 2 < end && nl[1] == '\r' && nl[2] == '\n') return (size_t)(nl + 3 - buf);
+        *scanned = (size_t)(nl - buf);
+        p = nl + 1;
+    }
+    return 0;
+}
+
+static HttpSlice trim(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+    HttpSlice s = { p, (size_t)(end - p) };
+    return s;
+}
+
+long http_parse_request(const char *buf, size_t len, size_t *scanned, HttpRequest *req) {
+    size_t head_len = find_header_end(buf, len, scanned);
+    if (head_len == 0) return 0;
+    if (has_control_bytes(buf, head_len)) return -1;
+
+    const char *p = buf, *end = buf + head_len;
+    memset(req, 0, sizeof(*req));
+
+    /* Request line: METHOD SP target SP HTTP/1.x */
+    const char *eol = mapped_find_newline(p, end);
+    const char *sp1 = memchr(p, ' ', (size_t)(eol - p));
+    if (!sp1 || sp1 == p) return -1;
+    const char *sp2 = memchr(sp1 + 1, ' ', (size_t)(eol - sp1 - 1));
+    if (!sp2 || sp2 == sp1 + 1) return -1;
+    HttpSlice version = trim(sp2 + 1, eol);
+    if (version.len != 8 || memcmp(version.ptr, "HTTP/1.", 7) != 0) return -1;
+    if (version.ptr[7] < '0' || version.ptr[7] > '9') return -1;
+
+    req->method.ptr = p;
+    req->method.len = (size_t)(sp1 - p);
+    const char *target = sp1 + 1;
+    const char *q = memchr(target, '?', (size_t)(sp2 - target));
+    req->path.ptr = target;
+    req->path.len = (size_t)((q ? q : sp2) - target);
+    req->query.ptr = q ? q + 1 : sp2;
+    req->query.len = q ? (size_t)(sp2 - q - 1) : 0;
+    req->minor_version = version.ptr[7] - '0';
+    req->keep_alive = req->minor_version >= 1;
+
+    /* Header lines */
+    for (p = eol + 1; p < end; p = eol + 1) {
+        eol = mapped_find_newline(p, end);
+        if (p == eol || (p + 1 == eol && *p == '\r')) break;     /* blank line */
+        if (*p == ' ' || *p == '\t') return -1;                  /* obs-fold */
+        if (req->header_count == HTTP_MAX_HEADERS) return -1;
+        const char *colon = memchr(p, ':', (size_t)(eol - p));
+        if (!colon || colon == p) return -1;
+
+        HttpHeader *h = &req->headers[req->header_count++];
+        h->name.ptr = p;
+        h->name.len = (size_t)(colon - p);
+        h->value = trim(colon + 1, eol);
+
+        if (slice_ieq(h->name, "content-length")) {
+            size_t n = 0;
+            if (h->value.len == 0 || h->value.len > 12) return -1;
+            for (size_t i = 0; i < h->value.len; i++) {
+                char c = h->value.ptr[i];
+                if (c < '0' || c > '9') return -1;
+                n = n * 10 + (size_t)(c - '0');
+            }
+            req->content_length = n;
+        } else if (slice_ieq(h->name, "connection")) {
+            if (slice_ieq(h->value, "close")) req->keep_alive = false;
+            else if (slice_ieq(h->value, "keep-alive")) req->keep_alive = true;
+        } else if (slice_ieq(h->name, "transfer-encoding")) {
+            req->chunked = !slice_ieq(h->value, "identity");
+        }
+    }
+
+    if (req->chunked) return (long)head_len;
+    if (len - head_len < req->content_length) return 0;
+    req->body.ptr = buf + head_len;
+    req->body.len = req->content_length;
+    return (long)(head_len + req->content_length);
+}
+
+const char *http_status_text(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default:  return "Unknown";
+    }
+}
+
+#ifndef _WIN32
+
+/* ========== SERVER STATE ========== */
+
+typedef struct HttpWorker {
+    HttpServer *server;
+    EventLoop *loop;
+    int listen_fd;
+    Thread *thread;
+    char *free_buffers[HTTP_POOL_MAX_BUFFERS];  /* Idle HTTP_BUFFER_SIZE buffers */
+    size_t free_count;
+    HttpConn *free_conns;
+    HttpConn *active;
+    char date[40];              /* Cached Date header, refreshed once a second */
+    time_t date_sec;
+} HttpWorker;
+
+struct HttpServer {
+    HttpHandler handler;
+    void *user;
+    int port;
+    HttpWorker *workers;
+    size_t worker_count;
+    volatile bool stopping;
+};
+
+struct HttpConn {
+    HttpWorker *worker;
+    int fd;
+    char *in;                   /* Unparsed input, compacted after each batch */
+    size_t in_len, in_cap;
+    size_t scanned;             /* Header-end search resume point */
+    char *out;                  /* Serialized responses awaiting write */
+    size_t out_len, out_cap, out_sent;
+    int file_fd;                /* Pending http_respond_file body */
+    int64_t file_off, file_end;
+    bool keep_alive;            /* Current request */
+    bool head_only;             /* Current request is HEAD */
+    bool responded;
+    bool close_after;
+    bool peer_closed;
+    bool read_blocked;          /* Stopped reading until output drains */
+    HttpConn *prev, *next;
+};
+
+/* ========== BUFFER POOL ========== */
+
+static char *pool_get(HttpWorker *w) {
+    if (w->free_count) return w->free_buffers[--w->free_count];
+    return (char *)malloc(HTTP_BUFFER_SIZE);
+}
+
+static void pool_put(HttpWorker *w, char *buf, size_t cap) {
+    if (!buf) return;
+    if (cap == HTTP_BUFFER_SIZE && w->free_count < HTTP_POOL_MAX_BUFFERS) w->free_buffers[w->free_count++] = buf;
+    else free(buf);
+}
+
+static bool out_reserve(HttpConn *c, size_t n) {
+    if (!c->out) {
+        c->out = pool_get(c->worker);
+        if (!c->out) return false;
+        c->out_cap = HTTP_BUFFER_SIZE;
+    }
+    if (c->out_len + n <= c->out_cap) return true;
+    size_t cap = c->out_cap;
+    while (cap < c->out_len + n) cap *= 2;
+    char *grown = (char *)realloc(c->out, cap);
+    if (!grown) return false;
+    c->out = grown;
+    c->out_cap = cap;
+    return true;
+}
+
+static void out_append(HttpConn *c, const char *data, size_t len) {
+    if (!len || !out_reserve(c, len)) return;
+    memcpy(c->out + c->out_len, data, len);
+    c->out_len += len;
+}
+
+/* ========== RESPONSES ========== */
+
+static const char *worker_date(HttpWorker *w) {
+    time_t now = time(NULL);
+    if (now != w->date_sec) {
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        strftime(w->date, sizeof(w->date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        w->date_sec = now;
+    }
+    return w->date;
+}
+
+static void write_head(HttpConn *c, int status, const char *content_type, const char *framing) {
+    if (!content_type) content_type = "text/plain";
+    size_t need = 192 + strlen(content_type) + strlen(framing);
+    if (!out_reserve(c, need)) return;
+    int n = snprintf(c->out + c->out_len, c->out_cap - c->out_len,
+                     "HTTP/1.1 %d %s\r\nServer: Rubolt\r\nDate: %s\r\nContent-Type: %s\r\n%s\r\nConnection: %s\r\n\r\n",
+                     status, http_status_text(status), worker_date(c->worker), content_type, framing,
+                     c->keep_alive ? "keep-alive" : "close");
+    if (n > 0) c->out_len += (size_t)n;
+    c->responded = true;
+}
+
+void http_respond(HttpConn *conn, int status, const char *content_type, const char *body, size_t len) {
+    char framing[48];
+    snprintf(framing, sizeof(framing), "Content-Length: %zu", len);
+    write_head(conn, status, content_type, framing);
+    if (!conn->head_only) out_append(conn, body, len);
+}
+
+void http_respond_chunked_begin(HttpConn *conn, int status, const char *content_type) {
+    write_head(conn, status, content_type, "Transfer-Encoding: chunked");
+}
+
+void http_respond_chunk(HttpConn *conn, const char *data, size_t len) {
+    if (!len || conn->head_only) return;    /* a zero-length chunk would end the body */
+    char size_line[24];
+    int n = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+    out_append(conn, size_line, (size_t)n);
+    out_append(conn, data, len);
+    out_append(conn, "\r\n", 2);
+}
+
+void http_respond_chunked_end(HttpConn *conn) {
+    if (!conn->head_only) out_append(conn, "0\r\n\r\n", 5);
+}
+
+bool http_respond_file(HttpConn *conn, int status, const char *content_type, const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+    char framing[48];
+    snprintf(framing, sizeof(framing), "Content-Length: %lld", (long long)st.st_size);
+    write_head(conn, status, content_type, framing);
+    if (conn->head_only || st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    /* Body goes out with sendfile once the buffered headers are written;
+     * pipelined requests behind it wait until it completes */
+    conn->file_fd = fd;
+    conn->file_off = 0;
+    conn->file_end = (int64_t)st.st_size;
+    return true;
+}
+
+/* ========== CONNECTIONS ========== */
+
+static void conn_on_ready(void *data, int fd, uint32_t ready);
+
+static HttpConn *conn_new(HttpWorker *w, int fd) {
+    HttpConn *c = w->free_conns;
+    if (c) w->free_conns = c->next;
+    else if (!(c = (HttpConn *)malloc(sizeof(HttpConn)))) return NULL;
+    memset(c, 0, sizeof(*c));
+    c->worker = w;
+    c->fd = fd;
+    c->file_fd = -1;
+    c->next = w->active;
+    if (w->active) w->active->prev = c;
+    w->active = c;
+    return c;
+}
+
+static void conn_release_buffers(HttpConn *c) {
+    HttpWorker *w = c->worker;
+    if (c->in && c->in_len == 0) { pool_put(w, c->in, c->in_cap); c->in = NULL; c->in_cap = 0; }
+    if (c->out && c->out_len == 0) { pool_put(w, c->out, c->out_cap); c->out = NULL; c->out_cap = 0; }
+}
+
+static void conn_close(HttpConn *c) {
+    HttpWorker *w = c->worker;
+    event_loop_unwatch_fd(w->loop, c->fd);
+    close(c->fd);
+    if (c->file_fd >= 0) close(c->file_fd);
+    c->in_len = c->out_len = 0;
+    conn_release_buffers(c);
+    if (c->prev) c->prev->next = c->next;
+    else w->active = c->next;
+    if (c->next) c->next->prev = c->prev;
+    c->next = w->free_conns;
+    w->free_conns = c;
+}
+
+/* Answer every complete request in the input buffer */
+static void conn_process(HttpConn *c) {
+    HttpServer *server = c->worker->server;
+    size_t pos = 0;
+    while (!c->close_after && c->file_fd < 0 && pos < c->in_len) {
+        HttpRequest req;
+        long n = http_parse_request(c->in + pos, c->in_len - pos, &c->scanned, &req);
+        if (n == 0) break;
+        if (n < 0) {
+            c->keep_alive = false;
+            c->head_only = false;
+            http_respond(c, 400, "text/plain", "Bad Request\n", 12);
+            c->close_after = true;
+            break;
+        }
+        pos += (size_t)n;
+        c->scanned = 0;
+        c->keep_alive = req.keep_alive;
+        c->head_only = http_slice_eq(req.method, "HEAD");
+        c->responded = false;
+        if (req.chunked) {
+            c->keep_alive = false;
+            http_respond(c, 501, "text/plain", "Chunked request bodies are not supported\n", 41);
+        } else {
+            server->handler(c, &req, server->user);
+            if (!c->responded) http_respond(c, 500, "text/plain", "No response\n", 12);
+        }
+        if (!c->keep_alive) c->close_after = true;
+    }
+    if (pos) {
+        memmove(c->in, c->in + pos, c->in_len - pos);
+        c->in_len -= pos;
+    }
+}
+
+/* Read until EAGAIN, answering requests as they complete. Returns false
+ * if the connection was closed. */
+static bool conn_read(HttpConn *c) {
+    HttpWorker *w = c->worker;
+    for (;;) {
+        /* Backpressure: stop reading while a file or a large backlog of
+         * responses is still going out */
+        if (c->file_fd >= 0 || c->out_len - c->out_sent > 4 * HTTP_BUFFER_SIZE) {
+            c->read_blocked = true;
+            return true;
+        }
+        if (c->close_after || c->peer_closed) return true;
+        if (!c->in) {
+            c->in = pool_get(w);
+            if (!c->in) { conn_close(c); return false; }
+            c->in_cap = HTTP_BUFFER_SIZE;
+        }
+        if (c->in_len == c->in_cap) {
+            if (c->in_cap >= HTTP_MAX_REQUEST) {
+                c->keep_alive = false;
+                c->head_only = false;
+                http_respond(c, 413, "text/plain", "Payload Too Large\n", 18);
+                c->close_after = true;
+                return true;
+            }
+            char *grown = (char *)realloc(c->in, c->in_cap * 2);
+            if (!grown) { conn_close(c); return false; }
+            c->in = grown;
+            c->in_cap *= 2;
+        }
+
+        ssize_t n = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+            conn_process(c);
+            continue;
+        }
+        if (n == 0) { c->peer_closed = true; return true; }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+        conn_close(c);
+        return false;
+    }
+}
+
+/* Write buffered responses, then any pending file. Returns true once
+ * everything is out; false if the socket is full or the connection closed. */
+static bool conn_flush(HttpConn *c) {
+    for (;;) {
+        while (c->out_sent < c->out_len) {
+            ssize_t n = write(c->fd, c->out + c->out_sent, c->out_len - c->out_sent);
+            if (n > 0) { c->out_sent += (size_t)n; continue; }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+            conn_close(c);
+            return false;
+        }
+        c->out_len = c->out_sent = 0;
+
+        if (c->file_fd < 0) break;
+        while (c->file_off < c->file_end) {
+            int64_t n = net_sendfile(c->fd, c->file_fd, &c->file_off, (size_t)(c->file_end - c->file_off));
+            if (n == -EAGAIN || n == -EWOULDBLOCK) return false;
+            if (n == -EINTR) continue;
+            if (n <= 0) { conn_close(c); return false; }
+        }
+        close(c->file_fd);
+        c->file_fd = -1;
+        conn_process(c);        /* pipelined requests held back by the file */
+    }
+
+    if (c->close_after || (c->peer_closed && !c->read_blocked)) {
+        conn_close(c);
+        return false;
+    }
+    conn_release_buffers(c);
+    return true;
+}
+
+static void conn_on_ready(void *data, int fd, uint32_t ready) {
+    HttpConn *c = (HttpConn *)data;
+    (void)fd;
+    if ((ready & EVENT_LOOP_READABLE) && !conn_read(c)) return;
+    for (;;) {
+        if (!conn_flush(c)) return;
+        if (!c->read_blocked) return;
+        c->read_blocked = false;
+        if (!conn_read(c)) return;
+    }
+}
+
+static void listener_on_ready(void *data, int fd, uint32_t ready) {
+    HttpWorker *w = (HttpWorker *)data;
+    (void)ready;
+    for (;;) {
+        int cfd = net_accept(fd);
+        if (cfd < 0) break;     /* EAGAIN, or out of fds: retry on next edge */
+        net_set_nodelay(cfd, true);
+        HttpConn *c = conn_new(w, cfd);
+        if (!c) { close(cfd); continue; }
+        if (!event_loop_watch_fd(w->loop, cfd, EVENT_LOOP_READABLE | EVENT_LOOP_WRITABLE, conn_on_ready, c))
+            conn_close(c);
+    }
+}
+
+/* ========== SERVER ========== */
+
+HttpServer *http_server_create(const char *host, int port, size_t workers,
+                               HttpHandler handler, void *user) {
+    if (!handler) return NULL;
+    if (workers == 0) workers = 1;
+
+    HttpServer *server = (HttpServer *)calloc(1, sizeof(HttpServer));
+    if (!server) return NULL;
+    server->handler = handler;
+    server->user = user;
+    server->workers = (HttpWorker *)calloc(workers, sizeof(HttpWorker));
+    if (!server->workers) { free(server); return NULL; }
+
+    int options = workers > 1 ? NET_OPT_REUSEPORT : 0;
+    for (size_t i = 0; i < workers; i++) {
+        HttpWorker *w = &server->workers[i];
+        w->server = server;
+        w->listen_fd = net_listen(host, i == 0 ? port : server->port, NET_DEFAULT_BACKLOG, options);
+        w->loop = event_loop_new();
+        server->worker_count = i + 1;
+        if (w->listen_fd < 0 || !w->loop ||
+            !event_loop_watch_fd(w->loop, w->listen_fd, EVENT_LOOP_READABLE, listener_on_ready, w)) {
+            http_server_free(server);
+            return NULL;
+        }
+        if (i == 0) server->port = net_local_port(w->listen_fd);
+    }
+    return server;
+}
+
+int http_server_port(HttpServer *server) { return server->port; }
+
+static void *worker_main(void *arg) {
+    HttpWorker *w = (HttpWorker *)arg;
+    while (!w->server->stopping) event_loop_run_once(w->loop);
+    return NULL;
+}
+
+void http_server_run(HttpServer *server) {
+    server->stopping = false;
+    for (size_t i = 1; i < server->worker_count; i++) {
+        HttpWorker *w = &server->workers[i];
+        w->thread = thread_create(worker_main, w, NULL);
+        if (w->thread && !thread_start(w->thread)) { free(w->thread); w->thread = NULL; }
+    }
+    worker_main(&server->workers[0]);
+    for (size_t i = 1; i < server->worker_count; i++) {
+        HttpWorker *w = &server->workers[i];
+        if (w->thread) { thread_join(w->thread); free(w->thread); w->thread = NULL; }
+    }
+}
+
+void http_server_stop(HttpServer *server) { server->stopping = true; }
+
+void http_server_free(HttpServer *server) {
+    if (!server) return;
+    for (size_t i = 0; i < server->worker_count; i++) {
+        HttpWorker *w = &server->workers[i];
+        while (w->active) conn_close(w->active);
+        while (w->free_conns) { HttpConn *n = w->free_conns->next; free(w->free_conns); w->free_conns = n; }
+        while (w->free_count) free(w->free_buffers[--w->free_count]);
+        if (w->listen_fd >= 0) {
+            if (w->loop) event_loop_unwatch_fd(w->loop, w->listen_fd);
+            close(w->listen_fd);
+        }
+        if (w->loop) event_loop_free(w->loop);
+    }
+    free(server->workers);
+    free(server);
+}
+
+#else /* _WIN32: the server needs the epoll-backed loop */
+
+HttpServer *http_server_create(const char *host, int port, size_t workers, HttpHandler handler, void *user) { (void)host; (void)port; (void)workers; (void)handler; (void)user; return NULL; }
+int http_server_port(HttpServer *server) { (void)server; return -1; }
+void http_server_run(HttpServer *server) { (void)server; }
+void http_server_stop(HttpServer *server) { (void)server; }
+void http_server_free(HttpServer *server) { (void)server; }
+void http_respond(HttpConn *conn, int status, const char *content_type, const char *body, size_t len) { (void)conn; (void)status; (void)content_type; (void)body; (void)len; }
+void http_respond_chunked_begin(HttpConn *conn, int status, const char *content_type) { (void)conn; (void)status; (void)content_type; }
+void http_respond_chunk(HttpConn *conn, const char *data, size_t len) { (void)conn; (void)data; (void)len; }
+void http_respond_chunked_end(HttpConn *conn) { (void)conn; }
+bool http_respond_file(HttpConn *conn, int status, const char *content_type, const char *path) { (void)conn; (void)status; (void)content_type; (void)path; return false; }
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef RUBOLT_HTTP_SERVER_H
+#define RUBOLT_HTTP_SERVER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "event_loop.h"
+
+/* HTTP/1.1 server on the event loop: one loop per worker thread, each with
+ * its own SO_REUSEPORT listener. Connections are keep-alive by default and
+ * pipelined requests are answered in order with a single write. */
+
+#define HTTP_MAX_HEADERS        32
+#define HTTP_BUFFER_SIZE        (16 * 1024)     /* Pooled per-connection buffer */
+#define HTTP_MAX_REQUEST        (1024 * 1024)   /* Larger requests get 413 */
+#define HTTP_POOL_MAX_BUFFERS   1024            /* Idle buffers kept per worker */
+
+/* Borrowed view into a connection's input buffer (not NUL-terminated) */
+typedef struct HttpSlice {
+    const char *ptr;
+    size_t len;
+} HttpSlice;
+
+typedef struct HttpHeader {
+    HttpSlice name;
+    HttpSlice value;
+} HttpHeader;
+
+/* Parsed request; every slice points into the input buffer and is only
+ * valid during the handler call */
+typedef struct HttpRequest {
+    HttpSlice method;
+    HttpSlice path;             /* Without the query string */
+    HttpSlice query;            /* After '?', empty if none */
+    int minor_version;          /* HTTP/1.<minor> */
+    HttpHeader headers[HTTP_MAX_HEADERS];
+    size_t header_count;
+    HttpSlice body;
+    size_t content_length;
+    bool keep_alive;
+    bool chunked;               /* Transfer-Encoding: chunked (unsupported, 501) */
+} HttpRequest;
+
+/* ========== PARSER ========== */
+
+/* Parse one request from buf[0..len). `scanned` carries how far a previous
+ * call already looked for the end of the headers so partial reads are not
+ * rescanned; pass a pointer to 0 for a fresh buffer.
+ * Returns bytes consumed (> 0), 0 if more data is needed, -1 if malformed. */
+long http_parse_request(const char *buf, size_t len, size_t *scanned, HttpRequest *req);
+
+/* Case-insensitive header lookup */
+const HttpSlice *http_request_header(const HttpRequest *req, const char *name);
+
+/* Compare a slice with a C string */
+bool http_slice_eq(HttpSlice s, const char *str);
+
+/* ========== SERVER ========== */
+
+typedef struct HttpConn HttpConn;
+typedef struct HttpServer HttpServer;
+
+/* Handler: must produce exactly one response per request via http_respond*.
+ * Runs on the worker's loop thread; workers run handlers concurrently. */
+typedef void (*HttpHandler)(HttpConn *conn, const HttpRequest *req, void *user);
+
+/* Bind `workers` listeners to host:port (port 0 = ephemeral). Returns NULL
+ * if the port cannot be bound. */
+HttpServer *http_server_create(const char *host, int port, size_t workers,
+                               HttpHandler handler, void *user);
+
+/* Port actually bound */
+int http_server_port(HttpServer *server);
+
+/* Serve until http_server_stop(); worker 0 runs on the calling thread */
+void http_server_run(HttpServer *server);
+
+/* Ask all workers to stop (safe from any thread or a handler) */
+void http_server_stop(HttpServer *server);
+
+void http_server_free(HttpServer *server);
+
+/* ========== RESPONSES ========== */
+
+/* Complete response with Content-Length */
+void http_respond(HttpConn *conn, int status, const char *content_type,
+                  const char *body, size_t len);
+
+/* Chunked response: begin, any number of chunks, end */
+void http_respond_chunked_begin(HttpConn *conn, int status, const char *content_type);
+void http_respond_chunk(HttpConn *conn, const char *data, size_t len);
+void http_respond_chunked_end(HttpConn *conn);
+
+/* Stream a file with sendfile(2) after the headers. Returns false (and
+ * sends nothing) if the file cannot be opened. */
+bool http_respond_file(HttpConn *conn, int status, const char *content_type, const char *path);
+
+/* Reason phrase for a status code */
+const char *http_status_text(int status);
+
+#endif /* RUBOLT_HTTP_SERVER_H */
@@ -5,10 +5,16 @@
 #include "jit_compiler.h"
 #include "pattern_match.h"
 #include "async.h"
+#include "str_kernels.h"
+#include "collection_objects.h"
+#include "dtoa.h"
+#include "output.h"
+#include "../collections/rb_collections.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 
 // Global interpreter state
 static Interpreter *current_interpreter = NULL;
@@ -19,11 +25,286 @@ Value value_number(double num) {
     return val;
 }
 
+// String values: header + bytes + NUL in one allocation. The caller fills
+// the bytes and then records their encoding with string_scan. Null when
+// out of memory.
+static Value string_alloc(size_t length) {
+    StringHeader *header = length <= SIZE_MAX - sizeof(StringHeader) - 1
+        ? malloc(sizeof(StringHeader) + length + 1) : NULL;
+    if (!header) return value_null();
+    header->refcount = 1;
+    header->length = length;
+    header->char_count = length;
+    header->flags = 0;
+    header->hash_epoch = 0;
+    header->breadcrumbs = NULL;
+    header->hash = 0;
+    char *bytes = (char *)(header + 1);
+    bytes[length] = '\0';
+    Value val = {VALUE_STRING, {.string = bytes}};
+    return val;
+}
+
+// One SIMD pass at creation: validity, ASCII-ness and the code point count
+static void string_scan(Value str) {
+    StringHeader *header = STRING_HEADER(str.as.string);
+    bool ascii;
+    header->flags = 0;
+    header->char_count = header->length;
+    if (str_utf8_validate(str.as.string, header->length, &ascii)) {
+        header->flags = ascii ? STRING_ASCII | STRING_UTF8 : STRING_UTF8;
+        if (!ascii) header->char_count = str_utf8_count(str.as.string, header->length);
+    }
+}
+
+Value value_string_len(const char *data, size_t length) {
+    Value val = string_alloc(length);
+    if (val.type != VALUE_STRING) return val;
+    memcpy(val.as.string, data, length);
+    string_scan(val);
+    return val;
+}
+
 Value value_string(const char *str) {
-    Value val = {VALUE_STRING, {.string = strdup(str)}};
+    return value_string_len(str, strlen(str));
+}
+
+// Preallocated one-character strings for ASCII; never freed
+#define STRING_IMMORTAL ((size_t)-1)
+
+typedef struct {
+    StringHeader header;
+    char bytes[2];
+} AsciiChar;
+
+static AsciiChar ascii_chars[128];
+static pthread_once_t ascii_chars_once = PTHREAD_ONCE_INIT;
+
+static void ascii_chars_init(void) {
+    for (int i = 0; i < 128; i++) {
+        ascii_chars[i].header.refcount = STRING_IMMORTAL;
+        ascii_chars[i].header.length = 1;
+        ascii_chars[i].header.char_count = 1;
+        ascii_chars[i].header.flags = STRING_ASCII | STRING_UTF8;
+        ascii_chars[i].header.breadcrumbs = NULL;
+        ascii_chars[i].bytes[0] = (char)i;
+        ascii_chars[i].bytes[1] = '\0';
+    }
+}
+
+static Value ascii_char(unsigned char c) {
+    pthread_once(&ascii_chars_once, ascii_chars_init);
+    Value val = {VALUE_STRING, {.string = ascii_chars[c].bytes}};
+    return val;
+}
+
+bool value_string_view(Value value, const char **data, size_t *length) {
+    if (value.type == VALUE_STRING) {
+        *data = value.as.string;
+        *length = STRING_HEADER(value.as.string)->length;
+        return true;
+    }
+    if (value.type == VALUE_SLICE) {
+        *data = value.as.slice.parent + value.as.slice.offset;
+        *length = value.as.slice.length;
+        return true;
+    }
+    return false;
+}
+
+// Bytes of the VALUE_STRING that owns a string or slice's storage
+static const char *string_storage(Value value) {
+    return value.type == VALUE_SLICE ? value.as.slice.parent : value.as.string;
+}
+
+// Slices are cut at code point boundaries, so they share their parent's
+// encoding flags
+static unsigned string_flags(Value value) {
+    return STRING_HEADER(string_storage(value))->flags;
+}
+
+// Substring that shares the parent's buffer and keeps it alive. ASCII
+// characters come from the static table; the whole string is returned as is.
+Value value_slice(Value str, size_t offset, size_t length) {
+    const char *data;
+    size_t total;
+    if (!value_string_view(str, &data, &total) || offset > total) return value_null();
+    if (length > total - offset) length = total - offset;
+
+    if (length == 1 && (unsigned char)data[offset] < 128) return ascii_char((unsigned char)data[offset]);
+
+    const char *parent = string_storage(str);
+    size_t base = str.type == VALUE_SLICE ? str.as.slice.offset : 0;
+    StringHeader *header = STRING_HEADER(parent);
+    if (__atomic_load_n(&header->refcount, __ATOMIC_RELAXED) != STRING_IMMORTAL) {
+        __atomic_fetch_add(&header->refcount, 1, __ATOMIC_RELAXED);
+    }
+    if (str.type == VALUE_STRING && offset == 0 && length == total) return str;
+
+    Value val;
+    val.type = VALUE_SLICE;
+    val.as.slice.parent = parent;
+    val.as.slice.offset = base + offset;
+    val.as.slice.length = length;
     return val;
 }
 
+/* ========== CODE POINT INDEXING ========== */
+// ASCII strings and invalid UTF-8 are indexed by byte. Other strings get a
+// breadcrumb table (the byte offset of every 64th code point) the first time
+// they are indexed, so finding code point i costs one table load plus a
+// short forward scan. Threads indexing a shared string at once may each
+// build the table; the first to publish it wins and the rest free theirs.
+
+static bool string_by_chars(const StringHeader *header) {
+    return (header->flags & (STRING_ASCII | STRING_UTF8)) == STRING_UTF8;
+}
+
+static const size_t *string_breadcrumbs(StringHeader *header, const char *bytes) {
+    size_t *crumbs = __atomic_load_n(&header->breadcrumbs, __ATOMIC_ACQUIRE);
+    if (crumbs) return crumbs;
+    size_t count = header->char_count / STRING_BREADCRUMB_STRIDE + 1;
+    crumbs = malloc(count * sizeof(size_t));
+    if (!crumbs) return NULL;
+    crumbs[0] = 0;
+    for (size_t k = 1; k < count; k++) {
+        crumbs[k] = str_utf8_advance(bytes, header->length, crumbs[k - 1], STRING_BREADCRUMB_STRIDE);
+    }
+    size_t *expected = NULL;
+    if (!__atomic_compare_exchange_n(&header->breadcrumbs, &expected, crumbs, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(crumbs);
+        crumbs = expected;
+    }
+    return crumbs;
+}
+
+// Byte offset of code point `index` (<= char_count) in a UTF-8 string
+static size_t string_char_to_byte(StringHeader *header, const char *bytes, size_t index) {
+    if (index >= header->char_count) return header->length;
+    const size_t *crumbs = string_breadcrumbs(header, bytes);
+    size_t from = 0;
+    if (crumbs) {
+        from = crumbs[index / STRING_BREADCRUMB_STRIDE];
+        index %= STRING_BREADCRUMB_STRIDE;
+    }
+    return str_utf8_advance(bytes, header->length, from, index);
+}
+
+// Code point index of a byte offset on a character boundary
+static size_t string_byte_to_char(StringHeader *header, const char *bytes, size_t offset) {
+    if (offset == 0) return 0;
+    if (offset >= header->length) return header->char_count;
+    const size_t *crumbs = string_breadcrumbs(header, bytes);
+    if (!crumbs) return str_utf8_count(bytes, offset);
+    size_t lo = 0, hi = header->char_count / STRING_BREADCRUMB_STRIDE + 1;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (crumbs[mid] <= offset) lo = mid;
+        else hi = mid;
+    }
+    return lo * STRING_BREADCRUMB_STRIDE + str_utf8_count(bytes + crumbs[lo], offset - crumbs[lo]);
+}
+
+// Length in code points; what len() and .length report
+size_t value_string_char_count(Value value) {
+    const char *data;
+    size_t length;
+    if (!value_string_view(value, &data, &length)) return 0;
+    const char *bytes = string_storage(value);
+    StringHeader *header = STRING_HEADER(bytes);
+    if (!string_by_chars(header)) return length;
+    if (value.type == VALUE_STRING) return header->char_count;
+    size_t offset = value.as.slice.offset;
+    return string_byte_to_char(header, bytes, offset + length) - string_byte_to_char(header, bytes, offset);
+}
+
+// Code points [start, start + count) of a string or slice, as a view
+Value value_string_char_slice(Value str, size_t start, size_t count) {
+    const char *data;
+    size_t length;
+    if (!value_string_view(str, &data, &length)) return value_null();
+    const char *bytes = string_storage(str);
+    StringHeader *header = STRING_HEADER(bytes);
+    if (!string_by_chars(header)) return value_slice(str, start, count);
+
+    size_t base = str.type == VALUE_SLICE ? str.as.slice.offset : 0;
+    size_t first = string_byte_to_char(header, bytes, base);
+    size_t limit = str.type == VALUE_SLICE ? string_byte_to_char(header, bytes, base + length) : header->char_count;
+    if (start > limit - first) return value_null();
+    first += start;
+    if (count > limit - first) count = limit - first;
+
+    size_t from = string_char_to_byte(header, bytes, first);
+    size_t to = count <= STRING_BREADCRUMB_STRIDE
+        ? str_utf8_advance(bytes, header->length, from, count)
+        : string_char_to_byte(header, bytes, first + count);
+    return value_slice(str, from - base, to - from);
+}
+
+// The same for natives, which see a VALUE_STRING only as its bytes: the
+// header's counts and breadcrumbs answer without rescanning the string
+size_t string_char_count(const char *str) {
+    StringHeader *header = STRING_HEADER(str);
+    return string_by_chars(header) ? header->char_count : header->length;
+}
+
+size_t string_char_offset(const char *str, size_t index) {
+    StringHeader *header = STRING_HEADER(str);
+    if (!string_by_chars(header)) return index < header->length ? index : header->length;
+    return string_char_to_byte(header, str, index);
+}
+
+size_t string_char_index(const char *str, size_t offset) {
+    StringHeader *header = STRING_HEADER(str);
+    if (!string_by_chars(header)) return offset < header->length ? offset : header->length;
+    return string_byte_to_char(header, str, offset);
+}
+
+// Keyed hash of the bytes before any NUL: rb_hash_string of what the
+// collections see as the key, so it can stand in for rb_value_hash. Whole
+// strings cache it in their header, tagged with the hash epoch so a new
+// seed invalidates it: hashing the same key again is a load, and == can
+// reject strings whose cached hashes differ.
+uint64_t value_string_hash(Value value) {
+    const char *data;
+    size_t length;
+    if (!value_string_view(value, &data, &length)) return 0;
+    if (value.type == VALUE_SLICE) {
+        const char *nul = memchr(data, '\0', length);
+        return rb_hash_bytes(data, nul ? (size_t)(nul - data) : length);
+    }
+    StringHeader *header = STRING_HEADER(value.as.string);
+    unsigned epoch = rb_hash_epoch();
+    if (__atomic_load_n(&header->hash_epoch, __ATOMIC_ACQUIRE) != epoch) {
+        __atomic_store_n(&header->hash, rb_hash_string(data), __ATOMIC_RELAXED);
+        __atomic_store_n(&header->hash_epoch, epoch, __ATOMIC_RELEASE);
+    }
+    return __atomic_load_n(&header->hash, __ATOMIC_RELAXED);
+}
+
+// Only strings hashed in the current epoch; the hash covers the bytes
+// before any NUL, so different hashes still mean different strings
+static bool string_hashes_differ(Value a, Value b) {
+    if (a.type != VALUE_STRING || b.type != VALUE_STRING) return false;
+    StringHeader *ha = STRING_HEADER(a.as.string), *hb = STRING_HEADER(b.as.string);
+    unsigned epoch = rb_hash_epoch();
+    return __atomic_load_n(&ha->hash_epoch, __ATOMIC_ACQUIRE) == epoch &&
+           __atomic_load_n(&hb->hash_epoch, __ATOMIC_ACQUIRE) == epoch &&
+           __atomic_load_n(&ha->hash, __ATOMIC_RELAXED) != __atomic_load_n(&hb->hash, __ATOMIC_RELAXED);
+}
+
+// Drop a reference to string storage (slices release their parent)
+void value_release(Value value) {
+    if (value.type != VALUE_STRING && value.type != VALUE_SLICE) return;
+    StringHeader *header = STRING_HEADER(string_storage(value));
+    if (__atomic_load_n(&header->refcount, __ATOMIC_RELAXED) == STRING_IMMORTAL) return;
+    if (__atomic_sub_fetch(&header->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(header->breadcrumbs);
+        free(header);
+    }
+}
+
 Value value_bool(bool b) {
     Value val = {VALUE_BOOL, {.boolean = b}};
     return val;
@@ -100,57 +381,140 @@ Interpreter *interpreter_create(void) {
     
     // Initialize built-in functions
     environment_define(interp->global_env, "print", value_object(builtin_print));
+    environment_define(interp->global_env, "flush", value_object(builtin_flush));
     environment_define(interp->global_env, "len", value_object(builtin_len));
     environment_define(interp->global_env, "type", value_object(builtin_type));
+    environment_define(interp->global_env, "slice", value_object(builtin_slice));
+    environment_define(interp->global_env, "deque", value_object(builtin_deque));
+    environment_define(interp->global_env, "heap", value_object(builtin_heap));
+    environment_define(interp->global_env, "sorted_set", value_object(builtin_sorted_set));
+    environment_define(interp->global_env, "pvector", value_object(builtin_pvector));
+    environment_define(interp->global_env, "pmap", value_object(builtin_pmap));
     
     current_interpreter = interp;
     return interp;
 }
 
 // Built-in functions
+
+// A line being assembled by print: starts in a stack buffer, moves to the
+// heap if it outgrows it. If the heap cannot grow, what is assembled so far
+// is written out and assembly continues in the buffer it has.
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    char *heap;
+} PrintLine;
+
+static void print_put(PrintLine *line, const char *data, size_t length) {
+    if (line->length + length > line->capacity) {
+        size_t capacity = line->capacity * 2;
+        while (capacity < line->length + length) capacity *= 2;
+        char *grown = realloc(line->heap, capacity);
+        if (!grown) {
+            output_write(line->data, line->length);
+            line->length = 0;
+            if (length > line->capacity) {
+                output_write(data, length);
+                return;
+            }
+        } else {
+            if (!line->heap) memcpy(grown, line->data, line->length);
+            line->heap = line->data = grown;
+            line->capacity = capacity;
+        }
+    }
+    memcpy(line->data + line->length, data, length);
+    line->length += length;
+}
+
+// Formats the whole line in one pass and writes it with one call, so the
+// output buffer (see output.h) decides when it reaches the terminal or file
 Value builtin_print(Environment *env, Value *args, size_t arg_count) {
+    char stack[256];
+    PrintLine line = { stack, 0, sizeof(stack), NULL };
     for (size_t i = 0; i < arg_count; i++) {
         switch (args[i].type) {
-            case VALUE_NUMBER:
-                printf("%.6g", args[i].as.number);
+            case VALUE_NUMBER: {
+                char text[DTOA_BUFFER_SIZE];
+                print_put(&line, text, dtoa_shortest(args[i].as.number, text));
                 break;
+            }
             case VALUE_STRING:
-                printf("%s", args[i].as.string);
+            case VALUE_SLICE: {
+                const char *data;
+                size_t length;
+                value_string_view(args[i], &data, &length);
+                print_put(&line, data, length);
                 break;
+            }
             case VALUE_BOOL:
-                printf("%s", args[i].as.boolean ? "true" : "false");
+                if (args[i].as.boolean) print_put(&line, "true", 4);
+                else print_put(&line, "false", 5);
                 break;
             case VALUE_NULL:
-                printf("null");
+                print_put(&line, "null", 4);
                 break;
             default:
-                printf("[object]");
+                print_put(&line, "[object]", 8);
                 break;
         }
-        if (i < arg_count - 1) printf(" ");
+        if (i < arg_count - 1) print_put(&line, " ", 1);
     }
-    printf("\n");
+    print_put(&line, "\n", 1);
+    output_write(line.data, line.length);
+    free(line.heap);
+    return value_null();
+}
+
+// flush() -> null; writes out anything print has buffered
+Value builtin_flush(Environment *env, Value *args, size_t arg_count) {
+    output_flush();
     return value_null();
 }
 
 Value builtin_len(Environment *env, Value *args, size_t arg_count) {
     if (arg_count != 1) return value_null();
     
-    if (args[0].type == VALUE_STRING) {
-        return value_number(strlen(args[0].as.string));
+    if (args[0].type == VALUE_STRING || args[0].type == VALUE_SLICE) {
+        return value_number((double)value_string_char_count(args[0]));
+    }
+    if (args[0].type == VALUE_COLLECTION) {
+        return value_number((double)collection_length(args[0]));
     }
     
     return value_null();
 }
 
+// slice(s, start, end?) -> code points [start, end); negative indexes count
+// from the end. Shares the source string's buffer.
+Value builtin_slice(Environment *env, Value *args, size_t arg_count) {
+    if (arg_count < 2 || arg_count > 3 || args[1].type != VALUE_NUMBER) return value_null();
+    if (args[0].type != VALUE_STRING && args[0].type != VALUE_SLICE) return value_null();
+    
+    double length = (double)value_string_char_count(args[0]);
+    double start = args[1].as.number;
+    double end = arg_count == 3 && args[2].type == VALUE_NUMBER ? args[2].as.number : length;
+    if (start < 0) start += length;
+    if (end < 0) end += length;
+    if (start < 0) start = 0;
+    if (end > length) end = length;
+    if (start > end) start = end;
+    
+    return value_string_char_slice(args[0], (size_t)start, (size_t)(end - start));
+}
+
 Value builtin_type(Environment *env, Value *args, size_t arg_count) {
     if (arg_count != 1) return value_null();
     
     switch (args[0].type) {
         case VALUE_NUMBER: return value_string("number");
-        case VALUE_STRING: return value_string("string");
+        case VALUE_STRING:
+        case VALUE_SLICE: return value_string("string");
         case VALUE_BOOL: return value_string("bool");
         case VALUE_NULL: return value_string("null");
+        case VALUE_COLLECTION: return value_string(collection_type_name(args[0]));
         default: return value_string("object");
     }
 }
@@ -251,18 +615,28 @@ Value evaluate_binary(Interpreter *interp, BinaryExpr *expr) {
         if (strcmp(expr->operator, "!=") == 0) return value_bool(a != b);
     }
     
-    if (left.type == VALUE_STRING && right.type == VALUE_STRING) {
+    const char *ldata, *rdata;
+    size_t llen, rlen;
+    if (value_string_view(left, &ldata, &llen) && value_string_view(right, &rdata, &rlen)) {
         if (strcmp(expr->operator, "+") == 0) {
-            char *result = malloc(strlen(left.as.string) + strlen(right.as.string) + 1);
-            strcpy(result, left.as.string);
-            strcat(result, right.as.string);
-            return value_string(result);
+            Value result = string_alloc(llen + rlen);
+            if (result.type != VALUE_STRING) return result;
+            memcpy(result.as.string, ldata, llen);
+            memcpy(result.as.string + llen, rdata, rlen);
+            if (string_flags(left) & string_flags(right) & STRING_ASCII) {
+                STRING_HEADER(result.as.string)->flags = STRING_ASCII | STRING_UTF8;
+            } else {
+                string_scan(result);
+            }
+            return result;
         }
         if (strcmp(expr->operator, "==") == 0) {
-            return value_bool(strcmp(left.as.string, right.as.string) == 0);
+            return value_bool(llen == rlen && !string_hashes_differ(left, right) &&
+                              memcmp(ldata, rdata, llen) == 0);
         }
         if (strcmp(expr->operator, "!=") == 0) {
-            return value_bool(strcmp(left.as.string, right.as.string) != 0);
+            return value_bool(llen != rlen || string_hashes_differ(left, right) ||
+                              memcmp(ldata, rdata, llen) != 0);
         }
     }
     
@@ -289,8 +663,30 @@ Value evaluate_unary(Interpreter *interp, UnaryExpr *expr) {
     return value_null();
 }
 
+// Property of an already evaluated object
+static Value member_of(Value object, const char *property) {
+    // Handle built-in object methods
+    if ((object.type == VALUE_STRING || object.type == VALUE_SLICE) && strcmp(property, "length") == 0) {
+        return value_number((double)value_string_char_count(object));
+    }
+    if (object.type == VALUE_COLLECTION && strcmp(property, "length") == 0) {
+        return value_number((double)collection_length(object));
+    }
+    
+    return value_null();
+}
+
 Value evaluate_call(Interpreter *interp, CallExpr *expr) {
-    Value callee = evaluate_expression(interp, expr->callee);
+    // Method call on a collection: obj.name(args)
+    Value receiver = value_null();
+    Value callee = value_null();
+    if (expr->callee->type == EXPR_MEMBER) {
+        // Evaluate the object once; the member is looked up on its value
+        receiver = evaluate_expression(interp, expr->callee->as.member.object);
+        if (receiver.type != VALUE_COLLECTION) callee = member_of(receiver, expr->callee->as.member.property);
+    } else {
+        callee = evaluate_expression(interp, expr->callee);
+    }
     
     // Evaluate arguments
     Value *args = malloc(sizeof(Value) * expr->arg_count);
@@ -300,18 +696,34 @@ Value evaluate_call(Interpreter *interp, CallExpr *expr) {
     
     Value result = value_null();
     
-    if (callee.type == VALUE_FUNCTION) {
+    if (receiver.type == VALUE_COLLECTION) {
+        collection_call_method(receiver, expr->callee->as.member.property, args, expr->arg_count, &result);
+    } else if (callee.type == VALUE_FUNCTION) {
         result = call_nested_function(interp, &callee.as.function, args, expr->arg_count);
     } else if (callee.type == VALUE_OBJECT) {
         // Built-in function call
         if (callee.as.object == builtin_print) {
             result = builtin_print(interp->current_env, args, expr->arg_count);
+        } else if (callee.as.object == builtin_flush) {
+            result = builtin_flush(interp->current_env, args, expr->arg_count);
         } else if (callee.as.object == builtin_len) {
             result = builtin_len(interp->current_env, args, expr->arg_count);
         } else if (callee.as.object == builtin_type) {
             result = builtin_type(interp->current_env, args, expr->arg_count);
         } else if (callee.as.object == builtin_range) {
             result = builtin_range(interp->current_env, args, expr->arg_count);
+        } else if (callee.as.object == builtin_slice) {
+            result = builtin_slice(interp->current_env, args, expr->arg_count);
+        } else if (callee.as.object == builtin_deque) {
+            result = builtin_deque(interp->current_env, args, expr->arg_count);
+        } else if (callee.as.object == builtin_heap) {
+            result = builtin_heap(interp->current_env, args, expr->arg_count);
+        } else if (callee.as.object == builtin_sorted_set) {
+            result = builtin_sorted_set(interp->current_env, args, expr->arg_count);
+        } else if (callee.as.object == builtin_pvector) {
+            result = builtin_pvector(interp->current_env, args, expr->arg_count);
+        } else if (callee.as.object == builtin_pmap) {
+            result = builtin_pmap(interp->current_env, args, expr->arg_count);
         }
     }
     
@@ -320,31 +732,19 @@ Value evaluate_call(Interpreter *interp, CallExpr *expr) {
 }
 
 Value evaluate_member(Interpreter *interp, MemberExpr *expr) {
-    Value object = evaluate_expression(interp, expr->object);
-    
-    // Handle built-in object methods
-    if (object.type == VALUE_STRING && strcmp(expr->property, "length") == 0) {
-        return value_number(strlen(object.as.string));
-    }
-    
-    return value_null();
+    return member_of(evaluate_expression(interp, expr->object), expr->property);
 }
 
 Value evaluate_index(Interpreter *interp, IndexExpr *expr) {
     Value object = evaluate_expression(interp, expr->object);
     Value index = evaluate_expression(interp, expr->index);
     
-    // Handle string indexing
-    if (object.type == VALUE_STRING && index.type == VALUE_NUMBER) {
-        int idx = (int)index.as.number;
-        const char *str = object.as.string;
-        int len = strlen(str);
+    // Handle string indexing: a view of one code point, no allocation
+    if ((object.type == VALUE_STRING || object.type == VALUE_SLICE) && index.type == VALUE_NUMBER) {
+        double idx = index.as.number;
         
-        if (idx >= 0 && idx < len) {
-            char *result = malloc(2);
-            result[0] = str[idx];
-            result[1] = '\0';
-            return value_string(result);
+        if (idx >= 0 && idx < (double)value_string_char_count(object)) {
+            return value_string_char_slice(object, (size_t)idx, 1);
         }
     }
     
@@ -573,6 +973,27 @@ Value execute_for_in(Interpreter *interp, ForInStmt *stmt) {
         for (int i = range->start; i < range->end; i += range->step) {
             environment_define(interp->current_env, stmt->variable, value_number(i));
             
+            for (size_t j = 0; j < stmt->body_count; j++) {
+                result = execute_statement(interp, stmt->body[j]);
+                
+                if (interp->return_flag) goto cleanup;
+                if (interp->break_flag) {
+                    interp->break_flag = false;
+                    goto cleanup;
+                }
+                if (interp->continue_flag) {
+                    interp->continue_flag = false;
+                    break;
+                }
+            }
+        }
+    } else if (iterable.type == VALUE_COLLECTION) {
+        CollectionIter it;
+        Value element;
+        collection_iter_init(&it, iterable);
+        while (collection_iter_next(&it, &element)) {
+            environment_define(interp->current_env, stmt->variable, element);
+            
             for (size_t j = 0; j < stmt->body_count; j++) {
                 result = execute_statement(interp, stmt->body[j]);
                 
@@ -690,12 +1111,20 @@ void value_print(Value value) {
         case VALUE_BOOL:
             printf("%s", value.as.boolean ? "true" : "false");
             break;
-        case VALUE_NUMBER:
-            printf("%g", value.as.number);
+        case VALUE_NUMBER: {
+            char text[DTOA_BUFFER_SIZE];
+            dtoa_shortest(value.as.number, text);
+            fputs(text, stdout);
             break;
+        }
         case VALUE_STRING:
-            printf("%s", value.as.string);
+        case VALUE_SLICE: {
+            const char *data;
+            size_t length;
+            value_string_view(value, &data, &length);
+            fwrite(data, 1, length, stdout);
             break;
+        }
         case VALUE_ARRAY:
             printf("[");
             for (size_t i = 0; i < value.as.array.count; i++) {
@@ -707,6 +1136,9 @@ void value_print(Value value) {
         case VALUE_FUNCTION:
             printf("<function>");
             break;
+        case VALUE_COLLECTION:
+            printf("<%s of %zu>", collection_type_name(value), collection_length(value));
+            break;
         default:
             printf("<object>");
             break;
@@ -777,9 +1209,13 @@ bool is_truthy(Value value) {
         case VALUE_NUMBER:
             return value.as.number != 0.0;
         case VALUE_STRING:
-            return strlen(value.as.string) > 0;
+            return STRING_HEADER(value.as.string)->length > 0;
+        case VALUE_SLICE:
+            return value.as.slice.length > 0;
         case VALUE_ARRAY:
             return value.as.array.count > 0;
+        case VALUE_COLLECTION:
+            return collection_length(value) > 0;
         default:
             return true;
     }
@@ -3,6 +3,7 @@
 
 #include "ast.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <setjmp.h>
 
 #define MAX_VARS 256
@@ -17,15 +18,42 @@ typedef enum {
     VALUE_STRING,
     VALUE_OBJECT,
     VALUE_ARRAY,
-    VALUE_FUNCTION
+    VALUE_FUNCTION,
+    VALUE_SLICE,
+    VALUE_COLLECTION        // as.object is a CollectionObject (collection_objects.h)
 } ValueType;
 
+// String storage: every VALUE_STRING's bytes are preceded by this header,
+// so substrings can share the parent buffer instead of copying it.
+// len, indexing and slice() count code points; the encoding facts they
+// need are computed once when the string is created.
+#define STRING_ASCII  0x1       // Every byte < 0x80: code point i is byte i
+#define STRING_UTF8   0x2       // Well-formed UTF-8 (otherwise indexed by byte)
+#define STRING_BREADCRUMB_STRIDE 64
+
+typedef struct StringHeader {
+    size_t refcount;        // References held by slices (plus the owner)
+    size_t length;          // Bytes
+    size_t char_count;      // Code points (== length unless non-ASCII UTF-8)
+    unsigned flags;
+    unsigned hash_epoch;    // rb_hash_epoch() hash was computed in; 0 = none
+    size_t* breadcrumbs;    // Byte offset of every 64th code point, built on first use
+    uint64_t hash;          // Cached value_string_hash
+} StringHeader;
+
+#define STRING_HEADER(str) ((StringHeader*)((char*)(str) - sizeof(StringHeader)))
+
 typedef struct {
     ValueType type;
     union {
         bool boolean;
         double number;
         char* string;
+        struct {
+            const char* parent;     // as.string of the VALUE_STRING it views
+            size_t offset;
+            size_t length;
+        } slice;
         void* object;
         struct {
             struct Value* elements;
@@ -99,6 +127,18 @@ typedef struct Exception {
 // Value operations
 Value value_number(double num);
 Value value_string(const char* str);
+Value value_string_len(const char* data, size_t length);
+Value value_slice(Value str, size_t offset, size_t length);
+bool value_string_view(Value value, const char** data, size_t* length);
+void value_release(Value value);
+size_t value_string_char_count(Value value);
+Value value_string_char_slice(Value str, size_t start, size_t count);
+// Code point count and index <-> byte offset conversions on a VALUE_STRING's
+// bytes (as.string), for natives that are handed only the pointer
+size_t string_char_count(const char* str);
+size_t string_char_offset(const char* str, size_t index);
+size_t string_char_index(const char* str, size_t offset);
+uint64_t value_string_hash(Value value);
 Value value_bool(bool b);
 Value value_null(void);
 Value value_object(void* obj);
@@ -146,9 +186,11 @@ Value execute_continue(Interpreter* interp, ContinueStmt* stmt);
 
 // Built-in functions
 Value builtin_print(Environment* env, Value* args, size_t arg_count);
+Value builtin_flush(Environment* env, Value* args, size_t arg_count);
 Value builtin_len(Environment* env, Value* args, size_t arg_count);
 Value builtin_type(Environment* env, Value* args, size_t arg_count);
 Value builtin_range(Environment* env, Value* args, size_t arg_count);
+Value builtin_slice(Environment* env, Value* args, size_t arg_count);
 
 // Nested function support
 Value call_nested_function(Interpreter* interp, Function* func, Value* args, size_t arg_count);
@@ -0,0 +1,1233 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L     /* pread, pwrite, fdatasync under -std=c11 */
+#endif
+
+#include "kv_store.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+/* The store needs a shared mapping kept coherent with pwrite; on Windows
+ * kv_open fails and nothing else can be reached. */
+KvStore *kv_open(const char *path, const KvOptions *options) { (void)path; (void)options; return NULL; }
+void kv_close(KvStore *store) { (void)store; }
+bool kv_sync(KvStore *store) { (void)store; return false; }
+void kv_stat(KvStore *store, KvStat *stat) { (void)store; memset(stat, 0, sizeof(*stat)); }
+KvTxn *kv_begin(KvStore *store, bool write) { (void)store; (void)write; return NULL; }
+bool kv_commit(KvTxn *txn) { (void)txn; return false; }
+void kv_abort(KvTxn *txn) { (void)txn; }
+bool kv_txn_failed(const KvTxn *txn) { (void)txn; return true; }
+bool kv_get(KvTxn *txn, const void *key, size_t key_length, KvView *value) {
+    (void)txn; (void)key; (void)key_length; (void)value;
+    return false;
+}
+bool kv_put(KvTxn *txn, const void *key, size_t key_length, const void *value, size_t value_length) {
+    (void)txn; (void)key; (void)key_length; (void)value; (void)value_length;
+    return false;
+}
+bool kv_delete(KvTxn *txn, const void *key, size_t key_length) { (void)txn; (void)key; (void)key_length; return false; }
+KvCursor *kv_cursor_open(KvTxn *txn, const void *start, size_t start_length) {
+    (void)txn; (void)start; (void)start_length;
+    return NULL;
+}
+bool kv_cursor_next(KvCursor *cursor, KvView *key, KvView *value) {
+    (void)cursor; (void)key; (void)value;
+    return false;
+}
+void kv_cursor_close(KvCursor *cursor) { (void)cursor; }
+
+#else
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PAGE            KV_PAGE_SIZE
+#define MAX_DEPTH       32
+#define META_MAGIC      0x564b4252u     /* "RBKV" */
+#define META_VERSION    1
+
+/* Page kinds */
+#define P_BRANCH        1
+#define P_LEAF          2
+#define P_FREELIST      4
+
+/* Leaf node flag: the value is on overflow pages */
+#define N_BIG           1
+
+/* Largest node kept on a leaf, so a split always leaves both halves room */
+#define NODE_MAX        ((PAGE - 16) / 4 - 2)
+#define LEAF_HEADER     8
+#define BRANCH_HEADER   16
+#define FREELIST_PER_PAGE ((PAGE - 24) / 8)
+
+typedef uint64_t pgno_t;
+
+/* ========== PAGES ==========
+ *
+ * Branch and leaf pages are slotted: a header, then the node offsets in
+ * key order growing up, and the nodes themselves packed at the end of the
+ * page growing down. Every change rebuilds the page from its node spans,
+ * which a copy-on-write tree does anyway.
+ *
+ *   leaf node    u16 key length, u16 flags, u32 value length, key, then
+ *                the value or (N_BIG) the u64 first overflow page
+ *   branch node  u16 key length, u16 0, u32 0, u64 child, key; the first
+ *                node's key is ignored (it covers everything below the
+ *                second)
+ *
+ * Overflow runs are raw data on consecutive pages, so a large value is
+ * still one contiguous view of the map. */
+
+typedef struct {
+    uint64_t pgno;
+    uint16_t flags;
+    uint16_t count;
+    uint16_t upper;             /* nodes occupy [upper, PAGE) */
+    uint16_t spare;
+} PageHeader;
+
+#define OFFSETS(page) ((uint16_t *)((char *)(page) + sizeof(PageHeader)))
+
+static inline uint16_t get16(const char *p) { uint16_t v; memcpy(&v, p, 2); return v; }
+static inline uint32_t get32(const char *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t get64(const char *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline void put16(char *p, uint16_t v) { memcpy(p, &v, 2); }
+static inline void put32(char *p, uint32_t v) { memcpy(p, &v, 4); }
+static inline void put64(char *p, uint64_t v) { memcpy(p, &v, 8); }
+
+static inline const char *node_at(const PageHeader *page, unsigned i) {
+    return (const char *)page + OFFSETS(page)[i];
+}
+
+static inline const char *node_key(const PageHeader *page, const char *node, size_t *length) {
+    *length = get16(node);
+    return node + (page->flags & P_LEAF ? LEAF_HEADER : BRANCH_HEADER);
+}
+
+static inline size_t node_size(const PageHeader *page, const char *node) {
+    if (page->flags & P_BRANCH) return BRANCH_HEADER + get16(node);
+    return LEAF_HEADER + get16(node) + (get16(node + 2) & N_BIG ? 8 : get32(node + 4));
+}
+
+static inline pgno_t branch_child(const char *node) {
+    return get64(node + 8);
+}
+
+static int key_compare(const char *a, size_t a_length, const void *b, size_t b_length) {
+    int c = memcmp(a, b, a_length < b_length ? a_length : b_length);
+    if (c) return c;
+    return a_length < b_length ? -1 : a_length > b_length;
+}
+
+/* First node >= key; *exact if it is equal */
+static unsigned leaf_search(const PageHeader *page, const void *key, size_t length, bool *exact) {
+    unsigned lo = 0, hi = page->count;
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        size_t k;
+        const char *node_k = node_key(page, node_at(page, mid), &k);
+        if (key_compare(node_k, k, key, length) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    *exact = false;
+    if (lo < page->count) {
+        size_t k;
+        const char *node_k = node_key(page, node_at(page, lo), &k);
+        *exact = key_compare(node_k, k, key, length) == 0;
+    }
+    return lo;
+}
+
+/* Last node whose key is <= key; node 0 always qualifies */
+static unsigned branch_search(const PageHeader *page, const void *key, size_t length) {
+    unsigned lo = 1, hi = page->count;
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        size_t k;
+        const char *node_k = node_key(page, node_at(page, mid), &k);
+        if (key_compare(node_k, k, key, length) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo - 1;
+}
+
+/* A node's bytes, wherever they currently live */
+typedef struct {
+    const char *data;
+    size_t length;
+} Span;
+
+static size_t spans_bytes(const Span *spans, size_t n) {
+    size_t total = sizeof(PageHeader);
+    for (size_t i = 0; i < n; i++) total += spans[i].length + 2;
+    return total;
+}
+
+static void page_build(char *out, pgno_t pgno, uint16_t flags, const Span *spans, size_t n) {
+    PageHeader *page = (PageHeader *)out;
+    page->pgno = pgno;
+    page->flags = flags;
+    page->count = (uint16_t)n;
+    page->spare = 0;
+    size_t upper = PAGE;
+    for (size_t i = 0; i < n; i++) {
+        upper -= spans[i].length;
+        memcpy(out + upper, spans[i].data, spans[i].length);
+        OFFSETS(page)[i] = (uint16_t)upper;
+    }
+    page->upper = (uint16_t)upper;
+    memset(out + sizeof(PageHeader) + 2 * n, 0, upper - sizeof(PageHeader) - 2 * n);
+}
+
+/* ========== META ========== */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t page_size;
+    uint32_t depth;
+    uint64_t txn;
+    uint64_t root;              /* 0 = empty tree */
+    uint64_t last_pgno;         /* pages in use; the next fresh page */
+    uint64_t freelist;          /* first free-list page, 0 if none */
+    uint64_t entries;
+    uint64_t checksum;
+} Meta;
+
+static uint64_t meta_checksum(const Meta *meta) {
+    const unsigned char *p = (const unsigned char *)meta;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < offsetof(Meta, checksum); i++) h = (h ^ p[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+static bool meta_valid(const Meta *meta) {
+    return meta->magic == META_MAGIC && meta->version == META_VERSION && meta->page_size == PAGE &&
+           meta->checksum == meta_checksum(meta);
+}
+
+/* ========== STORE ========== */
+
+typedef struct {
+    pgno_t *items;
+    size_t count;
+    size_t capacity;
+} PgnoList;
+
+static bool list_push(PgnoList *list, pgno_t pgno) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        pgno_t *items = realloc(list->items, sizeof(pgno_t) * capacity);
+        if (!items) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = pgno;
+    return true;
+}
+
+/* Set of page numbers; 0 (a meta page) marks an empty slot */
+typedef struct {
+    pgno_t *slots;
+    size_t count;
+    size_t capacity;
+} PgnoSet;
+
+static inline size_t set_slot(pgno_t pgno, size_t capacity) {
+    return (size_t)(pgno * 0x9e3779b97f4a7c15ULL >> 20) & (capacity - 1);
+}
+
+static bool set_has(const PgnoSet *set, pgno_t pgno) {
+    if (!set->count) return false;
+    for (size_t i = set_slot(pgno, set->capacity);; i = (i + 1) & (set->capacity - 1)) {
+        if (set->slots[i] == pgno) return true;
+        if (!set->slots[i]) return false;
+    }
+}
+
+static bool set_add(PgnoSet *set, pgno_t pgno) {
+    if (2 * (set->count + 1) > set->capacity) {
+        size_t capacity = set->capacity ? set->capacity * 2 : 1024;
+        pgno_t *slots = calloc(capacity, sizeof(pgno_t));
+        if (!slots) return false;
+        for (size_t i = 0; i < set->capacity; i++) {
+            if (!set->slots[i]) continue;
+            size_t j = set_slot(set->slots[i], capacity);
+            while (slots[j]) j = (j + 1) & (capacity - 1);
+            slots[j] = set->slots[i];
+        }
+        free(set->slots);
+        set->slots = slots;
+        set->capacity = capacity;
+    }
+    size_t i = set_slot(pgno, set->capacity);
+    while (set->slots[i] && set->slots[i] != pgno) i = (i + 1) & (set->capacity - 1);
+    if (!set->slots[i]) {
+        set->slots[i] = pgno;
+        set->count++;
+    }
+    return true;
+}
+
+static void set_clear(PgnoSet *set) {
+    if (set->count) memset(set->slots, 0, sizeof(pgno_t) * set->capacity);
+    set->count = 0;
+}
+
+/* A page freed by commit `txn`: still part of every snapshot before it,
+ * and of the durable meta unless it was written after that (unsynced) */
+typedef struct {
+    uint64_t txn;
+    pgno_t pgno;
+    bool unsynced;
+} PendingPage;
+
+struct KvStore {
+    KvStore *next;              /* process-wide list, for sharing by path */
+    dev_t dev;
+    ino_t ino;
+    int refs;
+
+    int fd;
+    const char *map;
+    size_t map_size;
+    unsigned sync_every;
+
+    pthread_mutex_t write_lock; /* held for a whole write transaction */
+    pthread_mutex_t lock;       /* meta, readers, stat_free */
+    Meta meta;                  /* latest commit */
+    uint64_t *readers;          /* snapshot txn of each open reader */
+    size_t reader_count;
+    size_t reader_capacity;
+    uint64_t stat_free;
+
+    /* Writer state, under write_lock */
+    PgnoList free;              /* reusable now */
+    PendingPage *pending;
+    size_t pending_count;
+    size_t pending_capacity;
+    PgnoList freelist_pages;    /* pages of the persisted free list */
+    PgnoSet unsynced_pages;     /* written since the durable meta */
+    uint64_t durable_txn;
+    int durable_slot;           /* meta page holding durable_txn */
+    unsigned unsynced;
+};
+
+/* One page (or overflow run) written by the current write transaction */
+typedef struct {
+    pgno_t pgno;                /* 0 = empty slot */
+    size_t pages;
+    char *data;
+} Dirty;
+
+struct KvTxn {
+    KvStore *store;
+    bool write;
+    bool failed;
+    Meta meta;                  /* snapshot; the write transaction edits it */
+
+    Dirty *dirty;               /* open addressing by pgno */
+    size_t dirty_count;
+    size_t dirty_capacity;
+    PgnoList freed;             /* snapshot pages this transaction replaced */
+    PgnoList reused;            /* taken from store->free */
+    PgnoList spare;             /* allocated and freed again here */
+    char *scratch;              /* 2 pages for rebuilds, a node, a key */
+};
+
+#define SCRATCH_LEFT(txn)  ((txn)->scratch)
+#define SCRATCH_RIGHT(txn) ((txn)->scratch + PAGE)
+#define SCRATCH_NODE(txn)  ((txn)->scratch + 2 * PAGE)
+#define SCRATCH_KEY(txn)   ((txn)->scratch + 3 * PAGE)
+
+static pthread_mutex_t g_stores_lock = PTHREAD_MUTEX_INITIALIZER;
+static KvStore *g_stores = NULL;
+
+/* ========== DIRTY PAGES ========== */
+
+static Dirty *dirty_find(const KvTxn *txn, pgno_t pgno) {
+    if (!txn->dirty_count) return NULL;
+    for (size_t i = set_slot(pgno, txn->dirty_capacity);; i = (i + 1) & (txn->dirty_capacity - 1)) {
+        if (txn->dirty[i].pgno == pgno) return &txn->dirty[i];
+        if (!txn->dirty[i].pgno) return NULL;
+    }
+}
+
+static bool dirty_insert(KvTxn *txn, pgno_t pgno, size_t pages, char *data) {
+    if (2 * (txn->dirty_count + 1) > txn->dirty_capacity) {
+        size_t capacity = txn->dirty_capacity ? txn->dirty_capacity * 2 : 64;
+        Dirty *table = calloc(capacity, sizeof(Dirty));
+        if (!table) return false;
+        for (size_t i = 0; i < txn->dirty_capacity; i++) {
+            if (!txn->dirty[i].pgno) continue;
+            size_t j = set_slot(txn->dirty[i].pgno, capacity);
+            while (table[j].pgno) j = (j + 1) & (capacity - 1);
+            table[j] = txn->dirty[i];
+        }
+        free(txn->dirty);
+        txn->dirty = table;
+        txn->dirty_capacity = capacity;
+    }
+    size_t i = set_slot(pgno, txn->dirty_capacity);
+    while (txn->dirty[i].pgno) i = (i + 1) & (txn->dirty_capacity - 1);
+    txn->dirty[i] = (Dirty){ pgno, pages, data };
+    txn->dirty_count++;
+    return true;
+}
+
+/* Remove a slot, shifting later members of its probe run back */
+static void dirty_remove(KvTxn *txn, Dirty *slot) {
+    size_t mask = txn->dirty_capacity - 1;
+    size_t i = (size_t)(slot - txn->dirty);
+    free(slot->data);
+    for (size_t j = (i + 1) & mask; txn->dirty[j].pgno; j = (j + 1) & mask) {
+        size_t home = set_slot(txn->dirty[j].pgno, txn->dirty_capacity);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            txn->dirty[i] = txn->dirty[j];
+            i = j;
+        }
+    }
+    txn->dirty[i].pgno = 0;
+    txn->dirty_count--;
+}
+
+static void dirty_clear(KvTxn *txn) {
+    for (size_t i = 0; i < txn->dirty_capacity; i++) {
+        if (txn->dirty[i].pgno) free(txn->dirty[i].data);
+    }
+    free(txn->dirty);
+    txn->dirty = NULL;
+    txn->dirty_count = txn->dirty_capacity = 0;
+}
+
+/* ========== PAGE ACCESS ========== */
+
+static inline const PageHeader *page_get(const KvTxn *txn, pgno_t pgno) {
+    if (txn->write) {
+        const Dirty *d = dirty_find(txn, pgno);
+        if (d) return (const PageHeader *)d->data;
+    }
+    return (const PageHeader *)(txn->store->map + pgno * PAGE);
+}
+
+static bool txn_fail(KvTxn *txn) {
+    txn->failed = true;
+    return false;
+}
+
+/* A fresh pgno for one page: pages freed earlier in this transaction, then
+ * the store's free list, then the end of the file */
+static bool alloc_pgno(KvTxn *txn, pgno_t *pgno) {
+    KvStore *store = txn->store;
+    if (txn->spare.count) {
+        *pgno = txn->spare.items[--txn->spare.count];
+        return true;
+    }
+    if (store->free.count) {
+        *pgno = store->free.items[--store->free.count];
+        if (!list_push(&txn->reused, *pgno)) {
+            store->free.count++;
+            return txn_fail(txn);
+        }
+        return true;
+    }
+    if ((txn->meta.last_pgno + 1) * PAGE > store->map_size) return txn_fail(txn);
+    *pgno = txn->meta.last_pgno++;
+    return true;
+}
+
+static char *new_page(KvTxn *txn, pgno_t *pgno) {
+    char *data = malloc(PAGE);
+    if (!data) {
+        txn_fail(txn);
+        return NULL;
+    }
+    if (!alloc_pgno(txn, pgno) || !dirty_insert(txn, *pgno, 1, data)) {
+        free(data);
+        txn_fail(txn);
+        return NULL;
+    }
+    return data;
+}
+
+/* Release `pages` pages at pgno. Pages written by this transaction can be
+ * reused by it at once; snapshot pages wait for commit. */
+static void free_pages(KvTxn *txn, pgno_t pgno, size_t pages) {
+    Dirty *d = dirty_find(txn, pgno);
+    if (d) dirty_remove(txn, d);
+    for (size_t i = 0; i < pages; i++) {
+        if (!list_push(d ? &txn->spare : &txn->freed, pgno + i)) txn_fail(txn);
+    }
+}
+
+/* The writable copy of a page, copying it on first touch */
+static char *touch(KvTxn *txn, pgno_t *pgno) {
+    Dirty *d = dirty_find(txn, *pgno);
+    if (d) return d->data;
+    pgno_t old = *pgno;
+    char *data = new_page(txn, pgno);
+    if (!data) return NULL;
+    memcpy(data, txn->store->map + old * PAGE, PAGE);
+    ((PageHeader *)data)->pgno = *pgno;
+    if (!list_push(&txn->freed, old)) txn_fail(txn);
+    return data;
+}
+
+/* ========== SEARCH ========== */
+
+typedef struct {
+    pgno_t pgno[MAX_DEPTH];
+    unsigned index[MAX_DEPTH];  /* child taken (branch) or position (leaf) */
+    unsigned depth;
+} Path;
+
+/* Walk from the root to the leaf for key; false for an empty tree */
+static bool find_path(const KvTxn *txn, const void *key, size_t length, Path *path, bool *exact) {
+    *exact = false;
+    path->depth = 0;
+    pgno_t pgno = txn->meta.root;
+    if (!pgno) return false;
+    for (;;) {
+        const PageHeader *page = page_get(txn, pgno);
+        unsigned level = path->depth++;
+        path->pgno[level] = pgno;
+        if (page->flags & P_LEAF) {
+            path->index[level] = leaf_search(page, key, length, exact);
+            return true;
+        }
+        unsigned i = branch_search(page, key, length);
+        path->index[level] = i;
+        pgno = branch_child(node_at(page, i));
+        if (path->depth == MAX_DEPTH) return false;
+    }
+}
+
+static void leaf_value(const KvTxn *txn, const char *node, KvView *value) {
+    size_t key_length = get16(node);
+    value->length = get32(node + 4);
+    if (get16(node + 2) & N_BIG) value->data = page_get(txn, get64(node + LEAF_HEADER + key_length));
+    else value->data = node + LEAF_HEADER + key_length;
+}
+
+bool kv_get(KvTxn *txn, const void *key, size_t key_length, KvView *value) {
+    Path path;
+    bool exact;
+    if (!find_path(txn, key, key_length, &path, &exact) || !exact) return false;
+    const PageHeader *leaf = page_get(txn, path.pgno[path.depth - 1]);
+    leaf_value(txn, node_at(leaf, path.index[path.depth - 1]), value);
+    return true;
+}
+
+/* ========== UPDATES ========== */
+
+/* Make every page on the path writable, repointing each parent at its
+ * child's new copy */
+static bool touch_path(KvTxn *txn, Path *path) {
+    for (unsigned level = 0; level < path->depth; level++) {
+        pgno_t before = path->pgno[level];
+        if (!touch(txn, &path->pgno[level])) return false;
+        if (path->pgno[level] == before) continue;
+        if (level == 0) {
+            txn->meta.root = path->pgno[0];
+        } else {
+            PageHeader *parent = (PageHeader *)dirty_find(txn, path->pgno[level - 1])->data;
+            put64((char *)node_at(parent, path->index[level - 1]) + 8, path->pgno[level]);
+        }
+    }
+    return true;
+}
+
+static size_t page_spans(const PageHeader *page, Span *spans) {
+    for (unsigned i = 0; i < page->count; i++) {
+        spans[i].data = node_at(page, i);
+        spans[i].length = node_size(page, spans[i].data);
+    }
+    return page->count;
+}
+
+static bool insert_branch(KvTxn *txn, Path *path, unsigned level, const char *key, size_t key_length,
+                          pgno_t child);
+
+/* Rebuild page `pgno` (dirty, at `level` of the path) from spans, splitting
+ * it in two if they do not fit */
+static bool rebuild(KvTxn *txn, Path *path, unsigned level, uint16_t flags, const Span *spans, size_t n) {
+    pgno_t pgno = path->pgno[level];
+    char *data = dirty_find(txn, pgno)->data;
+    if (spans_bytes(spans, n) <= PAGE) {
+        page_build(SCRATCH_LEFT(txn), pgno, flags, spans, n);
+        memcpy(data, SCRATCH_LEFT(txn), PAGE);
+        return true;
+    }
+    /* Split near the byte midpoint; nodes are at most a quarter page, so
+     * both halves fit */
+    size_t total = spans_bytes(spans, n), left_bytes = sizeof(PageHeader), k = 0;
+    while (k < n - 1 && (left_bytes + spans[k].length + 2) * 2 <= total) left_bytes += spans[k++].length + 2;
+    if (k == 0) k = 1;
+    pgno_t right_pgno;
+    char *right = new_page(txn, &right_pgno);
+    if (!right) return false;
+    page_build(SCRATCH_LEFT(txn), pgno, flags, spans, k);
+
+    /* The separator is the right half's first key; in a branch that node's
+     * key is cleared, as the first key of a branch is ignored */
+    size_t sep_length;
+    const char *sep = node_key(&(PageHeader){ .flags = flags }, spans[k].data, &sep_length);
+    memcpy(SCRATCH_KEY(txn), sep, sep_length);
+    Span first = spans[k];
+    if (flags & P_BRANCH) {
+        memcpy(SCRATCH_NODE(txn), spans[k].data, BRANCH_HEADER);
+        put16(SCRATCH_NODE(txn), 0);
+        first = (Span){ SCRATCH_NODE(txn), BRANCH_HEADER };
+    }
+    /* Right half: the (possibly rewritten) first node, then the rest */
+    PageHeader *out = (PageHeader *)SCRATCH_RIGHT(txn);
+    Span rest[PAGE / 8];
+    rest[0] = first;
+    for (size_t i = k + 1; i < n; i++) rest[i - k] = spans[i];
+    page_build((char *)out, right_pgno, flags, rest, n - k);
+    memcpy(right, out, PAGE);
+    memcpy(data, SCRATCH_LEFT(txn), PAGE);
+
+    if (level == 0) {
+        /* New root over the two halves */
+        pgno_t root;
+        char *page = new_page(txn, &root);
+        if (!page) return false;
+        char left_node[BRANCH_HEADER], right_node[BRANCH_HEADER + KV_MAX_KEY];
+        memset(left_node, 0, sizeof(left_node));
+        put64(left_node + 8, pgno);
+        memset(right_node, 0, BRANCH_HEADER);
+        put16(right_node, (uint16_t)sep_length);
+        put64(right_node + 8, right_pgno);
+        memcpy(right_node + BRANCH_HEADER, SCRATCH_KEY(txn), sep_length);
+        Span root_spans[2] = { { left_node, BRANCH_HEADER }, { right_node, BRANCH_HEADER + sep_length } };
+        page_build(page, root, P_BRANCH, root_spans, 2);
+        txn->meta.root = root;
+        txn->meta.depth++;
+        return true;
+    }
+    char key[KV_MAX_KEY];
+    memcpy(key, SCRATCH_KEY(txn), sep_length);
+    return insert_branch(txn, path, level - 1, key, sep_length, right_pgno);
+}
+
+/* Add (key -> child) to the branch at `level`, right after the child the
+ * path went through */
+static bool insert_branch(KvTxn *txn, Path *path, unsigned level, const char *key, size_t key_length,
+                          pgno_t child) {
+    const PageHeader *page = (const PageHeader *)dirty_find(txn, path->pgno[level])->data;
+    char node[BRANCH_HEADER + KV_MAX_KEY];
+    memset(node, 0, BRANCH_HEADER);
+    put16(node, (uint16_t)key_length);
+    put64(node + 8, child);
+    memcpy(node + BRANCH_HEADER, key, key_length);
+    Span spans[PAGE / 8 + 1];
+    size_t n = page_spans(page, spans);
+    unsigned at = path->index[level] + 1;
+    memmove(&spans[at + 1], &spans[at], sizeof(Span) * (n - at));
+    spans[at] = (Span){ node, BRANCH_HEADER + key_length };
+    return rebuild(txn, path, level, P_BRANCH, spans, n + 1);
+}
+
+bool kv_put(KvTxn *txn, const void *key, size_t key_length, const void *value, size_t value_length) {
+    if (!txn->write || txn->failed || key_length > KV_MAX_KEY || value_length > UINT32_MAX) return false;
+    /* The new leaf node, with the value inline or on an overflow run */
+    char *node = SCRATCH_NODE(txn);
+    bool big = LEAF_HEADER + key_length + value_length > NODE_MAX;
+    put16(node, (uint16_t)key_length);
+    put16(node + 2, big ? N_BIG : 0);
+    put32(node + 4, (uint32_t)value_length);
+    memcpy(node + LEAF_HEADER, key, key_length);
+    size_t node_length = LEAF_HEADER + key_length + (big ? 8 : value_length);
+    if (big) {
+        /* A one-page run can take any free page; longer runs come from the
+         * end of the file, where pages are known to be consecutive */
+        size_t pages = (value_length + PAGE - 1) / PAGE;
+        pgno_t first = txn->meta.last_pgno;
+        if (pages == 1 ? !alloc_pgno(txn, &first) : (first + pages) * PAGE > txn->store->map_size) {
+            return txn_fail(txn);
+        }
+        char *run = malloc(pages * PAGE);
+        if (!run || !dirty_insert(txn, first, pages, run)) {
+            free(run);
+            return txn_fail(txn);
+        }
+        memcpy(run, value, value_length);
+        memset(run + value_length, 0, pages * PAGE - value_length);
+        if (pages > 1) txn->meta.last_pgno += pages;
+        put64(node + LEAF_HEADER + key_length, first);
+    } else if (value_length) {
+        memcpy(node + LEAF_HEADER + key_length, value, value_length);
+    }
+
+    Path path;
+    bool exact;
+    if (!find_path(txn, key, key_length, &path, &exact)) {
+        if (txn->meta.root) return txn_fail(txn);    /* deeper than MAX_DEPTH */
+        pgno_t root;
+        char *page = new_page(txn, &root);
+        if (!page) return false;
+        Span span = { node, node_length };
+        page_build(page, root, P_LEAF, &span, 1);
+        txn->meta.root = root;
+        txn->meta.depth = 1;
+        txn->meta.entries = 1;
+        return true;
+    }
+    if (!touch_path(txn, &path)) return false;
+    unsigned level = path.depth - 1;
+    const PageHeader *leaf = (const PageHeader *)dirty_find(txn, path.pgno[level])->data;
+    Span spans[PAGE / 8 + 1];
+    size_t n = page_spans(leaf, spans);
+    unsigned at = path.index[level];
+    if (exact) {
+        const char *old = spans[at].data;
+        if (get16(old + 2) & N_BIG) {
+            size_t pages = (get32(old + 4) + PAGE - 1) / PAGE;
+            free_pages(txn, get64(old + LEAF_HEADER + get16(old)), pages);
+        }
+        spans[at] = (Span){ node, node_length };
+    } else {
+        memmove(&spans[at + 1], &spans[at], sizeof(Span) * (n - at));
+        spans[at] = (Span){ node, node_length };
+        n++;
+        txn->meta.entries++;
+    }
+    return rebuild(txn, &path, level, P_LEAF, spans, n) && !txn->failed;
+}
+
+/* Drop node `index` of the page at `level`; an emptied page leaves its
+ * parent too */
+static bool remove_node(KvTxn *txn, Path *path, unsigned level, unsigned index) {
+    const PageHeader *page = (const PageHeader *)dirty_find(txn, path->pgno[level])->data;
+    if (page->count == 1 && level > 0) {
+        free_pages(txn, path->pgno[level], 1);
+        return remove_node(txn, path, level - 1, path->index[level - 1]);
+    }
+    Span spans[PAGE / 8];
+    size_t n = page_spans(page, spans);
+    memmove(&spans[index], &spans[index + 1], sizeof(Span) * (n - index - 1));
+    return rebuild(txn, path, level, page->flags, spans, n - 1);
+}
+
+bool kv_delete(KvTxn *txn, const void *key, size_t key_length) {
+    if (!txn->write || txn->failed) return false;
+    Path path;
+    bool exact;
+    if (!find_path(txn, key, key_length, &path, &exact) || !exact) return false;
+    if (!touch_path(txn, &path)) return false;
+    unsigned level = path.depth - 1;
+    const char *node = node_at((const PageHeader *)dirty_find(txn, path.pgno[level])->data, path.index[level]);
+    if (get16(node + 2) & N_BIG) {
+        size_t pages = (get32(node + 4) + PAGE - 1) / PAGE;
+        free_pages(txn, get64(node + LEAF_HEADER + get16(node)), pages);
+    }
+    if (!remove_node(txn, &path, level, path.index[level])) return false;
+    txn->meta.entries--;
+
+    /* Shrink the tree: an empty root leaf, or a root branch with one child */
+    for (;;) {
+        const PageHeader *root = page_get(txn, txn->meta.root);
+        if (root->count > 1 || ((root->flags & P_LEAF) && root->count == 1)) break;
+        pgno_t old = txn->meta.root;
+        txn->meta.root = root->count ? branch_child(node_at(root, 0)) : 0;
+        txn->meta.depth = root->count ? txn->meta.depth - 1 : 0;
+        free_pages(txn, old, 1);
+        if (!txn->meta.root) break;
+    }
+    return !txn->failed;
+}
+
+/* ========== CURSORS ========== */
+
+struct KvCursor {
+    KvTxn *txn;
+    Path path;
+    bool done;
+};
+
+/* From the page at the path's last level down to its leftmost leaf */
+static void descend_leftmost(KvCursor *cursor) {
+    for (;;) {
+        unsigned level = cursor->path.depth - 1;
+        const PageHeader *page = page_get(cursor->txn, cursor->path.pgno[level]);
+        if (page->flags & P_LEAF || cursor->path.depth == MAX_DEPTH) return;
+        cursor->path.pgno[level + 1] = branch_child(node_at(page, cursor->path.index[level]));
+        cursor->path.index[level + 1] = 0;
+        cursor->path.depth++;
+    }
+}
+
+KvCursor *kv_cursor_open(KvTxn *txn, const void *start, size_t start_length) {
+    KvCursor *cursor = calloc(1, sizeof(KvCursor));
+    if (!cursor) return NULL;
+    cursor->txn = txn;
+    if (start) {
+        bool exact;
+        cursor->done = !find_path(txn, start, start_length, &cursor->path, &exact);
+    } else if (txn->meta.root) {
+        cursor->path.pgno[0] = txn->meta.root;
+        cursor->path.index[0] = 0;
+        cursor->path.depth = 1;
+        descend_leftmost(cursor);
+    } else {
+        cursor->done = true;
+    }
+    return cursor;
+}
+
+bool kv_cursor_next(KvCursor *cursor, KvView *key, KvView *value) {
+    if (cursor->done) return false;
+    for (;;) {
+        unsigned level = cursor->path.depth - 1;
+        const PageHeader *leaf = page_get(cursor->txn, cursor->path.pgno[level]);
+        unsigned i = cursor->path.index[level];
+        if (i < leaf->count) {
+            const char *node = node_at(leaf, i);
+            size_t key_length;
+            key->data = node_key(leaf, node, &key_length);
+            key->length = key_length;
+            leaf_value(cursor->txn, node, value);
+            cursor->path.index[level]++;
+            return true;
+        }
+        /* Up to the first ancestor with a next child, then down its left */
+        for (;;) {
+            if (level == 0) {
+                cursor->done = true;
+                return false;
+            }
+            level--;
+            const PageHeader *branch = page_get(cursor->txn, cursor->path.pgno[level]);
+            if (cursor->path.index[level] + 1 < branch->count) break;
+        }
+        cursor->path.index[level]++;
+        cursor->path.depth = level + 1;
+        descend_leftmost(cursor);
+    }
+}
+
+void kv_cursor_close(KvCursor *cursor) {
+    free(cursor);
+}
+
+/* ========== DURABILITY ========== */
+
+static bool write_all(int fd, const void *data, size_t length, off_t offset) {
+    const char *p = data;
+    while (length) {
+        ssize_t n = pwrite(fd, p, length, offset);
+        if (n <= 0) return false;
+        p += n;
+        length -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
+
+static bool pending_push(KvStore *store, uint64_t txn, pgno_t pgno, bool unsynced) {
+    if (store->pending_count == store->pending_capacity) {
+        size_t capacity = store->pending_capacity ? store->pending_capacity * 2 : 256;
+        PendingPage *pending = realloc(store->pending, sizeof(PendingPage) * capacity);
+        if (!pending) return false;
+        store->pending = pending;
+        store->pending_capacity = capacity;
+    }
+    store->pending[store->pending_count++] = (PendingPage){ txn, pgno, unsynced };
+    return true;
+}
+
+/* Make `meta` durable: data first, then the free list on fresh pages at
+ * the end of the file, then the meta page that is not the durable one.
+ * Writer only. */
+static bool write_durable(KvStore *store, Meta *meta) {
+    /* The old list's pages are free once this meta is on disk */
+    for (size_t i = 0; i < store->freelist_pages.count; i++) {
+        if (!pending_push(store, meta->txn, store->freelist_pages.items[i], false)) return false;
+    }
+    store->freelist_pages.count = 0;
+    /* The list lives on pages that are free now (no snapshot and no
+     * durable meta reaches them), topped up from the end of the file */
+    size_t total = store->free.count + store->pending_count;
+    size_t pages = (total + FREELIST_PER_PAGE - 1) / FREELIST_PER_PAGE;
+    size_t taken = pages < store->free.count ? pages : store->free.count;
+    if ((meta->last_pgno + pages - taken) * PAGE > store->map_size) return false;
+    meta->freelist = 0;
+    if (pages) {
+        char *chain = calloc(pages, PAGE);
+        pgno_t *where = malloc(sizeof(pgno_t) * pages);
+        if (!chain || !where) {
+            free(chain);
+            free(where);
+            return false;
+        }
+        store->free.count -= taken;
+        for (size_t p = 0; p < pages; p++) {
+            where[p] = p < taken ? store->free.items[store->free.count + p] : meta->last_pgno + (p - taken);
+        }
+        total -= taken;
+        size_t next = 0;
+        for (size_t p = 0; p < pages; p++) {
+            char *page = chain + p * PAGE;
+            PageHeader *header = (PageHeader *)page;
+            header->pgno = where[p];
+            header->flags = P_FREELIST;
+            put64(page + sizeof(PageHeader), p + 1 < pages ? where[p + 1] : 0);
+            size_t count = 0;
+            for (; count < FREELIST_PER_PAGE && next < total; count++, next++) {
+                pgno_t pgno = next < store->free.count ? store->free.items[next]
+                                                       : store->pending[next - store->free.count].pgno;
+                put64(page + 24 + 8 * count, pgno);
+            }
+            header->count = (uint16_t)count;
+        }
+        bool ok = true;
+        for (size_t p = 0; p < pages && ok; p++) {
+            ok = write_all(store->fd, chain + p * PAGE, PAGE, (off_t)(where[p] * PAGE));
+        }
+        free(chain);
+        if (!ok) {
+            /* The pages taken stay free; nothing points at them yet */
+            store->free.count += taken;
+            free(where);
+            return false;
+        }
+        for (size_t p = 0; p < pages; p++) list_push(&store->freelist_pages, where[p]);
+        free(where);
+        meta->freelist = store->freelist_pages.items[0];
+        meta->last_pgno += pages - taken;
+    }
+    if (fdatasync(store->fd) != 0) return false;
+    int slot = 1 - store->durable_slot;
+    meta->checksum = meta_checksum(meta);
+    char page[PAGE];
+    memset(page, 0, PAGE);
+    memcpy(page, meta, sizeof(Meta));
+    if (!write_all(store->fd, page, PAGE, (off_t)slot * PAGE) || fdatasync(store->fd) != 0) return false;
+    store->durable_slot = slot;
+    store->durable_txn = meta->txn;
+    store->unsynced = 0;
+    set_clear(&store->unsynced_pages);
+    return true;
+}
+
+static void publish(KvStore *store, const Meta *meta) {
+    pthread_mutex_lock(&store->lock);
+    store->meta = *meta;
+    store->stat_free = store->free.count + store->pending_count;
+    pthread_mutex_unlock(&store->lock);
+}
+
+bool kv_sync(KvStore *store) {
+    pthread_mutex_lock(&store->write_lock);
+    bool ok = true;
+    if (store->durable_txn != store->meta.txn) {
+        Meta meta = store->meta;
+        ok = write_durable(store, &meta);
+        if (ok) publish(store, &meta);
+    }
+    pthread_mutex_unlock(&store->write_lock);
+    return ok;
+}
+
+/* ========== TRANSACTIONS ========== */
+
+static uint64_t oldest_reader(const KvStore *store) {
+    uint64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < store->reader_count; i++) {
+        if (store->readers[i] < oldest) oldest = store->readers[i];
+    }
+    return oldest;
+}
+
+KvTxn *kv_begin(KvStore *store, bool write) {
+    KvTxn *txn = calloc(1, sizeof(KvTxn));
+    if (!txn) return NULL;
+    txn->store = store;
+    txn->write = write;
+    if (write) {
+        txn->scratch = malloc(4 * PAGE);
+        if (!txn->scratch) {
+            free(txn);
+            return NULL;
+        }
+        pthread_mutex_lock(&store->write_lock);
+        pthread_mutex_lock(&store->lock);
+        txn->meta = store->meta;
+        uint64_t oldest = oldest_reader(store);
+        pthread_mutex_unlock(&store->lock);
+        /* Pages freed by commit T are in no snapshot from T on; reuse them
+         * once every reader and the durable meta are that new. Pages the
+         * durable meta never saw only wait for readers, so a batch of
+         * unsynced commits recycles its own pages. */
+        uint64_t limit = oldest < store->durable_txn ? oldest : store->durable_txn;
+        size_t kept = 0;
+        for (size_t i = 0; i < store->pending_count; i++) {
+            PendingPage p = store->pending[i];
+            if (p.txn > (p.unsynced ? oldest : limit) || !list_push(&store->free, p.pgno)) {
+                store->pending[kept++] = p;
+            }
+        }
+        store->pending_count = kept;
+        return txn;
+    }
+    pthread_mutex_lock(&store->lock);
+    if (store->reader_count == store->reader_capacity) {
+        size_t capacity = store->reader_capacity ? store->reader_capacity * 2 : 16;
+        uint64_t *readers = realloc(store->readers, sizeof(uint64_t) * capacity);
+        if (!readers) {
+            pthread_mutex_unlock(&store->lock);
+            free(txn);
+            return NULL;
+        }
+        store->readers = readers;
+        store->reader_capacity = capacity;
+    }
+    txn->meta = store->meta;
+    store->readers[store->reader_count++] = txn->meta.txn;
+    pthread_mutex_unlock(&store->lock);
+    return txn;
+}
+
+static void txn_free(KvTxn *txn) {
+    dirty_clear(txn);
+    free(txn->freed.items);
+    free(txn->reused.items);
+    free(txn->spare.items);
+    free(txn->scratch);
+    free(txn);
+}
+
+static void end_read(KvTxn *txn) {
+    KvStore *store = txn->store;
+    pthread_mutex_lock(&store->lock);
+    for (size_t i = 0; i < store->reader_count; i++) {
+        if (store->readers[i] == txn->meta.txn) {
+            store->readers[i] = store->readers[--store->reader_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&store->lock);
+    free(txn);
+}
+
+void kv_abort(KvTxn *txn) {
+    if (!txn) return;
+    if (!txn->write) {
+        end_read(txn);
+        return;
+    }
+    KvStore *store = txn->store;
+    for (size_t i = 0; i < txn->reused.count; i++) list_push(&store->free, txn->reused.items[i]);
+    pthread_mutex_unlock(&store->write_lock);
+    txn_free(txn);
+}
+
+bool kv_txn_failed(const KvTxn *txn) {
+    return txn->failed;
+}
+
+static int dirty_order(const void *a, const void *b) {
+    pgno_t x = (*(Dirty *const *)a)->pgno, y = (*(Dirty *const *)b)->pgno;
+    return x < y ? -1 : x > y;
+}
+
+bool kv_commit(KvTxn *txn) {
+    if (!txn->write) {
+        end_read(txn);
+        return true;
+    }
+    KvStore *store = txn->store;
+    if (txn->failed) {
+        kv_abort(txn);
+        return false;
+    }
+    if (!txn->dirty_count && !txn->freed.count) {
+        kv_abort(txn);
+        return true;
+    }
+    /* New pages in file order */
+    Dirty **order = malloc(sizeof(Dirty *) * (txn->dirty_count ? txn->dirty_count : 1));
+    if (!order) {
+        kv_abort(txn);
+        return false;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < txn->dirty_capacity; i++) {
+        if (txn->dirty[i].pgno) order[n++] = &txn->dirty[i];
+    }
+    qsort(order, n, sizeof(Dirty *), dirty_order);
+    bool ok = true;
+    for (size_t i = 0; i < n && ok; i++) {
+        ok = write_all(store->fd, order[i]->data, order[i]->pages * PAGE, (off_t)(order[i]->pgno * PAGE));
+    }
+    if (store->sync_every > 1) {
+        for (size_t i = 0; i < n; i++) {
+            for (size_t p = 0; p < order[i]->pages; p++) set_add(&store->unsynced_pages, order[i]->pgno + p);
+        }
+    }
+    free(order);
+
+    if (!ok) {
+        /* Nothing was published; the pages written are unreachable */
+        kv_abort(txn);
+        return false;
+    }
+    txn->meta.txn++;
+    for (size_t i = 0; i < txn->freed.count; i++) {
+        pgno_t pgno = txn->freed.items[i];
+        if (!pending_push(store, txn->meta.txn, pgno, set_has(&store->unsynced_pages, pgno))) break;    /* leaked */
+    }
+    for (size_t i = 0; i < txn->spare.count; i++) list_push(&store->free, txn->spare.items[i]);
+    /* A failed sync still publishes: the pages are written, the durable
+     * meta is untouched and the next sync retries */
+    if (++store->unsynced >= store->sync_every) ok = write_durable(store, &txn->meta);
+    publish(store, &txn->meta);
+    pthread_mutex_unlock(&store->write_lock);
+    txn_free(txn);
+    return ok;
+}
+
+/* ========== OPEN / CLOSE ========== */
+
+static bool read_meta(int fd, int slot, Meta *meta) {
+    return pread(fd, meta, sizeof(Meta), (off_t)slot * PAGE) == (ssize_t)sizeof(Meta) && meta_valid(meta);
+}
+
+static bool load_freelist(KvStore *store) {
+    pgno_t pgno = store->meta.freelist;
+    size_t guard = 0;
+    while (pgno) {
+        if (pgno >= store->meta.last_pgno || ++guard > store->meta.last_pgno) return false;
+        const char *page = store->map + pgno * PAGE;
+        const PageHeader *header = (const PageHeader *)page;
+        if (!(header->flags & P_FREELIST) || header->count > FREELIST_PER_PAGE) return false;
+        for (unsigned i = 0; i < header->count; i++) {
+            if (!list_push(&store->free, get64(page + 24 + 8 * i))) return false;
+        }
+        if (!list_push(&store->freelist_pages, pgno)) return false;
+        pgno = get64(page + sizeof(PageHeader));
+    }
+    return true;
+}
+
+static void store_free(KvStore *store) {
+    if (store->map) munmap((void *)store->map, store->map_size);
+    if (store->fd >= 0) close(store->fd);
+    pthread_mutex_destroy(&store->write_lock);
+    pthread_mutex_destroy(&store->lock);
+    free(store->readers);
+    free(store->free.items);
+    free(store->pending);
+    free(store->freelist_pages.items);
+    free(store->unsynced_pages.slots);
+    free(store);
+}
+
+static KvStore *store_open(int fd, const struct stat *st, const KvOptions *options) {
+    KvStore *store = calloc(1, sizeof(KvStore));
+    if (!store) return NULL;
+    store->fd = fd;
+    store->dev = st->st_dev;
+    store->ino = st->st_ino;
+    store->refs = 1;
+    pthread_mutex_init(&store->write_lock, NULL);
+    pthread_mutex_init(&store->lock, NULL);
+    store->sync_every = options && options->sync_every > 1 ? options->sync_every : 1;
+    store->map_size = options && options->map_size ? options->map_size : KV_DEFAULT_MAP_SIZE;
+    store->map_size = (store->map_size + PAGE - 1) / PAGE * PAGE;
+
+    if (st->st_size == 0) {
+        /* New file: meta 0 valid and empty, meta 1 blank */
+        char page[2 * PAGE];
+        memset(page, 0, sizeof(page));
+        Meta meta = { META_MAGIC, META_VERSION, PAGE, 0, 0, 0, 2, 0, 0, 0 };
+        meta.checksum = meta_checksum(&meta);
+        memcpy(page, &meta, sizeof(meta));
+        if (!write_all(fd, page, sizeof(page), 0) || fdatasync(fd) != 0) {
+            store_free(store);
+            return NULL;
+        }
+    }
+    Meta metas[2];
+    bool valid[2] = { read_meta(fd, 0, &metas[0]), read_meta(fd, 1, &metas[1]) };
+    if (!valid[0] && !valid[1]) {
+        store_free(store);
+        return NULL;
+    }
+    int slot = valid[0] && (!valid[1] || metas[0].txn >= metas[1].txn) ? 0 : 1;
+    store->meta = metas[slot];
+    store->durable_slot = slot;
+    store->durable_txn = store->meta.txn;
+    if (store->meta.last_pgno * PAGE > store->map_size) store->map_size = store->meta.last_pgno * PAGE;
+
+    void *map = mmap(NULL, store->map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        store_free(store);
+        return NULL;
+    }
+    store->map = map;
+    if (!load_freelist(store)) {
+        store_free(store);
+        return NULL;
+    }
+    store->stat_free = store->free.count;
+    return store;
+}
+
+KvStore *kv_open(const char *path, const KvOptions *options) {
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    pthread_mutex_lock(&g_stores_lock);
+    KvStore *store = g_stores;
+    while (store && !(store->dev == st.st_dev && store->ino == st.st_ino)) store = store->next;
+    if (store) {
+        store->refs++;
+        close(fd);
+    } else {
+        store = store_open(fd, &st, options);
+        if (store) {
+            store->next = g_stores;
+            g_stores = store;
+        }
+    }
+    pthread_mutex_unlock(&g_stores_lock);
+    return store;
+}
+
+void kv_close(KvStore *store) {
+    if (!store) return;
+    pthread_mutex_lock(&g_stores_lock);
+    bool last = --store->refs == 0;
+    if (last) {
+        KvStore **link = &g_stores;
+        while (*link != store) link = &(*link)->next;
+        *link = store->next;
+    }
+    pthread_mutex_unlock(&g_stores_lock);
+    if (!last) return;
+    kv_sync(store);
+    store_free(store);
+}
+
+void kv_stat(KvStore *store, KvStat *stat) {
+    pthread_mutex_lock(&store->lock);
+    stat->entries = store->meta.entries;
+    stat->txn = store->meta.txn;
+    stat->durable_txn = store->durable_txn;
+    stat->pages = store->meta.last_pgno;
+    stat->free_pages = store->stat_free;
+    stat->depth = store->meta.depth;
+    pthread_mutex_unlock(&store->lock);
+}
+
+#endif /* _WIN32 */
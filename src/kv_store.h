@@ -0,0 +1,116 @@
+#ifndef RUBOLT_KV_STORE_H
+#define RUBOLT_KV_STORE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Embedded key-value store: one file, a copy-on-write B+tree of 4 KB pages
+ * read through a shared read-only mmap (the LMDB design).
+ *
+ * A write transaction never modifies a page in place. It copies every page
+ * on the path it changes to a fresh page, so the tree a reader started on
+ * stays intact until the reader ends. Commit writes the new pages with
+ * pwrite, then points one of two meta pages at the new root; the meta
+ * pages alternate, so a torn meta write falls back to the previous
+ * transaction. Pages replaced by a commit go to a free list and are reused
+ * once no reader and no durable meta can still reach them.
+ *
+ * One write transaction runs at a time (a mutex); any number of read
+ * transactions run beside it, each on the snapshot that was current when
+ * it began. Stores are shared per file within the process, so several
+ * isolates opening the same path get the same store and its locking.
+ *
+ * Group commit: with sync_every > 1, commits are visible at once but made
+ * durable in batches, by one fdatasync of the data and one of the meta per
+ * batch. A crash loses at most the unsynced batch and never corrupts the
+ * file. kv_sync flushes a batch early.
+ *
+ * Keys (up to KV_MAX_KEY bytes) are ordered bytewise. Values of any size;
+ * large ones live on contiguous overflow pages so they still read as one
+ * view. Reads return views into the map (or into the write transaction's
+ * pages), valid until the transaction ends or, in a write transaction,
+ * until the next put or delete. */
+
+#define KV_PAGE_SIZE 4096
+#define KV_MAX_KEY   511
+
+typedef struct KvStore KvStore;
+typedef struct KvTxn KvTxn;
+typedef struct KvCursor KvCursor;
+
+typedef struct {
+    const void *data;
+    size_t length;
+} KvView;
+
+typedef struct {
+    size_t map_size;            /* largest the file may grow; 0 = KV_DEFAULT_MAP_SIZE */
+    unsigned sync_every;        /* commits per fsync batch; 0 or 1 = every commit */
+} KvOptions;
+
+#define KV_DEFAULT_MAP_SIZE ((size_t)1 << 32)
+
+typedef struct {
+    uint64_t entries;
+    uint64_t txn;               /* id of the latest commit */
+    uint64_t durable_txn;       /* id of the latest commit on disk */
+    uint64_t pages;             /* file size in pages */
+    uint64_t free_pages;        /* reusable now or once readers move on */
+    unsigned depth;             /* 0 for an empty tree */
+} KvStat;
+
+/* ========== STORE ========== */
+
+/* Open or create a store. Opening a file this process already has open
+ * returns the same store (options are ignored then); each open needs a
+ * kv_close. */
+KvStore *kv_open(const char *path, const KvOptions *options);
+
+/* Sync any unsynced commits and close; the last close releases the store.
+ * No transactions may be open. */
+void kv_close(KvStore *store);
+
+/* Make every commit so far durable */
+bool kv_sync(KvStore *store);
+
+void kv_stat(KvStore *store, KvStat *stat);
+
+/* ========== TRANSACTIONS ========== */
+
+/* A write transaction waits for the previous one to finish */
+KvTxn *kv_begin(KvStore *store, bool write);
+
+/* Publish a write transaction's changes (a read transaction just ends);
+ * false if any operation in it failed or its pages could not be written,
+ * and then nothing is published. A failed fsync batch also returns false
+ * but the commit stays visible, not yet durable, until a sync succeeds.
+ * The transaction is released either way. */
+bool kv_commit(KvTxn *txn);
+
+/* Discard the transaction's changes and release it */
+void kv_abort(KvTxn *txn);
+
+/* True after a failed put/delete or I/O error; commit will fail */
+bool kv_txn_failed(const KvTxn *txn);
+
+/* ========== DATA ========== */
+
+bool kv_get(KvTxn *txn, const void *key, size_t key_length, KvView *value);
+
+/* Insert or replace; false for a key over KV_MAX_KEY, a full map or an
+ * allocation failure */
+bool kv_put(KvTxn *txn, const void *key, size_t key_length, const void *value, size_t value_length);
+
+/* False if the key is absent (or on failure, see kv_txn_failed) */
+bool kv_delete(KvTxn *txn, const void *key, size_t key_length);
+
+/* ========== CURSORS ========== */
+
+/* Iterate keys >= start in order (all keys when start is NULL). A cursor
+ * in a write transaction is invalid after the next put or delete. */
+KvCursor *kv_cursor_open(KvTxn *txn, const void *start, size_t start_length);
+bool kv_cursor_next(KvCursor *cursor, KvView *key, KvView *value);
+void kv_cursor_close(KvCursor *cursor);
+
+#endif /* RUBOLT_KV_STORE_H */
@@ -0,0 +1,622 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "logger.h"
+#include "threading.h"
+#include "dtoa.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <pthread.h>
+#endif
+
+#ifdef _MSC_VER
+#define LOGGER_THREAD_LOCAL __declspec(thread)
+#else
+#define LOGGER_THREAD_LOCAL __thread
+#endif
+
+#define PAD_FLAG ((uint32_t)1 << 31)
+#define OUT_CHUNK ((size_t)64 << 10)
+#define OUT_CHUNKS 16
+
+/* ========== RINGS ========== */
+
+/* Single producer (the owning thread), single consumer (the writer).
+ * head and tail count bytes ever written and consumed; each side
+ * publishes its own counter with a release store. */
+typedef struct LogRing {
+    unsigned char *data;
+    size_t capacity;            /* power of two */
+    size_t head;
+    size_t tail;
+    bool closed;                /* owner thread exited: free once drained */
+    struct LogRing *next;
+} LogRing;
+
+/* A record, 8-byte aligned in the ring, followed by the format bytes and
+ * then each argument as a type byte and its payload (a bool byte, 8
+ * double bytes, or a 32-bit length and the string bytes). A header whose
+ * size has PAD_FLAG set skips the rest of the ring to wrap around. */
+typedef struct {
+    uint32_t size;
+    uint16_t level;
+    uint16_t arg_count;
+    uint32_t format_length;
+    uint32_t reserved;
+    int64_t sec;
+    int64_t nsec;
+} RecordHeader;
+
+static LogRing *rings;                          /* pushed by producers with CAS */
+static LOGGER_THREAD_LOCAL LogRing *thread_ring;
+static int min_level = LOGGER_INFO;
+
+/* ========== WRITER STATE ========== */
+
+enum { STOPPED, STARTING, RUNNING };
+
+static int state = STOPPED;
+static Thread *writer;
+static Mutex *lock;
+static CondVar *wake;                           /* writer waits for work */
+static CondVar *flushed_cv;                     /* flushers wait for the writer */
+static bool stop_requested;
+static bool sleeping;
+static uint64_t flush_requested;
+static uint64_t flush_done;
+static int out_fd = 1;
+/* Counted here rather than per ring: drops are rare, and logger_stats must
+ * not touch rings the writer may be freeing */
+static LoggerStats stats;
+
+#ifndef _WIN32
+static pthread_key_t ring_key;
+
+/* Thread exit: the writer frees the ring once it has drained it */
+static void ring_release(void *ring) {
+    __atomic_store_n(&((LogRing *)ring)->closed, true, __ATOMIC_RELEASE);
+}
+#endif
+
+static LogRing *ring_for_thread(void) {
+    if (thread_ring) return thread_ring;
+    LogRing *ring = calloc(1, sizeof(LogRing));
+    if (!ring) return NULL;
+    ring->capacity = LOGGER_RING_SIZE;
+    ring->data = malloc(ring->capacity);
+    if (!ring->data) {
+        free(ring);
+        return NULL;
+    }
+    ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+#ifndef _WIN32
+    pthread_setspecific(ring_key, ring);
+#endif
+    thread_ring = ring;
+    return ring;
+}
+
+/* ========== CONFIGURATION ========== */
+
+static const char *level_names[] = { "debug", "info", "warn", "error", "off" };
+static const char *level_labels[] = { "DEBUG", "INFO ", "WARN ", "ERROR" };
+
+void logger_set_level(LoggerLevel level) {
+    __atomic_store_n(&min_level, (int)level, __ATOMIC_RELAXED);
+}
+
+LoggerLevel logger_level(void) {
+    return (LoggerLevel)__atomic_load_n(&min_level, __ATOMIC_RELAXED);
+}
+
+bool logger_enabled(LoggerLevel level) {
+    return level < LOGGER_OFF && (int)level >= __atomic_load_n(&min_level, __ATOMIC_RELAXED);
+}
+
+int logger_level_from_name(const char *name) {
+    for (int i = 0; i <= LOGGER_OFF; i++) {
+        const char *a = name, *b = level_names[i];
+        while (*a && (*a | 0x20) == *b) {
+            a++;
+            b++;
+        }
+        if (!*a && !*b) return i;
+    }
+    return -1;
+}
+
+const char *logger_level_name(LoggerLevel level) {
+    return level <= LOGGER_OFF ? level_names[level] : "off";
+}
+
+/* ========== FORMATTING ========== */
+
+typedef struct {
+    char *chunks[OUT_CHUNKS];
+    size_t used[OUT_CHUNKS];
+    size_t current;
+    char *line;                 /* the line being formatted */
+    size_t line_length;
+    size_t line_capacity;
+    int64_t cached_sec;
+    char cached_time[32];       /* "YYYY-MM-DDTHH:MM:SS" of cached_sec */
+} Output;
+
+static void line_append(Output *out, const char *s, size_t length) {
+    if (out->line_length + length > out->line_capacity) {
+        size_t capacity = out->line_capacity ? out->line_capacity : 256;
+        while (capacity < out->line_length + length) capacity *= 2;
+        char *line = realloc(out->line, capacity);
+        if (!line) return;
+        out->line = line;
+        out->line_capacity = capacity;
+    }
+    memcpy(out->line + out->line_length, s, length);
+    out->line_length += length;
+}
+
+static void format_number(Output *out, double x) {
+    char text[DTOA_BUFFER_SIZE];
+    line_append(out, text, dtoa_shortest(x, text));
+}
+
+/* Decode one argument at p, append it, and return the next position */
+static const unsigned char *format_arg(Output *out, const unsigned char *p) {
+    switch (*p++) {
+        case LOGGER_ARG_BOOL:
+            if (*p) line_append(out, "true", 4);
+            else line_append(out, "false", 5);
+            return p + 1;
+        case LOGGER_ARG_NUMBER: {
+            double x;
+            memcpy(&x, p, sizeof(x));
+            format_number(out, x);
+            return p + sizeof(x);
+        }
+        case LOGGER_ARG_STRING: {
+            uint32_t length;
+            memcpy(&length, p, sizeof(length));
+            line_append(out, (const char *)p + sizeof(length), length);
+            return p + sizeof(length) + length;
+        }
+        default:
+            line_append(out, "null", 4);
+            return p;
+    }
+}
+
+static void format_record(Output *out, const RecordHeader *h) {
+    out->line_length = 0;
+    if (h->sec != out->cached_sec || !out->cached_time[0]) {
+        time_t t = (time_t)h->sec;
+        struct tm tm;
+#ifdef _WIN32
+        gmtime_s(&tm, &t);
+#else
+        gmtime_r(&t, &tm);
+#endif
+        strftime(out->cached_time, sizeof(out->cached_time), "%Y-%m-%dT%H:%M:%S", &tm);
+        out->cached_sec = h->sec;
+    }
+    /* "YYYY-MM-DDTHH:MM:SS" + ".mmmZ " + "INFO  " */
+    char stamp[48];
+    size_t n = strlen(out->cached_time);
+    memcpy(stamp, out->cached_time, n);
+    int ms = (int)(h->nsec / 1000000);
+    stamp[n++] = '.';
+    stamp[n++] = (char)('0' + ms / 100);
+    stamp[n++] = (char)('0' + ms / 10 % 10);
+    stamp[n++] = (char)('0' + ms % 10);
+    stamp[n++] = 'Z';
+    stamp[n++] = ' ';
+    memcpy(stamp + n, level_labels[h->level < LOGGER_OFF ? h->level : LOGGER_ERROR], 5);
+    n += 5;
+    stamp[n++] = ' ';
+    line_append(out, stamp, n);
+
+    const char *format = (const char *)(h + 1);
+    const unsigned char *arg = (const unsigned char *)format + h->format_length;
+    size_t used = 0, start = 0;
+    for (size_t i = 0; i + 1 < h->format_length; i++) {
+        if (format[i] == '{' && format[i + 1] == '}' && used < h->arg_count) {
+            line_append(out, format + start, i - start);
+            arg = format_arg(out, arg);
+            used++;
+            start = i + 2;
+            i++;
+        }
+    }
+    line_append(out, format + start, h->format_length - start);
+    for (; used < h->arg_count; used++) {
+        line_append(out, " ", 1);
+        arg = format_arg(out, arg);
+    }
+    line_append(out, "\n", 1);
+}
+
+/* ========== WRITING ========== */
+
+static bool write_chunks(int fd, Output *out) {
+    size_t count = out->current + 1;
+    while (count && out->used[count - 1] == 0) count--;
+    if (!count) return true;
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) total += out->used[i];
+    bool ok = true;
+#ifdef _WIN32
+    for (size_t i = 0; i < count && ok; i++) ok = _write(fd, out->chunks[i], (unsigned)out->used[i]) >= 0;
+#else
+    struct iovec iov[OUT_CHUNKS];
+    for (size_t i = 0; i < count; i++) iov[i] = (struct iovec){ out->chunks[i], out->used[i] };
+    size_t first = 0;
+    while (first < count) {
+        ssize_t n = writev(fd, iov + first, (int)(count - first));
+        if (n < 0) {
+            ok = false;
+            break;
+        }
+        /* Partial write: skip what went out and continue */
+        size_t left = (size_t)n;
+        while (first < count && left >= iov[first].iov_len) left -= iov[first++].iov_len;
+        if (first < count) {
+            iov[first].iov_base = (char *)iov[first].iov_base + left;
+            iov[first].iov_len -= left;
+        }
+    }
+#endif
+    __atomic_fetch_add(&stats.writes, 1, __ATOMIC_RELAXED);
+    if (ok) __atomic_fetch_add(&stats.bytes, total, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < OUT_CHUNKS; i++) out->used[i] = 0;
+    out->current = 0;
+    return ok;
+}
+
+/* Append the formatted line to the chunks, writing them out when full */
+static void emit_line(Output *out) {
+    const char *s = out->line;
+    size_t length = out->line_length;
+    while (length) {
+        if (out->used[out->current] == OUT_CHUNK) {
+            if (out->current + 1 == OUT_CHUNKS) write_chunks(__atomic_load_n(&out_fd, __ATOMIC_ACQUIRE), out);
+            else out->current++;
+        }
+        size_t room = OUT_CHUNK - out->used[out->current];
+        size_t n = length < room ? length : room;
+        memcpy(out->chunks[out->current] + out->used[out->current], s, n);
+        out->used[out->current] += n;
+        s += n;
+        length -= n;
+    }
+    __atomic_fetch_add(&stats.written, 1, __ATOMIC_RELAXED);
+}
+
+/* The next record of a ring below its snapshot head, skipping padding;
+ * NULL if there is none */
+static const RecordHeader *peek(LogRing *ring, size_t head) {
+    while (ring->tail < head) {
+        const RecordHeader *h = (const RecordHeader *)(ring->data + (ring->tail & (ring->capacity - 1)));
+        if (!(h->size & PAD_FLAG)) return h;
+        __atomic_store_n(&ring->tail, ring->tail + (h->size & ~PAD_FLAG), __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static bool earlier(const RecordHeader *a, const RecordHeader *b) {
+    return a->sec < b->sec || (a->sec == b->sec && a->nsec < b->nsec);
+}
+
+/* One pass: every record published when the pass starts, merged across
+ * rings by timestamp. Records published during the pass wait for the next
+ * one, so the order across threads holds only within a pass (see
+ * logger.h). Returns the number of records. */
+static size_t drain(Output *out) {
+    LogRing *list = __atomic_load_n(&rings, __ATOMIC_ACQUIRE);
+    size_t count = 0, ring_count = 0;
+    for (LogRing *r = list; r; r = r->next) ring_count++;
+    if (!ring_count) return 0;
+    LogRing **active = malloc(ring_count * sizeof(LogRing *));
+    size_t *heads = malloc(ring_count * sizeof(size_t));
+    if (!active || !heads) {
+        free(active);
+        free(heads);
+        return 0;
+    }
+    size_t n = 0;
+    for (LogRing *r = list; r; r = r->next) {
+        active[n] = r;
+        heads[n++] = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    }
+    for (;;) {
+        size_t best = n;
+        const RecordHeader *best_h = NULL;
+        for (size_t i = 0; i < n; i++) {
+            const RecordHeader *h = peek(active[i], heads[i]);
+            if (h && (!best_h || earlier(h, best_h))) {
+                best = i;
+                best_h = h;
+            }
+        }
+        if (!best_h) break;
+        format_record(out, best_h);
+        emit_line(out);
+        __atomic_store_n(&active[best]->tail, active[best]->tail + best_h->size, __ATOMIC_RELEASE);
+        count++;
+    }
+    free(active);
+    free(heads);
+    return count;
+}
+
+/* Free rings whose threads have exited once they are empty */
+static void reclaim(void) {
+    LogRing **link = &rings;
+    LogRing *r;
+    while ((r = __atomic_load_n(link, __ATOMIC_ACQUIRE)) != NULL) {
+        bool done = __atomic_load_n(&r->closed, __ATOMIC_ACQUIRE) &&
+                    r->tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if (!done) {
+            link = &r->next;
+            continue;
+        }
+        if (link == &rings) {
+            LogRing *expected = r;
+            /* A producer pushed a new head: look for r again */
+            if (!__atomic_compare_exchange_n(&rings, &expected, r->next, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+        } else {
+            *link = r->next;
+        }
+        free(r->data);
+        free(r);
+    }
+}
+
+static void *writer_main(void *arg) {
+    (void)arg;
+    Output out;
+    memset(&out, 0, sizeof(out));
+    for (size_t i = 0; i < OUT_CHUNKS; i++) {
+        out.chunks[i] = malloc(OUT_CHUNK);
+        if (!out.chunks[i]) return NULL;
+    }
+    for (;;) {
+        uint64_t target = __atomic_load_n(&flush_requested, __ATOMIC_ACQUIRE);
+        bool stopping = __atomic_load_n(&stop_requested, __ATOMIC_ACQUIRE);
+        size_t n = drain(&out);
+        write_chunks(__atomic_load_n(&out_fd, __ATOMIC_ACQUIRE), &out);
+        reclaim();
+        mutex_lock(lock);
+        if (target > flush_done) {
+            flush_done = target;
+            condvar_broadcast(flushed_cv);
+        }
+        if (stopping && n == 0) {
+            mutex_unlock(lock);
+            break;
+        }
+        if (n == 0 && flush_requested == flush_done && !stop_requested) {
+            __atomic_store_n(&sleeping, true, __ATOMIC_RELAXED);
+            condvar_wait_timeout(wake, lock, LOGGER_FLUSH_MS);
+            __atomic_store_n(&sleeping, false, __ATOMIC_RELAXED);
+        }
+        mutex_unlock(lock);
+    }
+    for (size_t i = 0; i < OUT_CHUNKS; i++) free(out.chunks[i]);
+    free(out.line);
+    return NULL;
+}
+
+static void free_writer(void) {
+    if (writer) free(writer->name);
+    free(writer);
+    writer = NULL;
+}
+
+/* Start the writer if it is not running; false if it cannot be */
+static bool ensure_started(void) {
+    int s = __atomic_load_n(&state, __ATOMIC_ACQUIRE);
+    if (s == RUNNING) return true;
+    int expected = STOPPED;
+    if (s == STOPPED && __atomic_compare_exchange_n(&state, &expected, STARTING, false, __ATOMIC_ACQ_REL,
+                                                    __ATOMIC_ACQUIRE)) {
+        if (!lock) {
+            lock = mutex_create();
+            wake = condvar_create();
+            flushed_cv = condvar_create();
+#ifndef _WIN32
+            pthread_key_create(&ring_key, ring_release);
+#endif
+            /* Lines still queued at exit are written, not lost */
+            atexit(logger_shutdown);
+        }
+        stop_requested = false;
+        writer = lock && wake && flushed_cv ? thread_create(writer_main, NULL, "logger") : NULL;
+        if (!writer || !thread_start(writer)) {
+            free_writer();
+            __atomic_store_n(&state, STOPPED, __ATOMIC_RELEASE);
+            return false;
+        }
+        __atomic_store_n(&state, RUNNING, __ATOMIC_RELEASE);
+        return true;
+    }
+    /* Another thread is starting it */
+    while ((s = __atomic_load_n(&state, __ATOMIC_ACQUIRE)) == STARTING) thread_yield();
+    return s == RUNNING;
+}
+
+/* ========== LOGGING ========== */
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static void wake_writer(void) {
+    if (!__atomic_load_n(&sleeping, __ATOMIC_RELAXED)) return;
+    mutex_lock(lock);
+    condvar_signal(wake);
+    mutex_unlock(lock);
+}
+
+bool logger_write(LoggerLevel level, const char *format, size_t format_length, const LoggerArg *args,
+                  size_t arg_count) {
+    if (!logger_enabled(level)) return false;
+    if (!ensure_started()) return false;
+    LogRing *ring = ring_for_thread();
+    if (!ring) return false;
+
+    /* Size the record, truncating strings to LOGGER_MAX_RECORD */
+    if (arg_count > UINT16_MAX) arg_count = UINT16_MAX;
+    size_t budget = LOGGER_MAX_RECORD - sizeof(RecordHeader);
+    if (format_length > budget / 2) format_length = budget / 2;
+    size_t fixed = format_length;
+    for (size_t i = 0; i < arg_count; i++) {
+        fixed += 1 + (args[i].type == LOGGER_ARG_BOOL ? 1 : args[i].type == LOGGER_ARG_NUMBER ? 8 :
+                      args[i].type == LOGGER_ARG_STRING ? 4 : 0);
+    }
+    if (fixed > budget) return false;
+    size_t room = budget - fixed, strings = 0;
+    for (size_t i = 0; i < arg_count; i++) {
+        if (args[i].type != LOGGER_ARG_STRING) continue;
+        size_t length = args[i].as.string.length < room - strings ? args[i].as.string.length : room - strings;
+        strings += length;
+    }
+    size_t size = align8(sizeof(RecordHeader) + fixed + strings);
+
+    size_t head = ring->head;
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    size_t pos = head & (ring->capacity - 1);
+    size_t contiguous = ring->capacity - pos;
+    size_t needed = size > contiguous ? size + contiguous : size;
+    if (head + needed - tail > ring->capacity) {
+        __atomic_fetch_add(&stats.dropped, 1, __ATOMIC_RELAXED);
+        wake_writer();
+        return false;
+    }
+    if (size > contiguous) {
+        RecordHeader *pad = (RecordHeader *)(ring->data + pos);
+        pad->size = (uint32_t)contiguous | PAD_FLAG;
+        head += contiguous;
+        pos = 0;
+    }
+
+    RecordHeader *h = (RecordHeader *)(ring->data + pos);
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+    *h = (RecordHeader){ (uint32_t)size, (uint16_t)level, (uint16_t)arg_count, (uint32_t)format_length, 0,
+                         (int64_t)ts.tv_sec, (int64_t)ts.tv_nsec };
+    unsigned char *p = (unsigned char *)(h + 1);
+    memcpy(p, format, format_length);
+    p += format_length;
+    size_t left = strings;
+    for (size_t i = 0; i < arg_count; i++) {
+        *p++ = (unsigned char)args[i].type;
+        switch (args[i].type) {
+            case LOGGER_ARG_BOOL:
+                *p++ = args[i].as.boolean;
+                break;
+            case LOGGER_ARG_NUMBER:
+                memcpy(p, &args[i].as.number, 8);
+                p += 8;
+                break;
+            case LOGGER_ARG_STRING: {
+                uint32_t length = (uint32_t)(args[i].as.string.length < left ? args[i].as.string.length : left);
+                memcpy(p, &length, 4);
+                memcpy(p + 4, args[i].as.string.data, length);
+                p += 4 + length;
+                left -= length;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    __atomic_store_n(&ring->head, head + size, __ATOMIC_RELEASE);
+
+    /* Wake the writer early when the ring is filling up */
+    if (head + size - tail > ring->capacity / 2) wake_writer();
+    return true;
+}
+
+void logger_flush(void) {
+    if (__atomic_load_n(&state, __ATOMIC_ACQUIRE) != RUNNING) return;
+    mutex_lock(lock);
+    uint64_t target = __atomic_add_fetch(&flush_requested, 1, __ATOMIC_ACQ_REL);
+    condvar_signal(wake);
+    while (flush_done < target) condvar_wait(flushed_cv, lock);
+    mutex_unlock(lock);
+}
+
+bool logger_open(const char *path) {
+    int fd;
+    if (strcmp(path, "-") == 0) {
+        fd = 1;
+    } else if (strcmp(path, "stderr") == 0) {
+        fd = 2;
+    } else {
+#ifdef _WIN32
+        fd = _open(path, _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, 0644);
+#else
+        fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+        if (fd < 0) return false;
+    }
+    logger_flush();
+    int old = __atomic_exchange_n(&out_fd, fd, __ATOMIC_ACQ_REL);
+    if (old > 2) {
+        /* The writer may still hold the old fd for the current batch */
+        logger_flush();
+#ifdef _WIN32
+        _close(old);
+#else
+        close(old);
+#endif
+    }
+    return true;
+}
+
+void logger_stats(LoggerStats *out) {
+    out->written = __atomic_load_n(&stats.written, __ATOMIC_RELAXED);
+    out->bytes = __atomic_load_n(&stats.bytes, __ATOMIC_RELAXED);
+    out->writes = __atomic_load_n(&stats.writes, __ATOMIC_RELAXED);
+    out->dropped = __atomic_load_n(&stats.dropped, __ATOMIC_RELAXED);
+}
+
+void logger_shutdown(void) {
+    int expected = RUNNING;
+    if (!__atomic_compare_exchange_n(&state, &expected, STARTING, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    mutex_lock(lock);
+    __atomic_store_n(&stop_requested, true, __ATOMIC_RELEASE);
+    condvar_signal(wake);
+    mutex_unlock(lock);
+    thread_join(writer);
+    free_writer();
+    int old = __atomic_exchange_n(&out_fd, 1, __ATOMIC_ACQ_REL);
+    if (old > 2) {
+#ifdef _WIN32
+        _close(old);
+#else
+        close(old);
+#endif
+    }
+    __atomic_store_n(&state, STOPPED, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,102 @@
+#ifndef RUBOLT_LOGGER_H
+#define RUBOLT_LOGGER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Asynchronous logging for the log module.
+ *
+ * A logging call does not format or write anything. It checks the level,
+ * takes a timestamp, and copies the format string and raw arguments into
+ * a ring buffer owned by the calling thread. Only that thread writes to
+ * the ring and only the writer thread reads it, so the hot path takes no
+ * lock. The writer thread drains the rings in passes, formats the lines
+ * (reusing the formatted date and time within a second), and writes them
+ * in batches with one writev per pass. When a ring is full the record is
+ * dropped and counted rather than blocking the caller.
+ *
+ * Lines from one thread come out in the order it logged them. Lines from
+ * different threads are only ordered within a pass: a record stamped just
+ * before a pass but published after it starts goes out in the next pass,
+ * behind lines from other threads with later timestamps.
+ *
+ * Lines look like
+ *   2026-10-18T09:30:00.125Z INFO  listening on port 8080
+ * where each {} in the format takes the next argument and any arguments
+ * left over are appended separated by spaces. */
+
+typedef enum {
+    LOGGER_DEBUG,
+    LOGGER_INFO,
+    LOGGER_WARN,
+    LOGGER_ERROR,
+    LOGGER_OFF
+} LoggerLevel;
+
+typedef enum {
+    LOGGER_ARG_NULL,
+    LOGGER_ARG_BOOL,
+    LOGGER_ARG_NUMBER,
+    LOGGER_ARG_STRING
+} LoggerArgType;
+
+/* An argument; strings are borrowed until logger_write returns */
+typedef struct {
+    LoggerArgType type;
+    union {
+        bool boolean;
+        double number;
+        struct {
+            const char *data;
+            size_t length;
+        } string;
+    } as;
+} LoggerArg;
+
+typedef struct {
+    uint64_t written;           /* lines written */
+    uint64_t dropped;           /* lines lost to full rings */
+    uint64_t bytes;
+    uint64_t writes;            /* writev calls */
+} LoggerStats;
+
+#define LOGGER_RING_SIZE ((size_t)1 << 20)     /* bytes per thread */
+#define LOGGER_FLUSH_MS 20                     /* writer wake-up interval */
+#define LOGGER_MAX_RECORD ((size_t)16 << 10)   /* longer records are truncated */
+
+/* ========== CONFIGURATION ========== */
+
+/* Minimum level written; the default is LOGGER_INFO */
+void logger_set_level(LoggerLevel level);
+LoggerLevel logger_level(void);
+
+/* Whether a call at this level would be recorded; check it before
+ * building expensive arguments */
+bool logger_enabled(LoggerLevel level);
+
+/* Send lines to a file (appended, created if missing), "-" for stdout or
+ * "stderr"; queued lines are written to the old destination first */
+bool logger_open(const char *path);
+
+/* "debug", "info", "warn", "error" or "off", in any case; -1 if unknown */
+int logger_level_from_name(const char *name);
+const char *logger_level_name(LoggerLevel level);
+
+/* ========== LOGGING ========== */
+
+/* Queue a line; false if it was filtered out by level or dropped. The
+ * writer thread starts on the first call. */
+bool logger_write(LoggerLevel level, const char *format, size_t format_length, const LoggerArg *args,
+                  size_t arg_count);
+
+/* Block until every line queued before the call has been written */
+void logger_flush(void);
+
+void logger_stats(LoggerStats *stats);
+
+/* Flush, stop the writer thread and close the file; logging afterwards
+ * starts it again */
+void logger_shutdown(void);
+
+#endif /* RUBOLT_LOGGER_H */
@@ -2,6 +2,7 @@
 #include "parser.h"
 #include "interpreter.h"
 #include "ast.h"
+#include "output.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -118,6 +119,7 @@ static void repl() {
 }
 
 int main(int argc, const char* argv[]) {
+    output_init();
     if (argc == 1) {
         repl();
     } else if (argc == 2) {
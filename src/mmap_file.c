@@ -0,0 +1,214 @@
+#ifndef _WIN32
+#define _DEFAULT_SOURCE     /* madvise() under -std=c99 */
+#endif
+
+#include "mmap_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* ========== MAPPING ========== */
+
+#ifdef _WIN32
+static bool read_whole_file(MappedFile *mf, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    if (size < 0) { fclose(f); return false; }
+
+    char *buf = (char *)malloc((size_t)size + 1);
+    if (!buf) { fclose(f); return false; }
+    size_t got = fread(buf, 1, (size_t)size, f);
+    fclose(f);
+    buf[got] = '\0';
+
+    mf->data = buf;
+    mf->size = got;
+    mf->is_mapped = false;
+    return true;
+}
+#else
+/* read() to EOF into a heap copy, for what cannot be mapped: pipes, FIFOs
+ * and /proc files, which report size 0 */
+static bool read_fd(MappedFile *mf, int fd) {
+    size_t capacity = 65536, size = 0;
+    char *buf = (char *)malloc(capacity);
+    if (!buf) return false;
+    for (;;) {
+        if (size == capacity) {
+            char *grown = (char *)realloc(buf, capacity * 2);
+            if (!grown) { free(buf); return false; }
+            buf = grown;
+            capacity *= 2;
+        }
+        ssize_t n = read(fd, buf + size, capacity - size);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            free(buf);
+            return false;
+        }
+        size += (size_t)n;
+    }
+    mf->data = buf;
+    mf->size = size;
+    mf->is_mapped = false;
+    return true;
+}
+#endif
+
+bool mapped_file_open(MappedFile *mf, const char *path) {
+    mf->data = NULL;
+    mf->size = 0;
+    mf->is_mapped = false;
+    if (!path) return false;
+
+#ifdef _WIN32
+    return read_whole_file(mf, path);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+
+    /* mmap() rejects zero-length mappings, and a size of 0 may just mean
+     * the kernel does not know it yet */
+    void *addr = MAP_FAILED;
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (addr == MAP_FAILED) {
+        bool ok = read_fd(mf, fd);
+        close(fd);
+        return ok;
+    }
+    close(fd);
+
+    madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    mf->data = (const char *)addr;
+    mf->size = (size_t)st.st_size;
+    mf->is_mapped = true;
+    return true;
+#endif
+}
+
+void mapped_file_close(MappedFile *mf) {
+    if (!mf || !mf->data) return;
+#ifndef _WIN32
+    if (mf->is_mapped) munmap((void *)mf->data, mf->size);
+    else
+#endif
+    free((void *)mf->data);
+    mf->data = NULL;
+    mf->size = 0;
+    mf->is_mapped = false;
+}
+
+/* ========== LINE ITERATION ========== */
+
+void mapped_lines_begin(MappedLineIter *it, const MappedFile *mf) {
+    it->pos = mf->data;
+    it->end = mf->data + mf->size;
+}
+
+bool mapped_lines_next(MappedLineIter *it, const char **line, size_t *len) {
+    if (!it->pos || it->pos >= it->end) return false;
+
+    const char *start = it->pos;
+    const char *nl = mapped_find_newline(start, it->end);
+    size_t n = (size_t)(nl - start);
+    if (n > 0 && start[n - 1] == '\r') n--;
+
+    *line = start;
+    *len = n;
+    it->pos = nl < it->end ? nl + 1 : it->end;
+    return true;
+}
+
+/* ========== SCANNERS ========== */
+
+const char *mapped_find_newline(const char *p, const char *end) {
+#if defined(__AVX2__)
+    const __m256i nl = _mm256_set1_epi8('\n');
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)p);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+#elif defined(__SSE2__)
+    const __m128i nl = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    const char *hit = (const char *)memchr(p, '\n', (size_t)(end - p));
+    return hit ? hit : end;
+}
+
+size_t mapped_count_newlines(const char *p, size_t len) {
+    size_t count = 0;
+
+    /* Per-byte counters: each matching lane subtracts -1 (0xFF). Flush them
+     * with a horizontal SAD before any lane can overflow (255 blocks). */
+#if defined(__AVX2__)
+    const __m256i nl = _mm256_set1_epi8('\n');
+    while (len >= 32) {
+        __m256i acc = _mm256_setzero_si256();
+        size_t blocks = len / 32;
+        if (blocks > 255) blocks = 255;
+        for (size_t i = 0; i < blocks; i++) {
+            __m256i chunk = _mm256_loadu_si256((const __m256i *)p);
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(chunk, nl));
+            p += 32;
+        }
+        __m256i sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+        count += (size_t)_mm256_extract_epi64(sums, 0) + (size_t)_mm256_extract_epi64(sums, 1) +
+                 (size_t)_mm256_extract_epi64(sums, 2) + (size_t)_mm256_extract_epi64(sums, 3);
+        len -= blocks * 32;
+    }
+#elif defined(__SSE2__)
+    const __m128i nl = _mm_set1_epi8('\n');
+    while (len >= 16) {
+        __m128i acc = _mm_setzero_si128();
+        size_t blocks = len / 16;
+        if (blocks > 255) blocks = 255;
+        for (size_t i = 0; i < blocks; i++) {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(chunk, nl));
+            p += 16;
+        }
+        __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+        count += (size_t)_mm_cvtsi128_si32(sums) + (size_t)_mm_extract_epi16(sums, 4);
+        len -= blocks * 16;
+    }
+#endif
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] == '\n') count++;
+    }
+    return count;
+}
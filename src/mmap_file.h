@@ -0,0 +1,48 @@
+#ifndef RUBOLT_MMAP_FILE_H
+#define RUBOLT_MMAP_FILE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Read-only view of a whole file.
+ * Backed by mmap() for regular files on POSIX; pipes, FIFOs, files that
+ * report size 0 (/proc) and other platforms get a heap copy. */
+typedef struct MappedFile {
+    const char *data;
+    size_t size;
+    bool is_mapped;             /* true if data came from mmap() */
+} MappedFile;
+
+/* Zero-copy line cursor over a MappedFile */
+typedef struct MappedLineIter {
+    const char *pos;
+    const char *end;
+} MappedLineIter;
+
+/* ========== MAPPING ========== */
+
+/* Map a file read-only with sequential access hints, or read it into
+ * memory when it cannot be mapped */
+bool mapped_file_open(MappedFile *mf, const char *path);
+
+/* Unmap / release a file */
+void mapped_file_close(MappedFile *mf);
+
+/* ========== LINE ITERATION ========== */
+
+/* Start iterating lines of a mapping */
+void mapped_lines_begin(MappedLineIter *it, const MappedFile *mf);
+
+/* Next line as a (pointer, length) slice into the mapping, without the
+ * trailing '\n' (or "\r\n"). Returns false once the mapping is exhausted. */
+bool mapped_lines_next(MappedLineIter *it, const char **line, size_t *len);
+
+/* ========== SCANNERS ========== */
+
+/* Find the next '\n' in [p, end); returns end if none (SSE2 when available) */
+const char *mapped_find_newline(const char *p, const char *end);
+
+/* Count '\n' bytes in a buffer (SSE2/AVX2 when available) */
+size_t mapped_count_newlines(const char *p, size_t len);
+
+#endif /* RUBOLT_MMAP_FILE_H */
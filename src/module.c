@@ -1,10 +1,14 @@
 #include "module.h"
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
 #include <time.h>
 #include "modules_registry.h"
+#include "packed_array.h"
+#include "vec_math.h"
+#include "output.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -142,6 +146,72 @@ static Value math_cos(Environment* env, Value* args, size_t arg_count) {
     return value_number(cos(args[0].as.number));
 }
 
+// Packed array variants (see src/vec_math.h). Array handles are numbers,
+// so these cannot share the scalar names: math.sqrt(a) would take the
+// square root of the handle.
+static PackedArray* math_array_arg(Value* args, size_t arg_count, size_t i) {
+    if (i >= arg_count || args[i].type != VAL_NUMBER) return NULL;
+    return packed_array_lookup(args[i].as.number);
+}
+
+// op(a, out?) -> array of op applied to each element, written to out
+// (resized to fit; may be a itself) or to a new array; -1 on a bad handle
+static Value math_map(VecOp op, Value* args, size_t arg_count) {
+    PackedArray* in = math_array_arg(args, arg_count, 0);
+    if (!in) return value_number(-1);
+    if (arg_count > 1) {
+        PackedArray* out = math_array_arg(args, arg_count, 1);
+        if (!out || !packed_array_resize(out, in->length)) return value_number(-1);
+        vec_map(op, in->data, out->data, in->length);
+        return args[1];
+    }
+    PackedArray* out = packed_array_new(in->length);
+    if (!out) return value_number(-1);
+    vec_map(op, in->data, out->data, in->length);
+    return value_number(packed_array_register(out));
+}
+
+static Value math_vsqrt(Environment* env, Value* args, size_t arg_count) { return math_map(VEC_SQRT, args, arg_count); }
+static Value math_vabs(Environment* env, Value* args, size_t arg_count) { return math_map(VEC_ABS, args, arg_count); }
+static Value math_vfloor(Environment* env, Value* args, size_t arg_count) { return math_map(VEC_FLOOR, args, arg_count); }
+static Value math_vceil(Environment* env, Value* args, size_t arg_count) { return math_map(VEC_CEIL, args, arg_count); }
+static Value math_vexp(Environment* env, Value* args, size_t arg_count) { return math_map(VEC_EXP, args, arg_count); }
+static Value math_vlog(Environment* env, Value* args, size_t arg_count) { return math_map(VEC_LOG, args, arg_count); }
+static Value math_vsin(Environment* env, Value* args, size_t arg_count) { return math_map(VEC_SIN, args, arg_count); }
+static Value math_vcos(Environment* env, Value* args, size_t arg_count) { return math_map(VEC_COS, args, arg_count); }
+
+static Value math_sum(Environment* env, Value* args, size_t arg_count) {
+    PackedArray* a = math_array_arg(args, arg_count, 0);
+    if (!a) return value_null();
+    return value_number(vec_sum(a->data, a->length));
+}
+
+static Value math_dot(Environment* env, Value* args, size_t arg_count) {
+    PackedArray* a = math_array_arg(args, arg_count, 0);
+    PackedArray* b = math_array_arg(args, arg_count, 1);
+    if (!a || !b || a->length != b->length) return value_null();
+    return value_number(vec_dot(a->data, b->data, a->length));
+}
+
+// matmul(a, b, rows, inner, cols) -> new rows x cols array; a and b are
+// row-major rows x inner and inner x cols
+static Value math_matmul(Environment* env, Value* args, size_t arg_count) {
+    PackedArray* a = math_array_arg(args, arg_count, 0);
+    PackedArray* b = math_array_arg(args, arg_count, 1);
+    if (!a || !b || arg_count < 5) return value_number(-1);
+    for (size_t i = 2; i < 5; i++) {
+        if (args[i].type != VAL_NUMBER || !(args[i].as.number >= 0)) return value_number(-1);
+    }
+    size_t rows = (size_t)args[2].as.number, inner = (size_t)args[3].as.number, cols = (size_t)args[4].as.number;
+    if (cols && rows > SIZE_MAX / cols) return value_number(-1);
+    if (inner && (rows > SIZE_MAX / inner || cols > SIZE_MAX / inner)) return value_number(-1);
+    if (a->length != rows * inner || b->length != inner * cols) return value_number(-1);
+    PackedArray* c = packed_array_new(rows * cols);
+    if (!c) return value_number(-1);
+    vec_matmul(a->data, b->data, c->data, rows, inner, cols);
+    return value_number(packed_array_register(c));
+}
+
 void register_math_module(ModuleSystem* ms) {
     Module* mod = module_system_load(ms, "math");
     module_register_native_function(mod, "sqrt", math_sqrt);
@@ -151,6 +221,17 @@ void register_math_module(ModuleSystem* ms) {
     module_register_native_function(mod, "ceil", math_ceil);
     module_register_native_function(mod, "sin", math_sin);
     module_register_native_function(mod, "cos", math_cos);
+    module_register_native_function(mod, "vsqrt", math_vsqrt);
+    module_register_native_function(mod, "vabs", math_vabs);
+    module_register_native_function(mod, "vfloor", math_vfloor);
+    module_register_native_function(mod, "vceil", math_vceil);
+    module_register_native_function(mod, "vexp", math_vexp);
+    module_register_native_function(mod, "vlog", math_vlog);
+    module_register_native_function(mod, "vsin", math_vsin);
+    module_register_native_function(mod, "vcos", math_vcos);
+    module_register_native_function(mod, "sum", math_sum);
+    module_register_native_function(mod, "dot", math_dot);
+    module_register_native_function(mod, "matmul", math_matmul);
 }
 
 // OS module
@@ -199,10 +280,25 @@ static Value sys_version(Environment* env, Value* args, size_t arg_count) {
     return value_string("Rubolt 1.0.0");
 }
 
+// flush() -> null; same as the flush() builtin
+static Value sys_flush(Environment* env, Value* args, size_t arg_count) {
+    output_flush();
+    return value_null();
+}
+
+// flush_interval(ms) -> bool; also flush buffered output every ms
+// milliseconds while there is some, 0 to stop
+static Value sys_flush_interval(Environment* env, Value* args, size_t arg_count) {
+    if (arg_count < 1 || args[0].type != VAL_NUMBER || !(args[0].as.number >= 0)) return value_bool(false);
+    return value_bool(output_set_flush_interval((uint64_t)args[0].as.number));
+}
+
 void register_sys_module(ModuleSystem* ms) {
     Module* mod = module_system_load(ms, "sys");
     module_register_native_function(mod, "exit", sys_exit);
     module_register_native_function(mod, "version", sys_version);
+    module_register_native_function(mod, "flush", sys_flush);
+    module_register_native_function(mod, "flush_interval", sys_flush_interval);
 }
 
 // File module
@@ -8,6 +8,17 @@ void register_file_module(ModuleSystem* ms);
 void register_json_module(ModuleSystem* ms);
 void register_time_module(ModuleSystem* ms);
 void register_http_module(ModuleSystem* ms);
+void register_net_module(ModuleSystem* ms);
+void register_regex_module(ModuleSystem* ms);
+void register_collections_module(ModuleSystem* ms);
+void register_table_module(ModuleSystem* ms);
+void register_csv_module(ModuleSystem* ms);
+void register_array_module(ModuleSystem* ms);
+void register_msgpack_module(ModuleSystem* ms);
+void register_kv_module(ModuleSystem* ms);
+void register_sqlite_module(ModuleSystem* ms);
+void register_log_module(ModuleSystem* ms);
+void register_fs_module(ModuleSystem* ms);
 
 void register_custom_modules(ModuleSystem* ms) {
     register_mod_string(ms);
@@ -17,4 +28,15 @@ void register_custom_modules(ModuleSystem* ms) {
     register_json_module(ms);
     register_time_module(ms);
     register_http_module(ms);
+    register_net_module(ms);
+    register_regex_module(ms);
+    register_collections_module(ms);
+    register_table_module(ms);
+    register_csv_module(ms);
+    register_array_module(ms);
+    register_msgpack_module(ms);
+    register_kv_module(ms);
+    register_sqlite_module(ms);
+    register_log_module(ms);
+    register_fs_module(ms);
 }
@@ -0,0 +1,362 @@
+#include "msgpack.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define MP_HOST_LITTLE 0
+#else
+#define MP_HOST_LITTLE 1
+#endif
+
+/* ========== WRITER ========== */
+
+void mp_writer_init(MpWriter *writer) {
+    memset(writer, 0, sizeof(*writer));
+}
+
+void mp_writer_free(MpWriter *writer) {
+    free(writer->data);
+    mp_writer_init(writer);
+}
+
+unsigned char *mp_writer_take(MpWriter *writer, size_t *length) {
+    unsigned char *data = writer->data;
+    *length = writer->length;
+    mp_writer_init(writer);
+    return data;
+}
+
+/* Room for `extra` more bytes; NULL once the writer has failed */
+static unsigned char *reserve(MpWriter *writer, size_t extra) {
+    if (writer->failed) return NULL;
+    if (extra > writer->capacity - writer->length) {
+        size_t capacity = writer->capacity ? writer->capacity : 256;
+        while (capacity - writer->length < extra) {
+            if (capacity > SIZE_MAX / 2) {
+                writer->failed = true;
+                return NULL;
+            }
+            capacity *= 2;
+        }
+        unsigned char *data = realloc(writer->data, capacity);
+        if (!data) {
+            writer->failed = true;
+            return NULL;
+        }
+        writer->data = data;
+        writer->capacity = capacity;
+    }
+    return writer->data + writer->length;
+}
+
+/* A type byte followed by `width` big-endian bytes of value */
+static void put_be(MpWriter *writer, unsigned char type, uint64_t value, unsigned width) {
+    unsigned char *p = reserve(writer, 1 + width);
+    if (!p) return;
+    p[0] = type;
+    for (unsigned i = 0; i < width; i++) p[1 + i] = (unsigned char)(value >> (8 * (width - 1 - i)));
+    writer->length += 1 + width;
+}
+
+static void put_bytes(MpWriter *writer, const void *data, size_t length) {
+    unsigned char *p = reserve(writer, length);
+    if (!p) return;
+    if (length) memcpy(p, data, length);
+    writer->length += length;
+}
+
+void mp_write_header(MpWriter *writer) {
+    const unsigned char header[] = { 0xd6, MP_EXT_HEADER, 'R', 'B', MP_VERSION, 0 };
+    put_bytes(writer, header, sizeof(header));
+}
+
+void mp_write_nil(MpWriter *writer) {
+    put_be(writer, 0xc0, 0, 0);
+}
+
+void mp_write_bool(MpWriter *writer, bool value) {
+    put_be(writer, value ? 0xc3 : 0xc2, 0, 0);
+}
+
+void mp_write_int(MpWriter *writer, int64_t value) {
+    if (value >= 0) {
+        uint64_t u = (uint64_t)value;
+        if (u < 0x80) put_be(writer, (unsigned char)u, 0, 0);
+        else if (u <= 0xff) put_be(writer, 0xcc, u, 1);
+        else if (u <= 0xffff) put_be(writer, 0xcd, u, 2);
+        else if (u <= 0xffffffff) put_be(writer, 0xce, u, 4);
+        else put_be(writer, 0xcf, u, 8);
+    } else {
+        if (value >= -32) put_be(writer, (unsigned char)(0xe0 | (value + 32)), 0, 0);
+        else if (value >= INT8_MIN) put_be(writer, 0xd0, (uint64_t)value, 1);
+        else if (value >= INT16_MIN) put_be(writer, 0xd1, (uint64_t)value, 2);
+        else if (value >= INT32_MIN) put_be(writer, 0xd2, (uint64_t)value, 4);
+        else put_be(writer, 0xd3, (uint64_t)value, 8);
+    }
+}
+
+void mp_write_number(MpWriter *writer, double value) {
+    /* Integral values in int64 range (but not -0) go out as integers */
+    if (value == floor(value) && value >= -9223372036854775808.0 && value < 9223372036854775808.0 &&
+        !(value == 0 && signbit(value))) {
+        mp_write_int(writer, (int64_t)value);
+        return;
+    }
+    float narrow = (float)value;
+    if ((double)narrow == value) {
+        uint32_t bits;
+        memcpy(&bits, &narrow, sizeof(bits));
+        put_be(writer, 0xca, bits, 4);
+        return;
+    }
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_be(writer, 0xcb, bits, 8);
+}
+
+/* Header of a str / bin / array / map of `count`, in the smallest form
+ * the family has; fix is the fixed-size type (0 if none) and fix_limit its
+ * largest count */
+static void put_sized(MpWriter *writer, size_t count, unsigned fix, size_t fix_limit, unsigned char type8,
+                      unsigned char type16, unsigned char type32) {
+    if (count > 0xffffffff) {
+        writer->failed = true;
+        return;
+    }
+    if (fix && count <= fix_limit) put_be(writer, (unsigned char)(fix | count), 0, 0);
+    else if (type8 && count <= 0xff) put_be(writer, type8, count, 1);
+    else if (count <= 0xffff) put_be(writer, type16, count, 2);
+    else put_be(writer, type32, count, 4);
+}
+
+void mp_write_str(MpWriter *writer, const char *data, size_t length) {
+    put_sized(writer, length, 0xa0, 31, 0xd9, 0xda, 0xdb);
+    put_bytes(writer, data, length);
+}
+
+void mp_write_bin(MpWriter *writer, const void *data, size_t length) {
+    put_sized(writer, length, 0, 0, 0xc4, 0xc5, 0xc6);
+    put_bytes(writer, data, length);
+}
+
+void mp_write_array(MpWriter *writer, uint32_t count) {
+    put_sized(writer, count, 0x90, 15, 0, 0xdc, 0xdd);
+}
+
+void mp_write_map(MpWriter *writer, uint32_t count) {
+    put_sized(writer, count, 0x80, 15, 0, 0xde, 0xdf);
+}
+
+void mp_write_f64_array(MpWriter *writer, const double *values, size_t count) {
+    if (count > (0xffffffff - 8) / 8) {
+        writer->failed = true;
+        return;
+    }
+    /* ext 8/16/32 by the padded size, then the pad length byte and padding
+     * that align the values */
+    size_t bytes = count * 8;
+    size_t most = bytes + 8;
+    unsigned char type = most <= 0xff ? 0xc7 : most <= 0xffff ? 0xc8 : 0xc9;
+    unsigned width = type == 0xc7 ? 1 : type == 0xc8 ? 2 : 4;
+    size_t start = writer->length + 1 + width + 1 + 1;
+    unsigned pad = (unsigned)((8 - start % 8) % 8);
+    put_be(writer, type, 1 + pad + bytes, width);
+    unsigned char *p = reserve(writer, 2 + pad + bytes);
+    if (!p) return;
+    p[0] = MP_EXT_F64_ARRAY;
+    p[1] = (unsigned char)pad;
+    memset(p + 2, 0, pad);
+    unsigned char *out = p + 2 + pad;
+    if (MP_HOST_LITTLE) {
+        if (bytes) memcpy(out, values, bytes);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            uint64_t bits;
+            memcpy(&bits, &values[i], sizeof(bits));
+            for (unsigned b = 0; b < 8; b++) out[8 * i + b] = (unsigned char)(bits >> (8 * b));
+        }
+    }
+    writer->length += 2 + pad + bytes;
+}
+
+/* ========== READER ========== */
+
+void mp_reader_init(MpReader *reader, const void *data, size_t length) {
+    reader->data = data;
+    reader->length = length;
+    reader->pos = 0;
+    reader->failed = false;
+}
+
+static bool fail(MpReader *reader) {
+    reader->failed = true;
+    return false;
+}
+
+/* `width` big-endian bytes, advancing past them */
+static bool take_be(MpReader *reader, unsigned width, uint64_t *value) {
+    if (reader->length - reader->pos < width) return fail(reader);
+    uint64_t v = 0;
+    for (unsigned i = 0; i < width; i++) v = v << 8 | reader->data[reader->pos + i];
+    reader->pos += width;
+    *value = v;
+    return true;
+}
+
+static bool take_bytes(MpReader *reader, size_t length, const unsigned char **data) {
+    if (reader->length - reader->pos < length) return fail(reader);
+    *data = reader->data + reader->pos;
+    reader->pos += length;
+    return true;
+}
+
+static void set_int(MpItem *item, int64_t value) {
+    item->kind = MP_INT;
+    item->integer = value;
+    item->number = (double)value;
+}
+
+static void set_uint(MpItem *item, uint64_t value) {
+    if (value <= INT64_MAX) {
+        set_int(item, (int64_t)value);
+    } else {
+        item->kind = MP_FLOAT;
+        item->number = (double)value;
+    }
+}
+
+static bool read_ext(MpReader *reader, MpItem *item, size_t length) {
+    uint64_t type;
+    const unsigned char *payload;
+    if (!take_be(reader, 1, &type) || !take_bytes(reader, length, &payload)) return false;
+    item->ext_type = (int8_t)(uint8_t)type;
+    item->data = (const char *)payload;
+    item->length = length;
+    item->kind = MP_EXT;
+    if (item->ext_type != MP_EXT_F64_ARRAY) return true;
+    if (length < 1 || payload[0] > 7 || length - 1 < payload[0] || (length - 1 - payload[0]) % 8) {
+        return fail(reader);
+    }
+    item->kind = MP_F64_ARRAY;
+    item->raw = payload + 1 + payload[0];
+    item->values_count = (length - 1 - payload[0]) / 8;
+    item->values = MP_HOST_LITTLE && (uintptr_t)item->raw % 8 == 0 ? (const double *)(const void *)item->raw : NULL;
+    return true;
+}
+
+static bool read_sized(MpReader *reader, MpItem *item, MpKind kind, size_t length) {
+    const unsigned char *data;
+    if (!take_bytes(reader, length, &data)) return false;
+    item->kind = kind;
+    item->data = (const char *)data;
+    item->length = length;
+    return true;
+}
+
+/* Every item takes at least a byte, so a count beyond the remaining input
+ * is malformed; checking here keeps decoders from sizing by it */
+static bool read_container(MpReader *reader, MpItem *item, MpKind kind, uint32_t count) {
+    uint64_t items = kind == MP_MAP ? 2 * (uint64_t)count : count;
+    if (items > reader->length - reader->pos) return fail(reader);
+    item->kind = kind;
+    item->count = count;
+    return true;
+}
+
+bool mp_read(MpReader *reader, MpItem *item) {
+    if (reader->failed || reader->pos >= reader->length) return false;
+    memset(item, 0, sizeof(*item));
+    unsigned char type = reader->data[reader->pos++];
+    uint64_t v;
+    if (type < 0x80) {
+        set_int(item, type);
+        return true;
+    }
+    if (type >= 0xe0) {
+        set_int(item, (int8_t)type);
+        return true;
+    }
+    if ((type & 0xe0) == 0x80) return read_container(reader, item, type < 0x90 ? MP_MAP : MP_ARRAY, type & 0x0f);
+    if ((type & 0xe0) == 0xa0) return read_sized(reader, item, MP_STR, type & 0x1f);
+    switch (type) {
+        case 0xc0: item->kind = MP_NIL; return true;
+        case 0xc2: case 0xc3: item->kind = MP_BOOL; item->boolean = type == 0xc3; return true;
+        case 0xc4: case 0xc5: case 0xc6:
+            if (!take_be(reader, 1u << (type - 0xc4), &v)) return false;
+            return read_sized(reader, item, MP_BIN, (size_t)v);
+        case 0xc7: case 0xc8: case 0xc9:
+            if (!take_be(reader, 1u << (type - 0xc7), &v)) return false;
+            return read_ext(reader, item, (size_t)v);
+        case 0xca: {
+            if (!take_be(reader, 4, &v)) return false;
+            uint32_t bits = (uint32_t)v;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            item->kind = MP_FLOAT;
+            item->number = f;
+            return true;
+        }
+        case 0xcb:
+            if (!take_be(reader, 8, &v)) return false;
+            item->kind = MP_FLOAT;
+            memcpy(&item->number, &v, sizeof(v));
+            return true;
+        case 0xcc: case 0xcd: case 0xce: case 0xcf:
+            if (!take_be(reader, 1u << (type - 0xcc), &v)) return false;
+            set_uint(item, v);
+            return true;
+        case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+            unsigned width = 1u << (type - 0xd0);
+            if (!take_be(reader, width, &v)) return false;
+            /* Sign-extend from the top bit of the width */
+            unsigned shift = 64 - 8 * width;
+            set_int(item, (int64_t)(v << shift) >> shift);
+            return true;
+        }
+        case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:
+            return read_ext(reader, item, (size_t)1 << (type - 0xd4));
+        case 0xd9: case 0xda: case 0xdb:
+            if (!take_be(reader, 1u << (type - 0xd9), &v)) return false;
+            return read_sized(reader, item, MP_STR, (size_t)v);
+        case 0xdc: case 0xdd: case 0xde: case 0xdf:
+            if (!take_be(reader, type == 0xdc || type == 0xde ? 2 : 4, &v)) return false;
+            return read_container(reader, item, type <= 0xdd ? MP_ARRAY : MP_MAP, (uint32_t)v);
+        default:
+            return fail(reader);    /* 0xc1 is never used */
+    }
+}
+
+bool mp_read_header(MpReader *reader, unsigned *version) {
+    MpItem item;
+    if (!mp_read(reader, &item) || item.kind != MP_EXT || item.ext_type != MP_EXT_HEADER || item.length != 4 ||
+        item.data[0] != 'R' || item.data[1] != 'B') {
+        return fail(reader);
+    }
+    *version = (unsigned char)item.data[2];
+    return *version <= MP_VERSION || fail(reader);
+}
+
+bool mp_skip(MpReader *reader) {
+    uint64_t pending = 1;
+    MpItem item;
+    while (pending) {
+        if (!mp_read(reader, &item)) return fail(reader);
+        pending--;
+        if (item.kind == MP_ARRAY) pending += item.count;
+        else if (item.kind == MP_MAP) pending += 2 * (uint64_t)item.count;
+    }
+    return true;
+}
+
+void mp_f64_copy(const MpItem *item, double *out) {
+    if (MP_HOST_LITTLE) {
+        if (item->values_count) memcpy(out, item->raw, item->values_count * 8);
+        return;
+    }
+    for (size_t i = 0; i < item->values_count; i++) {
+        uint64_t bits = 0;
+        for (unsigned b = 0; b < 8; b++) bits |= (uint64_t)item->raw[8 * i + b] << (8 * b);
+        memcpy(&out[i], &bits, sizeof(bits));
+    }
+}
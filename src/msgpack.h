@@ -0,0 +1,116 @@
+#ifndef RUBOLT_MSGPACK_H
+#define RUBOLT_MSGPACK_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Binary serialization in MessagePack.
+ *
+ * A document is a header followed by one value:
+ *
+ *   header   fixext 4, type MP_EXT_HEADER: 'R' 'B' version flags
+ *   value    any MessagePack value
+ *
+ * so generic MessagePack tools read a document as a sequence of two
+ * objects. Numbers are written as the smallest integer form when they are
+ * integral, else float32 when exact, else float64. Packed float64 arrays
+ * are ext objects of type MP_EXT_F64_ARRAY whose payload is one pad-length
+ * byte, that many zero bytes, then the values little-endian; the padding
+ * puts the values on an 8-byte boundary from the start of the document, so
+ * a reader over an aligned buffer (malloc, mmap) can hand out a `const
+ * double *` into the input.
+ *
+ * The reader is a pull parser: strings, binaries and arrays come back as
+ * views into the input, valid as long as the input is. */
+
+#define MP_VERSION 1
+
+/* Application ext types */
+#define MP_EXT_HEADER    1
+#define MP_EXT_F64_ARRAY 2
+
+/* Nesting limit for recursive decoders */
+#define MP_MAX_DEPTH 512
+
+/* ========== WRITER ========== */
+
+typedef struct {
+    unsigned char *data;
+    size_t length;
+    size_t capacity;
+    bool failed;                /* an allocation failed; data is incomplete */
+} MpWriter;
+
+void mp_writer_init(MpWriter *writer);
+void mp_writer_free(MpWriter *writer);
+
+/* Hand the bytes to the caller (who frees them) and reset the writer */
+unsigned char *mp_writer_take(MpWriter *writer, size_t *length);
+
+void mp_write_header(MpWriter *writer);
+void mp_write_nil(MpWriter *writer);
+void mp_write_bool(MpWriter *writer, bool value);
+void mp_write_int(MpWriter *writer, int64_t value);
+void mp_write_number(MpWriter *writer, double value);
+void mp_write_str(MpWriter *writer, const char *data, size_t length);
+void mp_write_bin(MpWriter *writer, const void *data, size_t length);
+
+/* Containers: the header, then `count` values (maps: key, value pairs) */
+void mp_write_array(MpWriter *writer, uint32_t count);
+void mp_write_map(MpWriter *writer, uint32_t count);
+
+void mp_write_f64_array(MpWriter *writer, const double *values, size_t count);
+
+/* ========== READER ========== */
+
+typedef enum {
+    MP_NIL,
+    MP_BOOL,
+    MP_INT,                     /* integer; uint64 above INT64_MAX is MP_FLOAT */
+    MP_FLOAT,
+    MP_STR,
+    MP_BIN,
+    MP_ARRAY,
+    MP_MAP,
+    MP_EXT,                     /* other ext types, as raw bytes */
+    MP_F64_ARRAY
+} MpKind;
+
+typedef struct {
+    MpKind kind;
+    bool boolean;
+    int64_t integer;
+    double number;              /* also set for MP_INT */
+    const char *data;           /* MP_STR, MP_BIN, MP_EXT: view into the input */
+    size_t length;
+    uint32_t count;             /* MP_ARRAY, MP_MAP: items that follow */
+    int8_t ext_type;
+    const double *values;       /* MP_F64_ARRAY: NULL unless the view is usable */
+    const unsigned char *raw;   /* MP_F64_ARRAY: the little-endian bytes */
+    size_t values_count;
+} MpItem;
+
+typedef struct {
+    const unsigned char *data;
+    size_t length;
+    size_t pos;
+    bool failed;                /* truncated or malformed input */
+} MpReader;
+
+void mp_reader_init(MpReader *reader, const void *data, size_t length);
+
+/* Check the document header; false if it is missing or from a newer
+ * version */
+bool mp_read_header(MpReader *reader, unsigned *version);
+
+/* Next item; false at the end of the input or on bad input */
+bool mp_read(MpReader *reader, MpItem *item);
+
+/* Skip one value, including everything inside containers */
+bool mp_skip(MpReader *reader);
+
+/* Copy an MP_F64_ARRAY's values out (any alignment, any host order) */
+void mp_f64_copy(const MpItem *item, double *out);
+
+#endif /* RUBOLT_MSGPACK_H */
@@ -0,0 +1,324 @@
+#ifndef _WIN32
+#define _GNU_SOURCE         /* accept4(), getaddrinfo() under -std=c99 */
+#endif
+
+#include "net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#endif
+
+#ifndef _WIN32
+
+/* ========== SOCKETS ========== */
+
+bool net_set_nonblocking(int fd, bool on) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return false;
+    flags = on ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(fd, F_SETFL, flags) == 0;
+}
+
+bool net_set_nodelay(int fd, bool on) {
+    int v = on ? 1 : 0;
+    return setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v)) == 0;
+}
+
+bool net_set_reuseport(int fd, bool on) {
+#ifdef SO_REUSEPORT
+    int v = on ? 1 : 0;
+    return setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &v, sizeof(v)) == 0;
+#else
+    (void)fd; (void)on;
+    return false;
+#endif
+}
+
+/* A peer resetting mid-write must surface as EPIPE, not kill the process */
+static void ignore_sigpipe(void) {
+    static bool done = false;
+    if (!done) {
+        signal(SIGPIPE, SIG_IGN);
+        done = true;
+    }
+}
+
+static int new_socket(int family) {
+    ignore_sigpipe();
+#ifdef SOCK_NONBLOCK
+    int fd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -errno;
+#else
+    int fd = socket(family, SOCK_STREAM, 0);
+    if (fd < 0) return -errno;
+    net_set_nonblocking(fd, true);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+    return fd;
+}
+
+static int resolve(const char *host, int port, bool passive, struct addrinfo **out) {
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    if (host && !*host) host = NULL;
+    int rc = getaddrinfo(host, service, &hints, out);
+    return rc == 0 ? 0 : -EADDRNOTAVAIL;
+}
+
+int net_listen(const char *host, int port, int backlog, int options) {
+    struct addrinfo *res;
+    int rc = resolve(host, port, true, &res);
+    if (rc < 0) return rc;
+
+    int fd = -EADDRNOTAVAIL;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = new_socket(ai->ai_family);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if ((options & NET_OPT_REUSEPORT) && !net_set_reuseport(fd, true)) { close(fd); fd = -ENOPROTOOPT; continue; }
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 &&
+            listen(fd, backlog > 0 ? backlog : NET_DEFAULT_BACKLOG) == 0) break;
+        int err = errno;
+        close(fd);
+        fd = -err;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+int net_connect_start(const char *host, int port) {
+    struct addrinfo *res;
+    int rc = resolve(host, port, false, &res);
+    if (rc < 0) return rc;
+
+    int fd = -ECONNREFUSED;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = new_socket(ai->ai_family);
+        if (fd < 0) continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 || errno == EINPROGRESS) break;
+        int err = errno;
+        close(fd);
+        fd = -err;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+int net_accept(int listen_fd) {
+    int fd;
+    do {
+#ifdef __linux__
+        fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+        fd = accept(listen_fd, NULL, NULL);
+        if (fd >= 0) { net_set_nonblocking(fd, true); fcntl(fd, F_SETFD, FD_CLOEXEC); }
+#endif
+    } while (fd < 0 && errno == EINTR);
+    return fd >= 0 ? fd : -errno;
+}
+
+int net_local_port(int fd) {
+    struct sockaddr_storage ss;
+    socklen_t len = sizeof(ss);
+    if (getsockname(fd, (struct sockaddr *)&ss, &len) != 0) return -errno;
+    if (ss.ss_family == AF_INET) return ntohs(((struct sockaddr_in *)&ss)->sin_port);
+    if (ss.ss_family == AF_INET6) return ntohs(((struct sockaddr_in6 *)&ss)->sin6_port);
+    return -EAFNOSUPPORT;
+}
+
+int64_t net_sendfile(int sock_fd, int file_fd, int64_t *offset, size_t count) {
+#ifdef __linux__
+    off_t off = (off_t)*offset;
+    ssize_t n = sendfile(sock_fd, file_fd, &off, count);
+    if (n < 0) return -errno;
+    *offset = (int64_t)off;
+    return (int64_t)n;
+#else
+    /* Bounce through a stack buffer where sendfile(2) is unavailable */
+    char buf[16384];
+    size_t want = count < sizeof(buf) ? count : sizeof(buf);
+    ssize_t got = pread(file_fd, buf, want, (off_t)*offset);
+    if (got <= 0) return got < 0 ? -errno : 0;
+    ssize_t n = write(sock_fd, buf, (size_t)got);
+    if (n < 0) return -errno;
+    *offset += n;
+    return (int64_t)n;
+#endif
+}
+
+void net_close(int fd) { if (fd >= 0) close(fd); }
+
+/* ========== ASYNC OPERATIONS ========== */
+
+static void net_op_ready(void *data);
+
+/* One attempt at the operation's syscall. Returns false on EAGAIN. */
+static bool net_op_try(NetOp *op) {
+    switch (op->kind) {
+    case NET_OP_ACCEPT: {
+        int fd = net_accept(op->fd);
+        if (fd == -EAGAIN || fd == -EWOULDBLOCK) return false;
+        if (fd >= 0 && (op->options & NET_OPT_NODELAY)) net_set_nodelay(fd, true);
+        op->result = fd;
+        return true;
+    }
+    case NET_OP_CONNECT: {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(op->fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) err = errno;
+        if (err == EINPROGRESS) return false;
+        if (err) { close(op->fd); op->result = -err; }
+        else { net_set_nodelay(op->fd, true); op->result = op->fd; }
+        return true;
+    }
+    case NET_OP_READ: {
+        ssize_t n;
+        do { n = read(op->fd, op->buffer, op->size); } while (n < 0 && errno == EINTR);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+        op->result = n < 0 ? -errno : (int)n;
+        return true;
+    }
+    case NET_OP_WRITE:
+        while (op->done < op->size) {
+            ssize_t n = write(op->fd, (const char *)op->buffer + op->done, op->size - op->done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+            if (n < 0) { op->result = -errno; return true; }
+            op->done += (size_t)n;
+        }
+        op->result = (int)op->done;
+        return true;
+    }
+    return true;
+}
+
+static void net_op_arm(NetOp *op) {
+    if (op->kind == NET_OP_WRITE || op->kind == NET_OP_CONNECT)
+        op->event_id = event_loop_add_write(op->loop, op->fd, net_op_ready, op);
+    else
+        op->event_id = event_loop_add_read(op->loop, op->fd, net_op_ready, op);
+}
+
+static void net_op_finish(NetOp *op) {
+    op->completed = true;
+    if (op->on_complete) op->on_complete(op->context);
+}
+
+static void net_op_ready(void *data) {
+    NetOp *op = (NetOp *)data;
+    op->event_id = 0;           /* One-shot: the loop already dropped it */
+    if (net_op_try(op)) net_op_finish(op);
+    else net_op_arm(op);
+}
+
+static NetOp *net_op_new(EventLoop *loop, NetOpKind kind, int fd, void *buffer, size_t size,
+                         EventCallback callback, void *context) {
+    NetOp *op = (NetOp *)calloc(1, sizeof(NetOp));
+    if (!op) return NULL;
+    op->kind = kind;
+    op->fd = fd;
+    op->buffer = buffer;
+    op->size = size;
+    op->on_complete = callback;
+    op->context = context;
+    op->loop = loop;
+    return op;
+}
+
+/* Optimistic start: most reads/writes on a warm socket never touch epoll.
+ * Completion is still delivered from the loop so callers see one path. */
+static NetOp *net_op_start(NetOp *op) {
+    if (!op) return NULL;
+    if (op->kind != NET_OP_CONNECT && net_op_try(op)) {
+        op->completed = true;
+        if (op->on_complete) event_loop_call_soon(op->loop, op->on_complete, op->context);
+        return op;
+    }
+    net_op_arm(op);
+    return op;
+}
+
+NetOp *net_async_accept(EventLoop *loop, int listen_fd, int options, EventCallback callback, void *context) {
+    NetOp *op = net_op_new(loop, NET_OP_ACCEPT, listen_fd, NULL, 0, callback, context);
+    if (op) op->options = options;
+    return net_op_start(op);
+}
+
+NetOp *net_async_connect(EventLoop *loop, const char *host, int port, EventCallback callback, void *context) {
+    int fd = net_connect_start(host, port);
+    NetOp *op = net_op_new(loop, NET_OP_CONNECT, fd, NULL, 0, callback, context);
+    if (!op) { net_close(fd); return NULL; }
+    if (fd < 0) {
+        op->result = fd;
+        op->completed = true;
+        if (callback) event_loop_call_soon(loop, callback, context);
+        return op;
+    }
+    return net_op_start(op);
+}
+
+NetOp *net_async_read(EventLoop *loop, int fd, void *buffer, size_t size, EventCallback callback, void *context) {
+    return net_op_start(net_op_new(loop, NET_OP_READ, fd, buffer, size, callback, context));
+}
+
+NetOp *net_async_write(EventLoop *loop, int fd, const void *buffer, size_t size, EventCallback callback, void *context) {
+    return net_op_start(net_op_new(loop, NET_OP_WRITE, fd, (void *)buffer, size, callback, context));
+}
+
+#else /* _WIN32: sockets are not wired into the IOCP stub yet */
+
+int net_listen(const char *host, int port, int backlog, int options) { (void)host; (void)port; (void)backlog; (void)options; return -ENOSYS; }
+int net_connect_start(const char *host, int port) { (void)host; (void)port; return -ENOSYS; }
+int net_accept(int listen_fd) { (void)listen_fd; return -ENOSYS; }
+int net_local_port(int fd) { (void)fd; return -ENOSYS; }
+bool net_set_nodelay(int fd, bool on) { (void)fd; (void)on; return false; }
+bool net_set_reuseport(int fd, bool on) { (void)fd; (void)on; return false; }
+bool net_set_nonblocking(int fd, bool on) { (void)fd; (void)on; return false; }
+int64_t net_sendfile(int sock_fd, int file_fd, int64_t *offset, size_t count) { (void)sock_fd; (void)file_fd; (void)offset; (void)count; return -ENOSYS; }
+void net_close(int fd) { (void)fd; }
+
+static NetOp *net_op_failed(EventLoop *loop, NetOpKind kind, EventCallback callback, void *context) {
+    NetOp *op = (NetOp *)calloc(1, sizeof(NetOp));
+    if (!op) return NULL;
+    op->kind = kind; op->loop = loop; op->completed = true; op->result = -ENOSYS;
+    if (callback) event_loop_call_soon(loop, callback, context);
+    return op;
+}
+
+NetOp *net_async_accept(EventLoop *loop, int listen_fd, int options, EventCallback callback, void *context) { (void)listen_fd; (void)options; return net_op_failed(loop, NET_OP_ACCEPT, callback, context); }
+NetOp *net_async_connect(EventLoop *loop, const char *host, int port, EventCallback callback, void *context) { (void)host; (void)port; return net_op_failed(loop, NET_OP_CONNECT, callback, context); }
+NetOp *net_async_read(EventLoop *loop, int fd, void *buffer, size_t size, EventCallback callback, void *context) { (void)fd; (void)buffer; (void)size; return net_op_failed(loop, NET_OP_READ, callback, context); }
+NetOp *net_async_write(EventLoop *loop, int fd, const void *buffer, size_t size, EventCallback callback, void *context) { (void)fd; (void)buffer; (void)size; return net_op_failed(loop, NET_OP_WRITE, callback, context); }
+
+#endif
+
+void net_op_release(NetOp *op) {
+    if (!op) return;
+    if (op->event_id) event_loop_remove_event(op->loop, op->event_id);
+    free(op);
+}
+
+void net_op_wait(NetOp *op) {
+    while (op && !op->completed) event_loop_run_once(op->loop);
+}
@@ -0,0 +1,80 @@
+#ifndef RUBOLT_NET_H
+#define RUBOLT_NET_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "event_loop.h"
+
+/* Non-blocking TCP sockets driven by the event loop's epoll readiness.
+ * Every socket created here is O_NONBLOCK and close-on-exec. Functions
+ * returning int give an fd / byte count, or -errno on failure. */
+
+/* Listener options */
+#define NET_OPT_REUSEPORT   0x01    /* SO_REUSEPORT: several listeners per port */
+#define NET_OPT_NODELAY     0x02    /* TCP_NODELAY on accepted sockets */
+
+#define NET_DEFAULT_BACKLOG 1024
+
+/* ========== SOCKETS ========== */
+
+/* Bind and listen on host:port (host NULL or "" = any, port 0 = ephemeral) */
+int net_listen(const char *host, int port, int backlog, int options);
+
+/* Start a connect; completes in the background (see net_async_connect) */
+int net_connect_start(const char *host, int port);
+
+/* Accept one pending connection, or -EAGAIN */
+int net_accept(int listen_fd);
+
+/* Port a socket is bound to (useful after listening on port 0) */
+int net_local_port(int fd);
+
+bool net_set_nodelay(int fd, bool on);
+bool net_set_reuseport(int fd, bool on);
+bool net_set_nonblocking(int fd, bool on);
+
+/* Send `count` bytes of file_fd starting at *offset without copying through
+ * user space (sendfile(2) on Linux); advances *offset */
+int64_t net_sendfile(int sock_fd, int file_fd, int64_t *offset, size_t count);
+
+void net_close(int fd);
+
+/* ========== ASYNC OPERATIONS ========== */
+
+typedef enum {
+    NET_OP_ACCEPT,
+    NET_OP_CONNECT,
+    NET_OP_READ,
+    NET_OP_WRITE
+} NetOpKind;
+
+/* In-flight socket operation. The syscall is tried immediately; only on
+ * EAGAIN is a one-shot readiness event armed and the call retried. */
+typedef struct NetOp {
+    NetOpKind kind;
+    int fd;
+    void *buffer;
+    size_t size;
+    size_t done;                /* Bytes written so far (writes run to completion) */
+    bool completed;
+    int result;                 /* fd / bytes (0 = EOF on read) / -errno */
+    int options;                /* NET_OPT_* applied to accepted sockets */
+    int event_id;               /* Armed readiness event, 0 if none */
+    EventCallback on_complete;
+    void *context;
+    EventLoop *loop;
+} NetOp;
+
+NetOp *net_async_accept(EventLoop *loop, int listen_fd, int options, EventCallback callback, void *context);
+NetOp *net_async_connect(EventLoop *loop, const char *host, int port, EventCallback callback, void *context);
+NetOp *net_async_read(EventLoop *loop, int fd, void *buffer, size_t size, EventCallback callback, void *context);
+NetOp *net_async_write(EventLoop *loop, int fd, const void *buffer, size_t size, EventCallback callback, void *context);
+
+/* Drop an operation's readiness registration and free it */
+void net_op_release(NetOp *op);
+
+/* Run the loop until `op` completes */
+void net_op_wait(NetOp *op);
+
+#endif /* RUBOLT_NET_H */
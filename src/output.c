@@ -0,0 +1,106 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "output.h"
+#include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+static bool initialized;
+static char *buffer;
+static bool dirty;                  /* written since the last timer flush */
+
+/* ========== BUFFER ========== */
+
+void output_init(void) {
+    if (initialized) return;
+    initialized = true;
+    if (isatty(fileno(stdout))) return;
+    buffer = malloc(OUTPUT_BUFFER_SIZE);
+    if (buffer) setvbuf(stdout, buffer, _IOFBF, OUTPUT_BUFFER_SIZE);
+}
+
+void output_write(const char *data, size_t length) {
+    if (!initialized) output_init();
+    fwrite(data, 1, length, stdout);
+    __atomic_store_n(&dirty, true, __ATOMIC_RELAXED);
+}
+
+void output_flush(void) {
+    fflush(stdout);
+    __atomic_store_n(&dirty, false, __ATOMIC_RELAXED);
+}
+
+/* ========== FLUSH TIMER ========== */
+
+static Thread *timer;
+static Mutex *timer_lock;
+static CondVar *timer_wake;
+static uint64_t interval_ms;
+
+static void *timer_main(void *arg) {
+    (void)arg;
+    mutex_lock(timer_lock);
+    while (interval_ms) {
+        condvar_wait_timeout(timer_wake, timer_lock, interval_ms);
+        if (!interval_ms || !__atomic_exchange_n(&dirty, false, __ATOMIC_RELAXED)) continue;
+        mutex_unlock(timer_lock);
+        fflush(stdout);
+        mutex_lock(timer_lock);
+    }
+    mutex_unlock(timer_lock);
+    return NULL;
+}
+
+static void stop_timer(void) {
+    if (!timer) return;
+    mutex_lock(timer_lock);
+    interval_ms = 0;
+    condvar_signal(timer_wake);
+    mutex_unlock(timer_lock);
+    thread_join(timer);
+    free(timer->name);
+    free(timer);
+    timer = NULL;
+}
+
+bool output_set_flush_interval(uint64_t ms) {
+    if (!timer_lock) {
+        timer_lock = mutex_create();
+        timer_wake = condvar_create();
+        if (!timer_lock || !timer_wake) return false;
+        /* The thread must be gone before stdio shuts down */
+        atexit(stop_timer);
+    }
+    if (timer) {
+        if (ms) {
+            mutex_lock(timer_lock);
+            interval_ms = ms;
+            condvar_signal(timer_wake);
+            mutex_unlock(timer_lock);
+            return true;
+        }
+        stop_timer();
+        return true;
+    }
+    if (!ms) return true;
+    interval_ms = ms;
+    timer = thread_create(timer_main, NULL, "output-flush");
+    if (!timer || !thread_start(timer)) {
+        if (timer) free(timer->name);
+        free(timer);
+        timer = NULL;
+        interval_ms = 0;
+        return false;
+    }
+    return true;
+}
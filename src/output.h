@@ -0,0 +1,34 @@
+#ifndef RUBOLT_OUTPUT_H
+#define RUBOLT_OUTPUT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Buffered standard output for print.
+ *
+ * The runtime gives stdout an OUTPUT_BUFFER_SIZE buffer of its own, fully
+ * buffered unless stdout is a terminal, so a script printing many lines
+ * makes one write per buffer instead of one per line. The buffer is
+ * installed with setvbuf, so other printf output from the runtime goes
+ * through it too and stays in order with print. It is written out when
+ * full, on output_flush (the flush() builtin), at exit, and every
+ * interval milliseconds once a flush timer is set. A terminal keeps line
+ * buffering so prompts and progress appear at once. */
+
+#define OUTPUT_BUFFER_SIZE ((size_t)64 << 10)
+
+/* Install the buffer; call before anything is written to stdout. Later
+ * calls do nothing. */
+void output_init(void);
+
+/* Append bytes to stdout, e.g. one whole line from print */
+void output_write(const char *data, size_t length);
+
+void output_flush(void);
+
+/* Also flush from a background thread every ms milliseconds when there is
+ * pending output; 0 stops the timer. False if the thread cannot start. */
+bool output_set_flush_interval(uint64_t ms);
+
+#endif /* RUBOLT_OUTPUT_H */
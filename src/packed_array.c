@@ -0,0 +1,97 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "packed_array.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/* ========== ARRAYS ========== */
+
+static double *aligned_values(size_t capacity) {
+    if (capacity > SIZE_MAX / sizeof(double) - PACKED_ARRAY_ALIGN) return NULL;
+    /* aligned_alloc wants a multiple of the alignment */
+    size_t bytes = (capacity * sizeof(double) + PACKED_ARRAY_ALIGN - 1) & ~(size_t)(PACKED_ARRAY_ALIGN - 1);
+    return aligned_alloc(PACKED_ARRAY_ALIGN, bytes ? bytes : PACKED_ARRAY_ALIGN);
+}
+
+static bool reserve(PackedArray *array, size_t capacity) {
+    if (capacity <= array->capacity) return true;
+    double *data = aligned_values(capacity);
+    if (!data) return false;
+    if (array->length) memcpy(data, array->data, sizeof(double) * array->length);
+    free(array->data);
+    array->data = data;
+    array->capacity = capacity;
+    return true;
+}
+
+PackedArray *packed_array_new(size_t length) {
+    PackedArray *array = calloc(1, sizeof(PackedArray));
+    if (!array) return NULL;
+    if (!reserve(array, length ? length : 8)) {
+        free(array);
+        return NULL;
+    }
+    memset(array->data, 0, sizeof(double) * length);
+    array->length = length;
+    return array;
+}
+
+PackedArray *packed_array_from(const double *data, size_t length) {
+    PackedArray *array = packed_array_new(length);
+    if (array && length) memcpy(array->data, data, sizeof(double) * length);
+    return array;
+}
+
+bool packed_array_resize(PackedArray *array, size_t length) {
+    if (length > array->capacity) {
+        size_t capacity = array->capacity * 2;
+        if (!reserve(array, capacity > length ? capacity : length)) return false;
+    }
+    if (length > array->length) memset(array->data + array->length, 0, sizeof(double) * (length - array->length));
+    array->length = length;
+    return true;
+}
+
+bool packed_array_push(PackedArray *array, double value) {
+    if (array->length == array->capacity && !reserve(array, array->capacity * 2)) return false;
+    array->data[array->length++] = value;
+    return true;
+}
+
+void packed_array_free(PackedArray *array) {
+    if (!array) return;
+    free(array->data);
+    free(array);
+}
+
+/* ========== SCRIPT HANDLES ========== */
+
+static PackedArray *g_arrays[PACKED_ARRAY_MAX_HANDLES];
+
+double packed_array_register(PackedArray *array) {
+    if (!array) return -1;
+    for (int i = 0; i < PACKED_ARRAY_MAX_HANDLES; i++) {
+        if (!g_arrays[i]) {
+            g_arrays[i] = array;
+            return i + 1;
+        }
+    }
+    packed_array_free(array);
+    return -1;
+}
+
+PackedArray *packed_array_lookup(double handle) {
+    if (!(handle >= 1 && handle <= PACKED_ARRAY_MAX_HANDLES)) return NULL;
+    return g_arrays[(int)handle - 1];
+}
+
+bool packed_array_release(double handle) {
+    PackedArray *array = packed_array_lookup(handle);
+    if (!array) return false;
+    packed_array_free(array);
+    g_arrays[(int)handle - 1] = NULL;
+    return true;
+}
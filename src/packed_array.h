@@ -0,0 +1,46 @@
+#ifndef RUBOLT_PACKED_ARRAY_H
+#define RUBOLT_PACKED_ARRAY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Packed arrays: contiguous float64 values, 64-byte aligned, for native
+ * code that works on whole arrays (CSV columns, bulk math, random fills,
+ * binary serialization). Scripts hold them by handle, like tables; the
+ * handle table is shared by every module, so an array produced by one
+ * module can be passed to another. */
+
+typedef struct PackedArray {
+    double *data;
+    size_t length;
+    size_t capacity;
+} PackedArray;
+
+#define PACKED_ARRAY_ALIGN 64
+#define PACKED_ARRAY_MAX_HANDLES 4096
+
+/* ========== ARRAYS ========== */
+
+/* Zero-filled array of `length` values */
+PackedArray *packed_array_new(size_t length);
+
+/* Copy of `length` values */
+PackedArray *packed_array_from(const double *data, size_t length);
+
+bool packed_array_resize(PackedArray *array, size_t length);
+bool packed_array_push(PackedArray *array, double value);
+void packed_array_free(PackedArray *array);
+
+/* ========== SCRIPT HANDLES ========== */
+
+/* Register an array and return its handle (> 0), or -1 when the table is
+ * full (the array is freed then) */
+double packed_array_register(PackedArray *array);
+
+/* Array for a handle, or NULL */
+PackedArray *packed_array_lookup(double handle);
+
+/* Free a registered array; false for an unknown handle */
+bool packed_array_release(double handle);
+
+#endif /* RUBOLT_PACKED_ARRAY_H */
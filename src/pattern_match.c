@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <regex.h>
+#include "regex_engine.h"
 
 // Pattern matching engine
 bool pattern_match(Pattern *pattern, Value value, Environment *env) {
@@ -55,9 +56,13 @@ bool match_literal_pattern(LiteralPattern *pattern, Value value) {
             return value.type == VALUE_NUMBER && 
                    value.as.number == pattern->as.number;
                    
-        case VALUE_STRING:
-            return value.type == VALUE_STRING && 
-                   strcmp(value.as.string, pattern->as.string) == 0;
+        case VALUE_STRING: {
+            const char *data;
+            size_t length;
+            return value_string_view(value, &data, &length) &&
+                   length == strlen(pattern->as.string) &&
+                   memcmp(data, pattern->as.string, length) == 0;
+        }
                    
         case VALUE_BOOL:
             return value.type == VALUE_BOOL && 
@@ -226,7 +231,7 @@ bool match_type_pattern(TypePattern *pattern, Value value) {
             return value.type == VALUE_NUMBER;
             
         case TYPE_STRING:
-            return value.type == VALUE_STRING;
+            return value.type == VALUE_STRING || value.type == VALUE_SLICE;
             
         case TYPE_BOOL:
             return value.type == VALUE_BOOL;
@@ -291,22 +296,33 @@ bool match_range_pattern(RangePattern *pattern, Value value) {
     }
 }
 
+// Regex patterns carry regcomp() cflags; translate them for the native
+// engine. Without REG_NEWLINE, POSIX lets '.' match a newline and anchors
+// only the ends of the subject; with it, the reverse.
+static int regex_engine_flags(int cflags) {
+    int flags = 0;
+    if (cflags & REG_ICASE) flags |= REGEX_ICASE;
+    flags |= (cflags & REG_NEWLINE) ? REGEX_MULTILINE : REGEX_DOTALL;
+    return flags;
+}
+
 bool match_regex_pattern(RegexPattern *pattern, Value value) {
-    if (value.type != VALUE_STRING) {
+    const char *data;
+    size_t length;
+    if (!value_string_view(value, &data, &length)) {
         return false;
     }
     
-    regex_t regex;
-    int result = regcomp(&regex, pattern->pattern, pattern->flags);
-    
-    if (result != 0) {
+    // Compiled once per pattern/flags and reused from the regex cache
+    Regex *regex = regex_cache_get(pattern->pattern, regex_engine_flags(pattern->flags));
+    if (!regex) {
         return false; // Invalid regex
     }
     
-    result = regexec(&regex, value.as.string, 0, NULL, 0);
-    regfree(&regex);
+    bool matched = regex_is_match(regex, data, length);
+    regex_release(regex);
     
-    return result == 0;
+    return matched;
 }
 
 bool match_constructor_pattern(ConstructorPattern *pattern, Value value, Environment *env) {
@@ -358,16 +374,18 @@ bool match_when_pattern(WhenPattern *pattern, Value value, Environment *env) {
 }
 
 bool match_slice_pattern(SlicePattern *pattern, Value value, Environment *env) {
-    if (value.type != VALUE_ARRAY && value.type != VALUE_STRING) {
+    const char *data;
+    size_t length;
+    bool is_string = value_string_view(value, &data, &length);
+    if (value.type != VALUE_ARRAY && !is_string) {
         return false;
     }
     
-    size_t length;
     if (value.type == VALUE_ARRAY) {
         Array *array = (Array *)value.as.object;
         length = array->length;
     } else {
-        length = strlen(value.as.string);
+        length = value_string_char_count(value);
     }
     
     // Calculate slice bounds
@@ -390,14 +408,16 @@ bool match_slice_pattern(SlicePattern *pattern, Value value, Environment *env) {
         
         slice_value = value_object(slice_array);
     } else {
-        char *slice_str = malloc(end - start + 1);
-        strncpy(slice_str, value.as.string + start, end - start);
-        slice_str[end - start] = '\0';
-        slice_value = value_string(slice_str);
+        // View into the matched string; bindings that keep it hold a reference
+        slice_value = value_string_char_slice(value, start, end - start);
     }
     
     // Match against pattern
-    return pattern_match(pattern->pattern, slice_value, env);
+    bool matched = pattern_match(pattern->pattern, slice_value, env);
+    if (!matched) {
+        value_release(slice_value);
+    }
+    return matched;
 }
 
 bool match_nested_pattern(NestedPattern *pattern, Value value, Environment *env) {
@@ -570,10 +590,10 @@ bool check_type_constraint(Value value, TypeConstraint *constraint) {
             return value.type == VALUE_NUMBER;
             
         case CONSTRAINT_COMPARABLE:
-            return value.type == VALUE_NUMBER || value.type == VALUE_STRING;
+            return value.type == VALUE_NUMBER || value.type == VALUE_STRING || value.type == VALUE_SLICE;
             
         case CONSTRAINT_ITERABLE:
-            return value.type == VALUE_ARRAY || value.type == VALUE_STRING;
+            return value.type == VALUE_ARRAY || value.type == VALUE_STRING || value.type == VALUE_SLICE;
             
         case CONSTRAINT_CUSTOM:
             return check_custom_constraint(value, constraint->custom_checker);
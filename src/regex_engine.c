@@ -0,0 +1,1261 @@
+#include "regex_engine.h"
+#include "str_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#ifdef _MSC_VER
+#define REGEX_THREAD_LOCAL __declspec(thread)
+#else
+#define REGEX_THREAD_LOCAL __thread
+#endif
+
+#define REGEX_MAX_PROGRAM   8192    /* Instructions; bounds {m,n} expansion */
+#define REGEX_CACHE_SIZE    64
+#define DFA_MAX_STATES      2048    /* Per DFA before the state cache is flushed */
+#define DFA_MAX_FLUSHES     8       /* Then give up on the DFA for this regex */
+#define DFA_UNKNOWN         (-2)
+#define DFA_ACCEPT_BIT      (1 << 30) /* Set on transitions into a matching state */
+
+/* ========== AST ========== */
+
+typedef enum {
+    N_EMPTY,
+    N_BYTE,
+    N_CLASS,
+    N_ANY,
+    N_CONCAT,
+    N_ALT,
+    N_REPEAT,
+    N_GROUP,
+    N_ASSERT
+} NodeKind;
+
+typedef enum {
+    A_TEXT_START,               /* ^ without REGEX_MULTILINE, \A */
+    A_TEXT_END,                 /* $ without REGEX_MULTILINE, \z */
+    A_LINE_START,
+    A_LINE_END,
+    A_WORD,
+    A_NOT_WORD
+} AssertKind;
+
+typedef struct Node {
+    NodeKind kind;
+    int value;                  /* Byte, class index, group index (-1 = non-capturing) or AssertKind */
+    int min, max;               /* Repeat bounds, max -1 = unbounded */
+    bool greedy;
+    struct Node *a, *b;
+} Node;
+
+typedef struct ByteSet {
+    uint8_t bits[32];
+} ByteSet;
+
+static void set_add(ByteSet *s, int c) { s->bits[c >> 3] |= (uint8_t)(1u << (c & 7)); }
+static bool set_has(const ByteSet *s, int c) { return (s->bits[c >> 3] >> (c & 7)) & 1; }
+
+/* ========== PROGRAM ========== */
+
+typedef enum {
+    OP_BYTE,
+    OP_CLASS,
+    OP_ANY,                     /* Any byte */
+    OP_ANY_NL,                  /* Any byte but '\n' */
+    OP_SPLIT,                   /* Try x, then y */
+    OP_JMP,
+    OP_SAVE,                    /* Record position in capture slot x */
+    OP_ASSERT,
+    OP_MATCH
+} OpCode;
+
+typedef struct Inst {
+    uint8_t op;
+    uint8_t byte;
+    int x, y;
+} Inst;
+
+typedef struct DState {
+    int *pcs;                   /* Sorted consuming / MATCH / end-assert pcs */
+    int n;
+    uint32_t hash;
+    bool match;
+    bool has_end_assert;
+} DState;
+
+typedef struct Dfa {
+    DState **states;
+    int count;
+    int *table;                 /* Open-addressed hash of state indexes, -1 = empty */
+    int *trans;                 /* [state * stride + class] = next * stride (| DFA_ACCEPT_BIT), or DFA_UNKNOWN */
+    uint8_t *accept;            /* [state] = state contains MATCH */
+    int stride;
+    int accel_off;              /* Row offset of the accelerated start state, -1 none */
+    int accel_n;                /* 1-3: escape bytes in accel[], 0: use escape[] */
+    uint8_t accel[3];
+    bool escape[256];           /* Bytes that leave the start state */
+    bool accel_built;
+    int start[2];               /* Start state for [at text start] */
+    int flushes;
+} Dfa;
+
+typedef struct Thread {
+    int pc;
+    size_t *caps;
+} Thread;
+
+typedef struct ThreadList {
+    Thread *t;
+    size_t *slab;
+    int n;
+    unsigned gen;
+} ThreadList;
+
+struct Regex {
+    Inst *prog;
+    int prog_len;
+    ByteSet *classes;
+    int class_count;
+    int flags;
+    size_t group_count;
+
+    /* Literal prefilter */
+    char *lit;
+    size_t lit_len;
+    long lit_offset;            /* Fixed distance from match start, -1 if variable */
+    bool pure_literal;          /* Whole pattern is lit */
+
+    /* Lazy DFA (unanchored) */
+    bool dfa_ok;
+    Dfa dfa;
+    uint8_t byte_class[256];
+    int byte_class_count;
+
+    /* Scratch: closure sets, marks, Pike VM lists */
+    int *set_dense, *set_sparse, set_n;
+    int *stack;
+    unsigned *mark;
+    unsigned gen;
+    ThreadList lists[2];
+    size_t *scratch;
+
+    int refcount;
+};
+
+/* ========== PARSER ========== */
+
+typedef struct Parser {
+    const char *p, *end;
+    int flags;
+    Node **nodes;
+    size_t node_count, node_cap;
+    ByteSet *classes;
+    int class_count, class_cap;
+    int group_count;
+    const char *error;
+} Parser;
+
+static Node *new_node(Parser *ps, NodeKind kind) {
+    if (ps->node_count == ps->node_cap) {
+        size_t cap = ps->node_cap ? ps->node_cap * 2 : 32;
+        Node **grown = (Node **)realloc(ps->nodes, cap * sizeof(Node *));
+        if (!grown) { ps->error = "out of memory"; return NULL; }
+        ps->nodes = grown;
+        ps->node_cap = cap;
+    }
+    Node *n = (Node *)calloc(1, sizeof(Node));
+    if (!n) { ps->error = "out of memory"; return NULL; }
+    n->kind = kind;
+    ps->nodes[ps->node_count++] = n;
+    return n;
+}
+
+static int new_class(Parser *ps) {
+    if (ps->class_count == ps->class_cap) {
+        int cap = ps->class_cap ? ps->class_cap * 2 : 8;
+        ByteSet *grown = (ByteSet *)realloc(ps->classes, (size_t)cap * sizeof(ByteSet));
+        if (!grown) { ps->error = "out of memory"; return -1; }
+        ps->classes = grown;
+        ps->class_cap = cap;
+    }
+    memset(&ps->classes[ps->class_count], 0, sizeof(ByteSet));
+    return ps->class_count++;
+}
+
+static void fold_class(ByteSet *s) {
+    for (int c = 'a'; c <= 'z'; c++) {
+        if (set_has(s, c) || set_has(s, c - 32)) { set_add(s, c); set_add(s, c - 32); }
+    }
+}
+
+static void add_shorthand(ByteSet *s, char kind) {
+    ByteSet tmp;
+    memset(&tmp, 0, sizeof(tmp));
+    char lower = (char)(kind | 0x20);
+    for (int c = 0; c < 256; c++) {
+        bool in = false;
+        if (lower == 'd') in = c >= '0' && c <= '9';
+        else if (lower == 'w') in = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        else if (lower == 's') in = c == ' ' || (c >= '\t' && c <= '\r');
+        if (in != (kind != lower)) set_add(&tmp, c);
+    }
+    for (int i = 0; i < 32; i++) s->bits[i] |= tmp.bits[i];
+}
+
+static Node *node_class_from(Parser *ps, const ByteSet *s) {
+    int idx = new_class(ps);
+    if (idx < 0) return NULL;
+    ps->classes[idx] = *s;
+    if (ps->flags & REGEX_ICASE) fold_class(&ps->classes[idx]);
+    Node *n = new_node(ps, N_CLASS);
+    if (n) n->value = idx;
+    return n;
+}
+
+static Node *node_byte(Parser *ps, int c) {
+    if ((ps->flags & REGEX_ICASE) && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+        ByteSet s;
+        memset(&s, 0, sizeof(s));
+        set_add(&s, c);
+        return node_class_from(ps, &s);
+    }
+    Node *n = new_node(ps, N_BYTE);
+    if (n) n->value = c;
+    return n;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Single-byte escape (after the backslash); -1 if `c` is not one */
+static int escape_byte(Parser *ps, char c) {
+    switch (c) {
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case 'f': return '\f';
+    case 'v': return '\v';
+    case '0': return 0;
+    case 'x':
+        if (ps->end - ps->p >= 2 && hex_value(ps->p[0]) >= 0 && hex_value(ps->p[1]) >= 0) {
+            int v = hex_value(ps->p[0]) * 16 + hex_value(ps->p[1]);
+            ps->p += 2;
+            return v;
+        }
+        ps->error = "bad \\x escape";
+        return -1;
+    default:
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) return -1;
+        return (unsigned char)c;
+    }
+}
+
+static bool posix_class(Parser *ps, ByteSet *s) {
+    static const char *names[] = { "alpha", "digit", "alnum", "space", "upper", "lower", "punct", "xdigit", "word", NULL };
+    const char *close = ps->p + 2;
+    while (close + 1 < ps->end && !(close[0] == ':' && close[1] == ']')) close++;
+    if (close + 1 >= ps->end) return false;
+    size_t len = (size_t)(close - (ps->p + 2));
+    int which = -1;
+    for (int i = 0; names[i]; i++) {
+        if (strlen(names[i]) == len && memcmp(names[i], ps->p + 2, len) == 0) which = i;
+    }
+    if (which < 0) { ps->error = "unknown POSIX class"; return false; }
+    for (int c = 0; c < 128; c++) {
+        bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'), digit = c >= '0' && c <= '9';
+        bool in = false;
+        switch (which) {
+        case 0: in = alpha; break;
+        case 1: in = digit; break;
+        case 2: in = alpha || digit; break;
+        case 3: in = c == ' ' || (c >= '\t' && c <= '\r'); break;
+        case 4: in = c >= 'A' && c <= 'Z'; break;
+        case 5: in = c >= 'a' && c <= 'z'; break;
+        case 6: in = c > 32 && c < 127 && !alpha && !digit; break;
+        case 7: in = digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); break;
+        case 8: in = alpha || digit || c == '_'; break;
+        }
+        if (in) set_add(s, c);
+    }
+    ps->p = close + 2;
+    return true;
+}
+
+static Node *parse_class(Parser *ps) {
+    ByteSet s;
+    memset(&s, 0, sizeof(s));
+    bool negate = false;
+    if (ps->p < ps->end && *ps->p == '^') { negate = true; ps->p++; }
+    bool first = true;
+    for (;;) {
+        if (ps->p >= ps->end) { ps->error = "missing ]"; return NULL; }
+        char c = *ps->p;
+        if (c == ']' && !first) { ps->p++; break; }
+        first = false;
+        if (c == '[' && ps->p + 1 < ps->end && ps->p[1] == ':') {
+            if (!posix_class(ps, &s)) { if (!ps->error) ps->error = "bad POSIX class"; return NULL; }
+            continue;
+        }
+        int lo;
+        ps->p++;
+        if (c == '\\') {
+            if (ps->p >= ps->end) { ps->error = "trailing \\"; return NULL; }
+            char e = *ps->p++;
+            if (e == 'd' || e == 'D' || e == 'w' || e == 'W' || e == 's' || e == 'S') { add_shorthand(&s, e); continue; }
+            lo = escape_byte(ps, e);
+            if (lo < 0) { if (!ps->error) ps->error = "bad escape in class"; return NULL; }
+        } else {
+            lo = (unsigned char)c;
+        }
+        int hi = lo;
+        if (ps->p + 1 < ps->end && *ps->p == '-' && ps->p[1] != ']') {
+            ps->p++;
+            char h = *ps->p++;
+            if (h == '\\') {
+                if (ps->p >= ps->end) { ps->error = "trailing \\"; return NULL; }
+                hi = escape_byte(ps, *ps->p++);
+                if (hi < 0) { if (!ps->error) ps->error = "bad escape in class"; return NULL; }
+            } else {
+                hi = (unsigned char)h;
+            }
+            if (hi < lo) { ps->error = "bad class range"; return NULL; }
+        }
+        for (int b = lo; b <= hi; b++) set_add(&s, b);
+    }
+    if (ps->flags & REGEX_ICASE) fold_class(&s);
+    if (negate) for (int i = 0; i < 32; i++) s.bits[i] = (uint8_t)~s.bits[i];
+    int idx = new_class(ps);
+    if (idx < 0) return NULL;
+    ps->classes[idx] = s;
+    Node *n = new_node(ps, N_CLASS);
+    if (n) n->value = idx;
+    return n;
+}
+
+static Node *parse_alt(Parser *ps);
+
+static Node *parse_atom(Parser *ps) {
+    char c = *ps->p++;
+    switch (c) {
+    case '(': {
+        int group = -1;
+        if (ps->end - ps->p >= 2 && ps->p[0] == '?' && ps->p[1] == ':') {
+            ps->p += 2;
+        } else {
+            group = ++ps->group_count;
+            if (group >= REGEX_MAX_GROUPS) { ps->error = "too many groups"; return NULL; }
+        }
+        Node *inner = parse_alt(ps);
+        if (!inner) return NULL;
+        if (ps->p >= ps->end || *ps->p != ')') { ps->error = "missing )"; return NULL; }
+        ps->p++;
+        Node *n = new_node(ps, N_GROUP);
+        if (!n) return NULL;
+        n->value = group;
+        n->a = inner;
+        return n;
+    }
+    case '[':
+        return parse_class(ps);
+    case '.': {
+        Node *n = new_node(ps, N_ANY);
+        return n;
+    }
+    case '^': {
+        Node *n = new_node(ps, N_ASSERT);
+        if (n) n->value = (ps->flags & REGEX_MULTILINE) ? A_LINE_START : A_TEXT_START;
+        return n;
+    }
+    case '$': {
+        Node *n = new_node(ps, N_ASSERT);
+        if (n) n->value = (ps->flags & REGEX_MULTILINE) ? A_LINE_END : A_TEXT_END;
+        return n;
+    }
+    case '\\': {
+        if (ps->p >= ps->end) { ps->error = "trailing \\"; return NULL; }
+        char e = *ps->p++;
+        if (e == 'd' || e == 'D' || e == 'w' || e == 'W' || e == 's' || e == 'S') {
+            ByteSet s;
+            memset(&s, 0, sizeof(s));
+            add_shorthand(&s, e);
+            return node_class_from(ps, &s);
+        }
+        if (e == 'b' || e == 'B' || e == 'A' || e == 'z') {
+            Node *n = new_node(ps, N_ASSERT);
+            if (n) n->value = e == 'b' ? A_WORD : e == 'B' ? A_NOT_WORD : e == 'A' ? A_TEXT_START : A_TEXT_END;
+            return n;
+        }
+        int b = escape_byte(ps, e);
+        if (b < 0) { if (!ps->error) ps->error = "unknown escape"; return NULL; }
+        return node_byte(ps, b);
+    }
+    case '*': case '+': case '?':
+        ps->error = "nothing to repeat";
+        return NULL;
+    default:
+        return node_byte(ps, (unsigned char)c);
+    }
+}
+
+/* Parse {m}, {m,} or {m,n}; false (input untouched) if not a valid bound */
+static bool parse_bounds(Parser *ps, int *min, int *max) {
+    const char *p = ps->p + 1;
+    int lo = 0, hi;
+    if (p >= ps->end || *p < '0' || *p > '9') return false;
+    while (p < ps->end && *p >= '0' && *p <= '9') { lo = lo * 10 + (*p++ - '0'); if (lo > 1000) return false; }
+    if (p < ps->end && *p == '}') { hi = lo; }
+    else if (p < ps->end && *p == ',') {
+        p++;
+        if (p < ps->end && *p == '}') hi = -1;
+        else {
+            hi = 0;
+            if (p >= ps->end || *p < '0' || *p > '9') return false;
+            while (p < ps->end && *p >= '0' && *p <= '9') { hi = hi * 10 + (*p++ - '0'); if (hi > 1000) return false; }
+            if (p >= ps->end || *p != '}' || hi < lo) return false;
+        }
+    } else return false;
+    ps->p = p + 1;
+    *min = lo;
+    *max = hi;
+    return true;
+}
+
+static Node *parse_repeat(Parser *ps) {
+    Node *atom = parse_atom(ps);
+    while (atom && ps->p < ps->end) {
+        int min, max;
+        char c = *ps->p;
+        if (c == '*') { min = 0; max = -1; ps->p++; }
+        else if (c == '+') { min = 1; max = -1; ps->p++; }
+        else if (c == '?') { min = 0; max = 1; ps->p++; }
+        else if (c == '{' && parse_bounds(ps, &min, &max)) {}
+        else break;
+        if (atom->kind == N_ASSERT) { ps->error = "nothing to repeat"; return NULL; }
+        Node *n = new_node(ps, N_REPEAT);
+        if (!n) return NULL;
+        n->min = min;
+        n->max = max;
+        n->greedy = true;
+        if (ps->p < ps->end && *ps->p == '?') { n->greedy = false; ps->p++; }
+        n->a = atom;
+        atom = n;
+    }
+    return atom;
+}
+
+static Node *parse_concat(Parser *ps) {
+    Node *result = NULL;
+    while (ps->p < ps->end && *ps->p != '|' && *ps->p != ')') {
+        Node *item = parse_repeat(ps);
+        if (!item) return NULL;
+        if (!result) { result = item; continue; }
+        Node *cat = new_node(ps, N_CONCAT);
+        if (!cat) return NULL;
+        cat->a = result;
+        cat->b = item;
+        result = cat;
+    }
+    return result ? result : new_node(ps, N_EMPTY);
+}
+
+static Node *parse_alt(Parser *ps) {
+    Node *left = parse_concat(ps);
+    while (left && ps->p < ps->end && *ps->p == '|') {
+        ps->p++;
+        Node *right = parse_concat(ps);
+        if (!right) return NULL;
+        Node *alt = new_node(ps, N_ALT);
+        if (!alt) return NULL;
+        alt->a = left;
+        alt->b = right;
+        left = alt;
+    }
+    return left;
+}
+
+/* ========== COMPILER ========== */
+
+typedef struct Compiler {
+    Regex *re;
+    int cap;
+    const char *error;
+    bool needs_nfa;             /* Uses assertions the DFA cannot evaluate */
+} Compiler;
+
+static int emit(Compiler *cc, OpCode op, int x, int y) {
+    Regex *re = cc->re;
+    if (re->prog_len >= REGEX_MAX_PROGRAM) { cc->error = "pattern too large"; return -1; }
+    if (re->prog_len == cc->cap) {
+        int cap = cc->cap ? cc->cap * 2 : 64;
+        Inst *grown = (Inst *)realloc(re->prog, (size_t)cap * sizeof(Inst));
+        if (!grown) { cc->error = "out of memory"; return -1; }
+        re->prog = grown;
+        cc->cap = cap;
+    }
+    Inst *in = &re->prog[re->prog_len];
+    in->op = (uint8_t)op;
+    in->byte = 0;
+    in->x = x;
+    in->y = y;
+    return re->prog_len++;
+}
+
+static bool compile_node(Compiler *cc, const Node *n) {
+    Regex *re = cc->re;
+    int pc;
+    switch (n->kind) {
+    case N_EMPTY:
+        return true;
+    case N_BYTE:
+        if ((pc = emit(cc, OP_BYTE, 0, 0)) < 0) return false;
+        re->prog[pc].byte = (uint8_t)n->value;
+        return true;
+    case N_CLASS:
+        return emit(cc, OP_CLASS, n->value, 0) >= 0;
+    case N_ANY:
+        return emit(cc, (re->flags & REGEX_DOTALL) ? OP_ANY : OP_ANY_NL, 0, 0) >= 0;
+    case N_ASSERT:
+        if (n->value != A_TEXT_START && n->value != A_TEXT_END) cc->needs_nfa = true;
+        return emit(cc, OP_ASSERT, n->value, 0) >= 0;
+    case N_CONCAT:
+        return compile_node(cc, n->a) && compile_node(cc, n->b);
+    case N_GROUP:
+        if (n->value < 0) return compile_node(cc, n->a);
+        return emit(cc, OP_SAVE, 2 * n->value, 0) >= 0 && compile_node(cc, n->a) &&
+               emit(cc, OP_SAVE, 2 * n->value + 1, 0) >= 0;
+    case N_ALT: {
+        int split = emit(cc, OP_SPLIT, 0, 0);
+        if (split < 0) return false;
+        re->prog[split].x = re->prog_len;
+        if (!compile_node(cc, n->a)) return false;
+        int jmp = emit(cc, OP_JMP, 0, 0);
+        if (jmp < 0) return false;
+        re->prog[split].y = re->prog_len;
+        if (!compile_node(cc, n->b)) return false;
+        re->prog[jmp].x = re->prog_len;
+        return true;
+    }
+    case N_REPEAT: {
+        for (int i = 0; i < n->min; i++) {
+            if (!compile_node(cc, n->a)) return false;
+        }
+        if (n->max < 0) {
+            int loop = emit(cc, OP_SPLIT, 0, 0);
+            if (loop < 0 || !compile_node(cc, n->a) || emit(cc, OP_JMP, loop, 0) < 0) return false;
+            re->prog[loop].x = n->greedy ? loop + 1 : re->prog_len;
+            re->prog[loop].y = n->greedy ? re->prog_len : loop + 1;
+            return true;
+        }
+        int optional = n->max - n->min;
+        int *splits = optional > 0 ? (int *)malloc(sizeof(int) * (size_t)optional) : NULL;
+        if (optional > 0 && !splits) { cc->error = "out of memory"; return false; }
+        for (int i = 0; i < optional; i++) {
+            splits[i] = emit(cc, OP_SPLIT, 0, 0);
+            if (splits[i] < 0 || !compile_node(cc, n->a)) { free(splits); return false; }
+        }
+        for (int i = 0; i < optional; i++) {
+            int body = splits[i] + 1;
+            re->prog[splits[i]].x = n->greedy ? body : re->prog_len;
+            re->prog[splits[i]].y = n->greedy ? re->prog_len : body;
+        }
+        free(splits);
+        return true;
+    }
+    }
+    return false;
+}
+
+/* ========== LITERAL EXTRACTION ========== */
+
+static void flatten(const Node *n, const Node **items, size_t *count, size_t cap) {
+    if (*count >= cap) return;
+    if (n->kind == N_CONCAT) {
+        flatten(n->a, items, count, cap);
+        flatten(n->b, items, count, cap);
+    } else if (n->kind == N_GROUP) {
+        flatten(n->a, items, count, cap);
+    } else if (n->kind != N_EMPTY) {
+        items[(*count)++] = n;
+    }
+}
+
+/* Pick the longest run of literal bytes every match must contain */
+static void extract_literal(Regex *re, const Node *root, size_t node_total) {
+    const Node **items = (const Node **)malloc(sizeof(Node *) * (node_total + 1));
+    if (!items) return;
+    size_t count = 0;
+    flatten(root, items, &count, node_total + 1);
+
+    size_t best_start = 0, best_len = 0;
+    for (size_t i = 0; i < count;) {
+        if (items[i]->kind != N_BYTE) { i++; continue; }
+        size_t j = i;
+        while (j < count && items[j]->kind == N_BYTE) j++;
+        if (j - i > best_len) { best_start = i; best_len = j - i; }
+        i = j;
+    }
+
+    if (best_len > 0) {
+        re->lit = (char *)malloc(best_len);
+        if (re->lit) {
+            for (size_t k = 0; k < best_len; k++) re->lit[k] = (char)items[best_start + k]->value;
+            re->lit_len = best_len;
+            long offset = 0;
+            for (size_t k = 0; k < best_start && offset >= 0; k++) {
+                NodeKind kind = items[k]->kind;
+                if (kind == N_BYTE || kind == N_CLASS || kind == N_ANY) offset++;
+                else if (kind != N_ASSERT) offset = -1;
+            }
+            re->lit_offset = offset;
+            re->pure_literal = best_len == count && re->group_count == 0;
+        }
+    }
+    free(items);
+}
+
+/* ========== BYTE CLASSES ========== */
+
+/* Bytes no instruction can tell apart share a DFA column */
+static void compute_byte_classes(Regex *re) {
+    bool boundary[257];
+    memset(boundary, 0, sizeof(boundary));
+    boundary['\n'] = boundary['\n' + 1] = true;
+    for (int pc = 0; pc < re->prog_len; pc++) {
+        const Inst *in = &re->prog[pc];
+        if (in->op == OP_BYTE) {
+            boundary[in->byte] = boundary[in->byte + 1] = true;
+        } else if (in->op == OP_CLASS) {
+            const ByteSet *s = &re->classes[in->x];
+            for (int c = 1; c < 256; c++) {
+                if (set_has(s, c) != set_has(s, c - 1)) boundary[c] = true;
+            }
+        }
+    }
+    int cls = 0;
+    for (int c = 0; c < 256; c++) {
+        if (c > 0 && boundary[c]) cls++;
+        re->byte_class[c] = (uint8_t)cls;
+    }
+    re->byte_class_count = cls + 1;
+}
+
+/* ========== COMPILATION ========== */
+
+static void dfa_reset(Regex *re);
+
+Regex *regex_compile(const char *pattern, int flags, const char **error) {
+    const char *dummy;
+    if (!error) error = &dummy;
+    *error = NULL;
+    if (!pattern) { *error = "null pattern"; return NULL; }
+
+    Parser ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.p = pattern;
+    ps.end = pattern + strlen(pattern);
+    ps.flags = flags;
+
+    Node *root = parse_alt(&ps);
+    if (root && ps.p < ps.end) ps.error = "unmatched )";
+
+    Regex *re = NULL;
+    if (root && !ps.error) re = (Regex *)calloc(1, sizeof(Regex));
+    if (re) {
+        re->flags = flags;
+        re->group_count = (size_t)ps.group_count;
+        re->classes = ps.classes;
+        re->class_count = ps.class_count;
+        ps.classes = NULL;
+        re->lit_offset = -1;
+        re->refcount = 1;
+
+        Compiler cc;
+        memset(&cc, 0, sizeof(cc));
+        cc.re = re;
+        bool ok = emit(&cc, OP_SAVE, 0, 0) >= 0 && compile_node(&cc, root) &&
+                  emit(&cc, OP_SAVE, 1, 0) >= 0 && emit(&cc, OP_MATCH, 0, 0) >= 0;
+        if (!ok) {
+            ps.error = cc.error ? cc.error : "compile failed";
+        } else {
+            extract_literal(re, root, ps.node_count);
+            compute_byte_classes(re);
+            re->dfa_ok = !cc.needs_nfa;
+
+            size_t n = (size_t)re->prog_len;
+            size_t slots = 2 * (re->group_count + 1);
+            re->set_dense = (int *)malloc(n * sizeof(int));
+            re->set_sparse = (int *)calloc(n, sizeof(int));
+            re->stack = (int *)malloc((2 * n + 2) * sizeof(int));
+            re->mark = (unsigned *)calloc(n, sizeof(unsigned));
+            re->scratch = (size_t *)malloc(slots * sizeof(size_t));
+            for (int i = 0; i < 2; i++) {
+                re->lists[i].t = (Thread *)malloc(n * sizeof(Thread));
+                re->lists[i].slab = (size_t *)malloc(n * slots * sizeof(size_t));
+            }
+            re->dfa.table = (int *)malloc(sizeof(int) * DFA_MAX_STATES * 2);
+            re->dfa.states = (DState **)malloc(sizeof(DState *) * DFA_MAX_STATES);
+            re->dfa.stride = re->byte_class_count;
+            re->dfa.trans = (int *)malloc(sizeof(int) * DFA_MAX_STATES * (size_t)re->dfa.stride);
+            re->dfa.accept = (uint8_t *)malloc(DFA_MAX_STATES);
+            if (!re->set_dense || !re->set_sparse || !re->stack || !re->mark || !re->scratch ||
+                !re->lists[0].t || !re->lists[0].slab || !re->lists[1].t || !re->lists[1].slab ||
+                !re->dfa.table || !re->dfa.states || !re->dfa.trans || !re->dfa.accept) {
+                ps.error = "out of memory";
+            } else {
+                dfa_reset(re);
+            }
+        }
+        if (ps.error) {
+            regex_free(re);
+            re = NULL;
+        }
+    }
+
+    for (size_t i = 0; i < ps.node_count; i++) free(ps.nodes[i]);
+    free(ps.nodes);
+    free(ps.classes);
+    if (!re) *error = ps.error ? ps.error : "out of memory";
+    return re;
+}
+
+void regex_free(Regex *re) {
+    if (!re) return;
+    if (re->dfa.states) {
+        for (int i = 0; i < re->dfa.count; i++) { free(re->dfa.states[i]->pcs); free(re->dfa.states[i]); }
+    }
+    free(re->dfa.states);
+    free(re->dfa.table);
+    free(re->dfa.trans);
+    free(re->dfa.accept);
+    free(re->prog);
+    free(re->classes);
+    free(re->lit);
+    free(re->set_dense);
+    free(re->set_sparse);
+    free(re->stack);
+    free(re->mark);
+    free(re->scratch);
+    for (int i = 0; i < 2; i++) { free(re->lists[i].t); free(re->lists[i].slab); }
+    free(re);
+}
+
+size_t regex_group_count(const Regex *re) { return re->group_count; }
+
+/* ========== SHARED HELPERS ========== */
+
+static bool consumes(const Regex *re, const Inst *in, int c) {
+    switch (in->op) {
+    case OP_BYTE:   return in->byte == c;
+    case OP_CLASS:  return set_has(&re->classes[in->x], c);
+    case OP_ANY:    return true;
+    case OP_ANY_NL: return c != '\n';
+    default:        return false;
+    }
+}
+
+static bool is_word(int c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool assert_holds(int kind, const char *text, size_t len, size_t pos) {
+    switch (kind) {
+    case A_TEXT_START: return pos == 0;
+    case A_TEXT_END:   return pos == len;
+    case A_LINE_START: return pos == 0 || text[pos - 1] == '\n';
+    case A_LINE_END:   return pos == len || text[pos] == '\n';
+    case A_WORD:
+    case A_NOT_WORD: {
+        bool before = pos > 0 && is_word((unsigned char)text[pos - 1]);
+        bool after = pos < len && is_word((unsigned char)text[pos]);
+        return (before != after) == (kind == A_WORD);
+    }
+    }
+    return false;
+}
+
+/* ========== LAZY DFA ========== */
+/* States are sets of NFA pcs; transitions are computed on first use and
+ * memoized per byte class. Only text-start/text-end assertions are
+ * allowed here: start states are built for "at offset 0" and "later", and
+ * end assertions stay pending in the state until the input runs out. */
+
+static void dfa_reset(Regex *re) {
+    Dfa *d = &re->dfa;
+    for (int i = 0; i < d->count; i++) { free(d->states[i]->pcs); free(d->states[i]); }
+    d->count = 0;
+    for (int i = 0; i < DFA_MAX_STATES * 2; i++) d->table[i] = -1;
+    d->start[0] = d->start[1] = -1;
+    d->accel_off = -1;
+    d->accel_built = false;
+}
+
+static void set_clear(Regex *re) { re->set_n = 0; }
+
+static bool set_contains(const Regex *re, int pc) {
+    int i = re->set_sparse[pc];
+    return i >= 0 && i < re->set_n && re->set_dense[i] == pc;
+}
+
+static void set_insert(Regex *re, int pc) {
+    if (set_contains(re, pc)) return;
+    re->set_sparse[pc] = re->set_n;
+    re->set_dense[re->set_n++] = pc;
+}
+
+/* Add the epsilon closure of `pc` to the current set */
+static void closure(Regex *re, int pc, bool at_start, bool at_end) {
+    unsigned gen = ++re->gen;
+    int sp = 0;
+    re->stack[sp++] = pc;
+    while (sp > 0) {
+        pc = re->stack[--sp];
+        if (re->mark[pc] == gen) continue;
+        re->mark[pc] = gen;
+        const Inst *in = &re->prog[pc];
+        switch (in->op) {
+        case OP_JMP:
+            re->stack[sp++] = in->x;
+            break;
+        case OP_SPLIT:
+            re->stack[sp++] = in->y;
+            re->stack[sp++] = in->x;
+            break;
+        case OP_SAVE:
+            re->stack[sp++] = pc + 1;
+            break;
+        case OP_ASSERT:
+            if (in->x == A_TEXT_START) { if (at_start) re->stack[sp++] = pc + 1; }
+            else if (at_end) re->stack[sp++] = pc + 1;
+            else set_insert(re, pc);        /* pending end assertion */
+            break;
+        default:
+            set_insert(re, pc);
+            break;
+        }
+    }
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/* Intern the current set as a state; -1 if the cache is full */
+static int dfa_intern(Regex *re) {
+    Dfa *d = &re->dfa;
+    qsort(re->set_dense, (size_t)re->set_n, sizeof(int), cmp_int);
+    for (int i = 0; i < re->set_n; i++) re->set_sparse[re->set_dense[i]] = i;
+
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < re->set_n; i++) h = (h ^ (uint32_t)re->set_dense[i]) * 16777619u;
+
+    unsigned mask = DFA_MAX_STATES * 2 - 1;
+    unsigned slot = h & mask;
+    while (d->table[slot] >= 0) {
+        DState *s = d->states[d->table[slot]];
+        if (s->hash == h && s->n == re->set_n && memcmp(s->pcs, re->set_dense, sizeof(int) * (size_t)s->n) == 0)
+            return d->table[slot];
+        slot = (slot + 1) & mask;
+    }
+    if (d->count >= DFA_MAX_STATES) return -1;
+
+    DState *s = (DState *)malloc(sizeof(DState));
+    if (!s) return -1;
+    s->pcs = (int *)malloc(sizeof(int) * (size_t)(re->set_n ? re->set_n : 1));
+    if (!s->pcs) { free(s); return -1; }
+    memcpy(s->pcs, re->set_dense, sizeof(int) * (size_t)re->set_n);
+    s->n = re->set_n;
+    s->hash = h;
+    s->match = false;
+    s->has_end_assert = false;
+    for (int i = 0; i < s->n; i++) {
+        uint8_t op = re->prog[s->pcs[i]].op;
+        if (op == OP_MATCH) s->match = true;
+        else if (op == OP_ASSERT) s->has_end_assert = true;
+    }
+    int *row = d->trans + (size_t)d->count * (size_t)d->stride;
+    for (int i = 0; i < d->stride; i++) row[i] = DFA_UNKNOWN;
+    d->accept[d->count] = s->match;
+    d->states[d->count] = s;
+    d->table[slot] = d->count;
+    return d->count++;
+}
+
+static int dfa_start(Regex *re, bool at_start) {
+    Dfa *d = &re->dfa;
+    if (d->start[at_start] >= 0) return d->start[at_start];
+    set_clear(re);
+    closure(re, 0, at_start, false);
+    d->start[at_start] = dfa_intern(re);
+    return d->start[at_start];
+}
+
+/* Successor of state `si` on byte c; unanchored search re-seeds the start
+ * closure at every position */
+static int dfa_step(Regex *re, int si, int c) {
+    DState *s = re->dfa.states[si];
+    set_clear(re);
+    for (int i = 0; i < s->n; i++) {
+        const Inst *in = &re->prog[s->pcs[i]];
+        if (consumes(re, in, c)) closure(re, s->pcs[i] + 1, false, false);
+    }
+    closure(re, 0, false, false);
+    return dfa_intern(re);
+}
+
+static bool dfa_accepts_at_end(Regex *re, int si, size_t pos) {
+    DState *s = re->dfa.states[si];
+    if (s->match) return true;
+    if (!s->has_end_assert) return false;
+    int n = s->n;
+    int *pcs = (int *)malloc(sizeof(int) * (size_t)n);
+    if (!pcs) return false;
+    memcpy(pcs, s->pcs, sizeof(int) * (size_t)n);
+    bool found = false;
+    for (int i = 0; i < n && !found; i++) {
+        if (re->prog[pcs[i]].op != OP_ASSERT) continue;
+        set_clear(re);
+        closure(re, pcs[i] + 1, pos == 0, true);
+        for (int k = 0; k < re->set_n; k++) {
+            if (re->prog[re->set_dense[k]].op == OP_MATCH) found = true;
+        }
+    }
+    free(pcs);
+    return found;
+}
+
+/* Fill in the transition of *si on byte c. A full state cache is flushed
+ * and *si re-interned. Returns the encoded trans entry or -1 if the DFA
+ * gave up. */
+static int dfa_fill(Regex *re, int *si, int c) {
+    Dfa *d = &re->dfa;
+    int next = dfa_step(re, *si, c);
+    if (next < 0) {
+        if (++d->flushes > DFA_MAX_FLUSHES) { re->dfa_ok = false; return -1; }
+        DState *cur = d->states[*si];
+        int n = cur->n;
+        int *pcs = (int *)malloc(sizeof(int) * (size_t)(n ? n : 1));
+        if (!pcs) return -1;
+        memcpy(pcs, cur->pcs, sizeof(int) * (size_t)n);
+        dfa_reset(re);
+        set_clear(re);
+        for (int k = 0; k < n; k++) set_insert(re, pcs[k]);
+        free(pcs);
+        if ((*si = dfa_intern(re)) < 0) return -1;
+        if ((next = dfa_step(re, *si, c)) < 0) return -1;
+    }
+    int encoded = next * d->stride | (d->accept[next] ? DFA_ACCEPT_BIT : 0);
+    d->trans[(size_t)*si * (size_t)d->stride + re->byte_class[c]] = encoded;
+    return encoded;
+}
+
+/* The unanchored start state loops on most bytes. Record which bytes leave
+ * it so the scan can skip ahead (memchr-style) while nothing is in flight. */
+static void dfa_build_accel(Regex *re) {
+    Dfa *d = &re->dfa;
+    d->accel_built = true;
+    int si = dfa_start(re, false);
+    if (si < 0) return;
+    int flushes = d->flushes;
+    int off = si * d->stride;
+    int count = 0;
+    for (int c = 0; c < 256; c++) {
+        int next = d->trans[off + re->byte_class[c]];
+        if (next < 0 && (next = dfa_fill(re, &si, c)) < 0) return;
+        if (d->flushes != flushes) return;
+        d->escape[c] = next != off;
+        if (d->escape[c] && count++ < 3) d->accel[count - 1] = (uint8_t)c;
+    }
+    if (count > 128) return;    /* mostly escapes: skipping would not pay */
+    d->accel_n = count <= 3 ? count : 0;
+    d->accel_off = off;
+}
+
+/* First i >= from where text[i] leaves the start state */
+static size_t dfa_skip(const Dfa *d, const uint8_t *p, size_t i, size_t len) {
+    if (d->accel_n == 1) {
+        const void *hit = memchr(p + i, d->accel[0], len - i);
+        return hit ? (size_t)((const uint8_t *)hit - p) : len;
+    }
+#if defined(__SSE2__)
+    if (d->accel_n > 1) {
+        const __m128i a = _mm_set1_epi8((char)d->accel[0]);
+        const __m128i b = _mm_set1_epi8((char)d->accel[1]);
+        const __m128i c = _mm_set1_epi8((char)d->accel[d->accel_n - 1]);
+        for (; i + 16 <= len; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+            __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, a), _mm_cmpeq_epi8(v, b)), _mm_cmpeq_epi8(v, c));
+            unsigned mask = (unsigned)_mm_movemask_epi8(eq);
+            if (mask) return i + (unsigned)__builtin_ctz(mask);
+        }
+    }
+#endif
+    while (i < len && !d->escape[p[i]]) i++;
+    return i;
+}
+
+/* 1 = some match starts at or after `from`, 0 = none, -1 = DFA gave up */
+static int dfa_run(Regex *re, const char *text, size_t len, size_t from) {
+    int si = dfa_start(re, from == 0);
+    if (si < 0) return -1;
+    Dfa *d = &re->dfa;
+    const uint8_t *p = (const uint8_t *)text;
+    const uint8_t *classes = re->byte_class;
+    const int stride = d->stride;
+    int off = si * stride;          /* Row offset of the current state */
+    if (d->accept[si]) return 1;
+    if (!d->accel_built) {
+        dfa_build_accel(re);
+        si = dfa_start(re, from == 0);
+        if (si < 0) return -1;
+        off = si * stride;
+    }
+    for (size_t i = from; i < len; i++) {
+        if (off == d->accel_off && (i = dfa_skip(d, p, i, len)) >= len) break;
+        int next = d->trans[off + classes[p[i]]];
+        if (next & ~(DFA_ACCEPT_BIT - 1)) {
+            if (next < 0) {
+                si = off / stride;
+                if ((next = dfa_fill(re, &si, p[i])) < 0) return -1;
+            }
+            if (next & DFA_ACCEPT_BIT) return 1;
+        }
+        off = next;
+    }
+    return dfa_accepts_at_end(re, off / stride, len) ? 1 : 0;
+}
+
+/* ========== PIKE VM ========== */
+
+static void add_thread(Regex *re, ThreadList *list, int pc, size_t *caps, size_t nslots,
+                       const char *text, size_t len, size_t pos) {
+    if (re->mark[pc] == list->gen) return;
+    re->mark[pc] = list->gen;
+    const Inst *in = &re->prog[pc];
+    switch (in->op) {
+    case OP_JMP:
+        add_thread(re, list, in->x, caps, nslots, text, len, pos);
+        return;
+    case OP_SPLIT:
+        add_thread(re, list, in->x, caps, nslots, text, len, pos);
+        add_thread(re, list, in->y, caps, nslots, text, len, pos);
+        return;
+    case OP_SAVE:
+        if ((size_t)in->x < nslots) {
+            size_t old = caps[in->x];
+            caps[in->x] = pos;
+            add_thread(re, list, pc + 1, caps, nslots, text, len, pos);
+            caps[in->x] = old;
+        } else {
+            add_thread(re, list, pc + 1, caps, nslots, text, len, pos);
+        }
+        return;
+    case OP_ASSERT:
+        if (assert_holds(in->x, text, len, pos)) add_thread(re, list, pc + 1, caps, nslots, text, len, pos);
+        return;
+    default: {
+        Thread *t = &list->t[list->n];
+        t->pc = pc;
+        t->caps = list->slab + (size_t)list->n * nslots;
+        if (nslots) memcpy(t->caps, caps, nslots * sizeof(size_t));
+        list->n++;
+        return;
+    }
+    }
+}
+
+/* Leftmost-first match at or after `from`; `nslots` capture slots (0 when
+ * only a yes/no answer is needed) are written to `out` */
+static bool pike_search(Regex *re, const char *text, size_t len, size_t from, size_t nslots, size_t *out) {
+    ThreadList *clist = &re->lists[0], *nlist = &re->lists[1];
+    size_t *init = re->scratch;
+    bool matched = false;
+
+    clist->n = 0;
+    clist->gen = ++re->gen;
+    for (size_t pos = from; pos <= len; pos++) {
+        if (!matched) {
+            for (size_t i = 0; i < nslots; i++) init[i] = REGEX_NO_POS;
+            add_thread(re, clist, 0, init, nslots, text, len, pos);
+        }
+        if (clist->n == 0 && matched) break;
+
+        nlist->n = 0;
+        nlist->gen = ++re->gen;
+        int c = pos < len ? (unsigned char)text[pos] : -1;
+        for (int i = 0; i < clist->n; i++) {
+            Thread *t = &clist->t[i];
+            const Inst *in = &re->prog[t->pc];
+            if (in->op == OP_MATCH) {
+                matched = true;
+                if (nslots) memcpy(out, t->caps, nslots * sizeof(size_t));
+                if (!nslots) return true;
+                break;          /* lower-priority threads lose */
+            }
+            if (c >= 0 && consumes(re, in, c)) {
+                if (nslots) memcpy(re->scratch, t->caps, nslots * sizeof(size_t));
+                add_thread(re, nlist, t->pc + 1, re->scratch, nslots, text, len, pos + 1);
+            }
+        }
+        ThreadList *tmp = clist;
+        clist = nlist;
+        nlist = tmp;
+    }
+    return matched;
+}
+
+/* ========== MATCHING ========== */
+
+/* Earliest offset a match starting at or after `from` could begin, using
+ * the required literal; false if the literal does not occur */
+static bool prefilter(const Regex *re, const char *text, size_t len, size_t *from, size_t *lit_pos) {
+    if (!re->lit) return true;
+    size_t hit = regex_find_literal(text + *from, len - *from, re->lit, re->lit_len);
+    if (hit == REGEX_NO_POS) return false;
+    hit += *from;
+    *lit_pos = hit;
+    if (re->lit_offset >= 0 && hit >= (size_t)re->lit_offset + *from) *from = hit - (size_t)re->lit_offset;
+    return true;
+}
+
+bool regex_is_match(Regex *re, const char *text, size_t len) {
+    size_t from = 0, lit_pos = 0;
+    if (!prefilter(re, text, len, &from, &lit_pos)) return false;
+    if (re->pure_literal) return true;
+    if (re->dfa_ok) {
+        int r = dfa_run(re, text, len, from);
+        if (r >= 0) return r == 1;
+    }
+    return pike_search(re, text, len, from, 0, NULL);
+}
+
+bool regex_search(Regex *re, const char *text, size_t len, size_t start, RegexSpan *groups) {
+    if (start > len) return false;
+    size_t from = start, lit_pos = 0;
+    if (!prefilter(re, text, len, &from, &lit_pos)) return false;
+    if (re->pure_literal) {
+        groups[0].start = lit_pos;
+        groups[0].end = lit_pos + re->lit_len;
+        return true;
+    }
+    if (re->dfa_ok && dfa_run(re, text, len, from) == 0) return false;
+
+    size_t nslots = 2 * (re->group_count + 1);
+    size_t caps[2 * REGEX_MAX_GROUPS];
+    if (!pike_search(re, text, len, from, nslots, caps)) return false;
+    for (size_t g = 0; g <= re->group_count; g++) {
+        size_t s = caps[2 * g], e = caps[2 * g + 1];
+        if (s == REGEX_NO_POS || e == REGEX_NO_POS) groups[g].start = groups[g].end = REGEX_NO_POS;
+        else { groups[g].start = s; groups[g].end = e; }
+    }
+    return true;
+}
+
+/* ========== LITERAL SEARCH ========== */
+
+size_t regex_find_literal(const char *hay, size_t n, const char *needle, size_t k) {
+    size_t hit = str_find(hay, n, needle, k);
+    return hit == STR_NPOS ? REGEX_NO_POS : hit;
+}
+
+/* ========== CACHE ========== */
+
+typedef struct CacheEntry {
+    Regex *re;
+    char *pattern;
+    int flags;
+    uint32_t hash;
+    uint64_t last_used;
+} CacheEntry;
+
+/* One cache per thread: a Regex mutates its lazy DFA and scratch while it
+ * matches, so a compiled pattern must never be shared between threads, and
+ * the LRU bookkeeping then needs no lock */
+static REGEX_THREAD_LOCAL CacheEntry regex_cache[REGEX_CACHE_SIZE];
+static REGEX_THREAD_LOCAL uint64_t regex_cache_tick = 0;
+
+#ifndef _WIN32
+static pthread_key_t regex_cache_key;
+static pthread_once_t regex_cache_once = PTHREAD_ONCE_INIT;
+static REGEX_THREAD_LOCAL bool regex_cache_registered = false;
+
+/* Thread exit: drop the exiting thread's cache */
+static void regex_cache_exit(void *unused) {
+    (void)unused;
+    regex_cache_clear();
+}
+
+static void regex_cache_key_create(void) {
+    pthread_key_create(&regex_cache_key, regex_cache_exit);
+}
+#endif
+
+static uint32_t hash_pattern(const char *s, int flags) {
+    uint32_t h = 2166136261u ^ (uint32_t)flags;
+    while (*s) h = (h ^ (uint8_t)*s++) * 16777619u;
+    return h;
+}
+
+Regex *regex_cache_get(const char *pattern, int flags) {
+    if (!pattern) return NULL;
+    uint32_t h = hash_pattern(pattern, flags);
+    CacheEntry *victim = &regex_cache[0];
+    for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+        CacheEntry *e = &regex_cache[i];
+        if (e->re && e->hash == h && e->flags == flags && strcmp(e->pattern, pattern) == 0) {
+            e->last_used = ++regex_cache_tick;
+            e->re->refcount++;
+            return e->re;
+        }
+        if (!e->re) { if (victim->re) victim = e; }
+        else if (victim->re && e->last_used < victim->last_used) victim = e;
+    }
+
+    Regex *re = regex_compile(pattern, flags, NULL);
+    if (!re) return NULL;
+    size_t plen = strlen(pattern);
+    char *copy = (char *)malloc(plen + 1);
+    if (!copy) return re;       /* usable, just not cached */
+    memcpy(copy, pattern, plen + 1);
+
+#ifndef _WIN32
+    if (!regex_cache_registered) {
+        pthread_once(&regex_cache_once, regex_cache_key_create);
+        pthread_setspecific(regex_cache_key, regex_cache);
+        regex_cache_registered = true;
+    }
+#endif
+    if (victim->re) { regex_release(victim->re); free(victim->pattern); }
+    victim->re = re;
+    victim->pattern = copy;
+    victim->flags = flags;
+    victim->hash = h;
+    victim->last_used = ++regex_cache_tick;
+    re->refcount++;             /* one for the cache, one for the caller */
+    return re;
+}
+
+void regex_release(Regex *re) {
+    if (re && --re->refcount == 0) regex_free(re);
+}
+
+void regex_cache_clear(void) {
+    for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+        if (!regex_cache[i].re) continue;
+        regex_release(regex_cache[i].re);
+        free(regex_cache[i].pattern);
+        memset(&regex_cache[i], 0, sizeof(CacheEntry));
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef RUBOLT_REGEX_ENGINE_H
+#define RUBOLT_REGEX_ENGINE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Native regular expressions (byte-oriented, ERE syntax plus the usual
+ * Perl shorthands: \d \w \s \b, (?:...), lazy quantifiers, {m,n}).
+ *
+ * Matching is layered: a required literal is located first with a SIMD
+ * substring search, yes/no questions are answered by a lazily built DFA,
+ * and capture positions come from a Pike VM (Thompson NFA simulation)
+ * with leftmost-first semantics. Word boundaries and multiline anchors
+ * are handled by the Pike VM only. A compiled Regex caches DFA states and
+ * is not thread-safe. */
+
+#define REGEX_ICASE         0x01    /* Case-insensitive (ASCII) */
+#define REGEX_MULTILINE     0x02    /* ^ and $ also match at line breaks */
+#define REGEX_DOTALL        0x04    /* . also matches '\n' */
+
+#define REGEX_MAX_GROUPS    32      /* Including group 0 */
+#define REGEX_NO_POS        ((size_t)-1)
+
+typedef struct Regex Regex;
+
+typedef struct RegexSpan {
+    size_t start;               /* REGEX_NO_POS if the group did not take part */
+    size_t end;
+} RegexSpan;
+
+/* ========== COMPILATION ========== */
+
+/* Compile a pattern; on failure returns NULL and points *error at a static
+ * message (if error is non-NULL) */
+Regex *regex_compile(const char *pattern, int flags, const char **error);
+
+void regex_free(Regex *re);
+
+/* Number of capture groups, not counting group 0 */
+size_t regex_group_count(const Regex *re);
+
+/* ========== MATCHING ========== */
+
+/* True if the pattern matches anywhere in text[0..len) */
+bool regex_is_match(Regex *re, const char *text, size_t len);
+
+/* Leftmost match starting at or after `start`. On success fills
+ * groups[0..regex_group_count(re)] (group 0 is the whole match). */
+bool regex_search(Regex *re, const char *text, size_t len, size_t start, RegexSpan *groups);
+
+/* ========== CACHE ========== */
+
+/* Compiled regex for pattern+flags from the calling thread's LRU cache, or
+ * NULL if the pattern is invalid. The caller holds a reference until
+ * regex_release(); eviction only drops the cache's own reference. Each
+ * thread compiles its own copy, which must stay on that thread. */
+Regex *regex_cache_get(const char *pattern, int flags);
+
+void regex_release(Regex *re);
+
+/* Drop every regex cached by the calling thread (done at thread exit) */
+void regex_cache_clear(void);
+
+/* ========== LITERAL SEARCH ========== */
+
+/* Offset of the first occurrence of needle[0..k) in hay[0..n), or
+ * REGEX_NO_POS (str_find with runtime SIMD dispatch) */
+size_t regex_find_literal(const char *hay, size_t n, const char *needle, size_t k);
+
+#endif /* RUBOLT_REGEX_ENGINE_H */
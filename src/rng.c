@@ -0,0 +1,297 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "rng.h"
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define RNG_X86 1
+#include <immintrin.h>
+#define RNG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#ifdef _MSC_VER
+#define RNG_THREAD_LOCAL __declspec(thread)
+#else
+#define RNG_THREAD_LOCAL __thread
+#endif
+
+/* ========== GENERATOR ========== */
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(Rng *rng, uint64_t seed) {
+    /* splitmix64 never yields four zero words, the one state xoshiro
+     * cannot leave */
+    for (int i = 0; i < 4; i++) rng->s[i] = splitmix64(&seed);
+}
+
+void rng_seed_entropy(Rng *rng) {
+    uint64_t words[4] = { 0, 0, 0, 0 };
+    bool have = false;
+#ifndef _WIN32
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd >= 0) {
+        have = read(fd, words, sizeof(words)) == (ssize_t)sizeof(words);
+        close(fd);
+    }
+#endif
+    if (have && (words[0] | words[1] | words[2] | words[3])) {
+        memcpy(rng->s, words, sizeof(words));
+        return;
+    }
+    /* No entropy source: mix the clock, this thread's stack address and a
+     * process-wide counter, so threads started together still differ */
+    static uint64_t counter = 0;
+#ifdef __GNUC__
+    uint64_t n = __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED);
+#else
+    uint64_t n = counter++;
+#endif
+    uint64_t seed = (uint64_t)time(NULL) ^ (uint64_t)clock() << 32;
+#ifndef _WIN32
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    seed ^= (uint64_t)ts.tv_nsec * 0x9e3779b97f4a7c15ULL;
+#endif
+    seed ^= (uint64_t)(uintptr_t)&words ^ n << 48;
+    rng_seed(rng, seed);
+}
+
+uint64_t rng_bounded(Rng *rng, uint64_t range) {
+    if (range == 0) return 0;
+#ifdef __SIZEOF_INT128__
+    /* Lemire: the high word of x * range is uniform once the low words
+     * below 2^64 mod range are rejected; the modulo is only computed when
+     * the low word is small enough that a rejection is possible */
+    __uint128_t m = (__uint128_t)rng_next(rng) * range;
+    uint64_t low = (uint64_t)m;
+    if (low < range) {
+        uint64_t threshold = (0 - range) % range;
+        while (low < threshold) {
+            m = (__uint128_t)rng_next(rng) * range;
+            low = (uint64_t)m;
+        }
+    }
+    return (uint64_t)(m >> 64);
+#else
+    /* Reject the 2^64 mod range smallest values, then the modulo is exact */
+    uint64_t threshold = (0 - range) % range, x;
+    do {
+        x = rng_next(rng);
+    } while (x < threshold);
+    return x % range;
+#endif
+}
+
+void rng_jump(Rng *rng) {
+    static const uint64_t jump[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL,
+                                      0x39abdc4529b1661cULL };
+    uint64_t s[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (jump[i] & (uint64_t)1 << b) {
+                for (int w = 0; w < 4; w++) s[w] ^= rng->s[w];
+            }
+            rng_next(rng);
+        }
+    }
+    memcpy(rng->s, s, sizeof(s));
+}
+
+/* ========== BULK ========== */
+
+void rng_lanes_seed(RngLanes *lanes, const Rng *rng) {
+    Rng stream = *rng;
+    for (int lane = 0; lane < RNG_LANES; lane++) {
+        rng_jump(&stream);
+        for (int w = 0; w < 4; w++) lanes->s[w][lane] = stream.s[w];
+    }
+}
+
+/* [0, 1) from the top 52 bits, by making them the mantissa of a double in
+ * [1, 2): no integer-to-double conversion, which AVX2 lacks for 64 bits */
+static inline double unit_double(uint64_t x) {
+    uint64_t bits = x >> 12 | 0x3ff0000000000000ULL;
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d - 1.0;
+}
+
+/* One step of every lane, writing the first `count` outputs */
+static inline void lanes_step(RngLanes *lanes, double *out, size_t count, double lo, double scale) {
+    for (int lane = 0; lane < RNG_LANES; lane++) {
+        Rng r = { { lanes->s[0][lane], lanes->s[1][lane], lanes->s[2][lane], lanes->s[3][lane] } };
+        uint64_t x = rng_next(&r);
+        for (int w = 0; w < 4; w++) lanes->s[w][lane] = r.s[w];
+        if ((size_t)lane < count) out[lane] = lo + unit_double(x) * scale;
+    }
+}
+
+static void fill_scalar(RngLanes *lanes, double *out, size_t n, double lo, double scale) {
+    for (size_t i = 0; i < n; i += RNG_LANES) {
+        lanes_step(lanes, out + i, n - i < RNG_LANES ? n - i : RNG_LANES, lo, scale);
+    }
+}
+
+#ifdef RNG_X86
+RNG_TARGET_AVX2 static inline __m256i rotl256(__m256i x, int k) {
+    return _mm256_or_si256(_mm256_slli_epi64(x, k), _mm256_srli_epi64(x, 64 - k));
+}
+
+/* xoshiro256** on four lanes; the multiplies by 5 and 9 are shift-adds */
+RNG_TARGET_AVX2 static inline __m256i next256(__m256i *s0, __m256i *s1, __m256i *s2, __m256i *s3) {
+    __m256i x = _mm256_add_epi64(_mm256_slli_epi64(*s1, 2), *s1);
+    x = rotl256(x, 7);
+    x = _mm256_add_epi64(_mm256_slli_epi64(x, 3), x);
+    __m256i t = _mm256_slli_epi64(*s1, 17);
+    *s2 = _mm256_xor_si256(*s2, *s0);
+    *s3 = _mm256_xor_si256(*s3, *s1);
+    *s1 = _mm256_xor_si256(*s1, *s2);
+    *s0 = _mm256_xor_si256(*s0, *s3);
+    *s2 = _mm256_xor_si256(*s2, t);
+    *s3 = rotl256(*s3, 45);
+    return x;
+}
+
+RNG_TARGET_AVX2 static inline __m256d unit256(__m256i x, __m256d lo, __m256d scale) {
+    const __m256i exponent = _mm256_set1_epi64x(0x3ff0000000000000LL);
+    __m256d u = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(x, 12), exponent)),
+                              _mm256_set1_pd(1.0));
+    /* Multiply then add, as the scalar path does: no fused rounding */
+    return _mm256_add_pd(lo, _mm256_mul_pd(u, scale));
+}
+
+/* Lanes 0-3 and 4-7 in two register sets, independent chains that
+ * overlap in the pipeline */
+RNG_TARGET_AVX2 static void fill_avx2(RngLanes *lanes, double *out, size_t n, double lo, double scale) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i *)&lanes->s[0][0]);
+    __m256i a1 = _mm256_loadu_si256((const __m256i *)&lanes->s[1][0]);
+    __m256i a2 = _mm256_loadu_si256((const __m256i *)&lanes->s[2][0]);
+    __m256i a3 = _mm256_loadu_si256((const __m256i *)&lanes->s[3][0]);
+    __m256i b0 = _mm256_loadu_si256((const __m256i *)&lanes->s[0][4]);
+    __m256i b1 = _mm256_loadu_si256((const __m256i *)&lanes->s[1][4]);
+    __m256i b2 = _mm256_loadu_si256((const __m256i *)&lanes->s[2][4]);
+    __m256i b3 = _mm256_loadu_si256((const __m256i *)&lanes->s[3][4]);
+    __m256d vlo = _mm256_set1_pd(lo), vscale = _mm256_set1_pd(scale);
+    size_t i = 0;
+    for (; i + RNG_LANES <= n; i += RNG_LANES) {
+        __m256i xa = next256(&a0, &a1, &a2, &a3);
+        __m256i xb = next256(&b0, &b1, &b2, &b3);
+        _mm256_storeu_pd(out + i, unit256(xa, vlo, vscale));
+        _mm256_storeu_pd(out + i + 4, unit256(xb, vlo, vscale));
+    }
+    _mm256_storeu_si256((__m256i *)&lanes->s[0][0], a0);
+    _mm256_storeu_si256((__m256i *)&lanes->s[1][0], a1);
+    _mm256_storeu_si256((__m256i *)&lanes->s[2][0], a2);
+    _mm256_storeu_si256((__m256i *)&lanes->s[3][0], a3);
+    _mm256_storeu_si256((__m256i *)&lanes->s[0][4], b0);
+    _mm256_storeu_si256((__m256i *)&lanes->s[1][4], b1);
+    _mm256_storeu_si256((__m256i *)&lanes->s[2][4], b2);
+    _mm256_storeu_si256((__m256i *)&lanes->s[3][4], b3);
+    if (i < n) lanes_step(lanes, out + i, n - i, lo, scale);
+}
+#endif
+
+typedef struct {
+    const char *isa;
+    void (*fill)(RngLanes *lanes, double *out, size_t n, double lo, double scale);
+} RngKernel;
+
+static const RngKernel scalar_kernel = { "scalar", fill_scalar };
+#ifdef RNG_X86
+static const RngKernel avx2_kernel = { "avx2", fill_avx2 };
+#endif
+
+/* Chosen on first use; a racing first call just stores the same pointer */
+static const RngKernel *active_kernel = NULL;
+
+static const RngKernel *kernel(void) {
+    if (!active_kernel) {
+        active_kernel = &scalar_kernel;
+#ifdef RNG_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) active_kernel = &avx2_kernel;
+#endif
+    }
+    return active_kernel;
+}
+
+const char *rng_fill_isa(void) {
+    return kernel()->isa;
+}
+
+bool rng_fill_select(const char *isa) {
+    if (strcmp(isa, "scalar") == 0) {
+        active_kernel = &scalar_kernel;
+        return true;
+    }
+#ifdef RNG_X86
+    __builtin_cpu_init();
+    if (strcmp(isa, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        active_kernel = &avx2_kernel;
+        return true;
+    }
+#endif
+    return false;
+}
+
+void rng_fill_uniform(RngLanes *lanes, double *out, size_t n, double lo, double hi) {
+    kernel()->fill(lanes, out, n, lo, hi - lo);
+}
+
+void rng_shuffle(Rng *rng, void *base, size_t n, size_t size) {
+    unsigned char *bytes = base, tmp[64];
+    for (size_t i = n; i > 1; i--) {
+        size_t j = (size_t)rng_bounded(rng, i);
+        if (j == i - 1) continue;
+        unsigned char *a = bytes + (i - 1) * size, *b = bytes + j * size;
+        for (size_t off = 0; off < size; off += sizeof(tmp)) {
+            size_t chunk = size - off < sizeof(tmp) ? size - off : sizeof(tmp);
+            memcpy(tmp, a + off, chunk);
+            memcpy(a + off, b + off, chunk);
+            memcpy(b + off, tmp, chunk);
+        }
+    }
+}
+
+/* ========== PER-THREAD STATE ========== */
+
+static RNG_THREAD_LOCAL Rng thread_rng;
+static RNG_THREAD_LOCAL RngLanes thread_lanes;
+static RNG_THREAD_LOCAL bool thread_seeded = false;
+
+static void thread_init(void) {
+    if (thread_seeded) return;
+    rng_seed_entropy(&thread_rng);
+    rng_lanes_seed(&thread_lanes, &thread_rng);
+    thread_seeded = true;
+}
+
+Rng *rng_thread(void) {
+    thread_init();
+    return &thread_rng;
+}
+
+RngLanes *rng_thread_lanes(void) {
+    thread_init();
+    return &thread_lanes;
+}
+
+void rng_thread_seed(uint64_t seed) {
+    rng_seed(&thread_rng, seed);
+    rng_lanes_seed(&thread_lanes, &thread_rng);
+    thread_seeded = true;
+}
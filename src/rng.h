@@ -0,0 +1,100 @@
+#ifndef RUBOLT_RNG_H
+#define RUBOLT_RNG_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Pseudo-random numbers for the random module.
+ *
+ * The generator is xoshiro256** (Blackman and Vigna): 256 bits of state,
+ * period 2^256 - 1, a few cycles per 64-bit output, and it passes BigCrush
+ * and PractRand. Seeds are expanded with splitmix64. Each thread has its
+ * own state, seeded from the OS on first use, so there is no shared state
+ * to race on and no locking.
+ *
+ * Bounded integers use Lemire's multiply-shift method with rejection, so
+ * every value in the range is equally likely (rand() % n is biased toward
+ * small values whenever n does not divide RAND_MAX + 1). Bulk fills run
+ * RNG_LANES independent streams side by side, two AVX2 registers of four;
+ * the scalar fallback interleaves the same streams, so a seeded fill gives
+ * the same values on every machine. */
+
+#define RNG_LANES 8
+
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+/* Independent streams for bulk fills; s[word][lane] so that each word of
+ * all lanes is one vector */
+typedef struct {
+    uint64_t s[4][RNG_LANES];
+} RngLanes;
+
+/* ========== GENERATOR ========== */
+
+void rng_seed(Rng *rng, uint64_t seed);
+
+/* Seed from the OS entropy source, falling back to the clock, the thread
+ * and a counter when it is unavailable */
+void rng_seed_entropy(Rng *rng);
+
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_next(Rng *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+    return result;
+}
+
+/* Uniform in [0, 1) with 53 random bits */
+static inline double rng_double(Rng *rng) {
+    return (double)(rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+/* Uniform in [0, range); 0 when range is 0 */
+uint64_t rng_bounded(Rng *rng, uint64_t range);
+
+/* Advance 2^128 steps: calling it k times on copies of one state gives k
+ * streams that never overlap in practice */
+void rng_jump(Rng *rng);
+
+/* ========== BULK ========== */
+
+/* Lane streams split off rng by jumps; rng itself is left unchanged */
+void rng_lanes_seed(RngLanes *lanes, const Rng *rng);
+
+/* Fill out[0..n) with doubles uniform in [lo, hi), 52 random bits each */
+void rng_fill_uniform(RngLanes *lanes, double *out, size_t n, double lo, double hi);
+
+/* Fisher-Yates shuffle of n elements of `size` bytes in place */
+void rng_shuffle(Rng *rng, void *base, size_t n, size_t size);
+
+/* ========== PER-THREAD STATE ========== */
+
+/* This thread's generator and lanes, seeded from entropy on first use */
+Rng *rng_thread(void);
+RngLanes *rng_thread_lanes(void);
+
+/* Reseed this thread's generator and lanes */
+void rng_thread_seed(uint64_t seed);
+
+/* ========== KERNELS ========== */
+
+/* Bulk kernel in use ("avx2" or "scalar"), chosen on first use */
+const char *rng_fill_isa(void);
+
+/* Force a kernel by name; false if unknown or the CPU lacks it */
+bool rng_fill_select(const char *isa);
+
+#endif /* RUBOLT_RNG_H */
@@ -0,0 +1,325 @@
+#include "sqlite_db.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ========== STATEMENT CACHE ========== */
+
+typedef struct {
+    char *sql;
+    size_t length;
+    uint64_t hash;
+    sqlite3_stmt *stmt;
+    uint64_t last_used;
+    bool busy;                  /* held by an open cursor */
+} CachedStmt;
+
+struct SqlDb {
+    sqlite3 *handle;
+    CachedStmt *cache;          /* fixed capacity, so entries never move */
+    size_t cache_count;
+    size_t cache_size;
+    uint64_t clock;
+    SqlCacheStats stats;
+    char error[256];
+};
+
+struct SqlCursor {
+    SqlDb *db;
+    sqlite3_stmt *stmt;
+    CachedStmt *entry;          /* NULL for a private statement */
+    bool failed;
+    bool done;
+};
+
+static uint64_t sql_hash(const char *s, size_t length) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) h = (h ^ (unsigned char)s[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+static void set_error(SqlDb *db, const char *message) {
+    snprintf(db->error, sizeof(db->error), "%s", message ? message : sqlite3_errmsg(db->handle));
+}
+
+/* The prepared statement for sql, from the cache when possible. *entry is
+ * the cache slot now marked in use by the caller, or NULL when the
+ * statement is private (its cached copy is busy, or every slot is) and
+ * must be finalized after use. */
+static sqlite3_stmt *prepare(SqlDb *db, const char *sql, CachedStmt **entry) {
+    size_t length = strlen(sql);
+    uint64_t hash = sql_hash(sql, length);
+    bool cached_busy = false;
+    *entry = NULL;
+    for (size_t i = 0; i < db->cache_count; i++) {
+        CachedStmt *e = &db->cache[i];
+        if (e->hash != hash || e->length != length || memcmp(e->sql, sql, length) != 0) continue;
+        if (e->busy) {
+            cached_busy = true;
+            break;
+        }
+        e->last_used = ++db->clock;
+        e->busy = true;
+        db->stats.hits++;
+        *entry = e;
+        return e->stmt;
+    }
+    db->stats.misses++;
+    sqlite3_stmt *stmt = NULL;
+    const char *tail = NULL;
+    if (sqlite3_prepare_v2(db->handle, sql, (int)length + 1, &stmt, &tail) != SQLITE_OK) {
+        set_error(db, NULL);
+        return NULL;
+    }
+    if (!stmt) {
+        set_error(db, "empty statement");
+        return NULL;
+    }
+    while (tail && (*tail == ' ' || *tail == '\t' || *tail == '\n' || *tail == '\r' || *tail == ';')) tail++;
+    if (tail && *tail) {
+        /* Only the first statement would run; see sql_exec_script */
+        sqlite3_finalize(stmt);
+        set_error(db, "more than one statement");
+        return NULL;
+    }
+    if (cached_busy) return stmt;
+
+    CachedStmt *slot = NULL;
+    if (db->cache_count < db->cache_size) {
+        slot = &db->cache[db->cache_count++];
+    } else {
+        for (size_t i = 0; i < db->cache_count; i++) {
+            CachedStmt *e = &db->cache[i];
+            if (!e->busy && (!slot || e->last_used < slot->last_used)) slot = e;
+        }
+        if (!slot) return stmt;
+        sqlite3_finalize(slot->stmt);
+        free(slot->sql);
+        db->stats.evictions++;
+    }
+    slot->sql = malloc(length + 1);
+    if (!slot->sql) {
+        /* Leave the slot empty (it matches no SQL) and run uncached */
+        slot->length = 0;
+        slot->hash = 0;
+        slot->stmt = NULL;
+        slot->last_used = 0;
+        return stmt;
+    }
+    memcpy(slot->sql, sql, length + 1);
+    *slot = (CachedStmt){ slot->sql, length, hash, stmt, ++db->clock, true };
+    *entry = slot;
+    return stmt;
+}
+
+static void release(sqlite3_stmt *stmt, CachedStmt *entry) {
+    if (!entry) {
+        sqlite3_finalize(stmt);
+        return;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    entry->busy = false;
+}
+
+/* Bind parameters 1..count; destructor is SQLITE_STATIC when the values
+ * outlive every step, SQLITE_TRANSIENT to have SQLite copy them */
+static bool bind(SqlDb *db, sqlite3_stmt *stmt, const SqlValue *params, size_t count,
+                 sqlite3_destructor_type destructor) {
+    if (count > (size_t)sqlite3_bind_parameter_count(stmt)) {
+        set_error(db, "too many parameters");
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const SqlValue *v = &params[i];
+        int index = (int)i + 1, rc;
+        switch (v->type) {
+            case SQL_INT:
+                rc = sqlite3_bind_int64(stmt, index, v->as.i);
+                break;
+            case SQL_FLOAT:
+                rc = sqlite3_bind_double(stmt, index, v->as.f);
+                break;
+            case SQL_TEXT:
+                rc = sqlite3_bind_text64(stmt, index, v->as.bytes.data, v->as.bytes.length, destructor, SQLITE_UTF8);
+                break;
+            case SQL_BLOB:
+                rc = sqlite3_bind_blob64(stmt, index, v->as.bytes.data, v->as.bytes.length, destructor);
+                break;
+            default:
+                rc = sqlite3_bind_null(stmt, index);
+                break;
+        }
+        if (rc != SQLITE_OK) {
+            set_error(db, NULL);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Step a bound statement to completion, skipping any rows */
+static bool run(SqlDb *db, sqlite3_stmt *stmt) {
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    }
+    if (rc == SQLITE_DONE) return true;
+    set_error(db, NULL);
+    return false;
+}
+
+/* ========== CONNECTIONS ========== */
+
+SqlDb *sql_open(const char *path, size_t cache_size) {
+    SqlDb *db = calloc(1, sizeof(SqlDb));
+    if (!db) return NULL;
+    db->cache_size = cache_size ? cache_size : SQL_DEFAULT_CACHE;
+    db->cache = calloc(db->cache_size, sizeof(CachedStmt));
+    if (!db->cache ||
+        sqlite3_open_v2(path, &db->handle, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK) {
+        sql_close(db);
+        return NULL;
+    }
+    sqlite3_busy_timeout(db->handle, 5000);
+    return db;
+}
+
+void sql_close(SqlDb *db) {
+    if (!db) return;
+    for (size_t i = 0; i < db->cache_count; i++) {
+        sqlite3_finalize(db->cache[i].stmt);
+        free(db->cache[i].sql);
+    }
+    free(db->cache);
+    sqlite3_close_v2(db->handle);
+    free(db);
+}
+
+const char *sql_error(SqlDb *db) {
+    return db->error;
+}
+
+bool sql_exec_script(SqlDb *db, const char *sql) {
+    char *message = NULL;
+    if (sqlite3_exec(db->handle, sql, NULL, NULL, &message) == SQLITE_OK) return true;
+    set_error(db, message);
+    sqlite3_free(message);
+    return false;
+}
+
+int64_t sql_execute(SqlDb *db, const char *sql, const SqlValue *params, size_t param_count) {
+    CachedStmt *entry;
+    sqlite3_stmt *stmt = prepare(db, sql, &entry);
+    if (!stmt) return -1;
+    bool ok = bind(db, stmt, params, param_count, SQLITE_STATIC) && run(db, stmt);
+    release(stmt, entry);
+    return ok ? (int64_t)sqlite3_changes(db->handle) : -1;
+}
+
+int64_t sql_execute_many(SqlDb *db, const char *sql, const SqlValue *params, size_t row_count, size_t width) {
+    if (sql_execute(db, "SAVEPOINT rubolt_many", NULL, 0) < 0) return -1;
+    CachedStmt *entry;
+    sqlite3_stmt *stmt = prepare(db, sql, &entry);
+    int64_t total = 0;
+    bool ok = stmt != NULL;
+    /* Parameters a row does not set must not keep the previous row's */
+    bool partial = ok && width < (size_t)sqlite3_bind_parameter_count(stmt);
+    for (size_t r = 0; ok && r < row_count; r++) {
+        ok = bind(db, stmt, params + r * width, width, SQLITE_STATIC) && run(db, stmt);
+        if (ok) total += sqlite3_changes(db->handle);
+        sqlite3_reset(stmt);
+        if (partial) sqlite3_clear_bindings(stmt);
+    }
+    if (stmt) release(stmt, entry);
+    if (ok) return sql_execute(db, "RELEASE rubolt_many", NULL, 0) < 0 ? -1 : total;
+    /* Keep the first error, not one from the rollback */
+    char error[sizeof(db->error)];
+    memcpy(error, db->error, sizeof(error));
+    sql_execute(db, "ROLLBACK TO rubolt_many", NULL, 0);
+    sql_execute(db, "RELEASE rubolt_many", NULL, 0);
+    memcpy(db->error, error, sizeof(error));
+    return -1;
+}
+
+int64_t sql_last_insert_id(SqlDb *db) {
+    return (int64_t)sqlite3_last_insert_rowid(db->handle);
+}
+
+void sql_cache_stats(SqlDb *db, SqlCacheStats *stats) {
+    *stats = db->stats;
+}
+
+/* ========== CURSORS ========== */
+
+SqlCursor *sql_query(SqlDb *db, const char *sql, const SqlValue *params, size_t param_count) {
+    SqlCursor *cursor = calloc(1, sizeof(SqlCursor));
+    if (!cursor) return NULL;
+    cursor->db = db;
+    cursor->stmt = prepare(db, sql, &cursor->entry);
+    /* SQLite copies the parameters: the cursor may outlive them */
+    if (!cursor->stmt || !bind(db, cursor->stmt, params, param_count, SQLITE_TRANSIENT)) {
+        if (cursor->stmt) release(cursor->stmt, cursor->entry);
+        free(cursor);
+        return NULL;
+    }
+    return cursor;
+}
+
+bool sql_cursor_step(SqlCursor *cursor) {
+    if (cursor->done) return false;
+    int rc = sqlite3_step(cursor->stmt);
+    if (rc == SQLITE_ROW) return true;
+    cursor->done = true;
+    if (rc != SQLITE_DONE) {
+        cursor->failed = true;
+        set_error(cursor->db, NULL);
+    }
+    return false;
+}
+
+bool sql_cursor_failed(const SqlCursor *cursor) {
+    return cursor->failed;
+}
+
+size_t sql_cursor_columns(const SqlCursor *cursor) {
+    return (size_t)sqlite3_column_count(cursor->stmt);
+}
+
+const char *sql_cursor_name(const SqlCursor *cursor, size_t column) {
+    return sqlite3_column_name(cursor->stmt, (int)column);
+}
+
+SqlValue sql_cursor_value(const SqlCursor *cursor, size_t column) {
+    SqlValue v;
+    int i = (int)column;
+    switch (sqlite3_column_type(cursor->stmt, i)) {
+        case SQLITE_INTEGER:
+            v.type = SQL_INT;
+            v.as.i = sqlite3_column_int64(cursor->stmt, i);
+            break;
+        case SQLITE_FLOAT:
+            v.type = SQL_FLOAT;
+            v.as.f = sqlite3_column_double(cursor->stmt, i);
+            break;
+        case SQLITE_TEXT:
+            v.type = SQL_TEXT;
+            v.as.bytes.data = (const char *)sqlite3_column_text(cursor->stmt, i);
+            v.as.bytes.length = (size_t)sqlite3_column_bytes(cursor->stmt, i);
+            break;
+        case SQLITE_BLOB:
+            v.type = SQL_BLOB;
+            v.as.bytes.data = sqlite3_column_blob(cursor->stmt, i);
+            v.as.bytes.length = (size_t)sqlite3_column_bytes(cursor->stmt, i);
+            break;
+        default:
+            v.type = SQL_NULL;
+            break;
+    }
+    return v;
+}
+
+void sql_cursor_close(SqlCursor *cursor) {
+    if (!cursor) return;
+    release(cursor->stmt, cursor->entry);
+    free(cursor);
+}
@@ -0,0 +1,99 @@
+#ifndef RUBOLT_SQLITE_DB_H
+#define RUBOLT_SQLITE_DB_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sqlite3.h>
+
+/* SQLite connections for the native.sqlite3 module.
+ *
+ * Every statement goes through a per-connection cache of prepared
+ * statements keyed by SQL text and evicted least recently used, so a
+ * query run in a loop is parsed and planned once. Parameters are bound as
+ * typed values (integers, doubles, text views, blobs) rather than spliced
+ * into the SQL, and rows are read through a cursor that steps on demand.
+ * sql_execute_many runs one statement over many parameter rows inside a
+ * single transaction (a savepoint, so it also nests in an open one),
+ * which is what makes bulk inserts fast: one journal sync per batch
+ * instead of per row. */
+
+#define SQL_DEFAULT_CACHE 64
+
+typedef struct SqlDb SqlDb;
+typedef struct SqlCursor SqlCursor;
+
+typedef enum {
+    SQL_NULL,
+    SQL_INT,
+    SQL_FLOAT,
+    SQL_TEXT,
+    SQL_BLOB
+} SqlType;
+
+/* A parameter or cell; text and blobs are borrowed views */
+typedef struct {
+    SqlType type;
+    union {
+        int64_t i;
+        double f;
+        struct {
+            const char *data;
+            size_t length;
+        } bytes;
+    } as;
+} SqlValue;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} SqlCacheStats;
+
+/* ========== CONNECTIONS ========== */
+
+/* Open (creating) a database file, ":memory:" for a private in-memory
+ * one; cache_size statements are kept prepared (0 = SQL_DEFAULT_CACHE) */
+SqlDb *sql_open(const char *path, size_t cache_size);
+void sql_close(SqlDb *db);
+
+/* The last error message of this connection */
+const char *sql_error(SqlDb *db);
+
+/* Run SQL text that may hold several statements and no parameters,
+ * discarding any rows (schema scripts, pragmas) */
+bool sql_exec_script(SqlDb *db, const char *sql);
+
+/* Run one statement, skipping any rows; rows changed by an INSERT,
+ * UPDATE or DELETE, or -1 on error */
+int64_t sql_execute(SqlDb *db, const char *sql, const SqlValue *params, size_t param_count);
+
+/* Run one statement for each of row_count rows of width parameters
+ * (params is row-major), all in one transaction that is rolled back if
+ * any row fails; rows changed, or -1 */
+int64_t sql_execute_many(SqlDb *db, const char *sql, const SqlValue *params, size_t row_count, size_t width);
+
+int64_t sql_last_insert_id(SqlDb *db);
+void sql_cache_stats(SqlDb *db, SqlCacheStats *stats);
+
+/* ========== CURSORS ========== */
+
+/* Start a query; rows are produced one sql_cursor_step at a time. The
+ * cursor uses the cached statement, or a private one if that is already
+ * in use by another open cursor. NULL on error. */
+SqlCursor *sql_query(SqlDb *db, const char *sql, const SqlValue *params, size_t param_count);
+
+/* Advance to the next row: true if there is one, false at the end or on
+ * error (see sql_cursor_failed) */
+bool sql_cursor_step(SqlCursor *cursor);
+bool sql_cursor_failed(const SqlCursor *cursor);
+
+size_t sql_cursor_columns(const SqlCursor *cursor);
+const char *sql_cursor_name(const SqlCursor *cursor, size_t column);
+
+/* Cell of the current row; text and blob views last until the next step */
+SqlValue sql_cursor_value(const SqlCursor *cursor, size_t column);
+
+void sql_cursor_close(SqlCursor *cursor);
+
+#endif /* RUBOLT_SQLITE_DB_H */
@@ -0,0 +1,630 @@
+#include "str_kernels.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STR_KERNELS_X86 1
+#include <immintrin.h>
+#define STR_TARGET_SSE2 __attribute__((target("sse2")))
+#define STR_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+static bool is_space(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/* ========== SCALAR ========== */
+
+static size_t find_scalar(const char *hay, size_t n, const char *needle, size_t k) {
+    if (k == 0) return 0;
+    if (k > n) return STR_NPOS;
+    size_t last = n - k;
+    for (size_t i = 0; i <= last;) {
+        const char *p = (const char *)memchr(hay + i, needle[0], last - i + 1);
+        if (!p) return STR_NPOS;
+        i = (size_t)(p - hay);
+        if (memcmp(p, needle, k) == 0) return i;
+        i++;
+    }
+    return STR_NPOS;
+}
+
+/* Candidates at offsets [0, end) from the right, scalar */
+static size_t rfind_tail(const char *hay, size_t end, const char *needle, size_t k) {
+    while (end > 0) {
+        end--;
+        if (hay[end] == needle[0] && memcmp(hay + end, needle, k) == 0) return end;
+    }
+    return STR_NPOS;
+}
+
+static size_t rfind_scalar(const char *hay, size_t n, const char *needle, size_t k) {
+    if (k == 0) return n;
+    if (k > n) return STR_NPOS;
+    return rfind_tail(hay, n - k + 1, needle, k);
+}
+
+static size_t count_byte_scalar(const char *s, size_t n, char c) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) count += s[i] == c;
+    return count;
+}
+
+static void flip_case_scalar(char *dst, const char *src, size_t n, char first, char last) {
+    for (size_t i = 0; i < n; i++) {
+        char c = src[i];
+        dst[i] = (c >= first && c <= last) ? (char)(c ^ 0x20) : c;
+    }
+}
+
+static void trim_scalar(const char *s, size_t n, size_t *start, size_t *end) {
+    size_t b = 0, e = n;
+    while (b < e && is_space((unsigned char)s[b])) b++;
+    while (e > b && is_space((unsigned char)s[e - 1])) e--;
+    *start = b;
+    *end = e;
+}
+
+/* Validates from i, where i is known to start a character; ASCII runs are
+ * skipped a word at a time */
+static bool utf8_valid_from(const unsigned char *s, size_t n, size_t i) {
+    while (i < n) {
+        if (n - i >= 8) {
+            uint64_t w;
+            memcpy(&w, s + i, 8);
+            if ((w & 0x8080808080808080ULL) == 0) { i += 8; continue; }
+        }
+        unsigned char c = s[i];
+        if (c < 0x80) { i++; continue; }
+        size_t len;
+        if (c >= 0xC2 && c <= 0xDF) len = 2;
+        else if (c >= 0xE0 && c <= 0xEF) len = 3;
+        else if (c >= 0xF0 && c <= 0xF4) len = 4;
+        else return false;
+        if (n - i < len) return false;
+        for (size_t k = 1; k < len; k++) {
+            if ((s[i + k] & 0xC0) != 0x80) return false;
+        }
+        /* Overlongs, UTF-16 surrogates and values past U+10FFFF */
+        if (c == 0xE0 && s[i + 1] < 0xA0) return false;
+        if (c == 0xED && s[i + 1] > 0x9F) return false;
+        if (c == 0xF0 && s[i + 1] < 0x90) return false;
+        if (c == 0xF4 && s[i + 1] > 0x8F) return false;
+        i += len;
+    }
+    return true;
+}
+
+static bool utf8_validate_scalar(const char *s, size_t n, bool *is_ascii) {
+    const unsigned char *u = (const unsigned char *)s;
+    size_t i = 0;
+    while (i < n && u[i] < 0x80) i++;
+    *is_ascii = i == n;
+    return utf8_valid_from(u, n, i);
+}
+
+static size_t utf8_count_scalar(const char *s, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) count += ((unsigned char)s[i] & 0xC0) != 0x80;
+    return count;
+}
+
+#ifdef STR_KERNELS_X86
+
+/* ========== SSE2 ========== */
+/* Substring search compares the needle's first and last bytes against a
+ * whole block of candidate positions and only memcmps where both agree,
+ * which rejects almost every position without a byte loop. */
+
+STR_TARGET_SSE2
+static size_t find_sse2(const char *hay, size_t n, const char *needle, size_t k) {
+    if (k == 0) return 0;
+    if (k > n) return STR_NPOS;
+    if (k == 1) {
+        const char *p = (const char *)memchr(hay, needle[0], n);
+        return p ? (size_t)(p - hay) : STR_NPOS;
+    }
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[k - 1]);
+    size_t i = 0;
+    for (; i + k - 1 + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(hay + i + k - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, k - 2) == 0) return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = find_scalar(hay + i, n - i, needle, k);
+    return rest == STR_NPOS ? STR_NPOS : i + rest;
+}
+
+STR_TARGET_SSE2
+static size_t rfind_sse2(const char *hay, size_t n, const char *needle, size_t k) {
+    if (k == 0) return n;
+    if (k > n) return STR_NPOS;
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[k - 1]);
+    size_t end = n - k + 1;         /* candidates remaining: [0, end) */
+    while (end >= 16) {
+        size_t b = end - 16;
+        __m128i x = _mm_loadu_si128((const __m128i *)(hay + b));
+        __m128i y = _mm_loadu_si128((const __m128i *)(hay + b + k - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(x, first), _mm_cmpeq_epi8(y, last)));
+        while (mask) {
+            unsigned bit = 31u - (unsigned)__builtin_clz(mask);
+            if (k < 2 || memcmp(hay + b + bit + 1, needle + 1, k - 2) == 0) return b + bit;
+            mask &= ~(1u << bit);
+        }
+        end = b;
+    }
+    return rfind_tail(hay, end, needle, k);
+}
+
+/* Per-lane byte counters, flushed with a horizontal SAD every 255 blocks */
+STR_TARGET_SSE2
+static size_t count_byte_sse2(const char *s, size_t n, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    size_t count = 0, i = 0;
+    while (n - i >= 16) {
+        __m128i acc = _mm_setzero_si128();
+        size_t blocks = (n - i) / 16;
+        if (blocks > 255) blocks = 255;
+        for (size_t b = 0; b < blocks; b++, i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, needle));
+        }
+        __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+        count += (size_t)_mm_cvtsi128_si32(sums) + (size_t)_mm_extract_epi16(sums, 4);
+    }
+    return count + count_byte_scalar(s + i, n - i, c);
+}
+
+STR_TARGET_SSE2
+static void flip_case_sse2(char *dst, const char *src, size_t n, char first, char last) {
+    const __m128i lo = _mm_set1_epi8((char)(first - 1));
+    const __m128i hi = _mm_set1_epi8((char)(last + 1));
+    const __m128i bit = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        /* Signed compares: bytes >= 0x80 are negative and never in range */
+        __m128i in = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(v, _mm_and_si128(in, bit)));
+    }
+    flip_case_scalar(dst + i, src + i, n - i, first, last);
+}
+
+STR_TARGET_SSE2
+static unsigned space_mask_sse2(const char *p) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i ctl = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('\r' + 1)));
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(ctl, _mm_cmpeq_epi8(v, _mm_set1_epi8(' '))));
+}
+
+STR_TARGET_SSE2
+static void trim_sse2(const char *s, size_t n, size_t *start, size_t *end) {
+    size_t b = 0, e = n;
+    while (e - b >= 16) {
+        unsigned mask = space_mask_sse2(s + b);
+        if (mask != 0xFFFFu) { b += (size_t)__builtin_ctz(~mask); break; }
+        b += 16;
+    }
+    while (e - b >= 16) {
+        unsigned mask = space_mask_sse2(s + e - 16);
+        if (mask != 0xFFFFu) { e -= 15u - (31u - (unsigned)__builtin_clz(~mask & 0xFFFFu)); break; }
+        e -= 16;
+    }
+    size_t tb, te;
+    trim_scalar(s + b, e - b, &tb, &te);
+    *start = b + tb;
+    *end = b + te;
+}
+
+/* SSE2 has no byte shuffle, so only the ASCII prefix is checked in blocks;
+ * the first non-ASCII block onwards goes through the scalar validator */
+STR_TARGET_SSE2
+static bool utf8_validate_sse2(const char *s, size_t n, bool *is_ascii) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i)))) break;
+    }
+    while (i < n && (unsigned char)s[i] < 0x80) i++;
+    *is_ascii = i == n;
+    return utf8_valid_from((const unsigned char *)s, n, i);
+}
+
+/* Lead bytes are the ones that are not 0x80..0xBF, i.e. > -65 signed */
+STR_TARGET_SSE2
+static size_t utf8_count_sse2(const char *s, size_t n) {
+    const __m128i cont_max = _mm_set1_epi8(-65);
+    size_t count = 0, i = 0;
+    while (n - i >= 16) {
+        __m128i acc = _mm_setzero_si128();
+        size_t blocks = (n - i) / 16;
+        if (blocks > 255) blocks = 255;
+        for (size_t b = 0; b < blocks; b++, i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(v, cont_max));
+        }
+        __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+        count += (size_t)_mm_cvtsi128_si32(sums) + (size_t)_mm_extract_epi16(sums, 4);
+    }
+    return count + utf8_count_scalar(s + i, n - i);
+}
+
+/* ========== AVX2 ========== */
+
+STR_TARGET_AVX2
+static size_t find_avx2(const char *hay, size_t n, const char *needle, size_t k) {
+    if (k == 0) return 0;
+    if (k > n) return STR_NPOS;
+    if (k == 1) {
+        const char *p = (const char *)memchr(hay, needle[0], n);
+        return p ? (size_t)(p - hay) : STR_NPOS;
+    }
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[k - 1]);
+    size_t i = 0;
+    for (; i + k - 1 + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(hay + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(hay + i + k - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while (mask) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, k - 2) == 0) return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    _mm256_zeroupper();
+    size_t rest = find_sse2(hay + i, n - i, needle, k);
+    return rest == STR_NPOS ? STR_NPOS : i + rest;
+}
+
+STR_TARGET_AVX2
+static size_t rfind_avx2(const char *hay, size_t n, const char *needle, size_t k) {
+    if (k == 0) return n;
+    if (k > n) return STR_NPOS;
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[k - 1]);
+    size_t end = n - k + 1;
+    while (end >= 32) {
+        size_t b = end - 32;
+        __m256i x = _mm256_loadu_si256((const __m256i *)(hay + b));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(hay + b + k - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(x, first), _mm256_cmpeq_epi8(y, last)));
+        while (mask) {
+            unsigned bit = 31u - (unsigned)__builtin_clz(mask);
+            if (k < 2 || memcmp(hay + b + bit + 1, needle + 1, k - 2) == 0) return b + bit;
+            mask &= ~(1u << bit);
+        }
+        end = b;
+    }
+    /* Fewer than 32 candidates left: hand the prefix to the SSE2 kernel */
+    _mm256_zeroupper();
+    return rfind_sse2(hay, end + k - 1, needle, k);
+}
+
+STR_TARGET_AVX2
+static size_t count_byte_avx2(const char *s, size_t n, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    size_t count = 0, i = 0;
+    while (n - i >= 32) {
+        __m256i acc = _mm256_setzero_si256();
+        size_t blocks = (n - i) / 32;
+        if (blocks > 255) blocks = 255;
+        for (size_t b = 0; b < blocks; b++, i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, needle));
+        }
+        __m256i sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+        count += (size_t)_mm256_extract_epi64(sums, 0) + (size_t)_mm256_extract_epi64(sums, 1) +
+                 (size_t)_mm256_extract_epi64(sums, 2) + (size_t)_mm256_extract_epi64(sums, 3);
+    }
+    _mm256_zeroupper();
+    return count + count_byte_sse2(s + i, n - i, c);
+}
+
+STR_TARGET_AVX2
+static void flip_case_avx2(char *dst, const char *src, size_t n, char first, char last) {
+    const __m256i lo = _mm256_set1_epi8((char)(first - 1));
+    const __m256i hi = _mm256_set1_epi8((char)(last + 1));
+    const __m256i bit = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i in = _mm256_and_si256(_mm256_cmpgt_epi8(v, lo), _mm256_cmpgt_epi8(hi, v));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(v, _mm256_and_si256(in, bit)));
+    }
+    _mm256_zeroupper();
+    flip_case_sse2(dst + i, src + i, n - i, first, last);
+}
+
+STR_TARGET_AVX2
+static unsigned space_mask_avx2(const char *p) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i ctl = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('\t' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), v));
+    return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(ctl, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '))));
+}
+
+STR_TARGET_AVX2
+static void trim_avx2(const char *s, size_t n, size_t *start, size_t *end) {
+    size_t b = 0, e = n;
+    while (e - b >= 32) {
+        unsigned mask = space_mask_avx2(s + b);
+        if (mask != 0xFFFFFFFFu) { b += (size_t)__builtin_ctz(~mask); break; }
+        b += 32;
+    }
+    while (e - b >= 32) {
+        unsigned mask = space_mask_avx2(s + e - 32);
+        if (mask != 0xFFFFFFFFu) { e -= 31u - (31u - (unsigned)__builtin_clz(~mask)); break; }
+        e -= 32;
+    }
+    size_t tb, te;
+    _mm256_zeroupper();
+    trim_sse2(s + b, e - b, &tb, &te);
+    *start = b + tb;
+    *end = b + te;
+}
+
+/* UTF-8 validation with the Keiser-Lemire lookup method: every byte pair
+ * (previous byte, current byte) is classified with three 16-entry nibble
+ * tables whose AND is non-zero exactly for the malformed two-byte prefixes;
+ * the remaining errors (missing or extra continuations of 3- and 4-byte
+ * sequences) come from comparing against the bytes two and three back. */
+#define UTF8_TOO_SHORT   (1 << 0)
+#define UTF8_TOO_LONG    (1 << 1)
+#define UTF8_OVERLONG_3  (1 << 2)
+#define UTF8_TOO_LARGE   (1 << 3)
+#define UTF8_SURROGATE   (1 << 4)
+#define UTF8_OVERLONG_2  (1 << 5)
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4  (1 << 6)
+#define UTF8_TWO_CONTS   (1 << 7)
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+/* The bytes of `input` shifted right by k with the tail of `prev` in front */
+#define UTF8_PREV_AVX2(input, prev, k) \
+    _mm256_alignr_epi8((input), _mm256_permute2x128_si256((prev), (input), 0x21), 16 - (k))
+
+STR_TARGET_AVX2
+static __m256i utf8_errors_avx2(__m256i input, __m256i prev) {
+    const __m256i byte_1_high_table = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+        UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4));
+    const __m256i byte_1_low_table = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+        UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+        UTF8_CARRY | UTF8_OVERLONG_2,
+        UTF8_CARRY,
+        UTF8_CARRY,
+        UTF8_CARRY | UTF8_TOO_LARGE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000));
+    const __m256i byte_2_high_table = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    __m256i prev1 = UTF8_PREV_AVX2(input, prev, 1);
+    __m256i byte_1_high = _mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i byte_1_low = _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, nibble));
+    __m256i byte_2_high = _mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    /* Bytes 2 or 3 after a 3- or 4-byte lead must be continuations */
+    __m256i third = _mm256_subs_epu8(UTF8_PREV_AVX2(input, prev, 2), _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(UTF8_PREV_AVX2(input, prev, 3), _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must_continue, special);
+}
+
+STR_TARGET_AVX2
+static bool utf8_validate_avx2(const char *s, size_t n, bool *is_ascii) {
+    /* Non-zero where a block's last three bytes start a sequence that
+     * continues into the next block */
+    const __m256i incomplete_max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    __m256i error = _mm256_setzero_si256();
+    __m256i prev = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    bool ascii = true;
+    char tail[32];
+
+    for (size_t i = 0; i < n; i += 32) {
+        __m256i input;
+        if (n - i >= 32) {
+            input = _mm256_loadu_si256((const __m256i *)(s + i));
+        } else {
+            /* Zero padding reads as ASCII, so a truncated sequence still
+             * shows up as TOO_SHORT */
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, s + i, n - i);
+            input = _mm256_loadu_si256((const __m256i *)tail);
+        }
+        if (_mm256_movemask_epi8(input) == 0) {
+            error = _mm256_or_si256(error, prev_incomplete);
+        } else {
+            ascii = false;
+            error = _mm256_or_si256(error, utf8_errors_avx2(input, prev));
+            prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+        }
+        prev = input;
+    }
+    error = _mm256_or_si256(error, prev_incomplete);
+    bool valid = _mm256_testz_si256(error, error) != 0;
+    _mm256_zeroupper();
+    *is_ascii = ascii;
+    return valid;
+}
+
+STR_TARGET_AVX2
+static size_t utf8_count_avx2(const char *s, size_t n) {
+    const __m256i cont_max = _mm256_set1_epi8(-65);
+    size_t count = 0, i = 0;
+    while (n - i >= 32) {
+        __m256i acc = _mm256_setzero_si256();
+        size_t blocks = (n - i) / 32;
+        if (blocks > 255) blocks = 255;
+        for (size_t b = 0; b < blocks; b++, i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(v, cont_max));
+        }
+        __m256i sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+        count += (size_t)_mm256_extract_epi64(sums, 0) + (size_t)_mm256_extract_epi64(sums, 1) +
+                 (size_t)_mm256_extract_epi64(sums, 2) + (size_t)_mm256_extract_epi64(sums, 3);
+    }
+    _mm256_zeroupper();
+    return count + utf8_count_sse2(s + i, n - i);
+}
+
+#endif /* STR_KERNELS_X86 */
+
+/* ========== DISPATCH ========== */
+
+typedef struct StrKernels {
+    const char *isa;
+    size_t (*find)(const char *, size_t, const char *, size_t);
+    size_t (*rfind)(const char *, size_t, const char *, size_t);
+    size_t (*count_byte)(const char *, size_t, char);
+    void (*flip_case)(char *, const char *, size_t, char, char);
+    void (*trim)(const char *, size_t, size_t *, size_t *);
+    bool (*utf8_validate)(const char *, size_t, bool *);
+    size_t (*utf8_count)(const char *, size_t);
+} StrKernels;
+
+static const StrKernels scalar_kernels = {
+    "scalar", find_scalar, rfind_scalar, count_byte_scalar, flip_case_scalar, trim_scalar,
+    utf8_validate_scalar, utf8_count_scalar
+};
+
+#ifdef STR_KERNELS_X86
+static const StrKernels sse2_kernels = {
+    "sse2", find_sse2, rfind_sse2, count_byte_sse2, flip_case_sse2, trim_sse2,
+    utf8_validate_sse2, utf8_count_sse2
+};
+static const StrKernels avx2_kernels = {
+    "avx2", find_avx2, rfind_avx2, count_byte_avx2, flip_case_avx2, trim_avx2,
+    utf8_validate_avx2, utf8_count_avx2
+};
+#endif
+
+/* Chosen on first use; a racing first call just stores the same pointer */
+static const StrKernels *active_kernels = NULL;
+
+static const StrKernels *best_kernels(void) {
+#ifdef STR_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return &avx2_kernels;
+    if (__builtin_cpu_supports("sse2")) return &sse2_kernels;
+#endif
+    return &scalar_kernels;
+}
+
+static const StrKernels *kernels(void) {
+    if (!active_kernels) active_kernels = best_kernels();
+    return active_kernels;
+}
+
+const char *str_kernels_isa(void) {
+    return kernels()->isa;
+}
+
+bool str_kernels_select(const char *isa) {
+    if (strcmp(isa, "scalar") == 0) { active_kernels = &scalar_kernels; return true; }
+#ifdef STR_KERNELS_X86
+    __builtin_cpu_init();
+    if (strcmp(isa, "sse2") == 0 && __builtin_cpu_supports("sse2")) { active_kernels = &sse2_kernels; return true; }
+    if (strcmp(isa, "avx2") == 0 && __builtin_cpu_supports("avx2")) { active_kernels = &avx2_kernels; return true; }
+#endif
+    return false;
+}
+
+/* ========== PUBLIC API ========== */
+
+size_t str_find(const char *hay, size_t n, const char *needle, size_t k) {
+    return kernels()->find(hay, n, needle, k);
+}
+
+size_t str_rfind(const char *hay, size_t n, const char *needle, size_t k) {
+    return kernels()->rfind(hay, n, needle, k);
+}
+
+size_t str_count(const char *hay, size_t n, const char *needle, size_t k) {
+    const StrKernels *kt = kernels();
+    if (k == 0) return 0;
+    if (k == 1) return kt->count_byte(hay, n, needle[0]);
+    size_t count = 0, pos = 0;
+    while (pos + k <= n) {
+        size_t hit = kt->find(hay + pos, n - pos, needle, k);
+        if (hit == STR_NPOS) break;
+        count++;
+        pos += hit + k;
+    }
+    return count;
+}
+
+void str_upper_ascii(char *dst, const char *src, size_t n) {
+    kernels()->flip_case(dst, src, n, 'a', 'z');
+}
+
+void str_lower_ascii(char *dst, const char *src, size_t n) {
+    kernels()->flip_case(dst, src, n, 'A', 'Z');
+}
+
+void str_trim_bounds(const char *s, size_t n, size_t *start, size_t *end) {
+    kernels()->trim(s, n, start, end);
+}
+
+bool str_utf8_validate(const char *s, size_t n, bool *is_ascii) {
+    return kernels()->utf8_validate(s, n, is_ascii);
+}
+
+size_t str_utf8_count(const char *s, size_t n) {
+    return kernels()->utf8_count(s, n);
+}
+
+/* Short hops (the interpreter's breadcrumbs keep them under 64 code
+ * points) so this stays scalar, but whole words are skipped while they
+ * hold no more lead bytes than are left to step over */
+size_t str_utf8_advance(const char *s, size_t n, size_t from, size_t count) {
+    size_t i = from;
+    while (count >= 8 && n - i >= 8) {
+        uint64_t w;
+        memcpy(&w, s + i, 8);
+        /* Continuation bytes are 10xxxxxx: bit 7 set, bit 6 clear */
+        uint64_t cont = w & ~(w << 1) & 0x8080808080808080ULL;
+        size_t leads = 8 - (size_t)__builtin_popcountll(cont);
+        if (leads > count) break;
+        count -= leads;
+        i += 8;
+    }
+    while (i < n && ((unsigned char)s[i] & 0xC0) == 0x80) i++;
+    for (; count > 0 && i < n; count--) {
+        i++;
+        while (i < n && ((unsigned char)s[i] & 0xC0) == 0x80) i++;
+    }
+    return i < n ? i : n;
+}
@@ -0,0 +1,56 @@
+#ifndef RUBOLT_STR_KERNELS_H
+#define RUBOLT_STR_KERNELS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Byte-string kernels behind the string module, interpreter strings and
+ * the regex literal prefilter. Each has a scalar, SSE2 and AVX2 version; the widest one the
+ * CPU supports is picked at first use, so one binary runs everywhere. All
+ * functions work on explicit lengths and never read past them. */
+
+#define STR_NPOS ((size_t)-1)
+
+/* ========== SEARCH ========== */
+
+/* First / last offset of needle[0..k) in hay[0..n), or STR_NPOS. An empty
+ * needle matches at 0 (find) or n (rfind). */
+size_t str_find(const char *hay, size_t n, const char *needle, size_t k);
+size_t str_rfind(const char *hay, size_t n, const char *needle, size_t k);
+
+/* Non-overlapping occurrences of needle; 0 for an empty needle */
+size_t str_count(const char *hay, size_t n, const char *needle, size_t k);
+
+/* ========== TRANSFORMS ========== */
+
+/* ASCII case conversion; bytes >= 0x80 are copied unchanged. dst may
+ * equal src. */
+void str_upper_ascii(char *dst, const char *src, size_t n);
+void str_lower_ascii(char *dst, const char *src, size_t n);
+
+/* Bounds of s[0..n) without leading/trailing ASCII whitespace
+ * (" \t\n\v\f\r"); *start == *end when s is all whitespace */
+void str_trim_bounds(const char *s, size_t n, size_t *start, size_t *end);
+
+/* ========== UTF-8 ========== */
+
+/* True if s[0..n) is well-formed UTF-8 (no overlongs, surrogates or code
+ * points above U+10FFFF); *is_ascii reports whether every byte is < 0x80 */
+bool str_utf8_validate(const char *s, size_t n, bool *is_ascii);
+
+/* Code points in s[0..n), i.e. bytes that are not continuation bytes */
+size_t str_utf8_count(const char *s, size_t n);
+
+/* Byte offset reached by stepping `count` code points forward from byte
+ * offset `from`; clamped to n */
+size_t str_utf8_advance(const char *s, size_t n, size_t from, size_t count);
+
+/* ========== DISPATCH ========== */
+
+/* "avx2", "sse2" or "scalar" */
+const char *str_kernels_isa(void);
+
+/* Force a kernel set (for benchmarks); false if the CPU lacks it */
+bool str_kernels_select(const char *isa);
+
+#endif /* RUBOLT_STR_KERNELS_H */
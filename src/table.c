@@ -0,0 +1,1559 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "table.h"
+#include "mmap_file.h"
+#include "csv.h"
+#include "../collections/rb_collections.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define NO_CODE UINT32_MAX
+
+static char *copy_bytes(const char *s, size_t length) {
+    char *copy = malloc(length + 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+/* ========== PARALLEL CHUNKS ========== */
+
+static ThreadPool *configured_pool;
+
+void table_set_pool(ThreadPool *pool) {
+    __atomic_store_n(&configured_pool, pool, __ATOMIC_RELEASE);
+}
+
+typedef void (*ChunkFn)(void *ctx, size_t chunk);
+
+static void parallel_for(size_t chunks, ChunkFn fn, void *ctx) {
+    ThreadPool *pool = NULL;
+    if (chunks > 1) {
+        pool = __atomic_load_n(&configured_pool, __ATOMIC_ACQUIRE);
+        if (!pool) pool = thread_pool_shared();
+    }
+    thread_pool_parallel_for(pool, chunks, fn, ctx);
+}
+
+static size_t chunk_count(size_t rows) {
+    return (rows + TABLE_CHUNK_ROWS - 1) / TABLE_CHUNK_ROWS;
+}
+
+static void chunk_range(size_t chunk, size_t rows, size_t *begin, size_t *end) {
+    *begin = chunk * TABLE_CHUNK_ROWS;
+    *end = *begin + TABLE_CHUNK_ROWS < rows ? *begin + TABLE_CHUNK_ROWS : rows;
+}
+
+/* ========== STRING DICTIONARIES ========== */
+
+StringDict *string_dict_new(void) {
+    StringDict *dict = calloc(1, sizeof(StringDict));
+    if (!dict) return NULL;
+    dict->refcount = 1;
+    dict->capacity = 16;
+    dict->strings = malloc(sizeof(char *) * dict->capacity);
+    dict->lengths = malloc(sizeof(size_t) * dict->capacity);
+    dict->slot_mask = 31;
+    dict->slots = calloc(dict->slot_mask + 1, sizeof(uint32_t));
+    if (!dict->strings || !dict->lengths || !dict->slots) {
+        free(dict->strings);
+        free(dict->lengths);
+        free(dict->slots);
+        free(dict);
+        return NULL;
+    }
+    return dict;
+}
+
+StringDict *string_dict_retain(StringDict *dict) {
+    if (dict) __atomic_fetch_add(&dict->refcount, 1, __ATOMIC_RELAXED);
+    return dict;
+}
+
+void string_dict_release(StringDict *dict) {
+    if (!dict || __atomic_sub_fetch(&dict->refcount, 1, __ATOMIC_ACQ_REL) != 0) return;
+    for (uint32_t i = 0; i < dict->count; i++) free(dict->strings[i]);
+    free(dict->strings);
+    free(dict->lengths);
+    free(dict->slots);
+    free(dict);
+}
+
+/* Slot holding the string, or the empty slot where it would go */
+static size_t dict_slot(const StringDict *dict, const char *s, size_t length) {
+    size_t i = (size_t)rb_hash_bytes(s, length) & dict->slot_mask;
+    for (;;) {
+        uint32_t slot = dict->slots[i];
+        if (slot == 0) return i;
+        uint32_t code = slot - 1;
+        if (dict->lengths[code] == length && memcmp(dict->strings[code], s, length) == 0) return i;
+        i = (i + 1) & dict->slot_mask;
+    }
+}
+
+static bool dict_grow_slots(StringDict *dict) {
+    size_t mask = dict->slot_mask * 2 + 1;
+    uint32_t *slots = calloc(mask + 1, sizeof(uint32_t));
+    if (!slots) return false;
+    for (uint32_t code = 0; code < dict->count; code++) {
+        size_t i = (size_t)rb_hash_bytes(dict->strings[code], dict->lengths[code]) & mask;
+        while (slots[i]) i = (i + 1) & mask;
+        slots[i] = code + 1;
+    }
+    free(dict->slots);
+    dict->slots = slots;
+    dict->slot_mask = mask;
+    return true;
+}
+
+uint32_t string_dict_find(const StringDict *dict, const char *s, size_t length) {
+    uint32_t slot = dict->slots[dict_slot(dict, s, length)];
+    return slot ? slot - 1 : NO_CODE;
+}
+
+uint32_t string_dict_intern(StringDict *dict, const char *s, size_t length) {
+    size_t i = dict_slot(dict, s, length);
+    if (dict->slots[i]) return dict->slots[i] - 1;
+    if (dict->count == NO_CODE - 1) return NO_CODE;
+
+    /* Keep the slot table at most half full */
+    if (((size_t)dict->count + 1) * 2 > dict->slot_mask + 1) {
+        if (!dict_grow_slots(dict)) return NO_CODE;
+        i = dict_slot(dict, s, length);
+    }
+    if (dict->count == dict->capacity) {
+        uint32_t capacity = dict->capacity < NO_CODE / 2 ? dict->capacity * 2 : NO_CODE - 1;
+        char **strings = realloc(dict->strings, sizeof(char *) * capacity);
+        if (!strings) return NO_CODE;
+        dict->strings = strings;
+        size_t *lengths = realloc(dict->lengths, sizeof(size_t) * capacity);
+        if (!lengths) return NO_CODE;
+        dict->lengths = lengths;
+        dict->capacity = capacity;
+    }
+    char *copy = copy_bytes(s, length);
+    if (!copy) return NO_CODE;
+    uint32_t code = dict->count++;
+    dict->strings[code] = copy;
+    dict->lengths[code] = length;
+    dict->slots[i] = code + 1;
+    return code;
+}
+
+/* ========== TABLES ========== */
+
+Table *table_new(size_t rows) {
+    if (rows > TABLE_MAX_ROWS) return NULL;
+    Table *table = calloc(1, sizeof(Table));
+    if (table) table->rows = rows;
+    return table;
+}
+
+static void column_clear(Column *column) {
+    free(column->name);
+    free(column->as.f64);
+    string_dict_release(column->dict);
+}
+
+void table_free(Table *table) {
+    if (!table) return;
+    for (size_t i = 0; i < table->column_count; i++) column_clear(&table->columns[i]);
+    free(table->columns);
+    free(table);
+}
+
+static size_t element_size(ColumnType type) {
+    return type == TABLE_STRING ? sizeof(uint32_t) : sizeof(double);
+}
+
+Column *table_add_column(Table *table, const char *name, ColumnType type, StringDict *dict) {
+    Column *columns = realloc(table->columns, sizeof(Column) * (table->column_count + 1));
+    if (!columns) return NULL;
+    table->columns = columns;
+
+    Column column = {0};
+    column.type = type;
+    column.name = copy_bytes(name, strlen(name));
+    column.as.f64 = calloc(table->rows ? table->rows : 1, element_size(type));
+    if (type == TABLE_STRING) {
+        if (dict) {
+            column.dict = string_dict_retain(dict);
+        } else if ((column.dict = string_dict_new()) != NULL) {
+            string_dict_intern(column.dict, "", 0);     /* code 0 */
+        }
+    }
+    if (!column.name || !column.as.f64 || (type == TABLE_STRING && !column.dict)) {
+        column_clear(&column);
+        return NULL;
+    }
+    columns[table->column_count] = column;
+    return &columns[table->column_count++];
+}
+
+int table_column_index(const Table *table, const char *name) {
+    for (size_t i = 0; i < table->column_count; i++) {
+        if (strcmp(table->columns[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+double table_get_number(const Table *table, size_t column, size_t row) {
+    if (column >= table->column_count || row >= table->rows) return NAN;
+    const Column *c = &table->columns[column];
+    switch (c->type) {
+        case TABLE_FLOAT64: return c->as.f64[row];
+        case TABLE_INT64: return (double)c->as.i64[row];
+        case TABLE_STRING: return NAN;
+    }
+    return NAN;
+}
+
+const char *table_get_string(const Table *table, size_t column, size_t row) {
+    if (column >= table->column_count || row >= table->rows) return NULL;
+    const Column *c = &table->columns[column];
+    return c->type == TABLE_STRING ? c->dict->strings[c->as.codes[row]] : NULL;
+}
+
+static bool is_numeric(const Column *column) {
+    return column->type != TABLE_STRING;
+}
+
+/* ========== FILTER ========== */
+
+typedef struct {
+    const Column *column;
+    TableOp op;
+    double number;
+    int64_t integer;
+    bool exact;                 /* int64 column, integral scalar */
+    const uint8_t *mask;        /* string columns: per-code result */
+    const uint32_t *input;
+    size_t count;               /* rows or input->count */
+    uint32_t *out;
+    size_t *found;              /* per chunk */
+} FilterJob;
+
+/* Branch-free selection: always store the row, advance when it matches */
+#define SELECT_ROWS(value_at, cmp, rhs)                                     \
+    do {                                                                    \
+        if (job->input) {                                                   \
+            for (size_t k = begin; k < end; k++) {                          \
+                uint32_t r = job->input[k];                                 \
+                out[n] = r;                                                 \
+                n += (value_at(r) cmp rhs);                                 \
+            }                                                               \
+        } else {                                                            \
+            for (size_t r = begin; r < end; r++) {                          \
+                out[n] = (uint32_t)r;                                       \
+                n += (value_at(r) cmp rhs);                                 \
+            }                                                               \
+        }                                                                   \
+    } while (0)
+
+#define SELECT_BY_OP(value_at, rhs)                                         \
+    do {                                                                    \
+        switch (job->op) {                                                  \
+            case TABLE_EQ: SELECT_ROWS(value_at, ==, rhs); break;           \
+            case TABLE_NE: SELECT_ROWS(value_at, !=, rhs); break;           \
+            case TABLE_LT: SELECT_ROWS(value_at, <, rhs); break;            \
+            case TABLE_LE: SELECT_ROWS(value_at, <=, rhs); break;           \
+            case TABLE_GT: SELECT_ROWS(value_at, >, rhs); break;            \
+            case TABLE_GE: SELECT_ROWS(value_at, >=, rhs); break;           \
+        }                                                                   \
+    } while (0)
+
+#define F64_AT(r) f64[r]
+#define I64_AT(r) i64[r]
+#define I64_AS_DOUBLE_AT(r) ((double)i64[r])
+#define MASK_AT(r) mask[codes[r]]
+
+static void filter_chunk(void *ctx, size_t chunk) {
+    FilterJob *job = ctx;
+    size_t begin, end, n = 0;
+    chunk_range(chunk, job->count, &begin, &end);
+    uint32_t *out = job->out + begin;
+    const Column *column = job->column;
+    const double number = job->number;
+    const int64_t integer = job->integer;
+
+    if (job->mask) {
+        const uint8_t *mask = job->mask;
+        const uint32_t *codes = column->as.codes;
+        SELECT_ROWS(MASK_AT, !=, 0);
+    } else if (column->type == TABLE_FLOAT64) {
+        const double *f64 = column->as.f64;
+        SELECT_BY_OP(F64_AT, number);
+    } else if (job->exact) {
+        const int64_t *i64 = column->as.i64;
+        SELECT_BY_OP(I64_AT, integer);
+    } else {
+        const int64_t *i64 = column->as.i64;
+        SELECT_BY_OP(I64_AS_DOUBLE_AT, number);
+    }
+    job->found[chunk] = n;
+}
+
+#undef F64_AT
+#undef I64_AT
+#undef I64_AS_DOUBLE_AT
+#undef MASK_AT
+
+static int compare_bytes(const char *a, size_t a_length, const char *b, size_t b_length) {
+    int c = memcmp(a, b, a_length < b_length ? a_length : b_length);
+    if (c) return c;
+    return a_length < b_length ? -1 : a_length > b_length;
+}
+
+static bool op_holds(TableOp op, int c) {
+    switch (op) {
+        case TABLE_EQ: return c == 0;
+        case TABLE_NE: return c != 0;
+        case TABLE_LT: return c < 0;
+        case TABLE_LE: return c <= 0;
+        case TABLE_GT: return c > 0;
+        case TABLE_GE: return c >= 0;
+    }
+    return false;
+}
+
+bool table_filter(const Table *table, size_t column, TableOp op, TableScalar value,
+                  const Selection *input, Selection *out) {
+    out->rows = NULL;
+    out->count = 0;
+    if (column >= table->column_count) return false;
+    const Column *c = &table->columns[column];
+    if (value.is_string != (c->type == TABLE_STRING)) return false;
+
+    FilterJob job = {0};
+    job.column = c;
+    job.op = op;
+    job.input = input ? input->rows : NULL;
+    job.count = input ? input->count : table->rows;
+
+    uint8_t *mask = NULL;
+    if (value.is_string) {
+        /* Compare each distinct string once; rows then just index the mask */
+        size_t length = strlen(value.string);
+        const StringDict *dict = c->dict;
+        mask = malloc(dict->count ? dict->count : 1);
+        if (!mask) return false;
+        for (uint32_t code = 0; code < dict->count; code++) {
+            int cmp = compare_bytes(dict->strings[code], dict->lengths[code], value.string, length);
+            mask[code] = op_holds(op, cmp);
+        }
+        job.mask = mask;
+    } else {
+        job.number = value.number;
+        if (c->type == TABLE_INT64 && value.number == floor(value.number) &&
+            value.number >= -9223372036854775808.0 && value.number < 9223372036854775808.0) {
+            job.exact = true;
+            job.integer = (int64_t)value.number;
+        }
+    }
+
+    size_t chunks = chunk_count(job.count);
+    job.out = malloc(sizeof(uint32_t) * (job.count ? job.count : 1));
+    job.found = malloc(sizeof(size_t) * (chunks ? chunks : 1));
+    if (!job.out || !job.found) {
+        free(job.out);
+        free(job.found);
+        free(mask);
+        return false;
+    }
+    parallel_for(chunks, filter_chunk, &job);
+
+    /* Close the gaps between the chunks' runs */
+    size_t count = 0;
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        memmove(job.out + count, job.out + chunk * TABLE_CHUNK_ROWS, sizeof(uint32_t) * job.found[chunk]);
+        count += job.found[chunk];
+    }
+    uint32_t *rows = realloc(job.out, sizeof(uint32_t) * (count ? count : 1));
+    out->rows = rows ? rows : job.out;
+    out->count = count;
+    free(job.found);
+    free(mask);
+    return true;
+}
+
+void selection_free(Selection *selection) {
+    if (!selection) return;
+    free(selection->rows);
+    selection->rows = NULL;
+    selection->count = 0;
+}
+
+/* ========== GATHER ========== */
+
+typedef struct {
+    const Table *source;
+    Table *target;
+    const uint32_t *rows;
+} TakeJob;
+
+static void take_chunk(void *ctx, size_t chunk) {
+    TakeJob *job = ctx;
+    size_t begin, end;
+    chunk_range(chunk, job->target->rows, &begin, &end);
+    const uint32_t *rows = job->rows;
+    for (size_t i = 0; i < job->target->column_count; i++) {
+        const Column *from = &job->source->columns[i];
+        Column *to = &job->target->columns[i];
+        if (from->type == TABLE_STRING) {
+            for (size_t k = begin; k < end; k++) to->as.codes[k] = from->as.codes[rows[k]];
+        } else {
+            /* int64 and float64 are both 8-byte payloads */
+            for (size_t k = begin; k < end; k++) to->as.i64[k] = from->as.i64[rows[k]];
+        }
+    }
+}
+
+Table *table_take(const Table *table, const Selection *selection) {
+    Table *result = table_new(selection->count);
+    if (!result) return NULL;
+    for (size_t i = 0; i < table->column_count; i++) {
+        const Column *c = &table->columns[i];
+        if (!table_add_column(result, c->name, c->type, c->dict)) {
+            table_free(result);
+            return NULL;
+        }
+    }
+    TakeJob job = { table, result, selection->rows };
+    parallel_for(chunk_count(result->rows), take_chunk, &job);
+    return result;
+}
+
+/* ========== AGGREGATES ========== */
+
+/* Partial aggregate of the non-NaN values seen */
+typedef struct {
+    double sum;
+    double min;
+    double max;
+    uint64_t count;
+} Acc;
+
+static void acc_init(Acc *acc) {
+    acc->sum = 0;
+    acc->min = INFINITY;
+    acc->max = -INFINITY;
+    acc->count = 0;
+}
+
+static void acc_add(Acc *acc, double v) {
+    if (v != v) return;
+    acc->sum += v;
+    acc->min = v < acc->min ? v : acc->min;
+    acc->max = v > acc->max ? v : acc->max;
+    acc->count++;
+}
+
+static void acc_merge(Acc *acc, const Acc *other) {
+    acc->sum += other->sum;
+    acc->min = other->min < acc->min ? other->min : acc->min;
+    acc->max = other->max > acc->max ? other->max : acc->max;
+    acc->count += other->count;
+}
+
+static double acc_result(const Acc *acc, TableAgg agg, uint64_t rows) {
+    if (agg == TABLE_COUNT) return (double)rows;
+    if (acc->count == 0) return NAN;
+    switch (agg) {
+        case TABLE_SUM: return acc->sum;
+        case TABLE_MEAN: return acc->sum / (double)acc->count;
+        case TABLE_MIN: return acc->min;
+        case TABLE_MAX: return acc->max;
+        case TABLE_COUNT: break;
+    }
+    return NAN;
+}
+
+typedef struct {
+    const Column *column;
+    const uint32_t *input;
+    size_t count;
+    Acc *partial;               /* per chunk */
+} AggregateJob;
+
+static void aggregate_chunk(void *ctx, size_t chunk) {
+    AggregateJob *job = ctx;
+    size_t begin, end;
+    chunk_range(chunk, job->count, &begin, &end);
+    Acc acc;
+    acc_init(&acc);
+    const Column *c = job->column;
+    if (c->type == TABLE_FLOAT64) {
+        const double *values = c->as.f64;
+        if (job->input) for (size_t k = begin; k < end; k++) acc_add(&acc, values[job->input[k]]);
+        else for (size_t r = begin; r < end; r++) acc_add(&acc, values[r]);
+    } else {
+        /* No NaNs in an int64 column: a tighter loop than acc_add */
+        const int64_t *values = c->as.i64;
+        int64_t low = INT64_MAX, high = INT64_MIN;
+        double sum = 0;
+        for (size_t k = begin; k < end; k++) {
+            int64_t v = values[job->input ? job->input[k] : k];
+            sum += (double)v;
+            low = v < low ? v : low;
+            high = v > high ? v : high;
+        }
+        if (end > begin) {
+            acc.sum = sum;
+            acc.min = (double)low;
+            acc.max = (double)high;
+            acc.count = end - begin;
+        }
+    }
+    job->partial[chunk] = acc;
+}
+
+double table_aggregate(const Table *table, size_t column, TableAgg agg, const Selection *selection) {
+    size_t rows = selection ? selection->count : table->rows;
+    if (column >= table->column_count) return NAN;
+    if (agg == TABLE_COUNT) return (double)rows;
+    const Column *c = &table->columns[column];
+    if (!is_numeric(c)) return NAN;
+
+    AggregateJob job = { c, selection ? selection->rows : NULL, rows, NULL };
+    size_t chunks = chunk_count(rows);
+    job.partial = malloc(sizeof(Acc) * (chunks ? chunks : 1));
+    if (!job.partial) return NAN;
+    parallel_for(chunks, aggregate_chunk, &job);
+    Acc total;
+    acc_init(&total);
+    for (size_t chunk = 0; chunk < chunks; chunk++) acc_merge(&total, &job.partial[chunk]);
+    free(job.partial);
+    return acc_result(&total, agg, rows);
+}
+
+/* ========== KEYS ========== */
+
+/* Numeric keys as 64-bit patterns: equal values give equal patterns (0.0
+ * and -0.0 alike, all NaNs alike). String keys are dictionary codes. */
+static uint64_t float_key(double v) {
+    if (v == 0) v = 0;
+    if (v != v) return 0x7ff8000000000000ULL;
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+static double float_of_key(uint64_t key) {
+    double v;
+    memcpy(&v, &key, sizeof(v));
+    return v;
+}
+
+static uint64_t row_key(const Column *column, size_t row) {
+    switch (column->type) {
+        case TABLE_FLOAT64: return float_key(column->as.f64[row]);
+        case TABLE_INT64: return (uint64_t)column->as.i64[row];
+        case TABLE_STRING: return column->as.codes[row];
+    }
+    return 0;
+}
+
+/* Open-addressing map from key to a dense id (0, 1, 2, ... in insertion
+ * order) */
+typedef struct {
+    uint64_t *keys;
+    uint32_t *ids;              /* NO_CODE = empty */
+    size_t mask;
+    size_t count;
+} KeyMap;
+
+static void keymap_free(KeyMap *map) {
+    free(map->keys);
+    free(map->ids);
+}
+
+static bool keymap_init(KeyMap *map, size_t expected) {
+    size_t size = 16;
+    while (size < expected * 2) size *= 2;
+    map->keys = malloc(sizeof(uint64_t) * size);
+    map->ids = malloc(sizeof(uint32_t) * size);
+    map->mask = size - 1;
+    map->count = 0;
+    if (!map->keys || !map->ids) {
+        keymap_free(map);
+        map->keys = NULL;
+        map->ids = NULL;
+        return false;
+    }
+    memset(map->ids, 0xff, sizeof(uint32_t) * size);
+    return true;
+}
+
+static size_t keymap_slot(const KeyMap *map, uint64_t key) {
+    size_t i = (size_t)rb_hash_int((int64_t)key) & map->mask;
+    while (map->ids[i] != NO_CODE && map->keys[i] != key) i = (i + 1) & map->mask;
+    return i;
+}
+
+static uint32_t keymap_find(const KeyMap *map, uint64_t key) {
+    return map->ids[keymap_slot(map, key)];
+}
+
+static bool keymap_grow(KeyMap *map) {
+    KeyMap grown;
+    if (!keymap_init(&grown, map->mask + 1)) return false;
+    for (size_t i = 0; i <= map->mask; i++) {
+        if (map->ids[i] == NO_CODE) continue;
+        size_t slot = keymap_slot(&grown, map->keys[i]);
+        grown.keys[slot] = map->keys[i];
+        grown.ids[slot] = map->ids[i];
+    }
+    grown.count = map->count;
+    keymap_free(map);
+    *map = grown;
+    return true;
+}
+
+/* Id for key, adding it if new (*added tells which); NO_CODE if out of
+ * memory */
+static uint32_t keymap_add(KeyMap *map, uint64_t key, bool *added) {
+    size_t slot = keymap_slot(map, key);
+    *added = map->ids[slot] == NO_CODE;
+    if (!*added) return map->ids[slot];
+    if (map->count == NO_CODE - 1) return NO_CODE;
+    if ((map->count + 1) * 2 > map->mask + 1) {
+        if (!keymap_grow(map)) return NO_CODE;
+        slot = keymap_slot(map, key);
+    }
+    map->keys[slot] = key;
+    map->ids[slot] = (uint32_t)map->count;
+    return (uint32_t)map->count++;
+}
+
+/* ========== GROUP BY ========== */
+
+/* Groups of one chunk, or of the whole table after merging. Per group:
+ * the key, the row count and one Acc per spec. */
+typedef struct {
+    KeyMap map;
+    uint64_t *keys;
+    uint64_t *rows;
+    Acc *accs;
+    size_t capacity;
+    bool failed;
+} Groups;
+
+static bool groups_init(Groups *groups, size_t expected) {
+    memset(groups, 0, sizeof(*groups));
+    return keymap_init(&groups->map, expected);
+}
+
+static void groups_free(Groups *groups) {
+    keymap_free(&groups->map);
+    free(groups->keys);
+    free(groups->rows);
+    free(groups->accs);
+}
+
+/* Group id for key, creating the group if new; NO_CODE if out of memory */
+static uint32_t groups_add(Groups *groups, uint64_t key, size_t spec_count) {
+    bool added;
+    uint32_t id = keymap_add(&groups->map, key, &added);
+    if (id == NO_CODE || !added) return id;
+    if (id == groups->capacity) {
+        size_t capacity = groups->capacity ? groups->capacity * 2 : 64;
+        uint64_t *keys = realloc(groups->keys, sizeof(uint64_t) * capacity);
+        if (keys) groups->keys = keys;
+        uint64_t *rows = realloc(groups->rows, sizeof(uint64_t) * capacity);
+        if (rows) groups->rows = rows;
+        Acc *accs = realloc(groups->accs, sizeof(Acc) * capacity * (spec_count ? spec_count : 1));
+        if (accs) groups->accs = accs;
+        if (!keys || !rows || !accs) return NO_CODE;
+        groups->capacity = capacity;
+    }
+    groups->keys[id] = key;
+    groups->rows[id] = 0;
+    for (size_t s = 0; s < spec_count; s++) acc_init(&groups->accs[id * spec_count + s]);
+    return id;
+}
+
+typedef struct {
+    const Table *table;
+    const Column *key;
+    const TableAggSpec *specs;
+    size_t spec_count;
+    Groups *partial;            /* per chunk */
+} GroupJob;
+
+/* Group id of every row in the chunk. Dictionary codes of a small
+ * dictionary index a code -> id array, which skips hashing. */
+static bool group_ids(GroupJob *job, Groups *groups, size_t begin, size_t end, uint32_t *ids) {
+    const Column *key = job->key;
+    const size_t spec_count = job->spec_count;
+    if (key->type == TABLE_STRING && key->dict->count <= TABLE_CHUNK_ROWS) {
+        uint32_t *by_code = malloc(sizeof(uint32_t) * (key->dict->count ? key->dict->count : 1));
+        if (!by_code) return false;
+        memset(by_code, 0xff, sizeof(uint32_t) * key->dict->count);
+        for (size_t r = begin; r < end; r++) {
+            uint32_t code = key->as.codes[r];
+            uint32_t id = by_code[code];
+            if (id == NO_CODE) {
+                id = by_code[code] = groups_add(groups, code, spec_count);
+                if (id == NO_CODE) {
+                    free(by_code);
+                    return false;
+                }
+            }
+            ids[r - begin] = id;
+        }
+        free(by_code);
+        return true;
+    }
+    for (size_t r = begin; r < end; r++) {
+        uint32_t id = groups_add(groups, row_key(key, r), spec_count);
+        if (id == NO_CODE) return false;
+        ids[r - begin] = id;
+    }
+    return true;
+}
+
+static void group_chunk(void *ctx, size_t chunk) {
+    GroupJob *job = ctx;
+    size_t begin, end;
+    chunk_range(chunk, job->table->rows, &begin, &end);
+    Groups *groups = &job->partial[chunk];
+    uint32_t *ids = malloc(sizeof(uint32_t) * (end - begin ? end - begin : 1));
+    if (!ids || !groups_init(groups, 256) || !group_ids(job, groups, begin, end, ids)) {
+        groups->failed = true;
+        free(ids);
+        return;
+    }
+    for (size_t r = begin; r < end; r++) groups->rows[ids[r - begin]]++;
+
+    /* One column at a time, so each loop reads a single array */
+    const size_t spec_count = job->spec_count;
+    for (size_t s = 0; s < spec_count; s++) {
+        if (job->specs[s].agg == TABLE_COUNT) continue;
+        const Column *c = &job->table->columns[job->specs[s].column];
+        Acc *accs = groups->accs + s;
+        if (c->type == TABLE_FLOAT64) {
+            for (size_t r = begin; r < end; r++) acc_add(&accs[(size_t)ids[r - begin] * spec_count], c->as.f64[r]);
+        } else {
+            for (size_t r = begin; r < end; r++) {
+                acc_add(&accs[(size_t)ids[r - begin] * spec_count], (double)c->as.i64[r]);
+            }
+        }
+    }
+    free(ids);
+}
+
+static const char *agg_name(TableAgg agg) {
+    switch (agg) {
+        case TABLE_SUM: return "sum";
+        case TABLE_MEAN: return "mean";
+        case TABLE_MIN: return "min";
+        case TABLE_MAX: return "max";
+        case TABLE_COUNT: return "count";
+    }
+    return "agg";
+}
+
+static Table *groups_table(const Groups *groups, const Column *key, const Table *table,
+                           const TableAggSpec *specs, size_t spec_count) {
+    size_t count = groups->map.count;
+    Table *result = table_new(count);
+    if (!result) return NULL;
+    Column *out = table_add_column(result, key->name, key->type, key->dict);
+    if (!out) {
+        table_free(result);
+        return NULL;
+    }
+    for (size_t g = 0; g < count; g++) {
+        uint64_t k = groups->keys[g];
+        if (key->type == TABLE_STRING) out->as.codes[g] = (uint32_t)k;
+        else if (key->type == TABLE_INT64) out->as.i64[g] = (int64_t)k;
+        else out->as.f64[g] = float_of_key(k);
+    }
+
+    for (size_t s = 0; s < spec_count; s++) {
+        char name[256];
+        if (specs[s].agg == TABLE_COUNT) {
+            snprintf(name, sizeof(name), "count");
+        } else {
+            snprintf(name, sizeof(name), "%s_%s", agg_name(specs[s].agg), table->columns[specs[s].column].name);
+        }
+        bool count_column = specs[s].agg == TABLE_COUNT;
+        Column *column = table_add_column(result, name, count_column ? TABLE_INT64 : TABLE_FLOAT64, NULL);
+        if (!column) {
+            table_free(result);
+            return NULL;
+        }
+        for (size_t g = 0; g < count; g++) {
+            if (count_column) column->as.i64[g] = (int64_t)groups->rows[g];
+            else column->as.f64[g] = acc_result(&groups->accs[g * spec_count + s], specs[s].agg, groups->rows[g]);
+        }
+    }
+    return result;
+}
+
+Table *table_group_by(const Table *table, size_t key, const TableAggSpec *specs, size_t spec_count) {
+    if (key >= table->column_count) return NULL;
+    for (size_t s = 0; s < spec_count; s++) {
+        if (specs[s].agg == TABLE_COUNT) continue;
+        if (specs[s].column >= table->column_count || !is_numeric(&table->columns[specs[s].column])) return NULL;
+    }
+
+    size_t chunks = chunk_count(table->rows);
+    GroupJob job = { table, &table->columns[key], specs, spec_count, NULL };
+    job.partial = calloc(chunks ? chunks : 1, sizeof(Groups));
+    if (!job.partial) return NULL;
+    parallel_for(chunks, group_chunk, &job);
+
+    /* Merge in chunk order so groups keep their first-appearance order */
+    Groups total;
+    Table *result = NULL;
+    bool ok = groups_init(&total, 256);
+    for (size_t chunk = 0; chunk < chunks && ok; chunk++) {
+        Groups *part = &job.partial[chunk];
+        if (part->failed) {
+            ok = false;
+            break;
+        }
+        for (size_t g = 0; g < part->map.count; g++) {
+            uint32_t id = groups_add(&total, part->keys[g], spec_count);
+            if (id == NO_CODE) {
+                ok = false;
+                break;
+            }
+            total.rows[id] += part->rows[g];
+            for (size_t s = 0; s < spec_count; s++) {
+                acc_merge(&total.accs[(size_t)id * spec_count + s], &part->accs[g * spec_count + s]);
+            }
+        }
+    }
+    if (ok) result = groups_table(&total, &table->columns[key], table, specs, spec_count);
+    if (ok || total.map.keys) groups_free(&total);
+    for (size_t chunk = 0; chunk < chunks; chunk++) groups_free(&job.partial[chunk]);
+    free(job.partial);
+    return result;
+}
+
+/* ========== SORT ========== */
+
+static const StringDict *sort_dict;
+
+static int compare_codes(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return compare_bytes(sort_dict->strings[x], sort_dict->lengths[x],
+                         sort_dict->strings[y], sort_dict->lengths[y]);
+}
+
+/* Rank of every code in byte order, so codes can sort as integers */
+static uint64_t *string_ranks(const StringDict *dict) {
+    uint32_t *codes = malloc(sizeof(uint32_t) * (dict->count ? dict->count : 1));
+    uint64_t *ranks = malloc(sizeof(uint64_t) * (dict->count ? dict->count : 1));
+    if (!codes || !ranks) {
+        free(codes);
+        free(ranks);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < dict->count; i++) codes[i] = i;
+    sort_dict = dict;
+    qsort(codes, dict->count, sizeof(uint32_t), compare_codes);
+    for (uint32_t i = 0; i < dict->count; i++) ranks[codes[i]] = i;
+    free(codes);
+    return ranks;
+}
+
+
+typedef struct {
+    const Column *column;
+    const uint64_t *ranks;      /* string columns */
+    bool descending;
+    size_t rows;
+    uint64_t *keys;
+} SortKeyJob;
+
+#define SIGN_BIT 0x8000000000000000ULL
+#define NAN_KEY UINT64_MAX
+
+/* Unsigned keys in the column's order; NaN gets NAN_KEY, after everything
+ * in either direction */
+static void sort_key_chunk(void *ctx, size_t chunk) {
+    SortKeyJob *job = ctx;
+    const Column *c = job->column;
+    size_t begin, end;
+    chunk_range(chunk, job->rows, &begin, &end);
+    for (size_t r = begin; r < end; r++) {
+        uint64_t key;
+        if (c->type == TABLE_STRING) {
+            key = job->ranks[c->as.codes[r]];
+        } else if (c->type == TABLE_INT64) {
+            key = (uint64_t)c->as.i64[r] ^ SIGN_BIT;
+        } else {
+            double v = c->as.f64[r];
+            if (v != v) {
+                job->keys[r] = NAN_KEY;
+                continue;
+            }
+            if (v == 0) v = 0;
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            key = bits & SIGN_BIT ? ~bits : bits | SIGN_BIT;
+        }
+        job->keys[r] = job->descending ? ~key : key;
+    }
+}
+
+/* Stable LSD radix sort of (key, row) pairs, a byte per pass. Returns the
+ * buffer (rows or row_tmp) that ends up holding the sorted rows. */
+static uint32_t *radix_sort(uint64_t *keys, uint32_t *rows, uint64_t *key_tmp, uint32_t *row_tmp, size_t n) {
+    if (n == 0) return rows;
+    size_t (*counts)[256] = calloc(8, sizeof(*counts));
+    if (!counts) return NULL;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = keys[i];
+        for (int b = 0; b < 8; b++) counts[b][(k >> (8 * b)) & 0xff]++;
+    }
+    for (int b = 0; b < 8; b++) {
+        /* A byte that is the same in every key leaves the order unchanged */
+        if (counts[b][(keys[0] >> (8 * b)) & 0xff] == n) continue;
+        size_t offset = 0;
+        for (int d = 0; d < 256; d++) {
+            size_t count = counts[b][d];
+            counts[b][d] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < n; i++) {
+            size_t at = counts[b][(keys[i] >> (8 * b)) & 0xff]++;
+            key_tmp[at] = keys[i];
+            row_tmp[at] = rows[i];
+        }
+        uint64_t *k = keys;
+        keys = key_tmp;
+        key_tmp = k;
+        uint32_t *r = rows;
+        rows = row_tmp;
+        row_tmp = r;
+    }
+    free(counts);
+    return rows;
+}
+
+Table *table_sort(const Table *table, size_t column, bool descending) {
+    if (column >= table->column_count) return NULL;
+    const Column *c = &table->columns[column];
+    size_t n = table->rows;
+    SortKeyJob job = { c, NULL, descending, n, NULL };
+    if (c->type == TABLE_STRING && !(job.ranks = string_ranks(c->dict))) return NULL;
+
+    size_t size = n ? n : 1;
+    job.keys = malloc(sizeof(uint64_t) * size);
+    uint64_t *key_tmp = malloc(sizeof(uint64_t) * size);
+    uint32_t *rows = malloc(sizeof(uint32_t) * size);
+    uint32_t *row_tmp = malloc(sizeof(uint32_t) * size);
+    Table *result = NULL;
+    if (job.keys && key_tmp && rows && row_tmp) {
+        parallel_for(chunk_count(n), sort_key_chunk, &job);
+        for (size_t r = 0; r < n; r++) rows[r] = (uint32_t)r;
+        Selection order = { radix_sort(job.keys, rows, key_tmp, row_tmp, n), n };
+        if (order.rows) result = table_take(table, &order);
+    }
+    free((void *)job.ranks);
+    free(job.keys);
+    free(key_tmp);
+    free(rows);
+    free(row_tmp);
+    return result;
+}
+
+/* ========== JOIN ========== */
+
+typedef enum {
+    JOIN_INT,                   /* both int64 */
+    JOIN_FLOAT,                 /* numeric, compared as doubles */
+    JOIN_STRING                 /* left codes translated to right codes */
+} JoinMode;
+
+typedef struct {
+    JoinMode mode;
+    const uint32_t *translate;  /* JOIN_STRING: left code -> right code */
+} JoinKeys;
+
+/* Key of a row in the right table's key space; false if it cannot match */
+static bool join_key(const JoinKeys *keys, const Column *column, size_t row, bool left, uint64_t *out) {
+    switch (keys->mode) {
+        case JOIN_INT:
+            *out = (uint64_t)column->as.i64[row];
+            return true;
+        case JOIN_FLOAT: {
+            double v = column->type == TABLE_INT64 ? (double)column->as.i64[row] : column->as.f64[row];
+            *out = float_key(v);
+            return v == v;
+        }
+        case JOIN_STRING: {
+            uint32_t code = column->as.codes[row];
+            if (left) code = keys->translate[code];
+            *out = code;
+            return code != NO_CODE;
+        }
+    }
+    return false;
+}
+
+/* The probe runs twice over the same chunks: once to count each chunk's
+ * matches, then, at the offsets those counts give, to write the matched
+ * row pairs straight into the two output selections. */
+typedef struct {
+    const JoinKeys *keys;
+    const Column *probe;
+    size_t rows;
+    const KeyMap *map;
+    const uint32_t *heads;      /* per key id: first right row */
+    const uint32_t *next;       /* per right row: next row with the key */
+    size_t *offsets;            /* per chunk: match count, then first output index */
+    uint32_t *left_rows;        /* NULL while counting */
+    uint32_t *right_rows;
+} ProbeJob;
+
+static void probe_chunk(void *ctx, size_t chunk) {
+    ProbeJob *job = ctx;
+    size_t begin, end;
+    chunk_range(chunk, job->rows, &begin, &end);
+    size_t out = job->left_rows ? job->offsets[chunk] : 0;
+    for (size_t r = begin; r < end; r++) {
+        uint64_t key;
+        if (!join_key(job->keys, job->probe, r, true, &key)) continue;
+        uint32_t id = job->keys->mode == JOIN_STRING ? (uint32_t)key : keymap_find(job->map, key);
+        if (id == NO_CODE) continue;
+        for (uint32_t match = job->heads[id]; match != NO_CODE; match = job->next[match]) {
+            if (job->left_rows) {
+                job->left_rows[out] = (uint32_t)r;
+                job->right_rows[out] = match;
+            }
+            out++;
+        }
+    }
+    if (!job->left_rows) job->offsets[chunk] = out;
+}
+
+/* Move the right table's columns (but its key) onto the end of `into` */
+static bool append_columns(Table *into, Table *from, size_t skip) {
+    Column *columns = realloc(into->columns, sizeof(Column) * (into->column_count + from->column_count));
+    if (!columns) return false;
+    into->columns = columns;
+    for (size_t i = 0; i < from->column_count; i++) {
+        if (i == skip) continue;
+        Column column = from->columns[i];
+        if (table_column_index(into, column.name) >= 0) {
+            size_t length = strlen(column.name);
+            char *renamed = malloc(length + sizeof("_right"));
+            if (!renamed) return false;
+            memcpy(renamed, column.name, length);
+            memcpy(renamed + length, "_right", sizeof("_right"));
+            free(column.name);
+            column.name = renamed;
+        }
+        into->columns[into->column_count++] = column;
+        memset(&from->columns[i], 0, sizeof(Column));
+    }
+    return true;
+}
+
+Table *table_join(const Table *left, size_t left_key, const Table *right, size_t right_key) {
+    if (left_key >= left->column_count || right_key >= right->column_count) return NULL;
+    const Column *lk = &left->columns[left_key];
+    const Column *rk = &right->columns[right_key];
+    if ((lk->type == TABLE_STRING) != (rk->type == TABLE_STRING)) return NULL;
+
+    JoinKeys keys = { JOIN_FLOAT, NULL };
+    uint32_t *translate = NULL;
+    if (lk->type == TABLE_STRING) {
+        keys.mode = JOIN_STRING;
+        translate = malloc(sizeof(uint32_t) * (lk->dict->count ? lk->dict->count : 1));
+        if (!translate) return NULL;
+        for (uint32_t code = 0; code < lk->dict->count; code++) {
+            translate[code] = lk->dict == rk->dict ? code
+                : string_dict_find(rk->dict, lk->dict->strings[code], lk->dict->lengths[code]);
+        }
+        keys.translate = translate;
+    } else if (lk->type == TABLE_INT64 && rk->type == TABLE_INT64) {
+        keys.mode = JOIN_INT;
+    }
+
+    /* Build: key ids for the right rows, chained in row order. String keys
+     * use the right dictionary codes as ids. */
+    Table *result = NULL;
+    KeyMap map;
+    uint32_t *ids = malloc(sizeof(uint32_t) * (right->rows ? right->rows : 1));
+    uint32_t *next = malloc(sizeof(uint32_t) * (right->rows ? right->rows : 1));
+    uint32_t *heads = NULL;
+    size_t chunks = chunk_count(left->rows);
+    size_t *offsets = malloc(sizeof(size_t) * (chunks ? chunks : 1));
+    bool ok = ids && next && offsets && keymap_init(&map, 1024);
+    bool have_map = ok;
+    for (size_t r = 0; ok && r < right->rows; r++) {
+        uint64_t key;
+        bool added;
+        if (!join_key(&keys, rk, r, false, &key)) ids[r] = NO_CODE;
+        else ids[r] = keys.mode == JOIN_STRING ? (uint32_t)key : keymap_add(&map, key, &added);
+        if (ids[r] == NO_CODE && keys.mode != JOIN_FLOAT) ok = false;
+    }
+    size_t id_count = keys.mode == JOIN_STRING ? rk->dict->count : have_map ? map.count : 0;
+    if (ok) ok = (heads = malloc(sizeof(uint32_t) * (id_count ? id_count : 1))) != NULL;
+    if (ok) {
+        memset(heads, 0xff, sizeof(uint32_t) * (id_count ? id_count : 1));
+        for (size_t r = right->rows; r-- > 0;) {
+            if (ids[r] == NO_CODE) continue;
+            next[r] = heads[ids[r]];
+            heads[ids[r]] = (uint32_t)r;
+        }
+
+        ProbeJob job = { &keys, lk, left->rows, &map, heads, next, offsets, NULL, NULL };
+        parallel_for(chunks, probe_chunk, &job);
+
+        size_t total = 0;
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            size_t count = offsets[chunk];
+            offsets[chunk] = total;
+            total += count;
+        }
+        Selection from_left = { NULL, total };
+        Selection from_right = { NULL, total };
+        ok = total <= TABLE_MAX_ROWS;
+        if (ok) {
+            from_left.rows = malloc(sizeof(uint32_t) * (total ? total : 1));
+            from_right.rows = malloc(sizeof(uint32_t) * (total ? total : 1));
+            ok = from_left.rows && from_right.rows;
+        }
+        if (ok) {
+            job.left_rows = from_left.rows;
+            job.right_rows = from_right.rows;
+            parallel_for(chunks, probe_chunk, &job);
+
+            result = table_take(left, &from_left);
+            Table *matched = result ? table_take(right, &from_right) : NULL;
+            if (!matched || !append_columns(result, matched, right_key)) {
+                table_free(result);
+                result = NULL;
+            }
+            table_free(matched);
+        }
+        selection_free(&from_left);
+        selection_free(&from_right);
+    }
+
+    if (have_map) keymap_free(&map);
+    free(offsets);
+    free(ids);
+    free(next);
+    free(heads);
+    free(translate);
+    return result;
+}
+
+/* ========== CELL PARSING ========== */
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+static bool buffer_reserve(Buffer *buffer, size_t extra) {
+    if (buffer->length + extra + 1 <= buffer->capacity) return true;
+    size_t capacity = buffer->capacity ? buffer->capacity : 256;
+    while (capacity < buffer->length + extra + 1) capacity *= 2;
+    char *grown = realloc(buffer->data, capacity);
+    if (!grown) return false;
+    buffer->data = grown;
+    buffer->capacity = capacity;
+    return true;
+}
+
+static bool buffer_append(Buffer *buffer, const char *data, size_t length) {
+    if (!buffer_reserve(buffer, length)) return false;
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    return true;
+}
+
+static bool buffer_push(Buffer *buffer, char c) {
+    if (!buffer_reserve(buffer, 1)) return false;
+    buffer->data[buffer->length++] = c;
+    return true;
+}
+
+static ColumnType column_type(const CsvKinds *kinds) {
+    switch (csv_kinds_type(kinds)) {
+        case CSV_TYPE_INT: return TABLE_INT64;
+        case CSV_TYPE_FLOAT: return TABLE_FLOAT64;
+        case CSV_TYPE_STRING: return TABLE_STRING;
+    }
+    return TABLE_STRING;
+}
+
+/* Store a parsed cell in row `row` of a column of the chosen type */
+static bool store_cell(Column *column, size_t row, CsvCellKind kind, int64_t integer, double number,
+                       const char *text, size_t length) {
+    switch (column->type) {
+        case TABLE_INT64:
+            column->as.i64[row] = integer;
+            return true;
+        case TABLE_FLOAT64:
+            column->as.f64[row] = kind == CSV_CELL_INT ? (double)integer : kind == CSV_CELL_FLOAT ? number : NAN;
+            return true;
+        case TABLE_STRING: {
+            uint32_t code = string_dict_intern(column->dict, text, length);
+            column->as.codes[row] = code;
+            return code != NO_CODE;
+        }
+    }
+    return false;
+}
+
+/* Cells never seen in a row (short records, missing keys) */
+static bool store_missing(Column *column, size_t row) {
+    return store_cell(column, row, CSV_CELL_EMPTY, 0, 0, "", 0);
+}
+
+/* ========== CSV ========== */
+
+/* One pass over the records after the header. Pass 1 (table NULL) types
+ * the columns and counts rows; pass 2 fills the table. */
+static bool csv_pass(CsvReader *reader, size_t column_count, CsvKinds *kinds, Table *table, size_t *rows) {
+    bool ok = true;
+    size_t row = 0;
+    const CsvField *fields;
+    size_t count;
+    while (ok && csv_reader_next(reader, &fields, &count)) {
+        for (size_t i = 0; i < column_count; i++) {
+            if (i >= count) {
+                if (!table) kinds[i].has_empty = true;
+                else if (!store_missing(&table->columns[i], row)) ok = false;
+                continue;
+            }
+            int64_t integer = 0;
+            double number = 0;
+            CsvCellKind kind = csv_classify(fields[i].data, fields[i].length, &integer, &number);
+            if (!table) csv_kinds_note(&kinds[i], kind);
+            else if (!store_cell(&table->columns[i], row, kind, integer, number, fields[i].data, fields[i].length)) ok = false;
+        }
+        if (++row > TABLE_MAX_ROWS) ok = false;
+    }
+    *rows = row;
+    return ok && !csv_reader_failed(reader);
+}
+
+Table *table_read_csv(const char *path, char delimiter) {
+    CsvReader *reader = csv_reader_open(path, delimiter);
+    if (!reader) return NULL;
+
+    /* Header */
+    char **names = NULL;
+    size_t column_count = 0;
+    const CsvField *fields;
+    bool ok = csv_reader_next(reader, &fields, &column_count) &&
+              (names = calloc(column_count, sizeof(char *))) != NULL;
+    for (size_t i = 0; ok && i < column_count; i++) {
+        ok = (names[i] = copy_bytes(fields[i].data, fields[i].length)) != NULL;
+    }
+
+    Table *table = NULL;
+    CsvKinds *kinds = calloc(column_count ? column_count : 1, sizeof(CsvKinds));
+    size_t rows = 0;
+    ok = ok && kinds && csv_pass(reader, column_count, kinds, NULL, &rows);
+    if (ok) ok = (table = table_new(rows)) != NULL;
+    for (size_t i = 0; ok && i < column_count; i++) {
+        ok = table_add_column(table, names[i], column_type(&kinds[i]), NULL) != NULL;
+    }
+
+    /* Pass 2 reads the mapping again from the top */
+    csv_reader_close(reader);
+    reader = ok ? csv_reader_open(path, delimiter) : NULL;
+    ok = ok && reader && csv_reader_next(reader, &fields, &column_count);
+    if (ok) ok = csv_pass(reader, column_count, kinds, table, &rows);
+    if (!ok) {
+        table_free(table);
+        table = NULL;
+    }
+
+    for (size_t i = 0; names && i < column_count; i++) free(names[i]);
+    free(names);
+    free(kinds);
+    csv_reader_close(reader);
+    return table;
+}
+
+/* ========== NDJSON ========== */
+
+typedef struct {
+    const char *p;
+    const char *end;
+} JsonCursor;
+
+static void json_space(JsonCursor *j) {
+    while (j->p < j->end && (*j->p == ' ' || *j->p == '\t' || *j->p == '\r' || *j->p == '\n')) j->p++;
+}
+
+static bool json_hex4(JsonCursor *j, uint32_t *out) {
+    if (j->end - j->p < 4) return false;
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = *j->p++;
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f') value |= (uint32_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') value |= (uint32_t)(c - 'A' + 10);
+        else return false;
+    }
+    *out = value;
+    return true;
+}
+
+static bool buffer_push_utf8(Buffer *out, uint32_t cp) {
+    char bytes[4];
+    size_t n;
+    if (cp < 0x80) {
+        bytes[0] = (char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        bytes[0] = (char)(0xc0 | (cp >> 6));
+        bytes[1] = (char)(0x80 | (cp & 0x3f));
+        n = 2;
+    } else if (cp < 0x10000) {
+        bytes[0] = (char)(0xe0 | (cp >> 12));
+        bytes[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        bytes[2] = (char)(0x80 | (cp & 0x3f));
+        n = 3;
+    } else {
+        bytes[0] = (char)(0xf0 | (cp >> 18));
+        bytes[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+        bytes[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        bytes[3] = (char)(0x80 | (cp & 0x3f));
+        n = 4;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!buffer_push(out, bytes[i])) return false;
+    }
+    return true;
+}
+
+/* A string literal at the cursor, unescaped into out */
+static bool json_string(JsonCursor *j, Buffer *out) {
+    out->length = 0;
+    if (j->p >= j->end || *j->p != '"') return false;
+    j->p++;
+    while (j->p < j->end) {
+        char c = *j->p++;
+        if (c == '"') return buffer_reserve(out, 0);
+        if (c != '\\') {
+            if (!buffer_push(out, c)) return false;
+            continue;
+        }
+        if (j->p >= j->end) return false;
+        c = *j->p++;
+        uint32_t cp;
+        switch (c) {
+            case '"': case '\\': case '/': cp = (uint32_t)c; break;
+            case 'b': cp = '\b'; break;
+            case 'f': cp = '\f'; break;
+            case 'n': cp = '\n'; break;
+            case 'r': cp = '\r'; break;
+            case 't': cp = '\t'; break;
+            case 'u': {
+                if (!json_hex4(j, &cp)) return false;
+                if (cp >= 0xd800 && cp < 0xdc00) {
+                    uint32_t low;
+                    JsonCursor save = *j;
+                    if (j->end - j->p >= 2 && j->p[0] == '\\' && j->p[1] == 'u' &&
+                        (j->p += 2, json_hex4(j, &low)) && low >= 0xdc00 && low < 0xe000) {
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                    } else {
+                        *j = save;
+                        cp = 0xfffd;
+                    }
+                } else if (cp >= 0xdc00 && cp < 0xe000) {
+                    cp = 0xfffd;
+                }
+                break;
+            }
+            default: return false;
+        }
+        if (!buffer_push_utf8(out, cp)) return false;
+    }
+    return false;
+}
+
+/* A scalar value: a string, number, true / false or null. text gets the
+ * string's contents, or the token itself ("" for null) in case the column
+ * turns out to hold strings. Nested objects and arrays are rejected. */
+static bool json_scalar(JsonCursor *j, Buffer *text, CsvCellKind *kind, int64_t *integer, double *number) {
+    if (j->p >= j->end) return false;
+    char c = *j->p;
+    if (c == '"') {
+        *kind = CSV_CELL_STRING;
+        return json_string(j, text);
+    }
+    static const struct { const char *word; size_t length; CsvCellKind kind; int64_t value; } words[] = {
+        { "true", 4, CSV_CELL_INT, 1 }, { "false", 5, CSV_CELL_INT, 0 }, { "null", 4, CSV_CELL_EMPTY, 0 }
+    };
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        if ((size_t)(j->end - j->p) >= words[i].length && memcmp(j->p, words[i].word, words[i].length) == 0) {
+            text->length = 0;
+            if (words[i].kind != CSV_CELL_EMPTY && !buffer_append(text, j->p, words[i].length)) return false;
+            j->p += words[i].length;
+            *kind = words[i].kind;
+            *integer = words[i].value;
+            return true;
+        }
+    }
+    const char *start = j->p;
+    while (j->p < j->end && (strchr("+-.eE", *j->p) || (*j->p >= '0' && *j->p <= '9'))) j->p++;
+    size_t length = (size_t)(j->p - start);
+    text->length = 0;
+    *kind = csv_classify(start, length, integer, number);
+    return (*kind == CSV_CELL_INT || *kind == CSV_CELL_FLOAT) && buffer_append(text, start, length);
+}
+
+typedef struct {
+    StringDict *names;          /* key -> column index */
+    CsvKinds *kinds;
+    size_t *last_row;           /* last row that set the column */
+    size_t column_count;
+    size_t capacity;
+} JsonColumns;
+
+/* Column index for a key, adding it in pass 1; SIZE_MAX on failure */
+static size_t json_column(JsonColumns *columns, const Buffer *key, bool add) {
+    const char *text = key->data ? key->data : "";
+    if (!add) {
+        uint32_t code = string_dict_find(columns->names, text, key->length);
+        return code == NO_CODE ? SIZE_MAX : code;
+    }
+    uint32_t code = string_dict_intern(columns->names, text, key->length);
+    if (code == NO_CODE) return SIZE_MAX;
+    if (code == columns->column_count) {
+        if (columns->column_count == columns->capacity) {
+            size_t capacity = columns->capacity ? columns->capacity * 2 : 16;
+            CsvKinds *kinds = realloc(columns->kinds, sizeof(CsvKinds) * capacity);
+            if (kinds) columns->kinds = kinds;
+            size_t *last_row = realloc(columns->last_row, sizeof(size_t) * capacity);
+            if (last_row) columns->last_row = last_row;
+            if (!kinds || !last_row) return SIZE_MAX;
+            columns->capacity = capacity;
+        }
+        memset(&columns->kinds[code], 0, sizeof(CsvKinds));
+        columns->last_row[code] = SIZE_MAX;
+        columns->column_count++;
+    }
+    return code;
+}
+
+/* One object per non-blank line. Pass 1 (table NULL) finds the columns,
+ * types them and counts rows; pass 2 fills the table. */
+static bool ndjson_pass(const MappedFile *file, JsonColumns *columns, Table *table, size_t *rows) {
+    Buffer key = {0}, text = {0};
+    bool ok = true;
+    size_t row = 0;
+    JsonCursor j = { file->data, file->data + file->size };
+    for (size_t i = 0; i < columns->column_count; i++) columns->last_row[i] = SIZE_MAX;
+
+    while (ok) {
+        json_space(&j);
+        if (j.p >= j.end) break;
+        if (*j.p != '{' || row >= TABLE_MAX_ROWS) {
+            ok = false;
+            break;
+        }
+        j.p++;
+        json_space(&j);
+        bool more = j.p < j.end && *j.p != '}';
+        while (ok && more) {
+            int64_t integer = 0;
+            double number = 0;
+            CsvCellKind kind;
+            json_space(&j);
+            ok = json_string(&j, &key);
+            json_space(&j);
+            ok = ok && j.p < j.end && *j.p++ == ':';
+            json_space(&j);
+            ok = ok && json_scalar(&j, &text, &kind, &integer, &number);
+            if (!ok) break;
+
+            size_t column = json_column(columns, &key, table == NULL);
+            if (column == SIZE_MAX) {
+                ok = false;
+                break;
+            }
+            columns->last_row[column] = row;
+            if (!table) csv_kinds_note(&columns->kinds[column], kind);
+            else ok = store_cell(&table->columns[column], row, kind, integer, number,
+                                 text.data ? text.data : "", text.length);
+
+            json_space(&j);
+            if (j.p < j.end && *j.p == ',') j.p++;
+            else more = false;
+        }
+        ok = ok && j.p < j.end && *j.p++ == '}';
+        for (size_t i = 0; ok && i < columns->column_count; i++) {
+            if (columns->last_row[i] == row) continue;
+            if (!table) columns->kinds[i].has_empty = true;
+            else if (!store_missing(&table->columns[i], row)) ok = false;
+        }
+        row++;
+    }
+    free(key.data);
+    free(text.data);
+    *rows = row;
+    return ok;
+}
+
+Table *table_read_ndjson(const char *path) {
+    MappedFile file;
+    if (!mapped_file_open(&file, path)) return NULL;
+    JsonColumns columns = {0};
+    Table *table = NULL;
+    size_t rows = 0;
+    bool ok = (columns.names = string_dict_new()) != NULL && ndjson_pass(&file, &columns, NULL, &rows);
+    if (ok) ok = (table = table_new(rows)) != NULL;
+    for (size_t i = 0; ok && i < columns.column_count; i++) {
+        ok = table_add_column(table, columns.names->strings[i], column_type(&columns.kinds[i]), NULL) != NULL;
+    }
+    if (ok) ok = ndjson_pass(&file, &columns, table, &rows);
+    if (!ok) {
+        table_free(table);
+        table = NULL;
+    }
+    string_dict_release(columns.names);
+    free(columns.kinds);
+    free(columns.last_row);
+    mapped_file_close(&file);
+    return table;
+}
+
+/* ========== CSV OUTPUT ========== */
+
+bool table_write_csv(const Table *table, const char *path, char delimiter) {
+    CsvWriter *out = csv_writer_open(path, delimiter);
+    if (!out) return false;
+    for (size_t i = 0; i < table->column_count; i++) {
+        csv_writer_field(out, table->columns[i].name, strlen(table->columns[i].name));
+    }
+    csv_writer_end_row(out);
+    for (size_t r = 0; r < table->rows; r++) {
+        for (size_t i = 0; i < table->column_count; i++) {
+            const Column *c = &table->columns[i];
+            if (c->type == TABLE_INT64) {
+                csv_writer_int(out, c->as.i64[r]);
+            } else if (c->type == TABLE_FLOAT64) {
+                csv_writer_number(out, c->as.f64[r]);
+            } else {
+                uint32_t code = c->as.codes[r];
+                csv_writer_field(out, c->dict->strings[code], c->dict->lengths[code]);
+            }
+        }
+        csv_writer_end_row(out);
+    }
+    return csv_writer_close(out);
+}
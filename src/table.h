@@ -0,0 +1,182 @@
+#ifndef RUBOLT_TABLE_H
+#define RUBOLT_TABLE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threading.h"
+
+/* Columnar in-memory tables.
+ *
+ * A table is a set of equally long columns, each a packed typed array:
+ * float64, int64, or dictionary-encoded strings (a uint32 code per row into
+ * a string dictionary that derived tables share). Operators work a column
+ * at a time over chunks of TABLE_CHUNK_ROWS rows, and independent chunks
+ * run in parallel on the thread pool:
+ *
+ *   filter     predicates produce a selection vector (the matching row
+ *              numbers); further predicates refine it, and table_take
+ *              gathers the selected rows into a new table
+ *   aggregate  sum / mean / min / max / count of a column
+ *   group by   per-chunk hash tables of partial aggregates, merged at the
+ *              end; groups come out in order of first appearance
+ *   sort       stable LSD radix sort of order-preserving 64-bit keys
+ *   join       inner hash join, probing in parallel
+ *
+ * Missing numbers are NaN and are skipped by the aggregates (count counts
+ * rows). Strings compare bytewise. Operators return NULL / false on
+ * allocation failure or on a column of the wrong type. */
+
+#define TABLE_CHUNK_ROWS    ((size_t)1 << 16)
+#define TABLE_MAX_ROWS      ((size_t)UINT32_MAX)
+
+typedef enum {
+    TABLE_FLOAT64,
+    TABLE_INT64,
+    TABLE_STRING
+} ColumnType;
+
+/* Interned strings of one or more string columns. Reference counted
+ * atomically; append-only, so codes stay valid while it is shared. */
+typedef struct StringDict {
+    size_t refcount;
+    char **strings;
+    size_t *lengths;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *slots;            /* open addressing: code + 1, 0 = empty */
+    size_t slot_mask;
+} StringDict;
+
+typedef struct {
+    char *name;
+    ColumnType type;
+    union {
+        double *f64;
+        int64_t *i64;
+        uint32_t *codes;
+    } as;
+    StringDict *dict;           /* TABLE_STRING only */
+} Column;
+
+typedef struct Table {
+    size_t rows;
+    size_t column_count;
+    Column *columns;
+} Table;
+
+/* Row numbers, ascending unless produced by a sort */
+typedef struct {
+    uint32_t *rows;
+    size_t count;
+} Selection;
+
+typedef enum {
+    TABLE_EQ,
+    TABLE_NE,
+    TABLE_LT,
+    TABLE_LE,
+    TABLE_GT,
+    TABLE_GE
+} TableOp;
+
+/* Right-hand side of a predicate: a number for numeric columns, a string
+ * for string columns */
+typedef struct {
+    bool is_string;
+    double number;
+    const char *string;
+} TableScalar;
+
+typedef enum {
+    TABLE_SUM,
+    TABLE_MEAN,
+    TABLE_MIN,
+    TABLE_MAX,
+    TABLE_COUNT
+} TableAgg;
+
+typedef struct {
+    TableAgg agg;
+    size_t column;              /* ignored for TABLE_COUNT */
+} TableAggSpec;
+
+/* ========== STRING DICTIONARIES ========== */
+
+StringDict *string_dict_new(void);
+StringDict *string_dict_retain(StringDict *dict);
+void string_dict_release(StringDict *dict);
+
+/* Code for the string, adding it if new; UINT32_MAX if out of memory */
+uint32_t string_dict_intern(StringDict *dict, const char *s, size_t length);
+
+/* Code for the string, or UINT32_MAX if absent */
+uint32_t string_dict_find(const StringDict *dict, const char *s, size_t length);
+
+/* ========== TABLES ========== */
+
+/* An empty table of `rows` rows (add columns next) */
+Table *table_new(size_t rows);
+void table_free(Table *table);
+
+/* Append a zero-filled column (empty strings for TABLE_STRING, which get a
+ * fresh dictionary unless one is given to share); NULL if out of memory.
+ * The columns array may move, so Column pointers taken before the call
+ * are invalid after it; re-fetch them through table->columns. */
+Column *table_add_column(Table *table, const char *name, ColumnType type, StringDict *dict);
+
+/* Column index by name, or -1 */
+int table_column_index(const Table *table, const char *name);
+
+/* Cell accessors; a string cell is borrowed from the dictionary */
+double table_get_number(const Table *table, size_t column, size_t row);
+const char *table_get_string(const Table *table, size_t column, size_t row);
+
+/* ========== OPERATORS ========== */
+
+/* Rows of `input` (all rows if NULL) where column op value holds. out->rows
+ * is malloc'd; free with selection_free */
+bool table_filter(const Table *table, size_t column, TableOp op, TableScalar value,
+                  const Selection *input, Selection *out);
+
+void selection_free(Selection *selection);
+
+/* New table holding the selected rows, in selection order */
+Table *table_take(const Table *table, const Selection *selection);
+
+/* Aggregate of a numeric column over `selection` (all rows if NULL). NaN
+ * when there is nothing to aggregate; count counts rows of any column */
+double table_aggregate(const Table *table, size_t column, TableAgg agg, const Selection *selection);
+
+/* One row per distinct key: the key column, then one column per spec named
+ * "<agg>_<column>" ("count" for TABLE_COUNT) */
+Table *table_group_by(const Table *table, size_t key, const TableAggSpec *specs, size_t spec_count);
+
+/* Stable sort by one column; NaN sorts last either way */
+Table *table_sort(const Table *table, size_t column, bool descending);
+
+/* Inner join on left.left_key == right.right_key: every left column, then
+ * the right columns except its key (suffixed "_right" on a name clash).
+ * Numeric keys match by value; string keys by content */
+Table *table_join(const Table *left, size_t left_key, const Table *right, size_t right_key);
+
+/* ========== INPUT / OUTPUT ========== */
+
+/* Load a delimited file whose first line names the columns. A column is
+ * int64 if every cell is an integer, float64 if every cell is a number or
+ * empty, and strings otherwise. Fields may be quoted with "" escapes */
+Table *table_read_csv(const char *path, char delimiter);
+
+/* Load newline-delimited JSON: one flat object per line. Columns are the
+ * keys in order of first appearance; true / false load as 1 / 0, and null
+ * or a missing key as NaN (numbers) or "" (strings) */
+Table *table_read_ndjson(const char *path);
+
+bool table_write_csv(const Table *table, const char *path, char delimiter);
+
+/* ========== THREADING ========== */
+
+/* Pool for the chunk jobs; NULL (the default) uses thread_pool_shared() */
+void table_set_pool(ThreadPool *pool);
+
+#endif /* RUBOLT_TABLE_H */
@@ -1,8 +1,16 @@
+#ifndef _WIN32
+#define _DEFAULT_SOURCE     /* strdup/usleep under -std=c99 */
+#endif
+
 #include "threading.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+#ifndef _WIN32
+#define _strdup strdup
+#endif
+
 GIL *global_gil = NULL;
 ThreadPool *global_thread_pool = NULL;
 
@@ -12,6 +20,7 @@ static DWORD WINAPI thread_start_routine(LPVOID arg) {
 }
 #else
 #include <unistd.h>
+#include <time.h>
 static void *thread_start_routine(void *arg) {
     Thread *t = (Thread *)arg; t->state = THREAD_STATE_RUNNING; void *res = NULL; if (t->func) res = t->func(t->args); t->result = res; t->state = THREAD_STATE_FINISHED; return NULL;
 }
@@ -156,6 +165,229 @@ void thread_yield(void) {
 #endif
 }
 
+/* ========== THREAD POOL ========== */
+
+static void pool_lock(ThreadPool *pool) {
+#ifdef _WIN32
+    EnterCriticalSection(&pool->queue_mutex);
+#else
+    pthread_mutex_lock(&pool->queue_mutex);
+#endif
+}
+
+static void pool_unlock(ThreadPool *pool) {
+#ifdef _WIN32
+    LeaveCriticalSection(&pool->queue_mutex);
+#else
+    pthread_mutex_unlock(&pool->queue_mutex);
+#endif
+}
+
+static void *thread_pool_worker(void *arg) {
+    ThreadPool *pool = (ThreadPool *)arg;
+    for (;;) {
+        pool_lock(pool);
+        while (!pool->work_queue && !pool->shutdown) {
+#ifdef _WIN32
+            SleepConditionVariableCS(&pool->work_available, &pool->queue_mutex, INFINITE);
+#else
+            pthread_cond_wait(&pool->work_available, &pool->queue_mutex);
+#endif
+        }
+        if (!pool->work_queue && pool->shutdown) { pool_unlock(pool); break; }
+        struct WorkItem *item = pool->work_queue; pool->work_queue = item->next;
+        pool_unlock(pool);
+
+        void *result = item->func(item->args);
+        if (item->on_complete) item->on_complete(result, item->context);
+        free(item);
+
+        pool_lock(pool);
+        pool->pending_work--; pool->completed_work++;
+        if (pool->pending_work == 0) {
+#ifdef _WIN32
+            WakeAllConditionVariable(&pool->work_complete);
+#else
+            pthread_cond_broadcast(&pool->work_complete);
+#endif
+        }
+        pool_unlock(pool);
+    }
+    return NULL;
+}
+
+ThreadPool *thread_pool_create(size_t num_threads) {
+    if (num_threads == 0) num_threads = (size_t)thread_cpu_count();
+    ThreadPool *pool = (ThreadPool *)calloc(1, sizeof(ThreadPool)); if (!pool) return NULL;
+    pool->threads = (Thread **)calloc(num_threads, sizeof(Thread *)); pool->max_threads = num_threads;
+#ifdef _WIN32
+    InitializeCriticalSection(&pool->queue_mutex); InitializeConditionVariable(&pool->work_available); InitializeConditionVariable(&pool->work_complete);
+#else
+    pthread_mutex_init(&pool->queue_mutex, NULL); pthread_cond_init(&pool->work_available, NULL); pthread_cond_init(&pool->work_complete, NULL);
+#endif
+    for (size_t i = 0; i < num_threads; i++) {
+        Thread *t = thread_create(thread_pool_worker, pool, NULL);
+        if (!t || !thread_start(t)) { free(t); break; }
+        pool->threads[pool->thread_count++] = t;
+    }
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+    pool_lock(pool); pool->shutdown = true;
+#ifdef _WIN32
+    WakeAllConditionVariable(&pool->work_available);
+#else
+    pthread_cond_broadcast(&pool->work_available);
+#endif
+    pool_unlock(pool);
+    for (size_t i = 0; i < pool->thread_count; i++) { thread_join(pool->threads[i]); free(pool->threads[i]); }
+#ifdef _WIN32
+    DeleteCriticalSection(&pool->queue_mutex);
+#else
+    pthread_mutex_destroy(&pool->queue_mutex); pthread_cond_destroy(&pool->work_available); pthread_cond_destroy(&pool->work_complete);
+#endif
+    free(pool->threads); free(pool);
+}
+
+bool thread_pool_submit(ThreadPool *pool, void *(*func)(void *), void *args) {
+    return thread_pool_submit_callback(pool, func, args, NULL, NULL);
+}
+
+bool thread_pool_submit_callback(ThreadPool *pool, void *(*func)(void *), void *args,
+                                 void (*on_complete)(void *, void *), void *context) {
+    if (!pool || !func) return false;
+    struct WorkItem *item = (struct WorkItem *)calloc(1, sizeof(struct WorkItem)); if (!item) return false;
+    item->func = func; item->args = args; item->on_complete = on_complete; item->context = context;
+    pool_lock(pool);
+    if (pool->shutdown) { pool_unlock(pool); free(item); return false; }
+    /* FIFO: append at the tail so work starts in submission order */
+    struct WorkItem **tail = &pool->work_queue; while (*tail) tail = &(*tail)->next; *tail = item;
+    pool->pending_work++;
+#ifdef _WIN32
+    WakeConditionVariable(&pool->work_available);
+#else
+    pthread_cond_signal(&pool->work_available);
+#endif
+    pool_unlock(pool);
+    return true;
+}
+
+void thread_pool_wait(ThreadPool *pool) {
+    if (!pool) return;
+    pool_lock(pool);
+    while (pool->pending_work > 0) {
+#ifdef _WIN32
+        SleepConditionVariableCS(&pool->work_complete, &pool->queue_mutex, INFINITE);
+#else
+        pthread_cond_wait(&pool->work_complete, &pool->queue_mutex);
+#endif
+    }
+    pool_unlock(pool);
+}
+
+void thread_pool_get_stats(ThreadPool *pool, ThreadPoolStats *stats) {
+    if (!pool || !stats) return;
+    pool_lock(pool);
+    stats->thread_count = pool->thread_count; stats->pending_work = pool->pending_work;
+    stats->completed_work = pool->completed_work; stats->total_submitted = pool->pending_work + pool->completed_work;
+    pool_unlock(pool);
+}
+
+static ThreadPool *shared_pool;
+
+ThreadPool *thread_pool_shared(void) {
+    if (global_thread_pool) return global_thread_pool;
+    ThreadPool *pool = __atomic_load_n(&shared_pool, __ATOMIC_ACQUIRE);
+    if (pool) return pool;
+    ThreadPool *created = thread_pool_create(0);
+    if (!created) return NULL;
+    ThreadPool *expected = NULL;
+    if (!__atomic_compare_exchange_n(&shared_pool, &expected, created, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        thread_pool_destroy(created);
+        return expected;
+    }
+    return created;
+}
+
+/* Shared by the caller and the workers it submitted; the last of them to
+ * let go frees it, so a worker that starts after the loop is over only
+ * drops its reference and never waits on or touches the caller */
+typedef struct {
+    void (*fn)(void *ctx, size_t chunk);
+    void *ctx;
+    size_t chunks;
+    size_t next;                /* next chunk to claim */
+    size_t completed;           /* chunks run to the end */
+    size_t refs;
+    Mutex *lock;
+    CondVar *done;
+} ParallelFor;
+
+static void parallel_release(ParallelFor *pf) {
+    if (__atomic_sub_fetch(&pf->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    if (pf->lock) mutex_destroy(pf->lock);
+    if (pf->done) condvar_destroy(pf->done);
+    free(pf);
+}
+
+static void run_chunks(ParallelFor *pf) {
+    size_t chunk, ran = 0;
+    while ((chunk = __atomic_fetch_add(&pf->next, 1, __ATOMIC_RELAXED)) < pf->chunks) {
+        pf->fn(pf->ctx, chunk);
+        ran++;
+    }
+    if (ran && __atomic_add_fetch(&pf->completed, ran, __ATOMIC_ACQ_REL) == pf->chunks && pf->lock) {
+        mutex_lock(pf->lock);
+        condvar_broadcast(pf->done);
+        mutex_unlock(pf->lock);
+    }
+}
+
+static void *parallel_worker(void *p) {
+    ParallelFor *pf = (ParallelFor *)p;
+    run_chunks(pf);
+    parallel_release(pf);
+    return NULL;
+}
+
+void thread_pool_parallel_for(ThreadPool *pool, size_t chunks, void (*fn)(void *ctx, size_t chunk), void *ctx) {
+    size_t workers = chunks > 1 && pool && pool->thread_count > 1 ? pool->thread_count : 0;
+    if (workers > chunks - 1) workers = chunks - 1;
+    ParallelFor *pf = workers ? (ParallelFor *)calloc(1, sizeof(ParallelFor)) : NULL;
+    if (pf) {
+        pf->lock = mutex_create();
+        pf->done = condvar_create();
+    }
+    if (!pf || !pf->lock || !pf->done) {
+        if (pf) {
+            pf->refs = 1;
+            parallel_release(pf);
+        }
+        for (size_t i = 0; i < chunks; i++) fn(ctx, i);
+        return;
+    }
+    pf->fn = fn;
+    pf->ctx = ctx;
+    pf->chunks = chunks;
+    pf->refs = 1;
+    for (size_t i = 0; i < workers; i++) {
+        __atomic_add_fetch(&pf->refs, 1, __ATOMIC_RELAXED);
+        if (!thread_pool_submit(pool, parallel_worker, pf)) {
+            __atomic_sub_fetch(&pf->refs, 1, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+    run_chunks(pf);
+    /* Wait only for chunks other threads claimed, not for workers that
+     * have yet to start */
+    mutex_lock(pf->lock);
+    while (__atomic_load_n(&pf->completed, __ATOMIC_ACQUIRE) < chunks) condvar_wait(pf->done, pf->lock);
+    mutex_unlock(pf->lock);
+    parallel_release(pf);
+}
+
 Mutex *mutex_create(void) { Mutex *m = (Mutex *)calloc(1, sizeof(Mutex)); if (!m) return NULL; 
 #ifdef _WIN32
     InitializeCriticalSection(&m->native_mutex);
@@ -215,7 +447,8 @@ bool condvar_wait_timeout(CondVar *cv, Mutex *mtx, uint64_t timeout_ms) {
 #ifdef _WIN32
     return SleepConditionVariableCS(&cv->native_cond, &mtx->native_mutex, (DWORD)timeout_ms) != 0;
 #else
-    struct timespec ts; ts.tv_sec = timeout_ms / 1000; ts.tv_nsec = (timeout_ms % 1000) * 1000000; return pthread_cond_timedwait(&cv->native_cond, &mtx->native_mutex, &ts) == 0;
+    /* pthread_cond_timedwait takes an absolute CLOCK_REALTIME deadline */
+    struct timespec ts; clock_gettime(CLOCK_REALTIME, &ts); ts.tv_sec += (time_t)(timeout_ms / 1000); ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000; if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; } return pthread_cond_timedwait(&cv->native_cond, &mtx->native_mutex, &ts) == 0;
 #endif
 }
 void condvar_signal(CondVar *cv) { 
@@ -159,6 +159,18 @@ typedef struct ThreadPoolStats {
 
 void thread_pool_get_stats(ThreadPool *pool, ThreadPoolStats *stats);
 
+/* global_thread_pool if set, else a pool of one thread per CPU created
+ * on first use and kept for the life of the process */
+ThreadPool *thread_pool_shared(void);
+
+/* Run fn(ctx, chunk) for every chunk in [0, chunks), claimed from a shared
+ * counter by the pool's workers and by the calling thread, which always
+ * takes part. Returns when every chunk is done, waiting only on workers
+ * that claimed one: workers still queued behind other jobs, or never
+ * started because the caller is itself a pool worker, do not hold it up.
+ * pool may be NULL (the caller runs every chunk). */
+void thread_pool_parallel_for(ThreadPool *pool, size_t chunks, void (*fn)(void *ctx, size_t chunk), void *ctx);
+
 /* ========== SYNCHRONIZATION PRIMITIVES ========== */
 
 /* Mutex */
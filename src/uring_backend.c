@@ -0,0 +1,275 @@
+#ifndef _WIN32
+#define _DEFAULT_SOURCE     /* syscall(), MAP_POPULATE under -std=c99 */
+#endif
+
+#include "uring_backend.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef RUBOLT_HAVE_IO_URING
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+
+struct UringQueue {
+    int ring_fd;
+
+    /* Submission queue */
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    unsigned sqe_tail;          /* prepared but not yet published to the kernel */
+    struct io_uring_sqe *sqes;
+
+    /* Completion queue */
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /* Mappings */
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
+
+/* ========== LIFECYCLE ========== */
+
+UringQueue *uring_create(unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0) return NULL;
+
+    /* OPENAT/STATX/READ/WRITE all landed in 5.6; FAST_POLL (5.7) is the
+     * cheapest feature bit that guarantees them. */
+    if (!(p.features & IORING_FEAT_FAST_POLL)) {
+        close(fd);
+        return NULL;
+    }
+
+    UringQueue *q = (UringQueue *)calloc(1, sizeof(UringQueue));
+    if (!q) { close(fd); return NULL; }
+    q->ring_fd = fd;
+
+    q->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    q->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        if (q->cq_ring_size > q->sq_ring_size) q->sq_ring_size = q->cq_ring_size;
+        q->cq_ring_size = q->sq_ring_size;
+    }
+
+    q->sq_ring = mmap(NULL, q->sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (q->sq_ring == MAP_FAILED) goto fail;
+
+    if (single_mmap) {
+        q->cq_ring = q->sq_ring;
+    } else {
+        q->cq_ring = mmap(NULL, q->cq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (q->cq_ring == MAP_FAILED) { q->cq_ring = NULL; goto fail; }
+    }
+
+    q->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    q->sqes = (struct io_uring_sqe *)mmap(NULL, q->sqes_size, PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (q->sqes == MAP_FAILED) { q->sqes = NULL; goto fail; }
+
+    char *sq = (char *)q->sq_ring;
+    q->sq_head = (unsigned *)(sq + p.sq_off.head);
+    q->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    q->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    q->sq_array = (unsigned *)(sq + p.sq_off.array);
+    q->sq_entries = p.sq_entries;
+    q->sqe_tail = *q->sq_tail;
+
+    char *cq = (char *)q->cq_ring;
+    q->cq_head = (unsigned *)(cq + p.cq_off.head);
+    q->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    q->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    q->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return q;
+
+fail:
+    if (q->sq_ring && q->sq_ring != MAP_FAILED) munmap(q->sq_ring, q->sq_ring_size);
+    if (q->cq_ring && q->cq_ring != q->sq_ring) munmap(q->cq_ring, q->cq_ring_size);
+    close(fd);
+    free(q);
+    return NULL;
+}
+
+void uring_free(UringQueue *q) {
+    if (!q) return;
+    munmap(q->sqes, q->sqes_size);
+    if (q->cq_ring != q->sq_ring) munmap(q->cq_ring, q->cq_ring_size);
+    munmap(q->sq_ring, q->sq_ring_size);
+    close(q->ring_fd);
+    free(q);
+}
+
+int uring_fd(UringQueue *q) { return q ? q->ring_fd : -1; }
+
+bool uring_register_buffers(UringQueue *q, void *arena, size_t buf_size, unsigned count) {
+    struct iovec *iov = (struct iovec *)calloc(count, sizeof(struct iovec));
+    if (!iov) return false;
+    for (unsigned i = 0; i < count; i++) {
+        iov[i].iov_base = (char *)arena + (size_t)i * buf_size;
+        iov[i].iov_len = buf_size;
+    }
+    /* Can fail under a low RLIMIT_MEMLOCK; callers fall back to plain reads */
+    int r = (int)syscall(__NR_io_uring_register, q->ring_fd, IORING_REGISTER_BUFFERS, iov, count);
+    free(iov);
+    return r == 0;
+}
+
+/* ========== SUBMISSION ========== */
+
+static struct io_uring_sqe *get_sqe(UringQueue *q) {
+    unsigned head = __atomic_load_n(q->sq_head, __ATOMIC_ACQUIRE);
+    if (q->sqe_tail - head >= q->sq_entries) return NULL;
+
+    unsigned idx = q->sqe_tail & *q->sq_mask;
+    struct io_uring_sqe *sqe = &q->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    q->sq_array[idx] = idx;
+    q->sqe_tail++;
+    return sqe;
+}
+
+static bool prep_rw(UringQueue *q, bool is_write, int fd, const void *buf, unsigned len,
+                    int64_t offset, int buf_index, uint64_t user_data) {
+    struct io_uring_sqe *sqe = get_sqe(q);
+    if (!sqe) return false;
+    if (buf_index >= 0) {
+        sqe->opcode = is_write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->buf_index = (uint16_t)buf_index;
+    } else {
+        sqe->opcode = is_write ? IORING_OP_WRITE : IORING_OP_READ;
+    }
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = offset < 0 ? (uint64_t)-1 : (uint64_t)offset;   /* -1: current position */
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool uring_prep_read(UringQueue *q, int fd, void *buf, unsigned len, int64_t offset,
+                     int buf_index, uint64_t user_data) {
+    return prep_rw(q, false, fd, buf, len, offset, buf_index, user_data);
+}
+
+bool uring_prep_write(UringQueue *q, int fd, const void *buf, unsigned len, int64_t offset,
+                      int buf_index, uint64_t user_data) {
+    return prep_rw(q, true, fd, buf, len, offset, buf_index, user_data);
+}
+
+bool uring_prep_openat(UringQueue *q, const char *path, int flags, int mode, uint64_t user_data) {
+    struct io_uring_sqe *sqe = get_sqe(q);
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)path;
+    sqe->len = (uint32_t)mode;
+    sqe->open_flags = (uint32_t)flags;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool uring_prep_statx(UringQueue *q, const char *path, void *statx_buf, uint64_t user_data) {
+    struct io_uring_sqe *sqe = get_sqe(q);
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)path;
+    sqe->len = STATX_BASIC_STATS;
+    sqe->off = (uint64_t)(uintptr_t)statx_buf;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool uring_prep_fsync(UringQueue *q, int fd, uint64_t user_data) {
+    struct io_uring_sqe *sqe = get_sqe(q);
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = fd;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool uring_prep_cancel(UringQueue *q, uint64_t target_user_data, uint64_t user_data) {
+    struct io_uring_sqe *sqe = get_sqe(q);
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target_user_data;
+    sqe->user_data = user_data;
+    return true;
+}
+
+/* Counted from the kernel's head, so SQEs an earlier short submit left
+ * behind (published but not consumed) are still pending */
+unsigned uring_pending(UringQueue *q) { return q->sqe_tail - __atomic_load_n(q->sq_head, __ATOMIC_ACQUIRE); }
+
+int uring_submit(UringQueue *q, unsigned wait_nr) {
+    if (*q->sq_tail != q->sqe_tail) __atomic_store_n(q->sq_tail, q->sqe_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = uring_pending(q);
+    if (!to_submit && !wait_nr) return 0;
+
+    unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+    int r = (int)syscall(__NR_io_uring_enter, q->ring_fd, to_submit, wait_nr, flags, NULL, 0);
+    return r < 0 ? -errno : r;
+}
+
+/* ========== COMPLETION ========== */
+
+bool uring_next_completion(UringQueue *q, uint64_t *user_data, int32_t *res) {
+    unsigned head = *q->cq_head;
+    unsigned tail = __atomic_load_n(q->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail) return false;
+
+    struct io_uring_cqe *cqe = &q->cqes[head & *q->cq_mask];
+    *user_data = cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n(q->cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void uring_statx_decode(const void *statx_buf, uint64_t *size, uint32_t *mode, int64_t *mtime) {
+    const struct statx *stx = (const struct statx *)statx_buf;
+    *size = stx->stx_size;
+    *mode = stx->stx_mode;
+    *mtime = stx->stx_mtime.tv_sec;
+}
+
+#else /* !RUBOLT_HAVE_IO_URING */
+
+UringQueue *uring_create(unsigned entries) { (void)entries; return NULL; }
+void uring_free(UringQueue *q) { (void)q; }
+int uring_fd(UringQueue *q) { (void)q; return -1; }
+bool uring_register_buffers(UringQueue *q, void *arena, size_t buf_size, unsigned count) { (void)q; (void)arena; (void)buf_size; (void)count; return false; }
+bool uring_prep_read(UringQueue *q, int fd, void *buf, unsigned len, int64_t offset, int buf_index, uint64_t user_data) { (void)q; (void)fd; (void)buf; (void)len; (void)offset; (void)buf_index; (void)user_data; return false; }
+bool uring_prep_write(UringQueue *q, int fd, const void *buf, unsigned len, int64_t offset, int buf_index, uint64_t user_data) { (void)q; (void)fd; (void)buf; (void)len; (void)offset; (void)buf_index; (void)user_data; return false; }
+bool uring_prep_openat(UringQueue *q, const char *path, int flags, int mode, uint64_t user_data) { (void)q; (void)path; (void)flags; (void)mode; (void)user_data; return false; }
+bool uring_prep_statx(UringQueue *q, const char *path, void *statx_buf, uint64_t user_data) { (void)q; (void)path; (void)statx_buf; (void)user_data; return false; }
+bool uring_prep_fsync(UringQueue *q, int fd, uint64_t user_data) { (void)q; (void)fd; (void)user_data; return false; }
+bool uring_prep_cancel(UringQueue *q, uint64_t target_user_data, uint64_t user_data) { (void)q; (void)target_user_data; (void)user_data; return false; }
+unsigned uring_pending(UringQueue *q) { (void)q; return 0; }
+int uring_submit(UringQueue *q, unsigned wait_nr) { (void)q; (void)wait_nr; return -1; }
+bool uring_next_completion(UringQueue *q, uint64_t *user_data, int32_t *res) { (void)q; (void)user_data; (void)res; return false; }
+void uring_statx_decode(const void *statx_buf, uint64_t *size, uint32_t *mode, int64_t *mtime) { (void)statx_buf; *size = 0; *mode = 0; *mtime = 0; }
+
+#endif /* RUBOLT_HAVE_IO_URING */
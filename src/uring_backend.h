@@ -0,0 +1,65 @@
+#ifndef RUBOLT_URING_BACKEND_H
+#define RUBOLT_URING_BACKEND_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Minimal io_uring driver used by the event loop (raw syscalls, no liburing).
+ * Define RUBOLT_NO_IO_URING to compile it out; uring_create() then always
+ * fails and the event loop uses its thread-pool fallback. */
+#if defined(__linux__) && !defined(RUBOLT_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define RUBOLT_HAVE_IO_URING 1
+#endif
+#endif
+
+/* Size of the opaque statx buffer an async stat writes into */
+#define URING_STATX_SIZE 256
+
+typedef struct UringQueue UringQueue;
+
+/* ========== LIFECYCLE ========== */
+
+/* Create a ring; returns NULL if io_uring is unavailable or too old */
+UringQueue *uring_create(unsigned entries);
+
+/* Destroy a ring */
+void uring_free(UringQueue *q);
+
+/* Pollable ring fd (readable when completions are pending) */
+int uring_fd(UringQueue *q);
+
+/* Register `count` buffers of `buf_size` bytes carved from `arena` */
+bool uring_register_buffers(UringQueue *q, void *arena, size_t buf_size, unsigned count);
+
+/* ========== SUBMISSION ========== */
+/* prep functions only queue an SQE; they return false when the SQ is full.
+ * Nothing reaches the kernel until uring_submit(). */
+
+bool uring_prep_read(UringQueue *q, int fd, void *buf, unsigned len, int64_t offset,
+                     int buf_index, uint64_t user_data);
+bool uring_prep_write(UringQueue *q, int fd, const void *buf, unsigned len, int64_t offset,
+                      int buf_index, uint64_t user_data);
+bool uring_prep_openat(UringQueue *q, const char *path, int flags, int mode, uint64_t user_data);
+bool uring_prep_statx(UringQueue *q, const char *path, void *statx_buf, uint64_t user_data);
+bool uring_prep_fsync(UringQueue *q, int fd, uint64_t user_data);
+bool uring_prep_cancel(UringQueue *q, uint64_t target_user_data, uint64_t user_data);
+
+/* Number of queued SQEs the kernel has not consumed yet */
+unsigned uring_pending(UringQueue *q);
+
+/* Submit all queued SQEs in one io_uring_enter(), optionally waiting for
+ * `wait_nr` completions. Returns submitted count or -errno; SQEs the kernel
+ * did not take stay queued for the next call. */
+int uring_submit(UringQueue *q, unsigned wait_nr);
+
+/* ========== COMPLETION ========== */
+
+/* Pop one completion; false if the CQ is empty */
+bool uring_next_completion(UringQueue *q, uint64_t *user_data, int32_t *res);
+
+/* Decode a statx buffer filled by an async stat */
+void uring_statx_decode(const void *statx_buf, uint64_t *size, uint32_t *mode, int64_t *mtime);
+
+#endif /* RUBOLT_URING_BACKEND_H */
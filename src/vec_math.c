@@ -0,0 +1,496 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "vec_math.h"
+#include "threading.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define VEC_X86 1
+#include <immintrin.h>
+#define VEC_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+#define TRIG_MAX 1048576.0              /* 2^20: larger |x| goes to libm */
+#define MATMUL_ROWS 64                  /* rows per parallel chunk */
+#define MATMUL_COL_BLOCK 256            /* columns of b kept hot in cache */
+#define MATMUL_K_BLOCK 128
+#define MATMUL_PARALLEL_MIN ((size_t)1 << 21) /* multiply-adds */
+
+/* ========== SCALAR KERNELS ========== */
+
+/* One loop per operation, so each is a plain loop the compiler can
+ * vectorize where the libm call allows */
+static void map_scalar(VecOp op, const double *in, double *out, size_t n) {
+    switch (op) {
+        case VEC_SQRT: for (size_t i = 0; i < n; i++) out[i] = sqrt(in[i]); break;
+        case VEC_ABS: for (size_t i = 0; i < n; i++) out[i] = fabs(in[i]); break;
+        case VEC_FLOOR: for (size_t i = 0; i < n; i++) out[i] = floor(in[i]); break;
+        case VEC_CEIL: for (size_t i = 0; i < n; i++) out[i] = ceil(in[i]); break;
+        case VEC_EXP: for (size_t i = 0; i < n; i++) out[i] = exp(in[i]); break;
+        case VEC_LOG: for (size_t i = 0; i < n; i++) out[i] = log(in[i]); break;
+        case VEC_SIN: for (size_t i = 0; i < n; i++) out[i] = sin(in[i]); break;
+        case VEC_COS: for (size_t i = 0; i < n; i++) out[i] = cos(in[i]); break;
+    }
+}
+
+static double sum_scalar(const double *a, size_t n) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i];
+        s1 += a[i + 1];
+        s2 += a[i + 2];
+        s3 += a[i + 3];
+    }
+    for (; i < n; i++) s0 += a[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+static double dot_scalar(const double *a, const double *b, size_t n) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+/* Rows [row_begin, row_end) of c, in i-k-j order so the inner loop runs
+ * along rows of b and c */
+static void matmul_scalar(const double *a, const double *b, double *c, size_t row_begin, size_t row_end,
+                          size_t inner, size_t cols) {
+    for (size_t i = row_begin; i < row_end; i++) {
+        double *crow = c + i * cols;
+        for (size_t j = 0; j < cols; j++) crow[j] = 0;
+        for (size_t k = 0; k < inner; k++) {
+            double aik = a[i * inner + k];
+            const double *brow = b + k * cols;
+            for (size_t j = 0; j < cols; j++) crow[j] += aik * brow[j];
+        }
+    }
+}
+
+/* ========== AVX2 KERNELS ========== */
+
+#ifdef VEC_X86
+/* Integral doubles in [0, 2^51) as 64-bit integers and back, by way of
+ * the mantissa of 2^52 + 2^51 (AVX2 has no 64-bit conversions) */
+#define MAGIC_INT 6755399441055744.0
+
+VEC_TARGET_AVX2 static inline __m256i int_of(__m256d x) {
+    return _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(x, _mm256_set1_pd(MAGIC_INT))),
+                            _mm256_castpd_si256(_mm256_set1_pd(MAGIC_INT)));
+}
+
+/* 2^n for integral n in [-1022, 1023] */
+VEC_TARGET_AVX2 static inline __m256d pow2(__m256d n) {
+    return _mm256_castsi256_pd(_mm256_slli_epi64(int_of(_mm256_add_pd(n, _mm256_set1_pd(1023.0))), 52));
+}
+
+/* exp: x = n ln2 + r with |r| <= ln2/2, e^r by its Taylor series to r^13
+ * (truncation below 2^-60), then scaled by 2^n in two halves so that
+ * results near overflow and in the subnormal range come out right */
+VEC_TARGET_AVX2 static inline __m256d exp4(__m256d x) {
+    /* max/min return their second operand for NaN, so NaN passes */
+    x = _mm256_min_pd(_mm256_set1_pd(710.0), _mm256_max_pd(_mm256_set1_pd(-746.0), x));
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    /* ln2 split so that n * hi is exact */
+    __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(6.93147180369123816490e-01), x);
+    r = _mm256_fnmadd_pd(n, _mm256_set1_pd(1.90821492927058770002e-10), r);
+    static const double coeff[] = { 1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0,
+                                    1.0 / 362880.0,     1.0 / 40320.0,     1.0 / 5040.0,      1.0 / 720.0,
+                                    1.0 / 120.0,        1.0 / 24.0,        1.0 / 6.0,         0.5,
+                                    1.0,                1.0 };
+    __m256d p = _mm256_set1_pd(coeff[0]);
+    for (int i = 1; i < 14; i++) p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(coeff[i]));
+    __m256d n1 = _mm256_floor_pd(_mm256_mul_pd(n, _mm256_set1_pd(0.5)));
+    __m256d n2 = _mm256_sub_pd(n, n1);
+    return _mm256_mul_pd(_mm256_mul_pd(p, pow2(n1)), pow2(n2));
+}
+
+/* log: x = 2^e m with m in [sqrt(1/2), sqrt(2)), then log(1 + f) for
+ * f = m - 1 the way fdlibm does it: s = f / (2 + f) and a minimax
+ * polynomial in s^2, with the f^2 / 2 term kept apart to hold precision */
+VEC_TARGET_AVX2 static inline __m256d log4(__m256d x) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    /* Subnormals: scale into the normal range first */
+    __m256d tiny = _mm256_cmp_pd(x, _mm256_set1_pd(0x1p-1022), _CMP_LT_OQ);
+    __m256d xs = _mm256_blendv_pd(x, _mm256_mul_pd(x, _mm256_set1_pd(0x1p52)), tiny);
+    __m256d e = _mm256_and_pd(tiny, _mm256_set1_pd(-52.0));
+    __m256i bits = _mm256_castpd_si256(xs);
+    /* Exponent field into the mantissa of 2^52, then subtract */
+    __m256i field = _mm256_srli_epi64(bits, 52);
+    e = _mm256_add_pd(e, _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(field, _mm256_castpd_si256(
+                                           _mm256_set1_pd(0x1p52)))),
+                                       _mm256_set1_pd(0x1p52 + 1023.0)));
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffffLL)), _mm256_castpd_si256(one)));
+    __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+    e = _mm256_add_pd(e, _mm256_and_pd(big, one));
+
+    __m256d f = _mm256_sub_pd(m, one);
+    __m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+    __m256d z = _mm256_mul_pd(s, s);
+    static const double lg[] = { 1.479819860511658591e-01, 1.531383769920937332e-01, 1.818357216161805012e-01,
+                                 2.222219843214978396e-01, 2.857142874366239149e-01, 3.999999999940941908e-01,
+                                 6.666666666666735130e-01 };
+    __m256d R = _mm256_set1_pd(lg[0]);
+    for (int i = 1; i < 7; i++) R = _mm256_fmadd_pd(R, z, _mm256_set1_pd(lg[i]));
+    R = _mm256_mul_pd(R, z);
+    __m256d hfsq = _mm256_mul_pd(_mm256_set1_pd(0.5), _mm256_mul_pd(f, f));
+    /* e ln2_hi - ((hfsq - (s (hfsq + R) + e ln2_lo)) - f) */
+    __m256d t = _mm256_fmadd_pd(s, _mm256_add_pd(hfsq, R), _mm256_mul_pd(e, _mm256_set1_pd(1.90821492927058770002e-10)));
+    __m256d result = _mm256_fmadd_pd(e, _mm256_set1_pd(6.93147180369123816490e-01),
+                                     _mm256_sub_pd(f, _mm256_sub_pd(hfsq, t)));
+
+    /* log(x < 0) = NaN, log(0) = -inf, log(inf) = inf, NaN stays */
+    result = _mm256_blendv_pd(result, _mm256_set1_pd(NAN), _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_LT_OQ));
+    result = _mm256_blendv_pd(result, _mm256_set1_pd(-INFINITY), _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_EQ_OQ));
+    __m256d pass = _mm256_or_pd(_mm256_cmp_pd(x, x, _CMP_UNORD_Q), _mm256_cmp_pd(x, _mm256_set1_pd(INFINITY), _CMP_EQ_OQ));
+    return _mm256_blendv_pd(result, x, pass);
+}
+
+/* sin and cos: x = k pi/2 + r with |r| <= pi/4 (pi/2 in three parts; the
+ * first product is exact for |x| <= 2^20), then fdlibm's minimax kernels
+ * for sin and cos on r, picked and signed by k mod 4 */
+VEC_TARGET_AVX2 static inline __m256d sincos4(__m256d x, bool cosine) {
+    __m256d k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(0.63661977236758134308)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(1.5707963267948966), x);
+    r = _mm256_fnmadd_pd(k, _mm256_set1_pd(6.123233995736766e-17), r);
+    r = _mm256_fnmadd_pd(k, _mm256_set1_pd(-1.4973849048591698e-33), r);
+    __m256d z = _mm256_mul_pd(r, r);
+
+    static const double sc[] = { 1.58969099521155010221e-10, -2.50507602534068634195e-08, 2.75573137070700676789e-06,
+                                 -1.98412698298579493134e-04, 8.33333333332248946124e-03 };
+    __m256d ps = _mm256_set1_pd(sc[0]);
+    for (int i = 1; i < 5; i++) ps = _mm256_fmadd_pd(ps, z, _mm256_set1_pd(sc[i]));
+    /* r + r^3 (S1 + z R) */
+    __m256d sin_r = _mm256_fmadd_pd(_mm256_mul_pd(z, r),
+                                    _mm256_fmadd_pd(z, ps, _mm256_set1_pd(-1.66666666666666324348e-01)), r);
+
+    static const double cc[] = { -1.13596475577881948265e-11, 2.08757232129817482790e-09, -2.75573143513906633035e-07,
+                                 2.48015872894767294178e-05, -1.38888888888741095749e-03, 4.16666666666666019037e-02 };
+    __m256d pc = _mm256_set1_pd(cc[0]);
+    for (int i = 1; i < 6; i++) pc = _mm256_fmadd_pd(pc, z, _mm256_set1_pd(cc[i]));
+    /* w + (((1 - w) - z/2) + z^2 P), w = 1 - z/2 */
+    __m256d hz = _mm256_mul_pd(z, _mm256_set1_pd(0.5));
+    __m256d w = _mm256_sub_pd(_mm256_set1_pd(1.0), hz);
+    __m256d cos_r = _mm256_add_pd(w, _mm256_fmadd_pd(_mm256_mul_pd(z, z), pc,
+                                                     _mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), w), hz)));
+
+    /* k mod 4 (two's complement low bits work for negative k too) */
+    __m256i q = int_of(_mm256_add_pd(k, _mm256_set1_pd(cosine ? 1.0 : 0.0)));
+    __m256i odd = _mm256_cmpeq_epi64(_mm256_and_si256(q, _mm256_set1_epi64x(1)), _mm256_set1_epi64x(1));
+    __m256i neg = _mm256_slli_epi64(_mm256_and_si256(q, _mm256_set1_epi64x(2)), 62);
+    __m256d result = _mm256_xor_pd(_mm256_blendv_pd(sin_r, cos_r, _mm256_castsi256_pd(odd)), _mm256_castsi256_pd(neg));
+    /* The kernels turn sin(-0) into +0; sin(+-0) is x itself */
+    if (!cosine) result = _mm256_blendv_pd(result, x, _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_EQ_OQ));
+
+    /* Arguments too large for the inline reduction go to libm */
+    __m256d ax = _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+    __m256d large = _mm256_and_pd(_mm256_cmp_pd(ax, _mm256_set1_pd(TRIG_MAX), _CMP_GT_OQ),
+                                  _mm256_cmp_pd(ax, _mm256_set1_pd(INFINITY), _CMP_LT_OQ));
+    if (__builtin_expect(_mm256_movemask_pd(large) != 0, 0)) {
+        double in[4], out[4];
+        _mm256_storeu_pd(in, x);
+        _mm256_storeu_pd(out, result);
+        int lanes = _mm256_movemask_pd(large);
+        for (int i = 0; i < 4; i++) {
+            if (lanes >> i & 1) out[i] = cosine ? cos(in[i]) : sin(in[i]);
+        }
+        result = _mm256_loadu_pd(out);
+    }
+    return result;
+}
+
+VEC_TARGET_AVX2 static inline __m256d apply4(VecOp op, __m256d x) {
+    switch (op) {
+        case VEC_SQRT: return _mm256_sqrt_pd(x);
+        case VEC_ABS: return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+        case VEC_FLOOR: return _mm256_floor_pd(x);
+        case VEC_CEIL: return _mm256_ceil_pd(x);
+        case VEC_EXP: return exp4(x);
+        case VEC_LOG: return log4(x);
+        case VEC_SIN: return sincos4(x, false);
+        case VEC_COS: return sincos4(x, true);
+    }
+    return x;
+}
+
+/* The switch in apply4 is resolved at compile time in each instance */
+#define MAP_LOOP(OP)                                                                   \
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, apply4(OP, _mm256_loadu_pd(in + i)))
+
+VEC_TARGET_AVX2 static void map_avx2(VecOp op, const double *in, double *out, size_t n) {
+    size_t i = 0;
+    switch (op) {
+        case VEC_SQRT: MAP_LOOP(VEC_SQRT); break;
+        case VEC_ABS: MAP_LOOP(VEC_ABS); break;
+        case VEC_FLOOR: MAP_LOOP(VEC_FLOOR); break;
+        case VEC_CEIL: MAP_LOOP(VEC_CEIL); break;
+        case VEC_EXP: MAP_LOOP(VEC_EXP); break;
+        case VEC_LOG: MAP_LOOP(VEC_LOG); break;
+        case VEC_SIN: MAP_LOOP(VEC_SIN); break;
+        case VEC_COS: MAP_LOOP(VEC_COS); break;
+    }
+    if (i < n) {
+        double tail[4] = { 1.0, 1.0, 1.0, 1.0 };
+        memcpy(tail, in + i, (n - i) * sizeof(double));
+        _mm256_storeu_pd(tail, apply4(op, _mm256_loadu_pd(tail)));
+        memcpy(out + i, tail, (n - i) * sizeof(double));
+    }
+}
+
+VEC_TARGET_AVX2 static double hsum4(__m256d v) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+VEC_TARGET_AVX2 static double sum_avx2(const double *a, size_t n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = s0, s2 = s0, s3 = s0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm256_add_pd(s0, _mm256_loadu_pd(a + i));
+        s1 = _mm256_add_pd(s1, _mm256_loadu_pd(a + i + 4));
+        s2 = _mm256_add_pd(s2, _mm256_loadu_pd(a + i + 8));
+        s3 = _mm256_add_pd(s3, _mm256_loadu_pd(a + i + 12));
+    }
+    double s = hsum4(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+    for (; i < n; i++) s += a[i];
+    return s;
+}
+
+VEC_TARGET_AVX2 static double dot_avx2(const double *a, const double *b, size_t n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = s0, s2 = s0, s3 = s0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), s1);
+        s2 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8), s2);
+        s3 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12), s3);
+    }
+    double s = hsum4(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+    for (; i < n; i++) s += a[i] * b[i];
+    return s;
+}
+
+/* One row of c over columns [j, end) and k in [k0, k1), adding to what is
+ * there unless first */
+VEC_TARGET_AVX2 static void matmul_row_avx2(const double *arow, const double *b, double *crow, size_t j,
+                                            size_t end, size_t k0, size_t k1, size_t cols, bool first) {
+    for (; j + 4 <= end; j += 4) {
+        __m256d acc = first ? _mm256_setzero_pd() : _mm256_loadu_pd(crow + j);
+        for (size_t k = k0; k < k1; k++) {
+            acc = _mm256_fmadd_pd(_mm256_broadcast_sd(arow + k), _mm256_loadu_pd(b + k * cols + j), acc);
+        }
+        _mm256_storeu_pd(crow + j, acc);
+    }
+    for (; j < end; j++) {
+        double acc = first ? 0 : crow[j];
+        for (size_t k = k0; k < k1; k++) acc += arow[k] * b[k * cols + j];
+        crow[j] = acc;
+    }
+}
+
+/* Blocks of b (MATMUL_K_BLOCK x MATMUL_COL_BLOCK) stay in cache while a
+ * 4 x 8 tile of c is accumulated in registers: each b load feeds four
+ * multiply-adds and each broadcast of a two */
+VEC_TARGET_AVX2 static void matmul_avx2(const double *a, const double *b, double *c, size_t row_begin,
+                                        size_t row_end, size_t inner, size_t cols) {
+    if (inner == 0) {
+        for (size_t i = row_begin; i < row_end; i++) memset(c + i * cols, 0, cols * sizeof(double));
+        return;
+    }
+    for (size_t jb = 0; jb < cols; jb += MATMUL_COL_BLOCK) {
+        size_t je = jb + MATMUL_COL_BLOCK < cols ? jb + MATMUL_COL_BLOCK : cols;
+        for (size_t kb = 0; kb < inner; kb += MATMUL_K_BLOCK) {
+            size_t ke = kb + MATMUL_K_BLOCK < inner ? kb + MATMUL_K_BLOCK : inner;
+            bool first = kb == 0;
+            size_t i = row_begin;
+            for (; i + 4 <= row_end; i += 4) {
+                const double *a0 = a + i * inner, *a1 = a0 + inner, *a2 = a1 + inner, *a3 = a2 + inner;
+                double *c0 = c + i * cols, *c1 = c0 + cols, *c2 = c1 + cols, *c3 = c2 + cols;
+                size_t j = jb;
+                for (; j + 8 <= je; j += 8) {
+                    __m256d t00, t01, t10, t11, t20, t21, t30, t31;
+                    if (first) {
+                        t00 = t01 = t10 = t11 = t20 = t21 = t30 = t31 = _mm256_setzero_pd();
+                    } else {
+                        t00 = _mm256_loadu_pd(c0 + j), t01 = _mm256_loadu_pd(c0 + j + 4);
+                        t10 = _mm256_loadu_pd(c1 + j), t11 = _mm256_loadu_pd(c1 + j + 4);
+                        t20 = _mm256_loadu_pd(c2 + j), t21 = _mm256_loadu_pd(c2 + j + 4);
+                        t30 = _mm256_loadu_pd(c3 + j), t31 = _mm256_loadu_pd(c3 + j + 4);
+                    }
+                    for (size_t k = kb; k < ke; k++) {
+                        __m256d b0 = _mm256_loadu_pd(b + k * cols + j), b1 = _mm256_loadu_pd(b + k * cols + j + 4);
+                        __m256d x = _mm256_broadcast_sd(a0 + k);
+                        t00 = _mm256_fmadd_pd(x, b0, t00), t01 = _mm256_fmadd_pd(x, b1, t01);
+                        x = _mm256_broadcast_sd(a1 + k);
+                        t10 = _mm256_fmadd_pd(x, b0, t10), t11 = _mm256_fmadd_pd(x, b1, t11);
+                        x = _mm256_broadcast_sd(a2 + k);
+                        t20 = _mm256_fmadd_pd(x, b0, t20), t21 = _mm256_fmadd_pd(x, b1, t21);
+                        x = _mm256_broadcast_sd(a3 + k);
+                        t30 = _mm256_fmadd_pd(x, b0, t30), t31 = _mm256_fmadd_pd(x, b1, t31);
+                    }
+                    _mm256_storeu_pd(c0 + j, t00), _mm256_storeu_pd(c0 + j + 4, t01);
+                    _mm256_storeu_pd(c1 + j, t10), _mm256_storeu_pd(c1 + j + 4, t11);
+                    _mm256_storeu_pd(c2 + j, t20), _mm256_storeu_pd(c2 + j + 4, t21);
+                    _mm256_storeu_pd(c3 + j, t30), _mm256_storeu_pd(c3 + j + 4, t31);
+                }
+                for (size_t r = 0; r < 4 && j < je; r++) {
+                    matmul_row_avx2(a + (i + r) * inner, b, c + (i + r) * cols, j, je, kb, ke, cols, first);
+                }
+            }
+            for (; i < row_end; i++) matmul_row_avx2(a + i * inner, b, c + i * cols, jb, je, kb, ke, cols, first);
+        }
+    }
+}
+#endif
+
+/* ========== DISPATCH ========== */
+
+typedef struct {
+    const char *isa;
+    void (*map)(VecOp op, const double *in, double *out, size_t n);
+    double (*sum)(const double *a, size_t n);
+    double (*dot)(const double *a, const double *b, size_t n);
+    void (*matmul)(const double *a, const double *b, double *c, size_t row_begin, size_t row_end, size_t inner,
+                   size_t cols);
+} VecKernels;
+
+static const VecKernels scalar_kernels = { "scalar", map_scalar, sum_scalar, dot_scalar, matmul_scalar };
+#ifdef VEC_X86
+static const VecKernels avx2_kernels = { "avx2", map_avx2, sum_avx2, dot_avx2, matmul_avx2 };
+#endif
+
+/* Chosen on first use; a racing first call just stores the same pointer */
+static const VecKernels *active_kernels = NULL;
+
+static const VecKernels *kernels(void) {
+    if (!active_kernels) {
+        active_kernels = &scalar_kernels;
+#ifdef VEC_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) active_kernels = &avx2_kernels;
+#endif
+    }
+    return active_kernels;
+}
+
+const char *vec_isa(void) {
+    return kernels()->isa;
+}
+
+bool vec_select(const char *isa) {
+    if (strcmp(isa, "scalar") == 0) {
+        active_kernels = &scalar_kernels;
+        return true;
+    }
+#ifdef VEC_X86
+    __builtin_cpu_init();
+    if (strcmp(isa, "avx2") == 0 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        active_kernels = &avx2_kernels;
+        return true;
+    }
+#endif
+    return false;
+}
+
+/* ========== PARALLEL CHUNKS ========== */
+
+typedef struct {
+    const VecKernels *k;
+    VecOp op;
+    const double *a;
+    const double *b;
+    double *out;
+    size_t n;
+    size_t inner;
+    size_t cols;
+} VecJob;
+
+static size_t chunk_count(size_t n) {
+    return n >= VEC_PARALLEL_MIN ? (n + VEC_CHUNK - 1) / VEC_CHUNK : 1;
+}
+
+static void chunk_range(size_t chunk, size_t n, size_t chunk_size, size_t *begin, size_t *end) {
+    *begin = chunk * chunk_size;
+    *end = *begin + chunk_size < n ? *begin + chunk_size : n;
+}
+
+static void map_chunk(void *ctx, size_t chunk) {
+    VecJob *job = ctx;
+    size_t begin, end;
+    chunk_range(chunk, job->n, VEC_CHUNK, &begin, &end);
+    job->k->map(job->op, job->a + begin, job->out + begin, end - begin);
+}
+
+/* Partial sum of a chunk into out[chunk]; dot when b is set */
+static void sum_chunk(void *ctx, size_t chunk) {
+    VecJob *job = ctx;
+    size_t begin, end;
+    chunk_range(chunk, job->n, VEC_CHUNK, &begin, &end);
+    job->out[chunk] = job->b ? job->k->dot(job->a + begin, job->b + begin, end - begin)
+                             : job->k->sum(job->a + begin, end - begin);
+}
+
+static void matmul_chunk(void *ctx, size_t chunk) {
+    VecJob *job = ctx;
+    size_t begin, end;
+    chunk_range(chunk, job->n, MATMUL_ROWS, &begin, &end);
+    job->k->matmul(job->a, job->b, job->out, begin, end, job->inner, job->cols);
+}
+
+void vec_map(VecOp op, const double *in, double *out, size_t n) {
+    const VecKernels *k = kernels();
+    size_t chunks = chunk_count(n);
+    if (chunks == 1) {
+        k->map(op, in, out, n);
+        return;
+    }
+    VecJob job = { k, op, in, NULL, out, n, 0, 0 };
+    thread_pool_parallel_for(thread_pool_shared(), chunks, map_chunk, &job);
+}
+
+static double reduce(const double *a, const double *b, size_t n) {
+    const VecKernels *k = kernels();
+    size_t chunks = chunk_count(n);
+    double *partial = chunks > 1 ? malloc(chunks * sizeof(double)) : NULL;
+    if (!partial) return b ? k->dot(a, b, n) : k->sum(a, n);
+    VecJob job = { k, VEC_SQRT, a, b, partial, n, 0, 0 };
+    thread_pool_parallel_for(thread_pool_shared(), chunks, sum_chunk, &job);
+    double total = 0;
+    for (size_t i = 0; i < chunks; i++) total += partial[i];
+    free(partial);
+    return total;
+}
+
+double vec_sum(const double *a, size_t n) {
+    return reduce(a, NULL, n);
+}
+
+double vec_dot(const double *a, const double *b, size_t n) {
+    return reduce(a, b, n);
+}
+
+void vec_matmul(const double *a, const double *b, double *c, size_t rows, size_t inner, size_t cols) {
+    const VecKernels *k = kernels();
+    size_t chunks = (rows + MATMUL_ROWS - 1) / MATMUL_ROWS;
+    if (chunks <= 1 || (double)rows * (double)inner * (double)cols < (double)MATMUL_PARALLEL_MIN) {
+        k->matmul(a, b, c, 0, rows, inner, cols);
+        return;
+    }
+    VecJob job = { k, VEC_SQRT, a, b, c, rows, inner, cols };
+    thread_pool_parallel_for(thread_pool_shared(), chunks, matmul_chunk, &job);
+}
@@ -1,4 +1,5 @@
 #include "vm.h"
+#include "dtoa.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,7 +20,7 @@ int vm_run(const unsigned char* code, size_t size){
             case OP_ADD: {
                 double b=spop(&st), a=spop(&st); spush(&st, a+b); break; }
             case OP_PRINT: {
-                double v=spop(&st); printf("%g\n", v); break; }
+                double v=spop(&st); char t[DTOA_BUFFER_SIZE]; dtoa_shortest(v,t); printf("%s\n", t); break; }
             case OP_HALT: goto end;
             default: rc=1; goto end;
         }
@@ -0,0 +1,254 @@
+// collections_bench - RbDeque / RbHeap / RbSortedSet vs RbList emulation
+//
+// Usage: collections_bench [-n count] [-r rounds]
+//
+// Runs each workload on n random ints (default 100000) with the dedicated
+// container and with the RbList idiom it replaces:
+//   queue      n appends, then n x (pop front + append), then drain
+//              deque: push_back / pop_front    list: append / pop(0)
+//   pq         n pushes, n/4 decrease-keys, then n pops
+//              heap: push / update / pop       list: kept sorted descending,
+//              binary-search insert, pop from the back, decrease-key by
+//              linear search + remove + reinsert
+//   set        n adds (with duplicates), n lookups, n/100 range counts over
+//              ~1% of the keys, ordered scan, n removes
+//              sorted_set                      list: sorted, binary search,
+//              insert / pop at index
+// Prints ns per operation (best of rounds) and checks that both sides
+// produce the same results.
+//
+// Build: make -C tools collections_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rb_list.h"
+#include "rb_deque.h"
+#include "rb_heap.h"
+#include "rb_sorted_set.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static size_t n;
+static int64_t *keys;
+
+// Each workload returns a checksum so the two sides can be compared
+typedef uint64_t (*Workload)(void);
+
+// ========== QUEUE ==========
+
+static uint64_t queue_deque(void) {
+    RbDeque *deque = rb_deque_new();
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) rb_deque_push_back(deque, rb_value_int(keys[i]));
+    for (size_t i = 0; i < n; i++) {
+        sum = sum * 31 + (uint64_t)rb_deque_pop_front(deque).data.i;
+        rb_deque_push_back(deque, rb_value_int(keys[i] ^ 1));
+    }
+    while (!rb_deque_is_empty(deque)) sum = sum * 31 + (uint64_t)rb_deque_pop_front(deque).data.i;
+    rb_deque_free(deque);
+    return sum;
+}
+
+static uint64_t queue_list(void) {
+    RbList *list = rb_list_new();
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) rb_list_append(list, rb_value_int(keys[i]));
+    for (size_t i = 0; i < n; i++) {
+        sum = sum * 31 + (uint64_t)rb_list_pop(list, 0).data.i;
+        rb_list_append(list, rb_value_int(keys[i] ^ 1));
+    }
+    while (!rb_list_is_empty(list)) sum = sum * 31 + (uint64_t)rb_list_pop(list, 0).data.i;
+    rb_list_free(list);
+    return sum;
+}
+
+// ========== PRIORITY QUEUE ==========
+
+static uint64_t pq_heap(void) {
+    RbHeap *heap = rb_heap_new(NULL);
+    RbHeapHandle *handles = malloc(sizeof(RbHeapHandle) * n);
+    for (size_t i = 0; i < n; i++) {
+        handles[i] = rb_heap_push(heap, rb_value_int(keys[i]), rb_value_int((int64_t)i));
+    }
+    for (size_t i = 0; i < n; i += 4) {
+        rb_heap_update(heap, handles[i], rb_value_int(keys[i] - (int64_t)(keys[i] >> 4)));
+    }
+    uint64_t sum = 0;
+    RbValue priority, value;
+    while (rb_heap_pop(heap, &priority, &value)) sum = sum * 31 + (uint64_t)value.data.i;
+    free(handles);
+    rb_heap_free(heap);
+    return sum;
+}
+
+// The list holds ids sorted by (prio[id], id) descending, so the smallest
+// entry sits at the back where popping it is O(1)
+static int64_t *prio;
+
+static size_t list_position(const RbList *list, int64_t p, int64_t id) {
+    size_t low = 0, high = list->size;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        int64_t mid_id = list->items[mid].data.i;
+        int64_t q = prio[mid_id];
+        if (q > p || (q == p && mid_id > id)) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+static uint64_t pq_list(void) {
+    RbList *list = rb_list_new();
+    prio = malloc(sizeof(int64_t) * n);
+    for (size_t i = 0; i < n; i++) {
+        prio[i] = keys[i];
+        rb_list_insert(list, (int)list_position(list, prio[i], (int64_t)i), rb_value_int((int64_t)i));
+    }
+    for (size_t i = 0; i < n; i += 4) {
+        for (size_t j = 0; j < list->size; j++) {
+            if (list->items[j].data.i == (int64_t)i) {
+                rb_list_pop(list, (int)j);
+                break;
+            }
+        }
+        prio[i] = keys[i] - (int64_t)(keys[i] >> 4);
+        rb_list_insert(list, (int)list_position(list, prio[i], (int64_t)i), rb_value_int((int64_t)i));
+    }
+    uint64_t sum = 0;
+    while (!rb_list_is_empty(list)) sum = sum * 31 + (uint64_t)rb_list_pop(list, -1).data.i;
+    free(prio);
+    rb_list_free(list);
+    return sum;
+}
+
+// ========== SORTED SET ==========
+
+static size_t set_span;     // width of a range query
+
+static uint64_t set_tree(void) {
+    RbSortedSet *set = rb_sorted_set_new(NULL);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += rb_sorted_set_add(set, rb_value_int(keys[i] % (int64_t)n));
+    for (size_t i = 0; i < n; i++) sum += rb_sorted_set_contains(set, rb_value_int(keys[n - 1 - i] % (int64_t)n));
+    for (size_t i = 0; i < n / 100; i++) {
+        int64_t low = keys[i] % (int64_t)n;
+        sum += rb_sorted_set_count_range(set, rb_value_int(low), rb_value_int(low + (int64_t)set_span));
+    }
+    RbSortedSetIter it = rb_sorted_set_begin(set);
+    RbValue value;
+    while (rb_sorted_set_next(&it, &value)) sum = sum * 31 + (uint64_t)value.data.i;
+    for (size_t i = 0; i < n; i++) sum += rb_sorted_set_remove(set, rb_value_int(keys[i] % (int64_t)n));
+    rb_sorted_set_free(set);
+    return sum;
+}
+
+static size_t lower_bound(const RbList *list, int64_t x) {
+    size_t low = 0, high = list->size;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (list->items[mid].data.i < x) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+static uint64_t set_list(void) {
+    RbList *list = rb_list_new();
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        int64_t x = keys[i] % (int64_t)n;
+        size_t pos = lower_bound(list, x);
+        if (pos < list->size && list->items[pos].data.i == x) continue;
+        rb_list_insert(list, (int)pos, rb_value_int(x));
+        sum++;
+    }
+    for (size_t i = 0; i < n; i++) {
+        int64_t x = keys[n - 1 - i] % (int64_t)n;
+        size_t pos = lower_bound(list, x);
+        sum += pos < list->size && list->items[pos].data.i == x;
+    }
+    for (size_t i = 0; i < n / 100; i++) {
+        int64_t low = keys[i] % (int64_t)n;
+        sum += lower_bound(list, low + (int64_t)set_span) - lower_bound(list, low);
+    }
+    for (size_t i = 0; i < list->size; i++) sum = sum * 31 + (uint64_t)list->items[i].data.i;
+    for (size_t i = 0; i < n; i++) {
+        int64_t x = keys[i] % (int64_t)n;
+        size_t pos = lower_bound(list, x);
+        if (pos < list->size && list->items[pos].data.i == x) {
+            rb_list_pop(list, (int)pos);
+            sum++;
+        }
+    }
+    rb_list_free(list);
+    return sum;
+}
+
+// ========== DRIVER ==========
+
+static double best_of(Workload workload, int rounds, uint64_t *checksum) {
+    double best = 1e30;
+    for (int r = 0; r < rounds; r++) {
+        double start = now_sec();
+        *checksum = workload();
+        double elapsed = now_sec() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+static int compare(const char *name, Workload fast, Workload slow, size_t ops, int rounds) {
+    uint64_t a, b;
+    double t_fast = best_of(fast, rounds, &a);
+    double t_slow = best_of(slow, rounds, &b);
+    printf("%-6s %10zu %12.1f %12.1f %9.1fx%s\n", name, n,
+           t_fast * 1e9 / (double)ops, t_slow * 1e9 / (double)ops, t_slow / t_fast,
+           a == b ? "" : "  MISMATCH");
+    return a == b ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    n = 100000;
+    int rounds = 3;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) n = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) rounds = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-n count] [-r rounds]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (n < 100 || rounds < 1) {
+        fprintf(stderr, "count must be >= 100 and rounds >= 1\n");
+        return 2;
+    }
+
+    keys = malloc(sizeof(int64_t) * n);
+    for (size_t i = 0; i < n; i++) keys[i] = (int64_t)(next_random() >> 2);
+    set_span = n / 100;
+
+    printf("%-6s %10s %12s %12s %10s\n", "work", "n", "ns/op", "list ns/op", "speedup");
+    int failures = 0;
+    failures += compare("queue", queue_deque, queue_list, 3 * n, rounds);
+    failures += compare("pq", pq_heap, pq_list, 2 * n + n / 4, rounds);
+    failures += compare("set", set_tree, set_list, 3 * n + n / 100, rounds);
+
+    free(keys);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,285 @@
+// csv_bench - CSV reader and writer throughput on a generated file
+//
+// Usage: csv_bench [-g gigabytes] [-d dir] [-keep]
+//
+// Writes about -g GB (default 2) of sales rows into -d (default $TMPDIR or
+// /tmp) with the buffered CsvWriter: an int id, a short code, a name that
+// is quoted when it holds a comma, a price, a quantity and a free-text note
+// with doubled quotes. Then reads it back several ways, each counting rows
+// and field bytes so the results can be checked against each other:
+//   bytes      a byte-at-a-time quote/delimiter state machine, the loop a
+//              hand-written splitter runs
+//   scalar     CsvReader over mmap, scalar structural index
+//   sse2       the same, SSE2 masks
+//   avx2       the same, AVX2 masks and PCLMUL prefix XOR
+//   buffered   CsvReader over a FILE* with a refilled 1 MB buffer
+//   column     csv_read_column of the price column into a packed array
+// The writer is compared with fprintf on up to 1M rows written to
+// /dev/null. The first read warms the page cache; GB/s counts input bytes.
+//
+// Build: make -C tools csv_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "csv.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static const char *names[] = {
+    "Widget", "Gadget, large", "Sprocket", "Flange, 3/4\"", "Bolt", "Nut, hex", "Washer", "Gear"
+};
+
+// ========== ROWS ==========
+
+typedef struct {
+    int64_t id;
+    char code[9];
+    const char *name;
+    double price;
+    int64_t qty;
+    char note[48];
+} Row;
+
+static void make_row(Row *row, int64_t id) {
+    uint64_t r = next_random();
+    row->id = id;
+    for (int i = 0; i < 8; i++, r >>= 5) row->code[i] = (char)('A' + (r & 15));
+    row->code[8] = '\0';
+    row->name = names[r & 7];
+    row->price = (double)(next_random() % 100000) / 100.0;
+    row->qty = (int64_t)(next_random() % 500);
+    uint64_t words = 3 + next_random() % 5;
+    size_t n = 0;
+    for (uint64_t w = 0; w < words; w++) {
+        n += (size_t)snprintf(row->note + n, sizeof(row->note) - n, w == 1 && (id & 3) == 0 ? "\"%s\" " : "%s ",
+                              names[next_random() & 7]);
+        if (n > 30) break;
+    }
+    row->note[n ? n - 1 : 0] = '\0';
+}
+
+static void write_row(CsvWriter *out, const Row *row) {
+    csv_writer_int(out, row->id);
+    csv_writer_field(out, row->code, 8);
+    csv_writer_field(out, row->name, strlen(row->name));
+    csv_writer_number(out, row->price);
+    csv_writer_int(out, row->qty);
+    csv_writer_field(out, row->note, strlen(row->note));
+    csv_writer_end_row(out);
+}
+
+// What a script-level writer does: fprintf per field, quoting by hand
+static void fprintf_field(FILE *out, const char *s) {
+    if (!strpbrk(s, ",\"\n\r")) {
+        fputs(s, out);
+        return;
+    }
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"') fputc('"', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static void fprintf_row(FILE *out, const Row *row) {
+    fprintf(out, "%lld,", (long long)row->id);
+    fprintf_field(out, row->code);
+    fputc(',', out);
+    fprintf_field(out, row->name);
+    fprintf(out, ",%.17g,%lld,", row->price, (long long)row->qty);
+    fprintf_field(out, row->note);
+    fputc('\n', out);
+}
+
+// ========== READERS ==========
+
+typedef struct {
+    uint64_t rows;
+    uint64_t fields;
+    uint64_t bytes;
+} Counts;
+
+// Byte loop: fields end at a delimiter or newline outside quotes and are
+// collected per row, as a hand-written splitter hands them on
+static Counts read_bytes(const char *data, size_t length) {
+    Counts c = { 0, 0, 0 };
+    CsvField row[64];
+    size_t n = 0;
+    bool quoted = false;
+    size_t field_start = 0;
+    for (size_t i = 0; i < length; i++) {
+        char ch = data[i];
+        if (ch == '"') quoted = !quoted;
+        else if (!quoted && (ch == ',' || ch == '\n')) {
+            if (n < 64) row[n++] = (CsvField){ data + field_start, i - field_start };
+            field_start = i + 1;
+            if (ch == '\n') {
+                for (size_t f = 0; f < n; f++) c.bytes += row[f].length;
+                c.fields += n;
+                c.rows++;
+                n = 0;
+            }
+        }
+    }
+    return c;
+}
+
+static Counts read_with(CsvReader *reader) {
+    Counts c = { 0, 0, 0 };
+    const CsvField *fields;
+    size_t count;
+    while (csv_reader_next(reader, &fields, &count)) {
+        c.rows++;
+        c.fields += count;
+        for (size_t i = 0; i < count; i++) c.bytes += fields[i].length;
+    }
+    csv_reader_close(reader);
+    return c;
+}
+
+static void report(const char *name, double seconds, size_t bytes, uint64_t rows, double baseline) {
+    printf("%-9s %10.2f %10.2f %12.1f", name, seconds * 1e3, (double)bytes / seconds / 1e9, (double)rows / seconds / 1e6);
+    if (baseline > 0) printf(" %8.1fx", baseline / seconds);
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    double gigabytes = 2;
+    const char *dir = getenv("TMPDIR");
+    bool keep = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) gigabytes = atof(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) dir = argv[++i];
+        else if (strcmp(argv[i], "-keep") == 0) keep = true;
+        else {
+            fprintf(stderr, "Usage: %s [-g gigabytes] [-d dir] [-keep]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!(gigabytes > 0)) return 2;
+    if (!dir) dir = "/tmp";
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/csv_bench.csv", dir);
+
+    // Write
+    uint64_t target = (uint64_t)(gigabytes * 1e9);
+    double start = now_sec();
+    CsvWriter *out = csv_writer_open(path, ',');
+    if (!out) {
+        fprintf(stderr, "cannot create %s\n", path);
+        return 1;
+    }
+    const char *header[] = { "id", "code", "name", "price", "qty", "note" };
+    for (int i = 0; i < 6; i++) csv_writer_field(out, header[i], strlen(header[i]));
+    csv_writer_end_row(out);
+    Row row;
+    uint64_t written = 0, approx_bytes = 0;
+    while (approx_bytes < target) {
+        make_row(&row, (int64_t)written++);
+        write_row(out, &row);
+        approx_bytes += 40 + strlen(row.name) + strlen(row.note);
+    }
+    if (!csv_writer_close(out)) {
+        fprintf(stderr, "write failed\n");
+        return 1;
+    }
+    double write_time = now_sec() - start;
+
+    CsvReader *probe = csv_reader_open(path, ',');
+    if (!probe) return 1;
+    csv_reader_close(probe);
+    FILE *file = fopen(path, "rb");
+    fseek(file, 0, SEEK_END);
+    size_t size = (size_t)ftell(file);
+    fclose(file);
+    printf("%s: %.2f GB, %llu rows, scanner %s\n", path, (double)size / 1e9, (unsigned long long)written + 1,
+           csv_scan_isa());
+    printf("%-9s %10s %10s %12s %9s\n", "reader", "ms", "GB/s", "Mrows/s", "vs bytes");
+
+    // Byte loop over the file loaded into memory
+    FILE *raw = fopen(path, "rb");
+    char *data = malloc(size);
+    if (!raw || !data || fread(data, 1, size, raw) != size) {
+        fprintf(stderr, "cannot load %s\n", path);
+        return 1;
+    }
+    fclose(raw);
+    start = now_sec();
+    Counts expect = read_bytes(data, size);
+    double byte_time = now_sec() - start;
+    free(data);
+    report("bytes", byte_time, size, expect.rows, 0);
+
+    int failures = 0;
+    const char *isas[] = { "scalar", "sse2", "avx2" };
+    for (int i = 0; i < 3; i++) {
+        if (!csv_scan_select(isas[i])) continue;
+        start = now_sec();
+        Counts got = read_with(csv_reader_open(path, ','));
+        double t = now_sec() - start;
+        report(isas[i], t, size, got.rows, byte_time);
+        // The byte loop keeps the quotes of quoted fields
+        if (got.rows != expect.rows || got.fields != expect.fields) failures++;
+    }
+    if (!csv_scan_select(isas[2])) csv_scan_select(isas[1]);
+
+    FILE *stream = fopen(path, "rb");
+    start = now_sec();
+    Counts buffered = read_with(csv_reader_open_stream(stream, ','));
+    double t = now_sec() - start;
+    fclose(stream);
+    report("buffered", t, size, buffered.rows, byte_time);
+    if (buffered.rows != expect.rows || buffered.fields != expect.fields) failures++;
+
+    start = now_sec();
+    PackedArray *prices = csv_read_column(path, ',', 3);
+    t = now_sec() - start;
+    double sum = 0;
+    for (size_t i = 0; prices && i < prices->length; i++) sum += prices->data[i];
+    report("column", t, size, prices ? prices->length : 0, byte_time);
+    if (!prices || prices->length + 1 != expect.rows || !isfinite(sum)) failures++;
+    packed_array_free(prices);
+
+    // Writer against fprintf on rows generated up front, formatting only
+    size_t rows = written < ((size_t)1 << 20) ? (size_t)written : (size_t)1 << 20;
+    Row *table = malloc(sizeof(Row) * rows);
+    FILE *null_out = fopen("/dev/null", "wb");
+    CsvWriter *null_writer = csv_writer_open("/dev/null", ',');
+    if (table && null_out && null_writer) {
+        for (size_t i = 0; i < rows; i++) make_row(&table[i], (int64_t)i);
+        setvbuf(null_out, NULL, _IOFBF, CSV_WRITE_BUFFER);
+        start = now_sec();
+        for (size_t i = 0; i < rows; i++) fprintf_row(null_out, &table[i]);
+        double fprintf_time = now_sec() - start;
+        start = now_sec();
+        for (size_t i = 0; i < rows; i++) write_row(null_writer, &table[i]);
+        double writer_time = now_sec() - start;
+        printf("generate+write %.2f s; %zu rows: CsvWriter %.2f ms, fprintf %.2f ms, %.1fx\n", write_time, rows,
+               writer_time * 1e3, fprintf_time * 1e3, fprintf_time / writer_time);
+    }
+    free(table);
+    if (null_out) fclose(null_out);
+    csv_writer_close(null_writer);
+
+    if (!keep) remove(path);
+    if (failures) printf("MISMATCH in %d readers\n", failures);
+    return failures ? 1 : 0;
+}
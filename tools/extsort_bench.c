@@ -0,0 +1,186 @@
+// extsort_bench - external merge sort on a generated file of lines
+//
+// Usage: extsort_bench [-g gigabytes] [-b budget_mb] [-d dir] [-keep]
+//
+// Writes a file of about -g GB (default 10) of random 100-byte lines, each
+// a 16-character key and a payload, into -d (default $TMPDIR or /tmp), then
+// sorts it with external_sort under a -b MB memory budget (default 512)
+// into a second file, the same way collections.sort_external does. Reports
+// the run-formation and merge phases separately, the number of runs and
+// merge passes, and checks that the output is sorted and has every line.
+// Needs about three times the input size in free disk space (input,
+// output and the spilled runs). The files are removed unless -keep.
+//
+// Build: make -C tools extsort_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "external_sort.h"
+
+#define LINE_LENGTH 100     // including the newline
+#define KEY_LENGTH  16
+#define IO_BUFFER   (1 << 20)
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static bool generate(const char* path, uint64_t lines) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    setvbuf(file, NULL, _IOFBF, IO_BUFFER);
+    char line[LINE_LENGTH];
+    for (uint64_t i = 0; i < lines; i++) {
+        uint64_t r = next_random();
+        for (int j = 0; j < KEY_LENGTH; j++) {
+            line[j] = (char)('a' + (r % 26));
+            r /= 26;
+            if (j == 12) r = next_random();
+        }
+        int n = snprintf(line + KEY_LENGTH, sizeof(line) - KEY_LENGTH, " %020llu ",
+                         (unsigned long long)i);
+        memset(line + KEY_LENGTH + n, 'x', LINE_LENGTH - 1 - KEY_LENGTH - n);
+        line[LINE_LENGTH - 1] = '\n';
+        if (fwrite(line, 1, LINE_LENGTH, file) != LINE_LENGTH) {
+            fclose(file);
+            return false;
+        }
+    }
+    return fclose(file) == 0;
+}
+
+typedef struct {
+    FILE* file;
+    char line[LINE_LENGTH + 1];
+} LineReader;
+
+static bool next_line(void* ctx, RbValue* out) {
+    LineReader* reader = ctx;
+    if (!fgets(reader->line, sizeof(reader->line), reader->file)) return false;
+    size_t length = strlen(reader->line);
+    if (length && reader->line[length - 1] == '\n') length--;
+    out->type = RB_VAL_STRING;
+    out->data.s = malloc(length + 1);
+    if (!out->data.s) return false;
+    memcpy(out->data.s, reader->line, length);
+    out->data.s[length] = '\0';
+    return true;
+}
+
+typedef struct {
+    FILE* file;
+    double first_emit;
+} LineWriter;
+
+static bool write_line(void* ctx, RbValue line) {
+    LineWriter* writer = ctx;
+    if (writer->first_emit == 0) writer->first_emit = now_sec();
+    bool ok = fputs(line.data.s, writer->file) >= 0 && fputc('\n', writer->file) != EOF;
+    rb_value_free(line);
+    return ok;
+}
+
+// Sorted order and line count of the output
+static bool verify(const char* path, uint64_t expected) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    setvbuf(file, NULL, _IOFBF, IO_BUFFER);
+    char previous[LINE_LENGTH + 1] = "", line[LINE_LENGTH + 1];
+    uint64_t count = 0;
+    bool sorted = true;
+    while (fgets(line, sizeof(line), file)) {
+        if (count > 0 && strcmp(previous, line) > 0) sorted = false;
+        memcpy(previous, line, sizeof(line));
+        count++;
+    }
+    fclose(file);
+    if (!sorted) printf("output is NOT sorted\n");
+    if (count != expected) printf("output has %llu lines, expected %llu\n",
+                                  (unsigned long long)count, (unsigned long long)expected);
+    return sorted && count == expected;
+}
+
+int main(int argc, char** argv) {
+    double gigabytes = 10;
+    size_t budget_mb = 512;
+    const char* dir = getenv("TMPDIR");
+    bool keep = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-keep") == 0) keep = true;
+        else if (i + 1 < argc && strcmp(argv[i], "-g") == 0) gigabytes = atof(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "-b") == 0) budget_mb = (size_t)atol(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "-d") == 0) dir = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [-g gigabytes] [-b budget_mb] [-d dir] [-keep]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!dir || !*dir) dir = "/tmp";
+
+    char input[4096], output[4096];
+    snprintf(input, sizeof(input), "%s/extsort_bench.in", dir);
+    snprintf(output, sizeof(output), "%s/extsort_bench.out", dir);
+    uint64_t lines = (uint64_t)(gigabytes * 1e9) / LINE_LENGTH;
+    double size_mb = (double)lines * LINE_LENGTH / 1e6;
+
+    printf("generating %.0f MB (%llu lines) in %s\n", size_mb, (unsigned long long)lines, dir);
+    double t0 = now_sec();
+    if (!generate(input, lines)) {
+        fprintf(stderr, "cannot write %s\n", input);
+        return 1;
+    }
+    printf("  generate   %8.2f s\n", now_sec() - t0);
+
+    LineReader reader = { fopen(input, "rb"), "" };
+    LineWriter writer = { fopen(output, "wb"), 0 };
+    if (!reader.file || !writer.file) {
+        fprintf(stderr, "cannot open %s / %s\n", input, output);
+        return 1;
+    }
+    setvbuf(reader.file, NULL, _IOFBF, IO_BUFFER);
+    setvbuf(writer.file, NULL, _IOFBF, IO_BUFFER);
+
+    ExtSortOptions options = {0};
+    options.memory_budget = budget_mb << 20;
+    options.temp_dir = dir;
+    ExtSortStats stats;
+    double start = now_sec();
+    bool ok = external_sort(next_line, &reader, write_line, &writer, &options, &stats);
+    ok = fclose(writer.file) == 0 && ok;
+    double end = now_sec();
+    fclose(reader.file);
+    if (!ok) {
+        fprintf(stderr, "external_sort failed\n");
+        return 1;
+    }
+    double runs_done = writer.first_emit ? writer.first_emit : end;
+
+    printf("sorting with a %zu MB budget\n", budget_mb);
+    printf("  runs       %8.2f s   %zu runs\n", runs_done - start, stats.runs);
+    printf("  merge      %8.2f s   %zu pass%s\n", end - runs_done, stats.merge_passes,
+           stats.merge_passes == 1 ? "" : "es");
+    printf("  total      %8.2f s   %.1f MB/s, %.0f MB spilled\n", end - start,
+           size_mb / (end - start), (double)stats.bytes_spilled / 1e6);
+
+    bool good = verify(output, lines);
+    printf("%s\n", good ? "output verified" : "VERIFICATION FAILED");
+    if (!keep) {
+        remove(input);
+        remove(output);
+    }
+    return good ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+// fs_bench - src/fs_walk.c against find on a generated tree
+//
+// Usage: fs_bench [-r root] [-w width] [-d depth] [-f files] [-k]
+//
+// Builds a tree under root (default /tmp/fs_bench_tree) with width
+// subdirectories per directory down to depth levels and files empty files
+// in each directory (default 12, 3, 20: 1885 directories, 37700 files),
+// then lists it, each way after one warm-up so the page cache is hot:
+//   find        find root -mindepth 1, counting the lines it prints
+//   lstat       opendir/readdir and an lstat per entry, one thread, the
+//               usual hand-written recursive walk
+//   fs_walk     fs_walk_open over the shared pool; also the time until
+//               the first path arrived
+// and the same for a glob, root/**/f1*.txt against find -name. The counts
+// must agree. -k keeps the tree for another run.
+//
+// Build: make -C tools fs_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "fs_walk.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int width = 12, depth = 3, files = 20;
+
+static size_t build(char *path, size_t length, int level) {
+    size_t made = 0;
+    for (int i = 0; i < files; i++) {
+        snprintf(path + length, 32, "/f%d.txt", i);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            close(fd);
+            made++;
+        }
+    }
+    if (level == depth) return made;
+    for (int i = 0; i < width; i++) {
+        int n = snprintf(path + length, 32, "/d%d", i);
+        if (mkdir(path, 0755) != 0) continue;
+        made += 1 + build(path, length + (size_t)n, level + 1);
+    }
+    return made;
+}
+
+static size_t run_find(const char *root, const char *name) {
+    char command[1024];
+    if (name) snprintf(command, sizeof(command), "find '%s' -mindepth 1 -name '%s'", root, name);
+    else snprintf(command, sizeof(command), "find '%s' -mindepth 1", root);
+    FILE *p = popen(command, "r");
+    if (!p) return 0;
+    size_t count = 0;
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), p)) > 0) {
+        for (size_t i = 0; i < n; i++) count += buffer[i] == '\n';
+    }
+    pclose(p);
+    return count;
+}
+
+static size_t run_lstat(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+    size_t count = 0;
+    struct dirent *e;
+    char path[4096];
+    while ((e = readdir(d)) != NULL) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        struct stat st;
+        if (lstat(path, &st) != 0) continue;
+        count++;
+        if (S_ISDIR(st.st_mode)) count += run_lstat(path);
+    }
+    closedir(d);
+    return count;
+}
+
+static size_t run_walk(FsWalk *w, double start, double *first) {
+    const char *path;
+    size_t length, count = 0;
+    FsEntryType type;
+    while (fs_walk_next(w, &path, &length, &type)) {
+        if (count++ == 0) *first = now_sec() - start;
+    }
+    fs_walk_close(w);
+    return count;
+}
+
+static void report(const char *how, size_t count, double seconds) {
+    printf("  %-8s %8zu entries %9.2f ms %8.2f M entries/s\n", how, count, seconds * 1e3,
+           (double)count / seconds / 1e6);
+}
+
+int main(int argc, char **argv) {
+    const char *root = "/tmp/fs_bench_tree";
+    bool keep = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) root = argv[++i];
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) width = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) files = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0) keep = true;
+        else {
+            fprintf(stderr, "Usage: %s [-r root] [-w width] [-d depth] [-f files] [-k]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    char path[4096];
+    size_t length = strlen(root);
+    if (length + 32 * (size_t)(depth + 2) > sizeof(path)) return 2;
+    memcpy(path, root, length + 1);
+    struct stat st;
+    size_t entries;
+    if (stat(root, &st) == 0) {
+        entries = run_lstat(root);
+        printf("reusing %s: %zu entries\n", root, entries);
+    } else {
+        mkdir(root, 0755);
+        double start = now_sec();
+        entries = build(path, length, 0);
+        printf("built %s: %zu entries in %.2f s\n", root, entries, now_sec() - start);
+    }
+
+    char pattern[4200];
+    snprintf(pattern, sizeof(pattern), "%s/**/f1*.txt", root);
+    int failures = 0;
+    for (int glob = 0; glob <= 1; glob++) {
+        printf("%s\n", glob ? pattern : "walk");
+        double seconds[3], first = 0;
+        size_t counts[3];
+        for (int pass = 0; pass < 2; pass++) {
+            double start = now_sec();
+            counts[0] = run_find(root, glob ? "f1*.txt" : NULL);
+            seconds[0] = now_sec() - start;
+            start = now_sec();
+            counts[1] = glob ? 0 : run_lstat(root);
+            seconds[1] = now_sec() - start;
+            start = now_sec();
+            FsWalk *w = glob ? fs_glob_open(pattern) : fs_walk_open(root);
+            counts[2] = w ? run_walk(w, start, &first) : 0;
+            seconds[2] = now_sec() - start;
+        }
+        report("find", counts[0], seconds[0]);
+        if (!glob) report("lstat", counts[1], seconds[1]);
+        report("fs_walk", counts[2], seconds[2]);
+        printf("  first path after %.3f ms\n", first * 1e3);
+        if (counts[2] != counts[0] || (!glob && counts[1] != counts[0])) {
+            printf("  MISMATCH\n");
+            failures++;
+        }
+    }
+
+    if (!keep) {
+        char command[4200];
+        snprintf(command, sizeof(command), "rm -rf '%s'", root);
+        if (system(command) != 0) fprintf(stderr, "could not remove %s\n", root);
+    }
+    return failures ? 1 : 0;
+}
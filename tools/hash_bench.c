@@ -0,0 +1,248 @@
+// hash_bench - keyed collection hashes vs the old FNV-1a / int mixer
+//
+// Usage: hash_bench [-n samples]
+//
+// Throughput: rb_hash_bytes vs byte-at-a-time FNV-1a for inputs of 4 B to
+// 1 MB, in GB/s and bytes per TSC cycle (x86 only), plus ns per hash for
+// ints. Quality: avalanche matrices for rb_value_hash on every RbValueType.
+// Flipping one input bit should flip each output bit with probability 1/2;
+// the table shows the worst and mean deviation from that (as a fraction,
+// 0 = ideal, 1 = output bit fixed or always flipped) over -n random inputs
+// (default 20000). Null and bool have too few input bits to measure, so
+// every type is also checked against flips of the 64 seed bits.
+//
+// Build: make -C tools hash_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "rb_collections.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// The hashes rb_collections used before
+static uint64_t old_hash_bytes(const void* data, size_t len) {
+    const unsigned char* p = data;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t old_hash_int(int64_t i) {
+    uint64_t x = (uint64_t)i;
+    x = ((x >> 32) ^ x) * 0x45d9f3b3335b369dULL;
+    x = ((x >> 32) ^ x) * 0x3335b36945d9f3b3ULL;
+    return (x >> 32) ^ x;
+}
+
+static volatile uint64_t sink;
+
+/* ========== THROUGHPUT ========== */
+
+typedef uint64_t (*BytesHash)(const void* data, size_t len);
+
+static void time_bytes(BytesHash hash, const unsigned char* buf, size_t len,
+                       double* gbps, double* bytes_per_cycle) {
+    size_t iterations = (size_t)(64e6 / (double)(len + 16)) + 1;
+    double best = 1e30, best_cycles = 1e30;
+    for (int round = 0; round < 3; round++) {
+        uint64_t acc = 0;
+        double t0 = now_sec();
+#ifdef HAVE_TSC
+        uint64_t c0 = __rdtsc();
+#endif
+        for (size_t i = 0; i < iterations; i++) {
+            // Feed the previous result back so calls cannot overlap
+            acc += hash(buf + (acc & 7), len);
+        }
+#ifdef HAVE_TSC
+        double cycles = (double)(__rdtsc() - c0);
+        if (cycles < best_cycles) best_cycles = cycles;
+#endif
+        double t = now_sec() - t0;
+        if (t < best) best = t;
+        sink = acc;
+    }
+    double bytes = (double)len * (double)iterations;
+    *gbps = bytes / best / 1e9;
+    *bytes_per_cycle = best_cycles < 1e30 ? bytes / best_cycles : 0;
+}
+
+static double time_ints(uint64_t (*hash)(int64_t)) {
+    size_t iterations = 20000000;
+    double best = 1e30;
+    for (int round = 0; round < 3; round++) {
+        uint64_t acc = 0;
+        double t0 = now_sec();
+        for (size_t i = 0; i < iterations; i++) acc += hash((int64_t)(i ^ acc));
+        double t = now_sec() - t0;
+        if (t < best) best = t;
+        sink = acc;
+    }
+    return best * 1e9 / (double)iterations;
+}
+
+/* ========== AVALANCHE ========== */
+
+typedef enum { IN_INPUT, IN_SEED } FlipTarget;
+
+typedef struct {
+    const char* name;
+    RbValueType type;
+    int input_bits;     // bits flipped when testing the input (0 = none)
+    size_t string_len;
+} Case;
+
+// A value of the case's type built from `bits`; strings use buf
+static RbValue make_value(const Case* c, const uint64_t* bits, char* buf) {
+    RbValue v;
+    v.type = c->type;
+    switch (c->type) {
+    case RB_VAL_INT:   v.data.i = (int64_t)bits[0]; break;
+    case RB_VAL_FLOAT: memcpy(&v.data.f, &bits[0], sizeof(double)); break;
+    case RB_VAL_BOOL:  v.data.b = bits[0] & 1; break;
+    case RB_VAL_PTR:   v.data.ptr = (void*)(uintptr_t)bits[0]; break;
+    case RB_VAL_STRING:
+        // High bit always set, so flipping any of the low 7 bits of a
+        // byte never yields the terminator
+        for (size_t i = 0; i < c->string_len; i++) {
+            buf[i] = (char)((bits[i / 8] >> (8 * (i % 8))) | 0x80);
+        }
+        buf[c->string_len] = '\0';
+        v.data.s = buf;
+        break;
+    default:           v.data.ptr = NULL; break;
+    }
+    return v;
+}
+
+static uint64_t hash_with_seed(RbValue v, uint64_t seed) {
+    rb_hash_set_seed(seed);
+    return rb_value_hash(v);
+}
+
+// Worst and mean |P(output bit flips) - 1/2| * 2 over every input/output bit pair
+static void avalanche(const Case* c, FlipTarget target, size_t samples, double* worst, double* mean) {
+    int in_bits = target == IN_SEED ? 64 : c->input_bits;
+    uint32_t* flips = calloc((size_t)in_bits * 64, sizeof(uint32_t));
+    uint64_t bits[8];
+    char buf[72], flipped_buf[72];
+    for (size_t s = 0; s < samples; s++) {
+        for (int w = 0; w < 8; w++) bits[w] = next_random();
+        uint64_t seed = next_random() | 1;
+        RbValue v = make_value(c, bits, buf);
+        uint64_t base = hash_with_seed(v, seed);
+        for (int i = 0; i < in_bits; i++) {
+            uint64_t h;
+            if (target == IN_SEED) {
+                h = hash_with_seed(v, seed ^ (1ULL << i));
+            } else {
+                uint64_t flipped[8];
+                memcpy(flipped, bits, sizeof(bits));
+                if (c->type == RB_VAL_STRING) {
+                    int byte = i / 7;
+                    flipped[byte / 8] ^= 1ULL << (8 * (byte % 8) + i % 7);
+                } else {
+                    flipped[0] ^= 1ULL << i;
+                }
+                h = hash_with_seed(make_value(c, flipped, flipped_buf), seed);
+            }
+            uint64_t diff = h ^ base;
+            for (int j = 0; j < 64; j++) flips[i * 64 + j] += (diff >> j) & 1;
+        }
+    }
+    double w = 0, total = 0;
+    for (int k = 0; k < in_bits * 64; k++) {
+        double bias = fabs((double)flips[k] / (double)samples - 0.5) * 2;
+        if (bias > w) w = bias;
+        total += bias;
+    }
+    *worst = w;
+    *mean = total / (in_bits * 64);
+    free(flips);
+}
+
+int main(int argc, char** argv) {
+    size_t samples = 20000;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-n") == 0) samples = (size_t)atol(argv[++i]);
+        else { fprintf(stderr, "Usage: %s [-n samples]\n", argv[0]); return 1; }
+    }
+
+    size_t max_len = 1 << 20;
+    unsigned char* buf = malloc(max_len + 8);
+    for (size_t i = 0; i < max_len + 8; i++) buf[i] = (unsigned char)next_random();
+
+    printf("throughput (best of 3)\n");
+    printf("%9s %12s %12s %12s %12s %8s\n", "bytes", "fnv1a GB/s", "fnv1a B/cyc",
+           "keyed GB/s", "keyed B/cyc", "speedup");
+    static const size_t lengths[] = { 4, 8, 16, 32, 64, 128, 256, 1024, 4096, 65536, 1 << 20 };
+    for (size_t k = 0; k < sizeof(lengths) / sizeof(lengths[0]); k++) {
+        double old_gbps, old_bpc, new_gbps, new_bpc;
+        time_bytes(old_hash_bytes, buf, lengths[k], &old_gbps, &old_bpc);
+        time_bytes(rb_hash_bytes, buf, lengths[k], &new_gbps, &new_bpc);
+        printf("%9zu %12.2f %12.3f %12.2f %12.3f %7.1fx\n", lengths[k], old_gbps, old_bpc,
+               new_gbps, new_bpc, new_gbps / old_gbps);
+    }
+    printf("int hash: old mixer %.2f ns, keyed %.2f ns\n",
+           time_ints(old_hash_int), time_ints(rb_hash_int));
+
+    static const Case cases[] = {
+        { "null",      RB_VAL_NULL,    0,  0 },
+        { "bool",      RB_VAL_BOOL,    1,  0 },
+        { "int",       RB_VAL_INT,     64, 0 },
+        { "float",     RB_VAL_FLOAT,   64, 0 },
+        { "ptr",       RB_VAL_PTR,     64, 0 },
+        { "string/3",  RB_VAL_STRING,  21, 3 },
+        { "string/8",  RB_VAL_STRING,  56, 8 },
+        { "string/24", RB_VAL_STRING,  168, 24 },
+        { "string/64", RB_VAL_STRING,  448, 64 },
+    };
+    printf("\navalanche over %zu samples (deviation from 1/2: 0 = ideal)\n", samples);
+    printf("%-10s %12s %12s %12s %12s\n", "type", "input worst", "input mean", "seed worst", "seed mean");
+    uint64_t seed = rb_hash_seed();
+    bool ok = true;
+    // With n samples the noise floor of the worst cell is roughly 4.5 / sqrt(n)
+    double limit = 6.0 / sqrt((double)samples);
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+        const Case* c = &cases[k];
+        double in_worst = 0, in_mean = 0, seed_worst, seed_mean;
+        if (c->input_bits > 1) avalanche(c, IN_INPUT, samples, &in_worst, &in_mean);
+        avalanche(c, IN_SEED, samples, &seed_worst, &seed_mean);
+        if (c->input_bits > 1) {
+            printf("%-10s %12.4f %12.4f %12.4f %12.4f\n", c->name, in_worst, in_mean, seed_worst, seed_mean);
+        } else {
+            printf("%-10s %12s %12s %12.4f %12.4f\n", c->name, "-", "-", seed_worst, seed_mean);
+        }
+        if (in_worst > limit || seed_worst > limit) ok = false;
+    }
+    rb_hash_set_seed(seed);
+
+    printf("\n%s (limit %.4f)\n", ok ? "avalanche within noise" : "AVALANCHE BIAS ABOVE NOISE", limit);
+    free(buf);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+// http_load - wrk-style HTTP/1.1 load generator for benchmarking http.serve
+//
+// Usage: http_load [-c connections] [-t threads] [-d seconds] [-p pipeline] http://host:port/path
+//
+// Each thread drives its share of keep-alive connections from its own epoll
+// loop, keeping `pipeline` requests in flight per connection, and records
+// every response latency in a log-linear histogram. Reports req/s,
+// transfer rate and latency percentiles (p50/p90/p99/max).
+//
+// Build: make -C tools http_load   (Linux only)
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define MAX_PIPELINE 64
+#define RECV_BUFFER (64 * 1024)
+
+// Histogram: 64 sub-buckets per power of two of microseconds (~1.5% error)
+#define HIST_SUB 64
+#define HIST_POW 40
+#define HIST_SIZE (HIST_SUB * HIST_POW)
+
+typedef struct {
+    char host[256];
+    char port[16];
+    char path[1024];
+    int connections;
+    int threads;
+    int duration;
+    int pipeline;
+} Config;
+
+typedef struct {
+    int fd;
+    char *buf;
+    size_t len;
+    uint64_t sent_at[MAX_PIPELINE];     // Ring of in-flight request send times
+    int head, inflight;
+    size_t req_off;                     // Partial write offset into the request batch
+} Conn;
+
+typedef struct {
+    pthread_t tid;
+    int conn_count;
+    uint64_t requests;
+    uint64_t bytes;
+    uint64_t errors;
+    uint64_t hist[HIST_SIZE];
+} Worker;
+
+static Config cfg;
+static struct addrinfo *target;
+static char *request;
+static size_t request_len;
+static volatile bool stop_flag;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static int hist_index(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;
+    int exp = 63 - __builtin_clzll(v);                  // floor(log2 v) >= 6
+    int shift = exp - 6;                                // keep 7 significant bits
+    int idx = (exp - 5) * HIST_SUB + (int)((v >> shift) - HIST_SUB);
+    return idx < HIST_SIZE ? idx : HIST_SIZE - 1;
+}
+
+static uint64_t hist_value(int idx) {
+    if (idx < HIST_SUB) return (uint64_t)idx;
+    int block = idx / HIST_SUB;
+    return ((uint64_t)(idx % HIST_SUB) + HIST_SUB) << (block - 1);
+}
+
+static int connect_one(void) {
+    int fd = socket(target->ai_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, target->ai_addr, target->ai_addrlen) != 0 && errno != EINPROGRESS) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Length of one complete response at buf, 0 if incomplete, -1 if malformed
+static long response_length(const char *buf, size_t len) {
+    const char *end = memmem(buf, len, "\r\n\r\n", 4);
+    if (!end) return 0;
+    size_t head = (size_t)(end - buf) + 4;
+
+    const char *cl = memmem(buf, head, "Content-Length:", 15);
+    if (cl) {
+        size_t body = strtoull(cl + 15, NULL, 10);
+        return len - head >= body ? (long)(head + body) : 0;
+    }
+    if (memmem(buf, head, "chunked", 7)) {
+        const char *term = memmem(buf + head, len - head, "0\r\n\r\n", 5);
+        return term ? (long)(term + 5 - buf) : 0;
+    }
+    return -1;
+}
+
+static bool conn_send(Conn *c, int pipeline) {
+    // Top the connection up to `pipeline` requests in flight
+    while (c->inflight < pipeline || c->req_off) {
+        ssize_t n = write(c->fd, request + c->req_off, request_len - c->req_off);
+        if (n < 0) return errno == EAGAIN;
+        if (!c->req_off) {
+            c->sent_at[(c->head + c->inflight) % MAX_PIPELINE] = now_us();
+            c->inflight++;
+        }
+        c->req_off += (size_t)n;
+        if (c->req_off < request_len) return true;      // wait for EPOLLOUT
+        c->req_off = 0;
+    }
+    return true;
+}
+
+static bool conn_recv(Worker *w, Conn *c) {
+    for (;;) {
+        ssize_t n = read(c->fd, c->buf + c->len, RECV_BUFFER - c->len);
+        if (n == 0) return false;
+        if (n < 0) return errno == EAGAIN;
+        c->len += (size_t)n;
+        w->bytes += (uint64_t)n;
+
+        size_t pos = 0;
+        for (;;) {
+            long r = response_length(c->buf + pos, c->len - pos);
+            if (r < 0) return false;
+            if (r == 0) break;
+            pos += (size_t)r;
+            if (c->inflight > 0) {
+                uint64_t lat = now_us() - c->sent_at[c->head];
+                c->head = (c->head + 1) % MAX_PIPELINE;
+                c->inflight--;
+                w->hist[hist_index(lat)]++;
+                w->requests++;
+            }
+        }
+        memmove(c->buf, c->buf + pos, c->len - pos);
+        c->len -= pos;
+        if (c->len == RECV_BUFFER) return false;    // response larger than buffer
+    }
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = (Worker *)arg;
+    int ep = epoll_create1(0);
+    Conn *conns = calloc((size_t)w->conn_count, sizeof(Conn));
+
+    for (int i = 0; i < w->conn_count; i++) {
+        conns[i].fd = connect_one();
+        conns[i].buf = malloc(RECV_BUFFER);
+        if (conns[i].fd < 0) { w->errors++; continue; }
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLET, .data.ptr = &conns[i] };
+        epoll_ctl(ep, EPOLL_CTL_ADD, conns[i].fd, &ev);
+    }
+
+    struct epoll_event events[256];
+    while (!stop_flag) {
+        int n = epoll_wait(ep, events, 256, 100);
+        for (int i = 0; i < n; i++) {
+            Conn *c = (Conn *)events[i].data.ptr;
+            if (c->fd < 0) continue;
+            bool ok = true;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) ok = conn_recv(w, c);
+            if (ok) ok = conn_send(c, cfg.pipeline);
+            if (!ok) {
+                // Reconnect so a closing server does not end the run early
+                w->errors++;
+                epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+                close(c->fd);
+                c->len = 0; c->head = 0; c->inflight = 0; c->req_off = 0;
+                c->fd = connect_one();
+                if (c->fd < 0) continue;
+                struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLET, .data.ptr = c };
+                epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev);
+            }
+        }
+    }
+
+    for (int i = 0; i < w->conn_count; i++) {
+        if (conns[i].fd >= 0) close(conns[i].fd);
+        free(conns[i].buf);
+    }
+    free(conns);
+    close(ep);
+    return NULL;
+}
+
+static bool parse_url(const char *url) {
+    const char *p = url;
+    if (strncmp(p, "http://", 7) == 0) p += 7;
+    const char *slash = strchr(p, '/');
+    const char *hostend = slash ? slash : p + strlen(p);
+    const char *colon = memchr(p, ':', (size_t)(hostend - p));
+    size_t hlen = (size_t)((colon ? colon : hostend) - p);
+    if (hlen == 0 || hlen >= sizeof(cfg.host)) return false;
+    memcpy(cfg.host, p, hlen);
+    cfg.host[hlen] = '\0';
+    if (colon) snprintf(cfg.port, sizeof(cfg.port), "%.*s", (int)(hostend - colon - 1), colon + 1);
+    else strcpy(cfg.port, "80");
+    snprintf(cfg.path, sizeof(cfg.path), "%s", slash ? slash : "/");
+    return true;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: http_load [-c connections] [-t threads] [-d seconds] [-p pipeline] http://host:port/path\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    cfg.connections = 64;
+    cfg.threads = 2;
+    cfg.duration = 10;
+    cfg.pipeline = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:t:d:p:")) != -1) {
+        switch (opt) {
+        case 'c': cfg.connections = atoi(optarg); break;
+        case 't': cfg.threads = atoi(optarg); break;
+        case 'd': cfg.duration = atoi(optarg); break;
+        case 'p': cfg.pipeline = atoi(optarg); break;
+        default: usage();
+        }
+    }
+    if (optind >= argc || !parse_url(argv[optind])) usage();
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.connections < cfg.threads) cfg.connections = cfg.threads;
+    if (cfg.pipeline < 1) cfg.pipeline = 1;
+    if (cfg.pipeline > MAX_PIPELINE) cfg.pipeline = MAX_PIPELINE;
+
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    if (getaddrinfo(cfg.host, cfg.port, &hints, &target) != 0) {
+        fprintf(stderr, "http_load: cannot resolve %s:%s\n", cfg.host, cfg.port);
+        return 1;
+    }
+
+    request_len = (size_t)snprintf(NULL, 0, "GET %s HTTP/1.1\r\nHost: %s:%s\r\n\r\n", cfg.path, cfg.host, cfg.port);
+    request = malloc(request_len + 1);
+    snprintf(request, request_len + 1, "GET %s HTTP/1.1\r\nHost: %s:%s\r\n\r\n", cfg.path, cfg.host, cfg.port);
+
+    printf("Running %ds test @ http://%s:%s%s\n", cfg.duration, cfg.host, cfg.port, cfg.path);
+    printf("  %d threads, %d connections, pipeline %d\n", cfg.threads, cfg.connections, cfg.pipeline);
+
+    Worker *workers = calloc((size_t)cfg.threads, sizeof(Worker));
+    for (int i = 0; i < cfg.threads; i++) {
+        workers[i].conn_count = cfg.connections / cfg.threads + (i < cfg.connections % cfg.threads);
+        pthread_create(&workers[i].tid, NULL, worker_main, &workers[i]);
+    }
+
+    uint64_t t0 = now_us();
+    sleep((unsigned)cfg.duration);
+    stop_flag = true;
+    for (int i = 0; i < cfg.threads; i++) pthread_join(workers[i].tid, NULL);
+    double secs = (double)(now_us() - t0) / 1e6;
+
+    uint64_t requests = 0, bytes = 0, errors = 0;
+    static uint64_t hist[HIST_SIZE];
+    for (int i = 0; i < cfg.threads; i++) {
+        requests += workers[i].requests;
+        bytes += workers[i].bytes;
+        errors += workers[i].errors;
+        for (int b = 0; b < HIST_SIZE; b++) hist[b] += workers[i].hist[b];
+    }
+
+    double pct[] = { 50.0, 90.0, 99.0, 100.0 };
+    const char *names[] = { "p50", "p90", "p99", "max" };
+    printf("  Latency:\n");
+    for (int k = 0; k < 4; k++) {
+        uint64_t want = (uint64_t)((double)requests * pct[k] / 100.0 + 0.5), seen = 0;
+        if (want == 0) want = 1;
+        int b = 0;
+        for (; b < HIST_SIZE; b++) {
+            seen += hist[b];
+            if (seen >= want) break;
+        }
+        printf("    %-4s %10.3f ms\n", names[k], requests ? (double)hist_value(b < HIST_SIZE ? b : HIST_SIZE - 1) / 1000.0 : 0.0);
+    }
+    printf("  %llu requests in %.2fs, %.2f MB read, %llu errors\n",
+           (unsigned long long)requests, secs, (double)bytes / (1024.0 * 1024.0), (unsigned long long)errors);
+    printf("Requests/sec: %12.2f\n", (double)requests / secs);
+    printf("Transfer/sec: %10.2f MB\n", (double)bytes / (1024.0 * 1024.0) / secs);
+
+    freeaddrinfo(target);
+    free(request);
+    free(workers);
+    return 0;
+}
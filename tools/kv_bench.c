@@ -0,0 +1,294 @@
+// kv_bench - YCSB-style workloads against the embedded kv store
+//
+// Usage: kv_bench [-n records] [-o ops] [-s sync_every] [-f file]
+//
+// Loads -n (default 200k) records, keys "user" + 19 digits of a hashed id
+// as in YCSB, values of 100-1000 bytes, 1000 per transaction. Then runs
+// -o (default 200k) operations of each core workload on zipfian-chosen
+// keys (theta 0.99, scrambled):
+//   A  50% read, 50% update        B  95% read, 5% update
+//   C  100% read                   E  95% scan of 1-100 keys, 5% insert
+//   F  50% read, 50% read-modify-write
+// Every update or insert is its own write transaction; durability is
+// batched -s (default 64) commits per fsync. A short run of A with an
+// fsync per commit shows what batching buys, and the baseline is the
+// simplest durable store a script could write: the whole data set
+// rewritten and fsynced per update. Reads check the value they get.
+//
+// Build: make -C tools kv_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "kv_store.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static uint64_t fnv64(uint64_t v) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < 8; i++) {
+        h = (h ^ (v & 0xff)) * 0x100000001b3ULL;
+        v >>= 8;
+    }
+    return h;
+}
+
+// ========== ZIPFIAN ==========
+
+// Gray et al., "Quickly Generating Billion-Record Synthetic Databases",
+// as in YCSB's ZipfianGenerator; items are scrambled by hashing so the
+// hot keys are spread over the key space
+typedef struct {
+    uint64_t items;
+    double theta, alpha, zetan, eta;
+} Zipf;
+
+static double zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++) sum += 1.0 / pow((double)i, theta);
+    return sum;
+}
+
+static void zipf_init(Zipf *z, uint64_t items, double theta) {
+    z->items = items;
+    z->theta = theta;
+    z->zetan = zeta(items, theta);
+    z->alpha = 1.0 / (1.0 - theta);
+    z->eta = (1.0 - pow(2.0 / (double)items, 1.0 - theta)) / (1.0 - zeta(2, theta) / z->zetan);
+}
+
+static uint64_t zipf_next(const Zipf *z, uint64_t items) {
+    double u = (double)(next_random() >> 11) / 9007199254740992.0;
+    double uz = u * z->zetan;
+    uint64_t rank;
+    if (uz < 1.0) rank = 0;
+    else if (uz < 1.0 + pow(0.5, z->theta)) rank = 1;
+    else rank = (uint64_t)((double)z->items * pow(z->eta * u - z->eta + 1.0, z->alpha));
+    return fnv64(rank) % items;
+}
+
+// ========== RECORDS ==========
+
+static int make_key(uint64_t id, char *out) {
+    return snprintf(out, 32, "user%019llu", (unsigned long long)(fnv64(id) % 10000000000000000000ULL));
+}
+
+// Value bytes are a function of (id, version) so reads can be checked
+static size_t make_value(uint64_t id, uint32_t version, char *out) {
+    size_t length = 100 + fnv64(id ^ ((uint64_t)version << 40)) % 901;
+    for (size_t i = 0; i < length; i++) out[i] = (char)('a' + (id + version + i) % 26);
+    memcpy(out, &version, 4);
+    return length;
+}
+
+typedef struct {
+    KvStore *store;
+    uint32_t *versions;     // per record, for checking reads
+    uint64_t records;
+    char value[1024];
+    size_t errors;
+} Bench;
+
+static void do_read(Bench *b, uint64_t id) {
+    char key[32];
+    int n = make_key(id, key);
+    KvTxn *txn = kv_begin(b->store, false);
+    KvView v;
+    uint32_t version;
+    if (!kv_get(txn, key, (size_t)n, &v) || v.length < 4) b->errors++;
+    else if (memcpy(&version, v.data, 4), version != b->versions[id]) b->errors++;
+    kv_commit(txn);
+}
+
+static void do_write(Bench *b, uint64_t id, uint32_t version) {
+    char key[32];
+    int n = make_key(id, key);
+    size_t length = make_value(id, version, b->value);
+    KvTxn *txn = kv_begin(b->store, true);
+    if (!kv_put(txn, key, (size_t)n, b->value, length) || !kv_commit(txn)) b->errors++;
+    else b->versions[id] = version;
+}
+
+static void do_read_modify_write(Bench *b, uint64_t id) {
+    char key[32];
+    int n = make_key(id, key);
+    KvTxn *txn = kv_begin(b->store, true);
+    KvView v;
+    uint32_t version = 0;
+    if (kv_get(txn, key, (size_t)n, &v) && v.length >= 4) memcpy(&version, v.data, 4);
+    size_t length = make_value(id, version + 1, b->value);
+    if (!kv_put(txn, key, (size_t)n, b->value, length) || !kv_commit(txn)) b->errors++;
+    else b->versions[id] = version + 1;
+}
+
+static size_t do_scan(Bench *b, uint64_t id, size_t count) {
+    char key[32];
+    int n = make_key(id, key);
+    KvTxn *txn = kv_begin(b->store, false);
+    KvCursor *cursor = kv_cursor_open(txn, key, (size_t)n);
+    KvView k, v;
+    size_t seen = 0, bytes = 0;
+    while (seen < count && kv_cursor_next(cursor, &k, &v)) {
+        bytes += v.length;
+        seen++;
+    }
+    kv_cursor_close(cursor);
+    kv_commit(txn);
+    return bytes;
+}
+
+static void report(const char *name, size_t ops, double seconds) {
+    printf("%-24s %10.0f ops/s %10.2f us/op\n", name, (double)ops / seconds, seconds / (double)ops * 1e6);
+}
+
+int main(int argc, char **argv) {
+    uint64_t records = 200000;
+    size_t ops = 200000;
+    unsigned sync_every = 64;
+    const char *path = "kv_bench.db";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) records = (uint64_t)atoll(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) ops = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) sync_every = (unsigned)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) path = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [-n records] [-o ops] [-s sync_every] [-f file]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (records < 2) records = 2;
+
+    unlink(path);
+    KvOptions options = { 0, sync_every };
+    Bench b = { kv_open(path, &options), NULL, records, { 0 }, 0 };
+    uint64_t capacity = records + ops;     // room for E's inserts
+    b.versions = calloc(capacity, sizeof(uint32_t));
+    if (!b.store || !b.versions) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+
+    // Load
+    double start = now_sec();
+    size_t load_bytes = 0;
+    for (uint64_t id = 0; id < records;) {
+        KvTxn *txn = kv_begin(b.store, true);
+        for (uint64_t end = id + 1000 < records ? id + 1000 : records; id < end; id++) {
+            char key[32];
+            int n = make_key(id, key);
+            size_t length = make_value(id, 0, b.value);
+            load_bytes += length;
+            if (!kv_put(txn, key, (size_t)n, b.value, length)) b.errors++;
+        }
+        if (!kv_commit(txn)) b.errors++;
+    }
+    kv_sync(b.store);
+    double load = now_sec() - start;
+    KvStat st;
+    kv_stat(b.store, &st);
+    printf("load %llu records (%.0f MB of values) in %.2f s: %.0f records/s, depth %u, file %.0f MB\n",
+           (unsigned long long)records, (double)load_bytes / 1e6, load, (double)records / load, st.depth,
+           (double)st.pages * KV_PAGE_SIZE / 1e6);
+
+    Zipf zipf;
+    zipf_init(&zipf, records, 0.99);
+
+    // A, B, C, F: reads and updates of existing records
+    struct { const char *name; unsigned reads, rmw; } mixes[] = {
+        { "A (50 read/50 update)", 50, 0 },
+        { "B (95 read/5 update)", 95, 0 },
+        { "C (read only)", 100, 0 },
+        { "F (50 read/50 rmw)", 50, 50 },
+    };
+    for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); m++) {
+        start = now_sec();
+        for (size_t i = 0; i < ops; i++) {
+            uint64_t id = zipf_next(&zipf, records);
+            unsigned r = (unsigned)(next_random() % 100);
+            if (r < mixes[m].reads) do_read(&b, id);
+            else if (mixes[m].rmw) do_read_modify_write(&b, id);
+            else do_write(&b, id, b.versions[id] + 1);
+        }
+        kv_sync(b.store);
+        report(mixes[m].name, ops, now_sec() - start);
+    }
+
+    // E: short scans from zipfian keys, inserts of new records
+    uint64_t next_id = records;
+    size_t scanned = 0;
+    start = now_sec();
+    for (size_t i = 0; i < ops; i++) {
+        if (next_random() % 100 < 95) {
+            scanned += do_scan(&b, zipf_next(&zipf, next_id), 1 + next_random() % 100);
+        } else {
+            do_write(&b, next_id, 0);
+            next_id++;
+        }
+    }
+    kv_sync(b.store);
+    double seconds = now_sec() - start;
+    report("E (95 scan/5 insert)", ops, seconds);
+    printf("%-24s %.0f MB/s of values scanned\n", "", (double)scanned / seconds / 1e6);
+
+    // A with one fsync per commit
+    kv_close(b.store);
+    options.sync_every = 1;
+    b.store = kv_open(path, &options);
+    size_t strict_ops = ops / 100 > 100 ? ops / 100 : 100;
+    start = now_sec();
+    for (size_t i = 0; i < strict_ops; i++) {
+        uint64_t id = zipf_next(&zipf, records);
+        if (next_random() % 2) do_read(&b, id);
+        else do_write(&b, id, b.versions[id] + 1);
+    }
+    double strict = now_sec() - start;
+    report("A, fsync per commit", strict_ops, strict);
+    kv_stat(b.store, &st);
+    printf("file %.0f MB, %llu free pages, %llu entries\n", (double)st.pages * KV_PAGE_SIZE / 1e6,
+           (unsigned long long)st.free_pages, (unsigned long long)st.entries);
+    kv_close(b.store);
+    unlink(path);
+
+    // Baseline: rewrite and fsync the whole data set per update
+    char *image = malloc(load_bytes + records * 32);
+    if (image) {
+        size_t length = 0;
+        for (uint64_t id = 0; id < records; id++) {
+            length += (size_t)make_key(id, image + length);
+            length += make_value(id, b.versions[id], image + length);
+        }
+        size_t rewrites = 5;
+        start = now_sec();
+        for (size_t i = 0; i < rewrites; i++) {
+            int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0 || write(fd, image, length) != (ssize_t)length || fdatasync(fd) != 0) b.errors++;
+            if (fd >= 0) close(fd);
+        }
+        double rewrite = now_sec() - start;
+        report("baseline: rewrite file", rewrites, rewrite);
+        free(image);
+        unlink(path);
+    }
+
+    free(b.versions);
+    if (b.errors) printf("%zu ERRORS\n", b.errors);
+    return b.errors ? 1 : 0;
+}
@@ -0,0 +1,169 @@
+// log_bench - asynchronous logging through src/logger.c
+//
+// Usage: log_bench [-n lines] [-t threads] [-o path]
+//
+// Writes lines (default 1M per thread) of the form
+//   2026-10-18T09:30:00.125Z INFO  request 42 took 3.5 ms from worker-1
+// to path (default /tmp/log_bench.log, truncated first) three ways:
+//   fprintf     format with a timestamp and fprintf + fflush per line,
+//               what a print-based logger costs
+//   write       format into a buffer and one write() per line
+//   logger      logger_write into the per-thread ring; reports the time
+//               the callers spent and the time until logger_flush
+//               returned, with the written and dropped counts. A caller
+//               that outruns the writer thread fills its ring and drops
+//               lines, so this is run twice: flat out, and flushing
+//               every 10000 lines, which drops nothing and measures
+//               what the writer thread sustains
+// Threads (default 1) each log their own lines; the synchronous ways
+// share the file through the stdio lock or O_APPEND.
+//
+// Build: make -C tools log_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "logger.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static size_t lines = 1000000;
+static size_t flush_every;
+static FILE *file;
+static int fd;
+
+// The synchronous loggers format the timestamp on every line
+static int format_line(char *buf, size_t size, size_t i, long worker) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    struct tm tm;
+    gmtime_r(&ts.tv_sec, &tm);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tm);
+    return snprintf(buf, size, "%s.%03ldZ INFO  request %zu took %.1f ms from worker-%ld\n", stamp,
+                    ts.tv_nsec / 1000000, i, (double)(i % 100) / 10, worker);
+}
+
+static void *run_fprintf(void *arg) {
+    long worker = (long)arg;
+    char buf[256];
+    for (size_t i = 0; i < lines; i++) {
+        format_line(buf, sizeof(buf), i, worker);
+        fputs(buf, file);
+        fflush(file);
+    }
+    return NULL;
+}
+
+static void *run_write(void *arg) {
+    long worker = (long)arg;
+    char buf[256];
+    for (size_t i = 0; i < lines; i++) {
+        int n = format_line(buf, sizeof(buf), i, worker);
+        if (write(fd, buf, (size_t)n) != n) break;
+    }
+    return NULL;
+}
+
+static void *run_logger(void *arg) {
+    long worker = (long)arg;
+    char name[32];
+    int name_length = snprintf(name, sizeof(name), "worker-%ld", worker);
+    static const char format[] = "request {} took {} ms from {}";
+    for (size_t i = 0; i < lines; i++) {
+        LoggerArg args[3] = {
+            { LOGGER_ARG_NUMBER, { .number = (double)i } },
+            { LOGGER_ARG_NUMBER, { .number = (double)(i % 100) / 10 } },
+            { LOGGER_ARG_STRING, { .string = { name, (size_t)name_length } } },
+        };
+        logger_write(LOGGER_INFO, format, sizeof(format) - 1, args, 3);
+        if (flush_every && (i + 1) % flush_every == 0) logger_flush();
+    }
+    return NULL;
+}
+
+static double run(void *(*fn)(void *), int threads) {
+    pthread_t tids[64];
+    double start = now_sec();
+    for (long t = 0; t < threads; t++) pthread_create(&tids[t], NULL, fn, (void *)t);
+    for (int t = 0; t < threads; t++) pthread_join(tids[t], NULL);
+    return now_sec() - start;
+}
+
+static void report(const char *how, size_t count, double seconds) {
+    printf("%-16s %9.1f ms %9.2f M lines/s %7.1f ns/line\n", how, seconds * 1e3, (double)count / seconds / 1e6,
+           seconds * 1e9 / (double)count);
+}
+
+int main(int argc, char **argv) {
+    int threads = 1;
+    const char *path = "/tmp/log_bench.log";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) lines = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) path = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [-n lines] [-t threads] [-o path]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (threads > 64) threads = 64;
+    size_t total = lines * (size_t)threads;
+    printf("%zu lines, %d thread%s, to %s\n", total, threads, threads == 1 ? "" : "s", path);
+
+    file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    report("fprintf+fflush", total, run(run_fprintf, threads));
+    fclose(file);
+
+    fd = open(path, O_WRONLY | O_TRUNC | O_APPEND);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    report("write", total, run(run_write, threads));
+    close(fd);
+
+    // Truncate, then hand the file to the logger
+    fclose(fopen(path, "w"));
+    if (!logger_open(path)) {
+        perror(path);
+        return 1;
+    }
+    int failures = 0;
+    for (int paced = 0; paced < 2; paced++) {
+        flush_every = paced ? 10000 : 0;
+        LoggerStats before, after;
+        logger_stats(&before);
+        double start = now_sec();
+        double callers = run(run_logger, threads);
+        logger_flush();
+        double seconds = now_sec() - start;
+        logger_stats(&after);
+        printf("%s:\n", paced ? "logger, flushing every 10000 lines" : "logger, flat out");
+        report("  callers", total, callers);
+        report("  flushed", total, seconds);
+        uint64_t written = after.written - before.written, dropped = after.dropped - before.dropped;
+        printf("  written %llu, dropped %llu, %.1f MB in %llu writev calls\n", (unsigned long long)written,
+               (unsigned long long)dropped, (double)(after.bytes - before.bytes) / 1e6,
+               (unsigned long long)(after.writes - before.writes));
+        if (written + dropped != total || (paced && dropped)) failures++;
+    }
+    logger_shutdown();
+    if (failures) printf("FAILED: lines lost or dropped while paced\n");
+    return failures;
+}
@@ -0,0 +1,234 @@
+// math_bench - whole-array math through src/vec_math.c
+//
+// Usage: math_bench [-n count] [-m size]
+//
+// For exp, log, sin and cos, first measures the AVX2 kernel's error in
+// ULP against long double libm over several input ranges, then times
+// every elementwise function on count values (default 10M) three ways:
+//   loop        one libm call per element, what a script loop costs
+//               before interpreter overhead
+//   avx2        the SIMD kernel on one thread
+//   parallel    vec_map, chunked across the shared thread pool
+// then sum and dot the same way, and an m x m matmul (default 512)
+// against the textbook triple loop.
+//
+// Build: make -C tools math_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "vec_math.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double uniform(double lo, double hi) {
+    return lo + (hi - lo) * (double)(next_random() >> 11) * 0x1.0p-53;
+}
+
+static const char *op_names[] = { "sqrt", "abs", "floor", "ceil", "exp", "log", "sin", "cos" };
+
+static long double reference(VecOp op, double x) {
+    switch (op) {
+        case VEC_EXP: return expl(x);
+        case VEC_LOG: return logl(x);
+        case VEC_SIN: return sinl(x);
+        case VEC_COS: return cosl(x);
+        default: return x;
+    }
+}
+
+// Largest error over n inputs uniform in [lo, hi] (e^x for x uniform there
+// with log_scale), in units of the last place of the rounded result
+static double max_ulp(VecOp op, double lo, double hi, bool log_scale, size_t n, double *in, double *out) {
+    for (size_t i = 0; i < n; i++) in[i] = log_scale ? exp(uniform(lo, hi)) : uniform(lo, hi);
+    vec_map(op, in, out, n);
+    double worst = 0;
+    for (size_t i = 0; i < n; i++) {
+        long double ref = reference(op, in[i]);
+        double rounded = (double)ref;
+        if (isinf(rounded) || rounded == 0) continue;
+        double ulp = nextafter(fabs(rounded), INFINITY) - fabs(rounded);
+        double err = (double)(fabsl((long double)out[i] - ref) / ulp);
+        if (err > worst) worst = err;
+    }
+    return worst;
+}
+
+static void accuracy(size_t n) {
+    struct {
+        VecOp op;
+        double lo, hi;
+        bool log_scale;
+    } ranges[] = {
+        { VEC_EXP, -1, 1, false },      { VEC_EXP, -700, 700, false }, { VEC_EXP, -744, -708, false },
+        { VEC_LOG, 0.5, 2, false },     { VEC_LOG, -690, 690, true },  { VEC_LOG, -744, -708, true },
+        { VEC_SIN, -3.2, 3.2, false },  { VEC_SIN, -1e6, 1e6, false }, { VEC_SIN, -1e-3, 1e-3, false },
+        { VEC_COS, -3.2, 3.2, false },  { VEC_COS, -1e6, 1e6, false },
+    };
+    double *in = malloc(n * sizeof(double)), *out = malloc(n * sizeof(double));
+    if (!in || !out) exit(1);
+    printf("max error (%s), %zu inputs per range\n", vec_isa(), n);
+    for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+        double ulp = max_ulp(ranges[r].op, ranges[r].lo, ranges[r].hi, ranges[r].log_scale, n, in, out);
+        char range[64];
+        snprintf(range, sizeof(range), "%s[%g, %g]", ranges[r].log_scale ? "e^" : "", ranges[r].lo, ranges[r].hi);
+        printf("  %-4s %-20s %.3f ulp\n", op_names[ranges[r].op], range, ulp);
+    }
+    // Special values
+    double special[] = { NAN, INFINITY, -INFINITY, 0.0, -0.0, -1.0, 1e308, 4e-320 };
+    size_t count = sizeof(special) / sizeof(special[0]);
+    int mismatches = 0;
+    for (int op = VEC_EXP; op <= VEC_COS; op++) {
+        double got[8];
+        vec_map((VecOp)op, special, got, count);
+        for (size_t i = 0; i < count; i++) {
+            double want = (double)reference((VecOp)op, special[i]);
+            bool same = (isnan(want) && isnan(got[i])) || (want == got[i] && signbit(want) == signbit(got[i])) ||
+                        (want != 0 && fabs(got[i] - want) <= 2 * (nextafter(fabs(want), INFINITY) - fabs(want)));
+            if (!same) {
+                printf("  %s(%g) = %g, want %g\n", op_names[op], special[i], got[i], want);
+                mismatches++;
+            }
+        }
+    }
+    printf("  special values: %s\n", mismatches ? "MISMATCH" : "ok");
+    free(in);
+    free(out);
+}
+
+static void report(const char *name, const char *how, size_t count, double seconds) {
+    printf("%-6s %-9s %8.1f ms %9.1f M/s\n", name, how, seconds * 1e3, (double)count / seconds / 1e6);
+}
+
+// One thread: call the kernel on one chunk-sized piece at a time
+static void map_one_thread(VecOp op, const double *in, double *out, size_t n) {
+    for (size_t i = 0; i < n; i += VEC_CHUNK) vec_map(op, in + i, out + i, n - i < VEC_CHUNK ? n - i : VEC_CHUNK);
+}
+
+int main(int argc, char **argv) {
+    size_t count = 10000000, size = 512;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) count = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) size = (size_t)atol(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-n count] [-m size]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count == 0) count = 1;
+    const char *best = vec_isa();
+    accuracy(1000000);
+
+    double *in = malloc(count * sizeof(double)), *out = malloc(count * sizeof(double));
+    double *other = malloc(count * sizeof(double));
+    if (!in || !out || !other) return 1;
+    for (size_t i = 0; i < count; i++) {
+        in[i] = uniform(0.001, 50);
+        other[i] = uniform(-1, 1);
+    }
+    memset(out, 0, count * sizeof(double));
+
+    printf("\n%zu values\n", count);
+    for (int op = VEC_SQRT; op <= VEC_COS; op++) {
+        vec_select("scalar");
+        double start = now_sec();
+        map_one_thread((VecOp)op, in, out, count);
+        report(op_names[op], "loop", count, now_sec() - start);
+        vec_select(best);
+        start = now_sec();
+        map_one_thread((VecOp)op, in, out, count);
+        report(op_names[op], best, count, now_sec() - start);
+        start = now_sec();
+        vec_map((VecOp)op, in, out, count);
+        report(op_names[op], "parallel", count, now_sec() - start);
+    }
+
+    double sums[3], start;
+    const char *hows[] = { "loop", best, "parallel" };
+    for (int way = 0; way < 3; way++) {
+        vec_select(way == 0 ? "scalar" : best);
+        start = now_sec();
+        if (way < 2) {
+            sums[way] = 0;
+            for (size_t i = 0; i < count; i += VEC_CHUNK) {
+                sums[way] += vec_sum(in + i, count - i < VEC_CHUNK ? count - i : VEC_CHUNK);
+            }
+        } else {
+            sums[way] = vec_sum(in, count);
+        }
+        report("sum", hows[way], count, now_sec() - start);
+    }
+    for (int way = 0; way < 3; way++) {
+        vec_select(way == 0 ? "scalar" : best);
+        start = now_sec();
+        double d = 0;
+        if (way < 2) {
+            for (size_t i = 0; i < count; i += VEC_CHUNK) {
+                d += vec_dot(in + i, other + i, count - i < VEC_CHUNK ? count - i : VEC_CHUNK);
+            }
+        } else {
+            d = vec_dot(in, other, count);
+        }
+        report("dot", hows[way], count, now_sec() - start);
+        if (way == 2) printf("(sum %.6f / %.6f / %.6f, dot %.6f)\n", sums[0], sums[1], sums[2], d);
+    }
+
+    // matmul: textbook i-j-k triple loop vs the kernel
+    size_t m = size;
+    double *a = malloc(m * m * sizeof(double)), *b = malloc(m * m * sizeof(double));
+    double *c = malloc(m * m * sizeof(double)), *naive = malloc(m * m * sizeof(double));
+    if (!a || !b || !c || !naive) return 1;
+    for (size_t i = 0; i < m * m; i++) {
+        a[i] = uniform(-1, 1);
+        b[i] = uniform(-1, 1);
+    }
+    double flops = 2.0 * (double)m * (double)m * (double)m;
+    start = now_sec();
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < m; j++) {
+            double s = 0;
+            for (size_t k = 0; k < m; k++) s += a[i * m + k] * b[k * m + j];
+            naive[i * m + j] = s;
+        }
+    }
+    double seconds = now_sec() - start;
+    printf("matmul %zux%zu triple loop %8.1f ms %6.2f GFLOP/s\n", m, m, seconds * 1e3, flops / seconds / 1e9);
+    int failures = 0;
+    for (int way = 0; way < 2; way++) {
+        vec_select(way == 0 ? "scalar" : best);
+        start = now_sec();
+        vec_matmul(a, b, c, m, m, m);
+        seconds = now_sec() - start;
+        double worst = 0;
+        for (size_t i = 0; i < m * m; i++) worst = fmax(worst, fabs(c[i] - naive[i]));
+        printf("matmul %zux%zu %-11s %8.1f ms %6.2f GFLOP/s (max diff %.2g)\n", m, m, way == 0 ? "scalar" : best,
+               seconds * 1e3, flops / seconds / 1e9, worst);
+        if (worst > 1e-9 * (double)m) failures++;
+    }
+    free(a);
+    free(b);
+    free(c);
+    free(naive);
+    free(in);
+    free(out);
+    free(other);
+    if (failures) printf("%d FAILED\n", failures);
+    return failures ? 1 : 0;
+}
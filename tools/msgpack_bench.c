@@ -0,0 +1,335 @@
+// msgpack_bench - binary serialization vs JSON text
+//
+// Usage: msgpack_bench [-n records] [-a array_values]
+//
+// Encodes -n (default 1M) records {id, name, price, tags[2], active} and a
+// packed array of -a (default 10M) doubles both as MessagePack documents
+// (src/msgpack.c) and as JSON, then decodes each back, summing numbers and
+// string lengths so every value is looked at. The JSON side is a tight
+// hand-written encoder (%.17g numbers, escaped strings) and a recursive
+// parser that unescapes strings and runs strtod, i.e. the cheapest text
+// round trip, not the json module. The MessagePack decoder walks the
+// document with the pull reader: strings are views into the buffer and the
+// packed array is read in place. Reports sizes and MB/s of each format's
+// own bytes.
+//
+// Build: make -C tools msgpack_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "msgpack.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static const char *words[] = {
+    "alpha", "bravo \"quoted\"", "charlie", "delta\\slash", "echo", "foxtrot", "golf", "hotel"
+};
+
+typedef struct {
+    int64_t id;
+    const char *name;
+    double price;
+    const char *tags[2];
+    bool active;
+} Record;
+
+// What a decoder saw: every number summed, every string measured
+typedef struct {
+    double numbers;
+    size_t strings;
+    size_t items;
+} Digest;
+
+// ========== JSON ==========
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} Text;
+
+static void text_reserve(Text *t, size_t extra) {
+    if (t->length + extra <= t->capacity) return;
+    while (t->length + extra > t->capacity) t->capacity = t->capacity ? t->capacity * 2 : 4096;
+    t->data = realloc(t->data, t->capacity);
+    if (!t->data) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+}
+
+static void text_put(Text *t, const char *s, size_t n) {
+    text_reserve(t, n);
+    memcpy(t->data + t->length, s, n);
+    t->length += n;
+}
+
+static void json_string(Text *t, const char *s) {
+    text_reserve(t, 2 * strlen(s) + 2);
+    t->data[t->length++] = '"';
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') t->data[t->length++] = '\\';
+        t->data[t->length++] = *s;
+    }
+    t->data[t->length++] = '"';
+}
+
+static void json_number(Text *t, double v) {
+    text_reserve(t, 32);
+    t->length += (size_t)snprintf(t->data + t->length, 32, "%.17g", v);
+}
+
+static void json_records(Text *t, const Record *records, size_t n) {
+    text_put(t, "[", 1);
+    for (size_t i = 0; i < n; i++) {
+        const Record *r = &records[i];
+        if (i) text_put(t, ",", 1);
+        text_put(t, "{\"id\":", 6);
+        json_number(t, (double)r->id);
+        text_put(t, ",\"name\":", 8);
+        json_string(t, r->name);
+        text_put(t, ",\"price\":", 9);
+        json_number(t, r->price);
+        text_put(t, ",\"tags\":[", 9);
+        json_string(t, r->tags[0]);
+        text_put(t, ",", 1);
+        json_string(t, r->tags[1]);
+        text_put(t, "],\"active\":", 11);
+        text_put(t, r->active ? "true" : "false", r->active ? 4 : 5);
+        text_put(t, "}", 1);
+    }
+    text_put(t, "]", 1);
+}
+
+static void json_array(Text *t, const double *values, size_t n) {
+    text_put(t, "[", 1);
+    for (size_t i = 0; i < n; i++) {
+        if (i) text_put(t, ",", 1);
+        json_number(t, values[i]);
+    }
+    text_put(t, "]", 1);
+}
+
+typedef struct {
+    const char *p;
+    const char *end;
+    char *scratch;
+} JsonParser;
+
+static void json_value(JsonParser *jp, Digest *d);
+
+static void json_skip_space(JsonParser *jp) {
+    while (jp->p < jp->end && (*jp->p == ' ' || *jp->p == '\n')) jp->p++;
+}
+
+static void json_parse_string(JsonParser *jp, Digest *d) {
+    jp->p++;
+    size_t n = 0;
+    while (*jp->p != '"') {
+        if (*jp->p == '\\') jp->p++;
+        jp->scratch[n++] = *jp->p++;
+    }
+    jp->p++;
+    d->strings += n;
+    d->items++;
+}
+
+static void json_value(JsonParser *jp, Digest *d) {
+    json_skip_space(jp);
+    char c = *jp->p;
+    if (c == '{' || c == '[') {
+        char close = c == '{' ? '}' : ']';
+        jp->p++;
+        json_skip_space(jp);
+        if (*jp->p == close) {
+            jp->p++;
+            return;
+        }
+        for (;;) {
+            if (c == '{') {
+                json_skip_space(jp);
+                json_parse_string(jp, d);
+                json_skip_space(jp);
+                jp->p++;    // ':'
+            }
+            json_value(jp, d);
+            json_skip_space(jp);
+            if (*jp->p++ == close) break;
+        }
+        d->items++;
+    } else if (c == '"') {
+        json_parse_string(jp, d);
+    } else if (c == 't' || c == 'f' || c == 'n') {
+        jp->p += c == 'f' ? 5 : 4;
+        d->items++;
+    } else {
+        char *end;
+        d->numbers += strtod(jp->p, &end);
+        jp->p = end;
+        d->items++;
+    }
+}
+
+static Digest json_decode(const char *data, size_t length, char *scratch) {
+    Digest d = { 0, 0, 0 };
+    JsonParser jp = { data, data + length, scratch };
+    json_value(&jp, &d);
+    return d;
+}
+
+// ========== MESSAGEPACK ==========
+
+static void mp_records(MpWriter *w, const Record *records, size_t n) {
+    mp_write_header(w);
+    mp_write_array(w, (uint32_t)n);
+    for (size_t i = 0; i < n; i++) {
+        const Record *r = &records[i];
+        mp_write_map(w, 5);
+        mp_write_str(w, "id", 2);
+        mp_write_int(w, r->id);
+        mp_write_str(w, "name", 4);
+        mp_write_str(w, r->name, strlen(r->name));
+        mp_write_str(w, "price", 5);
+        mp_write_number(w, r->price);
+        mp_write_str(w, "tags", 4);
+        mp_write_array(w, 2);
+        mp_write_str(w, r->tags[0], strlen(r->tags[0]));
+        mp_write_str(w, r->tags[1], strlen(r->tags[1]));
+        mp_write_str(w, "active", 6);
+        mp_write_bool(w, r->active);
+    }
+}
+
+static Digest mp_decode(const unsigned char *data, size_t length) {
+    Digest d = { 0, 0, 0 };
+    MpReader r;
+    mp_reader_init(&r, data, length);
+    unsigned version;
+    if (!mp_read_header(&r, &version)) return d;
+    MpItem item;
+    while (mp_read(&r, &item)) {
+        switch (item.kind) {
+            case MP_INT:
+            case MP_FLOAT:
+                d.numbers += item.number;
+                break;
+            case MP_STR:
+                d.strings += item.length;
+                break;
+            case MP_F64_ARRAY:
+                for (size_t i = 0; i < item.values_count; i++) d.numbers += item.values[i];
+                d.items += item.values_count;
+                break;
+            default:
+                break;
+        }
+        d.items++;
+    }
+    return d;
+}
+
+static void report(const char *what, const char *format, size_t bytes, double encode, double decode) {
+    printf("%-8s %-8s %12zu %10.1f %10.1f\n", what, format, bytes, (double)bytes / encode / 1e6,
+           (double)bytes / decode / 1e6);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 1000000, values = 10000000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) n = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) values = (size_t)atol(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-n records] [-a array_values]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Record *records = malloc(sizeof(Record) * (n ? n : 1));
+    double *array = malloc(sizeof(double) * (values ? values : 1));
+    char *scratch = malloc(1 << 16);
+    if (!records || !array || !scratch) return 1;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t r = next_random();
+        records[i] = (Record){ (int64_t)(r % 10000000), words[r & 7], (double)((r >> 8) % 100000) / 100.0,
+                               { words[(r >> 3) & 7], words[(r >> 6) & 7] }, (r >> 30) & 1 };
+    }
+    for (size_t i = 0; i < values; i++) array[i] = (double)(next_random() >> 11) / 9007199254740992.0;
+
+    printf("%-8s %-8s %12s %10s %10s\n", "data", "format", "bytes", "enc MB/s", "dec MB/s");
+    int failures = 0;
+
+    // Records
+    double start = now_sec();
+    Text text = { NULL, 0, 0 };
+    json_records(&text, records, n);
+    double json_encode = now_sec() - start;
+    start = now_sec();
+    Digest json_digest = json_decode(text.data, text.length, scratch);
+    double json_decode_time = now_sec() - start;
+    report("records", "json", text.length, json_encode, json_decode_time);
+    size_t json_bytes = text.length;
+
+    start = now_sec();
+    MpWriter w;
+    mp_writer_init(&w);
+    mp_records(&w, records, n);
+    double mp_encode = now_sec() - start;
+    start = now_sec();
+    Digest mp_digest = mp_decode(w.data, w.length);
+    double mp_decode_time = now_sec() - start;
+    report("records", "msgpack", w.length, mp_encode, mp_decode_time);
+    printf("         msgpack is %.0f%% of the JSON size; encode %.1fx, decode %.1fx faster per record\n",
+           100.0 * (double)w.length / (double)json_bytes, json_encode / mp_encode, json_decode_time / mp_decode_time);
+    // Keys are strings on both sides; JSON keys count too
+    if (mp_digest.strings != json_digest.strings || mp_digest.numbers != json_digest.numbers) failures++;
+    mp_writer_free(&w);
+    free(text.data);
+
+    // Packed array
+    text = (Text){ NULL, 0, 0 };
+    start = now_sec();
+    json_array(&text, array, values);
+    json_encode = now_sec() - start;
+    start = now_sec();
+    json_digest = json_decode(text.data, text.length, scratch);
+    json_decode_time = now_sec() - start;
+    report("array", "json", text.length, json_encode, json_decode_time);
+    json_bytes = text.length;
+
+    mp_writer_init(&w);
+    start = now_sec();
+    mp_write_header(&w);
+    mp_write_f64_array(&w, array, values);
+    mp_encode = now_sec() - start;
+    start = now_sec();
+    mp_digest = mp_decode(w.data, w.length);
+    mp_decode_time = now_sec() - start;
+    report("array", "msgpack", w.length, mp_encode, mp_decode_time);
+    printf("         msgpack is %.0f%% of the JSON size; encode %.1fx, decode %.1fx faster per value\n",
+           100.0 * (double)w.length / (double)json_bytes, json_encode / mp_encode, json_decode_time / mp_decode_time);
+    if (mp_digest.numbers != json_digest.numbers) failures++;
+    mp_writer_free(&w);
+    free(text.data);
+
+    free(records);
+    free(array);
+    free(scratch);
+    if (failures) printf("MISMATCH in %d round trips\n", failures);
+    return failures ? 1 : 0;
+}
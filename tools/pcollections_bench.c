@@ -0,0 +1,269 @@
+// pcollections_bench - RbPVector / RbPMap snapshots vs copying an RbList
+//
+// Usage: pcollections_bench [-n count] [-u updates] [-r rounds]
+//
+// Each workload holds n int values (default 100000) and performs u updates
+// (default 2000), taking a snapshot before every update and keeping the
+// last 16 snapshots alive as readers would:
+//   vector     random index writes
+//              pvector: set on the current version    list: copy + set
+//   map        random key writes over keys 0..2n (about half are inserts)
+//              pmap: set on the current version       list: sorted pairs,
+//                                                     copy + binary-search
+//                                                     insert / replace
+//   build      n appends into a fresh container
+//              builder: push + build                  pvector: n pushes
+//              (one version per push)
+// Prints ns per update (best of rounds) and checks that both sides produce
+// the same results.
+//
+// Build: make -C tools pcollections_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rb_list.h"
+#include "rb_pvector.h"
+#include "rb_pmap.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+#define KEEP 16     // snapshots kept alive at any time
+
+static size_t n, updates;
+static int64_t *slots;      // update targets
+static int64_t *values;
+
+static RbPVectorBuilder *vector_builder(void) {
+    RbPVector *empty = rb_pvector_new();
+    RbPVectorBuilder *builder = rb_pvector_builder(empty);
+    rb_pvector_release(empty);
+    return builder;
+}
+
+static RbPMapBuilder *map_builder(void) {
+    RbPMap *empty = rb_pmap_new();
+    RbPMapBuilder *builder = rb_pmap_builder(empty);
+    rb_pmap_release(empty);
+    return builder;
+}
+
+// Each workload returns a checksum so the two sides can be compared
+typedef uint64_t (*Workload)(void);
+
+// ========== VECTOR ==========
+
+static uint64_t vector_persistent(void) {
+    RbPVectorBuilder *builder = vector_builder();
+    for (size_t i = 0; i < n; i++) rb_pvector_builder_push(builder, rb_value_int((int64_t)i));
+    RbPVector *current = rb_pvector_build(builder);
+    RbPVector *kept[KEEP] = { NULL };
+    for (size_t u = 0; u < updates; u++) {
+        rb_pvector_release(kept[u % KEEP]);
+        kept[u % KEEP] = rb_pvector_retain(current);
+        RbPVector *next = rb_pvector_set(current, (size_t)slots[u] % n, rb_value_int(values[u]));
+        rb_pvector_release(current);
+        current = next;
+    }
+    uint64_t sum = 0;
+    RbPVectorIter it = rb_pvector_iter(current);
+    RbValue value;
+    while (rb_pvector_next(&it, &value)) sum = sum * 31 + (uint64_t)value.data.i;
+    for (int k = 0; k < KEEP; k++) {
+        if (kept[k]) sum += (uint64_t)rb_pvector_get(kept[k], (size_t)slots[0] % n).data.i;
+    }
+    for (int k = 0; k < KEEP; k++) rb_pvector_release(kept[k]);
+    rb_pvector_release(current);
+    return sum;
+}
+
+static uint64_t vector_copy(void) {
+    RbList *current = rb_list_new();
+    for (size_t i = 0; i < n; i++) rb_list_append(current, rb_value_int((int64_t)i));
+    RbList *kept[KEEP] = { NULL };
+    for (size_t u = 0; u < updates; u++) {
+        if (kept[u % KEEP]) rb_list_free(kept[u % KEEP]);
+        kept[u % KEEP] = current;
+        current = rb_list_copy(current);
+        rb_list_set(current, (int)((size_t)slots[u] % n), rb_value_int(values[u]));
+    }
+    uint64_t sum = 0;
+    for (size_t i = 0; i < current->size; i++) sum = sum * 31 + (uint64_t)current->items[i].data.i;
+    for (int k = 0; k < KEEP; k++) {
+        if (kept[k]) sum += (uint64_t)kept[k]->items[(size_t)slots[0] % n].data.i;
+    }
+    for (int k = 0; k < KEEP; k++) {
+        if (kept[k]) rb_list_free(kept[k]);
+    }
+    rb_list_free(current);
+    return sum;
+}
+
+// ========== MAP ==========
+
+static uint64_t map_persistent(void) {
+    RbPMapBuilder *builder = map_builder();
+    for (size_t i = 0; i < n; i++) rb_pmap_builder_set(builder, rb_value_int((int64_t)(2 * i)), rb_value_int(0));
+    RbPMap *current = rb_pmap_build(builder);
+    RbPMap *kept[KEEP] = { NULL };
+    for (size_t u = 0; u < updates; u++) {
+        rb_pmap_release(kept[u % KEEP]);
+        kept[u % KEEP] = rb_pmap_retain(current);
+        RbPMap *next = rb_pmap_set(current, rb_value_int(slots[u] % (int64_t)(2 * n)), rb_value_int(values[u]));
+        rb_pmap_release(current);
+        current = next;
+    }
+    // Order-independent checksum: the map iterates in hash order
+    uint64_t sum = rb_pmap_len(current);
+    RbPMapIter it = rb_pmap_iter(current);
+    RbValue key, value;
+    while (rb_pmap_next(&it, &key, &value)) sum += (uint64_t)key.data.i * 2654435761u ^ (uint64_t)value.data.i;
+    for (int k = 0; k < KEEP; k++) sum += kept[k] ? rb_pmap_len(kept[k]) : 0;
+    for (int k = 0; k < KEEP; k++) rb_pmap_release(kept[k]);
+    rb_pmap_release(current);
+    return sum;
+}
+
+// Pairs stored flat: items[2i] is a key, items[2i+1] its value
+static size_t pair_position(const RbList *list, int64_t key) {
+    size_t low = 0, high = list->size / 2;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (list->items[2 * mid].data.i < key) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+static uint64_t map_copy(void) {
+    RbList *current = rb_list_new();
+    for (size_t i = 0; i < n; i++) {
+        rb_list_append(current, rb_value_int((int64_t)(2 * i)));
+        rb_list_append(current, rb_value_int(0));
+    }
+    RbList *kept[KEEP] = { NULL };
+    for (size_t u = 0; u < updates; u++) {
+        if (kept[u % KEEP]) rb_list_free(kept[u % KEEP]);
+        kept[u % KEEP] = current;
+        current = rb_list_copy(current);
+        int64_t key = slots[u] % (int64_t)(2 * n);
+        size_t pos = pair_position(current, key);
+        if (pos < current->size / 2 && current->items[2 * pos].data.i == key) {
+            rb_list_set(current, (int)(2 * pos + 1), rb_value_int(values[u]));
+        } else {
+            rb_list_insert(current, (int)(2 * pos), rb_value_int(values[u]));
+            rb_list_insert(current, (int)(2 * pos), rb_value_int(key));
+        }
+    }
+    uint64_t sum = current->size / 2;
+    for (size_t i = 0; i < current->size; i += 2) {
+        sum += (uint64_t)current->items[i].data.i * 2654435761u ^ (uint64_t)current->items[i + 1].data.i;
+    }
+    for (int k = 0; k < KEEP; k++) sum += kept[k] ? kept[k]->size / 2 : 0;
+    for (int k = 0; k < KEEP; k++) {
+        if (kept[k]) rb_list_free(kept[k]);
+    }
+    rb_list_free(current);
+    return sum;
+}
+
+// ========== BUILD ==========
+
+static uint64_t build_checksum(RbPVector *vector) {
+    uint64_t sum = 0;
+    RbPVectorIter it = rb_pvector_iter(vector);
+    RbValue value;
+    while (rb_pvector_next(&it, &value)) sum = sum * 31 + (uint64_t)value.data.i;
+    rb_pvector_release(vector);
+    return sum;
+}
+
+static uint64_t build_builder(void) {
+    RbPVectorBuilder *builder = vector_builder();
+    for (size_t i = 0; i < n; i++) rb_pvector_builder_push(builder, rb_value_int(values[i % updates]));
+    return build_checksum(rb_pvector_build(builder));
+}
+
+static uint64_t build_versions(void) {
+    RbPVector *vector = rb_pvector_new();
+    for (size_t i = 0; i < n; i++) {
+        RbPVector *next = rb_pvector_push(vector, rb_value_int(values[i % updates]));
+        rb_pvector_release(vector);
+        vector = next;
+    }
+    return build_checksum(vector);
+}
+
+// ========== DRIVER ==========
+
+static double best_of(Workload workload, int rounds, uint64_t *checksum) {
+    double best = 1e30;
+    for (int r = 0; r < rounds; r++) {
+        double start = now_sec();
+        *checksum = workload();
+        double elapsed = now_sec() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+static int compare(const char *name, Workload fast, Workload slow, size_t ops, int rounds) {
+    uint64_t a, b;
+    double t_fast = best_of(fast, rounds, &a);
+    double t_slow = best_of(slow, rounds, &b);
+    printf("%-6s %10zu %12.1f %12.1f %9.1fx%s\n", name, n,
+           t_fast * 1e9 / (double)ops, t_slow * 1e9 / (double)ops, t_slow / t_fast,
+           a == b ? "" : "  MISMATCH");
+    return a == b ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    n = 100000;
+    updates = 2000;
+    int rounds = 3;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) n = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) updates = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) rounds = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-n count] [-u updates] [-r rounds]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (n < 100 || updates < 1 || rounds < 1) {
+        fprintf(stderr, "count must be >= 100, updates and rounds >= 1\n");
+        return 2;
+    }
+
+    slots = malloc(sizeof(int64_t) * updates);
+    values = malloc(sizeof(int64_t) * updates);
+    for (size_t u = 0; u < updates; u++) {
+        slots[u] = (int64_t)(next_random() >> 2);
+        values[u] = (int64_t)(next_random() >> 40) + 1;
+    }
+
+    printf("%-6s %10s %12s %12s %10s\n", "work", "n", "ns/op", "slow ns/op", "speedup");
+    int failures = 0;
+    failures += compare("vector", vector_persistent, vector_copy, updates, rounds);
+    failures += compare("map", map_persistent, map_copy, updates, rounds);
+    failures += compare("build", build_builder, build_versions, n, rounds);
+
+    free(slots);
+    free(values);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+// print_bench - the print builtin's output path, before and after
+//
+// Usage: print_bench [-n lines] [-o path]
+//
+// Prints lines of three values (a counter, a fraction and a string), the
+// shape of `print(i, i / 7, "item")`, to path (default /dev/null) two ways:
+//   printf      what builtin_print did: one printf per argument with
+//               %.6g for numbers, one for each separator and the newline,
+//               on a line-buffered stdout (a terminal or many pipes)
+//   buffered    what it does now: the line assembled in one pass with
+//               dtoa_shortest, one fwrite into the 64 KB output buffer
+// and reports lines/s and how many write() calls each needed. Then
+// checks dtoa_shortest against printf on random doubles: the result must
+// read back exactly and have as few digits as the shortest %.*e that does.
+//
+// Build: make -C tools print_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "dtoa.h"
+#include "output.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void report(const char *how, size_t count, double seconds, size_t writes) {
+    printf("%-10s %9.1f ms %8.2f M lines/s %9zu writes\n", how, seconds * 1e3, (double)count / seconds / 1e6,
+           writes);
+}
+
+// Digits of the shortest %.*e form of |x| that reads back exactly
+static int shortest_printf_digits(double x) {
+    char text[40];
+    for (int precision = 1; precision <= 17; precision++) {
+        snprintf(text, sizeof(text), "%.*e", precision - 1, fabs(x));
+        if (strtod(text, NULL) == x || strtod(text, NULL) == -x) return precision;
+    }
+    return 17;
+}
+
+static int significant_digits(const char *s) {
+    int count = 0, zeros = 0;
+    bool started = false;
+    for (; *s && *s != 'e'; s++) {
+        if (*s < '0' || *s > '9') continue;
+        if (*s != '0') started = true;
+        if (!started) continue;
+        count++;
+        zeros = *s == '0' ? zeros + 1 : 0;
+    }
+    return count - zeros;
+}
+
+static int check_dtoa(size_t n) {
+    int failures = 0;
+    char text[DTOA_BUFFER_SIZE];
+    for (size_t i = 0; i < n; i++) {
+        uint64_t bits = next_random();
+        double x;
+        memcpy(&x, &bits, sizeof(x));
+        if (i % 2) x = (double)(next_random() % 100000000) / (double)(1 + next_random() % 1000);
+        if (!isfinite(x)) continue;
+        dtoa_shortest(x, text);
+        if (strtod(text, NULL) != x || significant_digits(text) != shortest_printf_digits(x)) {
+            if (failures++ < 5) fprintf(stderr, "dtoa(%.17g) = %s\n", x, text);
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    size_t count = 2000000;
+    const char *path = "/dev/null";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) count = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) path = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [-n lines] [-o path]\n", argv[0]);
+            return 2;
+        }
+    }
+    fprintf(stderr, "%zu lines to %s\n", count, path);
+
+    // Before: printf per piece, line-buffered
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return 1;
+    }
+    setvbuf(out, NULL, _IOLBF, BUFSIZ);
+    double start = now_sec();
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out, "%.6g", (double)i);
+        fprintf(out, " ");
+        fprintf(out, "%.6g", (double)i / 7);
+        fprintf(out, " ");
+        fwrite("item", 1, 4, out);
+        fprintf(out, "\n");
+    }
+    fclose(out);
+    double before = now_sec() - start;
+
+    // After: stdout goes to path for the run, then back for the results
+    int saved = dup(1);
+    if (saved < 0 || !freopen(path, "w", stdout)) {
+        perror(path);
+        return 1;
+    }
+    output_init();
+    size_t bytes = 0;
+    start = now_sec();
+    for (size_t i = 0; i < count; i++) {
+        char line[3 * DTOA_BUFFER_SIZE + 8], *p = line;
+        p += dtoa_shortest((double)i, p);
+        *p++ = ' ';
+        p += dtoa_shortest((double)i / 7, p);
+        memcpy(p, " item\n", 6);
+        p += 6;
+        output_write(line, (size_t)(p - line));
+        bytes += (size_t)(p - line);
+    }
+    output_flush();
+    double after = now_sec() - start;
+
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+    report("printf", count, before, count);
+    report("buffered", count, after, (bytes + OUTPUT_BUFFER_SIZE - 1) / OUTPUT_BUFFER_SIZE);
+
+    int failures = check_dtoa(1000000);
+    printf("dtoa_shortest: %s on 1000000 random doubles\n", failures ? "FAILED" : "shortest and exact");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+// random_bench - random number throughput through src/rng.c
+//
+// Usage: random_bench [-n count]
+//
+// Generates count numbers (default 50M) each way a script could get them:
+//   rand() % 100           the old random.int: biased, one shared state
+//   rng_bounded(100)       xoshiro256** with Lemire's bounded integers
+//   rand() / RAND_MAX      the old random.float
+//   rng_double             one double per call
+//   fill, scalar / avx2    rng_fill_uniform on a whole array per kernel
+// then estimates pi from count points filled in bulk, and checks that the
+// scalar and AVX2 kernels produce the same values from the same seed.
+//
+// Build: make -C tools random_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rng.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, size_t count, double seconds, double checksum) {
+    printf("%-22s %10zu values %7.3f s %8.1f M/s  (checksum %.6g)\n", name, count, seconds,
+           (double)count / seconds / 1e6, checksum);
+}
+
+int main(int argc, char **argv) {
+    size_t count = 50000000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) count = (size_t)atol(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-n count]\n", argv[0]);
+            return 2;
+        }
+    }
+    double *values = malloc(sizeof(double) * (count ? count : 1));
+    double *check = malloc(sizeof(double) * (count ? count : 1));
+    if (!values || !check) return 1;
+    // Fault the pages in up front so the fills measure generation
+    memset(values, 0, sizeof(double) * count);
+    memset(check, 0, sizeof(double) * count);
+    Rng rng;
+    rng_seed(&rng, 1);
+    srand(1);
+
+    double start = now_sec();
+    uint64_t isum = 0;
+    for (size_t i = 0; i < count; i++) isum += (uint64_t)(rand() % 100);
+    report("rand() % 100", count, now_sec() - start, (double)isum);
+
+    start = now_sec();
+    isum = 0;
+    for (size_t i = 0; i < count; i++) isum += rng_bounded(&rng, 100);
+    report("rng_bounded(100)", count, now_sec() - start, (double)isum);
+
+    start = now_sec();
+    double sum = 0;
+    for (size_t i = 0; i < count; i++) sum += (double)rand() / (double)RAND_MAX;
+    report("rand() / RAND_MAX", count, now_sec() - start, sum);
+
+    start = now_sec();
+    sum = 0;
+    for (size_t i = 0; i < count; i++) sum += rng_double(&rng);
+    report("rng_double", count, now_sec() - start, sum);
+
+    RngLanes lanes, copy;
+    rng_lanes_seed(&lanes, &rng);
+    copy = lanes;
+    const char *kernels[] = { "scalar", "avx2" };
+    int failures = 0;
+    for (int k = 0; k < 2; k++) {
+        if (!rng_fill_select(kernels[k])) {
+            printf("%-22s unsupported on this CPU\n", kernels[k]);
+            continue;
+        }
+        RngLanes run = copy;
+        start = now_sec();
+        rng_fill_uniform(&run, k == 0 ? check : values, count, 0, 1);
+        double seconds = now_sec() - start;
+        sum = 0;
+        for (size_t i = 0; i < count; i++) sum += (k == 0 ? check : values)[i];
+        char name[32];
+        snprintf(name, sizeof(name), "fill, %s", kernels[k]);
+        report(name, count, seconds, sum);
+        if (k == 1 && memcmp(check, values, sizeof(double) * count) != 0) {
+            printf("avx2 fill differs from scalar\n");
+            failures++;
+        }
+    }
+
+    // Monte Carlo pi: x and y for count / 2 points, two bulk fills
+    size_t points = count / 2;
+    start = now_sec();
+    rng_fill_uniform(&lanes, values, points, 0, 1);
+    rng_fill_uniform(&lanes, check, points, 0, 1);
+    size_t inside = 0;
+    for (size_t i = 0; i < points; i++) inside += values[i] * values[i] + check[i] * check[i] < 1.0;
+    double seconds = now_sec() - start;
+    printf("pi from %zu points: %.6f in %.3f s (%s)\n", points, points ? 4.0 * (double)inside / (double)points : 0,
+           seconds, rng_fill_isa());
+
+    free(values);
+    free(check);
+    if (failures) printf("%d FAILED\n", failures);
+    return failures ? 1 : 0;
+}
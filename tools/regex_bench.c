@@ -0,0 +1,146 @@
+// regex_bench - compare the native regex engine with POSIX regcomp/regexec
+//
+// Usage: regex_bench [-n lines] [-r rounds]
+//
+// Generates synthetic access-log lines and, for a handful of typical
+// log-parsing patterns, times three ways of matching every line:
+//   posix    regcomp once, regexec per line
+//   native   regex_compile once, regex_is_match per line
+//   cached   regex_cache_get/regex_release per line (what scripts do)
+// Also times recompiling per line, which is what pattern matching used to
+// do. Reports lines/s and MB/s and checks that both engines agree.
+//
+// Build: make -C tools regex_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <regex.h>
+#include "regex_engine.h"
+
+typedef struct {
+    const char* name;
+    const char* pattern;
+} BenchPattern;
+
+static const BenchPattern patterns[] = {
+    { "literal",     "POST /login" },
+    { "status 5xx",  "HTTP/1\\.1\" 5[0-9][0-9] " },
+    { "ip prefix",   "^10\\.0\\.[0-9]+\\.[0-9]+ " },
+    { "alternation", "(DELETE|PUT|PATCH) /api/v[0-9]+/" },
+    { "anywhere",    "[a-z]+_id=[0-9]+&" },
+    { "no match",    "timeout after [0-9]+ms" },
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char** make_lines(size_t count, size_t* total_bytes) {
+    static const char* methods[] = { "GET", "GET", "GET", "POST", "PUT", "DELETE" };
+    static const int statuses[] = { 200, 200, 200, 304, 404, 500, 503 };
+    char** lines = malloc(count * sizeof(char*));
+    char buf[512];
+    *total_bytes = 0;
+    srand(42);
+    for (size_t i = 0; i < count; i++) {
+        const char* method = methods[rand() % 6];
+        int n = snprintf(buf, sizeof(buf),
+            "10.0.%d.%d - - [12/Mar/2024:10:%02d:%02d +0000] \"%s /api/v%d/items/%zu?user_id=%d&page=%d HTTP/1.1\" %d %d \"-\" \"curl/8.0\"",
+            rand() % 256, rand() % 256, rand() % 60, rand() % 60, method, 1 + rand() % 3, i,
+            rand() % 100000, rand() % 50, statuses[rand() % 7], rand() % 20000);
+        if (i % 97 == 0) n = snprintf(buf, sizeof(buf), "192.168.1.%d - - [12/Mar/2024:10:00:00 +0000] \"POST /login HTTP/1.1\" 401 0", rand() % 256);
+        lines[i] = malloc((size_t)n + 1);
+        memcpy(lines[i], buf, (size_t)n + 1);
+        *total_bytes += (size_t)n;
+    }
+    return lines;
+}
+
+static void report(const char* label, double seconds, size_t lines, size_t bytes, size_t hits) {
+    printf("  %-8s %12.0f lines/s %9.1f MB/s  (%zu hits)\n",
+           label, (double)lines / seconds, (double)bytes / seconds / 1e6, hits);
+}
+
+int main(int argc, char** argv) {
+    size_t count = 200000;
+    int rounds = 3;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0) count = (size_t)atol(argv[i + 1]);
+        else if (strcmp(argv[i], "-r") == 0) rounds = atoi(argv[i + 1]);
+        else { fprintf(stderr, "Usage: %s [-n lines] [-r rounds]\n", argv[0]); return 1; }
+    }
+
+    size_t bytes;
+    char** lines = make_lines(count, &bytes);
+    size_t* lengths = malloc(count * sizeof(size_t));
+    for (size_t i = 0; i < count; i++) lengths[i] = strlen(lines[i]);
+    printf("%zu lines, %.1f MB, best of %d\n\n", count, (double)bytes / 1e6, rounds);
+
+    int mismatches = 0;
+    for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+        const char* pattern = patterns[p].pattern;
+        printf("%s: %s\n", patterns[p].name, pattern);
+
+        regex_t posix;
+        if (regcomp(&posix, pattern, REG_EXTENDED | REG_NOSUB) != 0) { printf("  regcomp failed\n"); continue; }
+        const char* error;
+        Regex* native = regex_compile(pattern, 0, &error);
+        if (!native) { printf("  regex_compile failed: %s\n", error); regfree(&posix); continue; }
+
+        double best_posix = 1e9, best_native = 1e9, best_cached = 1e9;
+        size_t hits_posix = 0, hits_native = 0, hits_cached = 0;
+        for (int r = 0; r < rounds; r++) {
+            double t0 = now_sec();
+            hits_posix = 0;
+            for (size_t i = 0; i < count; i++) hits_posix += regexec(&posix, lines[i], 0, NULL, 0) == 0;
+            double t1 = now_sec();
+            hits_native = 0;
+            for (size_t i = 0; i < count; i++) hits_native += regex_is_match(native, lines[i], lengths[i]);
+            double t2 = now_sec();
+            hits_cached = 0;
+            for (size_t i = 0; i < count; i++) {
+                Regex* re = regex_cache_get(pattern, 0);
+                hits_cached += regex_is_match(re, lines[i], lengths[i]);
+                regex_release(re);
+            }
+            double t3 = now_sec();
+            if (t1 - t0 < best_posix) best_posix = t1 - t0;
+            if (t2 - t1 < best_native) best_native = t2 - t1;
+            if (t3 - t2 < best_cached) best_cached = t3 - t2;
+        }
+        report("posix", best_posix, count, bytes, hits_posix);
+        report("native", best_native, count, bytes, hits_native);
+        report("cached", best_cached, count, bytes, hits_cached);
+        printf("  speedup  %.1fx\n", best_posix / best_native);
+        if (hits_posix != hits_native || hits_native != hits_cached) {
+            printf("  MISMATCH\n");
+            mismatches++;
+        }
+
+        // Per-line recompilation, sampled (it is slow)
+        size_t sample = count < 20000 ? count : 20000;
+        double t0 = now_sec();
+        for (size_t i = 0; i < sample; i++) {
+            regex_t once;
+            regcomp(&once, pattern, REG_EXTENDED | REG_NOSUB);
+            regexec(&once, lines[i], 0, NULL, 0);
+            regfree(&once);
+        }
+        double t1 = now_sec();
+        printf("  recompile per line (posix): %.0f lines/s\n\n", (double)sample / (t1 - t0));
+
+        regex_free(native);
+        regfree(&posix);
+    }
+
+    regex_cache_clear();
+    for (size_t i = 0; i < count; i++) free(lines[i]);
+    free(lines);
+    free(lengths);
+    return mismatches ? 1 : 0;
+}
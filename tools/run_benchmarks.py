@@ -9,6 +9,12 @@ CASES = [
     ('loop', os.path.join(BENCH_DIR, 'loop.rbo')),
     ('recursion', os.path.join(BENCH_DIR, 'recursion.rbo')),
     ('io', os.path.join(BENCH_DIR, 'io.rbo')),
+    ('lines', os.path.join(BENCH_DIR, 'lines.rbo')),
+    ('async_io', os.path.join(BENCH_DIR, 'async_io.rbo')),
+    ('net_echo', os.path.join(BENCH_DIR, 'net_echo.rbo')),
+    ('regex', os.path.join(BENCH_DIR, 'regex.rbo')),
+    ('string_index', os.path.join(BENCH_DIR, 'string_index.rbo')),
+    ('string_utf8', os.path.join(BENCH_DIR, 'string_utf8.rbo')),
 ]
 
 N = 5
@@ -0,0 +1,152 @@
+// sort_bench - RbList sorting vs the old qsort path
+//
+// Usage: sort_bench [-max exponent] [-r rounds]
+//
+// For n = 10^3 .. 10^max (default 10^7; 10^8 needs ~5 GB of RAM), sorts
+// random ints, floats, short strings and a mixed-type list with:
+//   qsort    libc qsort + the generic comparator (what rb_list_sort did)
+//   sort     rb_sort_values (radix / multikey quicksort / pdqsort)
+//   stable   rb_sort_values_stable
+// and a sort-by-key on ints with qsort calling the key function in every
+// comparison vs rb_sort_values_by_key computing each key once. Prints
+// ns per element (best of rounds) and checks that the results agree.
+//
+// Build: make -C tools sort_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rb_sort.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+typedef enum { DATA_INT, DATA_FLOAT, DATA_STRING, DATA_MIXED, DATA_COUNT } DataKind;
+
+static const char* data_names[] = { "int", "float", "string", "mixed" };
+
+// Strings live in one arena so generation and cleanup stay cheap
+static char* string_arena;
+
+static void fill(RbValue* items, size_t n, DataKind kind) {
+    for (size_t i = 0; i < n; i++) {
+        uint64_t r = next_random();
+        DataKind k = kind == DATA_MIXED ? (DataKind)(r % 3) : kind;
+        switch (k) {
+        case DATA_INT:   items[i] = rb_value_int((int64_t)(r >> 1) - (int64_t)(UINT64_MAX >> 2)); break;
+        case DATA_FLOAT: items[i] = rb_value_float(((double)(r >> 11) / 9007199254740992.0 - 0.5) * 1e6); break;
+        default: {
+            char* s = string_arena + i * 16;
+            size_t len = 8 + (r >> 60) % 7;
+            for (size_t j = 0; j < len; j++) s[j] = (char)('a' + (next_random() >> 59) % 26);
+            s[len] = '\0';
+            items[i].type = RB_VAL_STRING;
+            items[i].data.s = s;
+            break;
+        }
+        }
+    }
+}
+
+static RbValue negate_key(RbValue v) {
+    return rb_value_int(-v.data.i);
+}
+
+static int compare_by_negated(const void* a, const void* b) {
+    RbValue ka = negate_key(*(const RbValue*)a), kb = negate_key(*(const RbValue*)b);
+    return rb_compare_values(&ka, &kb);
+}
+
+typedef enum { RUN_QSORT, RUN_SORT, RUN_STABLE, RUN_KEY_QSORT, RUN_KEY } RunKind;
+
+static double time_run(RunKind run, const RbValue* input, RbValue* work, size_t n, int rounds) {
+    double best = 1e30;
+    for (int r = 0; r < rounds; r++) {
+        memcpy(work, input, n * sizeof(RbValue));
+        double t0 = now_sec();
+        switch (run) {
+        case RUN_QSORT:     qsort(work, n, sizeof(RbValue), rb_compare_values); break;
+        case RUN_SORT:      rb_sort_values(work, n, NULL); break;
+        case RUN_STABLE:    rb_sort_values_stable(work, n, NULL); break;
+        case RUN_KEY_QSORT: qsort(work, n, sizeof(RbValue), compare_by_negated); break;
+        case RUN_KEY:       rb_sort_values_by_key(work, n, negate_key); break;
+        }
+        double t = now_sec() - t0;
+        if (t < best) best = t;
+    }
+    return best * 1e9 / (double)n;
+}
+
+static bool agree(const RbValue* a, const RbValue* b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (rb_compare_values(&a[i], &b[i]) != 0) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int max_exp = 7, rounds = 3;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-max") == 0) max_exp = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-r") == 0) rounds = atoi(argv[i + 1]);
+        else { fprintf(stderr, "Usage: %s [-max exponent] [-r rounds]\n", argv[0]); return 1; }
+    }
+
+    size_t max_n = 1;
+    for (int e = 0; e < max_exp; e++) max_n *= 10;
+    RbValue* input = malloc(max_n * sizeof(RbValue));
+    RbValue* work = malloc(max_n * sizeof(RbValue));
+    RbValue* reference = malloc(max_n * sizeof(RbValue));
+    string_arena = malloc(max_n * 16);
+    if (!input || !work || !reference || !string_arena) { fprintf(stderr, "out of memory\n"); return 1; }
+
+    printf("ns/element, best of %d\n", rounds);
+    printf("%-8s %10s %9s %9s %9s %8s\n", "data", "n", "qsort", "sort", "stable", "speedup");
+    int mismatches = 0;
+    for (int kind = 0; kind < DATA_COUNT; kind++) {
+        for (size_t n = 1000; n <= max_n; n *= 10) {
+            fill(input, n, (DataKind)kind);
+            int r = n >= 10000000 ? 1 : rounds;
+            double q = time_run(RUN_QSORT, input, work, n, r);
+            memcpy(reference, work, n * sizeof(RbValue));
+            double s = time_run(RUN_SORT, input, work, n, r);
+            if (!agree(reference, work, n)) mismatches++;
+            double st = time_run(RUN_STABLE, input, work, n, r);
+            if (!agree(reference, work, n)) mismatches++;
+            printf("%-8s %10zu %9.1f %9.1f %9.1f %7.1fx\n", data_names[kind], n, q, s, st, q / s);
+        }
+    }
+
+    printf("\nsort by key (int, key = -x)\n");
+    printf("%-8s %10s %9s %9s %8s\n", "", "n", "qsort", "by_key", "speedup");
+    for (size_t n = 1000; n <= max_n; n *= 10) {
+        fill(input, n, DATA_INT);
+        int r = n >= 10000000 ? 1 : rounds;
+        double q = time_run(RUN_KEY_QSORT, input, work, n, r);
+        memcpy(reference, work, n * sizeof(RbValue));
+        double k = time_run(RUN_KEY, input, work, n, r);
+        if (!agree(reference, work, n)) mismatches++;
+        printf("%-8s %10zu %9.1f %9.1f %7.1fx\n", "", n, q, k, q / k);
+    }
+
+    if (mismatches) printf("\n%d MISMATCHES\n", mismatches);
+    free(input);
+    free(work);
+    free(reference);
+    free(string_arena);
+    return mismatches ? 1 : 0;
+}
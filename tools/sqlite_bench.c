@@ -0,0 +1,170 @@
+// sqlite_bench - insert throughput through src/sqlite_db.c
+//
+// Usage: sqlite_bench [-n rows] [-u autocommit_rows] [-w] [-f file]
+//
+// Inserts rows (id, name, price, qty) into a fresh file database in the
+// ways a script could:
+//   autocommit, SQL text     one INSERT string per row, formatted and
+//                            parsed each time, each its own transaction
+//   autocommit, prepared     the cached statement with bound parameters,
+//                            still a transaction (and journal sync) per row
+//   one txn, SQL text        formatted INSERTs inside BEGIN/COMMIT
+//   execute_many, 10k/batch  cached statement, one transaction per batch
+//   execute_many, one batch  all rows in one transaction
+// The autocommit runs use -u rows (default 2000) since every row waits on
+// fsync; the others -n (default 1M). Then reads every row back through a
+// cursor. -w switches the database to WAL mode.
+//
+// Build: make -C tools sqlite_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sqlite_db.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static const char *names[] = { "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel" };
+
+#define INSERT_SQL "INSERT INTO items(id, name, price, qty) VALUES (?, ?, ?, ?)"
+
+static int64_t next_id = 1;
+
+static void fill_row(SqlValue *row) {
+    uint64_t r = next_random();
+    const char *name = names[r & 7];
+    row[0] = (SqlValue){ SQL_INT, { .i = next_id++ } };
+    row[1] = (SqlValue){ SQL_TEXT, { .bytes = { name, strlen(name) } } };
+    row[2] = (SqlValue){ SQL_FLOAT, { .f = (double)((r >> 8) % 100000) / 100.0 } };
+    row[3] = (SqlValue){ SQL_INT, { .i = (int64_t)((r >> 32) % 1000) } };
+}
+
+static void format_row(char *sql, size_t size) {
+    SqlValue row[4];
+    fill_row(row);
+    snprintf(sql, size, "INSERT INTO items(id, name, price, qty) VALUES (%lld, '%s', %.2f, %lld)",
+             (long long)row[0].as.i, row[1].as.bytes.data, row[2].as.f, (long long)row[3].as.i);
+}
+
+static void report(const char *name, size_t rows, double seconds, bool ok) {
+    printf("%-26s %9zu rows %8.2f s %12.0f rows/s%s\n", name, rows, seconds, (double)rows / seconds,
+           ok ? "" : "  FAILED");
+}
+
+int main(int argc, char **argv) {
+    size_t rows = 1000000, autocommit_rows = 2000;
+    bool wal = false;
+    const char *path = "sqlite_bench.db";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) rows = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) autocommit_rows = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-w") == 0) wal = true;
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) path = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [-n rows] [-u autocommit_rows] [-w] [-f file]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    unlink(path);
+    SqlDb *db = sql_open(path, 0);
+    if (!db || !sql_exec_script(db, "CREATE TABLE items(id INTEGER PRIMARY KEY, name TEXT, price REAL, qty INTEGER)") ||
+        (wal && !sql_exec_script(db, "PRAGMA journal_mode=WAL"))) {
+        fprintf(stderr, "cannot create %s: %s\n", path, db ? sql_error(db) : "out of memory");
+        return 1;
+    }
+    SqlValue *params = malloc(sizeof(SqlValue) * 4 * (rows ? rows : 1));
+    if (!params) return 1;
+    char sql[256];
+    int failures = 0;
+    size_t total = 0;
+
+    double start = now_sec();
+    bool ok = true;
+    for (size_t i = 0; i < autocommit_rows && ok; i++) {
+        format_row(sql, sizeof(sql));
+        ok = sql_exec_script(db, sql);
+    }
+    report("autocommit, SQL text", autocommit_rows, now_sec() - start, ok);
+    failures += !ok;
+    total += autocommit_rows;
+
+    start = now_sec();
+    for (size_t i = 0; i < autocommit_rows && ok; i++) {
+        fill_row(params);
+        ok = sql_execute(db, INSERT_SQL, params, 4) == 1;
+    }
+    report("autocommit, prepared", autocommit_rows, now_sec() - start, ok);
+    failures += !ok;
+    total += autocommit_rows;
+
+    start = now_sec();
+    ok = sql_execute(db, "BEGIN", NULL, 0) >= 0;
+    for (size_t i = 0; i < rows && ok; i++) {
+        format_row(sql, sizeof(sql));
+        ok = sql_exec_script(db, sql);
+    }
+    ok = ok && sql_execute(db, "COMMIT", NULL, 0) >= 0;
+    report("one txn, SQL text", rows, now_sec() - start, ok);
+    failures += !ok;
+    total += rows;
+
+    for (size_t i = 0; i < rows; i++) fill_row(params + 4 * i);
+    start = now_sec();
+    ok = true;
+    for (size_t i = 0; i < rows && ok; i += 10000) {
+        size_t batch = rows - i < 10000 ? rows - i : 10000;
+        ok = sql_execute_many(db, INSERT_SQL, params + 4 * i, batch, 4) == (int64_t)batch;
+    }
+    report("execute_many, 10k/batch", rows, now_sec() - start, ok);
+    failures += !ok;
+    total += rows;
+
+    for (size_t i = 0; i < rows; i++) fill_row(params + 4 * i);
+    start = now_sec();
+    ok = sql_execute_many(db, INSERT_SQL, params, rows, 4) == (int64_t)rows;
+    report("execute_many, one batch", rows, now_sec() - start, ok);
+    failures += !ok;
+    total += rows;
+
+    // Read back
+    start = now_sec();
+    SqlCursor *cursor = sql_query(db, "SELECT id, name, price, qty FROM items", NULL, 0);
+    size_t seen = 0, text = 0;
+    double sum = 0;
+    while (cursor && sql_cursor_step(cursor)) {
+        sum += sql_cursor_value(cursor, 2).as.f;
+        text += sql_cursor_value(cursor, 1).as.bytes.length;
+        seen++;
+    }
+    ok = cursor && !sql_cursor_failed(cursor) && seen == total;
+    sql_cursor_close(cursor);
+    report("cursor scan", seen, now_sec() - start, ok);
+    failures += !ok;
+
+    SqlCacheStats stats;
+    sql_cache_stats(db, &stats);
+    printf("statement cache: %llu hits, %llu misses (sum %.2f, %zu text bytes)\n", (unsigned long long)stats.hits,
+           (unsigned long long)stats.misses, sum, text);
+    sql_close(db);
+    free(params);
+    unlink(path);
+    if (failures) printf("%d FAILED\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,293 @@
+// str_bench - microbenchmarks for the string kernels (src/str_kernels.c)
+//
+// Usage: str_bench [-m megabytes-per-measurement]
+//
+// For input sizes from 16 B to 16 MB, times each operation with a naive
+// byte-at-a-time implementation (what the string module used to do) and
+// with every kernel set the CPU supports, and prints throughput in GB/s.
+// split/join compare per-piece allocation against the size-first,
+// allocate-once versions the module uses. utf8 validates and counts the
+// code points of mixed ASCII/accented/CJK text, which is what every new
+// interpreter string pays.
+//
+// Build: make -C tools str_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "str_kernels.h"
+
+static volatile size_t sink;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* ========== NAIVE VERSIONS ========== */
+
+static size_t naive_find(const char* s, size_t n, const char* needle, size_t k) {
+    for (size_t i = 0; i + k <= n; i++) {
+        size_t j = 0;
+        while (j < k && s[i + j] == needle[j]) j++;
+        if (j == k) return i;
+    }
+    return STR_NPOS;
+}
+
+static size_t naive_rfind(const char* s, size_t n, const char* needle, size_t k) {
+    for (size_t i = n - k + 1; i-- > 0;) {
+        size_t j = 0;
+        while (j < k && s[i + j] == needle[j]) j++;
+        if (j == k) return i;
+    }
+    return STR_NPOS;
+}
+
+static size_t naive_count(const char* s, size_t n, const char* needle, size_t k) {
+    size_t count = 0;
+    for (size_t i = 0; i + k <= n;) {
+        if (memcmp(s + i, needle, k) == 0) { count++; i += k; }
+        else i++;
+    }
+    return count;
+}
+
+static void naive_upper(char* dst, const char* src, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = (char)toupper((unsigned char)src[i]);
+}
+
+static size_t naive_trim(const char* s, size_t n) {
+    size_t b = 0, e = n;
+    while (b < e && isspace((unsigned char)s[b])) b++;
+    while (e > b && isspace((unsigned char)s[e - 1])) e--;
+    return e - b;
+}
+
+// One malloc per piece, like building the list element by element
+static size_t naive_split(const char* s, size_t n, char sep) {
+    size_t pieces = 0, start = 0;
+    for (size_t i = 0; i <= n; i++) {
+        if (i == n || s[i] == sep) {
+            char* piece = malloc(i - start + 1);
+            memcpy(piece, s + start, i - start);
+            piece[i - start] = '\0';
+            sink += (size_t)piece[0];
+            free(piece);
+            pieces++;
+            start = i + 1;
+        }
+    }
+    return pieces;
+}
+
+static size_t kernel_split(const char* s, size_t n, char sep) {
+    size_t pieces = str_count(s, n, &sep, 1) + 1;
+    char* buffer = malloc(n + 1);
+    size_t pos = 0;
+    for (size_t i = 0; i < pieces; i++) {
+        size_t hit = i + 1 < pieces ? str_find(s + pos, n - pos, &sep, 1) : n - pos;
+        memcpy(buffer + pos, s + pos, hit);
+        buffer[pos + hit] = '\0';
+        pos += hit + 1;
+    }
+    sink += (size_t)buffer[0];
+    free(buffer);
+    return pieces;
+}
+
+// Repeated realloc-and-append
+static size_t naive_join(char** parts, size_t count, const char* sep) {
+    char* out = calloc(1, 1);
+    size_t len = 0, sep_len = strlen(sep);
+    for (size_t i = 0; i < count; i++) {
+        size_t n = strlen(parts[i]);
+        out = realloc(out, len + n + sep_len + 1);
+        if (i) { memcpy(out + len, sep, sep_len); len += sep_len; }
+        memcpy(out + len, parts[i], n);
+        len += n;
+        out[len] = '\0';
+    }
+    free(out);
+    return len;
+}
+
+static size_t kernel_join(char** parts, size_t count, const char* sep) {
+    size_t total = 0, sep_len = strlen(sep);
+    size_t* lengths = malloc(count * sizeof(size_t));
+    for (size_t i = 0; i < count; i++) total += lengths[i] = strlen(parts[i]);
+    if (count > 1) total += (count - 1) * sep_len;
+    char* out = malloc(total + 1);
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i) { memcpy(out + len, sep, sep_len); len += sep_len; }
+        memcpy(out + len, parts[i], lengths[i]);
+        len += lengths[i];
+    }
+    out[len] = '\0';
+    free(out);
+    free(lengths);
+    return len;
+}
+
+// Decode every code point, as a byte-at-a-time validator would
+static size_t naive_utf8(const char* s, size_t n) {
+    const unsigned char* u = (const unsigned char*)s;
+    size_t count = 0;
+    for (size_t i = 0; i < n; count++) {
+        unsigned char c = u[i];
+        size_t len = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+        if (c >= 0x80 && c < 0xC2) return 0;
+        if (n - i < len) return 0;
+        for (size_t k = 1; k < len; k++) if ((u[i + k] & 0xC0) != 0x80) return 0;
+        i += len;
+    }
+    return count;
+}
+
+static size_t kernel_utf8(const char* s, size_t n) {
+    bool ascii;
+    if (!str_utf8_validate(s, n, &ascii)) return 0;
+    return ascii ? n : str_utf8_count(s, n);
+}
+
+/* ========== DRIVER ========== */
+
+typedef enum { OP_FIND, OP_RFIND, OP_COUNT, OP_COUNT_BYTE, OP_UPPER, OP_STRIP, OP_SPLIT, OP_JOIN, OP_UTF8, OP_COUNT_OPS } BenchOp;
+
+static const char* op_names[] = { "find", "rfind", "count", "count(byte)", "upper", "strip", "split", "join", "utf8" };
+
+typedef struct {
+    char* text;         // words separated by spaces, padded with whitespace
+    char* scratch;
+    char* unicode;      // same size, mixed one- to three-byte characters
+    size_t size;
+    char** parts;       // 16-byte pieces for join
+    size_t part_count;
+} BenchInput;
+
+static const char needle[] = "needle!";
+
+static void run_op(BenchOp op, bool naive, BenchInput* in) {
+    const char* s = in->text;
+    size_t n = in->size;
+    switch (op) {
+    case OP_FIND:       sink += naive ? naive_find(s, n, needle, 7) : str_find(s, n, needle, 7); break;
+    case OP_RFIND:      sink += naive ? naive_rfind(s, n, "zz", 2) : str_rfind(s, n, "zz", 2); break;
+    case OP_COUNT:      sink += naive ? naive_count(s, n, "ab", 2) : str_count(s, n, "ab", 2); break;
+    case OP_COUNT_BYTE: sink += naive ? naive_count(s, n, "e", 1) : str_count(s, n, "e", 1); break;
+    case OP_UPPER:
+        if (naive) naive_upper(in->scratch, s, n);
+        else str_upper_ascii(in->scratch, s, n);
+        sink += (size_t)in->scratch[0];
+        break;
+    case OP_STRIP: {
+        if (naive) { sink += naive_trim(s, n); break; }
+        size_t b, e;
+        str_trim_bounds(s, n, &b, &e);
+        sink += e - b;
+        break;
+    }
+    case OP_SPLIT:      sink += naive ? naive_split(s, n, ' ') : kernel_split(s, n, ' '); break;
+    case OP_JOIN:       sink += naive ? naive_join(in->parts, in->part_count, ", ") : kernel_join(in->parts, in->part_count, ", "); break;
+    case OP_UTF8:       sink += naive ? naive_utf8(in->unicode, n) : kernel_utf8(in->unicode, n); break;
+    default: break;
+    }
+}
+
+static double measure(BenchOp op, bool naive, BenchInput* in, double budget_bytes) {
+    size_t reps = (size_t)(budget_bytes / (double)in->size);
+    if (reps < 1) reps = 1;
+    run_op(op, naive, in);  // warm up
+    double t0 = now_sec();
+    for (size_t r = 0; r < reps; r++) run_op(op, naive, in);
+    double t1 = now_sec();
+    return (double)in->size * (double)reps / (t1 - t0) / 1e9;
+}
+
+static void make_input(BenchInput* in, size_t size) {
+    in->size = size;
+    in->text = malloc(size + 1);
+    in->scratch = malloc(size + 1);
+    static const char* words[] = { "alpha", "beta", "gamma", "delta", "epsilon", "zeta", "eta", "theta" };
+    size_t pos = 0, w = 0;
+    // Leading/trailing whitespace of 1/8 of the input so strip has work
+    size_t pad = size / 8;
+    memset(in->text, ' ', size);
+    pos = pad;
+    while (pos + 8 < size - pad) {
+        const char* word = words[w++ % 8];
+        size_t len = strlen(word);
+        memcpy(in->text + pos, word, len);
+        pos += len + 1;
+    }
+    in->text[size] = '\0';
+
+    static const char* chars[] = { "a", "b", " ", "\xc3\xa9", "c", "\xe6\x97\xa5", "d", "e" };
+    in->unicode = malloc(size + 1);
+    pos = 0;
+    for (w = 0; pos < size; w++) {
+        const char* ch = chars[w % 8];
+        size_t len = strlen(ch);
+        if (pos + len > size) ch = "x", len = 1;
+        memcpy(in->unicode + pos, ch, len);
+        pos += len;
+    }
+    in->unicode[size] = '\0';
+
+    in->part_count = size / 16 ? size / 16 : 1;
+    in->parts = malloc(in->part_count * sizeof(char*));
+    for (size_t i = 0; i < in->part_count; i++) {
+        in->parts[i] = malloc(15);
+        memcpy(in->parts[i], "part-0123456789", 14);
+        in->parts[i][14] = '\0';
+    }
+}
+
+static void free_input(BenchInput* in) {
+    for (size_t i = 0; i < in->part_count; i++) free(in->parts[i]);
+    free(in->parts);
+    free(in->text);
+    free(in->scratch);
+    free(in->unicode);
+}
+
+int main(int argc, char** argv) {
+    double budget = 256e6;
+    if (argc == 3 && strcmp(argv[1], "-m") == 0) budget = atof(argv[2]) * 1e6;
+    else if (argc != 1) { fprintf(stderr, "Usage: %s [-m megabytes-per-measurement]\n", argv[0]); return 1; }
+
+    const char* isas[] = { "scalar", "sse2", "avx2" };
+    bool available[3];
+    for (int i = 0; i < 3; i++) available[i] = str_kernels_select(isas[i]);
+
+    printf("GB/s (higher is better)\n");
+    printf("%-12s %9s %9s", "op", "size", "naive");
+    for (int i = 0; i < 3; i++) if (available[i]) printf(" %9s", isas[i]);
+    printf("\n");
+
+    for (int op = 0; op < OP_COUNT_OPS; op++) {
+        for (size_t size = 16; size <= (size_t)16 << 20; size *= 16) {
+            BenchInput in;
+            make_input(&in, size);
+            char label[16];
+            if (size >= (1u << 20)) snprintf(label, sizeof(label), "%zuM", size >> 20);
+            else if (size >= 1024) snprintf(label, sizeof(label), "%zuK", size >> 10);
+            else snprintf(label, sizeof(label), "%zuB", size);
+
+            printf("%-12s %9s %9.2f", op_names[op], label, measure((BenchOp)op, true, &in, budget));
+            for (int i = 0; i < 3; i++) {
+                if (!available[i]) continue;
+                str_kernels_select(isas[i]);
+                printf(" %9.2f", measure((BenchOp)op, false, &in, budget));
+            }
+            printf("\n");
+            free_input(&in);
+        }
+    }
+    return 0;
+}
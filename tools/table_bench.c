@@ -0,0 +1,327 @@
+// table_bench - columnar Table operators vs row-at-a-time record loops
+//
+// Usage: table_bench [-n rows] [-r rounds]
+//
+// Builds n sales rows (default 10^7): region (one of 64 strings), qty
+// (int) and price (float), once as a columnar Table and once as an array
+// of boxed records with named fields, which is how a Rubolt script holds a
+// list of records. Each workload runs on both:
+//   filter     price > 500 and region == "r7" (record loop: append the
+//              matching records to a new list)
+//   group      group by region: sum(price), mean(qty), count (record loop:
+//              a string-keyed hash map of running totals)
+//   sort       by price (records: qsort reading the field by name)
+//   join       region -> manager from a 64-row dimension table (record
+//              loop: a string-keyed lookup and a new record per row)
+//   sum        sum(price) over all rows
+// The record loops are compiled C, so they are a lower bound for the same
+// loops run by the interpreter. Prints ms per run (best of rounds), the
+// speedup, and checks that both sides produce the same results.
+//
+// Build: make -C tools table_bench
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "table.h"
+#include "rb_collections.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+#define REGIONS 64
+
+static size_t n;
+static char region_names[REGIONS][8];
+static char manager_names[REGIONS][8];
+
+// ========== RECORDS ==========
+
+typedef struct {
+    const char *name;
+    RbValue value;
+} Field;
+
+typedef struct {
+    Field fields[3];
+} Record;
+
+static Record *records;
+
+static RbValue field(const Record *record, const char *name) {
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(record->fields[i].name, name) == 0) return record->fields[i].value;
+    }
+    return rb_value_null();
+}
+
+// String-keyed map of the kind a script dict provides
+typedef struct {
+    const char **keys;
+    double *sums;
+    double *qty;
+    uint64_t *counts;
+    const char **values;
+    size_t mask;
+    size_t count;
+} Dict;
+
+static void dict_init(Dict *dict, size_t size) {
+    dict->keys = calloc(size, sizeof(char *));
+    dict->sums = calloc(size, sizeof(double));
+    dict->qty = calloc(size, sizeof(double));
+    dict->counts = calloc(size, sizeof(uint64_t));
+    dict->values = calloc(size, sizeof(char *));
+    dict->mask = size - 1;
+    dict->count = 0;
+}
+
+static void dict_free(Dict *dict) {
+    free(dict->keys);
+    free(dict->sums);
+    free(dict->qty);
+    free(dict->counts);
+    free(dict->values);
+}
+
+static size_t dict_slot(Dict *dict, const char *key) {
+    size_t i = (size_t)rb_hash_string(key) & dict->mask;
+    while (dict->keys[i] && strcmp(dict->keys[i], key) != 0) i = (i + 1) & dict->mask;
+    if (!dict->keys[i]) {
+        dict->keys[i] = key;
+        dict->count++;
+    }
+    return i;
+}
+
+static uint64_t filter_records(void) {
+    Record **out = malloc(sizeof(Record *) * 16);
+    size_t count = 0, capacity = 16;
+    for (size_t i = 0; i < n; i++) {
+        if (field(&records[i], "price").data.f > 500 && strcmp(field(&records[i], "region").data.s, "r7") == 0) {
+            if (count == capacity) out = realloc(out, sizeof(Record *) * (capacity *= 2));
+            out[count++] = &records[i];
+        }
+    }
+    free(out);
+    return count;
+}
+
+static uint64_t group_records(void) {
+    Dict dict;
+    dict_init(&dict, 256);
+    for (size_t i = 0; i < n; i++) {
+        size_t slot = dict_slot(&dict, field(&records[i], "region").data.s);
+        dict.sums[slot] += field(&records[i], "price").data.f;
+        dict.qty[slot] += (double)field(&records[i], "qty").data.i;
+        dict.counts[slot]++;
+    }
+    double check = 0;
+    for (size_t i = 0; i <= dict.mask; i++) {
+        if (dict.keys[i]) check += round(dict.sums[i]) + round(dict.qty[i] / (double)dict.counts[i] * 1000) + (double)dict.counts[i];
+    }
+    dict_free(&dict);
+    return (uint64_t)check;
+}
+
+static int compare_price(const void *a, const void *b) {
+    double x = field(*(Record *const *)a, "price").data.f;
+    double y = field(*(Record *const *)b, "price").data.f;
+    return (x > y) - (x < y);
+}
+
+static uint64_t sort_records(void) {
+    Record **order = malloc(sizeof(Record *) * n);
+    for (size_t i = 0; i < n; i++) order[i] = &records[i];
+    qsort(order, n, sizeof(Record *), compare_price);
+    uint64_t check = 0;
+    for (size_t i = 0; i < n; i += n / 100 + 1) check = check * 31 + (uint64_t)(field(order[i], "price").data.f * 100);
+    free(order);
+    return check;
+}
+
+// A joined row is a new record: the left fields plus the manager
+typedef struct {
+    Field fields[4];
+} JoinedRecord;
+
+static uint64_t join_records(void) {
+    Dict managers;
+    dict_init(&managers, 256);
+    for (int r = 0; r < REGIONS; r++) managers.values[dict_slot(&managers, region_names[r])] = manager_names[r];
+    JoinedRecord *out = malloc(sizeof(JoinedRecord) * n);
+    for (size_t i = 0; i < n; i++) {
+        const char *manager = managers.values[dict_slot(&managers, field(&records[i], "region").data.s)];
+        memcpy(out[i].fields, records[i].fields, sizeof(records[i].fields));
+        out[i].fields[3] = (Field){ "manager", { RB_VAL_STRING, { .s = (char *)manager } } };
+    }
+    uint64_t check = 0;
+    for (size_t i = 0; i < n; i += 997) check += (uint64_t)out[i].fields[3].value.data.s[1];
+    free(out);
+    dict_free(&managers);
+    return check;
+}
+
+static uint64_t sum_records(void) {
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) sum += field(&records[i], "price").data.f;
+    return (uint64_t)round(sum);
+}
+
+// ========== COLUMNAR ==========
+
+static Table *table;
+static Table *managers;
+
+static uint64_t filter_table(void) {
+    Selection expensive, matched;
+    TableScalar price = { false, 500, NULL };
+    TableScalar region = { true, 0, "r7" };
+    table_filter(table, 2, TABLE_GT, price, NULL, &expensive);
+    table_filter(table, 0, TABLE_EQ, region, &expensive, &matched);
+    Table *result = table_take(table, &matched);
+    uint64_t count = result->rows;
+    table_free(result);
+    selection_free(&expensive);
+    selection_free(&matched);
+    return count;
+}
+
+static uint64_t group_table(void) {
+    TableAggSpec specs[] = { { TABLE_SUM, 2 }, { TABLE_MEAN, 1 }, { TABLE_COUNT, 0 } };
+    Table *groups = table_group_by(table, 0, specs, 3);
+    double check = 0;
+    for (size_t g = 0; g < groups->rows; g++) {
+        check += round(groups->columns[1].as.f64[g]) + round(groups->columns[2].as.f64[g] * 1000) +
+                 (double)groups->columns[3].as.i64[g];
+    }
+    table_free(groups);
+    return (uint64_t)check;
+}
+
+static uint64_t sort_table(void) {
+    Table *sorted = table_sort(table, 2, false);
+    uint64_t check = 0;
+    for (size_t i = 0; i < n; i += n / 100 + 1) check = check * 31 + (uint64_t)(sorted->columns[2].as.f64[i] * 100);
+    table_free(sorted);
+    return check;
+}
+
+static uint64_t join_table(void) {
+    Table *joined = table_join(table, 0, managers, 0);
+    uint64_t check = 0;
+    for (size_t i = 0; i < n; i += 997) check += (uint64_t)table_get_string(joined, 3, i)[1];
+    table_free(joined);
+    return check;
+}
+
+static uint64_t sum_table(void) {
+    return (uint64_t)round(table_aggregate(table, 2, TABLE_SUM, NULL));
+}
+
+// ========== DRIVER ==========
+
+typedef uint64_t (*Workload)(void);
+
+static double best_of(Workload workload, int rounds, uint64_t *checksum) {
+    double best = 1e30;
+    for (int r = 0; r < rounds; r++) {
+        double start = now_sec();
+        *checksum = workload();
+        double elapsed = now_sec() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+static int compare(const char *name, Workload fast, Workload slow, int rounds) {
+    uint64_t a, b;
+    double t_fast = best_of(fast, rounds, &a);
+    double t_slow = best_of(slow, rounds, &b);
+    printf("%-7s %10zu %12.1f %12.1f %9.1fx%s\n", name, n, t_fast * 1e3, t_slow * 1e3, t_slow / t_fast,
+           a == b ? "" : "  MISMATCH");
+    return a == b ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    n = 10000000;
+    int rounds = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) n = (size_t)strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) rounds = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-n rows] [-r rounds]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (n < 1000 || n > TABLE_MAX_ROWS || rounds < 1) {
+        fprintf(stderr, "rows must be in [1000, 2^32) and rounds >= 1\n");
+        return 2;
+    }
+
+    for (int r = 0; r < REGIONS; r++) {
+        snprintf(region_names[r], sizeof(region_names[r]), "r%d", r);
+        snprintf(manager_names[r], sizeof(manager_names[r]), "m%d", r);
+    }
+    table = table_new(n);
+    records = malloc(sizeof(Record) * n);
+    if (!table || !records || !table_add_column(table, "region", TABLE_STRING, NULL) ||
+        !table_add_column(table, "qty", TABLE_INT64, NULL) || !table_add_column(table, "price", TABLE_FLOAT64, NULL)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    // Each add may move the columns, so take pointers only after the last
+    Column *region = &table->columns[0], *qty = &table->columns[1], *price = &table->columns[2];
+    uint32_t codes[REGIONS];
+    for (int r = 0; r < REGIONS; r++) codes[r] = string_dict_intern(region->dict, region_names[r], strlen(region_names[r]));
+    for (size_t i = 0; i < n; i++) {
+        int r = (int)(next_random() % REGIONS);
+        int64_t q = (int64_t)(next_random() % 50) + 1;
+        double p = (double)(next_random() % 100000) / 100.0;
+        region->as.codes[i] = codes[r];
+        qty->as.i64[i] = q;
+        price->as.f64[i] = p;
+        records[i].fields[0] = (Field){ "region", { RB_VAL_STRING, { .s = region_names[r] } } };
+        records[i].fields[1] = (Field){ "qty", rb_value_int(q) };
+        records[i].fields[2] = (Field){ "price", rb_value_float(p) };
+    }
+    managers = table_new(REGIONS);
+    if (!managers || !table_add_column(managers, "region", TABLE_STRING, NULL) ||
+        !table_add_column(managers, "manager", TABLE_STRING, NULL)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    Column *key = &managers->columns[0], *name = &managers->columns[1];
+    for (int r = 0; r < REGIONS; r++) {
+        key->as.codes[r] = string_dict_intern(key->dict, region_names[r], strlen(region_names[r]));
+        name->as.codes[r] = string_dict_intern(name->dict, manager_names[r], strlen(manager_names[r]));
+    }
+
+    printf("%-7s %10s %12s %12s %10s\n", "work", "rows", "table ms", "records ms", "speedup");
+    int failures = 0;
+    failures += compare("filter", filter_table, filter_records, rounds);
+    failures += compare("group", group_table, group_records, rounds);
+    failures += compare("sort", sort_table, sort_records, rounds);
+    failures += compare("join", join_table, join_records, rounds);
+    failures += compare("sum", sum_table, sum_records, rounds);
+
+    table_free(table);
+    table_free(managers);
+    free(records);
+    return failures ? 1 : 0;
+}